@@ -21,6 +21,7 @@
 #include <lists/string_list.h>
 #include <conversion/float_to_s16.h>
 #include <conversion/s16_to_float.h>
+#include <features/features_cpu.h>
 
 #ifdef HAVE_CONFIG_H
 #include "../config.h"
@@ -31,6 +32,7 @@
 #include "audio_resampler_driver.h"
 #include "../record/record_driver.h"
 #include "audio_thread_wrapper.h"
+#include "audio_telemetry.h"
 
 #include "../command.h"
 #include "../driver.h"
@@ -45,6 +47,12 @@
 #define AUDIO_BUFFER_FREE_SAMPLES_COUNT (8 * 1024)
 #endif
 
+/* Without a DSP filter, audio is converted and resampled in blocks
+ * of at most this many frames, so the intermediate float samples
+ * stay in L1 cache. */
+#define AUDIO_FUSED_IN_FRAMES  256
+#define AUDIO_FUSED_OUT_FRAMES 1024
+
 struct audio_driver_input_data
 {
    float *data;
@@ -61,6 +69,8 @@ struct audio_driver_input_data
    struct
    {
       float input;
+      /* Core sample rate, without the timing skew correction. */
+      float nominal_input;
       bool  control; 
       struct
       {
@@ -88,6 +98,8 @@ struct audio_driver_input_data
    {
       float *buf;
       int16_t *conv_buf;
+      /* Resampler output of one fused block. */
+      float *block_buf;
    } output_samples;
 
    struct
@@ -95,6 +107,13 @@ struct audio_driver_input_data
       unsigned buf[AUDIO_BUFFER_FREE_SAMPLES_COUNT];
       uint64_t count;
    } free_samples;
+
+   /* State of the current flush, for audio_telemetry_push(). */
+   struct
+   {
+      retro_time_t flush_start;
+      unsigned avail;
+   } telemetry;
 };
 
 static const audio_driver_t *audio_drivers[] = {
@@ -164,6 +183,9 @@ static struct audio_driver_input_data audio_driver_data;
 static struct retro_audio_callback audio_callback;
 static struct string_list *audio_driver_devices_list   = NULL;
 static struct retro_perf_counter resampler_proc        = {0};
+static struct retro_perf_counter audio_convert_s16     = {0};
+static struct retro_perf_counter audio_convert_float   = {0};
+static struct retro_perf_counter audio_dsp             = {0};
 static const rarch_resampler_t *audio_driver_resampler = NULL;
 static void *audio_driver_resampler_data               = NULL;
 static bool audio_driver_active                        = false;
@@ -304,10 +326,16 @@ static bool uninit_audio(void)
       free(audio_driver_data.output_samples.buf);
    audio_driver_data.output_samples.buf = NULL;
 
+   if (audio_driver_data.output_samples.block_buf)
+      free(audio_driver_data.output_samples.block_buf);
+   audio_driver_data.output_samples.block_buf = NULL;
+
    command_event(CMD_EVENT_DSP_FILTER_DEINIT, NULL);
 
    compute_audio_buffer_statistics();
 
+   audio_telemetry_deinit();
+
    return true;
 }
 
@@ -432,6 +460,13 @@ static bool audio_driver_init_internal(bool audio_cb_inited)
    if (!audio_driver_data.output_samples.buf)
       goto error;
 
+   audio_driver_data.output_samples.block_buf = (float*)
+      malloc(AUDIO_FUSED_OUT_FRAMES * 2 * sizeof(float));
+   retro_assert(audio_driver_data.output_samples.block_buf != NULL);
+
+   if (!audio_driver_data.output_samples.block_buf)
+      goto error;
+
    audio_driver_data.audio_rate.control = false;
    if (
          !audio_cb_inited
@@ -455,6 +490,9 @@ static bool audio_driver_init_internal(bool audio_cb_inited)
 
    audio_driver_data.free_samples.count = 0;
 
+   if (!audio_telemetry_init())
+      RARCH_WARN("Failed to initialize audio telemetry.\n");
+
    /* Threaded driver is initially stopped. */
    if (
          audio_driver_is_active()
@@ -492,6 +530,7 @@ static void audio_driver_readjust_input_rate(void)
 #endif
 
    audio_driver_data.free_samples.buf[write_idx] = avail;
+   audio_driver_data.telemetry.avail             = avail;
    audio_driver_data.audio_rate.source_ratio.current = 
       audio_driver_data.audio_rate.source_ratio.original * adjust;
 
@@ -517,10 +556,111 @@ void audio_driver_set_nonblocking_state(bool enable)
       audio_driver_data.chunk.block_size;
 }
 
+static bool audio_driver_write(const void *data, size_t size)
+{
+   struct audio_telemetry_sample sample;
+   settings_t *settings = config_get_ptr();
+
+   if (current_audio->write(audio_driver_context_audio_data,
+            data, size) < 0)
+   {
+      audio_driver_unset_active();
+      return false;
+   }
+
+   sample.free_bytes   = audio_driver_data.telemetry.avail;
+   sample.buffer_bytes = audio_driver_data.driver_buffer_size;
+   sample.write_bytes  = size;
+   sample.write_usec   = cpu_features_get_time_usec()
+      - audio_driver_data.telemetry.flush_start;
+   sample.ratio_drift  = audio_driver_data.audio_rate.source_ratio.current
+      / audio_driver_data.audio_rate.source_ratio.original - 1.0;
+   sample.byte_rate    = settings->audio.out_rate * 2 *
+      (audio_driver_data.use_float ? sizeof(float) : sizeof(int16_t));
+   audio_telemetry_push(&sample);
+
+   return true;
+}
+
+/**
+ * audio_driver_flush_fused:
+ * @data                 : pointer to audio buffer.
+ * @samples              : amount of samples to write.
+ * @ratio                : resampling ratio.
+ *
+ * Converts, resamples and converts back one block at a time
+ * instead of making a full pass over the samples for each step.
+ * Only used without a DSP filter, which needs the whole input.
+ *
+ * Returns: true (1) if audio samples were written to the audio
+ * driver, false (0) in case of an error.
+ **/
+static bool audio_driver_flush_fused(const int16_t *data, size_t samples,
+      double ratio)
+{
+   size_t i, block_frames;
+   size_t frames        = samples >> 1;
+   size_t output_frames = 0;
+   float *out_float     = audio_driver_data.output_samples.buf;
+   /* In s16 mode, the float output buffer is unused, so it
+    * takes the converted samples. audio_driver_data.output_samples.conv_buf
+    * can't, as it may hold the input. */
+   int16_t *out_s16     = (int16_t*)audio_driver_data.output_samples.buf;
+
+   /* Keep the resampler output of a block within block_buf. */
+   block_frames = (size_t)((AUDIO_FUSED_OUT_FRAMES - 2) / ratio);
+   if (block_frames > AUDIO_FUSED_IN_FRAMES)
+      block_frames = AUDIO_FUSED_IN_FRAMES;
+   else if (block_frames > 8)
+      block_frames &= ~7;
+   else if (block_frames < 1)
+      block_frames = 1;
+
+   performance_counter_init(&audio_convert_s16, "audio_convert_s16");
+   performance_counter_init(&audio_convert_float, "audio_convert_float");
+
+   for (i = 0; i < frames; i += block_frames)
+   {
+      struct resampler_data src_data = {0};
+      size_t in_frames               = MIN(frames - i, block_frames);
+
+      performance_counter_start(&audio_convert_s16);
+      convert_s16_to_float(audio_driver_data.data, data + i * 2,
+            in_frames * 2, audio_driver_data.volume_gain);
+      performance_counter_stop(&audio_convert_s16);
+
+      src_data.data_in      = audio_driver_data.data;
+      src_data.input_frames = in_frames;
+      src_data.ratio        = ratio;
+      src_data.data_out     = audio_driver_data.use_float
+         ? out_float + output_frames * 2
+         : audio_driver_data.output_samples.block_buf;
+
+      audio_driver_process_resampler(&src_data);
+
+      if (!audio_driver_data.use_float)
+      {
+         performance_counter_start(&audio_convert_float);
+         convert_float_to_s16(out_s16 + output_frames * 2,
+               audio_driver_data.output_samples.block_buf,
+               src_data.output_frames * 2);
+         performance_counter_stop(&audio_convert_float);
+      }
+
+      output_frames += src_data.output_frames;
+   }
+
+   if (audio_driver_data.use_float)
+      return audio_driver_write(out_float,
+            output_frames * sizeof(float) * 2);
+   return audio_driver_write(out_s16,
+         output_frames * sizeof(int16_t) * 2);
+}
+
 /**
  * audio_driver_flush:
  * @data                 : pointer to audio buffer.
- * @right                : amount of samples to write.
+ * @samples              : amount of samples to write.
  *
  * Writes audio samples to audio driver. Will first
  * perform DSP processing (if enabled) and resampling.
@@ -530,14 +670,12 @@ void audio_driver_set_nonblocking_state(bool enable)
  **/
 static bool audio_driver_flush(const int16_t *data, size_t samples)
 {
-   static struct retro_perf_counter audio_convert_s16 = {0};
-   static struct retro_perf_counter audio_convert_float = {0};
-   static struct retro_perf_counter audio_dsp         = {0};
    struct resampler_data src_data              = {0};
    struct rarch_dsp_data dsp_data              = {0};
    const void *output_data                     = NULL;
    unsigned output_frames                      = 0;
    size_t   output_size                        = sizeof(float);
+   double   ratio                              = 0.0;
    settings_t *settings                        = config_get_ptr();
 
    recording_push_audio(data, samples);
@@ -549,6 +687,20 @@ static bool audio_driver_flush(const int16_t *data, size_t samples)
    if (!audio_driver_data.data)
       return false;
 
+   audio_driver_data.telemetry.flush_start = cpu_features_get_time_usec();
+   audio_driver_data.telemetry.avail       = AUDIO_TELEMETRY_UNKNOWN;
+
+   if (audio_driver_data.audio_rate.control)
+      audio_driver_readjust_input_rate();
+
+   ratio = audio_driver_data.audio_rate.source_ratio.current;
+
+   if (runloop_ctl(RUNLOOP_CTL_IS_SLOWMOTION, NULL))
+      ratio *= settings->slowmotion_ratio;
+
+   if (!audio_driver_data.dsp)
+      return audio_driver_flush_fused(data, samples, ratio);
+
    performance_counter_init(&audio_convert_s16, "audio_convert_s16");
    performance_counter_start(&audio_convert_s16);
    convert_s16_to_float(audio_driver_data.data, data, samples,
@@ -561,29 +713,19 @@ static bool audio_driver_flush(const int16_t *data, size_t samples)
    dsp_data.input                 = audio_driver_data.data;
    dsp_data.input_frames          = samples >> 1;
 
-   if (audio_driver_data.dsp)
-   {
-      performance_counter_init(&audio_dsp, "audio_dsp");
-      performance_counter_start(&audio_dsp);
-      rarch_dsp_filter_process(audio_driver_data.dsp, &dsp_data);
-      performance_counter_stop(&audio_dsp);
+   performance_counter_init(&audio_dsp, "audio_dsp");
+   performance_counter_start(&audio_dsp);
+   rarch_dsp_filter_process(audio_driver_data.dsp, &dsp_data);
+   performance_counter_stop(&audio_dsp);
 
-      if (dsp_data.output)
-      {
-         src_data.data_in      = dsp_data.output;
-         src_data.input_frames = dsp_data.output_frames;
-      }
+   if (dsp_data.output)
+   {
+      src_data.data_in      = dsp_data.output;
+      src_data.input_frames = dsp_data.output_frames;
    }
 
    src_data.data_out = audio_driver_data.output_samples.buf;
-
-   if (audio_driver_data.audio_rate.control)
-      audio_driver_readjust_input_rate();
-
-   src_data.ratio = audio_driver_data.audio_rate.source_ratio.current;
-
-   if (runloop_ctl(RUNLOOP_CTL_IS_SLOWMOTION, NULL))
-      src_data.ratio *= settings->slowmotion_ratio;
+   src_data.ratio    = ratio;
 
    audio_driver_process_resampler(&src_data);
 
@@ -602,14 +744,7 @@ static bool audio_driver_flush(const int16_t *data, size_t samples)
       output_size = sizeof(int16_t);
    }
 
-   if (current_audio->write(audio_driver_context_audio_data,
-            output_data, output_frames * output_size * 2) < 0)
-   {
-      audio_driver_unset_active();
-      return false;
-   }
-
-   return true;
+   return audio_driver_write(output_data, output_frames * output_size * 2);
 }
 
 /**
@@ -706,8 +841,11 @@ void audio_driver_dsp_filter_free(void)
 
 void audio_driver_dsp_filter_init(const char *device)
 {
+   settings_t *settings  = config_get_ptr();
+
    audio_driver_data.dsp = rarch_dsp_filter_new(
-         device, audio_driver_data.audio_rate.input);
+         device, audio_driver_data.audio_rate.input,
+         settings->audio.dsp_thread);
 
    if (!audio_driver_data.dsp)
       RARCH_ERR("[DSP]: Failed to initialize DSP filter \"%s\".\n", device);
@@ -732,7 +870,8 @@ void audio_driver_monitor_adjust_system_rates(void)
       return;
 
    timing_skew        = fabs(1.0f - info->fps / settings->video.refresh_rate);
-   audio_driver_data.audio_rate.input = info->sample_rate;
+   audio_driver_data.audio_rate.input         = info->sample_rate;
+   audio_driver_data.audio_rate.nominal_input = info->sample_rate;
 
    if (timing_skew <= settings->audio.max_timing_skew)
       audio_driver_data.audio_rate.input *= (settings->video.refresh_rate / info->fps);
@@ -837,14 +976,25 @@ bool audio_driver_get_devices_list(void **data)
    return true;
 }
 
+/* Resamplers are created with the nominal ratio of the core, so
+ * that the polyphase resampler sees the core's fixed rate. The skew
+ * correction is within max_timing_skew, so the filter cutoff of the
+ * other resamplers barely moves. */
 bool audio_driver_init_resampler(void)
 {
    settings_t *settings = config_get_ptr();
+   double ratio         = audio_driver_data.audio_rate.source_ratio.original;
+
+   if (audio_driver_data.audio_rate.nominal_input > 0.0f)
+      ratio = (double)settings->audio.out_rate
+         / audio_driver_data.audio_rate.nominal_input;
+
    return rarch_resampler_realloc(
          &audio_driver_resampler_data,
          &audio_driver_resampler,
          settings->audio.resampler,
-         audio_driver_data.audio_rate.source_ratio.original);
+         ratio,
+         (enum resampler_quality)settings->audio.resampler_quality);
 }
 
 void audio_driver_process_resampler(void *data)
@@ -15,16 +15,20 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <retro_miscellaneous.h>
+#include <memalign.h>
 
 #include <compat/posix_string.h>
 #include <dynamic/dylib.h>
 
 #include <file/file_path.h>
 #include <lists/dir_list.h>
-#include <features/features_cpu.h>
 #include <string/stdstring.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #include "audio_dsp_filter.h"
 #include "audio_filters/dspfilter.h"
@@ -48,6 +52,44 @@ struct rarch_dsp_instance
    void *impl_data;
 };
 
+/* Set by rarch_dsp_filter_init() at startup. */
+static dspfilter_simd_mask_t dsp_filter_simd;
+
+#ifdef DSP_BENCH
+/* Cleared by dsp-bench to compare against the process callbacks. */
+extern bool dsp_bench_use_block;
+#define DSP_IMPL_HAS_BLOCK(impl) \
+   (dsp_bench_use_block && (impl)->api_version >= 2 && (impl)->process_block)
+#else
+#define DSP_IMPL_HAS_BLOCK(impl) \
+   ((impl)->api_version >= 2 && (impl)->process_block)
+#endif
+
+#ifdef HAVE_THREADS
+/* Runs the filter chain one call behind the caller. */
+struct rarch_dsp_worker
+{
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+
+   /* Copy of the input of the current job. */
+   float *input;
+   unsigned input_frames;
+   unsigned input_capacity;
+
+   /* Alternating between jobs, as the caller still reads
+    * the previous result while the next job is running. */
+   float *output[2];
+   unsigned output_frames[2];
+   unsigned output_capacity[2];
+   unsigned job;
+
+   bool busy;
+   bool quit;
+};
+#endif
+
 struct rarch_dsp_filter
 {
    config_file_t *conf;
@@ -57,6 +99,13 @@ struct rarch_dsp_filter
 
    struct rarch_dsp_instance *instances;
    unsigned num_instances;
+
+   /* Channel-planar buffers for block filters. */
+   float *planar[2];
+
+#ifdef HAVE_THREADS
+   struct rarch_dsp_worker *worker;
+#endif
 };
 
 static const struct dspfilter_implementation *find_implementation(
@@ -134,6 +183,7 @@ extern const struct dspfilter_implementation *phaser_dspfilter_get_implementatio
 extern const struct dspfilter_implementation *wahwah_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
 extern const struct dspfilter_implementation *eq_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
 extern const struct dspfilter_implementation *chorus_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *reverb_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
 
 static const dspfilter_get_implementation_t dsp_plugs_builtin[] = {
    panning_dspfilter_get_implementation,
@@ -143,12 +193,13 @@ static const dspfilter_get_implementation_t dsp_plugs_builtin[] = {
    wahwah_dspfilter_get_implementation,
    eq_dspfilter_get_implementation,
    chorus_dspfilter_get_implementation,
+   reverb_dspfilter_get_implementation,
 };
 
 static bool append_plugs(rarch_dsp_filter_t *dsp, struct string_list *list)
 {
    unsigned i;
-   dspfilter_simd_mask_t mask = cpu_features_get();
+   dspfilter_simd_mask_t mask = dsp_filter_simd;
 
    (void)list;
 
@@ -172,7 +223,7 @@ static bool append_plugs(rarch_dsp_filter_t *dsp, struct string_list *list)
 static bool append_plugs(rarch_dsp_filter_t *dsp, struct string_list *list)
 {
    unsigned i;
-   dspfilter_simd_mask_t mask = cpu_features_get();
+   dspfilter_simd_mask_t mask = dsp_filter_simd;
 
    for (i = 0; i < list->size; i++)
    {
@@ -198,7 +249,7 @@ static bool append_plugs(rarch_dsp_filter_t *dsp, struct string_list *list)
          continue;
       }
 
-      if (impl->api_version != DSPFILTER_API_VERSION)
+      if (impl->api_version < 1 || impl->api_version > DSPFILTER_API_VERSION)
       {
          dylib_close(lib);
          continue;
@@ -224,13 +275,169 @@ static bool append_plugs(rarch_dsp_filter_t *dsp, struct string_list *list)
 }
 #endif
 
+static void dsp_filter_run(rarch_dsp_filter_t *dsp,
+      float *samples, unsigned frames,
+      float **out_samples, unsigned *out_frames);
+
+#ifdef HAVE_THREADS
+static bool dsp_worker_reserve(float **buf, unsigned *capacity,
+      unsigned frames)
+{
+   float *new_buf;
+
+   if (frames <= *capacity)
+      return true;
+
+   new_buf = (float*)realloc(*buf, frames * 2 * sizeof(float));
+   if (!new_buf)
+      return false;
+
+   *buf      = new_buf;
+   *capacity = frames;
+   return true;
+}
+
+static void dsp_worker_thread(void *data)
+{
+   rarch_dsp_filter_t      *dsp = (rarch_dsp_filter_t*)data;
+   struct rarch_dsp_worker *w   = dsp->worker;
+
+   for (;;)
+   {
+      float *samples;
+      unsigned frames, job;
+
+      slock_lock(w->lock);
+      while (!w->busy && !w->quit)
+         scond_wait(w->cond, w->lock);
+      if (w->quit)
+      {
+         slock_unlock(w->lock);
+         break;
+      }
+      job = w->job;
+      slock_unlock(w->lock);
+
+      /* The caller doesn't touch the input or this job's
+       * output buffer until busy is cleared. */
+      dsp_filter_run(dsp, w->input, w->input_frames, &samples, &frames);
+
+      if (!dsp_worker_reserve(&w->output[job],
+               &w->output_capacity[job], frames))
+         frames = 0;
+      if (frames)
+         memcpy(w->output[job], samples, frames * 2 * sizeof(float));
+
+      slock_lock(w->lock);
+      w->output_frames[job] = frames;
+      w->busy               = false;
+      scond_signal(w->cond);
+      slock_unlock(w->lock);
+   }
+}
+
+static void dsp_worker_free(rarch_dsp_filter_t *dsp)
+{
+   struct rarch_dsp_worker *w = dsp->worker;
+
+   if (!w)
+      return;
+
+   if (w->thread)
+   {
+      slock_lock(w->lock);
+      w->quit = true;
+      scond_signal(w->cond);
+      slock_unlock(w->lock);
+      sthread_join(w->thread);
+   }
+
+   if (w->lock)
+      slock_free(w->lock);
+   if (w->cond)
+      scond_free(w->cond);
+
+   free(w->input);
+   free(w->output[0]);
+   free(w->output[1]);
+   free(w);
+   dsp->worker = NULL;
+}
+
+static bool dsp_worker_init(rarch_dsp_filter_t *dsp)
+{
+   struct rarch_dsp_worker *w = (struct rarch_dsp_worker*)
+      calloc(1, sizeof(*w));
+   if (!w)
+      return false;
+
+   dsp->worker = w;
+   w->lock     = slock_new();
+   w->cond     = scond_new();
+
+   /* The first call returns an empty, but valid, result. */
+   if (!w->lock || !w->cond
+         || !dsp_worker_reserve(&w->output[0], &w->output_capacity[0], 1)
+         || !dsp_worker_reserve(&w->output[1], &w->output_capacity[1], 1))
+      goto error;
+
+   w->thread = sthread_create(dsp_worker_thread, dsp);
+   if (!w->thread)
+      goto error;
+
+   return true;
+
+error:
+   dsp_worker_free(dsp);
+   return false;
+}
+
+static void dsp_worker_process(rarch_dsp_filter_t *dsp,
+      struct rarch_dsp_data *data)
+{
+   unsigned prev;
+   struct rarch_dsp_worker *w = dsp->worker;
+
+   slock_lock(w->lock);
+   while (w->busy)
+      scond_wait(w->cond, w->lock);
+
+   prev                = w->job;
+   data->output        = w->output[prev];
+   data->output_frames = w->output_frames[prev];
+
+   w->job              = prev ^ 1;
+
+   /* Without room for the input, the next call returns no frames
+    * instead of handing out this result a second time. */
+   if (dsp_worker_reserve(&w->input, &w->input_capacity,
+            data->input_frames))
+   {
+      memcpy(w->input, data->input,
+            data->input_frames * 2 * sizeof(float));
+      w->input_frames = data->input_frames;
+      w->busy         = true;
+      scond_signal(w->cond);
+   }
+   else
+      w->output_frames[w->job] = 0;
+   slock_unlock(w->lock);
+}
+#endif
+
+void rarch_dsp_filter_init(uint64_t simd)
+{
+   dsp_filter_simd = (dspfilter_simd_mask_t)simd;
+}
+
 rarch_dsp_filter_t *rarch_dsp_filter_new(
-      const char *filter_config, float sample_rate)
+      const char *filter_config, float sample_rate, bool threaded)
 {
 #if !defined(HAVE_FILTERS_BUILTIN) && defined(HAVE_DYLIB)
    char basedir[PATH_MAX_LENGTH];
    char ext_name[PATH_MAX_LENGTH];
 #endif
+   unsigned i;
    struct string_list *plugs     = NULL;
    rarch_dsp_filter_t *dsp       = NULL;
 
@@ -265,6 +472,19 @@ rarch_dsp_filter_t *rarch_dsp_filter_new(
    if (!create_filter_graph(dsp, sample_rate))
       goto error;
 
+   for (i = 0; i < 2; i++)
+   {
+      dsp->planar[i] = (float*)memalign_alloc(DSPFILTER_BLOCK_ALIGNMENT,
+            DSPFILTER_BLOCK_MAX_FRAMES * sizeof(float));
+      if (!dsp->planar[i])
+         goto error;
+   }
+
+#ifdef HAVE_THREADS
+   if (threaded && !dsp_worker_init(dsp))
+      goto error;
+#endif
+
    return dsp;
 
 error:
@@ -280,6 +500,10 @@ void rarch_dsp_filter_free(rarch_dsp_filter_t *dsp)
    if (!dsp)
       return;
 
+#ifdef HAVE_THREADS
+   dsp_worker_free(dsp);
+#endif
+
    for (i = 0; i < dsp->num_instances; i++)
    {
       if (dsp->instances[i].impl_data && dsp->instances[i].impl)
@@ -296,30 +520,99 @@ void rarch_dsp_filter_free(rarch_dsp_filter_t *dsp)
    free(dsp->plugs);
 #endif
 
+   for (i = 0; i < 2; i++)
+      memalign_free(dsp->planar[i]);
+
    if (dsp->conf)
       config_file_free(dsp->conf);
 
    free(dsp);
 }
 
-void rarch_dsp_filter_process(rarch_dsp_filter_t *dsp,
-      struct rarch_dsp_data *data)
+/* Runs instances [first, last), which all have process_block,
+ * on interleaved samples in place. */
+static void dsp_filter_run_blocks(rarch_dsp_filter_t *dsp,
+      unsigned first, unsigned last, float *samples, unsigned frames)
 {
-   unsigned i;
+   unsigned i, j;
+   struct dspfilter_block block;
+
+   block.channels[0] = dsp->planar[0];
+   block.channels[1] = dsp->planar[1];
+
+   while (frames)
+   {
+      block.frames = MIN(frames, DSPFILTER_BLOCK_MAX_FRAMES);
+
+      for (j = 0; j < block.frames; j++)
+      {
+         block.channels[0][j] = samples[2 * j + 0];
+         block.channels[1][j] = samples[2 * j + 1];
+      }
+
+      for (i = first; i < last; i++)
+         dsp->instances[i].impl->process_block(
+               dsp->instances[i].impl_data, &block);
+
+      for (j = 0; j < block.frames; j++)
+      {
+         samples[2 * j + 0] = block.channels[0][j];
+         samples[2 * j + 1] = block.channels[1][j];
+      }
+
+      samples += block.frames * 2;
+      frames  -= block.frames;
+   }
+}
+
+static void dsp_filter_run(rarch_dsp_filter_t *dsp,
+      float *samples, unsigned frames,
+      float **out_samples, unsigned *out_frames)
+{
+   unsigned i = 0;
    struct dspfilter_output output = {0};
    struct dspfilter_input input   = {0};
 
-   output.samples = data->input;
-   output.frames  = data->input_frames;
+   output.samples = samples;
+   output.frames  = frames;
 
-   for (i = 0; i < dsp->num_instances; i++)
+   while (i < dsp->num_instances)
    {
+      const struct dspfilter_implementation *impl = dsp->instances[i].impl;
+
+      if (DSP_IMPL_HAS_BLOCK(impl))
+      {
+         unsigned last = i + 1;
+         while (last < dsp->num_instances
+               && DSP_IMPL_HAS_BLOCK(dsp->instances[last].impl))
+            last++;
+
+         dsp_filter_run_blocks(dsp, i, last, output.samples, output.frames);
+         i = last;
+         continue;
+      }
+
       input.samples = output.samples;
       input.frames  = output.frames;
-      dsp->instances[i].impl->process(
-            dsp->instances[i].impl_data, &output, &input);
+      impl->process(dsp->instances[i].impl_data, &output, &input);
+      i++;
    }
 
-   data->output        = output.samples;
-   data->output_frames = output.frames;
+   *out_samples = output.samples;
+   *out_frames  = output.frames;
+}
+
+void rarch_dsp_filter_process(rarch_dsp_filter_t *dsp,
+      struct rarch_dsp_data *data)
+{
+#ifdef HAVE_THREADS
+   if (dsp->worker)
+   {
+      dsp_worker_process(dsp, data);
+      return;
+   }
+#endif
+
+   dsp_filter_run(dsp, data->input, data->input_frames,
+         &data->output, &data->output_frames);
 }
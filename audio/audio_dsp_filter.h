@@ -17,14 +17,39 @@
 #ifndef __AUDIO_DSP_FILTER_H__
 #define __AUDIO_DSP_FILTER_H__
 
+#include <stdint.h>
+
+#include <boolean.h>
 #include <retro_common_api.h>
 
 RETRO_BEGIN_DECLS
 
 typedef struct rarch_dsp_filter rarch_dsp_filter_t;
 
+/**
+ * rarch_dsp_filter_init:
+ * @simd                 : mask of RETRO_SIMD_* flags.
+ *
+ * Sets the CPU features the filter plugins pick their kernels
+ * for, usually from cpu_features_get(). Until then, they use
+ * plain C. Only filter chains created afterwards are affected.
+ **/
+void rarch_dsp_filter_init(uint64_t simd);
+
+/**
+ * rarch_dsp_filter_new:
+ * @filter_config        : path to a .dsp preset.
+ * @sample_rate          : input sample rate.
+ * @threaded             : run the filter chain on a worker thread.
+ *
+ * If @threaded is set, rarch_dsp_filter_process() hands the input
+ * to a worker thread and returns the result of the previous call,
+ * which adds one call worth of latency.
+ *
+ * Returns: new filter chain, or NULL on failure.
+ **/
 rarch_dsp_filter_t *rarch_dsp_filter_new(const char *filter_config,
-      float sample_rate);
+      float sample_rate, bool threaded);
 
 void rarch_dsp_filter_free(rarch_dsp_filter_t *dsp);
 
@@ -33,7 +58,8 @@ struct rarch_dsp_data
    float *input;
    unsigned input_frames;
 
-   /* Set by rarch_dsp_filter_process(). */
+   /* Set by rarch_dsp_filter_process().
+    * Valid until the next call. */
    float *output;
    unsigned output_frames;
 };
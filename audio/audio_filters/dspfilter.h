@@ -53,7 +53,8 @@ typedef const struct dspfilter_implementation *(
 const struct dspfilter_implementation *dspfilter_get_implementation(
       dspfilter_simd_mask_t mask);
 
-#define DSPFILTER_API_VERSION 1
+/* Version 2 adds the optional process_block callback. */
+#define DSPFILTER_API_VERSION 2
 
 struct dspfilter_info
 {
@@ -109,6 +110,28 @@ struct dspfilter_input
    unsigned frames;
 };
 
+/* Start of each channel in a dspfilter_block, in bytes. */
+#define DSPFILTER_BLOCK_ALIGNMENT  32
+
+/* Upper bound for dspfilter_block::frames. */
+#define DSPFILTER_BLOCK_MAX_FRAMES 1024
+
+struct dspfilter_block
+{
+   /* Channel-planar samples, left in channels[0] and
+    * right in channels[1]. Both are aligned to
+    * DSPFILTER_BLOCK_ALIGNMENT bytes.
+    *
+    * The block is processed in place, so the number of
+    * output frames is always the same as the input. Block
+    * based filters have to buffer internally, and add a
+    * fixed latency instead of returning variable sizes. */
+   float *channels[2];
+
+   /* Number of frames, at most DSPFILTER_BLOCK_MAX_FRAMES. */
+   unsigned frames;
+};
+
 /* Returns true if config key was found. Otherwise, 
  * returns false, and sets value to default value.
  */
@@ -160,13 +183,18 @@ typedef void (*dspfilter_free_t)(void *data);
 typedef void (*dspfilter_process_t)(void *data,
       struct dspfilter_output *output, const struct dspfilter_input *input);
 
+/* Processes a block of channel-planar data in place. */
+typedef void (*dspfilter_process_block_t)(void *data,
+      struct dspfilter_block *block);
+
 struct dspfilter_implementation
 {
    dspfilter_init_t     init;
    dspfilter_process_t  process;
    dspfilter_free_t     free;
 
-   /* Must be DSPFILTER_API_VERSION */
+   /* DSPFILTER_API_VERSION the plugin was built against.
+    * Plugins built against version 1 are still loaded. */
    unsigned api_version;
 
    /* Human readable identifier of implementation. */
@@ -175,6 +203,11 @@ struct dspfilter_implementation
    /* Computer-friendly short version of ident.
     * Lower case, no spaces and special characters, etc. */
    const char *short_ident; 
+
+   /* Since version 2. Optional, used instead of process
+    * when set. Consecutive block filters in a chain share
+    * one conversion to and from the planar layout. */
+   dspfilter_process_block_t process_block;
 };
 
 RETRO_END_DECLS
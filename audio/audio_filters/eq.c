@@ -35,6 +35,16 @@ struct eq_data
    fft_complex_t *fftblock;
    unsigned block_size;
    unsigned block_ptr;
+
+   /* Channel-planar state of process_block, one block each:
+    * input collected so far, output of the last convolution,
+    * and the tail carried over into the next one. The
+    * convolution result itself needs two blocks. */
+   float *planar_in[2];
+   float *planar_out[2];
+   float *planar_save[2];
+   float *planar_conv[2];
+   unsigned planar_ptr;
 };
 
 struct eq_gain
@@ -54,6 +64,7 @@ static void eq_free(void *data)
    free(eq->block);
    free(eq->fftblock);
    free(eq->filter);
+   free(eq->planar_in[0]);
    free(eq);
 }
 
@@ -112,6 +123,63 @@ static void eq_process(void *data, struct dspfilter_output *output,
    }
 }
 
+/* Both channels are convolved with one complex FFT, as
+ * left + i * right. The filter is real, so the channels
+ * come out again in the real and imaginary parts. */
+static void eq_convolve_planar(struct eq_data *eq)
+{
+   unsigned i, c;
+   unsigned size = eq->block_size;
+
+   fft_process_forward_stereo(eq->fft, eq->fftblock,
+         eq->planar_in[0], eq->planar_in[1], size);
+   fft_complex_mul_array(eq->fft, eq->fftblock, eq->fftblock, eq->filter, 2 * size);
+   fft_process_inverse_stereo(eq->fft,
+         eq->planar_conv[0], eq->planar_conv[1], eq->fftblock);
+
+   for (c = 0; c < 2; c++)
+   {
+      float *conv = eq->planar_conv[c];
+
+      for (i = 0; i < size; i++)
+         eq->planar_out[c][i] = conv[i] + eq->planar_save[c][i];
+      memcpy(eq->planar_save[c], conv + size, size * sizeof(float));
+   }
+}
+
+/* Delays by one block, so that every input frame can be
+ * exchanged for an output frame right away. */
+static void eq_process_block(void *data, struct dspfilter_block *block)
+{
+   unsigned c, done = 0;
+   struct eq_data *eq = (struct eq_data*)data;
+
+   while (done < block->frames)
+   {
+      unsigned avail = MIN(block->frames - done,
+            eq->block_size - eq->planar_ptr);
+
+      for (c = 0; c < 2; c++)
+      {
+         float *samples = block->channels[c] + done;
+
+         memcpy(eq->planar_in[c] + eq->planar_ptr, samples,
+               avail * sizeof(float));
+         memcpy(samples, eq->planar_out[c] + eq->planar_ptr,
+               avail * sizeof(float));
+      }
+
+      done           += avail;
+      eq->planar_ptr += avail;
+
+      if (eq->planar_ptr == eq->block_size)
+      {
+         eq_convolve_planar(eq);
+         eq->planar_ptr = 0;
+      }
+   }
+}
+
 static int gains_cmp(const void *a_, const void *b_)
 {
    const struct eq_gain *a = (const struct eq_gain*)a_;
@@ -246,8 +314,8 @@ end:
    free(time_filter);
 }
 
-static void *eq_init(const struct dspfilter_info *info,
-      const struct dspfilter_config *config, void *userdata)
+static void *eq_init_common(const struct dspfilter_info *info,
+      const struct dspfilter_config *config, void *userdata, bool simd)
 {
    float *frequencies, *gain;
    unsigned num_freq, num_gain, i, size;
@@ -297,14 +365,28 @@ static void *eq_init(const struct dspfilter_info *info,
    eq->fftblock = (fft_complex_t*)calloc(2 * size, sizeof(*eq->fftblock));
    eq->filter   = (fft_complex_t*)calloc(2 * size, sizeof(*eq->filter));
 
+   /* One allocation for all planar buffers, 10 blocks in total. */
+   eq->planar_in[0] = (float*)calloc(10 * size, sizeof(float));
+
    /* Use an FFT which is twice the block size with zero-padding
     * to make circular convolution => proper convolution.
     */
    eq->fft = fft_new(size_log2 + 1);
 
-   if (!eq->fft || !eq->fftblock || !eq->save || !eq->block || !eq->filter)
+   if (!eq->fft || !eq->fftblock || !eq->save || !eq->block || !eq->filter
+         || !eq->planar_in[0])
       goto error;
 
+   fft_set_simd(eq->fft, simd);
+
+   eq->planar_in[1]   = eq->planar_in[0]   + size;
+   eq->planar_out[0]  = eq->planar_in[1]   + size;
+   eq->planar_out[1]  = eq->planar_out[0]  + size;
+   eq->planar_save[0] = eq->planar_out[1]  + size;
+   eq->planar_save[1] = eq->planar_save[0] + size;
+   eq->planar_conv[0] = eq->planar_save[1] + size;
+   eq->planar_conv[1] = eq->planar_conv[0] + 2 * size;
+
    create_filter(eq, size_log2, gains, num_gain, beta, filter_path);
    config->free(filter_path);
    filter_path = NULL;
@@ -318,6 +400,12 @@ error:
    return NULL;
 }
 
+static void *eq_init(const struct dspfilter_info *info,
+      const struct dspfilter_config *config, void *userdata)
+{
+   return eq_init_common(info, config, userdata, false);
+}
+
 static const struct dspfilter_implementation eq_plug = {
    eq_init,
    eq_process,
@@ -326,14 +414,38 @@ static const struct dspfilter_implementation eq_plug = {
    DSPFILTER_API_VERSION,
    "Linear-Phase FFT Equalizer",
    "eq",
+   eq_process_block,
 };
 
+#if defined(__SSE__)
+static void *eq_init_sse(const struct dspfilter_info *info,
+      const struct dspfilter_config *config, void *userdata)
+{
+   return eq_init_common(info, config, userdata, true);
+}
+
+static const struct dspfilter_implementation eq_plug_sse = {
+   eq_init_sse,
+   eq_process,
+   eq_free,
+
+   DSPFILTER_API_VERSION,
+   "Linear-Phase FFT Equalizer (SSE)",
+   "eq",
+   eq_process_block,
+};
+#endif
+
 #ifdef HAVE_FILTERS_BUILTIN
 #define dspfilter_get_implementation eq_dspfilter_get_implementation
 #endif
 
 const struct dspfilter_implementation *dspfilter_get_implementation(dspfilter_simd_mask_t mask)
 {
+#if defined(__SSE__)
+   if (mask & DSPFILTER_SIMD_SSE)
+      return &eq_plug_sse;
+#endif
    (void)mask;
    return &eq_plug;
 }
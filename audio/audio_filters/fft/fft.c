@@ -17,14 +17,20 @@
 #include <math.h>
 #include <stdlib.h>
 
+#include <boolean.h>
 #include <retro_miscellaneous.h>
 
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
 struct fft
 {
    fft_complex_t *interleave_buffer;
    fft_complex_t *phase_lut;
    unsigned *bitinverse_buffer;
    unsigned size;
+   bool simd;
 };
 
 static unsigned bitswap(unsigned x, unsigned size_log2)
@@ -114,6 +120,15 @@ error:
    return NULL;
 }
 
+void fft_set_simd(fft_t *fft, bool simd)
+{
+#if defined(__SSE__)
+   fft->simd = simd;
+#else
+   (void)simd;
+#endif
+}
+
 void fft_free(fft_t *fft)
 {
    if (!fft)
@@ -132,7 +147,21 @@ static void butterfly(fft_complex_t *a, fft_complex_t *b, fft_complex_t mod)
    *a = fft_complex_add(*a, mod);
 }
 
-static void butterflies(fft_complex_t *butterfly_buf,
+#if defined(__SSE__)
+/* Multiplies two pairs of complex numbers. */
+static INLINE __m128 fft_complex_mul_sse(__m128 a, __m128 b)
+{
+   const __m128 sign = _mm_set_ps(0.0f, -0.0f, 0.0f, -0.0f);
+   __m128 b_real     = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 0, 0));
+   __m128 b_imag     = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 1, 1));
+   __m128 a_swap     = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1));
+
+   return _mm_add_ps(_mm_mul_ps(a, b_real),
+         _mm_xor_ps(_mm_mul_ps(a_swap, b_imag), sign));
+}
+#endif
+
+static void butterflies(fft_t *fft, fft_complex_t *butterfly_buf,
       const fft_complex_t *phase_lut,
       int phase_dir, unsigned step_size, unsigned samples)
 {
@@ -140,11 +169,52 @@ static void butterflies(fft_complex_t *butterfly_buf,
    for (i = 0; i < samples; i += step_size << 1)
    {
       int phase_step = (int)samples * phase_dir / (int)step_size;
+
+#if defined(__SSE__)
+      /* Two butterflies at a time, twiddles are gathered. */
+      if (fft->simd && step_size >= 2)
+      {
+         for (j = i; j < i + step_size; j += 2)
+         {
+            float *a  = (float*)&butterfly_buf[j];
+            float *b  = (float*)&butterfly_buf[j + step_size];
+            __m128 tw = _mm_loadl_pi(_mm_setzero_ps(),
+                  (const __m64*)&phase_lut[phase_step * (int)(j - i)]);
+            __m128 va = _mm_loadu_ps(a);
+            __m128 mod;
+
+            tw  = _mm_loadh_pi(tw,
+                  (const __m64*)&phase_lut[phase_step * (int)(j + 1 - i)]);
+            mod = fft_complex_mul_sse(tw, _mm_loadu_ps(b));
+
+            _mm_storeu_ps(b, _mm_sub_ps(va, mod));
+            _mm_storeu_ps(a, _mm_add_ps(va, mod));
+         }
+         continue;
+      }
+#endif
+
       for (j = i; j < i + step_size; j++)
          butterfly(&butterfly_buf[j], &butterfly_buf[j + step_size], phase_lut[phase_step * (int)(j - i)]);
    }
 }
 
+void fft_complex_mul_array(fft_t *fft, fft_complex_t *out,
+      const fft_complex_t *a, const fft_complex_t *b, unsigned samples)
+{
+   unsigned i = 0;
+
+#if defined(__SSE__)
+   for (; fft->simd && i + 2 <= samples; i += 2)
+      _mm_storeu_ps((float*)&out[i], fft_complex_mul_sse(
+               _mm_loadu_ps((const float*)&a[i]),
+               _mm_loadu_ps((const float*)&b[i])));
+#endif
+
+   for (; i < samples; i++)
+      out[i] = fft_complex_mul(a[i], b[i]);
+}
+
 void fft_process_forward_complex(fft_t *fft,
       fft_complex_t *out, const fft_complex_t *in, unsigned step)
 {
@@ -154,7 +224,7 @@ void fft_process_forward_complex(fft_t *fft,
 
    for (step_size = 1; step_size < samples; step_size <<= 1)
    {
-      butterflies(out,
+      butterflies(fft, out,
             fft->phase_lut + samples,
             -1, step_size, samples);
    }
@@ -169,7 +239,7 @@ void fft_process_forward(fft_t *fft,
 
    for (step_size = 1; step_size < fft->size; step_size <<= 1)
    {
-      butterflies(out,
+      butterflies(fft, out,
             fft->phase_lut + samples,
             -1, step_size, samples);
    }
@@ -184,7 +254,7 @@ void fft_process_inverse(fft_t *fft,
 
    for (step_size = 1; step_size < samples; step_size <<= 1)
    {
-      butterflies(fft->interleave_buffer,
+      butterflies(fft, fft->interleave_buffer,
             fft->phase_lut + samples,
             1, step_size, samples);
    }
@@ -192,3 +262,52 @@ void fft_process_inverse(fft_t *fft,
    resolve_float(out, fft->interleave_buffer, samples, 1.0f / samples, step);
 }
 
+
+void fft_process_forward_stereo(fft_t *fft, fft_complex_t *out,
+      const float *left, const float *right, unsigned samples)
+{
+   unsigned i, step_size;
+   const unsigned *bitinverse = fft->bitinverse_buffer;
+
+   for (i = 0; i < samples; i++)
+   {
+      out[bitinverse[i]].real = left[i];
+      out[bitinverse[i]].imag = right[i];
+   }
+
+   for (; i < fft->size; i++)
+   {
+      out[bitinverse[i]].real = 0.0f;
+      out[bitinverse[i]].imag = 0.0f;
+   }
+
+   for (step_size = 1; step_size < fft->size; step_size <<= 1)
+   {
+      butterflies(fft, out,
+            fft->phase_lut + fft->size,
+            -1, step_size, fft->size);
+   }
+}
+
+void fft_process_inverse_stereo(fft_t *fft,
+      float *left, float *right, const fft_complex_t *in)
+{
+   unsigned i, step_size;
+   unsigned samples = fft->size;
+   float gain       = 1.0f / samples;
+
+   interleave_complex(fft->bitinverse_buffer, fft->interleave_buffer, in, samples, 1);
+
+   for (step_size = 1; step_size < samples; step_size <<= 1)
+   {
+      butterflies(fft, fft->interleave_buffer,
+            fft->phase_lut + samples,
+            1, step_size, samples);
+   }
+
+   for (i = 0; i < samples; i++)
+   {
+      left[i]  = gain * fft->interleave_buffer[i].real;
+      right[i] = gain * fft->interleave_buffer[i].imag;
+   }
+}
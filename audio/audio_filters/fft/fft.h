@@ -16,6 +16,7 @@
 #ifndef RARCH_FFT_H__
 #define RARCH_FFT_H__
 
+#include <boolean.h>
 #include <retro_inline.h>
 #include <math/complex.h>
 
@@ -25,6 +26,10 @@ fft_t *fft_new(unsigned block_size_log2);
 
 void fft_free(fft_t *fft);
 
+/* Enables the SSE kernels, if they were compiled in.
+ * Off by default. */
+void fft_set_simd(fft_t *fft, bool simd);
+
 void fft_process_forward_complex(fft_t *fft,
       fft_complex_t *out, const fft_complex_t *in, unsigned step);
 
@@ -34,6 +39,20 @@ void fft_process_forward(fft_t *fft,
 void fft_process_inverse(fft_t *fft,
       float *out, const fft_complex_t *in, unsigned step);
 
+/* Transforms left + i * right, zero-padded from @samples
+ * to the size of the FFT. */
+void fft_process_forward_stereo(fft_t *fft, fft_complex_t *out,
+      const float *left, const float *right, unsigned samples);
+
+/* Inverse of fft_process_forward_stereo(), writes the real part
+ * to @left and the imaginary part to @right. */
+void fft_process_inverse_stereo(fft_t *fft,
+      float *left, float *right, const fft_complex_t *in);
+
+/* out[i] = a[i] * b[i], with the kernels selected for @fft. */
+void fft_complex_mul_array(fft_t *fft, fft_complex_t *out,
+      const fft_complex_t *a, const fft_complex_t *b, unsigned samples);
+
 
 #endif
 
@@ -21,6 +21,15 @@
 
 #include <retro_miscellaneous.h>
 
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+#if defined(__ARM_NEON__) || defined(__aarch64__)
+#include <arm_neon.h>
+#define IIR_HAVE_NEON
+#endif
+
 #define sqr(a) ((a) * (a))
 
 /* filter types */
@@ -40,18 +49,29 @@ enum IIRFilter
    RIAA_CD     /* CD de-emphasis */
 };
 
+struct iir_state
+{
+   float xn1, xn2;
+   float yn1, yn2;
+};
+
 struct iir_data
 {
    float b0, b1, b2;
    float a0, a1, a2;
 
-   struct
-   {
-      float xn1, xn2;
-      float yn1, yn2;
-   } l, r;
+   struct iir_state l, r;
+
+   /* Each of the next four outputs as a linear combination of
+    * the next four inputs, xn1, xn2, yn1 and yn2, in that order.
+    * Lets the SIMD paths compute four outputs at once, with
+    * only one dependency on the previous group. */
+   float group[8][4];
 };
 
+typedef void (*iir_channel_t)(const struct iir_data *iir,
+      struct iir_state *state, float *samples, unsigned frames);
+
 static void iir_free(void *data)
 {
    free(data);
@@ -122,6 +142,175 @@ static void iir_process(void *data, struct dspfilter_output *output,
    iir->r.yn2 = yn2_r;
 }
 
+static void iir_process_channel_C(const struct iir_data *iir,
+      struct iir_state *state, float *samples, unsigned frames)
+{
+   unsigned i;
+   float b0  = iir->b0 / iir->a0;
+   float b1  = iir->b1 / iir->a0;
+   float b2  = iir->b2 / iir->a0;
+   float a1  = iir->a1 / iir->a0;
+   float a2  = iir->a2 / iir->a0;
+   float xn1 = state->xn1;
+   float xn2 = state->xn2;
+   float yn1 = state->yn1;
+   float yn2 = state->yn2;
+
+   for (i = 0; i < frames; i++)
+   {
+      float x = samples[i];
+      float y = b0 * x + b1 * xn1 + b2 * xn2 - a1 * yn1 - a2 * yn2;
+
+      xn2 = xn1;
+      xn1 = x;
+      yn2 = yn1;
+      yn1 = y;
+
+      samples[i] = y;
+   }
+
+   state->xn1 = xn1;
+   state->xn2 = xn2;
+   state->yn1 = yn1;
+   state->yn2 = yn2;
+}
+
+#if defined(__SSE__)
+#define IIR_SPLAT(v, i) _mm_shuffle_ps(v, v, _MM_SHUFFLE(i, i, i, i))
+
+static void iir_process_channel_SSE(const struct iir_data *iir,
+      struct iir_state *state, float *samples, unsigned frames)
+{
+   unsigned i;
+   unsigned groups = frames & ~3;
+   __m128 c0       = _mm_loadu_ps(iir->group[0]);
+   __m128 c1       = _mm_loadu_ps(iir->group[1]);
+   __m128 c2       = _mm_loadu_ps(iir->group[2]);
+   __m128 c3       = _mm_loadu_ps(iir->group[3]);
+   __m128 c4       = _mm_loadu_ps(iir->group[4]);
+   __m128 c5       = _mm_loadu_ps(iir->group[5]);
+   __m128 c6       = _mm_loadu_ps(iir->group[6]);
+   __m128 c7       = _mm_loadu_ps(iir->group[7]);
+   __m128 xn1      = _mm_set1_ps(state->xn1);
+   __m128 xn2      = _mm_set1_ps(state->xn2);
+   __m128 yn1      = _mm_set1_ps(state->yn1);
+   __m128 yn2      = _mm_set1_ps(state->yn2);
+
+   /* Samples are aligned, as they come in a dspfilter_block. */
+   for (i = 0; i < groups; i += 4)
+   {
+      __m128 x  = _mm_load_ps(samples + i);
+      __m128 s0 = _mm_add_ps(
+            _mm_mul_ps(c0, IIR_SPLAT(x, 0)),
+            _mm_mul_ps(c1, IIR_SPLAT(x, 1)));
+      __m128 s1 = _mm_add_ps(
+            _mm_mul_ps(c2, IIR_SPLAT(x, 2)),
+            _mm_mul_ps(c3, IIR_SPLAT(x, 3)));
+      __m128 s2 = _mm_add_ps(
+            _mm_mul_ps(c4, xn1),
+            _mm_mul_ps(c5, xn2));
+      __m128 y  = _mm_add_ps(_mm_add_ps(s0, s1), s2);
+
+      y = _mm_add_ps(y, _mm_add_ps(
+               _mm_mul_ps(c6, yn1),
+               _mm_mul_ps(c7, yn2)));
+
+      _mm_store_ps(samples + i, y);
+
+      xn1 = IIR_SPLAT(x, 3);
+      xn2 = IIR_SPLAT(x, 2);
+      yn1 = IIR_SPLAT(y, 3);
+      yn2 = IIR_SPLAT(y, 2);
+   }
+
+   state->xn1 = _mm_cvtss_f32(xn1);
+   state->xn2 = _mm_cvtss_f32(xn2);
+   state->yn1 = _mm_cvtss_f32(yn1);
+   state->yn2 = _mm_cvtss_f32(yn2);
+
+   iir_process_channel_C(iir, state, samples + groups, frames - groups);
+}
+
+#undef IIR_SPLAT
+#endif
+
+#ifdef IIR_HAVE_NEON
+static void iir_process_channel_NEON(const struct iir_data *iir,
+      struct iir_state *state, float *samples, unsigned frames)
+{
+   unsigned i;
+   unsigned groups = frames & ~3;
+   float32x4_t c0  = vld1q_f32(iir->group[0]);
+   float32x4_t c1  = vld1q_f32(iir->group[1]);
+   float32x4_t c2  = vld1q_f32(iir->group[2]);
+   float32x4_t c3  = vld1q_f32(iir->group[3]);
+   float32x4_t c4  = vld1q_f32(iir->group[4]);
+   float32x4_t c5  = vld1q_f32(iir->group[5]);
+   float32x4_t c6  = vld1q_f32(iir->group[6]);
+   float32x4_t c7  = vld1q_f32(iir->group[7]);
+   float xn1       = state->xn1;
+   float xn2       = state->xn2;
+   float yn1       = state->yn1;
+   float yn2       = state->yn2;
+
+   for (i = 0; i < groups; i += 4)
+   {
+      float32x4_t x  = vld1q_f32(samples + i);
+      float32x4_t s0 = vmulq_n_f32(c0, vgetq_lane_f32(x, 0));
+      float32x4_t s1 = vmulq_n_f32(c2, vgetq_lane_f32(x, 2));
+      float32x4_t y;
+
+      s0 = vmlaq_n_f32(s0, c1, vgetq_lane_f32(x, 1));
+      s1 = vmlaq_n_f32(s1, c3, vgetq_lane_f32(x, 3));
+      s0 = vmlaq_n_f32(s0, c4, xn1);
+      s1 = vmlaq_n_f32(s1, c5, xn2);
+      y  = vaddq_f32(s0, s1);
+      y  = vmlaq_n_f32(y, c6, yn1);
+      y  = vmlaq_n_f32(y, c7, yn2);
+
+      vst1q_f32(samples + i, y);
+
+      xn1 = vgetq_lane_f32(x, 3);
+      xn2 = vgetq_lane_f32(x, 2);
+      yn1 = vgetq_lane_f32(y, 3);
+      yn2 = vgetq_lane_f32(y, 2);
+   }
+
+   state->xn1 = xn1;
+   state->xn2 = xn2;
+   state->yn1 = yn1;
+   state->yn2 = yn2;
+
+   iir_process_channel_C(iir, state, samples + groups, frames - groups);
+}
+#endif
+
+static void iir_process_block(struct iir_data *iir,
+      struct dspfilter_block *block, iir_channel_t process_channel)
+{
+   process_channel(iir, &iir->l, block->channels[0], block->frames);
+   process_channel(iir, &iir->r, block->channels[1], block->frames);
+}
+
+static void iir_process_block_C(void *data, struct dspfilter_block *block)
+{
+   iir_process_block((struct iir_data*)data, block, iir_process_channel_C);
+}
+
+#if defined(__SSE__)
+static void iir_process_block_SSE(void *data, struct dspfilter_block *block)
+{
+   iir_process_block((struct iir_data*)data, block, iir_process_channel_SSE);
+}
+#endif
+
+#ifdef IIR_HAVE_NEON
+static void iir_process_block_NEON(void *data, struct dspfilter_block *block)
+{
+   iir_process_block((struct iir_data*)data, block, iir_process_channel_NEON);
+}
+#endif
+
 #define CHECK(x) if (!strcmp(str, #x)) return x
 static enum IIRFilter str_to_type(const char *str)
 {
@@ -154,6 +343,41 @@ static void make_poly_from_roots(
          poly[j] -= poly[j - 1] * roots[i];
 }
 
+static void iir_group_init(struct iir_data *iir)
+{
+   unsigned i, j;
+   double b0 = (double)iir->b0 / iir->a0;
+   double b1 = (double)iir->b1 / iir->a0;
+   double b2 = (double)iir->b2 / iir->a0;
+   double a1 = (double)iir->a1 / iir->a0;
+   double a2 = (double)iir->a2 / iir->a0;
+
+   /* Run the filter four steps for each input alone. */
+   for (i = 0; i < 8; i++)
+   {
+      double x[6] = {0.0}; /* xn2, xn1, then the four inputs. */
+      double y[6] = {0.0}; /* yn2, yn1, then the four outputs. */
+
+      if (i < 4)
+         x[i + 2] = 1.0;
+      else if (i == 4)
+         x[1]     = 1.0;
+      else if (i == 5)
+         x[0]     = 1.0;
+      else if (i == 6)
+         y[1]     = 1.0;
+      else
+         y[0]     = 1.0;
+
+      for (j = 2; j < 6; j++)
+      {
+         y[j] = b0 * x[j] + b1 * x[j - 1] + b2 * x[j - 2]
+            - a1 * y[j - 1] - a2 * y[j - 2];
+         iir->group[i][j - 2] = y[j];
+      }
+   }
+}
+
 static void iir_filter_init(struct iir_data *iir,
       float sample_rate, float freq, float qual, float gain, enum IIRFilter filter_type)
 {
@@ -320,6 +544,8 @@ static void iir_filter_init(struct iir_data *iir,
    iir->a0 = a0;
    iir->a1 = a1;
    iir->a2 = a2;
+
+   iir_group_init(iir);
 }
 
 static void *iir_init(const struct dspfilter_info *info,
@@ -353,14 +579,49 @@ static const struct dspfilter_implementation iir_plug = {
    DSPFILTER_API_VERSION,
    "IIR",
    "iir",
+   iir_process_block_C,
 };
 
+#if defined(__SSE__)
+static const struct dspfilter_implementation iir_plug_sse = {
+   iir_init,
+   iir_process,
+   iir_free,
+
+   DSPFILTER_API_VERSION,
+   "IIR (SSE)",
+   "iir",
+   iir_process_block_SSE,
+};
+#endif
+
+#ifdef IIR_HAVE_NEON
+static const struct dspfilter_implementation iir_plug_neon = {
+   iir_init,
+   iir_process,
+   iir_free,
+
+   DSPFILTER_API_VERSION,
+   "IIR (NEON)",
+   "iir",
+   iir_process_block_NEON,
+};
+#endif
+
 #ifdef HAVE_FILTERS_BUILTIN
 #define dspfilter_get_implementation iir_dspfilter_get_implementation
 #endif
 
 const struct dspfilter_implementation *dspfilter_get_implementation(dspfilter_simd_mask_t mask)
 {
+#if defined(__SSE__)
+   if (mask & DSPFILTER_SIMD_SSE)
+      return &iir_plug_sse;
+#endif
+#ifdef IIR_HAVE_NEON
+   if (mask & DSPFILTER_SIMD_NEON)
+      return &iir_plug_neon;
+#endif
    (void)mask;
    return &iir_plug;
 }
@@ -19,6 +19,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <retro_inline.h>
+#include <retro_miscellaneous.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 struct comb
 {
@@ -140,6 +145,110 @@ static float revmodel_process(struct revmodel *rev, float in)
    return mono_in * rev->dry + mono_out * rev->wet1;
 }
 
+/* Block versions of comb_process() and allpass_process(), for a
+ * span that doesn't wrap around the delay line. As the delay is
+ * longer than the span, every sample read was written before it. */
+typedef void (*comb_span_t)(struct comb *c, float *buf,
+      const float *in, float *out, unsigned frames);
+typedef void (*allpass_span_t)(struct allpass *a, float *buf,
+      float *samples, unsigned frames);
+
+/* Adds the comb output to @out. */
+static void comb_span_C(struct comb *c, float *buf,
+      const float *in, float *out, unsigned frames)
+{
+   unsigned i;
+   float filterstore = c->filterstore;
+
+   for (i = 0; i < frames; i++)
+   {
+      float output = buf[i];
+      filterstore  = (output * c->damp2) + (filterstore * c->damp1);
+      buf[i]       = in[i] + (filterstore * c->feedback);
+      out[i]      += output;
+   }
+
+   c->filterstore = filterstore;
+}
+
+static void allpass_span_C(struct allpass *a, float *buf,
+      float *samples, unsigned frames)
+{
+   unsigned i;
+
+   for (i = 0; i < frames; i++)
+   {
+      float input  = samples[i];
+      float bufout = buf[i];
+      samples[i]   = -input + bufout;
+      buf[i]       = input + bufout * a->feedback;
+   }
+}
+
+#if defined(__SSE2__)
+#define REVERB_SHIFT(v, n) \
+   _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), (n) * 4))
+
+/* The damping lowpass is a running sum, so four steps of it
+ * are computed as a prefix sum, plus the previous state. */
+static void comb_span_SSE2(struct comb *c, float *buf,
+      const float *in, float *out, unsigned frames)
+{
+   unsigned i;
+   unsigned groups   = frames & ~3;
+   float d1          = c->damp1;
+   __m128 damp1      = _mm_set1_ps(d1);
+   __m128 damp1_2    = _mm_set1_ps(d1 * d1);
+   __m128 damp2      = _mm_set1_ps(c->damp2);
+   __m128 feedback   = _mm_set1_ps(c->feedback);
+   __m128 carry      = _mm_set_ps(d1 * d1 * d1 * d1, d1 * d1 * d1,
+         d1 * d1, d1);
+   __m128 store      = _mm_set1_ps(c->filterstore);
+
+   for (i = 0; i < groups; i += 4)
+   {
+      __m128 output = _mm_loadu_ps(buf + i);
+      __m128 fs     = _mm_mul_ps(output, damp2);
+
+      fs    = _mm_add_ps(fs, _mm_mul_ps(damp1,   REVERB_SHIFT(fs, 1)));
+      fs    = _mm_add_ps(fs, _mm_mul_ps(damp1_2, REVERB_SHIFT(fs, 2)));
+      fs    = _mm_add_ps(fs, _mm_mul_ps(carry, store));
+      store = _mm_shuffle_ps(fs, fs, _MM_SHUFFLE(3, 3, 3, 3));
+
+      _mm_storeu_ps(buf + i, _mm_add_ps(_mm_loadu_ps(in + i),
+               _mm_mul_ps(fs, feedback)));
+      _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), output));
+   }
+
+   c->filterstore = _mm_cvtss_f32(store);
+
+   comb_span_C(c, buf + groups, in + groups, out + groups,
+         frames - groups);
+}
+
+static void allpass_span_SSE2(struct allpass *a, float *buf,
+      float *samples, unsigned frames)
+{
+   unsigned i;
+   unsigned groups = frames & ~3;
+   __m128 feedback = _mm_set1_ps(a->feedback);
+
+   for (i = 0; i < groups; i += 4)
+   {
+      __m128 input  = _mm_loadu_ps(samples + i);
+      __m128 bufout = _mm_loadu_ps(buf + i);
+
+      _mm_storeu_ps(samples + i, _mm_sub_ps(bufout, input));
+      _mm_storeu_ps(buf + i, _mm_add_ps(input,
+               _mm_mul_ps(bufout, feedback)));
+   }
+
+   allpass_span_C(a, buf + groups, samples + groups, frames - groups);
+}
+
+#undef REVERB_SHIFT
+#endif
+
 static void revmodel_update(struct revmodel *rev)
 {
    int i;
@@ -231,6 +340,63 @@ static void revmodel_init(struct revmodel *rev)
    revmodel_setmode(rev, initialmode);
 }
 
+/* Processes @frames samples in place, at most
+ * DSPFILTER_BLOCK_MAX_FRAMES. */
+static void revmodel_process_block(struct revmodel *rev,
+      float *samples, unsigned frames,
+      comb_span_t comb_span, allpass_span_t allpass_span)
+{
+   unsigned i;
+   float input[DSPFILTER_BLOCK_MAX_FRAMES];
+   float mono_out[DSPFILTER_BLOCK_MAX_FRAMES];
+
+   for (i = 0; i < frames; i++)
+   {
+      input[i]    = samples[i] * rev->gain;
+      mono_out[i] = 0.0f;
+   }
+
+   for (i = 0; i < numcombs; i++)
+   {
+      struct comb *c = &rev->combL[i];
+      unsigned done  = 0;
+
+      while (done < frames)
+      {
+         unsigned span = MIN(frames - done, c->bufsize - c->bufidx);
+
+         comb_span(c, c->buffer + c->bufidx,
+               input + done, mono_out + done, span);
+
+         done      += span;
+         c->bufidx += span;
+         if (c->bufidx >= c->bufsize)
+            c->bufidx = 0;
+      }
+   }
+
+   for (i = 0; i < numallpasses; i++)
+   {
+      struct allpass *a = &rev->allpassL[i];
+      unsigned done     = 0;
+
+      while (done < frames)
+      {
+         unsigned span = MIN(frames - done, a->bufsize - a->bufidx);
+
+         allpass_span(a, a->buffer + a->bufidx, mono_out + done, span);
+
+         done      += span;
+         a->bufidx += span;
+         if (a->bufidx >= a->bufsize)
+            a->bufidx = 0;
+      }
+   }
+
+   for (i = 0; i < frames; i++)
+      samples[i] = samples[i] * rev->dry + mono_out[i] * rev->wet1;
+}
+
 struct reverb_data
 {
    struct revmodel left, right;
@@ -261,6 +427,30 @@ static void reverb_process(void *data, struct dspfilter_output *output,
    }
 }
 
+static void reverb_process_block_C(void *data,
+      struct dspfilter_block *block)
+{
+   struct reverb_data *rev = (struct reverb_data*)data;
+
+   revmodel_process_block(&rev->left, block->channels[0], block->frames,
+         comb_span_C, allpass_span_C);
+   revmodel_process_block(&rev->right, block->channels[1], block->frames,
+         comb_span_C, allpass_span_C);
+}
+
+#if defined(__SSE2__)
+static void reverb_process_block_SSE2(void *data,
+      struct dspfilter_block *block)
+{
+   struct reverb_data *rev = (struct reverb_data*)data;
+
+   revmodel_process_block(&rev->left, block->channels[0], block->frames,
+         comb_span_SSE2, allpass_span_SSE2);
+   revmodel_process_block(&rev->right, block->channels[1], block->frames,
+         comb_span_SSE2, allpass_span_SSE2);
+}
+#endif
+
 static void *reverb_init(const struct dspfilter_info *info,
       const struct dspfilter_config *config, void *userdata)
 {
@@ -302,14 +492,32 @@ static const struct dspfilter_implementation reverb_plug = {
    DSPFILTER_API_VERSION,
    "Reverb",
    "reverb",
+   reverb_process_block_C,
 };
 
+#if defined(__SSE2__)
+static const struct dspfilter_implementation reverb_plug_sse2 = {
+   reverb_init,
+   reverb_process,
+   reverb_free,
+
+   DSPFILTER_API_VERSION,
+   "Reverb (SSE2)",
+   "reverb",
+   reverb_process_block_SSE2,
+};
+#endif
+
 #ifdef HAVE_FILTERS_BUILTIN
 #define dspfilter_get_implementation reverb_dspfilter_get_implementation
 #endif
 
 const struct dspfilter_implementation *dspfilter_get_implementation(dspfilter_simd_mask_t mask)
 {
+#if defined(__SSE2__)
+   if (mask & DSPFILTER_SIMD_SSE2)
+      return &reverb_plug_sse2;
+#endif
    (void)mask;
    return &reverb_plug;
 }
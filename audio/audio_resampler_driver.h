@@ -41,6 +41,7 @@ RETRO_BEGIN_DECLS
 #define RESAMPLER_SIMD_AVX2     (1 << 12)
 #define RESAMPLER_SIMD_VFPU     (1 << 13)
 #define RESAMPLER_SIMD_PS       (1 << 14)
+#define RESAMPLER_SIMD_FMA3     (1 << 22)
 
 /* A bit-mask of all supported SIMD instruction sets.
  * Allows an implementation to pick different 
@@ -48,7 +49,20 @@ RETRO_BEGIN_DECLS
  */
 typedef unsigned resampler_simd_mask_t;
 
-#define RESAMPLER_API_VERSION 1
+/* Trade-off between quality and CPU time.
+ * DONTCARE lets the resampler pick its build default. */
+enum resampler_quality
+{
+   RESAMPLER_QUALITY_DONTCARE = 0,
+   RESAMPLER_QUALITY_LOWEST,
+   RESAMPLER_QUALITY_LOWER,
+   RESAMPLER_QUALITY_NORMAL,
+   RESAMPLER_QUALITY_HIGHER,
+   RESAMPLER_QUALITY_HIGHEST
+};
+
+/* 2: resampler_init_t takes a quality tier. */
+#define RESAMPLER_API_VERSION 2
 
 struct resampler_data
 {
@@ -103,7 +117,8 @@ struct resampler_config
 /* Bandwidth factor. Will be < 1.0 for downsampling, > 1.0 for upsampling. 
  * Corresponds to expected resampling ratio. */
 typedef void *(*resampler_init_t)(const struct resampler_config *config,
-      double bandwidth_mod, resampler_simd_mask_t mask);
+      double bandwidth_mod, enum resampler_quality quality,
+      resampler_simd_mask_t mask);
 
 /* Frees the handle. */
 typedef void (*resampler_free_t)(void *data);
@@ -136,9 +151,21 @@ typedef struct audio_frame_float
 
 extern rarch_resampler_t sinc_resampler;
 extern rarch_resampler_t CC_resampler;
+extern rarch_resampler_t polyphase_resampler;
 extern rarch_resampler_t nearest_resampler;
 extern rarch_resampler_t null_resampler;
 
+/**
+ * resampler_sinc_set_time:
+ * @re                 : handle of sinc_resampler.
+ * @time               : position of the next output sample, in input
+ *                       samples after the newest one pushed.
+ *
+ * Lets the polyphase resampler hand over to sinc at the phase
+ * it stopped at.
+ **/
+void resampler_sinc_set_time(void *re, double time);
+
 /**
  * config_get_audio_resampler_driver_options:
  *
@@ -172,6 +199,7 @@ const char *audio_resampler_driver_find_ident(int index);
  * @backend                    : Resampler backend that is about to be set.
  * @ident                      : Identifier name for resampler we want.
  * @bw_ratio                   : Bandwidth ratio.
+ * @quality                    : Quality tier, see enum resampler_quality.
  *
  * Reallocates resampler. Will free previous handle before 
  * allocating a new one. If ident is NULL, first resampler will be used.
@@ -179,7 +207,7 @@ const char *audio_resampler_driver_find_ident(int index);
  * Returns: true (1) if successful, otherwise false (0).
  **/
 bool rarch_resampler_realloc(void **re, const rarch_resampler_t **backend,
-      const char *ident, double bw_ratio);
+      const char *ident, double bw_ratio, enum resampler_quality quality);
 
 /* Convenience macros.
  * freep makes sure to set handles to NULL to avoid double-free 
@@ -0,0 +1,243 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2016 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include <queues/spsc_fifo.h>
+#include <retro_atomic.h>
+#include <retro_miscellaneous.h>
+
+#include "audio_telemetry.h"
+
+#include "../configuration.h"
+
+/* About a minute of flushes at 60 per second. */
+#define AUDIO_TELEMETRY_RING_SAMPLES 4096
+
+static spsc_fifo_t *audio_telemetry_ring;
+static retro_atomic_int_t audio_telemetry_dropped;
+static struct audio_telemetry_stats
+   audio_telemetry_stats[AUDIO_TELEMETRY_WINDOW_LAST];
+
+static void audio_telemetry_reset(void)
+{
+   memset(audio_telemetry_stats, 0, sizeof(audio_telemetry_stats));
+}
+
+bool audio_telemetry_init(void)
+{
+   if (audio_telemetry_ring)
+      return true;
+
+   audio_telemetry_ring = spsc_fifo_new(AUDIO_TELEMETRY_RING_SAMPLES
+         * sizeof(struct audio_telemetry_sample));
+   retro_atomic_store(&audio_telemetry_dropped, 0);
+   audio_telemetry_reset();
+
+   return audio_telemetry_ring != NULL;
+}
+
+void audio_telemetry_deinit(void)
+{
+   spsc_fifo_free(audio_telemetry_ring);
+   audio_telemetry_ring = NULL;
+}
+
+void audio_telemetry_push(const struct audio_telemetry_sample *sample)
+{
+   if (!audio_telemetry_ring)
+      return;
+
+   if (spsc_fifo_write_avail(audio_telemetry_ring) < sizeof(*sample))
+   {
+      retro_atomic_fetch_add(&audio_telemetry_dropped, 1);
+      return;
+   }
+
+   spsc_fifo_write(audio_telemetry_ring, sample, sizeof(*sample));
+}
+
+static unsigned audio_telemetry_bin(double value, unsigned bins)
+{
+   if (value <= 0.0)
+      return 0;
+   if (value >= 1.0)
+      return bins - 1;
+   return (unsigned)(value * bins);
+}
+
+static void audio_telemetry_add(struct audio_telemetry_stats *stats,
+      const struct audio_telemetry_sample *sample, float delta)
+{
+   unsigned bin;
+
+   if (stats->flushes == 0 || sample->ratio_drift < stats->drift_min)
+      stats->drift_min = sample->ratio_drift;
+   if (stats->flushes == 0 || sample->ratio_drift > stats->drift_max)
+      stats->drift_max = sample->ratio_drift;
+
+   stats->flushes++;
+   stats->drift_sum += sample->ratio_drift;
+
+   if (delta > 0.0f)
+      stats->drift_hist[audio_telemetry_bin(
+            (sample->ratio_drift / delta + 1.0) / 2.0,
+            AUDIO_TELEMETRY_DRIFT_BINS)]++;
+
+   for (bin = 0; bin < AUDIO_TELEMETRY_LATENCY_BINS - 1; bin++)
+      if (sample->write_usec < (1u << (bin + 6)))
+         break;
+   stats->latency_hist[bin]++;
+   stats->latency_sum += sample->write_usec;
+   if (sample->write_usec > stats->latency_max)
+      stats->latency_max = sample->write_usec;
+
+   if (sample->free_bytes != AUDIO_TELEMETRY_UNKNOWN
+         && sample->buffer_bytes && sample->byte_rate)
+   {
+      uint32_t queued = 0;
+      uint32_t queued_usec;
+
+      if (sample->free_bytes >= sample->buffer_bytes)
+         stats->underruns++;
+      if (sample->free_bytes < sample->write_bytes)
+         stats->overruns++;
+
+      stats->free_hist[audio_telemetry_bin(
+            (double)sample->free_bytes / sample->buffer_bytes,
+            AUDIO_TELEMETRY_FREE_BINS)]++;
+      stats->free_samples++;
+
+      /* Whatever didn't fit was blocked on or dropped. */
+      if (sample->free_bytes < sample->buffer_bytes)
+         queued = sample->buffer_bytes - sample->free_bytes;
+      queued = MIN(queued + sample->write_bytes, sample->buffer_bytes);
+
+      queued_usec = (uint32_t)((uint64_t)queued * 1000000 / sample->byte_rate);
+      stats->queued_usec_sum += queued_usec;
+      if (queued_usec > stats->queued_usec_max)
+         stats->queued_usec_max = queued_usec;
+   }
+}
+
+void audio_telemetry_poll(enum audio_telemetry_window window,
+      struct audio_telemetry_stats *stats, bool reset)
+{
+   unsigned i, dropped;
+   settings_t *settings = config_get_ptr();
+   float delta          = settings ? settings->audio.rate_control_delta : 0.0f;
+
+   if (audio_telemetry_ring)
+   {
+      struct audio_telemetry_sample sample;
+
+      while (spsc_fifo_read_avail(audio_telemetry_ring) >= sizeof(sample))
+      {
+         spsc_fifo_read(audio_telemetry_ring, &sample, sizeof(sample));
+         for (i = 0; i < AUDIO_TELEMETRY_WINDOW_LAST; i++)
+            audio_telemetry_add(&audio_telemetry_stats[i], &sample, delta);
+      }
+   }
+
+   dropped = retro_atomic_exchange(&audio_telemetry_dropped, 0);
+   for (i = 0; i < AUDIO_TELEMETRY_WINDOW_LAST; i++)
+      audio_telemetry_stats[i].dropped += dropped;
+
+   if (stats)
+      *stats = audio_telemetry_stats[window];
+
+   if (reset)
+      memset(&audio_telemetry_stats[window], 0,
+            sizeof(audio_telemetry_stats[window]));
+}
+
+static size_t audio_telemetry_format_hist(char *s, size_t len,
+      const unsigned *hist, unsigned bins)
+{
+   unsigned i;
+   size_t pos = 0;
+
+   for (i = 0; i < bins && pos < len; i++)
+      pos += snprintf(s + pos, len - pos, " %u", hist[i]);
+
+   return pos;
+}
+
+unsigned audio_telemetry_format(const struct audio_telemetry_stats *stats,
+      int line, char *s, size_t len)
+{
+   unsigned i;
+   size_t pos         = 0;
+   unsigned flushes   = stats->flushes ? stats->flushes : 1;
+   unsigned samples   = stats->free_samples ? stats->free_samples : 1;
+
+   if (len)
+      *s = '\0';
+
+   for (i = 0; i < AUDIO_TELEMETRY_LINES && pos < len; i++)
+   {
+      if (line >= 0 && (unsigned)line != i)
+         continue;
+
+      if (pos && pos < len)
+         s[pos++] = '\n';
+      if (pos >= len)
+         break;
+
+      switch (i)
+      {
+         case 0:
+            pos += snprintf(s + pos, len - pos,
+                  "audio_flushes %u dropped %u underruns %u overruns %u",
+                  stats->flushes, stats->dropped,
+                  stats->underruns, stats->overruns);
+            break;
+         case 1:
+            pos += snprintf(s + pos, len - pos, "audio_free_tenths");
+            if (pos < len)
+               pos += audio_telemetry_format_hist(s + pos, len - pos,
+                     stats->free_hist, AUDIO_TELEMETRY_FREE_BINS);
+            break;
+         case 2:
+            pos += snprintf(s + pos, len - pos,
+                  "audio_drift_ppm avg %.0f min %.0f max %.0f hist",
+                  stats->drift_sum * 1e6 / flushes,
+                  stats->drift_min * 1e6, stats->drift_max * 1e6);
+            if (pos < len)
+               pos += audio_telemetry_format_hist(s + pos, len - pos,
+                     stats->drift_hist, AUDIO_TELEMETRY_DRIFT_BINS);
+            break;
+         case 3:
+            pos += snprintf(s + pos, len - pos,
+                  "audio_write_usec avg %llu max %u hist",
+                  (unsigned long long)(stats->latency_sum / flushes),
+                  (unsigned)stats->latency_max);
+            if (pos < len)
+               pos += audio_telemetry_format_hist(s + pos, len - pos,
+                     stats->latency_hist, AUDIO_TELEMETRY_LATENCY_BINS);
+            break;
+         case 4:
+            pos += snprintf(s + pos, len - pos,
+                  "audio_queued_usec avg %.0f max %u",
+                  stats->queued_usec_sum / samples,
+                  (unsigned)stats->queued_usec_max);
+            break;
+      }
+   }
+
+   return AUDIO_TELEMETRY_LINES;
+}
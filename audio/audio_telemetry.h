@@ -0,0 +1,135 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2016 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __AUDIO_TELEMETRY_H__
+#define __AUDIO_TELEMETRY_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+RETRO_BEGIN_DECLS
+
+#define AUDIO_TELEMETRY_FREE_BINS    10
+#define AUDIO_TELEMETRY_DRIFT_BINS   8
+#define AUDIO_TELEMETRY_LATENCY_BINS 12
+
+/* Lines written by audio_telemetry_format(). */
+#define AUDIO_TELEMETRY_LINES        5
+
+/* Not known, as the driver can't report its buffer state. */
+#define AUDIO_TELEMETRY_UNKNOWN      0xffffffffu
+
+/* Each reader of the statistics gets its own interval,
+ * so resetting one doesn't cut short the other. */
+enum audio_telemetry_window
+{
+   AUDIO_TELEMETRY_WINDOW_MENU = 0,
+   AUDIO_TELEMETRY_WINDOW_COMMAND,
+   AUDIO_TELEMETRY_WINDOW_LAST
+};
+
+/* One audio_driver_flush(). */
+struct audio_telemetry_sample
+{
+   /* Free space in the driver buffer before the write, in bytes. */
+   uint32_t free_bytes;
+   uint32_t buffer_bytes;
+   /* Bytes written. */
+   uint32_t write_bytes;
+   /* From the start of the flush until the driver write returned. */
+   uint32_t write_usec;
+   /* Relative deviation of the resampling ratio from the nominal
+    * one, as set by audio rate control. */
+   float ratio_drift;
+   /* Output bytes per second. */
+   uint32_t byte_rate;
+};
+
+struct audio_telemetry_stats
+{
+   unsigned flushes;
+   /* Samples lost because the ring was full. */
+   unsigned dropped;
+   /* Flushes that found the driver buffer empty. */
+   unsigned underruns;
+   /* Flushes that found less space than they were about to write. */
+   unsigned overruns;
+
+   /* Free buffer space, in tenths of the buffer. */
+   unsigned free_hist[AUDIO_TELEMETRY_FREE_BINS];
+   unsigned free_samples;
+
+   /* Ratio drift, from -audio_rate_control_delta
+    * to +audio_rate_control_delta. */
+   unsigned drift_hist[AUDIO_TELEMETRY_DRIFT_BINS];
+   float drift_min, drift_max;
+   double drift_sum;
+
+   /* Write latency, bin i covers up to 2^(i + 6) microseconds. */
+   unsigned latency_hist[AUDIO_TELEMETRY_LATENCY_BINS];
+   uint32_t latency_max;
+   uint64_t latency_sum;
+
+   /* Audio queued in the driver after the write. */
+   double queued_usec_sum;
+   uint32_t queued_usec_max;
+};
+
+bool audio_telemetry_init(void);
+
+void audio_telemetry_deinit(void);
+
+/**
+ * audio_telemetry_push:
+ * @sample               : measurements of one flush.
+ *
+ * Called from the audio thread. Only copies @sample into a
+ * lock-free ring, or counts it as dropped if the ring is full.
+ **/
+void audio_telemetry_push(const struct audio_telemetry_sample *sample);
+
+/**
+ * audio_telemetry_poll:
+ * @window               : whose interval to report.
+ * @stats                : filled in with the accumulated statistics.
+ * @reset                : start a new interval of @window afterwards.
+ *
+ * Drains the ring and returns the statistics of all flushes since
+ * the last reset of @window. Must not be called from two threads
+ * at once.
+ **/
+void audio_telemetry_poll(enum audio_telemetry_window window,
+      struct audio_telemetry_stats *stats, bool reset);
+
+/**
+ * audio_telemetry_format:
+ * @stats                : statistics to describe.
+ * @line                 : which line, or -1 for all of them.
+ * @s                    : output buffer.
+ * @len                  : size of @s.
+ *
+ * Formats @stats as lines of "<name> <values>".
+ *
+ * Returns: number of lines in total.
+ **/
+unsigned audio_telemetry_format(const struct audio_telemetry_stats *stats,
+      int line, char *s, size_t len);
+
+RETRO_END_DECLS
+
+#endif
@@ -33,7 +33,8 @@ static void resampler_null_free(void *re_)
 }
  
 static void *resampler_null_init(const struct resampler_config *config,
-      double bandwidth_mod, resampler_simd_mask_t mask)
+      double bandwidth_mod, enum resampler_quality quality,
+      resampler_simd_mask_t mask)
 {
    return (void*)0;
 }
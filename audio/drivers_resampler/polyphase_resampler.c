@@ -0,0 +1,603 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2016 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Polyphase FIR resampler for fixed rational ratios.
+ *
+ * Many cores output a fixed rate, so the nominal ratio the resampler
+ * is created with can often be written as a fraction L / M with a
+ * small L. Output samples then only ever fall on L distinct phases
+ * between two input samples. Each phase gets its own exact row of
+ * windowed sinc coefficients, and every output sample is a plain dot
+ * product, without the phase interpolation the sinc resampler needs
+ * for arbitrary ratios.
+ *
+ * The audio driver creates resamplers with the core's nominal ratio,
+ * before the timing skew correction, so the fraction only depends on
+ * the core rate and the output rate. As soon as process() is called
+ * with a different ratio, be it due to audio rate control, the skew
+ * correction or slow motion, the resampler hands over to a sinc
+ * resampler with the same filter length at the same phase, and stays
+ * with it. Switching back and forth would be a phase jump each time. */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+
+#include <retro_inline.h>
+#include <filters.h>
+#include <memalign.h>
+#include <features/features_target.h>
+
+#include "../audio_resampler_driver.h"
+
+#if defined(__SSE__)
+#define HAVE_POLYPHASE_SSE
+#include <xmmintrin.h>
+#endif
+
+/* As in sinc_resampler.c, the AVX kernels are built regardless
+ * of -m flags and picked at runtime. */
+#if defined(HAVE_POLYPHASE_SSE) && defined(RETRO_HAVE_TARGET_X86)
+#define HAVE_POLYPHASE_AVX
+#include <immintrin.h>
+#endif
+
+#if (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(VITA)
+#define HAVE_POLYPHASE_NEON
+#include <arm_neon.h>
+#endif
+
+/* Upper bound for L, and for the size of the coefficient table. */
+#define POLYPHASE_MAX_PHASES        1024
+#define POLYPHASE_MAX_TABLE_ELEMS   (1 << 18)
+
+/* How close L / M has to be to the ratio at creation. The output
+ * then drifts by at most one sample in a million, which the driver
+ * buffer absorbs. */
+#define POLYPHASE_DETECT_TOLERANCE  1e-6
+
+/* How far the ratio passed to process() may deviate from L / M
+ * before handing over to sinc. Only leaves room for rounding, so
+ * rate control always hands over. */
+#define POLYPHASE_RATIO_TOLERANCE   (2 * POLYPHASE_DETECT_TOLERANCE)
+
+/* As in sinc_resampler.c, SSE is faster than AVX for the short
+ * filters of the lower tiers. */
+#define POLYPHASE_AVX_MIN_TAPS      32
+
+#define POLYPHASE_ALIGN_TAPS(taps) (((taps) + 7) & ~7)
+
+struct polyphase_tier
+{
+   unsigned sidelobes;
+   double kaiser_beta;
+   double cutoff;
+};
+
+/* Indexed by enum resampler_quality - 1. Same filter lengths as the
+ * sinc tiers, so switching to the fallback keeps the same delay. */
+static const struct polyphase_tier polyphase_tiers[] = {
+   {   2,  4.0, 0.80  },
+   {   4,  5.0, 0.80  },
+   {   8,  5.5, 0.825 },
+   {  32, 10.5, 0.90  },
+   { 128, 14.5, 0.962 },
+};
+
+typedef struct rarch_polyphase_resampler
+{
+   void (*process)(struct rarch_polyphase_resampler *re,
+         struct resampler_data *data);
+
+   /* phases rows of taps coefficients. */
+   float *phase_table;
+   float *buffer_l;
+   float *buffer_r;
+
+   unsigned taps;
+   unsigned ptr;
+
+   /* Output time in units of 1 / L input samples,
+    * advances by M per output sample. */
+   uint32_t time;
+   /* L, or 0 if no fraction was found. */
+   uint32_t phases;
+   /* M */
+   uint32_t step;
+   double ratio;
+
+   const rarch_resampler_t *fallback;
+   void *fallback_data;
+   bool fallback_active;
+
+   float *main_buffer;
+} rarch_polyphase_resampler_t;
+
+typedef void (*polyphase_fir_t)(rarch_polyphase_resampler_t *re,
+      struct resampler_data *data);
+
+/* Dot products of one row of coefficients with the window.
+ * @taps is a multiple of 8. */
+static INLINE void polyphase_dot_C(const float *buffer_l,
+      const float *buffer_r, const float *coeffs, unsigned taps,
+      float *out_buffer)
+{
+   unsigned i;
+   float sum_l = 0.0f;
+   float sum_r = 0.0f;
+
+   for (i = 0; i < taps; i++)
+   {
+      sum_l += buffer_l[i] * coeffs[i];
+      sum_r += buffer_r[i] * coeffs[i];
+   }
+
+   out_buffer[0] = sum_l;
+   out_buffer[1] = sum_r;
+}
+
+#ifdef HAVE_POLYPHASE_SSE
+static INLINE void polyphase_dot_sse(const float *buffer_l,
+      const float *buffer_r, const float *coeffs, unsigned taps,
+      float *out_buffer)
+{
+   unsigned i;
+   __m128 sum;
+   __m128 sum_l  = _mm_setzero_ps();
+   __m128 sum_r  = _mm_setzero_ps();
+   __m128 sum_l2 = _mm_setzero_ps();
+   __m128 sum_r2 = _mm_setzero_ps();
+
+   for (i = 0; i < taps; i += 8)
+   {
+      __m128 c  = _mm_load_ps(coeffs + i);
+      __m128 c2 = _mm_load_ps(coeffs + i + 4);
+      sum_l     = _mm_add_ps(sum_l,
+            _mm_mul_ps(_mm_loadu_ps(buffer_l + i), c));
+      sum_r     = _mm_add_ps(sum_r,
+            _mm_mul_ps(_mm_loadu_ps(buffer_r + i), c));
+      sum_l2    = _mm_add_ps(sum_l2,
+            _mm_mul_ps(_mm_loadu_ps(buffer_l + i + 4), c2));
+      sum_r2    = _mm_add_ps(sum_r2,
+            _mm_mul_ps(_mm_loadu_ps(buffer_r + i + 4), c2));
+   }
+   sum_l = _mm_add_ps(sum_l, sum_l2);
+   sum_r = _mm_add_ps(sum_r, sum_r2);
+
+   /* Same horizontal add as the sinc kernels:
+    * { R1, R0, L1, L0 } + { R3, R2, L3, L2 }, then fold once more. */
+   sum = _mm_add_ps(_mm_shuffle_ps(sum_l, sum_r, _MM_SHUFFLE(1, 0, 1, 0)),
+         _mm_shuffle_ps(sum_l, sum_r, _MM_SHUFFLE(3, 2, 3, 2)));
+   sum = _mm_add_ps(_mm_shuffle_ps(sum, sum, _MM_SHUFFLE(3, 3, 1, 1)), sum);
+
+   _mm_store_ss(out_buffer + 0, sum);
+   _mm_store_ss(out_buffer + 1, _mm_movehl_ps(sum, sum));
+}
+#endif
+
+#ifdef HAVE_POLYPHASE_AVX
+#define POLYPHASE_MADD_AVX(a, b, c) _mm256_add_ps(_mm256_mul_ps((a), (b)), (c))
+#define POLYPHASE_MADD_FMA(a, b, c) _mm256_fmadd_ps((a), (b), (c))
+
+#define POLYPHASE_DOT_AVX(name, target, MADD) \
+static INLINE RETRO_TARGET(target) void name(const float *buffer_l, \
+      const float *buffer_r, const float *coeffs, unsigned taps, \
+      float *out_buffer) \
+{ \
+   unsigned i; \
+   __m128 l, r, sum; \
+   __m256 sum_l  = _mm256_setzero_ps(); \
+   __m256 sum_r  = _mm256_setzero_ps(); \
+   __m256 sum_l2 = _mm256_setzero_ps(); \
+   __m256 sum_r2 = _mm256_setzero_ps(); \
+ \
+   for (i = 0; i + 16 <= taps; i += 16) \
+   { \
+      __m256 c  = _mm256_load_ps(coeffs + i); \
+      __m256 c2 = _mm256_load_ps(coeffs + i + 8); \
+      sum_l     = MADD(_mm256_loadu_ps(buffer_l + i), c, sum_l); \
+      sum_r     = MADD(_mm256_loadu_ps(buffer_r + i), c, sum_r); \
+      sum_l2    = MADD(_mm256_loadu_ps(buffer_l + i + 8), c2, sum_l2); \
+      sum_r2    = MADD(_mm256_loadu_ps(buffer_r + i + 8), c2, sum_r2); \
+   } \
+   if (i < taps) \
+   { \
+      __m256 c  = _mm256_load_ps(coeffs + i); \
+      sum_l     = MADD(_mm256_loadu_ps(buffer_l + i), c, sum_l); \
+      sum_r     = MADD(_mm256_loadu_ps(buffer_r + i), c, sum_r); \
+   } \
+   sum_l = _mm256_add_ps(sum_l, sum_l2); \
+   sum_r = _mm256_add_ps(sum_r, sum_r2); \
+ \
+   /* Fold the high lanes in, then the same as the SSE kernel. */ \
+   l   = _mm_add_ps(_mm256_castps256_ps128(sum_l), \
+         _mm256_extractf128_ps(sum_l, 1)); \
+   r   = _mm_add_ps(_mm256_castps256_ps128(sum_r), \
+         _mm256_extractf128_ps(sum_r, 1)); \
+   sum = _mm_add_ps(_mm_shuffle_ps(l, r, _MM_SHUFFLE(1, 0, 1, 0)), \
+         _mm_shuffle_ps(l, r, _MM_SHUFFLE(3, 2, 3, 2))); \
+   sum = _mm_add_ps(_mm_shuffle_ps(sum, sum, _MM_SHUFFLE(3, 3, 1, 1)), sum); \
+ \
+   _mm_store_ss(out_buffer + 0, sum); \
+   _mm_store_ss(out_buffer + 1, _mm_movehl_ps(sum, sum)); \
+}
+
+POLYPHASE_DOT_AVX(polyphase_dot_avx, "avx", POLYPHASE_MADD_AVX)
+POLYPHASE_DOT_AVX(polyphase_dot_fma, "avx,fma", POLYPHASE_MADD_FMA)
+#endif
+
+#ifdef HAVE_POLYPHASE_NEON
+static INLINE void polyphase_dot_neon(const float *buffer_l,
+      const float *buffer_r, const float *coeffs, unsigned taps,
+      float *out_buffer)
+{
+   unsigned i;
+   float32x4_t sum_l = vdupq_n_f32(0.0f);
+   float32x4_t sum_r = vdupq_n_f32(0.0f);
+
+   for (i = 0; i < taps; i += 4)
+   {
+      float32x4_t c = vld1q_f32(coeffs + i);
+      sum_l         = vmlaq_f32(sum_l, vld1q_f32(buffer_l + i), c);
+      sum_r         = vmlaq_f32(sum_r, vld1q_f32(buffer_r + i), c);
+   }
+
+   vst1_f32(out_buffer, vpadd_f32(
+         vadd_f32(vget_low_f32(sum_l), vget_high_f32(sum_l)),
+         vadd_f32(vget_low_f32(sum_r), vget_high_f32(sum_r))));
+}
+#endif
+
+/* The FIR loop is a template, instantiated with the tap counts of the
+ * upsampling tiers baked in so the dot product gets unrolled, and with
+ * TAPS == 0 for everything else. The window is pushed in reverse and
+ * kept twice, like in the sinc resampler, so it is always contiguous.
+ * ATTR is empty or a RETRO_TARGET() matching DOT. */
+#define POLYPHASE_FIR(name, DOT, TAPS, ATTR) \
+static ATTR void name(rarch_polyphase_resampler_t *re, \
+      struct resampler_data *data) \
+{ \
+   unsigned taps      = (TAPS) ? (TAPS) : re->taps; \
+   uint32_t phases    = re->phases; \
+   uint32_t step      = re->step; \
+   uint32_t time      = re->time; \
+   unsigned ptr       = re->ptr; \
+   float *buffer_l    = re->buffer_l; \
+   float *buffer_r    = re->buffer_r; \
+   const float *table = re->phase_table; \
+   const float *input = data->data_in; \
+   float *output      = data->data_out; \
+   size_t frames      = data->input_frames; \
+ \
+   while (frames) \
+   { \
+      while (frames && time >= phases) \
+      { \
+         if (!ptr) \
+            ptr = taps; \
+         ptr--; \
+         buffer_l[ptr + taps] = buffer_l[ptr] = *input++; \
+         buffer_r[ptr + taps] = buffer_r[ptr] = *input++; \
+         time -= phases; \
+         frames--; \
+      } \
+ \
+      while (time < phases) \
+      { \
+         DOT(buffer_l + ptr, buffer_r + ptr, table + time * taps, \
+               taps, output); \
+         output += 2; \
+         time   += step; \
+      } \
+   } \
+ \
+   re->time            = time; \
+   re->ptr             = ptr; \
+   data->output_frames = (output - data->data_out) >> 1; \
+}
+
+#define POLYPHASE_FIR_SET(suffix, DOT, ATTR) \
+   POLYPHASE_FIR(polyphase_fir_##suffix, DOT, 0, ATTR) \
+   POLYPHASE_FIR(polyphase_fir_##suffix##_8, DOT, 8, ATTR) \
+   POLYPHASE_FIR(polyphase_fir_##suffix##_16, DOT, 16, ATTR) \
+   POLYPHASE_FIR(polyphase_fir_##suffix##_64, DOT, 64, ATTR) \
+ \
+static polyphase_fir_t polyphase_find_fir_##suffix(unsigned taps) \
+{ \
+   switch (taps) \
+   { \
+      case 8: \
+         return polyphase_fir_##suffix##_8; \
+      case 16: \
+         return polyphase_fir_##suffix##_16; \
+      case 64: \
+         return polyphase_fir_##suffix##_64; \
+   } \
+   return polyphase_fir_##suffix; \
+}
+
+POLYPHASE_FIR_SET(C, polyphase_dot_C, )
+#ifdef HAVE_POLYPHASE_SSE
+POLYPHASE_FIR_SET(sse, polyphase_dot_sse, )
+#endif
+#ifdef HAVE_POLYPHASE_AVX
+POLYPHASE_FIR_SET(avx, polyphase_dot_avx, RETRO_TARGET("avx"))
+POLYPHASE_FIR_SET(fma, polyphase_dot_fma, RETRO_TARGET("avx,fma"))
+#endif
+#ifdef HAVE_POLYPHASE_NEON
+POLYPHASE_FIR_SET(neon, polyphase_dot_neon, )
+#endif
+
+/**
+ * polyphase_find_fraction:
+ * @ratio                : output rate / input rate.
+ * @max_phases           : largest acceptable L.
+ * @phases               : set to L.
+ * @step                 : set to M.
+ *
+ * Walks the continued fraction convergents of @ratio, which are the
+ * best approximations for their size, and takes the first one within
+ * POLYPHASE_DETECT_TOLERANCE.
+ *
+ * Returns: false if there is none with L <= @max_phases.
+ **/
+static bool polyphase_find_fraction(double ratio, unsigned max_phases,
+      uint32_t *phases, uint32_t *step)
+{
+   unsigned i;
+   double x    = ratio;
+   double p0   = 0.0, q0 = 1.0;
+   double p1   = 1.0, q1 = 0.0;
+
+   for (i = 0; i < 32; i++)
+   {
+      double a  = floor(x);
+      double p2 = a * p1 + p0;
+      double q2 = a * q1 + q0;
+
+      if (p2 > max_phases)
+         break;
+
+      if (p2 >= 1.0 && fabs(p2 / q2 / ratio - 1.0)
+            <= POLYPHASE_DETECT_TOLERANCE)
+      {
+         *phases = (uint32_t)p2;
+         *step   = (uint32_t)q2;
+         return true;
+      }
+
+      p0 = p1;
+      q0 = q1;
+      p1 = p2;
+      q1 = q2;
+
+      if (x - a < 1e-9)
+         break;
+      x = 1.0 / (x - a);
+   }
+
+   return false;
+}
+
+/* The filter length sinc_find_kernel() ends up with for the same
+ * settings, so that both resamplers have the same delay. */
+static unsigned polyphase_sinc_taps(unsigned taps, resampler_simd_mask_t mask)
+{
+   if ((taps >= 32 && (mask & (RESAMPLER_SIMD_AVX | RESAMPLER_SIMD_AVX2)))
+         || (mask & RESAMPLER_SIMD_NEON))
+      return (taps + 7) & ~7;
+   return (taps + 3) & ~3;
+}
+
+/* Row i is the filter for an output sample i / L input samples
+ * into the window, laid out like the sinc resampler's phase table.
+ * Rows are padded with zeros from @window_taps to @taps. */
+static void polyphase_init_table(const struct polyphase_tier *tier,
+      double cutoff, float *phase_table, unsigned phases, unsigned taps,
+      unsigned window_taps)
+{
+   unsigned i, j;
+   double window_mod = kaiser_window_function(0.0, tier->kaiser_beta);
+   double sidelobes  = window_taps / 2.0;
+
+   for (i = 0; i < phases; i++)
+   {
+      for (j = 0; j < window_taps; j++)
+      {
+         double window_phase = (double)(j * phases + i)
+            / (phases * window_taps);
+         double sinc_phase;
+
+         window_phase = 2.0 * window_phase - 1.0;
+         sinc_phase   = sidelobes * window_phase;
+
+         phase_table[i * taps + j] = cutoff
+            * sinc(M_PI * sinc_phase * cutoff)
+            * kaiser_window_function(window_phase, tier->kaiser_beta)
+            / window_mod;
+      }
+   }
+}
+
+/* Runs the window through the fallback and sets it to the current
+ * phase, so it continues where the polyphase FIR stopped. */
+static void polyphase_hand_over(rarch_polyphase_resampler_t *re)
+{
+   unsigned i;
+
+   for (i = re->taps; i > 0; i--)
+   {
+      struct resampler_data data;
+      float frame[2];
+      /* A fresh sinc resampler outputs two frames for the first. */
+      float out[2 * 2];
+      unsigned idx = re->ptr + i - 1;
+
+      frame[0]          = re->buffer_l[idx];
+      frame[1]          = re->buffer_r[idx];
+
+      /* The output is dropped, and the phase overwritten below. */
+      data.data_in      = frame;
+      data.data_out     = out;
+      data.input_frames = 1;
+      data.ratio        = 1.0;
+
+      re->fallback->process(re->fallback_data, &data);
+   }
+
+   resampler_sinc_set_time(re->fallback_data,
+         (double)re->time / re->phases);
+   re->fallback_active = true;
+}
+
+static void resampler_polyphase_process(void *re_,
+      struct resampler_data *data)
+{
+   rarch_polyphase_resampler_t *re = (rarch_polyphase_resampler_t*)re_;
+
+   if (!re->fallback_active)
+   {
+      if (fabs(data->ratio / re->ratio - 1.0)
+            <= POLYPHASE_RATIO_TOLERANCE)
+      {
+         re->process(re, data);
+         return;
+      }
+
+      polyphase_hand_over(re);
+   }
+
+   re->fallback->process(re->fallback_data, data);
+}
+
+static void resampler_polyphase_free(void *re_)
+{
+   rarch_polyphase_resampler_t *re = (rarch_polyphase_resampler_t*)re_;
+
+   if (!re)
+      return;
+
+   if (re->fallback && re->fallback_data)
+      re->fallback->free(re->fallback_data);
+   memalign_free(re->main_buffer);
+   free(re);
+}
+
+static void *resampler_polyphase_new(const struct resampler_config *config,
+      double bandwidth_mod, enum resampler_quality quality,
+      resampler_simd_mask_t mask)
+{
+   double cutoff;
+   unsigned taps, max_phases;
+   size_t phase_elems;
+   const struct polyphase_tier *tier = NULL;
+   rarch_polyphase_resampler_t *re   = (rarch_polyphase_resampler_t*)
+      calloc(1, sizeof(*re));
+
+   if (!re)
+      return NULL;
+
+   re->fallback        = &sinc_resampler;
+   re->fallback_data   = sinc_resampler.init(config,
+         bandwidth_mod, quality, mask);
+   if (!re->fallback_data)
+      goto error;
+
+   if (quality == RESAMPLER_QUALITY_DONTCARE
+         || quality > RESAMPLER_QUALITY_HIGHEST)
+      quality = RESAMPLER_QUALITY_NORMAL;
+   tier = &polyphase_tiers[quality - 1];
+
+   taps   = tier->sidelobes * 2;
+   cutoff = tier->cutoff;
+
+   /* Lower the cutoff when downsampling, see sinc_resampler.c. */
+   if (bandwidth_mod < 1.0)
+   {
+      cutoff *= bandwidth_mod;
+      taps    = (unsigned)ceil(taps / bandwidth_mod);
+   }
+
+   taps        = polyphase_sinc_taps(taps, mask);
+   re->taps    = POLYPHASE_ALIGN_TAPS(taps);
+   re->process = polyphase_find_fir_C(re->taps);
+#ifdef HAVE_POLYPHASE_SSE
+   if (mask & RESAMPLER_SIMD_SSE)
+      re->process = polyphase_find_fir_sse(re->taps);
+#endif
+#ifdef HAVE_POLYPHASE_AVX
+   if (re->taps >= POLYPHASE_AVX_MIN_TAPS && (mask & RESAMPLER_SIMD_AVX))
+   {
+      if (mask & RESAMPLER_SIMD_FMA3)
+         re->process = polyphase_find_fir_fma(re->taps);
+      else
+         re->process = polyphase_find_fir_avx(re->taps);
+   }
+#endif
+#ifdef HAVE_POLYPHASE_NEON
+   if (mask & RESAMPLER_SIMD_NEON)
+      re->process = polyphase_find_fir_neon(re->taps);
+#endif
+
+   max_phases = POLYPHASE_MAX_TABLE_ELEMS / re->taps;
+   if (max_phases > POLYPHASE_MAX_PHASES)
+      max_phases = POLYPHASE_MAX_PHASES;
+
+   /* Without a fraction, everything goes through the fallback,
+    * which starts out silent just like the FIR would. */
+   if (!polyphase_find_fraction(bandwidth_mod, max_phases,
+            &re->phases, &re->step))
+   {
+      re->phases          = 0;
+      re->step            = 0;
+      re->fallback_active = true;
+   }
+
+   phase_elems = (size_t)re->phases * re->taps;
+
+   re->main_buffer = (float*)memalign_alloc(128,
+         sizeof(float) * (phase_elems + 4 * re->taps));
+   if (!re->main_buffer)
+      goto error;
+
+   memset(re->main_buffer, 0, sizeof(float) * (phase_elems + 4 * re->taps));
+
+   re->phase_table = re->main_buffer;
+   re->buffer_l    = re->main_buffer + phase_elems;
+   re->buffer_r    = re->buffer_l + 2 * re->taps;
+
+   if (re->phases)
+   {
+      re->ratio = (double)re->phases / re->step;
+      polyphase_init_table(tier, cutoff, re->phase_table,
+            re->phases, re->taps, taps);
+   }
+
+   return re;
+
+error:
+   resampler_polyphase_free(re);
+   return NULL;
+}
+
+rarch_resampler_t polyphase_resampler = {
+   resampler_polyphase_new,
+   resampler_polyphase_process,
+   resampler_polyphase_free,
+   RESAMPLER_API_VERSION,
+   "polyphase",
+   "polyphase"
+};
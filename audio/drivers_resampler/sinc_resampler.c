@@ -20,88 +20,90 @@
 #include <math.h>
 #include <string.h>
 
-#ifdef __SSE__
-#include <xmmintrin.h>
-#endif
-
 #include <retro_inline.h>
 #include <filters.h>
 #include <memalign.h>
+#include <features/features_target.h>
 
 #include "../audio_resampler_driver.h"
 
-/* Rough SNR values for upsampling:
+/* Where features_target.h allows, the SSE, AVX and FMA kernels
+ * are compiled regardless of -m flags and picked at runtime. */
+#if defined(RETRO_HAVE_TARGET_X86)
+#define HAVE_SINC_SSE
+#define HAVE_SINC_AVX
+#define HAVE_SINC_FMA
+#include <immintrin.h>
+#elif defined(__SSE__)
+#define HAVE_SINC_SSE
+#include <xmmintrin.h>
+#if defined(__AVX__)
+#define HAVE_SINC_AVX
+#include <immintrin.h>
+#endif
+#if defined(__FMA__)
+#define HAVE_SINC_FMA
+#endif
+#endif
+
+#if (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(VITA)
+#define HAVE_SINC_NEON
+#include <arm_neon.h>
+#endif
+
+/* Quality tiers, picked when the resampler is created.
+ * Rough SNR values for upsampling:
  * LOWEST: 40 dB
  * LOWER: 55 dB
  * NORMAL: 70 dB
  * HIGHER: 110 dB
  * HIGHEST: 140 dB
+ *
+ * The SINC_*_QUALITY defines only select the tier used when the
+ * frontend doesn't ask for one.
  */
-
-/* TODO, make all this more configurable. */
 #if defined(SINC_LOWEST_QUALITY)
-#define SINC_WINDOW_LANCZOS
-#define CUTOFF 0.98
-#define PHASE_BITS 12
-#define SINC_COEFF_LERP 0
-#define SUBPHASE_BITS 10
-#define SIDELOBES 2
-#define ENABLE_AVX 0
+#define SINC_DEFAULT_QUALITY RESAMPLER_QUALITY_LOWEST
 #elif defined(SINC_LOWER_QUALITY)
-#define SINC_WINDOW_LANCZOS
-#define CUTOFF 0.98
-#define PHASE_BITS 12
-#define SUBPHASE_BITS 10
-#define SINC_COEFF_LERP 0
-#define SIDELOBES 4
-#define ENABLE_AVX 0
+#define SINC_DEFAULT_QUALITY RESAMPLER_QUALITY_LOWER
 #elif defined(SINC_HIGHER_QUALITY)
-#define SINC_WINDOW_KAISER
-#define SINC_WINDOW_KAISER_BETA 10.5
-#define CUTOFF 0.90
-#define PHASE_BITS 10
-#define SUBPHASE_BITS 14
-#define SINC_COEFF_LERP 1
-#define SIDELOBES 32
-#define ENABLE_AVX 1
+#define SINC_DEFAULT_QUALITY RESAMPLER_QUALITY_HIGHER
 #elif defined(SINC_HIGHEST_QUALITY)
-#define SINC_WINDOW_KAISER
-#define SINC_WINDOW_KAISER_BETA 14.5
-#define CUTOFF 0.962
-#define PHASE_BITS 10
-#define SUBPHASE_BITS 14
-#define SINC_COEFF_LERP 1
-#define SIDELOBES 128
-#define ENABLE_AVX 1
+#define SINC_DEFAULT_QUALITY RESAMPLER_QUALITY_HIGHEST
 #else
-#define SINC_WINDOW_KAISER
-#define SINC_WINDOW_KAISER_BETA 5.5
-#define CUTOFF 0.825
-#define PHASE_BITS 8
-#define SUBPHASE_BITS 16
-#define SINC_COEFF_LERP 1
-#define SIDELOBES 8
-#define ENABLE_AVX 0
+#define SINC_DEFAULT_QUALITY RESAMPLER_QUALITY_NORMAL
 #endif
 
-/* For the little amount of taps we're using,
- * SSE1 is faster than AVX for some reason.
- * AVX code is kept here though as by increasing number
- * of sinc taps, the AVX code is clearly faster than SSE1.
- */
-
-#if defined(__AVX__) && ENABLE_AVX
-#include <immintrin.h>
-#endif
+enum sinc_window
+{
+   SINC_WINDOW_LANCZOS = 0,
+   SINC_WINDOW_KAISER
+};
 
-#define PHASES (1 << (PHASE_BITS + SUBPHASE_BITS))
+struct sinc_tier
+{
+   enum sinc_window window;
+   double kaiser_beta;
+   double cutoff;
+   unsigned phase_bits;
+   unsigned subphase_bits;
+   unsigned sidelobes;
+   bool coeff_lerp;
+};
 
-#define TAPS (SIDELOBES * 2)
-#define SUBPHASE_MASK ((1 << SUBPHASE_BITS) - 1)
-#define SUBPHASE_MOD (1.0f / (1 << SUBPHASE_BITS))
+/* Indexed by enum resampler_quality - 1. */
+static const struct sinc_tier sinc_tiers[] = {
+   { SINC_WINDOW_LANCZOS, 0.0,  0.98,  12, 10,   2, false },
+   { SINC_WINDOW_LANCZOS, 0.0,  0.98,  12, 10,   4, false },
+   { SINC_WINDOW_KAISER,  5.5,  0.825,  8, 16,   8, true  },
+   { SINC_WINDOW_KAISER,  10.5, 0.90,  10, 14,  32, true  },
+   { SINC_WINDOW_KAISER,  14.5, 0.962, 10, 14, 128, true  },
+};
 
 typedef struct rarch_sinc_resampler
 {
+   void (*process)(struct rarch_sinc_resampler *resamp, float *out_buffer);
+
    float *phase_table;
    float *buffer_l;
    float *buffer_r;
@@ -111,25 +113,32 @@ typedef struct rarch_sinc_resampler
    unsigned ptr;
    uint32_t time;
 
+   uint32_t phases;
+   unsigned subphase_bits;
+   uint32_t subphase_mask;
+   float subphase_mod;
+
    /* A buffer for phase_table, buffer_l and buffer_r 
     * are created in a single calloc().
     * Ensure that we get as good cache locality as we can hope for. */
    float *main_buffer;
 } rarch_sinc_resampler_t;
 
-#if defined(SINC_WINDOW_LANCZOS)
-#define window_function(idx)  (lanzcos_window_function(idx))
-#elif defined(SINC_WINDOW_KAISER)
-#define window_function(idx)  (kaiser_window_function(idx, SINC_WINDOW_KAISER_BETA))
-#else
-#error "No SINC window function defined."
-#endif
+typedef void (*sinc_process_t)(rarch_sinc_resampler_t *resamp,
+      float *out_buffer);
+
+static double window_function(const struct sinc_tier *tier, double idx)
+{
+   if (tier->window == SINC_WINDOW_LANCZOS)
+      return lanzcos_window_function(idx);
+   return kaiser_window_function(idx, tier->kaiser_beta);
+}
 
-static void init_sinc_table(rarch_sinc_resampler_t *resamp, double cutoff,
+static void init_sinc_table(const struct sinc_tier *tier, double cutoff,
       float *phase_table, int phases, int taps, bool calculate_delta)
 {
    int i, j;
-   double    window_mod = window_function(0.0); /* Need to normalize w(0) to 1.0. */
+   double    window_mod = window_function(tier, 0.0); /* Need to normalize w(0) to 1.0. */
    int           stride = calculate_delta ? 2 : 1;
    double     sidelobes = taps / 2.0;
 
@@ -144,7 +153,7 @@ static void init_sinc_table(rarch_sinc_resampler_t *resamp, double cutoff,
          window_phase        = 2.0 * window_phase - 1.0; /* [-1, 1) */
          sinc_phase          = sidelobes * window_phase;
          val                 = cutoff * sinc(M_PI * sinc_phase * cutoff) * 
-            window_function(window_phase) / window_mod;
+            window_function(tier, window_phase) / window_mod;
          phase_table[i * stride * taps + j] = val;
       }
    }
@@ -175,177 +184,304 @@ static void init_sinc_table(rarch_sinc_resampler_t *resamp, double cutoff,
          sinc_phase          = sidelobes * window_phase;
 
          val                 = cutoff * sinc(M_PI * sinc_phase * cutoff) * 
-            window_function(window_phase) / window_mod;
+            window_function(tier, window_phase) / window_mod;
          delta = (val - phase_table[phase * stride * taps + j]);
          phase_table[(phase * stride + 1) * taps + j] = delta;
       }
    }
 }
 
-#if !(defined(__AVX__) && ENABLE_AVX) && !defined(__SSE__)
-static INLINE void process_sinc_C(rarch_sinc_resampler_t *resamp,
-      float *out_buffer)
-{
-   unsigned i;
-   float sum_l              = 0.0f;
-   float sum_r              = 0.0f;
-   const float *buffer_l    = resamp->buffer_l + resamp->ptr;
-   const float *buffer_r    = resamp->buffer_r + resamp->ptr;
-   unsigned taps            = resamp->taps;
-   unsigned phase           = resamp->time >> SUBPHASE_BITS;
-#if SINC_COEFF_LERP
-   const float *phase_table = resamp->phase_table + phase * taps * 2;
-   const float *delta_table = phase_table + taps;
-   float delta              = (float)
-      (resamp->time & SUBPHASE_MASK) * SUBPHASE_MOD;
-#else
-   const float *phase_table = resamp->phase_table + phase * taps;
-#endif
-
-   for (i = 0; i < taps; i++)
-   {
-#if SINC_COEFF_LERP
-      float sinc_val = phase_table[i] + delta_table[i] * delta;
-#else
-      float sinc_val = phase_table[i];
-#endif
-      sum_l         += buffer_l[i] * sinc_val;
-      sum_r         += buffer_r[i] * sinc_val;
-   }
-
-   out_buffer[0] = sum_l;
-   out_buffer[1] = sum_r;
+/* The kernels below are templates. Each one is instantiated once with
+ * TAPS == 0, which reads the tap count from the resampler and covers
+ * downsampling, and once per quality tier with the tier's tap count
+ * baked in, so the compiler can unroll the loop. LERP selects linear
+ * interpolation between adjacent phases of the table.
+ *
+ * Every kernel sets out_buffer[0] and out_buffer[1] to the left and
+ * right output sample for the current resampler time. */
+
+#define SINC_KERNEL_SETUP(TAPS, LERP) \
+   const float *buffer_l    = resamp->buffer_l + resamp->ptr; \
+   const float *buffer_r    = resamp->buffer_r + resamp->ptr; \
+   unsigned taps            = (TAPS) ? (TAPS) : resamp->taps; \
+   unsigned phase           = resamp->time >> resamp->subphase_bits; \
+   const float *phase_table = resamp->phase_table + \
+      phase * taps * ((LERP) ? 2 : 1); \
+   const float *delta_table = phase_table + taps; \
+   float delta_f            = (float) \
+      (resamp->time & resamp->subphase_mask) * resamp->subphase_mod
+
+#define SINC_KERNEL_C(name, LERP) \
+static void name(rarch_sinc_resampler_t *resamp, float *out_buffer) \
+{ \
+   unsigned i; \
+   float sum_l              = 0.0f; \
+   float sum_r              = 0.0f; \
+   SINC_KERNEL_SETUP(0, LERP); \
+ \
+   for (i = 0; i < taps; i++) \
+   { \
+      float sinc_val = phase_table[i]; \
+      if (LERP) \
+         sinc_val   += delta_table[i] * delta_f; \
+      sum_l         += buffer_l[i] * sinc_val; \
+      sum_r         += buffer_r[i] * sinc_val; \
+   } \
+ \
+   out_buffer[0] = sum_l; \
+   out_buffer[1] = sum_r; \
 }
-#endif
 
-#if defined(__AVX__) && ENABLE_AVX
-#define process_sinc_func process_sinc
-static void process_sinc(rarch_sinc_resampler_t *resamp, float *out_buffer)
+SINC_KERNEL_C(process_sinc_C, false)
+SINC_KERNEL_C(process_sinc_C_lerp, true)
+
+static sinc_process_t sinc_find_kernel_C(unsigned taps, bool lerp)
 {
-   unsigned i;
-   __m256 sum_l             = _mm256_setzero_ps();
-   __m256 sum_r             = _mm256_setzero_ps();
+   (void)taps;
+   return lerp ? process_sinc_C_lerp : process_sinc_C;
+}
 
-   const float *buffer_l    = resamp->buffer_l + resamp->ptr;
-   const float *buffer_r    = resamp->buffer_r + resamp->ptr;
+#ifdef HAVE_SINC_SSE
+#define SINC_STEP_SSE(sum_l, sum_r, i, LERP) do { \
+   __m128 buf_l = _mm_loadu_ps(buffer_l + (i)); \
+   __m128 buf_r = _mm_loadu_ps(buffer_r + (i)); \
+   __m128 _sinc = _mm_load_ps(phase_table + (i)); \
+   if (LERP) \
+      _sinc     = _mm_add_ps(_sinc, \
+            _mm_mul_ps(_mm_load_ps(delta_table + (i)), delta)); \
+   sum_l        = _mm_add_ps(sum_l, _mm_mul_ps(buf_l, _sinc)); \
+   sum_r        = _mm_add_ps(sum_r, _mm_mul_ps(buf_r, _sinc)); \
+} while (0)
+
+#define SINC_KERNEL_SSE(name, TAPS, LERP) \
+static RETRO_TARGET("sse") void name(rarch_sinc_resampler_t *resamp, \
+      float *out_buffer) \
+{ \
+   unsigned i; \
+   __m128 sum, delta; \
+   __m128 sum_l             = _mm_setzero_ps(); \
+   __m128 sum_r             = _mm_setzero_ps(); \
+   __m128 sum_l2            = _mm_setzero_ps(); \
+   __m128 sum_r2            = _mm_setzero_ps(); \
+   SINC_KERNEL_SETUP(TAPS, LERP); \
+   delta                    = _mm_set1_ps(delta_f); \
+ \
+   for (i = 0; i + 8 <= taps; i += 8) \
+   { \
+      SINC_STEP_SSE(sum_l, sum_r, i, LERP); \
+      SINC_STEP_SSE(sum_l2, sum_r2, i + 4, LERP); \
+   } \
+   if (i < taps) \
+      SINC_STEP_SSE(sum_l, sum_r, i, LERP); \
+   sum_l = _mm_add_ps(sum_l, sum_l2); \
+   sum_r = _mm_add_ps(sum_r, sum_r2); \
+ \
+   /* sum_l = { l3, l2, l1, l0 } \
+    * sum_r = { r3, r2, r1, r0 } \
+    * sum   = { r1, r0, l1, l0 } + { r3, r2, l3, l2 } \
+    *       = { R1, R0, L1, L0 } */ \
+   sum = _mm_add_ps(_mm_shuffle_ps(sum_l, sum_r, \
+            _MM_SHUFFLE(1, 0, 1, 0)), \
+         _mm_shuffle_ps(sum_l, sum_r, _MM_SHUFFLE(3, 2, 3, 2))); \
+ \
+   /* sum   = { R1, R1, L1, L1 } + { R1, R0, L1, L0 } \
+    *       = { X,  R,  X,  L } */ \
+   sum = _mm_add_ps(_mm_shuffle_ps(sum, sum, _MM_SHUFFLE(3, 3, 1, 1)), sum); \
+ \
+   _mm_store_ss(out_buffer + 0, sum); \
+   /* movehl { X, R, X, L } == { X, R, X, R } */ \
+   _mm_store_ss(out_buffer + 1, _mm_movehl_ps(sum, sum)); \
+}
 
-   unsigned taps            = resamp->taps;
-   unsigned phase           = resamp->time >> SUBPHASE_BITS;
-#if SINC_COEFF_LERP
-   const float *phase_table = resamp->phase_table + phase * taps * 2;
-   const float *delta_table = phase_table + taps;
-   __m256 delta             = _mm256_set1_ps((float)
-         (resamp->time & SUBPHASE_MASK) * SUBPHASE_MOD);
-#else
-   const float *phase_table = resamp->phase_table + phase * taps;
-#endif
+SINC_KERNEL_SSE(process_sinc_sse, 0, false)
+SINC_KERNEL_SSE(process_sinc_sse_lerp, 0, true)
+SINC_KERNEL_SSE(process_sinc_sse_4, 4, false)
+SINC_KERNEL_SSE(process_sinc_sse_8, 8, false)
+SINC_KERNEL_SSE(process_sinc_sse_16_lerp, 16, true)
+SINC_KERNEL_SSE(process_sinc_sse_64_lerp, 64, true)
+SINC_KERNEL_SSE(process_sinc_sse_256_lerp, 256, true)
 
-   for (i = 0; i < taps; i += 8)
+static sinc_process_t sinc_find_kernel_sse(unsigned taps, bool lerp)
+{
+   if (lerp)
    {
-      __m256 buf_l  = _mm256_loadu_ps(buffer_l + i);
-      __m256 buf_r  = _mm256_loadu_ps(buffer_r + i);
-
-#if SINC_COEFF_LERP
-      __m256 deltas = _mm256_load_ps(delta_table + i);
-      __m256 sinc   = _mm256_add_ps(_mm256_load_ps(phase_table + i),
-            _mm256_mul_ps(deltas, delta));
-#else
-      __m256 sinc   = _mm256_load_ps(phase_table + i);
-#endif
-      sum_l         = _mm256_add_ps(sum_l, _mm256_mul_ps(buf_l, sinc));
-      sum_r         = _mm256_add_ps(sum_r, _mm256_mul_ps(buf_r, sinc));
+      switch (taps)
+      {
+         case 16:
+            return process_sinc_sse_16_lerp;
+         case 64:
+            return process_sinc_sse_64_lerp;
+         case 256:
+            return process_sinc_sse_256_lerp;
+      }
+      return process_sinc_sse_lerp;
    }
 
-   /* hadd on AVX is weird, and acts on low-lanes 
-    * and high-lanes separately. */
-   __m256 res_l = _mm256_hadd_ps(sum_l, sum_l);
-   __m256 res_r = _mm256_hadd_ps(sum_r, sum_r);
-   res_l        = _mm256_hadd_ps(res_l, res_l);
-   res_r        = _mm256_hadd_ps(res_r, res_r);
-   res_l        = _mm256_add_ps(_mm256_permute2f128_ps(res_l, res_l, 1), res_l);
-   res_r        = _mm256_add_ps(_mm256_permute2f128_ps(res_r, res_r, 1), res_r);
-
-   /* This is optimized to mov %xmmN, [mem].
-    * There doesn't seem to be any _mm256_store_ss intrinsic. */
-   _mm_store_ss(out_buffer + 0, _mm256_extractf128_ps(res_l, 0));
-   _mm_store_ss(out_buffer + 1, _mm256_extractf128_ps(res_r, 0));
+   switch (taps)
+   {
+      case 4:
+         return process_sinc_sse_4;
+      case 8:
+         return process_sinc_sse_8;
+   }
+   return process_sinc_sse;
 }
-#elif defined(__SSE__)
-#define process_sinc_func process_sinc
-static void process_sinc(rarch_sinc_resampler_t *resamp, float *out_buffer)
-{
-   unsigned i;
-   __m128 sum;
-   __m128 sum_l             = _mm_setzero_ps();
-   __m128 sum_r             = _mm_setzero_ps();
+#endif
 
-   const float *buffer_l    = resamp->buffer_l + resamp->ptr;
-   const float *buffer_r    = resamp->buffer_r + resamp->ptr;
+#ifdef HAVE_SINC_AVX
+#define SINC_MADD_AVX(a, b, c) _mm256_add_ps(_mm256_mul_ps((a), (b)), (c))
+#define SINC_MADD_FMA(a, b, c) _mm256_fmadd_ps((a), (b), (c))
+
+#define SINC_STEP_AVX(MADD, sum_l, sum_r, i, LERP) do { \
+   __m256 buf_l = _mm256_loadu_ps(buffer_l + (i)); \
+   __m256 buf_r = _mm256_loadu_ps(buffer_r + (i)); \
+   __m256 _sinc = _mm256_load_ps(phase_table + (i)); \
+   if (LERP) \
+      _sinc     = MADD(_mm256_load_ps(delta_table + (i)), delta, _sinc); \
+   sum_l        = MADD(buf_l, _sinc, sum_l); \
+   sum_r        = MADD(buf_r, _sinc, sum_r); \
+} while (0)
+
+/* MADD is one of the SINC_MADD_* macros above. */
+#define SINC_KERNEL_AVX(name, target, MADD, TAPS, LERP) \
+static RETRO_TARGET(target) void name(rarch_sinc_resampler_t *resamp, \
+      float *out_buffer) \
+{ \
+   unsigned i; \
+   __m256 delta, res_l, res_r; \
+   __m256 sum_l             = _mm256_setzero_ps(); \
+   __m256 sum_r             = _mm256_setzero_ps(); \
+   __m256 sum_l2            = _mm256_setzero_ps(); \
+   __m256 sum_r2            = _mm256_setzero_ps(); \
+   SINC_KERNEL_SETUP(TAPS, LERP); \
+   delta                    = _mm256_set1_ps(delta_f); \
+ \
+   for (i = 0; i + 16 <= taps; i += 16) \
+   { \
+      SINC_STEP_AVX(MADD, sum_l, sum_r, i, LERP); \
+      SINC_STEP_AVX(MADD, sum_l2, sum_r2, i + 8, LERP); \
+   } \
+   if (i < taps) \
+      SINC_STEP_AVX(MADD, sum_l, sum_r, i, LERP); \
+   sum_l = _mm256_add_ps(sum_l, sum_l2); \
+   sum_r = _mm256_add_ps(sum_r, sum_r2); \
+ \
+   /* hadd on AVX is weird, and acts on low-lanes \
+    * and high-lanes separately. */ \
+   res_l = _mm256_hadd_ps(sum_l, sum_l); \
+   res_r = _mm256_hadd_ps(sum_r, sum_r); \
+   res_l = _mm256_hadd_ps(res_l, res_l); \
+   res_r = _mm256_hadd_ps(res_r, res_r); \
+   res_l = _mm256_add_ps(_mm256_permute2f128_ps(res_l, res_l, 1), res_l); \
+   res_r = _mm256_add_ps(_mm256_permute2f128_ps(res_r, res_r, 1), res_r); \
+ \
+   /* This is optimized to mov %xmmN, [mem]. \
+    * There doesn't seem to be any _mm256_store_ss intrinsic. */ \
+   _mm_store_ss(out_buffer + 0, _mm256_castps256_ps128(res_l)); \
+   _mm_store_ss(out_buffer + 1, _mm256_castps256_ps128(res_r)); \
+}
 
-   unsigned taps            = resamp->taps;
-   unsigned phase           = resamp->time >> SUBPHASE_BITS;
-#if SINC_COEFF_LERP
-   const float *phase_table = resamp->phase_table + phase * taps * 2;
-   const float *delta_table = phase_table + taps;
-   __m128 delta             = _mm_set1_ps((float)
-         (resamp->time & SUBPHASE_MASK) * SUBPHASE_MOD);
-#else
-   const float *phase_table = resamp->phase_table + phase * taps;
-#endif
+SINC_KERNEL_AVX(process_sinc_avx, "avx", SINC_MADD_AVX, 0, false)
+SINC_KERNEL_AVX(process_sinc_avx_lerp, "avx", SINC_MADD_AVX, 0, true)
+SINC_KERNEL_AVX(process_sinc_avx_64_lerp, "avx", SINC_MADD_AVX, 64, true)
+SINC_KERNEL_AVX(process_sinc_avx_256_lerp, "avx", SINC_MADD_AVX, 256, true)
 
-   for (i = 0; i < taps; i += 4)
+static sinc_process_t sinc_find_kernel_avx(unsigned taps, bool lerp)
+{
+   if (lerp)
    {
-      __m128 buf_l = _mm_loadu_ps(buffer_l + i);
-      __m128 buf_r = _mm_loadu_ps(buffer_r + i);
-
-#if SINC_COEFF_LERP
-      __m128 deltas = _mm_load_ps(delta_table + i);
-      __m128 _sinc  = _mm_add_ps(_mm_load_ps(phase_table + i),
-            _mm_mul_ps(deltas, delta));
-#else
-      __m128 _sinc = _mm_load_ps(phase_table + i);
-#endif
-      sum_l        = _mm_add_ps(sum_l, _mm_mul_ps(buf_l, _sinc));
-      sum_r        = _mm_add_ps(sum_r, _mm_mul_ps(buf_r, _sinc));
+      switch (taps)
+      {
+         case 64:
+            return process_sinc_avx_64_lerp;
+         case 256:
+            return process_sinc_avx_256_lerp;
+      }
+      return process_sinc_avx_lerp;
    }
 
-   /* Them annoying shuffles.
-    * sum_l = { l3, l2, l1, l0 }
-    * sum_r = { r3, r2, r1, r0 }
-    */
-
-   sum = _mm_add_ps(_mm_shuffle_ps(sum_l, sum_r,
-            _MM_SHUFFLE(1, 0, 1, 0)),
-         _mm_shuffle_ps(sum_l, sum_r, _MM_SHUFFLE(3, 2, 3, 2)));
-
-   /* sum   = { r1, r0, l1, l0 } + { r3, r2, l3, l2 }
-    * sum   = { R1, R0, L1, L0 }
-    */
-
-   sum = _mm_add_ps(_mm_shuffle_ps(sum, sum, _MM_SHUFFLE(3, 3, 1, 1)), sum);
+   return process_sinc_avx;
+}
+#endif
 
-   /* sum   = {R1, R1, L1, L1 } + { R1, R0, L1, L0 }
-    * sum   = { X,  R,  X,  L } 
-    */
+#ifdef HAVE_SINC_FMA
+SINC_KERNEL_AVX(process_sinc_fma, "avx,fma", SINC_MADD_FMA, 0, false)
+SINC_KERNEL_AVX(process_sinc_fma_lerp, "avx,fma", SINC_MADD_FMA, 0, true)
+SINC_KERNEL_AVX(process_sinc_fma_64_lerp, "avx,fma", SINC_MADD_FMA, 64, true)
+SINC_KERNEL_AVX(process_sinc_fma_256_lerp, "avx,fma", SINC_MADD_FMA, 256, true)
 
-   /* Store L */
-   _mm_store_ss(out_buffer + 0, sum);
+static sinc_process_t sinc_find_kernel_fma(unsigned taps, bool lerp)
+{
+   if (lerp)
+   {
+      switch (taps)
+      {
+         case 64:
+            return process_sinc_fma_64_lerp;
+         case 256:
+            return process_sinc_fma_256_lerp;
+      }
+      return process_sinc_fma_lerp;
+   }
 
-   /* movehl { X, R, X, L } == { X, R, X, R } */
-   _mm_store_ss(out_buffer + 1, _mm_movehl_ps(sum, sum));
+   return process_sinc_fma;
 }
-#elif defined(__ARM_NEON__) && !defined(VITA)
+#endif
 
-#if SINC_COEFF_LERP
-#error "NEON asm does not support SINC lerp."
+#ifdef HAVE_SINC_NEON
+#if defined(__aarch64__)
+#define SINC_MADD_NEON(a, b, c) vfmaq_f32((c), (a), (b))
+#else
+#define SINC_MADD_NEON(a, b, c) vmlaq_f32((c), (a), (b))
 #endif
 
-/* Need to make this function pointer as Android doesn't 
- * have built-in targets for NEON and plain ARMv7a.
- */
-static void (*process_sinc_func)(rarch_sinc_resampler_t *resamp,
-      float *out_buffer);
+#define SINC_STEP_NEON(sum_l, sum_r, i, LERP) do { \
+   float32x4_t buf_l = vld1q_f32(buffer_l + (i)); \
+   float32x4_t buf_r = vld1q_f32(buffer_r + (i)); \
+   float32x4_t _sinc = vld1q_f32(phase_table + (i)); \
+   if (LERP) \
+      _sinc          = SINC_MADD_NEON(vld1q_f32(delta_table + (i)), \
+            delta, _sinc); \
+   sum_l             = SINC_MADD_NEON(buf_l, _sinc, sum_l); \
+   sum_r             = SINC_MADD_NEON(buf_r, _sinc, sum_r); \
+} while (0)
+
+#define SINC_KERNEL_NEON(name, TAPS, LERP) \
+static void name(rarch_sinc_resampler_t *resamp, float *out_buffer) \
+{ \
+   unsigned i; \
+   float32x4_t delta; \
+   float32x2_t res_l, res_r; \
+   float32x4_t sum_l        = vdupq_n_f32(0.0f); \
+   float32x4_t sum_r        = vdupq_n_f32(0.0f); \
+   float32x4_t sum_l2       = vdupq_n_f32(0.0f); \
+   float32x4_t sum_r2       = vdupq_n_f32(0.0f); \
+   SINC_KERNEL_SETUP(TAPS, LERP); \
+   delta                    = vdupq_n_f32(delta_f); \
+ \
+   for (i = 0; i + 8 <= taps; i += 8) \
+   { \
+      SINC_STEP_NEON(sum_l, sum_r, i, LERP); \
+      SINC_STEP_NEON(sum_l2, sum_r2, i + 4, LERP); \
+   } \
+   if (i < taps) \
+      SINC_STEP_NEON(sum_l, sum_r, i, LERP); \
+   sum_l = vaddq_f32(sum_l, sum_l2); \
+   sum_r = vaddq_f32(sum_r, sum_r2); \
+ \
+   res_l = vadd_f32(vget_low_f32(sum_l), vget_high_f32(sum_l)); \
+   res_r = vadd_f32(vget_low_f32(sum_r), vget_high_f32(sum_r)); \
+   /* { L, R } */ \
+   vst1_f32(out_buffer, vpadd_f32(res_l, res_r)); \
+}
 
+SINC_KERNEL_NEON(process_sinc_neon_lerp, 0, true)
+SINC_KERNEL_NEON(process_sinc_neon_8, 8, false)
+SINC_KERNEL_NEON(process_sinc_neon_16_lerp, 16, true)
+SINC_KERNEL_NEON(process_sinc_neon_64_lerp, 64, true)
+SINC_KERNEL_NEON(process_sinc_neon_256_lerp, 256, true)
+
+#if defined(__ARM_NEON__)
 /* Assumes that taps >= 8, and that taps is a multiple of 8. */
 void process_sinc_neon_asm(float *out, const float *left, 
       const float *right, const float *coeff, unsigned taps);
@@ -356,21 +492,99 @@ static void process_sinc_neon(rarch_sinc_resampler_t *resamp,
    const float *buffer_l    = resamp->buffer_l + resamp->ptr;
    const float *buffer_r    = resamp->buffer_r + resamp->ptr;
 
-   unsigned phase           = resamp->time >> SUBPHASE_BITS;
+   unsigned phase           = resamp->time >> resamp->subphase_bits;
    unsigned taps            = resamp->taps;
    const float *phase_table = resamp->phase_table + phase * taps;
 
    process_sinc_neon_asm(out_buffer, buffer_l, buffer_r, phase_table, taps);
 }
-#else /* Plain ol' C99 */
-#define process_sinc_func process_sinc_C
+#else
+SINC_KERNEL_NEON(process_sinc_neon, 0, false)
+#endif
+
+static sinc_process_t sinc_find_kernel_neon(unsigned taps, bool lerp)
+{
+   if (lerp)
+   {
+      switch (taps)
+      {
+         case 16:
+            return process_sinc_neon_16_lerp;
+         case 64:
+            return process_sinc_neon_64_lerp;
+         case 256:
+            return process_sinc_neon_256_lerp;
+      }
+      return process_sinc_neon_lerp;
+   }
+
+   if (taps == 8)
+      return process_sinc_neon_8;
+   return process_sinc_neon;
+}
 #endif
 
+#define SINC_ALIGN_TAPS(taps, align) (((taps) + (align) - 1) & ~((align) - 1))
+
+/* For the little amount of taps the lower tiers use,
+ * SSE1 is faster than AVX, so AVX is only used from here on. */
+#define SINC_AVX_MIN_TAPS 32
+
+/**
+ * sinc_find_kernel:
+ * @taps               : number of taps, rounded up to what
+ *                       the kernel needs.
+ * @lerp               : whether the phase table holds deltas.
+ * @mask               : SIMD instruction sets the CPU supports.
+ *
+ * Picks the fastest kernel the CPU supports.
+ *
+ * Returns: kernel for @taps and @lerp.
+ **/
+static sinc_process_t sinc_find_kernel(unsigned *taps, bool lerp,
+      resampler_simd_mask_t mask)
+{
+#ifdef HAVE_SINC_FMA
+   if (*taps >= SINC_AVX_MIN_TAPS
+         && (mask & RESAMPLER_SIMD_AVX) && (mask & RESAMPLER_SIMD_FMA3))
+   {
+      *taps = SINC_ALIGN_TAPS(*taps, 8);
+      return sinc_find_kernel_fma(*taps, lerp);
+   }
+#endif
+#ifdef HAVE_SINC_AVX
+   if (*taps >= SINC_AVX_MIN_TAPS && (mask & RESAMPLER_SIMD_AVX))
+   {
+      *taps = SINC_ALIGN_TAPS(*taps, 8);
+      return sinc_find_kernel_avx(*taps, lerp);
+   }
+#endif
+#ifdef HAVE_SINC_SSE
+   if (mask & RESAMPLER_SIMD_SSE)
+   {
+      *taps = SINC_ALIGN_TAPS(*taps, 4);
+      return sinc_find_kernel_sse(*taps, lerp);
+   }
+#endif
+#ifdef HAVE_SINC_NEON
+   if (mask & RESAMPLER_SIMD_NEON)
+   {
+      /* The NEON asm works on 8 taps at a time. */
+      *taps = SINC_ALIGN_TAPS(*taps, 8);
+      return sinc_find_kernel_neon(*taps, lerp);
+   }
+#endif
+
+   *taps = SINC_ALIGN_TAPS(*taps, 4);
+   return sinc_find_kernel_C(*taps, lerp);
+}
+
 static void resampler_sinc_process(void *re_, struct resampler_data *data)
 {
    rarch_sinc_resampler_t *re = (rarch_sinc_resampler_t*)re_;
 
-   uint32_t ratio        = PHASES / data->ratio;
+   uint32_t phases       = re->phases;
+   uint32_t ratio        = phases / data->ratio;
    const float *input    = data->data_in;
    float *output         = data->data_out;
    size_t frames         = data->input_frames;
@@ -378,7 +592,7 @@ static void resampler_sinc_process(void *re_, struct resampler_data *data)
 
    while (frames)
    {
-      while (frames && re->time >= PHASES)
+      while (frames && re->time >= phases)
       {
          /* Push in reverse to make filter more obvious. */
          if (!re->ptr)
@@ -388,13 +602,13 @@ static void resampler_sinc_process(void *re_, struct resampler_data *data)
          re->buffer_l[re->ptr + re->taps] = re->buffer_l[re->ptr] = *input++;
          re->buffer_r[re->ptr + re->taps] = re->buffer_r[re->ptr] = *input++;
 
-         re->time -= PHASES;
+         re->time -= phases;
          frames--;
       }
 
-      while (re->time < PHASES)
+      while (re->time < phases)
       {
-         process_sinc_func(re, output);
+         re->process(re, output);
          output += 2;
          out_frames++;
          re->time += ratio;
@@ -404,6 +618,12 @@ static void resampler_sinc_process(void *re_, struct resampler_data *data)
    data->output_frames = out_frames;
 }
 
+void resampler_sinc_set_time(void *re_, double time)
+{
+   rarch_sinc_resampler_t *re = (rarch_sinc_resampler_t*)re_;
+   re->time                   = (uint32_t)(time * re->phases + 0.5);
+}
+
 static void resampler_sinc_free(void *re)
 {
    rarch_sinc_resampler_t *resampler = (rarch_sinc_resampler_t*)re;
@@ -413,11 +633,13 @@ static void resampler_sinc_free(void *re)
 }
 
 static void *resampler_sinc_new(const struct resampler_config *config,
-      double bandwidth_mod, resampler_simd_mask_t mask)
+      double bandwidth_mod, enum resampler_quality quality,
+      resampler_simd_mask_t mask)
 {
    double cutoff;
    size_t phase_elems, elems;
-   rarch_sinc_resampler_t *re = (rarch_sinc_resampler_t*)
+   const struct sinc_tier *tier = NULL;
+   rarch_sinc_resampler_t *re   = (rarch_sinc_resampler_t*)
       calloc(1, sizeof(*re));
 
    if (!re)
@@ -425,8 +647,13 @@ static void *resampler_sinc_new(const struct resampler_config *config,
 
    (void)config;
 
-   re->taps = TAPS;
-   cutoff   = CUTOFF;
+   if (quality == RESAMPLER_QUALITY_DONTCARE
+         || quality > RESAMPLER_QUALITY_HIGHEST)
+      quality = SINC_DEFAULT_QUALITY;
+   tier = &sinc_tiers[quality - 1];
+
+   re->taps = tier->sidelobes * 2;
+   cutoff   = tier->cutoff;
 
    /* Downsampling, must lower cutoff, and extend number of 
     * taps accordingly to keep same stopband attenuation. */
@@ -437,33 +664,30 @@ static void *resampler_sinc_new(const struct resampler_config *config,
    }
 
    /* Be SIMD-friendly. */
-#if (defined(__AVX__) && ENABLE_AVX) || (defined(__ARM_NEON__)&& !defined(VITA))
-   re->taps     = (re->taps + 7) & ~7;
-#else
-   re->taps     = (re->taps + 3) & ~3;
-#endif
+   re->process       = sinc_find_kernel(&re->taps, tier->coeff_lerp, mask);
 
-   phase_elems  = (1 << PHASE_BITS) * re->taps;
-#if SINC_COEFF_LERP
-   phase_elems *= 2;
-#endif
+   re->phases        = 1 << (tier->phase_bits + tier->subphase_bits);
+   re->subphase_bits = tier->subphase_bits;
+   re->subphase_mask = (1 << tier->subphase_bits) - 1;
+   re->subphase_mod  = 1.0f / (1 << tier->subphase_bits);
+
+   phase_elems  = (1 << tier->phase_bits) * re->taps;
+   if (tier->coeff_lerp)
+      phase_elems *= 2;
    elems        = phase_elems + 4 * re->taps;
 
    re->main_buffer = (float*)memalign_alloc(128, sizeof(float) * elems);
    if (!re->main_buffer)
       goto error;
 
+   memset(re->main_buffer, 0, sizeof(float) * elems);
+
    re->phase_table = re->main_buffer;
    re->buffer_l    = re->main_buffer + phase_elems;
    re->buffer_r    = re->buffer_l + 2 * re->taps;
 
-   init_sinc_table(re, cutoff, re->phase_table,
-         1 << PHASE_BITS, re->taps, SINC_COEFF_LERP);
-
-#if defined(__ARM_NEON__) && !defined(VITA)
-   process_sinc_func = mask & RESAMPLER_SIMD_NEON 
-      ? process_sinc_neon : process_sinc_C;
-#endif
+   init_sinc_table(tier, cutoff, re->phase_table,
+         1 << tier->phase_bits, re->taps, tier->coeff_lerp);
 
    return re;
 
@@ -0,0 +1,231 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Runs each .dsp preset given on the command line over the same
+ * ten seconds of audio, in chunks the size the audio driver uses:
+ * with plain C kernels, with the SIMD kernels the CPU supports,
+ * through the version 1 process callbacks only, and with the chain
+ * on a worker thread. The C, SIMD and process outputs are compared,
+ * as they should only differ by rounding and a fixed latency.
+ *
+ * Usage: dsp-bench ../audio_filters/ *.dsp */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <boolean.h>
+#include <features/features_cpu.h>
+#include <retro_miscellaneous.h>
+
+#include "../audio_dsp_filter.h"
+
+#define BENCH_RATE   48000
+#define BENCH_FRAMES (10 * BENCH_RATE)
+#define BENCH_CHUNK  1024
+
+/* Largest latency of the block path searched for, in frames. */
+#define BENCH_MAX_LATENCY 8192
+/* Frames compared to find that latency. */
+#define BENCH_ALIGN_FRAMES 4096
+
+/* Read by audio_dsp_filter.c, built with DSP_BENCH. */
+bool dsp_bench_use_block = true;
+
+static float bench_max_diff(const float *a, const float *b, unsigned frames)
+{
+   unsigned i;
+   float diff = 0.0f;
+
+   for (i = 0; i < frames * 2; i++)
+   {
+      float d = fabsf(a[i] - b[i]);
+      if (d > diff)
+         diff = d;
+   }
+
+   return diff;
+}
+
+/* The block path of a filter may add latency the process callback
+ * doesn't have. Returns the offset into @block at which it lines
+ * up best with the start of @process. */
+static unsigned bench_find_latency(const float *block, unsigned block_frames,
+      const float *process, unsigned process_frames)
+{
+   unsigned d;
+   unsigned best      = 0;
+   float best_diff    = -1.0f;
+   unsigned frames    = MIN(process_frames, BENCH_ALIGN_FRAMES);
+
+   for (d = 0; d <= BENCH_MAX_LATENCY && d + frames <= block_frames; d++)
+   {
+      float diff = bench_max_diff(block + 2 * d, process, frames);
+      if (best_diff < 0.0f || diff < best_diff)
+      {
+         best      = d;
+         best_diff = diff;
+      }
+   }
+
+   return best;
+}
+
+static void bench_gen_signal(float *out, unsigned frames)
+{
+   unsigned i;
+   uint32_t seed = 1;
+
+   for (i = 0; i < frames; i++)
+   {
+      double t = (double)i / BENCH_RATE;
+      float noise;
+
+      seed  = seed * 1664525 + 1013904223;
+      noise = (float)(seed >> 8) / (1 << 24) - 0.5f;
+
+      out[2 * i + 0] = 0.3f * sin(2.0 * M_PI * 440.0 * t) + 0.1f * noise;
+      out[2 * i + 1] = 0.3f * sin(2.0 * M_PI * 3000.0 * t) - 0.1f * noise;
+   }
+}
+
+/* Returns the time per frame in ns, or a negative value
+ * on failure. @out receives up to BENCH_FRAMES frames. */
+static double bench_run(const char *preset, const float *signal,
+      float *out, unsigned *out_frames, bool threaded)
+{
+   unsigned i;
+   retro_time_t start, total = 0;
+   float *chunk             = (float*)malloc(BENCH_CHUNK * 2 * sizeof(float));
+   rarch_dsp_filter_t *dsp  = rarch_dsp_filter_new(preset,
+         BENCH_RATE, threaded);
+
+   *out_frames = 0;
+
+   if (!dsp || !chunk)
+   {
+      rarch_dsp_filter_free(dsp);
+      free(chunk);
+      return -1.0;
+   }
+
+   for (i = 0; i + BENCH_CHUNK <= BENCH_FRAMES; i += BENCH_CHUNK)
+   {
+      struct rarch_dsp_data data = {0};
+      unsigned frames;
+
+      memcpy(chunk, signal + 2 * i, BENCH_CHUNK * 2 * sizeof(float));
+      data.input        = chunk;
+      data.input_frames = BENCH_CHUNK;
+
+      start = cpu_features_get_time_usec();
+      rarch_dsp_filter_process(dsp, &data);
+      total += cpu_features_get_time_usec() - start;
+
+      frames = MIN(data.output_frames, BENCH_FRAMES - *out_frames);
+      memcpy(out + 2 * *out_frames, data.output,
+            frames * 2 * sizeof(float));
+      *out_frames += frames;
+   }
+
+   rarch_dsp_filter_free(dsp);
+   free(chunk);
+   return total * 1000.0 / BENCH_FRAMES;
+}
+
+int main(int argc, char *argv[])
+{
+   int i;
+   bool ok           = true;
+   uint64_t simd     = cpu_features_get();
+   float *signal     = (float*)malloc(BENCH_FRAMES * 2 * sizeof(float));
+   float *out_c      = (float*)malloc(BENCH_FRAMES * 2 * sizeof(float));
+   float *out_simd   = (float*)malloc(BENCH_FRAMES * 2 * sizeof(float));
+   float *out_thread = (float*)malloc(BENCH_FRAMES * 2 * sizeof(float));
+   float *out_proc   = (float*)malloc(BENCH_FRAMES * 2 * sizeof(float));
+
+   if (argc < 2)
+   {
+      fprintf(stderr, "Usage: %s preset.dsp...\n", argv[0]);
+      return 1;
+   }
+
+   if (!signal || !out_c || !out_simd || !out_thread || !out_proc)
+      return 1;
+
+   bench_gen_signal(signal, BENCH_FRAMES);
+
+   printf("%-24s %10s %10s %10s %10s %10s %10s %8s\n", "preset",
+         "C ns/f", "SIMD ns/f", "proc ns/f", "thread",
+         "C diff", "proc diff", "latency");
+
+   for (i = 1; i < argc; i++)
+   {
+      unsigned frames_c, frames_simd, frames_thread, frames_proc;
+      unsigned latency = 0;
+      double c, vec, proc, thread;
+      float diff       = 0.0f;
+      float proc_diff  = 0.0f;
+      const char *name = strrchr(argv[i], '/');
+
+      name = name ? name + 1 : argv[i];
+
+      rarch_dsp_filter_init(0);
+      c               = bench_run(argv[i], signal, out_c, &frames_c, false);
+      rarch_dsp_filter_init(simd);
+      vec             = bench_run(argv[i], signal, out_simd, &frames_simd, false);
+      thread          = bench_run(argv[i], signal, out_thread, &frames_thread, true);
+      dsp_bench_use_block = false;
+      proc            = bench_run(argv[i], signal, out_proc, &frames_proc, false);
+      dsp_bench_use_block = true;
+
+      if (c < 0.0 || vec < 0.0 || proc < 0.0 || thread < 0.0)
+      {
+         printf("%-24s failed to load\n", name);
+         ok = false;
+         continue;
+      }
+
+      diff      = bench_max_diff(out_c, out_simd, MIN(frames_c, frames_simd));
+      latency   = bench_find_latency(out_simd, frames_simd,
+            out_proc, frames_proc);
+      proc_diff = bench_max_diff(out_simd + 2 * latency, out_proc,
+            MIN(frames_simd - latency, frames_proc));
+
+      printf("%-24s %10.2f %10.2f %10.2f %10.2f %10.6f %10.6f %8u\n",
+            name, c, vec, proc, thread, diff, proc_diff, latency);
+
+      /* The threaded run is one chunk behind. */
+      if (frames_c != frames_simd
+            || frames_thread + BENCH_CHUNK < frames_simd
+            || memcmp(out_thread, out_simd, frames_thread * 2 * sizeof(float))
+            || frames_proc + latency < frames_simd - BENCH_MAX_LATENCY
+            || diff > 1e-3f
+            || proc_diff > 1e-3f)
+      {
+         printf("%-24s mismatch: %u, %u, %u and %u frames\n",
+               name, frames_c, frames_simd, frames_proc, frames_thread);
+         ok = false;
+      }
+   }
+
+   free(signal);
+   free(out_c);
+   free(out_simd);
+   free(out_thread);
+   free(out_proc);
+   return ok ? 0 : 1;
+}
@@ -15,13 +15,149 @@
 
 // Resampler that reads raw S16NE/stereo from stdin and outputs to stdout in S16NE/stereo.
 // Used for testing and performance benchmarking.
+//
+// With --bench, runs a sine through every sinc quality tier with every
+// kernel the CPU supports, and reports ns per output frame and SNR.
 
 #include "../audio_resampler_driver.h"
-#include "../audio_utils.h"
+#include <conversion/s16_to_float.h>
+#include <conversion/float_to_s16.h>
+#include <features/features_cpu.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
 #include <time.h>
 
+#define BENCH_FRAMES      (1 << 18)
+#define BENCH_SKIP_FRAMES 4096
+
+struct bench_isa
+{
+   const char *ident;
+   resampler_simd_mask_t mask;
+};
+
+static const struct bench_isa bench_isas[] = {
+   { "C",       0 },
+   { "SSE",     RESAMPLER_SIMD_SSE },
+   { "AVX",     RESAMPLER_SIMD_SSE | RESAMPLER_SIMD_AVX },
+   { "AVX/FMA", RESAMPLER_SIMD_SSE | RESAMPLER_SIMD_AVX | RESAMPLER_SIMD_FMA3 },
+   { "NEON",    RESAMPLER_SIMD_NEON },
+};
+
+static const char *bench_tiers[] = {
+   "lowest", "lower", "normal", "higher", "highest"
+};
+
+/* Least-squares fit of a * cos + b * sin at the known frequency.
+ * Whatever the fit doesn't explain is counted as noise, which also
+ * makes the result independent of the filter delay and gain. */
+static double bench_snr(const float *out, size_t frames, double omega)
+{
+   size_t i;
+   double a, b, det;
+   double cc = 0.0, ss = 0.0, cs = 0.0, xc = 0.0, xs = 0.0;
+   double signal = 0.0, noise = 0.0;
+
+   for (i = 0; i < frames; i++)
+   {
+      double c = cos(omega * i);
+      double s = sin(omega * i);
+      cc += c * c;
+      ss += s * s;
+      cs += c * s;
+      xc += out[2 * i] * c;
+      xs += out[2 * i] * s;
+   }
+
+   det = cc * ss - cs * cs;
+   a   = (xc * ss - xs * cs) / det;
+   b   = (xs * cc - xc * cs) / det;
+
+   for (i = 0; i < frames; i++)
+   {
+      double fit = a * cos(omega * i) + b * sin(omega * i);
+      double err = out[2 * i] - fit;
+      signal    += fit * fit;
+      noise     += err * err;
+   }
+
+   return 10.0 * log10(signal / noise);
+}
+
+static void bench_run(double in_rate, double out_rate)
+{
+   unsigned t, k;
+   size_t i;
+   double ratio             = out_rate / in_rate;
+   /* A tone well inside the passband of every tier. */
+   double freq              = in_rate * 0.1;
+   double omega_in          = 2.0 * M_PI * freq / in_rate;
+   double omega_out         = 2.0 * M_PI * freq / out_rate;
+   size_t max_out           = (size_t)(BENCH_FRAMES * ratio) + 1024;
+   resampler_simd_mask_t cpu = cpu_features_get();
+   float *input             = (float*)malloc(BENCH_FRAMES * 2 * sizeof(float));
+   float *output            = (float*)malloc(max_out * 2 * sizeof(float));
+
+   if (!input || !output)
+      goto end;
+
+   for (i = 0; i < BENCH_FRAMES; i++)
+      input[2 * i + 0] = input[2 * i + 1] = 0.5 * cos(omega_in * i);
+
+   printf("%.1f Hz -> %.1f Hz, %.1f Hz tone\n", in_rate, out_rate, freq);
+
+   for (t = 0; t < sizeof(bench_tiers) / sizeof(bench_tiers[0]); t++)
+   {
+      for (k = 0; k < sizeof(bench_isas) / sizeof(bench_isas[0]); k++)
+      {
+         retro_time_t start, total;
+         size_t in_pos   = 0;
+         size_t out_pos  = 0;
+         void *re        = NULL;
+
+         if ((bench_isas[k].mask & cpu) != bench_isas[k].mask)
+            continue;
+
+         re = sinc_resampler.init(NULL, ratio,
+               (enum resampler_quality)(RESAMPLER_QUALITY_LOWEST + t),
+               bench_isas[k].mask);
+         if (!re)
+            continue;
+
+         start = cpu_features_get_time_usec();
+         while (in_pos < BENCH_FRAMES)
+         {
+            struct resampler_data data;
+
+            data.data_in      = input + 2 * in_pos;
+            data.data_out     = output + 2 * out_pos;
+            data.input_frames = 1024;
+            data.ratio        = ratio;
+
+            sinc_resampler.process(re, &data);
+
+            in_pos  += data.input_frames;
+            out_pos += data.output_frames;
+         }
+         total = cpu_features_get_time_usec() - start;
+
+         sinc_resampler.free(re);
+
+         printf("sinc %-8s %-8s %8.1f ns/frame %7.1f dB\n",
+               bench_tiers[t], bench_isas[k].ident,
+               1000.0 * total / out_pos,
+               bench_snr(output + 2 * BENCH_SKIP_FRAMES,
+                  out_pos - BENCH_SKIP_FRAMES, omega_out));
+      }
+   }
+
+end:
+   free(input);
+   free(output);
+}
+
 #ifndef RESAMPLER_IDENT
 #define RESAMPLER_IDENT "sinc"
 #endif
@@ -41,9 +177,26 @@ int main(int argc, char *argv[])
 
    srand(time(NULL));
 
+   if (argc > 1 && !strcmp(argv[1], "--bench"))
+   {
+      if (argc == 4)
+         bench_run(strtod(argv[2], NULL), strtod(argv[3], NULL));
+      else
+      {
+         /* The resampler steps through its phase table in fixed point,
+          * so a tone only comes out at exactly the expected frequency
+          * if in-rate / out-rate is a dyadic fraction. 44062.5 Hz is
+          * 235/256 of 48 kHz. */
+         bench_run(44062.5, 48000.0);
+         bench_run(48000.0, 32000.0);
+      }
+      return 0;
+   }
+
    if (argc < 3 || argc > 4)
    {
       fprintf(stderr, "Usage: %s <in-rate> <out-rate> [ratio deviation] (max ratio: 8.0)\n", argv[0]);
+      fprintf(stderr, "       %s --bench [<in-rate> <out-rate>]\n", argv[0]);
       return 1;
    }
    else if (argc == 4)
@@ -62,7 +215,8 @@ int main(int argc, char *argv[])
       return 1;
    }
 
-   if (!rarch_resampler_realloc(&re, &resampler, RESAMPLER_IDENT, out_rate / in_rate))
+   if (!rarch_resampler_realloc(&re, &resampler, RESAMPLER_IDENT, out_rate / in_rate,
+            RESAMPLER_QUALITY_DONTCARE))
    {
       fprintf(stderr, "Failed to allocate resampler ...\n");
       return 1;
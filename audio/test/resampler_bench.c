@@ -0,0 +1,215 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2016 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Resamples ten seconds of audio at common core rates to 48 kHz with
+ * the sinc, CC and polyphase resamplers, in chunks of one video frame,
+ * once at the nominal ratio and once with the ratio wobbling the way
+ * audio rate control moves it. At the nominal ratio, the polyphase
+ * output is compared against sinc, which uses the same filter.
+ *
+ * Usage: resampler-bench [quality] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <boolean.h>
+#include <features/features_cpu.h>
+#include <retro_miscellaneous.h>
+#include <string/stdstring.h>
+
+#include "../audio_resampler_driver.h"
+
+#define BENCH_OUT_RATE   48000
+#define BENCH_SECONDS    10
+#define BENCH_FPS        60
+#define BENCH_RUNS       3
+/* Default audio_rate_control_delta. */
+#define BENCH_RATE_DELTA 0.005
+/* Output frames compared, from the start. */
+#define BENCH_COMPARE    (BENCH_OUT_RATE / 2)
+
+static void bench_gen_signal(float *out, unsigned frames, unsigned rate)
+{
+   unsigned i;
+   uint32_t seed = 1;
+
+   for (i = 0; i < frames; i++)
+   {
+      double t = (double)i / rate;
+      float noise;
+
+      seed  = seed * 1664525 + 1013904223;
+      noise = (float)(seed >> 8) / (1 << 24) - 0.5f;
+
+      out[2 * i + 0] = 0.3f * sin(2.0 * M_PI * 440.0 * t) + 0.1f * noise;
+      out[2 * i + 1] = 0.3f * sin(2.0 * M_PI * 3000.0 * t) - 0.1f * noise;
+   }
+}
+
+/* Returns the time per output frame in ns, or a negative value
+ * on failure. */
+static double bench_run_once(const char *ident, unsigned quality,
+      unsigned in_rate, const float *signal, unsigned frames,
+      float *out, size_t *out_frames, bool wobble)
+{
+   unsigned i;
+   retro_time_t total                 = 0;
+   unsigned chunk                     = in_rate / BENCH_FPS;
+   double ratio                       = (double)BENCH_OUT_RATE / in_rate;
+   const rarch_resampler_t *resampler = NULL;
+   void *re                           = NULL;
+
+   *out_frames = 0;
+
+   if (!rarch_resampler_realloc(&re, &resampler, ident, ratio,
+            (enum resampler_quality)quality))
+      return -1.0;
+
+   for (i = 0; i + chunk <= frames; i += chunk)
+   {
+      retro_time_t start;
+      struct resampler_data data;
+
+      data.data_in      = signal + i * 2;
+      data.data_out     = out + *out_frames * 2;
+      data.input_frames = chunk;
+      data.ratio        = ratio;
+
+      /* Rate control swings over a few seconds. */
+      if (wobble)
+         data.ratio *= 1.0 + BENCH_RATE_DELTA
+            * sin(2.0 * M_PI * i / (4.0 * in_rate));
+
+      start        = cpu_features_get_time_usec();
+      rarch_resampler_process(resampler, re, &data);
+      total       += cpu_features_get_time_usec() - start;
+
+      *out_frames += data.output_frames;
+   }
+
+   rarch_resampler_freep(&resampler, &re);
+
+   return *out_frames ? total * 1000.0 / *out_frames : 0.0;
+}
+
+/* Best of a few runs, as single runs are noisy. */
+static double bench_run(const char *ident, unsigned quality,
+      unsigned in_rate, const float *signal, unsigned frames,
+      float *out, size_t *out_frames, bool wobble)
+{
+   unsigned i;
+   double best = -1.0;
+
+   for (i = 0; i < BENCH_RUNS; i++)
+   {
+      double ns = bench_run_once(ident, quality, in_rate,
+            signal, frames, out, out_frames, wobble);
+
+      if (ns < 0.0)
+         return ns;
+      if (best < 0.0 || ns < best)
+         best = ns;
+   }
+
+   return best;
+}
+
+/* Difference relative to the signal, in dB. */
+static double bench_compare(const float *a, const float *b, size_t samples)
+{
+   size_t i;
+   double signal = 0.0, noise = 0.0;
+
+   for (i = 0; i < samples; i++)
+   {
+      double diff = a[i] - b[i];
+      signal     += a[i] * a[i];
+      noise      += diff * diff;
+   }
+
+   if (noise <= 0.0)
+      return -INFINITY;
+   return 10.0 * log10(noise / signal);
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i, j;
+   static const unsigned rates[]  = { 32040, 32000, 44100, 53693 };
+   static const char *idents[]    = { "sinc", "CC", "polyphase" };
+   unsigned quality               = RESAMPLER_QUALITY_NORMAL;
+   unsigned max_rate              = 53693;
+   unsigned frames                = max_rate * BENCH_SECONDS;
+   size_t max_out                 = BENCH_OUT_RATE * (BENCH_SECONDS + 1) * 2;
+   float *signal                  = (float*)malloc(frames * 2 * sizeof(float));
+   float *out                     = (float*)malloc(max_out * sizeof(float));
+   float *out_sinc                = (float*)malloc(max_out * sizeof(float));
+   float *out_wobble              = (float*)malloc(max_out * sizeof(float));
+   int ret                        = 0;
+
+   if (argc > 1)
+      quality = strtoul(argv[1], NULL, 0);
+
+   if (!signal || !out || !out_sinc || !out_wobble)
+      return 1;
+
+   printf("%-10s %6s %12s %12s %10s\n",
+         "resampler", "rate", "fixed ns/f", "wobble ns/f", "vs sinc");
+
+   for (i = 0; i < ARRAY_SIZE(rates); i++)
+   {
+      unsigned in_frames = rates[i] * BENCH_SECONDS;
+
+      bench_gen_signal(signal, in_frames, rates[i]);
+
+      for (j = 0; j < ARRAY_SIZE(idents); j++)
+      {
+         size_t out_frames, wobble_frames;
+         double fixed_ns, wobble_ns;
+         bool polyphase = string_is_equal(idents[j], "polyphase");
+         float *dst     = (j == 0) ? out_sinc : out;
+
+         fixed_ns  = bench_run(idents[j], quality, rates[i],
+               signal, in_frames, dst, &out_frames, false);
+
+         if (fixed_ns < 0.0)
+         {
+            fprintf(stderr, "Failed to create %s resampler.\n", idents[j]);
+            ret = 1;
+            continue;
+         }
+
+         wobble_ns = bench_run(idents[j], quality, rates[i],
+               signal, in_frames, out_wobble, &wobble_frames, true);
+
+         printf("%-10s %6u %12.1f %12.1f", idents[j], rates[i],
+               fixed_ns, wobble_ns);
+
+         if (polyphase)
+            printf(" %7.1f dB", bench_compare(out_sinc, dst,
+                     BENCH_COMPARE * 2));
+
+         printf("\n");
+      }
+   }
+
+   free(signal);
+   free(out);
+   free(out_sinc);
+   free(out_wobble);
+   return ret;
+}
@@ -26,7 +26,8 @@
 #include <retro_miscellaneous.h>
 
 #include "../audio_resampler_driver.h"
-#include "../audio_utils.h"
+#include <conversion/s16_to_float.h>
+#include <conversion/float_to_s16.h>
 
 #ifndef RESAMPLER_IDENT
 #define RESAMPLER_IDENT "sinc"
@@ -302,7 +303,8 @@ int main(int argc, char *argv[])
    retro_assert(input);
    retro_assert(output);
 
-   if (!rarch_resampler_realloc(&re, &resampler, RESAMPLER_IDENT, ratio))
+   if (!rarch_resampler_realloc(&re, &resampler, RESAMPLER_IDENT, ratio,
+            RESAMPLER_QUALITY_DONTCARE))
    {
       free(input);
       free(output);
@@ -331,7 +333,7 @@ int main(int argc, char *argv[])
 
       /* We generate 2 seconds worth of audio, however, 
        * only the last second is considered so phase has stabilized. */
-      max_freq = min(in_rate, out_rate) / 2;
+      max_freq = MIN(in_rate, out_rate) / 2;
       if (freq > max_freq)
          continue;
 
@@ -0,0 +1,41 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Frontend functions the resampler driver and config code link
+ * against, which the tests never call. */
+
+#include <string.h>
+
+#include <compat/strl.h>
+#include <file/file_path.h>
+
+#include "../../list_special.h"
+
+void fill_pathname_expand_special(char *out_path,
+      const char *in_path, size_t size)
+{
+   strlcpy(out_path, in_path, size);
+}
+
+void fill_pathname_abbreviate_special(char *out_path,
+      const char *in_path, size_t size)
+{
+   strlcpy(out_path, in_path, size);
+}
+
+const char *char_list_new_special(enum string_list_type type, void *data)
+{
+   return NULL;
+}
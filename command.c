@@ -65,6 +65,10 @@
 #include "driver.h"
 #include "frontend/frontend_driver.h"
 #include "audio/audio_driver.h"
+#include "audio/audio_telemetry.h"
+#ifdef HAVE_THREADS
+#include "gfx/video_thread_wrapper.h"
+#endif
 #include "record/record_driver.h"
 #include "file_path_special.h"
 #include "autosave.h"
@@ -123,7 +127,6 @@ static struct sockaddr_storage lastcmd_net_source;
 static socklen_t lastcmd_net_source_len;
 #endif
 
-#ifdef HAVE_CHEEVOS
 #if defined(HAVE_STDIN_CMD) || defined(HAVE_NETWORK_CMD) && defined(HAVE_NETPLAY)
 static bool command_reply(const char * data, size_t len)
 {
@@ -145,7 +148,6 @@ static bool command_reply(const char * data, size_t len)
    return false;
 }
 #endif
-#endif
 
 struct cmd_map
 {
@@ -255,8 +257,110 @@ static bool command_write_ram(const char *arg)
 }
 #endif
 
+#if defined(HAVE_STDIN_CMD) || defined(HAVE_NETWORK_CMD) && defined(HAVE_NETPLAY)
+/* Replies with the audio telemetry since the last
+ * GET_AUDIO_STATS, one "<name> <values>" line each. */
+static bool command_get_audio_stats(const char *arg)
+{
+   char reply[1024];
+   size_t len;
+   struct audio_telemetry_stats stats;
+
+   (void)arg;
+
+   audio_telemetry_poll(AUDIO_TELEMETRY_WINDOW_COMMAND, &stats, true);
+   audio_telemetry_format(&stats, -1, reply, sizeof(reply) - 1);
+
+   len          = strlen(reply);
+   reply[len++] = '\n';
+
+   return command_reply(reply, len);
+}
+
+#ifdef HAVE_THREADS
+/* Replies with the frame handoff statistics of threaded video since
+ * the video driver was started, in the format of GET_AUDIO_STATS.
+ * Latency bucket i counts frames shown within 2^i ms of being
+ * pushed, the last one all slower frames. */
+static bool command_get_video_stats(const char *arg)
+{
+   char reply[512];
+   unsigned i;
+   struct video_thread_stats stats;
+
+   (void)arg;
+
+   if (!video_thread_get_stats(&stats))
+      return command_reply("video_thread_inactive\n", 22);
+
+   snprintf(reply, sizeof(reply),
+         "video_thread triple_buffer %u\n"
+         "video_frames pushed %u dropped %u superseded %u rendered %u\n"
+         "video_copies copied %u zero_copy %u\n"
+         "video_latency_ms",
+         stats.triple_buffer, stats.pushed, stats.dropped,
+         stats.superseded, stats.rendered, stats.copied, stats.zero_copy);
+
+   for (i = 0; i < VIDEO_THREAD_LATENCY_BUCKETS; i++)
+   {
+      char bucket[32];
+
+      snprintf(bucket, sizeof(bucket), " %s%u %u",
+            i < VIDEO_THREAD_LATENCY_BUCKETS - 1 ? "<" : ">=",
+            1u << (i < VIDEO_THREAD_LATENCY_BUCKETS - 1 ? i : i - 1),
+            stats.latency[i]);
+      strlcat(reply, bucket, sizeof(reply));
+   }
+   strlcat(reply, "\n", sizeof(reply));
+
+   return command_reply(reply, strlen(reply));
+}
+#endif
+
+#ifdef HAVE_NETPLAY
+/* Replies with the netplay rollback statistics since the last
+ * GET_NETPLAY_STATS, in the format of GET_AUDIO_STATS. Times are
+ * per second of the interval. */
+static bool command_get_netplay_stats(const char *arg)
+{
+   char reply[512];
+   double secs;
+   struct netplay_stats stats;
+
+   (void)arg;
+
+   if (!netplay_driver_ctl(RARCH_NETPLAY_CTL_GET_STATS, &stats))
+      return command_reply("netplay_inactive\n", 17);
+
+   secs = stats.usec ? stats.usec / 1000000.0 : 1.0;
+
+   snprintf(reply, sizeof(reply),
+         "netplay_frames %u replayed %u rollbacks %u stalls %u\n"
+         "netplay_replayed_per_sec %.1f max_depth %u\n"
+         "netplay_replay_usec_per_sec serialize %.0f unserialize %.0f run %.0f\n"
+         "netplay_input_delay %u rtt_usec %u\n",
+         stats.frames, stats.replayed, stats.rollbacks, stats.stalls,
+         stats.replayed / secs, stats.max_depth,
+         stats.serialize_usec / secs, stats.unserialize_usec / secs,
+         stats.run_usec / secs,
+         stats.input_delay, stats.rtt_usec);
+
+   return command_reply(reply, strlen(reply));
+}
+#endif
+#endif
+
 static const struct cmd_action_map action_map[] = {
    { "SET_SHADER", command_set_shader, "<shader path>" },
+#if defined(HAVE_STDIN_CMD) || defined(HAVE_NETWORK_CMD) && defined(HAVE_NETPLAY)
+   { "GET_AUDIO_STATS", command_get_audio_stats, "" },
+#ifdef HAVE_THREADS
+   { "GET_VIDEO_STATS", command_get_video_stats, "" },
+#endif
+#ifdef HAVE_NETPLAY
+   { "GET_NETPLAY_STATS", command_get_netplay_stats, "" },
+#endif
+#endif
 #ifdef HAVE_CHEEVOS
    { "READ_CORE_RAM", command_read_ram, "<address> <number of bytes>" },
    { "WRITE_CORE_RAM", command_write_ram, "<address> <byte1> <byte2> ..." },
@@ -329,11 +433,19 @@ static bool command_get_arg(const char *tok,
       if (str == tok)
       {
          const char *argument = str + strlen(action_map[i].str);
-         if (*argument != ' ')
+
+         /* Only commands without an argument description
+          * may be sent without an argument. */
+         if (*argument == '\0')
+         {
+            if (*action_map[i].arg_desc)
+               return false;
+         }
+         else if (*argument != ' ')
             return false;
 
          if (arg)
-            *arg = argument + 1;
+            *arg = *argument ? argument + 1 : argument;
 
          if (index)
             *index = i;
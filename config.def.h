@@ -452,6 +452,12 @@ static unsigned swap_interval = 1;
  */
 static const bool video_threaded = false;
 
+/* Hand frames to the video thread through three buffers instead
+ * of one. The core no longer waits for each frame to be rendered,
+ * only for refresh rate pacing, and while the menu texture is shown.
+ */
+static const bool video_threaded_triple_buffer = false;
+
 #if defined(HAVE_THREADS)
 #if defined(GEKKO) || defined(PSP) || defined(_3DS) || defined(_XBOX1)
 /* For single-core consoles right now it's better to have this be disabled. */
@@ -463,6 +469,10 @@ static const bool threaded_data_runloop_enable = true;
 static const bool threaded_data_runloop_enable = false;
 #endif
 
+/* Worker threads running background tasks when the threaded data
+ * runloop is enabled. 0 starts one per CPU core. */
+static const unsigned threaded_data_runloop_workers = 0;
+
 /* Set to true if HW render cores should get their private context. */
 static const bool video_shared_context = false;
 
@@ -632,6 +642,10 @@ static const bool gpu_screenshot = true;
 /* Screenshots named automatically. */
 static const bool auto_screenshot_filename = true;
 
+/* zlib compression level of PNG screenshots, 0 (none) to 9 (best).
+ * Higher levels are much slower for a few percent smaller files. */
+static const unsigned screenshot_compression_level = 6;
+
 /* Record post-shaded GPU output instead of raw game footage if available. */
 static const bool gpu_record = false;
 
@@ -708,6 +722,14 @@ static const float max_timing_skew = 0.05;
 /* Default audio volume in dB. (0.0 dB == unity gain). */
 static const float audio_volume = 0.0;
 
+/* Resampler quality tier, from 1 (lowest) to 5 (highest).
+ * 0 uses the default the resampler was built with. */
+static const unsigned audio_resampler_quality = 0;
+
+/* Runs the audio DSP filter chain on its own thread,
+ * at the cost of one more audio chunk of latency. */
+static const bool audio_dsp_thread = false;
+
 /* MISC */
 
 /* Enables displaying the current frames per second. */
@@ -721,9 +743,20 @@ static const bool rewind_enable = false;
  * 15-20MB per minute. Very game dependant. */
 static const unsigned rewind_buffer_size = 20 << 20; /* 20MiB */
 
+/* Once the rewind buffer is full, older frames are compressed
+ * again and kept in RAM up to this size, then spilled to a
+ * file in the savestate directory up to rewind_disk_size.
+ * 0 disables either tier. */
+static const unsigned rewind_compressed_size = 0;
+static const unsigned rewind_disk_size = 0;
+
 /* How many frames to rewind at a time. */
 static const unsigned rewind_granularity = 1;
 
+/* Number of worker threads used to compress rewind states.
+ * 0 compresses each state in one pass on the main thread. */
+static const unsigned rewind_threads = 0;
+
 /* Pause gameplay when gameplay loses focus. */
 #ifdef EMSCRIPTEN
 static const bool pause_nonactive = false;
@@ -739,6 +772,22 @@ static const unsigned autosave_interval = 0;
  * user 1 rather than user 2. */
 static const bool netplay_client_swap_input = true;
 
+/* Netplay compares savestate checksums every this many frames,
+ * and patches the client's state when they differ. 0 disables it.
+ * Clients use the host's value. */
+static const unsigned netplay_check_frames = 30;
+
+/* Netplay delays local input by this many frames, so it reaches
+ * the other side before it's needed there. With
+ * netplay_input_delay_auto, the delay follows the measured
+ * round-trip time and this is its upper bound. */
+static const unsigned netplay_input_delay_frames = 0;
+static const bool netplay_input_delay_auto = false;
+
+/* Netplay rolls back at most this many frames before waiting
+ * for input. 0 allows as many as netplay_delay_frames. */
+static const unsigned netplay_rollback_frames = 0;
+
 /* On save state load, block SRAM from being overwritten.
  * This could potentially lead to buggy games. */
 static const bool block_sram_overwrite = false;
@@ -771,6 +820,10 @@ static const uint16_t network_remote_base_port = 55400;
 /* Number of entries that will be kept in content history playlist file. */
 static const unsigned default_content_history_size = 100;
 
+/* Number of threads hashing files while scanning content.
+ * 0 reads and hashes one file at a time within the scan task. */
+static const unsigned database_scan_threads = 0;
+
 /* Show Menu start-up screen on boot. */
 static const bool default_menu_show_start_screen = true;
 
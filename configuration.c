@@ -703,6 +703,7 @@ static int populate_settings_bool(settings_t *settings, struct config_bool_setti
    SETTING_BOOL("video_smooth",                  &settings->video.smooth, true, video_smooth, false);
    SETTING_BOOL("video_force_aspect",            &settings->video.force_aspect, true, force_aspect, false);
    SETTING_BOOL("video_threaded",                &settings->video.threaded, true, video_threaded, false);
+   SETTING_BOOL("video_threaded_triple_buffer",  &settings->video.threaded_triple_buffer, true, video_threaded_triple_buffer, false);
    SETTING_BOOL("video_shared_context",          &settings->video.shared_context, true, video_shared_context, false);
    SETTING_BOOL("custom_bgm_enable",             &global->console.sound.system_bgm_enable, true, false, false);
    SETTING_BOOL("auto_screenshot_filename",      &settings->auto_screenshot_filename, true, auto_screenshot_filename, false);
@@ -782,6 +783,7 @@ static int populate_settings_bool(settings_t *settings, struct config_bool_setti
 #ifdef HAVE_NETPLAY
    SETTING_BOOL("netplay_spectator_mode_enable",&global->netplay.is_spectate, false, false /* TODO */, false);
    SETTING_BOOL("netplay_mode",                 &global->netplay.is_client, false, false /* TODO */, false);
+   SETTING_BOOL("netplay_input_delay_auto",     &global->netplay.input_delay_auto, true, netplay_input_delay_auto, false);
 #endif
    SETTING_BOOL("block_sram_overwrite",         &settings->block_sram_overwrite, true, block_sram_overwrite, false);
    SETTING_BOOL("savestate_auto_index",         &settings->savestate_auto_index, true, savestate_auto_index, false);
@@ -799,6 +801,7 @@ static int populate_settings_bool(settings_t *settings, struct config_bool_setti
    SETTING_BOOL("show_hidden_files",            &settings->show_hidden_files, true, show_hidden_files, false);
    SETTING_BOOL("input_autodetect_enable",      &settings->input.autodetect_enable, true, input_autodetect_enable, false);
    SETTING_BOOL("audio_rate_control",           &settings->audio.rate_control, true, rate_control, false);
+   SETTING_BOOL("audio_dsp_thread",             &settings->audio.dsp_thread, true, audio_dsp_thread, false);
 
    *out = 
       (struct config_bool_setting*) malloc(count *sizeof(struct config_bool_setting));
@@ -857,6 +860,7 @@ static int populate_settings_int(settings_t *settings, struct config_int_setting
    SETTING_INT("audio_latency",                &settings->audio.latency, false, 0 /* TODO */, false);
    SETTING_INT("audio_block_frames",           &settings->audio.block_frames, true, 0, false);
    SETTING_INT("rewind_granularity",           &settings->rewind_granularity, true, rewind_granularity, false);
+   SETTING_INT("rewind_threads",               &settings->rewind_threads, true, rewind_threads, false);
    SETTING_INT("autosave_interval",            &settings->autosave_interval,  true, autosave_interval, false);
    SETTING_INT("libretro_log_level",           &settings->libretro_log_level, true, libretro_log_level, false);
    SETTING_INT("keyboard_gamepad_mapping_type",&settings->input.keyboard_gamepad_mapping_type, true, 1, false);
@@ -897,11 +901,15 @@ static int populate_settings_int(settings_t *settings, struct config_int_setting
 #endif
 #endif
    SETTING_INT("audio_out_rate",               &settings->audio.out_rate, true, out_rate, false);
+   SETTING_INT("audio_resampler_quality",      &settings->audio.resampler_quality, true, audio_resampler_quality, false);
    SETTING_INT("custom_viewport_width",        &settings->video_viewport_custom.width, false, 0 /* TODO */, false);
    SETTING_INT("custom_viewport_height",       &settings->video_viewport_custom.height, false, 0 /* TODO */, false);
    SETTING_INT("custom_viewport_x",            (unsigned*)&settings->video_viewport_custom.x, false, 0 /* TODO */, false);
    SETTING_INT("custom_viewport_y",            (unsigned*)&settings->video_viewport_custom.y, false, 0 /* TODO */, false);
    SETTING_INT("content_history_size",         &settings->content_history_size,   true, default_content_history_size, false);
+   SETTING_INT("database_scan_threads",        &settings->database_scan_threads,  true, database_scan_threads, false);
+   SETTING_INT("threaded_data_runloop_workers", &settings->threaded_data_runloop_workers, true, threaded_data_runloop_workers, false);
+   SETTING_INT("screenshot_compression_level", &settings->screenshot_compression_level, true, screenshot_compression_level, false);
    SETTING_INT("video_hard_sync_frames",       &settings->video.hard_sync_frames, true, hard_sync_frames, false);
    SETTING_INT("video_frame_delay",            &settings->video.frame_delay,      true, frame_delay, false);
    SETTING_INT("video_max_swapchain_images",   &settings->video.max_swapchain_images, true, max_swapchain_images, false);
@@ -912,6 +920,9 @@ static int populate_settings_int(settings_t *settings, struct config_int_setting
 #ifdef HAVE_NETPLAY
    SETTING_INT("netplay_ip_port",              &global->netplay.port, false, 0 /* TODO */, false);
    SETTING_INT("netplay_delay_frames",         &global->netplay.sync_frames, false, 0 /* TODO */, false);
+   SETTING_INT("netplay_check_frames",         &global->netplay.check_frames, true, netplay_check_frames, false);
+   SETTING_INT("netplay_input_delay_frames",   &global->netplay.input_delay_frames, true, netplay_input_delay_frames, false);
+   SETTING_INT("netplay_rollback_frames",      &global->netplay.rollback_frames, true, netplay_rollback_frames, false);
 #endif
 #ifdef HAVE_LANGEXTRA
    SETTING_INT("user_language",                &settings->user_language, true, RETRO_LANGUAGE_ENGLISH, false);
@@ -1045,6 +1056,8 @@ static void config_set_defaults(void)
    audio_driver_set_volume_gain(db_to_gain(settings->audio.volume));
 
    settings->rewind_buffer_size                = rewind_buffer_size;
+   settings->rewind_compressed_size            = rewind_compressed_size;
+   settings->rewind_disk_size                  = rewind_disk_size;
 
 #ifdef HAVE_LAKKA
    settings->ssh_enable                        = path_file_exists(LAKKA_SSH_PATH);
@@ -1811,6 +1824,10 @@ static bool config_load_file(const char *path, bool set_defaults,
       int buffer_size = 0;
       if (config_get_int(conf, "rewind_buffer_size", &buffer_size))
          settings->rewind_buffer_size = buffer_size * UINT64_C(1000000);
+      if (config_get_int(conf, "rewind_compressed_size", &buffer_size))
+         settings->rewind_compressed_size = buffer_size * UINT64_C(1000000);
+      if (config_get_int(conf, "rewind_disk_size", &buffer_size))
+         settings->rewind_disk_size = buffer_size * UINT64_C(1000000);
    }
 
 
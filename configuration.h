@@ -81,6 +81,7 @@ typedef struct settings
 
       float refresh_rate;
       bool threaded;
+      bool threaded_triple_buffer;
 
 
       float font_size;
@@ -229,6 +230,7 @@ typedef struct settings
       char driver[32];
       char resampler[32];
       char device[PATH_MAX_LENGTH];
+      unsigned resampler_quality;
       bool enable;
       bool mute_enable;
       unsigned out_rate;
@@ -238,6 +240,7 @@ typedef struct settings
 
 
       bool rate_control;
+      bool dsp_thread;
       float rate_control_delta;
       float max_timing_skew;
       float volume; /* dB scale. */
@@ -390,6 +393,9 @@ typedef struct settings
    } directory;
 
    unsigned content_history_size;
+   unsigned database_scan_threads;
+   unsigned threaded_data_runloop_workers;
+   unsigned screenshot_compression_level;
 
    unsigned libretro_log_level;
 
@@ -398,7 +404,10 @@ typedef struct settings
    bool history_list_enable;
    bool rewind_enable;
    size_t rewind_buffer_size;
+   size_t rewind_compressed_size;
+   size_t rewind_disk_size;
    unsigned rewind_granularity;
+   unsigned rewind_threads;
 
    float slowmotion_ratio;
    float fastforward_ratio;
@@ -43,7 +43,7 @@ extern "C" {
 #endif
 
 #include <rthreads/rthreads.h>
-#include <queues/fifo_queue.h>
+#include <queues/spsc_fifo.h>
 
 #include <libretro.h>
 #ifdef RARCH_INTERNAL
@@ -125,10 +125,14 @@ static uint64_t frame_cnt;
 static uint64_t audio_frames;
 static double pts_bias;
 
-/* Threaded FIFOs. */
+/* Threaded FIFOs.
+ * The decode thread writes them and retro_run() reads them. fifo_lock
+ * only covers the waiting and the timestamps; the frames themselves
+ * are copied in and out without holding it. The decode thread may
+ * clear them while the main thread is waiting for it. */
 static volatile bool decode_thread_dead;
-static fifo_buffer_t *video_decode_fifo;
-static fifo_buffer_t *audio_decode_fifo;
+static spsc_fifo_t *video_decode_fifo;
+static spsc_fifo_t *audio_decode_fifo;
 static scond_t *fifo_cond;
 static scond_t *fifo_decode_cond;
 static slock_t *fifo_lock;
@@ -415,9 +419,9 @@ static void seek_frame(int seek_frames)
    audio_frames = frame_cnt * media.sample_rate / media.interpolate_fps;
 
    if (video_decode_fifo)
-      fifo_clear(video_decode_fifo);
+      spsc_fifo_clear(video_decode_fifo);
    if (audio_decode_fifo)
-      fifo_clear(audio_decode_fifo);
+      spsc_fifo_clear(audio_decode_fifo);
    scond_signal(fifo_decode_cond);
 
    while (!decode_thread_dead && do_seek)
@@ -553,6 +557,7 @@ void CORE_PREFIX(retro_run)(void)
    if (audio_streams_num > 0)
    {
       /* Audio */
+      bool read_audio;
       double reading_pts;
       double expected_pts;
       double old_pts_bias;
@@ -563,7 +568,7 @@ void CORE_PREFIX(retro_run)(void)
       to_read_bytes = to_read_frames * sizeof(int16_t) * 2;
 
       slock_lock(fifo_lock);
-      while (!decode_thread_dead && fifo_read_avail(audio_decode_fifo) < to_read_bytes)
+      while (!decode_thread_dead && spsc_fifo_read_avail(audio_decode_fifo) < to_read_bytes)
       {
          main_sleeping = true;
          scond_signal(fifo_decode_cond);
@@ -572,7 +577,7 @@ void CORE_PREFIX(retro_run)(void)
       }
 
       reading_pts  = decode_last_audio_time -
-         (double)fifo_read_avail(audio_decode_fifo) / (media.sample_rate * sizeof(int16_t) * 2);
+         (double)spsc_fifo_read_avail(audio_decode_fifo) / (media.sample_rate * sizeof(int16_t) * 2);
       expected_pts = (double)audio_frames / media.sample_rate;
       old_pts_bias = pts_bias;
       pts_bias     = reading_pts - expected_pts;
@@ -584,10 +589,14 @@ void CORE_PREFIX(retro_run)(void)
          frames[1].pts = 0.0;
       }
 
-      if (!decode_thread_dead)
-         fifo_read(audio_decode_fifo, audio_buffer, to_read_bytes);
-      scond_signal(fifo_decode_cond);
+      read_audio = !decode_thread_dead;
+      slock_unlock(fifo_lock);
+
+      if (read_audio)
+         spsc_fifo_read(audio_decode_fifo, audio_buffer, to_read_bytes);
 
+      slock_lock(fifo_lock);
+      scond_signal(fifo_decode_cond);
       slock_unlock(fifo_lock);
       audio_frames += to_read_frames;
    }
@@ -608,13 +617,14 @@ void CORE_PREFIX(retro_run)(void)
 
       while (!decode_thread_dead && min_pts > frames[1].pts)
       {
+         bool read_frame;
          size_t to_read_frame_bytes;
          int64_t pts = 0;
 
          slock_lock(fifo_lock);
          to_read_frame_bytes = media.width * media.height * sizeof(uint32_t) + sizeof(int64_t);
 
-         while (!decode_thread_dead && fifo_read_avail(video_decode_fifo) < to_read_frame_bytes)
+         while (!decode_thread_dead && spsc_fifo_read_avail(video_decode_fifo) < to_read_frame_bytes)
          {
             main_sleeping = true;
             scond_signal(fifo_decode_cond);
@@ -622,10 +632,13 @@ void CORE_PREFIX(retro_run)(void)
             main_sleeping = false;
          }
 
-         if (!decode_thread_dead)
+         read_frame = !decode_thread_dead;
+         slock_unlock(fifo_lock);
+
+         if (read_frame)
          {
             uint32_t *data = video_frame_temp_buffer;
-            fifo_read(video_decode_fifo, &pts, sizeof(int64_t));
+            spsc_fifo_read(video_decode_fifo, &pts, sizeof(int64_t));
 #if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES)
             if (use_gl)
             {
@@ -639,7 +652,7 @@ void CORE_PREFIX(retro_run)(void)
 #endif
 #endif
 
-               fifo_read(video_decode_fifo, data, media.width * media.height * sizeof(uint32_t));
+               spsc_fifo_read(video_decode_fifo, data, media.width * media.height * sizeof(uint32_t));
 
 #ifndef HAVE_OPENGLES
                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
@@ -660,11 +673,12 @@ void CORE_PREFIX(retro_run)(void)
             else
 #endif
             {
-               fifo_read(video_decode_fifo, data, media.width * media.height * sizeof(uint32_t));
+               spsc_fifo_read(video_decode_fifo, data, media.width * media.height * sizeof(uint32_t));
                dupe = false;
             }
          }
 
+         slock_lock(fifo_lock);
          scond_signal(fifo_decode_cond);
          slock_unlock(fifo_lock);
 
@@ -1025,6 +1039,7 @@ static int16_t *decode_audio(AVCodecContext *ctx, AVPacket *pkt,
    for (;;)
    {
       int64_t pts;
+      bool write_audio;
       size_t required_buffer;
       int ret = avcodec_decode_audio4(ctx, frame, &got_ptr, &pkt_tmp);
 
@@ -1053,23 +1068,32 @@ static int16_t *decode_audio(AVCodecContext *ctx, AVPacket *pkt,
       pts = av_frame_get_best_effort_timestamp(frame);
       slock_lock(fifo_lock);
 
-      while (!decode_thread_dead && fifo_write_avail(audio_decode_fifo) < required_buffer)
+      while (!decode_thread_dead && spsc_fifo_write_avail(audio_decode_fifo) < required_buffer)
       {
          if (!main_sleeping)
             scond_wait(fifo_decode_cond, fifo_lock);
          else
          {
             log_cb(RETRO_LOG_ERROR, "Thread: Audio deadlock detected ...\n");
-            fifo_clear(audio_decode_fifo);
+            spsc_fifo_clear(audio_decode_fifo);
             break;
          }
       }
 
+      write_audio = !decode_thread_dead;
+      slock_unlock(fifo_lock);
+
+      /* Only committed together with the timestamp,
+       * which retro_run() uses to compute the PTS bias. */
+      if (write_audio)
+         spsc_fifo_write_at(audio_decode_fifo, 0, buffer, required_buffer);
+
+      slock_lock(fifo_lock);
       decode_last_audio_time = pts * av_q2d(
             fctx->streams[audio_streams[audio_streams_ptr]]->time_base);
 
-      if (!decode_thread_dead)
-         fifo_write(audio_decode_fifo, buffer, required_buffer);
+      if (write_audio)
+         spsc_fifo_write_commit(audio_decode_fifo, required_buffer);
 
       scond_signal(fifo_cond);
       slock_unlock(fifo_lock);
@@ -1231,9 +1255,9 @@ static void decode_thread(void *data)
          seek_time = 0.0;
 
          if (video_decode_fifo)
-            fifo_clear(video_decode_fifo);
+            spsc_fifo_clear(video_decode_fifo);
          if (audio_decode_fifo)
-            fifo_clear(audio_decode_fifo);
+            spsc_fifo_clear(audio_decode_fifo);
 
          scond_signal(fifo_cond);
          slock_unlock(fifo_lock);
@@ -1258,6 +1282,7 @@ static void decode_thread(void *data)
       {
          if (decode_video(&pkt, vid_frame, conv_frame, sws))
          {
+            bool write_video;
             size_t decoded_size;
             int64_t pts       = av_frame_get_best_effort_timestamp(vid_frame);
             double video_time = pts * av_q2d(fctx->streams[video_stream]->time_base);
@@ -1279,31 +1304,40 @@ static void decode_thread(void *data)
             slock_lock(fifo_lock);
 
             while (!decode_thread_dead  && (video_decode_fifo != NULL)
-                  && fifo_write_avail(video_decode_fifo) < decoded_size)
+                  && spsc_fifo_write_avail(video_decode_fifo) < decoded_size)
             {
                if (!main_sleeping)
                   scond_wait(fifo_decode_cond, fifo_lock);
                else
                {
-                  fifo_clear(video_decode_fifo);
+                  spsc_fifo_clear(video_decode_fifo);
                   break;
                }
             }
 
-            decode_last_video_time = video_time;
-            if (!decode_thread_dead)
+            write_video = !decode_thread_dead;
+            slock_unlock(fifo_lock);
+
+            if (write_video)
             {
                int stride;
                unsigned y;
+               size_t row_size   = media.width * sizeof(uint32_t);
                const uint8_t *src = NULL;
                
-               fifo_write(video_decode_fifo, &pts, sizeof(pts));
+               spsc_fifo_write_at(video_decode_fifo, 0, &pts, sizeof(pts));
                src    = conv_frame->data[0];
                stride = conv_frame->linesize[0];
 
                for (y = 0; y < media.height; y++, src += stride)
-                  fifo_write(video_decode_fifo, src, media.width * sizeof(uint32_t));
+                  spsc_fifo_write_at(video_decode_fifo,
+                        sizeof(pts) + y * row_size, src, row_size);
             }
+
+            slock_lock(fifo_lock);
+            decode_last_video_time = video_time;
+            if (write_video)
+               spsc_fifo_write_commit(video_decode_fifo, decoded_size);
             scond_signal(fifo_cond);
             slock_unlock(fifo_lock);
          }
@@ -1486,9 +1520,9 @@ void CORE_PREFIX(retro_unload_game)(void)
       slock_free(decode_thread_lock);
 
    if (video_decode_fifo)
-      fifo_free(video_decode_fifo);
+      spsc_fifo_free(video_decode_fifo);
    if (audio_decode_fifo)
-      fifo_free(audio_decode_fifo);
+      spsc_fifo_free(audio_decode_fifo);
 
    fifo_cond = NULL;
    fifo_decode_cond = NULL;
@@ -1609,8 +1643,13 @@ bool CORE_PREFIX(retro_load_game)(const struct retro_game_info *info)
 
    if (video_stream >= 0 || is_glfft)
    {
-      video_decode_fifo = fifo_new(media.width 
+      video_decode_fifo = spsc_fifo_new(media.width 
             * media.height * sizeof(uint32_t) * 32);
+      if (!video_decode_fifo)
+      {
+         LOG_ERR("Cannot allocate video decode buffer.");
+         goto error;
+      }
 
 #if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES)
       use_gl = true;
@@ -1634,7 +1673,12 @@ bool CORE_PREFIX(retro_load_game)(const struct retro_game_info *info)
    if (audio_streams_num > 0)
    {
       unsigned buffer_seconds = video_stream >= 0 ? 20 : 1;
-      audio_decode_fifo = fifo_new(buffer_seconds * media.sample_rate * sizeof(int16_t) * 2);
+      audio_decode_fifo = spsc_fifo_new(buffer_seconds * media.sample_rate * sizeof(int16_t) * 2);
+      if (!audio_decode_fifo)
+      {
+         LOG_ERR("Cannot allocate audio decode buffer.");
+         goto error;
+      }
    }
 
    fifo_cond        = scond_new();
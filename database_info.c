@@ -20,6 +20,12 @@
 
 #include <compat/strl.h>
 #include <retro_endianness.h>
+#include <retro_miscellaneous.h>
+#include <features/features_cpu.h>
+#include <retro_stat.h>
+#include <file/file_path.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
 
 #include "list_special.h"
 #include "database_info.h"
@@ -574,3 +580,583 @@ void database_info_list_free(database_info_list_t *database_info_list)
    free(database_info_list->list);
    free(database_info_list);
 }
+
+#define DATABASE_INFO_INDEX_MAGIC    "RDBIDX02"
+#define DATABASE_INFO_INDEX_NONE     0xffffffffU
+
+struct database_info_index_rdb
+{
+   char *path;
+   int64_t mtime;
+   int64_t size;
+};
+
+struct database_info_index_entry
+{
+   uint32_t crc;
+   uint32_t rdb;
+   /* Offsets into the string pool. */
+   uint32_t name;
+   uint32_t serial;
+};
+
+struct database_info_index
+{
+   struct database_info_index_rdb *rdbs;
+   struct database_info_index_entry *entries;
+   char *pool;
+   uint32_t *crc_buckets;
+   uint32_t *crc_next;
+   uint32_t *serial_buckets;
+   uint32_t *serial_next;
+   uint32_t mask;
+   unsigned rdb_count;
+   size_t count;
+   size_t capacity;
+   size_t pool_size;
+   size_t pool_capacity;
+};
+
+static uint32_t database_info_index_add_string(
+      database_info_index_t *index, const char *s, size_t len)
+{
+   uint32_t offset;
+   const char *end = (const char*)memchr(s, '\0', len);
+
+   if (end)
+      len = end - s;
+
+   if (index->pool_size + len + 1 > index->pool_capacity)
+   {
+      size_t capacity = index->pool_capacity ? index->pool_capacity : 4096;
+      char *pool      = NULL;
+
+      while (index->pool_size + len + 1 > capacity)
+         capacity *= 2;
+
+      pool = (char*)realloc(index->pool, capacity);
+      if (!pool)
+         return DATABASE_INFO_INDEX_NONE;
+
+      index->pool          = pool;
+      index->pool_capacity = capacity;
+   }
+
+   offset = (uint32_t)index->pool_size;
+   memcpy(index->pool + offset, s, len);
+   index->pool[offset + len] = '\0';
+   index->pool_size += len + 1;
+
+   return offset;
+}
+
+static bool database_info_index_add_rdb(database_info_index_t *index,
+      unsigned rdb, const char *path)
+{
+   struct rmsgpack_dom_value item;
+   bool ret                 = true;
+   libretrodb_t *db         = libretrodb_new();
+   libretrodb_cursor_t *cur = libretrodb_cursor_new();
+
+   if (!db || !cur)
+   {
+      ret = false;
+      goto end;
+   }
+
+   /* A database that can't be opened just has no entries,
+    * as with database_info_list_new(). */
+   if (database_cursor_open(db, cur, path, NULL) != 0)
+   {
+      libretrodb_free(db);
+      db = NULL;
+      goto end;
+   }
+
+   while (libretrodb_cursor_read_item(cur, &item) == 0)
+   {
+      unsigned i;
+      struct database_info_index_entry *entry = NULL;
+
+      if (item.type != RDT_MAP)
+      {
+         rmsgpack_dom_value_free(&item);
+         continue;
+      }
+
+      if (index->count == index->capacity)
+      {
+         size_t capacity = index->capacity ? index->capacity * 2 : 1024;
+         struct database_info_index_entry *entries = 
+            (struct database_info_index_entry*)
+            realloc(index->entries, capacity * sizeof(*entries));
+
+         if (!entries)
+         {
+            rmsgpack_dom_value_free(&item);
+            ret = false;
+            goto end;
+         }
+
+         index->entries  = entries;
+         index->capacity = capacity;
+      }
+
+      entry         = &index->entries[index->count++];
+      entry->crc    = 0;
+      entry->rdb    = rdb;
+      entry->name   = DATABASE_INFO_INDEX_NONE;
+      entry->serial = DATABASE_INFO_INDEX_NONE;
+
+      for (i = 0; i < item.val.map.len; i++)
+      {
+         struct rmsgpack_dom_value *key = &item.val.map.items[i].key;
+         struct rmsgpack_dom_value *val = &item.val.map.items[i].value;
+
+         switch (msg_hash_calculate(key->val.string.buff))
+         {
+            case DB_CURSOR_NAME:
+               entry->name = database_info_index_add_string(index,
+                     val->val.string.buff, val->val.string.len);
+               break;
+            case DB_CURSOR_SERIAL:
+               entry->serial = database_info_index_add_string(index,
+                     val->val.string.buff, val->val.string.len);
+               break;
+            case DB_CURSOR_CHECKSUM_CRC32:
+               entry->crc = swap_if_little32(
+                     *(uint32_t*)val->val.binary.buff);
+               break;
+            default:
+               break;
+         }
+      }
+
+      rmsgpack_dom_value_free(&item);
+   }
+
+end:
+   if (db)
+   {
+      database_cursor_close(db, cur);
+      libretrodb_free(db);
+   }
+   if (cur)
+      libretrodb_cursor_free(cur);
+
+   return ret;
+}
+
+static bool database_info_index_build_buckets(database_info_index_t *index)
+{
+   size_t i;
+   uint32_t buckets = 16;
+
+   while (buckets < index->count * 2)
+      buckets <<= 1;
+
+   index->mask           = buckets - 1;
+   index->crc_buckets    = (uint32_t*)malloc(buckets * sizeof(uint32_t));
+   index->serial_buckets = (uint32_t*)malloc(buckets * sizeof(uint32_t));
+   index->crc_next       = (uint32_t*)malloc(
+         (index->count + 1) * sizeof(uint32_t));
+   index->serial_next    = (uint32_t*)malloc(
+         (index->count + 1) * sizeof(uint32_t));
+
+   if (     !index->crc_buckets || !index->serial_buckets 
+         || !index->crc_next    || !index->serial_next)
+      return false;
+
+   memset(index->crc_buckets,    0xff, buckets * sizeof(uint32_t));
+   memset(index->serial_buckets, 0xff, buckets * sizeof(uint32_t));
+
+   /* Insert from the back, so every chain is in entry order
+    * and lookups return the same match as a linear scan. */
+   for (i = index->count; i-- > 0; )
+   {
+      const struct database_info_index_entry *entry = &index->entries[i];
+
+      if (entry->crc)
+      {
+         uint32_t bucket       = entry->crc & index->mask;
+         index->crc_next[i]    = index->crc_buckets[bucket];
+         index->crc_buckets[bucket] = (uint32_t)i;
+      }
+
+      if (entry->serial != DATABASE_INFO_INDEX_NONE)
+      {
+         uint32_t bucket       = msg_hash_calculate(
+               index->pool + entry->serial) & index->mask;
+         index->serial_next[i] = index->serial_buckets[bucket];
+         index->serial_buckets[bucket] = (uint32_t)i;
+      }
+   }
+
+   return true;
+}
+
+/* The index file is stored little-endian, whatever the host:
+ *
+ * "RDBIDX02", u32 rdb count, u32 entry count, u32 pool size,
+ * per database: s64 mtime, s64 size, u32 path length, path,
+ * per entry: u32 crc, u32 rdb, u32 name, u32 serial,
+ * string pool. */
+#define DATABASE_INFO_INDEX_RDB_SIZE   (8 + 8 + 4)
+#define DATABASE_INFO_INDEX_ENTRY_SIZE (4 * 4)
+
+static void database_info_index_put32(uint8_t **p, uint32_t val)
+{
+   val = swap_if_big32(val);
+   memcpy(*p, &val, sizeof(val));
+   *p += sizeof(val);
+}
+
+static void database_info_index_put64(uint8_t **p, int64_t val)
+{
+   uint64_t v = swap_if_big64((uint64_t)val);
+   memcpy(*p, &v, sizeof(v));
+   *p += sizeof(v);
+}
+
+static uint32_t database_info_index_get32(const uint8_t **p)
+{
+   uint32_t val;
+   memcpy(&val, *p, sizeof(val));
+   *p += sizeof(val);
+   return swap_if_big32(val);
+}
+
+static int64_t database_info_index_get64(const uint8_t **p)
+{
+   uint64_t val;
+   memcpy(&val, *p, sizeof(val));
+   *p += sizeof(val);
+   return (int64_t)swap_if_big64(val);
+}
+
+static bool database_info_index_load(database_info_index_t *index,
+      const char *cache_path)
+{
+   unsigned i;
+   uint32_t rdb_count, count, pool_size;
+   void *data       = NULL;
+   ssize_t len      = 0;
+   const uint8_t *p = NULL;
+   const uint8_t *end;
+   bool ret         = false;
+
+   if (!path_file_exists(cache_path))
+      return false;
+   if (!filestream_read_file(cache_path, &data, &len) || !data)
+      return false;
+
+   p   = (const uint8_t*)data;
+   end = p + len;
+
+   if (  len < 8 + 3 * 4 ||
+         memcmp(p, DATABASE_INFO_INDEX_MAGIC, 8))
+      goto end;
+   p += 8;
+
+   rdb_count = database_info_index_get32(&p);
+   count     = database_info_index_get32(&p);
+   pool_size = database_info_index_get32(&p);
+
+   if (rdb_count != index->rdb_count)
+      goto end;
+
+   for (i = 0; i < index->rdb_count; i++)
+   {
+      int64_t mtime, size;
+      uint32_t path_len;
+      const struct database_info_index_rdb *rdb = &index->rdbs[i];
+
+      if ((size_t)(end - p) < DATABASE_INFO_INDEX_RDB_SIZE)
+         goto end;
+
+      mtime    = database_info_index_get64(&p);
+      size     = database_info_index_get64(&p);
+      path_len = database_info_index_get32(&p);
+
+      if ((size_t)(end - p) < path_len)
+         goto end;
+
+      if (  mtime != rdb->mtime || size != rdb->size 
+            || path_len != strlen(rdb->path)
+            || memcmp(p, rdb->path, path_len))
+         goto end;
+      p += path_len;
+   }
+
+   if ((size_t)(end - p) != 
+         (size_t)count * DATABASE_INFO_INDEX_ENTRY_SIZE + pool_size)
+      goto end;
+
+   index->count         = count;
+   index->capacity      = count;
+   index->pool_size     = pool_size;
+   index->pool_capacity = pool_size;
+   index->entries       = (struct database_info_index_entry*)
+      malloc((count + 1) * sizeof(*index->entries));
+   index->pool          = (char*)malloc(pool_size + 1);
+
+   if (!index->entries || !index->pool)
+      goto end;
+
+   for (i = 0; i < index->count; i++)
+   {
+      struct database_info_index_entry *entry = &index->entries[i];
+
+      entry->crc    = database_info_index_get32(&p);
+      entry->rdb    = database_info_index_get32(&p);
+      entry->name   = database_info_index_get32(&p);
+      entry->serial = database_info_index_get32(&p);
+
+      if (  entry->rdb >= index->rdb_count ||
+            (entry->name   != DATABASE_INFO_INDEX_NONE 
+             && entry->name   >= index->pool_size) ||
+            (entry->serial != DATABASE_INFO_INDEX_NONE 
+             && entry->serial >= index->pool_size))
+         goto end;
+   }
+
+   memcpy(index->pool, p, pool_size);
+
+   if (index->pool_size && index->pool[index->pool_size - 1] != '\0')
+      goto end;
+
+   ret = true;
+
+end:
+   if (!ret)
+   {
+      free(index->entries);
+      free(index->pool);
+      index->entries   = NULL;
+      index->pool      = NULL;
+      index->count     = index->capacity      = 0;
+      index->pool_size = index->pool_capacity = 0;
+   }
+   free(data);
+   return ret;
+}
+
+/* Writes the index to a file of its own first and then renames
+ * it into place, so a scan running at the same time never reads
+ * a half written index. */
+static void database_info_index_save(const database_info_index_t *index,
+      const char *cache_path)
+{
+   unsigned i;
+   uint8_t *data, *p;
+   char tmp_path[PATH_MAX_LENGTH] = {0};
+   size_t size                    = 8 + 3 * 4
+      + index->count * DATABASE_INFO_INDEX_ENTRY_SIZE + index->pool_size;
+   bool ok                        = false;
+
+   for (i = 0; i < index->rdb_count; i++)
+      size += DATABASE_INFO_INDEX_RDB_SIZE + strlen(index->rdbs[i].path);
+
+   if (!(data = (uint8_t*)malloc(size)))
+      return;
+
+   p = data;
+   memcpy(p, DATABASE_INFO_INDEX_MAGIC, 8);
+   p += 8;
+
+   database_info_index_put32(&p, index->rdb_count);
+   database_info_index_put32(&p, (uint32_t)index->count);
+   database_info_index_put32(&p, (uint32_t)index->pool_size);
+
+   for (i = 0; i < index->rdb_count; i++)
+   {
+      const struct database_info_index_rdb *rdb = &index->rdbs[i];
+      uint32_t path_len = (uint32_t)strlen(rdb->path);
+
+      database_info_index_put64(&p, rdb->mtime);
+      database_info_index_put64(&p, rdb->size);
+      database_info_index_put32(&p, path_len);
+      memcpy(p, rdb->path, path_len);
+      p += path_len;
+   }
+
+   for (i = 0; i < index->count; i++)
+   {
+      const struct database_info_index_entry *entry = &index->entries[i];
+
+      database_info_index_put32(&p, entry->crc);
+      database_info_index_put32(&p, entry->rdb);
+      database_info_index_put32(&p, entry->name);
+      database_info_index_put32(&p, entry->serial);
+   }
+
+   if (index->pool_size)
+      memcpy(p, index->pool, index->pool_size);
+
+   /* Unique to this index, in case another scan saves one too. */
+   snprintf(tmp_path, sizeof(tmp_path), "%s.%08x.tmp", cache_path,
+         (unsigned)((uintptr_t)index ^ cpu_features_get_time_usec()));
+
+   if (filestream_write_file(tmp_path, data, size))
+   {
+#ifdef _WIN32
+      /* rename() doesn't replace existing files here. */
+      remove(cache_path);
+#endif
+      ok = rename(tmp_path, cache_path) == 0;
+   }
+
+   if (!ok)
+   {
+      remove(tmp_path);
+      RARCH_WARN("Could not write database index to %s.\n", cache_path);
+   }
+
+   free(data);
+}
+
+database_info_index_t *database_info_index_new(
+      const struct string_list *rdb_list, const char *cache_path)
+{
+   unsigned i;
+   database_info_index_t *index = NULL;
+
+   if (!rdb_list)
+      return NULL;
+
+   index = (database_info_index_t*)calloc(1, sizeof(*index));
+   if (!index)
+      return NULL;
+
+   index->rdb_count = (unsigned)rdb_list->size;
+   index->rdbs      = (struct database_info_index_rdb*)
+      calloc(index->rdb_count + 1, sizeof(*index->rdbs));
+
+   if (!index->rdbs)
+      goto error;
+
+   for (i = 0; i < index->rdb_count; i++)
+   {
+      const char *path     = rdb_list->elems[i].data;
+
+      index->rdbs[i].path  = strdup(path);
+      index->rdbs[i].mtime = path_get_mtime(path);
+      index->rdbs[i].size  = path_get_size(path);
+
+      if (!index->rdbs[i].path)
+         goto error;
+   }
+
+   if (string_is_empty(cache_path) || 
+         !database_info_index_load(index, cache_path))
+   {
+      for (i = 0; i < index->rdb_count; i++)
+         if (!database_info_index_add_rdb(index, i, index->rdbs[i].path))
+            goto error;
+
+      if (!string_is_empty(cache_path))
+         database_info_index_save(index, cache_path);
+   }
+
+   if (!database_info_index_build_buckets(index))
+      goto error;
+
+   return index;
+
+error:
+   database_info_index_free(index);
+   return NULL;
+}
+
+void database_info_index_free(database_info_index_t *index)
+{
+   unsigned i;
+
+   if (!index)
+      return;
+
+   if (index->rdbs)
+      for (i = 0; i < index->rdb_count; i++)
+         free(index->rdbs[i].path);
+
+   free(index->rdbs);
+   free(index->entries);
+   free(index->pool);
+   free(index->crc_buckets);
+   free(index->crc_next);
+   free(index->serial_buckets);
+   free(index->serial_next);
+   free(index);
+}
+
+int database_info_index_find_crc(const database_info_index_t *index,
+      uint32_t crc)
+{
+   uint32_t i;
+
+   if (!index || !crc)
+      return -1;
+
+   for (i = index->crc_buckets[crc & index->mask];
+         i != DATABASE_INFO_INDEX_NONE; i = index->crc_next[i])
+      if (index->entries[i].crc == crc)
+         return (int)i;
+
+   return -1;
+}
+
+int database_info_index_find_serial(const database_info_index_t *index,
+      const char *serial)
+{
+   uint32_t i;
+
+   if (!index || string_is_empty(serial))
+      return -1;
+
+   for (i = index->serial_buckets[msg_hash_calculate(serial) & index->mask];
+         i != DATABASE_INFO_INDEX_NONE; i = index->serial_next[i])
+      if (string_is_equal(index->pool + index->entries[i].serial, serial))
+         return (int)i;
+
+   return -1;
+}
+
+database_info_list_t *database_info_index_get(
+      const database_info_index_t *index, int entry, size_t *rdb_index)
+{
+   const struct database_info_index_entry *src = NULL;
+   database_info_list_t *list                  = NULL;
+   database_info_t *info                       = NULL;
+
+   if (!index || entry < 0 || (size_t)entry >= index->count)
+      return NULL;
+
+   src  = &index->entries[entry];
+   list = (database_info_list_t*)calloc(1, sizeof(*list));
+   info = (database_info_t*)calloc(1, sizeof(*info));
+
+   if (!list || !info)
+   {
+      free(list);
+      free(info);
+      return NULL;
+   }
+
+   info->analog_supported = -1;
+   info->rumble_supported = -1;
+   info->coop_supported   = -1;
+   info->crc32            = src->crc;
+
+   if (src->name != DATABASE_INFO_INDEX_NONE)
+      info->name   = strdup(index->pool + src->name);
+   if (src->serial != DATABASE_INFO_INDEX_NONE)
+      info->serial = strdup(index->pool + src->serial);
+
+   list->list  = info;
+   list->count = 1;
+
+   if (rdb_index)
+      *rdb_index = src->rdb;
+
+   return list;
+}
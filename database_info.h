@@ -120,6 +120,38 @@ void database_info_free(database_info_handle_t *handle);
 int database_info_build_query(
       char *query, size_t len, const char *label, const char *path);
 
+typedef struct database_info_index database_info_index_t;
+
+/**
+ * database_info_index_new:
+ * @rdb_list          : list of database (.rdb) files.
+ * @cache_path        : file to load the index from and save it to, or NULL.
+ *
+ * Builds a hash index of the CRC32 and serial of every entry in
+ * every database of @rdb_list. If @cache_path holds an index of
+ * the same databases with the same sizes and modification times,
+ * it is loaded from there instead.
+ *
+ * Returns: new index, or NULL on failure.
+ **/
+database_info_index_t *database_info_index_new(
+      const struct string_list *rdb_list, const char *cache_path);
+
+void database_info_index_free(database_info_index_t *index);
+
+/* Both return the first matching entry, in database list
+ * and then database order, or -1 if there is none. */
+int database_info_index_find_crc(const database_info_index_t *index,
+      uint32_t crc);
+
+int database_info_index_find_serial(const database_info_index_t *index,
+      const char *serial);
+
+/* Returns a list holding only @entry, with the name, serial and
+ * CRC32 filled in, and sets @rdb_index to its database. */
+database_info_list_t *database_info_index_get(
+      const database_info_index_t *index, int entry, size_t *rdb_index);
+
 /* NOTE: Allocates memory, it is the caller's responsibility to free the
  * memory after it is no longer required. */
 char *bin_to_hex_alloc(const uint8_t *data, size_t len);
@@ -1657,6 +1657,7 @@ static void gl_init_pbo_readback(gl_t *gl)
    scaler->in_fmt      = SCALER_FMT_ARGB8888;
    scaler->out_fmt     = SCALER_FMT_BGR24;
    scaler->scaler_type = SCALER_TYPE_POINT;
+   scaler->pool        = video_driver_get_thread_pool();
 
    if (!scaler_ctx_gen_filter(scaler))
    {
@@ -1007,6 +1007,7 @@ static void vulkan_init_readback(vk_t *vk)
    vk->readback.scaler.in_fmt      = SCALER_FMT_ARGB8888;
    vk->readback.scaler.out_fmt     = SCALER_FMT_BGR24;
    vk->readback.scaler.scaler_type = SCALER_TYPE_POINT;
+   vk->readback.scaler.pool        = video_driver_get_thread_pool();
 
    if (!scaler_ctx_gen_filter(&vk->readback.scaler))
    {
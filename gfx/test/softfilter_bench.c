@@ -0,0 +1,291 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Runs softfilter chains over a synthetic frame, once as a chained
+ * graph on a thread pool and once as separate single-filter passes
+ * on the calling thread, the only way to stack filters before. Both
+ * outputs have to match exactly, which checks that tiles and bands
+ * are stitched together without seams.
+ *
+ * Usage: softfilter-bench [threads] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <compat/strl.h>
+#include <features/features_cpu.h>
+#include <retro_miscellaneous.h>
+#include <retro_test.h>
+#include <rthreads/rthread_pool.h>
+
+#include "../video_filter.h"
+
+#define BENCH_WIDTH  320
+#define BENCH_HEIGHT 240
+#define BENCH_RUNS   200
+/* Some filters read a row or two past the edges of the frame. Give
+ * every buffer zeroed rows around it, like the graph's tile strips,
+ * so that both ways of running them read the same thing. */
+#define BENCH_PAD    4
+
+struct bench_chain
+{
+   const char *filters[4];
+   enum retro_pixel_format fmt;
+};
+
+static const struct bench_chain bench_chains[] = {
+   /* Single filters, split up by the filter itself... */
+   { { "scale2x" }, RETRO_PIXEL_FORMAT_XRGB8888 },
+   { { "phosphor2x" }, RETRO_PIXEL_FORMAT_RGB565 },
+   /* ...or run on tiles, as the filter can't. */
+   { { "2xsai" }, RETRO_PIXEL_FORMAT_RGB565 },
+   /* The last stage needs no context and writes straight out. */
+   { { "scale2x", "phosphor2x" }, RETRO_PIXEL_FORMAT_XRGB8888 },
+   { { "scale2x", "phosphor2x" }, RETRO_PIXEL_FORMAT_RGB565 },
+   /* Tiles are copied out of the last stage's strips. */
+   { { "darken", "2xsai" }, RETRO_PIXEL_FORMAT_XRGB8888 },
+   { { "epx", "darken", "supereagle" }, RETRO_PIXEL_FORMAT_RGB565 },
+   { { "lq2x", "2xbr" }, RETRO_PIXEL_FORMAT_RGB565 },
+   /* NTSC keeps state between frames, so this runs frame by frame. */
+   { { "blargg_ntsc_snes", "darken" }, RETRO_PIXEL_FORMAT_RGB565 },
+};
+
+/* Buffer of @rows rows with padding around it. */
+static void *bench_alloc(unsigned rows, size_t pitch)
+{
+   uint8_t *buf = (uint8_t*)calloc(rows + 2 * BENCH_PAD, pitch);
+   return buf ? buf + BENCH_PAD * pitch : NULL;
+}
+
+static void bench_free(void *buf, size_t pitch)
+{
+   if (buf)
+      free((uint8_t*)buf - BENCH_PAD * pitch);
+}
+
+static bool bench_write_config(const char *path,
+      const char * const *filters, unsigned num)
+{
+   unsigned i;
+   FILE *file = fopen(path, "w");
+
+   if (!file)
+      return false;
+
+   if (num == 1)
+      fprintf(file, "filter = %s\n", filters[0]);
+   else
+   {
+      fprintf(file, "filters = %u\n", num);
+      for (i = 0; i < num; i++)
+         fprintf(file, "filter%u = %s\n", i, filters[i]);
+   }
+
+   fclose(file);
+   return true;
+}
+
+/* Blocks of flat colour with some noise, so that the pixel art
+ * scalers find edges to work on. */
+static void bench_gen_frame(void *frame, enum retro_pixel_format fmt)
+{
+   unsigned x, y;
+   uint32_t seed = 1;
+
+   for (y = 0; y < BENCH_HEIGHT; y++)
+   {
+      for (x = 0; x < BENCH_WIDTH; x++)
+      {
+         uint32_t block = ((x / 7) * 0x9e3779b9u) ^ ((y / 5) * 0x85ebca6bu);
+         uint32_t color;
+
+         seed  = seed * 1664525 + 1013904223;
+         color = (seed >> 28) == 0 ? seed : block;
+
+         if (fmt == RETRO_PIXEL_FORMAT_XRGB8888)
+            ((uint32_t*)frame)[y * BENCH_WIDTH + x] = color & 0xffffff;
+         else
+            ((uint16_t*)frame)[y * BENCH_WIDTH + x] = (uint16_t)color;
+      }
+   }
+}
+
+/**
+ * bench_run:
+ * @path                 : .filt config.
+ * @pool                 : thread pool, or NULL.
+ * @fmt                  : input format.
+ * @input                : input frame.
+ * @input_pitch          : pitch of @input.
+ * @output               : set to a new output frame.
+ * @width                : in: input width, out: output width.
+ * @height               : in: input height, out: output height.
+ * @pitch                : set to the pitch of @output.
+ * @runs                 : times to run the filter.
+ *
+ * Returns: time per frame in us, or a negative value on failure.
+ **/
+static double bench_run(const char *path, rthread_pool_t *pool,
+      enum retro_pixel_format *fmt, const void *input, size_t input_pitch,
+      void **output, unsigned *width, unsigned *height, size_t *pitch,
+      unsigned runs)
+{
+   unsigned i, out_width, out_height, bpp;
+   retro_time_t start;
+   rarch_softfilter_t *filt = rarch_softfilter_new(path, pool,
+         *fmt, *width, *height);
+
+   if (!filt)
+      return -1.0;
+
+   rarch_softfilter_get_output_size(filt, &out_width, &out_height,
+         *width, *height);
+   *fmt    = rarch_softfilter_get_output_format(filt);
+   bpp     = *fmt == RETRO_PIXEL_FORMAT_XRGB8888 ? 4 : 2;
+   *pitch  = out_width * bpp;
+   *output = bench_alloc(out_height, *pitch);
+
+   start = cpu_features_get_time_usec();
+   for (i = 0; i < runs; i++)
+      rarch_softfilter_process(filt, *output, *pitch,
+            input, *width, *height, input_pitch);
+   start = cpu_features_get_time_usec() - start;
+
+   rarch_softfilter_free(filt);
+
+   *width  = out_width;
+   *height = out_height;
+   return (double)start / runs;
+}
+
+static void bench_chain(const struct bench_chain *chain, rthread_pool_t *pool)
+{
+   unsigned i, num, width, height, ref_width, ref_height;
+   size_t row, ref_in_pitch;
+   size_t pitch      = 0;
+   size_t ref_pitch  = 0;
+   double chained, separate = 0.0;
+   enum retro_pixel_format fmt, ref_fmt;
+   char name[256]    = {0};
+   void *frame       = NULL;
+   void *output      = NULL;
+   void *ref_in      = NULL;
+   void *ref_out     = NULL;
+   const char *path  = "softfilter_bench.filt";
+   size_t bpp        = chain->fmt == RETRO_PIXEL_FORMAT_XRGB8888 ? 4 : 2;
+
+   for (num = 0; num < ARRAY_SIZE(chain->filters) && chain->filters[num];
+         num++)
+   {
+      if (num)
+         strlcat(name, " > ", sizeof(name));
+      strlcat(name, chain->filters[num], sizeof(name));
+   }
+
+   frame = bench_alloc(BENCH_HEIGHT, BENCH_WIDTH * bpp);
+   bench_gen_frame(frame, chain->fmt);
+
+   /* All filters as one graph. */
+   fmt    = chain->fmt;
+   width  = BENCH_WIDTH;
+   height = BENCH_HEIGHT;
+   bench_write_config(path, chain->filters, num);
+   chained = bench_run(path, pool, &fmt, frame, BENCH_WIDTH * bpp,
+         &output, &width, &height, &pitch, BENCH_RUNS);
+
+   /* One filter at a time. The NTSC filter's output depends on the
+    * number of frames it has seen, so run the same number each. */
+   ref_fmt      = chain->fmt;
+   ref_width    = BENCH_WIDTH;
+   ref_height   = BENCH_HEIGHT;
+   ref_in       = frame;
+   ref_in_pitch = BENCH_WIDTH * bpp;
+
+   for (i = 0; i < num && chained >= 0.0; i++)
+   {
+      double time;
+
+      ref_out = NULL;
+      bench_write_config(path, &chain->filters[i], 1);
+      time = bench_run(path, NULL, &ref_fmt, ref_in, ref_in_pitch,
+            &ref_out, &ref_width, &ref_height, &ref_pitch, BENCH_RUNS);
+
+      if (ref_in != frame)
+         bench_free(ref_in, ref_in_pitch);
+      ref_in       = ref_out;
+      ref_in_pitch = ref_pitch;
+
+      if (time < 0.0)
+      {
+         separate = time;
+         break;
+      }
+      separate += time;
+   }
+
+   remove(path);
+
+   CHECK(chained >= 0.0 && separate >= 0.0,
+         "%s: could not create filters", name);
+   if (chained < 0.0 || separate < 0.0)
+      goto end;
+
+   CHECK(width == ref_width && height == ref_height && fmt == ref_fmt,
+         "%s: output is %ux%u, expected %ux%u",
+         name, width, height, ref_width, ref_height);
+   if (width != ref_width || height != ref_height || fmt != ref_fmt)
+      goto end;
+
+   for (row = 0; row < height; row++)
+   {
+      bool same = !memcmp((uint8_t*)output + row * pitch,
+            (uint8_t*)ref_in + row * ref_pitch, pitch);
+
+      CHECK(same, "%s: row %u differs", name, (unsigned)row);
+      if (!same)
+         goto end;
+   }
+
+   printf("%-36s %-8s %4ux%-4u chained %7.1f us, separate %7.1f us\n",
+         name, chain->fmt == RETRO_PIXEL_FORMAT_XRGB8888 ? "XRGB8888"
+         : "RGB565", width, height, chained, separate);
+
+end:
+   if (ref_in != frame)
+      bench_free(ref_in, ref_in_pitch);
+   bench_free(output, pitch);
+   bench_free(frame, BENCH_WIDTH * bpp);
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i;
+   unsigned threads     = argc > 1 ? strtoul(argv[1], NULL, 0)
+      : cpu_features_get_core_amount();
+   rthread_pool_t *pool = rthread_pool_new(threads);
+
+   printf("%u threads, %u frames of %ux%u\n", rthread_pool_threads(pool),
+         BENCH_RUNS, BENCH_WIDTH, BENCH_HEIGHT);
+
+   for (i = 0; i < ARRAY_SIZE(bench_chains); i++)
+      bench_chain(&bench_chains[i], pool);
+
+   rthread_pool_free(pool);
+
+   return test_result();
+}
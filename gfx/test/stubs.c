@@ -0,0 +1,70 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Frontend functions the video filter code links against. The
+ * benches time things themselves, so the counters do nothing. */
+
+#include <stdio.h>
+#include <stdarg.h>
+
+#include <compat/strl.h>
+#include <file/file_path.h>
+
+#include "../../performance_counters.h"
+#include "../../verbosity.h"
+
+void RARCH_LOG(const char *fmt, ...)
+{
+}
+
+void RARCH_ERR(const char *fmt, ...)
+{
+   va_list ap;
+
+   va_start(ap, fmt);
+   vfprintf(stderr, fmt, ap);
+   va_end(ap);
+}
+
+void fill_pathname_expand_special(char *out_path,
+      const char *in_path, size_t size)
+{
+   strlcpy(out_path, in_path, size);
+}
+
+void fill_pathname_abbreviate_special(char *out_path,
+      const char *in_path, size_t size)
+{
+   strlcpy(out_path, in_path, size);
+}
+
+int performance_counter_init(struct retro_perf_counter *perf, const char *name)
+{
+   perf->ident = name;
+   return 0;
+}
+
+void performance_counter_start(struct retro_perf_counter *perf)
+{
+}
+
+void performance_counter_stop(struct retro_perf_counter *perf)
+{
+}
+
+void performance_counter_add(struct retro_perf_counter *perf,
+      retro_perf_tick_t ticks)
+{
+}
@@ -390,7 +390,7 @@ static void init_video_filter(enum retro_pixel_format colfmt)
 
    video_driver_state.filter.filter = rarch_softfilter_new(
          settings->path.softfilter_plugin,
-         RARCH_SOFTFILTER_THREADS_AUTO, colfmt, width, height);
+         video_driver_get_thread_pool(), colfmt, width, height);
 
    if (!video_driver_state.filter.filter)
    {
@@ -575,6 +575,7 @@ static bool init_video_pixel_converter(unsigned size)
 
    /* TODO: Pick either ARGB8888 or RGB565 depending on driver. */
    video_driver_scaler_ptr->scaler->out_fmt     = SCALER_FMT_RGB565;
+   video_driver_scaler_ptr->scaler->pool        = video_driver_get_thread_pool();
 
    if (!scaler_ctx_gen_filter(video_driver_scaler_ptr->scaler))
       goto error;
@@ -1311,6 +1312,7 @@ static bool video_driver_cache_context_ack       = false;
 static uint8_t *video_driver_record_gpu_buffer   = NULL;
 #ifdef HAVE_THREADS
 static slock_t *display_lock                     = NULL;
+static rthread_pool_t *video_driver_thread_pool  = NULL;
 #endif
 
 void video_driver_lock(void)
@@ -1349,6 +1351,34 @@ void video_driver_lock_new(void)
 #endif
 }
 
+/**
+ * video_driver_get_thread_pool:
+ *
+ * Threads shared by software filters and the scaler, for jobs the
+ * main thread waits on. Created along with the first video driver
+ * and kept until exit, so that work in flight outlives driver
+ * reinits. The recorder and screenshot tasks have pools of their
+ * own, since their long jobs would stall the main thread here.
+ *
+ * Returns: thread pool, or NULL to do the work on the calling thread.
+ **/
+rthread_pool_t *video_driver_get_thread_pool(void)
+{
+#ifdef HAVE_THREADS
+   return video_driver_thread_pool;
+#else
+   return NULL;
+#endif
+}
+
+void video_driver_thread_pool_free(void)
+{
+#ifdef HAVE_THREADS
+   rthread_pool_free(video_driver_thread_pool);
+   video_driver_thread_pool = NULL;
+#endif
+}
+
 void video_driver_destroy(void)
 {
    video_driver_use_rgba          = false;
@@ -1556,6 +1586,11 @@ bool video_driver_get_prev_video_out(void)
 bool video_driver_init(void)
 {
    video_driver_lock_new();
+#ifdef HAVE_THREADS
+   if (!video_driver_thread_pool)
+      video_driver_thread_pool = rthread_pool_new(
+            cpu_features_get_core_amount());
+#endif
    return init_video();
 }
 
@@ -1928,6 +1963,11 @@ bool video_driver_get_current_software_framebuffer(struct retro_framebuffer *fb)
          !video_driver_poke || 
          !video_driver_poke->get_current_software_framebuffer)
       return false;
+
+   /* The frame would be converted or filtered into another
+    * buffer before it reaches the driver anyway. */
+   if (video_driver_scaler_ptr || video_driver_state.filter.filter)
+      return false;
    if (!video_driver_poke->get_current_software_framebuffer(
             video_driver_data, fb))
       return false;
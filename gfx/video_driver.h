@@ -23,6 +23,7 @@
 
 #include <boolean.h>
 #include <retro_common_api.h>
+#include <rthreads/rthread_pool.h>
 
 #include "font_driver.h"
 #include "video_filter.h"
@@ -289,6 +290,8 @@ void video_driver_lock(void);
 void video_driver_unlock(void);
 void video_driver_lock_free(void);
 void video_driver_lock_new(void);
+rthread_pool_t *video_driver_get_thread_pool(void);
+void video_driver_thread_pool_free(void);
 void video_driver_destroy(void);
 void video_driver_set_cached_frame_ptr(const void *data);
 void video_driver_set_stub_frame(void);
@@ -14,7 +14,9 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <file/file_path.h>
 #include <lists/dir_list.h>
@@ -35,61 +37,70 @@
 #include "video_filter.h"
 #include "video_filters/softfilter.h"
 
+/* Filters in one graph at most. */
+#define SOFTFILTER_MAX_STAGES    8
+/* Largest piece of one stage's output a tile should produce,
+ * so that a whole tile stays in the cache on its way through
+ * the graph. */
+#define SOFTFILTER_TILE_BYTES    (128 * 1024)
+#define SOFTFILTER_TILE_MIN_ROWS 16
+/* Bands a filter splits the frame into per thread, so that
+ * threads which finish early have some left to steal. */
+#define SOFTFILTER_BANDS_PER_THREAD 4
+
 struct rarch_soft_plug
 {
 #ifdef HAVE_DYLIB
    dylib_t lib;
+   /* Copy of a version 2 implementation, which ends before flags. */
+   struct softfilter_implementation *compat;
 #endif
    const struct softfilter_implementation *impl;
 };
 
-#ifdef HAVE_THREADS
-#include <rthreads/rthreads.h>
-
-struct filter_thread_data
+struct softfilter_stage
 {
-   sthread_t *thread;
-   const struct softfilter_work_packet *packet;
-   scond_t *cond;
-   slock_t *lock;
-   void *userdata;
-   bool die;
-   bool done;
-};
+   const struct softfilter_implementation *impl;
+   /* One instance per tile worker, otherwise just one. */
+   void **impl_data;
+   unsigned num_instances;
+   /* Config prefix, "filter" or "filter%u". */
+   char key[32];
+
+   enum retro_pixel_format in_pix_fmt, out_pix_fmt;
+   unsigned in_fmt, out_fmt;
+   unsigned out_bpp;
+   /* Largest input and output. */
+   unsigned max_width, max_height;
+   unsigned max_out_width, max_out_height;
 
-static void filter_thread_loop(void *data)
-{
-   struct filter_thread_data *thr = (struct filter_thread_data*)data;
+   /* Output rows per input row, 0 if that isn't a whole number. */
+   unsigned scale;
+   /* Input rows around a tile that have to be computed as well,
+    * so that every later stage gets the context it reads. */
+   unsigned margin;
 
-   for (;;)
-   {
-      bool die;
-      slock_lock(thr->lock);
-      while (thr->done && !thr->die)
-         scond_wait(thr->cond, thr->lock);
-      die = thr->die;
-      slock_unlock(thr->lock);
-
-      if (die)
-         break;
+   /* Output of all but the last stage, when not running on tiles. */
+   uint8_t *frame;
+   size_t frame_pitch;
 
-      if (thr->packet && thr->packet->work)
-         thr->packet->work(thr->userdata, thr->packet->thread_data);
+   struct softfilter_work_packet *packets;
+   unsigned threads;
+};
 
-      slock_lock(thr->lock);
-      thr->done = true;
-      scond_signal(thr->cond);
-      slock_unlock(thr->lock);
-   }
-}
-#endif
+/* A thread's share of a tile, one strip per stage. */
+struct softfilter_tile_worker
+{
+   uint8_t *strips[SOFTFILTER_MAX_STAGES];
+   retro_perf_tick_t ticks[SOFTFILTER_MAX_STAGES];
+};
 
 struct rarch_softfilter
 {
    config_file_t *conf;
 
-   const struct softfilter_implementation *impl;
-   void *impl_data;
+   struct softfilter_stage stages[SOFTFILTER_MAX_STAGES];
+   unsigned num_stages;
 
    struct rarch_soft_plug *plugs;
    unsigned num_plugs;
@@ -97,12 +108,38 @@ struct rarch_softfilter
    unsigned max_width, max_height;
    enum retro_pixel_format pix_fmt, out_pix_fmt;
 
-   struct softfilter_work_packet *packets;
-   unsigned threads;
+   /* Tile-fused execution, see softfilter_process_tile(). */
+   bool tiled;
+   unsigned tile_rows;
+   size_t strip_pitch[SOFTFILTER_MAX_STAGES];
+   unsigned strip_pad[SOFTFILTER_MAX_STAGES];
+   struct softfilter_tile_worker *workers;
+   unsigned num_workers;
+
+   /* The frame being processed, for the tile workers. */
+   void *output;
+   size_t output_stride;
+   const void *input;
+   unsigned width, height;
+   size_t input_stride;
+
+   /* Packets being run on the pool. */
+   const struct softfilter_work_packet *packets;
+   void *packets_userdata;
+
+   rthread_pool_t *pool;
+};
 
-#ifdef HAVE_THREADS
-   struct filter_thread_data *thread_data;
-#endif
+static struct retro_perf_counter softfilter_stage_perf[SOFTFILTER_MAX_STAGES];
+static const char *softfilter_stage_perf_ident[SOFTFILTER_MAX_STAGES] = {
+   "softfilter_stage0",
+   "softfilter_stage1",
+   "softfilter_stage2",
+   "softfilter_stage3",
+   "softfilter_stage4",
+   "softfilter_stage5",
+   "softfilter_stage6",
+   "softfilter_stage7",
 };
 
 static const struct softfilter_implementation *
@@ -128,136 +165,328 @@ static const struct softfilter_config softfilter_config = {
    config_userdata_free,
 };
 
-static bool create_softfilter_graph(rarch_softfilter_t *filt,
-      enum retro_pixel_format in_pixel_format,
-      unsigned max_width, unsigned max_height,
-      softfilter_simd_mask_t cpu_features,
-      unsigned threads)
+static bool softfilter_create_instance(rarch_softfilter_t *filt,
+      struct softfilter_stage *stage, unsigned threads,
+      softfilter_simd_mask_t cpu_features)
 {
-   unsigned input_fmts, input_fmt, output_fmts, i = 0;
    struct config_file_userdata userdata;
-   char key[64]  = {0};
-   char name[64] = {0};
-
-   (void)i;
+   void *impl_data = NULL;
 
-   snprintf(key, sizeof(key), "filter");
-
-   if (!config_get_array(filt->conf, key, name, sizeof(name)))
+   userdata.conf = filt->conf;
+   /* Index-specific configs take priority over ident-specific. */
+   userdata.prefix[0] = stage->key;
+   userdata.prefix[1] = stage->impl->short_ident;
+
+   impl_data = stage->impl->create(
+         &softfilter_config, stage->in_fmt, stage->out_fmt,
+         stage->max_width, stage->max_height,
+         threads, cpu_features, &userdata);
+   if (!impl_data)
    {
-      RARCH_ERR("Could not find 'filter' array in config.\n");
+      RARCH_ERR("Failed to create softfilter state.\n");
       return false;
    }
 
-   if (filt->num_plugs == 0)
+   stage->impl_data[stage->num_instances++] = impl_data;
+   return true;
+}
+
+static unsigned softfilter_fmt(enum retro_pixel_format pix_fmt)
+{
+   switch (pix_fmt)
    {
-      RARCH_ERR("No filter plugs found. Exiting...\n");
-      return false;
+      case RETRO_PIXEL_FORMAT_XRGB8888:
+         return SOFTFILTER_FMT_XRGB8888;
+      case RETRO_PIXEL_FORMAT_RGB565:
+         return SOFTFILTER_FMT_RGB565;
+      default:
+         break;
    }
 
-   filt->impl = softfilter_find_implementation(filt, name);
-   if (!filt->impl)
+   return SOFTFILTER_FMT_NONE;
+}
+
+/**
+ * softfilter_init_stage:
+ * @filt                 : softfilter handle.
+ * @stage                : stage to set up.
+ * @name                 : short ident of the filter.
+ * @in_pixel_format      : format of the stage's input.
+ *
+ * Picks the filter and the formats of a stage. Creates no instances.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+static bool softfilter_init_stage(rarch_softfilter_t *filt,
+      struct softfilter_stage *stage, const char *name,
+      enum retro_pixel_format in_pixel_format)
+{
+   unsigned input_fmts, output_fmts;
+
+   stage->impl = softfilter_find_implementation(filt, name);
+   if (!stage->impl)
    {
       RARCH_ERR("Could not find implementation.\n");
       return false;
    }
 
-   userdata.conf = filt->conf;
-   /* Index-specific configs take priority over ident-specific. */
-   userdata.prefix[0] = key; 
-   userdata.prefix[1] = filt->impl->short_ident;
-
    /* Simple assumptions. */
-   filt->pix_fmt = in_pixel_format;
-   input_fmts = filt->impl->query_input_formats();
+   stage->in_pix_fmt = in_pixel_format;
+   stage->in_fmt     = softfilter_fmt(in_pixel_format);
+   input_fmts        = stage->impl->query_input_formats();
 
-   switch (in_pixel_format)
-   {
-      case RETRO_PIXEL_FORMAT_XRGB8888:
-         input_fmt = SOFTFILTER_FMT_XRGB8888;
-         break;
-      case RETRO_PIXEL_FORMAT_RGB565:
-         input_fmt = SOFTFILTER_FMT_RGB565;
-         break;
-      default:
-         return false;
-   }
-
-   if (!(input_fmt & input_fmts))
+   if (!(stage->in_fmt & input_fmts))
    {
       RARCH_ERR("Softfilter does not support input format.\n");
       return false;
    }
 
-   output_fmts = filt->impl->query_output_formats(input_fmt);
+   output_fmts = stage->impl->query_output_formats(stage->in_fmt);
    /* If we have a match of input/output formats, use that. */
-   if (output_fmts & input_fmt)
-      filt->out_pix_fmt = in_pixel_format;
+   if (output_fmts & stage->in_fmt)
+      stage->out_pix_fmt = in_pixel_format;
    else if (output_fmts & SOFTFILTER_FMT_XRGB8888)
-      filt->out_pix_fmt = RETRO_PIXEL_FORMAT_XRGB8888;
+      stage->out_pix_fmt = RETRO_PIXEL_FORMAT_XRGB8888;
    else if (output_fmts & SOFTFILTER_FMT_RGB565)
-      filt->out_pix_fmt = RETRO_PIXEL_FORMAT_RGB565;
+      stage->out_pix_fmt = RETRO_PIXEL_FORMAT_RGB565;
    else
    {
       RARCH_ERR("Did not find suitable output format for softfilter.\n");
       return false;
    }
 
-   filt->max_width = max_width;
-   filt->max_height = max_height;
+   stage->out_fmt    = softfilter_fmt(stage->out_pix_fmt);
+   stage->out_bpp    = stage->out_pix_fmt == RETRO_PIXEL_FORMAT_XRGB8888
+      ? SOFTFILTER_BPP_XRGB8888 : SOFTFILTER_BPP_RGB565;
+
+   return true;
+}
+
+/* Sets up tiles once all stages have their first instance.
+ * Returns false if the graph can't run on tiles. */
+static bool softfilter_init_tiles(rarch_softfilter_t *filt)
+{
+   unsigned i, rows;
+   size_t row_bytes = 0;
+   /* Rows of stage i's output per input row of the graph. */
+   unsigned scale   = 1;
 
-   filt->impl_data = filt->impl->create(
-         &softfilter_config, input_fmt, input_fmt, max_width, max_height,
-         threads != RARCH_SOFTFILTER_THREADS_AUTO ? threads : 
-         cpu_features_get_core_amount(), cpu_features,
-         &userdata);
-   if (!filt->impl_data)
+   for (i = 0; i < filt->num_stages; i++)
    {
-      RARCH_ERR("Failed to create softfilter state.\n");
-      return false;
+      unsigned one_width, one_height;
+      struct softfilter_stage *stage = &filt->stages[i];
+
+      stage->impl->query_output_size(stage->impl_data[0],
+            &one_width, &one_height, stage->max_width, 1);
+
+      if (!one_height ||
+            stage->max_out_height != stage->max_height * one_height)
+         return false;
+
+      stage->scale = one_height;
+      scale       *= stage->scale;
+      row_bytes    = MAX(row_bytes,
+            (size_t)stage->max_out_width * stage->out_bpp * scale);
    }
 
-   threads = filt->impl->query_num_threads(filt->impl_data);
-   if (!threads)
+   /* Stage i has to compute the rows stage i + 1 reads
+    * around its tile, on top of its own context. */
+   filt->stages[filt->num_stages - 1].margin =
+      filt->stages[filt->num_stages - 1].impl->tile_context;
+
+   for (i = filt->num_stages - 1; i-- > 0; )
    {
-      RARCH_ERR("Invalid number of threads.\n");
+      struct softfilter_stage *stage = &filt->stages[i];
+      stage->margin = (filt->stages[i + 1].margin + stage->scale - 1)
+         / stage->scale + stage->impl->tile_context;
+   }
+
+   rows = (unsigned)(SOFTFILTER_TILE_BYTES / MAX(row_bytes, 1));
+   /* Leave every worker a few tiles to balance the load with. */
+   rows = MIN(rows, filt->max_height / (filt->num_workers * 2));
+   filt->tile_rows = MAX(rows, SOFTFILTER_TILE_MIN_ROWS);
+
+   filt->workers = (struct softfilter_tile_worker*)
+      calloc(filt->num_workers, sizeof(*filt->workers));
+   if (!filt->workers)
       return false;
+
+   scale = 1;
+   for (i = 0; i < filt->num_stages; i++)
+   {
+      unsigned j, strip_rows;
+      struct softfilter_stage *stage = &filt->stages[i];
+      /* The next stage may read this far past its part of the strip. */
+      unsigned pad = (i + 1 < filt->num_stages
+            ? filt->stages[i + 1].impl->tile_context : 0) + 2;
+
+      strip_rows = (filt->tile_rows * scale + 2 * stage->margin)
+         * stage->scale;
+      scale     *= stage->scale;
+
+      filt->strip_pitch[i] = (size_t)stage->max_out_width * stage->out_bpp;
+      filt->strip_pad[i]   = pad;
+
+      for (j = 0; j < filt->num_workers; j++)
+      {
+         filt->workers[j].strips[i] = (uint8_t*)calloc(
+               strip_rows + 2 * pad, filt->strip_pitch[i]);
+         if (!filt->workers[j].strips[i])
+            return false;
+      }
    }
 
-   filt->threads = threads;
-   RARCH_LOG("Using %u threads for softfilter.\n", threads);
+   return true;
+}
 
-   filt->packets = (struct softfilter_work_packet*)
-      calloc(threads, sizeof(*filt->packets));
-   if (!filt->packets)
+static bool create_softfilter_graph(rarch_softfilter_t *filt,
+      enum retro_pixel_format in_pixel_format,
+      unsigned max_width, unsigned max_height,
+      softfilter_simd_mask_t cpu_features)
+{
+   unsigned i, j, num_filters  = 0;
+   enum retro_pixel_format fmt = in_pixel_format;
+   bool tileable               = true;
+   unsigned threads            = rthread_pool_threads(filt->pool);
+   unsigned bands              = threads > 1
+      ? threads * SOFTFILTER_BANDS_PER_THREAD : 1;
+
+   if (filt->num_plugs == 0)
    {
-      RARCH_ERR("Failed to allocate softfilter packets.\n");
+      RARCH_ERR("No filter plugs found. Exiting...\n");
       return false;
    }
 
-#ifdef HAVE_THREADS
-   filt->thread_data = (struct filter_thread_data*)
-      calloc(threads, sizeof(*filt->thread_data));
-   if (!filt->thread_data)
+   /* Either a single filter, or a chain of them, like
+    * audio DSP configs:
+    *    filters = 2
+    *    filter0 = scale2x
+    *    filter1 = phosphor2x */
+   if (!config_get_uint(filt->conf, "filters", &num_filters))
+      num_filters = 0;
+
+   if (num_filters > SOFTFILTER_MAX_STAGES)
+   {
+      RARCH_ERR("Too many filters, at most %u are supported.\n",
+            SOFTFILTER_MAX_STAGES);
       return false;
+   }
+
+   filt->num_stages = MAX(num_filters, 1);
+   filt->max_width  = max_width;
+   filt->max_height = max_height;
+   filt->pix_fmt    = in_pixel_format;
 
-   for (i = 0; i < threads; i++)
+   for (i = 0; i < filt->num_stages; i++)
    {
-      filt->thread_data[i].userdata = filt->impl_data;
-      filt->thread_data[i].done = true;
+      char name[64] = {0};
+      struct softfilter_stage *stage = &filt->stages[i];
 
-      filt->thread_data[i].lock = slock_new();
-      if (!filt->thread_data[i].lock)
+      if (num_filters)
+         snprintf(stage->key, sizeof(stage->key), "filter%u", i);
+      else
+         snprintf(stage->key, sizeof(stage->key), "filter");
+
+      if (!config_get_array(filt->conf, stage->key, name, sizeof(name)))
+      {
+         RARCH_ERR("Could not find '%s' array in config.\n", stage->key);
          return false;
-      filt->thread_data[i].cond = scond_new();
-      if (!filt->thread_data[i].cond)
+      }
+
+      if (!softfilter_init_stage(filt, stage, name, fmt))
          return false;
-      filt->thread_data[i].thread = sthread_create(
-            filter_thread_loop, &filt->thread_data[i]);
-      if (!filt->thread_data[i].thread)
+
+      if (!(stage->impl->flags & SOFTFILTER_FLAG_TILEABLE))
+         tileable = false;
+
+      fmt = stage->out_pix_fmt;
+   }
+
+   filt->out_pix_fmt = fmt;
+   filt->num_workers = threads;
+
+   for (i = 0; i < filt->num_stages; i++)
+   {
+      struct softfilter_stage *stage = &filt->stages[i];
+
+      stage->max_width  = max_width;
+      stage->max_height = max_height;
+      stage->impl_data  = (void**)calloc(filt->num_workers,
+            sizeof(*stage->impl_data));
+      if (!stage->impl_data)
+         return false;
+
+      if (!softfilter_create_instance(filt, stage, bands, cpu_features))
          return false;
+
+      stage->impl->query_output_size(stage->impl_data[0],
+            &stage->max_out_width, &stage->max_out_height,
+            max_width, max_height);
+      max_width  = stage->max_out_width;
+      max_height = stage->max_out_height;
+
+      stage->threads = stage->impl->query_num_threads(stage->impl_data[0]);
+      if (!stage->threads)
+      {
+         RARCH_ERR("Invalid number of threads.\n");
+         return false;
+      }
    }
-#endif
+
+   /* Chains run on tiles if they can. So does a single filter
+    * that can't split the frame up by itself, to spread it over
+    * the threads. */
+   if (filt->num_stages == 1)
+      tileable = tileable && threads > 1 && filt->stages[0].threads == 1;
+
+   filt->tiled = tileable && softfilter_init_tiles(filt);
+
+   for (i = 0; i < filt->num_stages; i++)
+   {
+      struct softfilter_stage *stage = &filt->stages[i];
+
+      performance_counter_init(&softfilter_stage_perf[i],
+            softfilter_stage_perf_ident[i]);
+
+      if (filt->tiled)
+      {
+         /* Every worker runs a single-threaded instance of its own. */
+         if (bands > 1)
+         {
+            stage->impl->destroy(stage->impl_data[0]);
+            stage->num_instances = 0;
+         }
+
+         for (j = stage->num_instances; j < filt->num_workers; j++)
+            if (!softfilter_create_instance(filt, stage, 1, cpu_features))
+               return false;
+         continue;
+      }
+
+      stage->packets = (struct softfilter_work_packet*)
+         calloc(stage->threads, sizeof(*stage->packets));
+      if (!stage->packets)
+      {
+         RARCH_ERR("Failed to allocate softfilter packets.\n");
+         return false;
+      }
+
+      /* Intermediate frame for the next stage. */
+      if (i + 1 < filt->num_stages)
+      {
+         stage->frame_pitch = (size_t)stage->max_out_width * stage->out_bpp;
+         stage->frame       = (uint8_t*)calloc(stage->max_out_height,
+               stage->frame_pitch);
+         if (!stage->frame)
+            return false;
+      }
+   }
+
+   if (filt->tiled)
+      RARCH_LOG("[SoftFilter]: Running %u filters on tiles of %u rows.\n",
+            filt->num_stages, filt->tile_rows);
+
+   RARCH_LOG("Using %u threads for softfilter.\n", threads);
 
    return true;
 }
@@ -273,6 +502,7 @@ static bool append_softfilter_plugs(rarch_softfilter_t *filt,
    {
       softfilter_get_implementation_t cb;
       const struct softfilter_implementation *impl = NULL;
+      struct softfilter_implementation *compat     = NULL;
       struct rarch_soft_plug *new_plugs = NULL;
       dylib_t lib = dylib_load(list->elems[i].data);
 
@@ -295,16 +525,34 @@ static bool append_softfilter_plugs(rarch_softfilter_t *filt,
          continue;
       }
 
-      if (impl->api_version != SOFTFILTER_API_VERSION)
+      if (impl->api_version != SOFTFILTER_API_VERSION
+            && impl->api_version != SOFTFILTER_API_VERSION_V2)
       {
          dylib_close(lib);
          continue;
       }
 
+      if (impl->api_version == SOFTFILTER_API_VERSION_V2)
+      {
+         /* The plugin's struct has no flags or tile_context,
+          * so it is never tiled. */
+         compat = (struct softfilter_implementation*)
+            calloc(1, sizeof(*compat));
+         if (!compat)
+         {
+            dylib_close(lib);
+            return false;
+         }
+         memcpy(compat, impl,
+               offsetof(struct softfilter_implementation, flags));
+         impl = compat;
+      }
+
       new_plugs = (struct rarch_soft_plug*)
          realloc(filt->plugs, sizeof(*filt->plugs) * (filt->num_plugs + 1));
       if (!new_plugs)
       {
+         free(compat);
          dylib_close(lib);
          return false;
       }
@@ -313,8 +561,9 @@ static bool append_softfilter_plugs(rarch_softfilter_t *filt,
             impl->ident, impl->short_ident);
       
       filt->plugs = new_plugs;
-      filt->plugs[filt->num_plugs].lib = lib;
-      filt->plugs[filt->num_plugs].impl = impl;
+      filt->plugs[filt->num_plugs].lib    = lib;
+      filt->plugs[filt->num_plugs].compat = compat;
+      filt->plugs[filt->num_plugs].impl   = impl;
       filt->num_plugs++;
    }
 
@@ -382,8 +631,113 @@ static bool append_softfilter_plugs(rarch_softfilter_t *filt,
 }
 #endif
 
+static void softfilter_packet_job(void *data, unsigned item, unsigned thread)
+{
+   rarch_softfilter_t *filt                  = (rarch_softfilter_t*)data;
+   const struct softfilter_work_packet *pckt = &filt->packets[item];
+
+   (void)thread;
+
+   pckt->work(filt->packets_userdata, pckt->thread_data);
+}
+
+/**
+ * softfilter_process_tile:
+ * @filt                 : softfilter handle.
+ * @worker               : worker running the tile.
+ * @tile                 : tile index.
+ *
+ * Takes a band of input rows through every stage. Each stage gets
+ * its margin of extra rows on both sides, so that the rows it
+ * computes wrongly at the band edges are never used. Stages write
+ * into the worker's strips, and the final rows are copied out, unless
+ * the last stage needs no margin and can write its rows directly.
+ **/
+static void softfilter_process_tile(rarch_softfilter_t *filt,
+      struct softfilter_tile_worker *worker, unsigned tile)
+{
+   unsigned i;
+   unsigned first      = tile * filt->tile_rows;
+   unsigned last       = MIN(first + filt->tile_rows, filt->height);
+   unsigned width      = filt->width;
+   /* Input rows of the current stage per row of the frame. */
+   unsigned scale      = 1;
+   const uint8_t *in   = (const uint8_t*)filt->input;
+   size_t in_stride    = filt->input_stride;
+   /* First row of the input that in points to. */
+   unsigned in_row     = 0;
+   uint8_t *out        = NULL;
+   size_t out_stride   = 0;
+   unsigned out_row    = 0;
+   bool direct         = false;
+
+   for (i = 0; i < filt->num_stages; i++)
+   {
+      retro_perf_tick_t start;
+      unsigned lo, hi, out_width, out_height;
+      struct softfilter_work_packet packet;
+      struct softfilter_stage *stage = &filt->stages[i];
+      void *impl_data                = stage->impl_data[worker - filt->workers];
+      unsigned height                = filt->height * scale;
+
+      lo = first * scale > stage->margin ? first * scale - stage->margin : 0;
+      hi = MIN(last * scale + stage->margin, height);
+
+      direct = i + 1 == filt->num_stages && !stage->margin;
+
+      if (direct)
+      {
+         out_stride = filt->output_stride;
+         out        = (uint8_t*)filt->output + lo * stage->scale * out_stride;
+      }
+      else
+      {
+         out_stride = filt->strip_pitch[i];
+         out        = worker->strips[i] + filt->strip_pad[i] * out_stride;
+      }
+
+      out_row = lo * stage->scale;
+
+      start = cpu_features_get_perf_counter();
+      stage->impl->get_work_packets(impl_data, &packet, out, out_stride,
+            in + (lo - in_row) * in_stride, width, hi - lo, in_stride);
+      packet.work(impl_data, packet.thread_data);
+      worker->ticks[i] += cpu_features_get_perf_counter() - start;
+
+      stage->impl->query_output_size(impl_data, &out_width, &out_height,
+            width, hi - lo);
+
+      /* Rows past the bottom of the frame read as zeroes,
+       * not as what the previous tile left in the strip. */
+      if (!direct && hi == height)
+         memset(out + out_height * out_stride, 0,
+               filt->strip_pad[i] * out_stride);
+
+      in        = out;
+      in_stride = out_stride;
+      in_row    = out_row;
+      width     = out_width;
+      scale    *= stage->scale;
+   }
+
+   if (direct)
+      return;
+
+   /* The last stage computed more rows than this tile owns. */
+   for (i = first * scale; i < last * scale; i++)
+      memcpy((uint8_t*)filt->output + i * filt->output_stride,
+            out + (i - out_row) * out_stride,
+            width * filt->stages[filt->num_stages - 1].out_bpp);
+}
+
+static void softfilter_tile_job(void *data, unsigned item, unsigned thread)
+{
+   rarch_softfilter_t *filt = (rarch_softfilter_t*)data;
+   softfilter_process_tile(filt, &filt->workers[thread], item);
+}
+
 rarch_softfilter_t *rarch_softfilter_new(const char *filter_config,
-      unsigned threads,
+      rthread_pool_t *pool,
       enum retro_pixel_format in_pixel_format,
       unsigned max_width, unsigned max_height)
 {
@@ -401,6 +755,8 @@ rarch_softfilter_t *rarch_softfilter_new(const char *filter_config,
    if (!filt)
       return NULL;
 
+   filt->pool = pool;
+
    filt->conf = config_file_new(filter_config);
    if (!filt->conf)
    {
@@ -433,7 +789,7 @@ rarch_softfilter_t *rarch_softfilter_new(const char *filter_config,
    plugs = NULL;
 
    if (!create_softfilter_graph(filt, in_pixel_format,
-            max_width, max_height, cpu_features, threads))
+            max_width, max_height, cpu_features))
    {
       RARCH_ERR("[SoftFitler]: Failed to create softfilter graph...\n");
       goto error;
@@ -451,40 +807,46 @@ error:
 
 void rarch_softfilter_free(rarch_softfilter_t *filt)
 {
-   unsigned i = 0;
+   unsigned i = 0, j;
    (void)i;
 
    if (!filt)
       return;
 
-   free(filt->packets);
-   if (filt->impl && filt->impl_data)
-      filt->impl->destroy(filt->impl_data);
+   for (i = 0; i < filt->num_stages; i++)
+   {
+      struct softfilter_stage *stage = &filt->stages[i];
+
+      for (j = 0; j < stage->num_instances; j++)
+         stage->impl->destroy(stage->impl_data[j]);
+
+      free(stage->impl_data);
+      free(stage->packets);
+      free(stage->frame);
+   }
+
+   if (filt->workers)
+   {
+      for (i = 0; i < filt->num_workers; i++)
+         for (j = 0; j < SOFTFILTER_MAX_STAGES; j++)
+            free(filt->workers[i].strips[j]);
+   }
+
+   free(filt->workers);
 
 #ifdef HAVE_DYLIB
    for (i = 0; i < filt->num_plugs; i++)
    {
+      free(filt->plugs[i].compat);
       if (filt->plugs[i].lib)
          dylib_close(filt->plugs[i].lib);
    }
-   free(filt->plugs);
 #endif
+   free(filt->plugs);
+
+   if (filt->conf)
+      config_file_free(filt->conf);
 
-#ifdef HAVE_THREADS
-   for (i = 0; i < filt->threads; i++)
-   {
-      if (!filt->thread_data[i].thread)
-         continue;
-      slock_lock(filt->thread_data[i].lock);
-      filt->thread_data[i].die = true;
-      scond_signal(filt->thread_data[i].cond);
-      slock_unlock(filt->thread_data[i].lock);
-      sthread_join(filt->thread_data[i].thread);
-      slock_free(filt->thread_data[i].lock);
-      scond_free(filt->thread_data[i].cond);
-   }
-   free(filt->thread_data);
-#endif
    free(filt);
 }
 
@@ -499,9 +861,22 @@ void rarch_softfilter_get_output_size(rarch_softfilter_t *filt,
       unsigned *out_width, unsigned *out_height,
       unsigned width, unsigned height)
 {
-   if (filt && filt->impl && filt->impl->query_output_size)
-      filt->impl->query_output_size(filt->impl_data, out_width,
-            out_height, width, height);
+   unsigned i;
+
+   if (!filt)
+      return;
+
+   for (i = 0; i < filt->num_stages; i++)
+   {
+      const struct softfilter_stage *stage = &filt->stages[i];
+
+      if (stage->impl && stage->impl->query_output_size)
+         stage->impl->query_output_size(stage->impl_data[0],
+               &width, &height, width, height);
+   }
+
+   *out_width  = width;
+   *out_height = height;
 }
 
 enum retro_pixel_format rarch_softfilter_get_output_format(
@@ -515,43 +890,62 @@ void rarch_softfilter_process(rarch_softfilter_t *filt,
       const void *input, unsigned width, unsigned height,
       size_t input_stride)
 {
-   unsigned i;
+   unsigned i, j;
 
    if (!filt)
       return;
 
-   if (filt->impl && filt->impl->get_work_packets)
-      filt->impl->get_work_packets(filt->impl_data, filt->packets,
-            output, output_stride, input, width, height, input_stride);
-   
-#ifdef HAVE_THREADS
-   /* Fire off workers */
-   for (i = 0; i < filt->threads; i++)
+   if (filt->tiled)
    {
-#if 0
-      RARCH_LOG("Firing off filter thread %u ...\n", i);
-#endif
-      filt->thread_data[i].packet = &filt->packets[i];
-      slock_lock(filt->thread_data[i].lock);
-      filt->thread_data[i].done = false;
-      scond_signal(filt->thread_data[i].cond);
-      slock_unlock(filt->thread_data[i].lock);
+      filt->output        = output;
+      filt->output_stride = output_stride;
+      filt->input         = input;
+      filt->width         = width;
+      filt->height        = height;
+      filt->input_stride  = input_stride;
+
+      rthread_pool_run(filt->pool, softfilter_tile_job, filt,
+            (height + filt->tile_rows - 1) / filt->tile_rows);
+
+      /* Stage times are CPU time, summed over all workers. */
+      for (i = 0; i < filt->num_stages; i++)
+      {
+         retro_perf_tick_t ticks = 0;
+
+         for (j = 0; j < filt->num_workers; j++)
+         {
+            ticks += filt->workers[j].ticks[i];
+            filt->workers[j].ticks[i] = 0;
+         }
+
+         performance_counter_add(&softfilter_stage_perf[i], ticks);
+      }
+      return;
    }
 
-   /* Wait for workers */
-   for (i = 0; i < filt->threads; i++)
+   for (i = 0; i < filt->num_stages; i++)
    {
-#if 0
-      RARCH_LOG("Waiting for filter thread %u ...\n", i);
-#endif
-      slock_lock(filt->thread_data[i].lock);
-      while (!filt->thread_data[i].done)
-         scond_wait(filt->thread_data[i].cond, filt->thread_data[i].lock);
-      slock_unlock(filt->thread_data[i].lock);
+      struct softfilter_stage *stage = &filt->stages[i];
+      bool last                      = i + 1 == filt->num_stages;
+      void *out                      = last ? output : stage->frame;
+      size_t out_stride              = last ? output_stride
+         : stage->frame_pitch;
+
+      if (stage->impl->get_work_packets)
+         stage->impl->get_work_packets(stage->impl_data[0], stage->packets,
+               out, out_stride, input, width, height, input_stride);
+
+      filt->packets          = stage->packets;
+      filt->packets_userdata = stage->impl_data[0];
+
+      performance_counter_start(&softfilter_stage_perf[i]);
+      rthread_pool_run(filt->pool, softfilter_packet_job, filt,
+            stage->threads);
+      performance_counter_stop(&softfilter_stage_perf[i]);
+
+      stage->impl->query_output_size(stage->impl_data[0],
+            &width, &height, width, height);
+      input        = out;
+      input_stride = out_stride;
    }
-#else
-   for (i = 0; i < filt->threads; i++)
-      filt->packets[i].work(filt->impl_data, filt->packets[i].thread_data);
-#endif
 }
-
@@ -20,12 +20,14 @@
 #include <stddef.h>
 
 #include <libretro.h>
+#include <rthreads/rthread_pool.h>
 
-#define RARCH_SOFTFILTER_THREADS_AUTO 0
 typedef struct rarch_softfilter rarch_softfilter_t;
 
+/* Filters split their work over @pool. Without one,
+ * everything runs on the calling thread. */
 rarch_softfilter_t *rarch_softfilter_new(const char *filter_path,
-      unsigned threads,
+      rthread_pool_t *pool,
       enum retro_pixel_format in_pixel_format,
       unsigned max_width, unsigned max_height);
 
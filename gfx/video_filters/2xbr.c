@@ -756,6 +756,8 @@ static const struct softfilter_implementation twoxbr_generic = {
    SOFTFILTER_API_VERSION,
    "2xBR",
    "2xbr",
+   SOFTFILTER_FLAG_TILEABLE,
+   2,
 };
  
 const struct softfilter_implementation *softfilter_get_implementation(
@@ -251,6 +251,9 @@ static const struct softfilter_implementation blargg_ntsc_snes_generic = {
    SOFTFILTER_API_VERSION,
    "Blargg NTSC SNES",
    "blargg_ntsc_snes",
+   /* The colour burst phase carries over from one call to the next. */
+   0,
+   0,
 };
 
 const struct softfilter_implementation *softfilter_get_implementation(
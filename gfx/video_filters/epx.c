@@ -76,7 +76,7 @@ static void *epx_generic_create(const struct softfilter_config *config,
       return NULL;
    filt->workers = (struct softfilter_thread_data*)
       calloc(threads, sizeof(struct softfilter_thread_data));
-   filt->threads = 1;
+   filt->threads = threads;
    filt->in_fmt  = in_fmt;
    if (!filt->workers)
    {
@@ -260,6 +260,8 @@ static const struct softfilter_implementation epx_generic = {
    SOFTFILTER_API_VERSION,
    "EPX",
    "epx",
+   SOFTFILTER_FLAG_TILEABLE,
+   1,
 };
 
 const struct softfilter_implementation *softfilter_get_implementation(
@@ -279,6 +279,8 @@ static const struct softfilter_implementation lq2x_generic = {
    SOFTFILTER_API_VERSION,
    "LQ2x",
    "lq2x",
+   SOFTFILTER_FLAG_TILEABLE,
+   1,
 };
 
 const struct softfilter_implementation *softfilter_get_implementation(
@@ -247,7 +247,7 @@ static void *phosphor2x_generic_create(const struct softfilter_config *config,
       return NULL;
    filt->workers = (struct softfilter_thread_data*)
       calloc(threads, sizeof(struct softfilter_thread_data));
-   filt->threads = 1;
+   filt->threads = threads;
    filt->in_fmt  = in_fmt;
    if (!filt->workers)
    {
@@ -486,6 +486,8 @@ static const struct softfilter_implementation phosphor2x_generic = {
    SOFTFILTER_API_VERSION,
    "Phosphor2x",
    "phosphor2x",
+   SOFTFILTER_FLAG_TILEABLE,
+   0,
 };
 
 const struct softfilter_implementation *softfilter_get_implementation(
@@ -138,7 +138,7 @@ static void *scale2x_generic_create(const struct softfilter_config *config,
       return NULL;
    filt->workers = (struct softfilter_thread_data*)
       calloc(threads, sizeof(struct softfilter_thread_data));
-   filt->threads = 1;
+   filt->threads = threads;
    filt->in_fmt  = in_fmt;
    if (!filt->workers)
    {
@@ -223,7 +223,7 @@ static void scale2x_generic_packets(void *data,
 
       /* Workers need to know if they can access pixels 
        * outside their given buffer. */
-      thr->first = y_start;
+      thr->first = y_start == 0;
       thr->last = y_end == height;
 
       if (filt->in_fmt == SOFTFILTER_FMT_XRGB8888)
@@ -247,6 +247,8 @@ static const struct softfilter_implementation scale2x_generic = {
    SOFTFILTER_API_VERSION,
    "Scale2x",
    "scale2x",
+   SOFTFILTER_FLAG_TILEABLE,
+   1,
 };
 
 const struct softfilter_implementation *softfilter_get_implementation(
@@ -92,7 +92,17 @@ typedef const struct softfilter_implementation
 const struct softfilter_implementation *softfilter_get_implementation(
       softfilter_simd_mask_t simd);
 
-#define SOFTFILTER_API_VERSION  2
+#define SOFTFILTER_API_VERSION  3
+/* Still loaded, without flags and tile_context, and never tiled. */
+#define SOFTFILTER_API_VERSION_V2 2
+
+/* The filter can run on horizontal strips of a frame.
+ * Each strip is passed to get_work_packets() as if it were a whole
+ * frame, with tile_context valid rows above and below it, and the
+ * rows the filter computes differently at strip edges are thrown
+ * away. Filters which keep state from one call to the next, or
+ * whose output depends on the absolute row, must not set this. */
+#define SOFTFILTER_FLAG_TILEABLE (1 << 0)
 
 /* Required base color formats */
 
@@ -171,13 +181,20 @@ struct softfilter_implementation
    softfilter_query_output_size_t query_output_size;
    softfilter_get_work_packets_t get_work_packets;
 
-   /* Must be SOFTFILTER_API_VERSION. */
+   /* SOFTFILTER_API_VERSION, or SOFTFILTER_API_VERSION_V2 for
+    * a plugin built before flags and tile_context existed. */
    unsigned api_version;
    /* Human readable identifier of implementation. */
    const char *ident;
    /* Computer-friendly short version of ident.
     * Lower case, no spaces and special characters, etc. */
    const char *short_ident;
+
+   /* SOFTFILTER_FLAG_* */
+   unsigned flags;
+   /* With SOFTFILTER_FLAG_TILEABLE, the number of input rows above
+    * and below an output row the filter reads. */
+   unsigned tile_context;
 };
 
 #ifdef __cplusplus
@@ -330,6 +330,8 @@ static const struct softfilter_implementation supertwoxsai_generic = {
    SOFTFILTER_API_VERSION,
    "Super2xSaI",
    "super2xsai",
+   SOFTFILTER_FLAG_TILEABLE,
+   2,
 };
 
 const struct softfilter_implementation *softfilter_get_implementation(softfilter_simd_mask_t simd)
@@ -333,6 +333,8 @@ static const struct softfilter_implementation supereagle_generic = {
    SOFTFILTER_API_VERSION,
    "SuperEagle",
    "supereagle",
+   SOFTFILTER_FLAG_TILEABLE,
+   2,
 };
 
 const struct softfilter_implementation *softfilter_get_implementation(softfilter_simd_mask_t simd)
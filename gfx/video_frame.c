@@ -14,6 +14,7 @@
  */
 
 #include <libretro.h>
+#include <gfx/scaler/pixconv.h>
 
 #include "../performance_counters.h"
 
@@ -139,18 +140,13 @@ void video_frame_convert_to_bgr24(
       struct scaler_ctx *scaler,
       void *output, const void *input,
       int width, int height, int in_pitch,
-      bool bgr24)
+      enum scaler_pix_fmt in_fmt)
 {
    scaler->in_width    = width;
    scaler->in_height   = height;
    scaler->out_width   = width;
    scaler->out_height  = height;
-   if (bgr24)
-      scaler->in_fmt   = SCALER_FMT_BGR24;
-   else if (video_driver_get_pixel_format() == RETRO_PIXEL_FORMAT_XRGB8888)
-      scaler->in_fmt   = SCALER_FMT_ARGB8888;
-   else
-      scaler->in_fmt   = SCALER_FMT_RGB565;
+   scaler->in_fmt      = in_fmt;
    scaler->out_fmt     = SCALER_FMT_BGR24;
    scaler->scaler_type = SCALER_TYPE_POINT;
    scaler_ctx_gen_filter(scaler);
@@ -166,16 +162,7 @@ void video_frame_convert_rgba_to_bgr(
       void *dst_data,
       unsigned width)
 {
-   unsigned x;
-   uint8_t      *dst  = (uint8_t*)dst_data;
-   const uint8_t *src = (const uint8_t*)src_data;
-
-   for (x = 0; x < width; x++, dst += 3, src += 4)
-   {
-      dst[0] = src[2];
-      dst[1] = src[1];
-      dst[2] = src[0];
-   }
+   conv_abgr8888_bgr24(dst_data, src_data, width, 1, width * 3, width * 4);
 }
 
 bool video_pixel_frame_scale(
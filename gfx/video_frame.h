@@ -60,7 +60,7 @@ void video_frame_convert_to_bgr24(
       struct scaler_ctx *scaler,
       void *output, const void *input,
       int width, int height, int in_pitch,
-      bool bgr24);
+      enum scaler_pix_fmt in_fmt);
 
 void video_frame_convert_rgba_to_bgr(
       const void *src_data,
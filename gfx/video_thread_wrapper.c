@@ -14,6 +14,7 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
@@ -21,6 +22,7 @@
 #include <compat/strl.h>
 #include <features/features_cpu.h>
 #include <rthreads/rthreads.h>
+#include <retro_atomic.h>
 
 #include "video_thread_wrapper.h"
 #include "font_driver.h"
@@ -148,6 +150,23 @@ struct thread_packet
    } data;
 };
 
+/* Set in thread_video::ready while the published slot
+ * hasn't been picked up by the video thread yet. */
+#define THREAD_SLOT_FRESH 4
+
+struct thread_frame_slot
+{
+   uint8_t *buffer;
+   unsigned width;
+   unsigned height;
+   unsigned pitch;
+   uint64_t count;
+   retro_time_t time;
+   unsigned seq;
+   bool dupe;
+   char msg[PATH_MAX_LENGTH];
+};
+
 struct thread_video
 {
    slock_t *lock;
@@ -192,6 +211,11 @@ struct thread_video
    retro_time_t last_time;
    unsigned hit_count;
    unsigned miss_count;
+   unsigned superseded_count;
+   unsigned render_count;
+   unsigned copy_count;
+   unsigned zero_copy_count;
+   unsigned latency[VIDEO_THREAD_LATENCY_BUCKETS];
 
    float *alpha_mod;
    unsigned alpha_mods;
@@ -216,9 +240,24 @@ struct thread_video
       bool updated;
       bool within_thread;
       uint64_t count;
+      retro_time_t time;
       char msg[PATH_MAX_LENGTH];
    } frame;
 
+   /* Triple buffering. Each thread owns one slot, the third one
+    * is handed back and forth by swapping thread_video::ready,
+    * so handing over a frame needs no lock. The core thread only
+    * waits for pacing and for the menu texture, see
+    * video_thread_frame_triple(). */
+   bool triple_buffer;
+   struct thread_frame_slot slot[3];
+   unsigned write_slot;       /* Owned by the core thread. */
+   unsigned read_slot;        /* Owned by the video thread. */
+   unsigned write_seq;        /* Last frame published by the core. */
+   unsigned rendered_seq;     /* Last frame rendered, under lock. */
+   retro_atomic_int_t ready;  /* Spare slot, | THREAD_SLOT_FRESH. */
+   retro_atomic_int_t idle;   /* Video thread is waiting for a frame. */
+
    video_driver_t video_thread;
 
 };
@@ -561,6 +600,19 @@ static bool video_thread_handle_packet(
    return false;
 }
 
+static void video_thread_log_latency(thread_video_t *thr, retro_time_t time)
+{
+   unsigned i;
+   retro_time_t ms = (cpu_features_get_time_usec() - time) / 1000;
+
+   for (i = 0; i < VIDEO_THREAD_LATENCY_BUCKETS - 1; i++)
+      if (ms < (1 << i))
+         break;
+
+   thr->latency[i]++;
+   thr->render_count++;
+}
+
 static void video_thread_loop(void *data)
 {
    thread_video_t *thr = (thread_video_t*)data;
@@ -571,10 +623,27 @@ static void video_thread_loop(void *data)
       bool updated = false;
 
       slock_lock(thr->lock);
-      while (thr->send_cmd == CMD_VIDEO_NONE && !thr->frame.updated)
-         scond_wait(thr->cond_thread, thr->lock);
-      if (thr->frame.updated)
-         updated = true;
+      if (thr->triple_buffer)
+      {
+         while (thr->send_cmd == CMD_VIDEO_NONE)
+         {
+            /* The core thread only takes the lock to wake us up
+             * once it sees idle set, so look for a fresh frame
+             * again after setting it. */
+            retro_atomic_store(&thr->idle, 1);
+            if (retro_atomic_load(&thr->ready) & THREAD_SLOT_FRESH)
+               break;
+            scond_wait(thr->cond_thread, thr->lock);
+         }
+         retro_atomic_store(&thr->idle, 0);
+      }
+      else
+      {
+         while (thr->send_cmd == CMD_VIDEO_NONE && !thr->frame.updated)
+            scond_wait(thr->cond_thread, thr->lock);
+         if (thr->frame.updated)
+            updated = true;
+      }
 
       /* To avoid race condition where send_cmd is updated 
        * right after the switch is checked. */
@@ -585,6 +654,15 @@ static void video_thread_loop(void *data)
       if (video_thread_handle_packet(thr, &pkt))
          return;
 
+      /* Swap our slot for the newest one the core has published. */
+      if (thr->triple_buffer &&
+            (retro_atomic_load(&thr->ready) & THREAD_SLOT_FRESH))
+      {
+         thr->read_slot = retro_atomic_exchange(&thr->ready, thr->read_slot)
+            & ~THREAD_SLOT_FRESH;
+         updated        = true;
+      }
+
       if (updated)
       {
          bool                 ret = false;
@@ -592,6 +670,29 @@ static void video_thread_loop(void *data)
          bool               focus = false;
          bool        has_windowed = true;
          struct video_viewport vp = {0};
+         const uint8_t    *buffer = thr->frame.buffer;
+         unsigned           width = thr->frame.width;
+         unsigned          height = thr->frame.height;
+         unsigned           pitch = thr->frame.pitch;
+         uint64_t           count = thr->frame.count;
+         retro_time_t        time = thr->frame.time;
+         const char          *msg = thr->frame.msg;
+         unsigned             seq = 0;
+
+         if (thr->triple_buffer)
+         {
+            struct thread_frame_slot *slot = &thr->slot[thr->read_slot];
+
+            /* Let the driver redraw its last frame for dupes. */
+            buffer = slot->dupe ? NULL : slot->buffer;
+            width  = slot->width;
+            height = slot->height;
+            pitch  = slot->pitch;
+            count  = slot->count;
+            time   = slot->time;
+            seq    = slot->seq;
+            msg    = slot->msg;
+         }
 
          slock_lock(thr->frame.lock);
 
@@ -599,9 +700,8 @@ static void video_thread_loop(void *data)
 
          if (thr->driver && thr->driver->frame)
             ret = thr->driver->frame(thr->driver_data,
-               thr->frame.buffer, thr->frame.width, thr->frame.height,
-               thr->frame.count,
-               thr->frame.pitch, *thr->frame.msg ? thr->frame.msg : NULL);
+               buffer, width, height, count,
+               pitch, *msg ? msg : NULL);
 
          slock_unlock(thr->frame.lock);
 
@@ -623,6 +723,8 @@ static void video_thread_loop(void *data)
          thr->has_windowed  = has_windowed;
          thr->frame.updated = false;
          thr->vp            = vp;
+         thr->rendered_seq  = seq;
+         video_thread_log_latency(thr, time);
          scond_signal(thr->cond_cmd);
          slock_unlock(thr->lock);
       }
@@ -685,6 +787,112 @@ static bool video_thread_has_windowed(void *data)
    return ret;
 }
 
+/* Finished frames are published by swapping the write slot with the
+ * spare one. A frame the video thread didn't get to in time is
+ * replaced by the newer one instead of being dropped.
+ *
+ * Like video_thread_frame(), this keeps the core from running ahead
+ * of the display when not in nonblock mode. While the last frame
+ * hasn't been picked up, it waits until one refresh period after the
+ * previous call, then replaces it. With the menu texture enabled, it
+ * waits until the frame has been rendered. */
+static void video_thread_frame_triple(thread_video_t *thr,
+      const uint8_t *src, unsigned width, unsigned height,
+      uint64_t frame_count, unsigned pitch, unsigned copy_stride,
+      const char *msg)
+{
+   int prev;
+   struct thread_frame_slot *slot = &thr->slot[thr->write_slot];
+
+   if (!thr->nonblock &&
+         (retro_atomic_load(&thr->ready) & THREAD_SLOT_FRESH))
+   {
+      settings_t *settings = config_get_ptr();
+      retro_time_t target  = thr->last_time + (retro_time_t)
+         roundf(1000000 / settings->video.refresh_rate);
+
+      /* The video thread signals cond_cmd after every frame it
+       * renders, and it takes the fresh slot before rendering. */
+      slock_lock(thr->lock);
+      while (retro_atomic_load(&thr->ready) & THREAD_SLOT_FRESH)
+      {
+         retro_time_t delta = target - cpu_features_get_time_usec();
+
+         if (delta <= 0)
+            break;
+
+         if (!scond_wait_timeout(thr->cond_cmd, thr->lock, delta))
+            break;
+      }
+      slock_unlock(thr->lock);
+   }
+
+   /* A dupe is just a redraw, don't let it replace a real frame
+    * which hasn't been shown yet. */
+   if (!src && (retro_atomic_load(&thr->ready) & THREAD_SLOT_FRESH))
+   {
+      thr->hit_count++;
+      return;
+   }
+
+   slot->pitch  = copy_stride;
+
+   /* The core rendered straight into the slot we handed out
+    * through GET_CURRENT_SOFTWARE_FRAMEBUFFER. */
+   if (src == slot->buffer)
+   {
+      slot->pitch = pitch;
+      thr->zero_copy_count++;
+   }
+   else if (src)
+   {
+      unsigned h;
+      uint8_t *dst = slot->buffer;
+
+      for (h = 0; h < height; h++, src += pitch, dst += copy_stride)
+         memcpy(dst, src, copy_stride);
+      thr->copy_count++;
+   }
+
+   slot->dupe   = !src;
+   slot->width  = width;
+   slot->height = height;
+   slot->count  = frame_count;
+   slot->time   = cpu_features_get_time_usec();
+   slot->seq    = ++thr->write_seq;
+
+   if (msg)
+      strlcpy(slot->msg, msg, sizeof(slot->msg));
+   else
+      *slot->msg = '\0';
+
+   prev            = retro_atomic_exchange(&thr->ready,
+         thr->write_slot | THREAD_SLOT_FRESH);
+   thr->write_slot = prev & ~THREAD_SLOT_FRESH;
+
+   if (prev & THREAD_SLOT_FRESH)
+      thr->superseded_count++;
+   thr->hit_count++;
+
+   if (retro_atomic_load(&thr->idle))
+   {
+      slock_lock(thr->lock);
+      scond_signal(thr->cond_thread);
+      slock_unlock(thr->lock);
+   }
+
+#if defined(HAVE_MENU)
+   /* Only ever set on this thread. */
+   if (thr->texture.enable)
+   {
+      slock_lock(thr->lock);
+      while (thr->rendered_seq != thr->write_seq)
+         scond_wait(thr->cond_cmd, thr->lock);
+      slock_unlock(thr->lock);
+   }
+#endif
+}
+
 static bool video_thread_frame(void *data, const void *frame_,
       unsigned width, unsigned height, uint64_t frame_count,
       unsigned pitch, const char *msg)
@@ -716,6 +924,17 @@ static bool video_thread_frame(void *data, const void *frame_,
    src = (const uint8_t*)frame_;
    dst = thr->frame.buffer;
 
+   if (thr->triple_buffer)
+   {
+      video_thread_frame_triple(thr, src, width, height,
+            frame_count, pitch, copy_stride, msg);
+
+      performance_counter_stop(&thr_frame);
+
+      thr->last_time = cpu_features_get_time_usec();
+      return true;
+   }
+
    slock_lock(thr->lock);
 
    if (!thr->nonblock)
@@ -749,6 +968,7 @@ static bool video_thread_frame(void *data, const void *frame_,
          unsigned h;
          for (h = 0; h < height; h++, src += pitch, dst += copy_stride)
             memcpy(dst, src, copy_stride);
+         thr->copy_count++;
       }
 
       thr->frame.updated = true;
@@ -756,6 +976,7 @@ static bool video_thread_frame(void *data, const void *frame_,
       thr->frame.height = height;
       thr->frame.count  = frame_count;
       thr->frame.pitch  = copy_stride;
+      thr->frame.time   = cpu_features_get_time_usec();
 
       if (msg)
          strlcpy(thr->frame.msg, msg, sizeof(thr->frame.msg));
@@ -796,6 +1017,7 @@ static bool video_thread_init(thread_video_t *thr, const video_info_t *info,
 {
    size_t max_size;
    thread_packet_t pkt = {CMD_INIT};
+   settings_t *settings = config_get_ptr();
 
    thr->lock                 = slock_new();
    thr->alpha_lock           = slock_new();
@@ -820,6 +1042,28 @@ static bool video_thread_init(thread_video_t *thr, const video_info_t *info,
 
    memset(thr->frame.buffer, 0x80, max_size);
 
+#ifdef RETRO_ATOMIC_LOCK_FREE
+   thr->triple_buffer        = settings->video.threaded_triple_buffer;
+#endif
+
+   if (thr->triple_buffer)
+   {
+      unsigned i;
+      uint8_t *slots            = (uint8_t*)malloc(3 * max_size);
+
+      if (!slots)
+         return false;
+
+      memset(slots, 0x80, 3 * max_size);
+
+      for (i = 0; i < 3; i++)
+         thr->slot[i].buffer    = slots + i * max_size;
+
+      thr->write_slot           = 0;
+      thr->ready                = 1;
+      thr->read_slot            = 2;
+   }
+
    thr->last_time            = cpu_features_get_time_usec();
    thr->thread               = sthread_create(video_thread_loop, thr);
 
@@ -912,6 +1156,27 @@ static bool video_thread_read_viewport(void *data, uint8_t *buffer)
    return pkt.data.b;
 }
 
+static void video_thread_log_histogram(const thread_video_t *thr)
+{
+   unsigned i;
+   char buf[256] = {0};
+
+   for (i = 0; i < VIDEO_THREAD_LATENCY_BUCKETS; i++)
+   {
+      char bucket[32];
+
+      snprintf(bucket, sizeof(bucket), "%s%s%u ms: %u",
+            i ? ", " : "",
+            i < VIDEO_THREAD_LATENCY_BUCKETS - 1 ? "<" : ">=",
+            1u << (i < VIDEO_THREAD_LATENCY_BUCKETS - 1 ? i : i - 1),
+            thr->latency[i]);
+      strlcat(buf, bucket, sizeof(buf));
+   }
+
+   RARCH_LOG("Threaded video stats: Frames rendered: %u (%s).\n",
+         thr->render_count, buf);
+}
+
 static void video_thread_free(void *data)
 {
    thread_video_t *thr = (thread_video_t*)data;
@@ -928,6 +1193,7 @@ static void video_thread_free(void *data)
    free(thr->texture.frame);
 #endif
    free(thr->frame.buffer);
+   free(thr->slot[0].buffer);
    slock_free(thr->frame.lock);
    slock_free(thr->lock);
    scond_free(thr->cond_cmd);
@@ -938,6 +1204,12 @@ static void video_thread_free(void *data)
 
    RARCH_LOG("Threaded video stats: Frames pushed: %u, Frames dropped: %u.\n",
          thr->hit_count, thr->miss_count);
+   RARCH_LOG("Threaded video stats: Frames copied: %u, Frames rendered in place: %u.\n",
+         thr->copy_count, thr->zero_copy_count);
+   if (thr->triple_buffer)
+      RARCH_LOG("Threaded video stats: Frames superseded: %u.\n",
+            thr->superseded_count);
+   video_thread_log_histogram(thr);
 
    free(thr);
 }
@@ -1222,6 +1494,42 @@ static void thread_apply_state_changes(void *data)
    slock_unlock(thr->frame.lock);
 }
 
+/* Hands out the core thread's slot, so the core can render into
+ * it and video_thread_frame() only has to publish it. Only safe
+ * with triple buffering, otherwise the video thread may still be
+ * reading the one buffer we have. */
+static bool thread_get_current_software_framebuffer(void *data,
+      struct retro_framebuffer *framebuffer)
+{
+   unsigned max_dim;
+   const void *cached  = NULL;
+   thread_video_t *thr = (thread_video_t*)data;
+
+   if (!thr || !thr->triple_buffer || !framebuffer)
+      return false;
+
+   max_dim = thr->info.input_scale * RARCH_SCALE_BASE;
+   if (framebuffer->width > max_dim || framebuffer->height > max_dim)
+      return false;
+
+   /* Duped frames keep the cached frame pointing at an older slot,
+    * which the ring may hand back to us as the write slot. Pause
+    * and menu redraws still need it, so the core has to render
+    * into its own buffer until a newer frame replaces it. */
+   video_driver_cached_frame_get(&cached, NULL, NULL, NULL);
+   if (cached == thr->slot[thr->write_slot].buffer)
+      return false;
+
+   framebuffer->data         = thr->slot[thr->write_slot].buffer;
+   framebuffer->pitch        = framebuffer->width *
+      (thr->info.rgb32 ? sizeof(uint32_t) : sizeof(uint16_t));
+   framebuffer->format       = thr->info.rgb32
+      ? RETRO_PIXEL_FORMAT_XRGB8888 : RETRO_PIXEL_FORMAT_RGB565;
+   framebuffer->memory_flags = RETRO_MEMORY_TYPE_CACHED;
+
+   return true;
+}
+
 /* This is read-only state which should not 
  * have any kind of race condition. */
 static struct video_shader *thread_get_current_shader(void *data)
@@ -1257,6 +1565,8 @@ static const video_poke_interface_t thread_poke = {
    NULL,
 
    thread_get_current_shader,
+   thread_get_current_software_framebuffer,
+   NULL, /* get_hw_render_interface */
 };
 
 static void video_thread_get_poke_interface(
@@ -1376,6 +1686,39 @@ void *video_thread_get_ptr(const video_driver_t **drv)
    return thr->driver_data;
 }
 
+bool video_thread_get_stats(struct video_thread_stats *stats)
+{
+   unsigned i;
+   const thread_video_t *thr = NULL;
+   settings_t *settings      = config_get_ptr();
+
+   if (!stats || !settings->video.threaded || video_driver_is_hw_context())
+      return false;
+
+   thr = (const thread_video_t*)video_driver_get_ptr(true);
+   if (!thr)
+      return false;
+
+   /* Frames pushed, dropped and copied are counted on this thread,
+    * frames rendered on the video thread under its lock. */
+   slock_lock(thr->lock);
+
+   stats->triple_buffer = thr->triple_buffer;
+   stats->pushed        = thr->hit_count;
+   stats->dropped       = thr->miss_count;
+   stats->superseded    = thr->superseded_count;
+   stats->rendered      = thr->render_count;
+   stats->copied        = thr->copy_count;
+   stats->zero_copy     = thr->zero_copy_count;
+
+   for (i = 0; i < VIDEO_THREAD_LATENCY_BUCKETS; i++)
+      stats->latency[i] = thr->latency[i];
+
+   slock_unlock(thr->lock);
+
+   return true;
+}
+
 const char *video_thread_get_ident(void)
 {
    const thread_video_t *thr = (const thread_video_t*)
@@ -36,6 +36,24 @@ typedef struct thread_packet thread_packet_t;
 
 typedef struct thread_video thread_video_t;
 
+#define VIDEO_THREAD_LATENCY_BUCKETS 8
+
+struct video_thread_stats
+{
+   bool triple_buffer;
+   unsigned pushed;     /* Frames handed to the video thread. */
+   unsigned dropped;    /* Frames dropped as the video thread was busy. */
+   unsigned superseded; /* Frames replaced by a newer one before shown. */
+   unsigned rendered;
+   unsigned copied;     /* Frames copied out of the core's buffer. */
+   unsigned zero_copy;  /* Frames the core rendered into our buffer. */
+
+   /* Time from a frame being pushed to it being rendered.
+    * Bucket i counts frames which took less than (1 << i) ms,
+    * the last one all frames which took longer. */
+   unsigned latency[VIDEO_THREAD_LATENCY_BUCKETS];
+};
+
 /**
  * video_init_thread:
  * @out_driver                : Output video driver
@@ -71,6 +89,20 @@ void *video_thread_get_ptr(const video_driver_t **drv);
 
 const char *video_thread_get_ident(void);
 
+/**
+ * video_thread_get_stats:
+ * @stats                     : Output statistics.
+ *
+ * Gets frame handoff statistics of the threaded video wrapper,
+ * for either the single buffered or the triple buffered mode.
+ * Counts start at zero when the video driver is initialized.
+ * Call from the main thread.
+ *
+ * Returns: true (1) if the threaded video wrapper is active,
+ * otherwise false (0).
+ **/
+bool video_thread_get_stats(struct video_thread_stats *stats);
+
 bool video_thread_font_init(
       const void **font_driver,
       void **font_handle,
@@ -530,6 +530,7 @@ STATE TRACKER
 FIFO BUFFER
 ============================================================ */
 #include "../libretro-common/queues/fifo_queue.c"
+#include "../libretro-common/queues/spsc_fifo.c"
 
 /*============================================================
 AUDIO RESAMPLER
@@ -539,6 +540,7 @@ AUDIO RESAMPLER
 #include "../audio/drivers_resampler/nearest_resampler.c"
 #include "../audio/drivers_resampler/null_resampler.c"
 #include "../audio/drivers_resampler/cc_resampler.c"
+#include "../audio/drivers_resampler/polyphase_resampler.c"
 
 /*============================================================
 CAMERA
@@ -677,6 +679,7 @@ DYNAMIC
 #include "../gfx/video_filter.c"
 #include "../gfx/video_frame.c"
 #include "../audio/audio_dsp_filter.c"
+#include "../audio/audio_telemetry.c"
 
 /*============================================================
 CORES
@@ -838,6 +841,10 @@ THREAD
 #include "../audio/audio_thread_wrapper.c"
 #endif
 
+#ifdef HAVE_THREADS
+#include "../libretro-common/rthreads/rthread_pool.c"
+#endif
+
 
 /*============================================================
 NETPLAY
@@ -846,6 +853,9 @@ NETPLAY
 #include "../network/netplay/netplay_net.c"
 #include "../network/netplay/netplay_spectate.c"
 #include "../network/netplay/netplay_common.c"
+#include "../network/netplay/netplay_io.c"
+#include "../network/netplay/netplay_broadcast.c"
+#include "../network/netplay/netplay_sync.c"
 #include "../network/netplay/netplay.c"
 #include "../libretro-common/net/net_compat.c"
 #include "../libretro-common/net/net_socket.c"
@@ -3359,6 +3359,12 @@ const char *msg_hash_to_str_us(enum msg_hash_enums msg)
          return "Could not process ZIP file.";
       case MSG_SCANNING_OF_DIRECTORY_FINISHED:
          return "Scanning of directory finished";
+      case MSG_FILES:
+         return "files";
+      case MSG_FILES_PER_SECOND:
+         return "files/s";
+      case MSG_MEGABYTES_PER_SECOND:
+         return "MB/s";
       case MSG_SCANNING:
          return "Scanning";
       case MSG_REDIRECTING_CHEATFILE_TO:
@@ -3306,6 +3306,12 @@ const char *msg_hash_to_str_us(enum msg_hash_enums msg)
          return "Côüld not proçess ZIP fîlè.";
       case MSG_SCANNING_OF_DIRECTORY_FINISHED:
          return "Sçâñning of dirêctõry fiñished";
+      case MSG_FILES:
+         return "fîlës";
+      case MSG_FILES_PER_SECOND:
+         return "fîlës/s";
+      case MSG_MEGABYTES_PER_SECOND:
+         return "MB/s";
       case MSG_SCANNING:
          return "Sçanñing";
       case MSG_REDIRECTING_CHEATFILE_TO:
@@ -25,8 +25,11 @@
 #include <string.h>
 
 #include <retro_inline.h>
+#include <retro_miscellaneous.h>
 #include <algorithms/mismatch.h>
 #include <compat/intrinsics.h>
+#include <features/features_cpu.h>
+#include <features/features_target.h>
 
 #if defined(__x86_64__) || defined(__i386__) || defined(__i486__) || defined(__i686__)
 #define CPU_X86
@@ -37,36 +40,27 @@
 #define NO_UNALIGNED_MEM
 #endif
 
-#if __SSE2__
+#if defined(RETRO_HAVE_TARGET_X86)
+#define HAVE_MISMATCH_SSE2
+#define HAVE_MISMATCH_AVX2
+#ifdef RETRO_HAVE_TARGET_AVX512
+#define HAVE_MISMATCH_AVX512
+#endif
+#include <immintrin.h>
+#elif __SSE2__
+#define HAVE_MISMATCH_SSE2
 #include <emmintrin.h>
 #endif
 
+typedef size_t (*mismatch_func_t)(const uint16_t *a, const uint16_t *b);
+/* The find_same kernels stop looking once they are past @limit. */
+typedef size_t (*mismatch_limit_func_t)(const uint16_t *a,
+      const uint16_t *b, size_t limit);
+
 /* There's no equivalent in libc, you'd think so ...
  * std::mismatch exists, but it's not optimized at all. */
-size_t find_change(const uint16_t *a, const uint16_t *b)
+static size_t find_change_generic(const uint16_t *a, const uint16_t *b)
 {
-#if __SSE2__
-   const __m128i *a128 = (const __m128i*)a;
-   const __m128i *b128 = (const __m128i*)b;
-   
-   for (;;)
-   {
-      __m128i v0    = _mm_loadu_si128(a128);
-      __m128i v1    = _mm_loadu_si128(b128);
-      __m128i c     = _mm_cmpeq_epi32(v0, v1);
-      uint32_t mask = _mm_movemask_epi8(c);
-
-      if (mask != 0xffff) /* Something has changed, figure out where. */
-      {
-         size_t ret = (((uint8_t*)a128 - (uint8_t*)a) |
-               (compat_ctz(~mask))) >> 1;
-         return ret | (a[ret] == b[ret]);
-      }
-
-      a128++;
-      b128++;
-   }
-#else
    const uint16_t *a_org = a;
 #ifdef NO_UNALIGNED_MEM
    while (((uintptr_t)a & (sizeof(size_t) - 1)) && *a == *b)
@@ -95,10 +89,10 @@ size_t find_change(const uint16_t *a, const uint16_t *b)
       }
    }
    return a - a_org;
-#endif
 }
 
-size_t find_same(const uint16_t *a, const uint16_t *b)
+static size_t find_same_generic(const uint16_t *a, const uint16_t *b,
+      size_t limit)
 {
    const uint16_t *a_org = a;
 #ifdef NO_UNALIGNED_MEM
@@ -123,6 +117,8 @@ size_t find_same(const uint16_t *a, const uint16_t *b)
       
       while (*a_big != *b_big)
       {
+         if ((size_t)((const uint16_t*)a_big - a_org) > limit)
+            return limit;
          a_big++;
          b_big++;
       }
@@ -135,5 +131,221 @@ size_t find_same(const uint16_t *a, const uint16_t *b)
          b--;
       }
    }
-   return a - a_org;
+   return MIN((size_t)(a - a_org), limit);
+}
+
+/* Set by mismatch_init() before any other thread calls in, so that
+ * the calls themselves don't have to synchronize. */
+static mismatch_func_t find_change_func = find_change_generic;
+static mismatch_limit_func_t find_same_func = find_same_generic;
+
+/* The vector versions compare the same 32-bit pairs as the
+ * generic code, so they return exactly the same results.
+ *
+ * 'ret' is the offset of the first mismatching (or matching)
+ * pair in uint16 units. */
+
+/* The pair at 'ret' differs, but its first half might not. */
+static INLINE size_t find_change_finish(const uint16_t *a,
+      const uint16_t *b, size_t ret)
+{
+   return ret | (a[ret] == b[ret]);
+}
+
+/* Also catch a matching word right before the matching pair. */
+static INLINE size_t find_same_finish(const uint16_t *a,
+      const uint16_t *b, size_t ret, size_t limit)
+{
+   if (ret && a[ret - 1] == b[ret - 1])
+      ret--;
+   return MIN(ret, limit);
+}
+
+#ifdef HAVE_MISMATCH_SSE2
+RETRO_TARGET("sse2")
+static size_t find_change_sse2(const uint16_t *a, const uint16_t *b)
+{
+   const __m128i *a128 = (const __m128i*)a;
+   const __m128i *b128 = (const __m128i*)b;
+   
+   for (;;)
+   {
+      __m128i v0    = _mm_loadu_si128(a128);
+      __m128i v1    = _mm_loadu_si128(b128);
+      __m128i c     = _mm_cmpeq_epi32(v0, v1);
+      uint32_t mask = _mm_movemask_epi8(c);
+
+      if (mask != 0xffff) /* Something has changed, figure out where. */
+      {
+         size_t ret = (((uint8_t*)a128 - (uint8_t*)a) |
+               (compat_ctz(~mask))) >> 1;
+         return find_change_finish(a, b, ret);
+      }
+
+      a128++;
+      b128++;
+   }
+}
+
+RETRO_TARGET("sse2")
+static size_t find_same_sse2(const uint16_t *a, const uint16_t *b,
+      size_t limit)
+{
+   size_t pos;
+
+   for (pos = 0; pos <= limit; pos += 8)
+   {
+      __m128i v0    = _mm_loadu_si128((const __m128i*)(a + pos));
+      __m128i v1    = _mm_loadu_si128((const __m128i*)(b + pos));
+      __m128i c     = _mm_cmpeq_epi32(v0, v1);
+      uint32_t mask = _mm_movemask_ps(_mm_castsi128_ps(c));
+
+      if (mask)
+         return find_same_finish(a, b,
+               pos + compat_ctz(mask) * 2, limit);
+   }
+
+   return limit;
+}
+#endif
+
+#ifdef HAVE_MISMATCH_AVX2
+RETRO_TARGET("avx2")
+static size_t find_change_avx2(const uint16_t *a, const uint16_t *b)
+{
+   const __m256i *a256 = (const __m256i*)a;
+   const __m256i *b256 = (const __m256i*)b;
+
+   for (;;)
+   {
+      __m256i v0    = _mm256_loadu_si256(a256);
+      __m256i v1    = _mm256_loadu_si256(b256);
+      __m256i c     = _mm256_cmpeq_epi32(v0, v1);
+      uint32_t mask = _mm256_movemask_epi8(c);
+
+      if (mask != 0xffffffffu)
+      {
+         size_t ret = (((uint8_t*)a256 - (uint8_t*)a) |
+               (compat_ctz(~mask))) >> 1;
+         return find_change_finish(a, b, ret);
+      }
+
+      a256++;
+      b256++;
+   }
+}
+
+RETRO_TARGET("avx2")
+static size_t find_same_avx2(const uint16_t *a, const uint16_t *b,
+      size_t limit)
+{
+   size_t pos;
+
+   for (pos = 0; pos <= limit; pos += 16)
+   {
+      __m256i v0    = _mm256_loadu_si256((const __m256i*)(a + pos));
+      __m256i v1    = _mm256_loadu_si256((const __m256i*)(b + pos));
+      __m256i c     = _mm256_cmpeq_epi32(v0, v1);
+      uint32_t mask = _mm256_movemask_ps(_mm256_castsi256_ps(c));
+
+      if (mask)
+         return find_same_finish(a, b,
+               pos + compat_ctz(mask) * 2, limit);
+   }
+
+   return limit;
+}
+#endif
+
+#ifdef HAVE_MISMATCH_AVX512
+RETRO_TARGET("avx512f")
+static size_t find_change_avx512(const uint16_t *a, const uint16_t *b)
+{
+   const uint8_t *a8 = (const uint8_t*)a;
+   const uint8_t *b8 = (const uint8_t*)b;
+
+   for (;;)
+   {
+      __m512i v0  = _mm512_loadu_si512((const void*)a8);
+      __m512i v1  = _mm512_loadu_si512((const void*)b8);
+      __mmask16 m = _mm512_cmpneq_epi32_mask(v0, v1);
+
+      if (m)
+      {
+         size_t ret = ((a8 - (const uint8_t*)a) >> 1)
+            + compat_ctz(m) * 2;
+         return find_change_finish(a, b, ret);
+      }
+
+      a8 += 64;
+      b8 += 64;
+   }
+}
+
+RETRO_TARGET("avx512f")
+static size_t find_same_avx512(const uint16_t *a, const uint16_t *b,
+      size_t limit)
+{
+   size_t pos;
+
+   for (pos = 0; pos <= limit; pos += 32)
+   {
+      __m512i v0  = _mm512_loadu_si512((const void*)(a + pos));
+      __m512i v1  = _mm512_loadu_si512((const void*)(b + pos));
+      __mmask16 m = _mm512_cmpeq_epi32_mask(v0, v1);
+
+      if (m)
+         return find_same_finish(a, b, pos + compat_ctz(m) * 2, limit);
+   }
+
+   return limit;
+}
+#endif
+
+void mismatch_init(uint64_t simd)
+{
+   mismatch_func_t change = find_change_generic;
+   mismatch_limit_func_t same = find_same_generic;
+
+#ifdef HAVE_MISMATCH_SSE2
+   if (simd & RETRO_SIMD_SSE2)
+   {
+      change = find_change_sse2;
+      same   = find_same_sse2;
+   }
+#endif
+#ifdef HAVE_MISMATCH_AVX2
+   if (simd & RETRO_SIMD_AVX2)
+   {
+      change = find_change_avx2;
+      same   = find_same_avx2;
+   }
+#endif
+#ifdef HAVE_MISMATCH_AVX512
+   if (simd & RETRO_SIMD_AVX512)
+   {
+      change = find_change_avx512;
+      same   = find_same_avx512;
+   }
+#endif
+
+   (void)simd;
+
+   find_change_func = change;
+   find_same_func   = same;
+}
+
+size_t find_change(const uint16_t *a, const uint16_t *b)
+{
+   return find_change_func(a, b);
+}
+
+size_t find_same(const uint16_t *a, const uint16_t *b)
+{
+   return find_same_func(a, b, (size_t)-1);
+}
+
+size_t find_same_limit(const uint16_t *a, const uint16_t *b, size_t limit)
+{
+   return find_same_func(a, b, limit);
 }
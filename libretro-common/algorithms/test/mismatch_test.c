@@ -0,0 +1,223 @@
+/* Copyright  (C) 2010-2016 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (mismatch_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Fuzzes every find_change/find_same implementation the CPU
+ * supports against the generic one, then measures how fast
+ * each of them walks through sparse and dense changes. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithms/mismatch.h>
+#include <features/features_cpu.h>
+#include <retro_miscellaneous.h>
+
+#define FUZZ_ROUNDS   20000
+#define FUZZ_MAX_LEN  2048
+#define BENCH_SIZE    (16 << 20)
+#define BENCH_ROUNDS  8
+/* Room for the terminating words and the widest vector read. */
+#define PADDING       (64 + 4 * sizeof(uint16_t))
+
+struct mismatch_impl
+{
+   const char *ident;
+   uint64_t simd;
+};
+
+static const struct mismatch_impl impls[] = {
+   { "generic", 0 },
+   { "sse2",    RETRO_SIMD_SSE2 },
+   { "avx2",    RETRO_SIMD_SSE2 | RETRO_SIMD_AVX2 },
+   { "avx512",  RETRO_SIMD_SSE2 | RETRO_SIMD_AVX2 | RETRO_SIMD_AVX512 },
+};
+
+static uint32_t rand_state = 1;
+
+static uint32_t test_rand(void)
+{
+   rand_state = rand_state * 1103515245 + 12345;
+   return rand_state >> 8;
+}
+
+/* Same layout as the rewind buffer: the data, three identical
+ * words to stop find_same and a different one to stop find_change. */
+static void fill_pair(uint16_t *a, uint16_t *b, size_t len, unsigned density)
+{
+   size_t i;
+
+   memset(a, 0, len * sizeof(uint16_t) + PADDING);
+   memset(b, 0, len * sizeof(uint16_t) + PADDING);
+
+   for (i = 0; i < len; i++)
+   {
+      a[i] = test_rand();
+      b[i] = a[i];
+      if (test_rand() % 100 < density)
+         b[i] ^= 1 + (test_rand() & 0x7fff);
+   }
+
+   a[len + 3] = 0;
+   b[len + 3] = 1;
+}
+
+static size_t ref_find_change(const uint16_t *a, const uint16_t *b)
+{
+   size_t i = 0;
+   while (a[i] == b[i])
+      i++;
+   return i;
+}
+
+static bool run_fuzz(const struct mismatch_impl *impl)
+{
+   unsigned round;
+   uint16_t *a = (uint16_t*)malloc((FUZZ_MAX_LEN + 8) * sizeof(uint16_t) + PADDING);
+   uint16_t *b = (uint16_t*)malloc((FUZZ_MAX_LEN + 8) * sizeof(uint16_t) + PADDING);
+   bool ok     = true;
+
+   rand_state = 1;
+
+   for (round = 0; round < FUZZ_ROUNDS && ok; round++)
+   {
+      size_t len       = 1 + test_rand() % FUZZ_MAX_LEN;
+      size_t start     = test_rand() % len;
+      unsigned density = test_rand() % 101;
+      size_t limit     = test_rand() % (len - start + 1);
+      size_t change, same, limited, expect_change, expect_same;
+
+      fill_pair(a, b, len, density);
+
+      mismatch_init(0);
+      expect_change = find_change(a + start, b + start);
+      expect_same   = find_same(a + start, b + start);
+
+      mismatch_init(impl->simd);
+      change        = find_change(a + start, b + start);
+      same          = find_same(a + start, b + start);
+      limited       = find_same_limit(a + start, b + start, limit);
+
+      if (expect_change != ref_find_change(a + start, b + start))
+      {
+         printf("generic find_change is wrong at round %u\n", round);
+         ok = false;
+      }
+
+      if (change != expect_change || same != expect_same)
+      {
+         printf("%s: round %u, len %u, start %u: find_change %u (want %u), "
+               "find_same %u (want %u)\n", impl->ident, round,
+               (unsigned)len, (unsigned)start,
+               (unsigned)change, (unsigned)expect_change,
+               (unsigned)same, (unsigned)expect_same);
+         ok = false;
+      }
+
+      if (limited != MIN(expect_same, limit))
+      {
+         printf("%s: round %u, len %u, start %u: find_same_limit %u "
+               "(want %u with limit %u)\n", impl->ident, round,
+               (unsigned)len, (unsigned)start, (unsigned)limited,
+               (unsigned)MIN(expect_same, limit), (unsigned)limit);
+         ok = false;
+      }
+   }
+
+   free(a);
+   free(b);
+   return ok;
+}
+
+/* Walks the buffers the same way the rewind compressor does. */
+static void run_bench(const struct mismatch_impl *impl,
+      const uint16_t *a, const uint16_t *b, size_t len, const char *desc)
+{
+   unsigned round;
+   retro_time_t start;
+   double secs;
+
+   mismatch_init(impl->simd);
+   start = cpu_features_get_time_usec();
+
+   for (round = 0; round < BENCH_ROUNDS; round++)
+   {
+      size_t pos = 0;
+
+      while (pos < len)
+      {
+         pos += find_change(a + pos, b + pos);
+         if (pos >= len)
+            break;
+         pos += find_same(a + pos, b + pos);
+      }
+   }
+
+   secs = (cpu_features_get_time_usec() - start) / 1000000.0;
+   printf("%-8s %-7s %7.2f GB/s\n", impl->ident, desc,
+         (double)len * sizeof(uint16_t) * BENCH_ROUNDS / secs / 1e9);
+}
+
+int main(void)
+{
+   unsigned i;
+   const size_t len = BENCH_SIZE / sizeof(uint16_t);
+   uint64_t simd    = cpu_features_get();
+   uint16_t *a      = (uint16_t*)malloc(BENCH_SIZE + PADDING);
+   uint16_t *b      = (uint16_t*)malloc(BENCH_SIZE + PADDING);
+   uint16_t *sa     = (uint16_t*)malloc(BENCH_SIZE + PADDING);
+   uint16_t *sb     = (uint16_t*)malloc(BENCH_SIZE + PADDING);
+   bool ok          = true;
+
+   if (!a || !b || !sa || !sb)
+      return 1;
+
+   /* Dense: every other word or so differs.
+    * Sparse: a short run every 64 KB. */
+   fill_pair(a, b, len, 40);
+   fill_pair(sa, sb, len, 0);
+   for (i = 0; i < len; i += 32768)
+      sb[i] ^= 0x5555;
+
+   for (i = 0; i < sizeof(impls) / sizeof(impls[0]); i++)
+   {
+      if ((impls[i].simd & simd) != impls[i].simd)
+      {
+         printf("%-8s not supported by this CPU, skipped\n", impls[i].ident);
+         continue;
+      }
+
+      if (!run_fuzz(&impls[i]))
+         ok = false;
+
+      run_bench(&impls[i], sa, sb, len, "sparse");
+      run_bench(&impls[i], a, b, len, "dense");
+   }
+
+   free(a);
+   free(b);
+   free(sa);
+   free(sb);
+
+   puts(ok ? "All implementations match." : "Mismatches found.");
+   return ok ? 0 : 1;
+}
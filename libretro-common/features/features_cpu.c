@@ -523,7 +523,7 @@ uint64_t cpu_features_get(void)
    const int avx_flags = (1 << 27) | (1 << 28);
 #endif
 
-   char buf[sizeof(" MMX MMXEXT SSE SSE2 SSE3 SSSE3 SS4 SSE4.2 AES AVX AVX2 NEON VMX VMX128 VFPU PS")];
+   char buf[sizeof(" MMX MMXEXT SSE SSE2 SSE3 SSSE3 SS4 SSE4.2 AES AVX AVX2 AVX512 FMA3 NEON VFPv3 VFPv4 VMX VMX128 VFPU PS")];
 
    memset(buf, 0, sizeof(buf));
 
@@ -659,11 +659,21 @@ uint64_t cpu_features_get(void)
          && ((xgetbv_x86(0) & 0x6) == 0x6))
       cpu |= RETRO_SIMD_AVX;
 
+   /* FMA3 uses the YMM state as well. */
+   if ((cpu & RETRO_SIMD_AVX) && (flags[2] & (1 << 12)))
+      cpu |= RETRO_SIMD_FMA3;
+
    if (max_flag >= 7)
    {
       x86_cpuid(7, flags);
-      if (flags[1] & (1 << 5))
+      if ((cpu & RETRO_SIMD_AVX) && (flags[1] & (1 << 5)))
          cpu |= RETRO_SIMD_AVX2;
+
+      /* AVX-512 Foundation, and the OS has to save the
+       * opmask and upper ZMM state on context switches. */
+      if ((cpu & RETRO_SIMD_AVX) && (flags[1] & (1 << 16))
+            && ((xgetbv_x86(0) & 0xe6) == 0xe6))
+         cpu |= RETRO_SIMD_AVX512;
    }
 
    x86_cpuid(0x80000000, flags);
@@ -677,7 +687,8 @@ uint64_t cpu_features_get(void)
          cpu |= RETRO_SIMD_MMXEXT;
    }
 #elif defined(__linux__)
-   if (check_arm_cpu_feature("neon"))
+   /* AArch64 kernels call NEON "asimd". */
+   if (check_arm_cpu_feature("neon") || check_arm_cpu_feature("asimd"))
    {
       cpu |= RETRO_SIMD_NEON;
 #ifdef __ARM_NEON__
@@ -728,6 +739,8 @@ uint64_t cpu_features_get(void)
    if (cpu & RETRO_SIMD_AES)    strlcat(buf, " AES", sizeof(buf));
    if (cpu & RETRO_SIMD_AVX)    strlcat(buf, " AVX", sizeof(buf));
    if (cpu & RETRO_SIMD_AVX2)   strlcat(buf, " AVX2", sizeof(buf));
+   if (cpu & RETRO_SIMD_AVX512) strlcat(buf, " AVX512", sizeof(buf));
+   if (cpu & RETRO_SIMD_FMA3)   strlcat(buf, " FMA3", sizeof(buf));
    if (cpu & RETRO_SIMD_NEON)   strlcat(buf, " NEON", sizeof(buf));
    if (cpu & RETRO_SIMD_VFPV3)  strlcat(buf, " VFPv3", sizeof(buf));
    if (cpu & RETRO_SIMD_VFPV4)  strlcat(buf, " VFPv4", sizeof(buf));
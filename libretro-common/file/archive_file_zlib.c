@@ -197,6 +197,58 @@ static uint32_t zlib_stream_crc32_calculate(uint32_t crc,
    return crc32(crc, data, length);
 }
 
+static uint32_t zlib_stream_crc32_combine(uint32_t crc1,
+      uint32_t crc2, size_t length2)
+{
+   return crc32_combine(crc1, crc2, length2);
+}
+
+static void zlib_stream_compress_block_init(void *data, int level,
+      const uint8_t *dict, uint32_t dict_size)
+{
+   z_stream *stream = (z_stream*)data;
+
+   if (!stream)
+      return;
+
+   deflateInit2(stream, level, Z_DEFLATED, -MAX_WBITS, 8,
+         Z_DEFAULT_STRATEGY);
+   if (dict_size)
+      deflateSetDictionary(stream, dict, dict_size);
+}
+
+static int zlib_stream_compress_block(void *data, bool last)
+{
+   int zstatus;
+   z_stream *stream = (z_stream*)data;
+
+   if (!stream)
+      return -1;
+
+   if (last)
+      return deflate(stream, Z_FINISH) == Z_STREAM_END ? 1 : 0;
+
+   zstatus = deflate(stream, Z_SYNC_FLUSH);
+
+   /* Out of space if it couldn't leave any over. */
+   if (zstatus == Z_OK && stream->avail_in == 0 && stream->avail_out)
+      return 1;
+
+   return 0;
+}
+
+static uint32_t zlib_stream_adler32_calculate(uint32_t adler,
+      const uint8_t *data, size_t length)
+{
+   return adler32(adler, data, length);
+}
+
+static uint32_t zlib_stream_adler32_combine(uint32_t adler1,
+      uint32_t adler2, size_t length2)
+{
+   return adler32_combine(adler1, adler2, length2);
+}
+
 const struct file_archive_file_backend zlib_backend = {
    zlib_stream_new,
    zlib_stream_free,
@@ -212,5 +264,10 @@ const struct file_archive_file_backend zlib_backend = {
    zlib_stream_compress_free,
    zlib_stream_compress_data_to_file,
    zlib_stream_crc32_calculate,
+   zlib_stream_crc32_combine,
+   zlib_stream_compress_block_init,
+   zlib_stream_compress_block,
+   zlib_stream_adler32_calculate,
+   zlib_stream_adler32_combine,
    "zlib"
 };
@@ -176,6 +176,42 @@ int32_t path_get_size(const char *path)
    return -1;
 }
 
+/**
+ * path_get_mtime:
+ * @path               : path
+ *
+ * Gets the last modification time of a file.
+ *
+ * Returns: modification time in seconds since the epoch,
+ * or 0 if it couldn't be determined.
+ */
+int64_t path_get_mtime(const char *path)
+{
+#if defined(_WIN32) && !defined(_XBOX)
+   WIN32_FILE_ATTRIBUTE_DATA attr;
+   ULARGE_INTEGER time;
+
+   if (!GetFileAttributesEx(path, GetFileExInfoStandard, &attr))
+      return 0;
+
+   time.LowPart  = attr.ftLastWriteTime.dwLowDateTime;
+   time.HighPart = attr.ftLastWriteTime.dwHighDateTime;
+
+   /* 100ns intervals since 1601 to seconds since 1970. */
+   return (int64_t)(time.QuadPart / 10000000ULL) - 11644473600LL;
+#elif defined(VITA) || defined(PSP) || defined(__CELLOS_LV2__) || defined(_XBOX)
+   (void)path;
+   return 0;
+#else
+   struct stat buf;
+
+   if (stat(path, &buf) < 0)
+      return 0;
+
+   return (int64_t)buf.st_mtime;
+#endif
+}
+
 /**
  * path_mkdir_norecurse:
  * @dir                : directory
@@ -24,6 +24,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <retro_miscellaneous.h>
 #include <streams/file_stream.h>
 #include <file/archive_file.h>
 
@@ -206,67 +207,96 @@ static unsigned filter_paeth(uint8_t *target,
    return count_sad(target, width);
 }
 
-static bool rpng_save_image(const char *path,
-      const uint8_t *data,
-      unsigned width, unsigned height, unsigned pitch, unsigned bpp)
-{
-   unsigned h;
-   bool ret = true;
-   struct png_ihdr ihdr = {0};
-
-   const struct file_archive_file_backend *stream_backend = NULL;
-   size_t encode_buf_size  = 0;
-   uint8_t *encode_buf     = NULL;
-   uint8_t *deflate_buf    = NULL;
-   uint8_t *rgba_line      = NULL;
-   uint8_t *up_filtered    = NULL;
-   uint8_t *sub_filtered   = NULL;
-   uint8_t *avg_filtered   = NULL;
-   uint8_t *paeth_filtered = NULL;
-   uint8_t *prev_encoded   = NULL;
-   uint8_t *encode_target  = NULL;
-   void *stream            = NULL;
-   RFILE *file             = filestream_open(path, RFILE_MODE_WRITE, -1);
-   if (!file)
-      GOTO_END_ERROR();
+/* Rows are filtered and deflated in blocks of about this many bytes,
+ * when there are threads to share them. Each block is a separate run
+ * of raw deflate, primed with the input before it and flushed to a
+ * byte boundary, so that they join up into one zlib stream. Every
+ * block goes into its own IDAT chunk. */
+#define RPNG_BLOCK_SIZE (256 * 1024)
+#define RPNG_DICT_SIZE  (32 * 1024)
 
-   stream_backend = file_archive_get_default_file_backend();
-
-   if (filestream_write(file, png_magic, sizeof(png_magic)) != sizeof(png_magic))
-      GOTO_END_ERROR();
-
-   ihdr.width = width;
-   ihdr.height = height;
-   ihdr.depth = 8;
-   ihdr.color_type = bpp == sizeof(uint32_t) ? 6 : 2; /* RGBA or RGB */
-   if (!png_write_ihdr(file, &ihdr))
-      GOTO_END_ERROR();
-
-   encode_buf_size = (width * bpp + 1) * height;
-   encode_buf = (uint8_t*)malloc(encode_buf_size);
-   if (!encode_buf)
-      GOTO_END_ERROR();
+struct rpng_block
+{
+   unsigned first_row;
+   unsigned rows;
+   /* IDAT chunk, starting with room for its length and type. */
+   uint8_t *chunk;
+   size_t chunk_size;
+   uint32_t adler;
+   bool ok;
+};
+
+struct rpng_encoder
+{
+   const struct file_archive_file_backend *backend;
+   const uint8_t *data;
+   unsigned width;
+   unsigned height;
+   unsigned pitch;
+   unsigned bpp;
+   int level;
+   size_t line_size;
+   uint8_t *encode_buf;
+   /* Six lines per thread, see rpng_filter_block(). */
+   uint8_t *lines;
+   struct rpng_block *blocks;
+   unsigned num_blocks;
+};
+
+/* Runs @job on every block. A job holds the pool until all blocks
+ * are done, so callers pass a pool nothing time-critical waits on. */
+static void rpng_run(struct rpng_encoder *enc, rthread_pool_t *pool,
+      rthread_pool_job_t job)
+{
+#ifdef HAVE_THREADS
+   rthread_pool_run(pool, job, enc, enc->num_blocks);
+#else
+   unsigned i;
 
-   prev_encoded = (uint8_t*)calloc(1, width * bpp);
-   if (!prev_encoded)
-      GOTO_END_ERROR();
+   for (i = 0; i < enc->num_blocks; i++)
+      job(enc, i, 0);
+#endif
+}
 
-   rgba_line      = (uint8_t*)malloc(width * bpp);
-   up_filtered    = (uint8_t*)malloc(width * bpp);
-   sub_filtered   = (uint8_t*)malloc(width * bpp);
-   avg_filtered   = (uint8_t*)malloc(width * bpp);
-   paeth_filtered = (uint8_t*)malloc(width * bpp);
-   if (!rgba_line || !up_filtered || !sub_filtered || !avg_filtered || !paeth_filtered)
-      GOTO_END_ERROR();
+static void copy_line(const struct rpng_encoder *enc,
+      uint8_t *dst, const uint8_t *src)
+{
+   if (enc->bpp == sizeof(uint32_t))
+      copy_argb_line(dst, (const uint32_t*)src, enc->width);
+   else
+      copy_bgr24_line(dst, src, enc->width);
+}
 
-   encode_target = encode_buf;
-   for (h = 0; h < height;
-         h++, encode_target += width * bpp, data += pitch)
+static void rpng_filter_block(void *userdata, unsigned item, unsigned thread)
+{
+   unsigned h;
+   struct rpng_encoder *enc       = (struct rpng_encoder*)userdata;
+   const struct rpng_block *block = &enc->blocks[item];
+   unsigned width                 = enc->width;
+   unsigned bpp                   = enc->bpp;
+   size_t line_size               = enc->line_size;
+   uint8_t *rgba_line             = enc->lines + thread * 6 * line_size;
+   uint8_t *prev_encoded          = rgba_line      + line_size;
+   uint8_t *up_filtered           = prev_encoded   + line_size;
+   uint8_t *sub_filtered          = up_filtered    + line_size;
+   uint8_t *avg_filtered          = sub_filtered   + line_size;
+   uint8_t *paeth_filtered        = avg_filtered   + line_size;
+   const uint8_t *data            = enc->data
+      + (size_t)block->first_row * enc->pitch;
+   uint8_t *encode_target         = enc->encode_buf
+      + (size_t)block->first_row * (line_size + 1);
+
+   /* Filters look at the row above, which belongs to the block
+    * before this one. */
+   if (block->first_row)
+      copy_line(enc, prev_encoded, data - enc->pitch);
+   else
+      memset(prev_encoded, 0, line_size);
+
+   for (h = 0; h < block->rows;
+         h++, encode_target += line_size, data += enc->pitch)
    {
-      if (bpp == sizeof(uint32_t))
-         copy_argb_line(rgba_line, (const uint32_t*)data, width);
-      else
-         copy_bgr24_line(rgba_line, data, width);
+      copy_line(enc, rgba_line, data);
 
       /* Try every filtering method, and choose the method
        * which has most entries as zero.
@@ -319,60 +349,175 @@ static bool rpng_save_image(const char *path,
          memcpy(prev_encoded, rgba_line, width * bpp);
       }
    }
+}
+
+static void rpng_deflate_block(void *userdata, unsigned item, unsigned thread)
+{
+   size_t offset, size, dict_size;
+   struct rpng_encoder *enc                       = (struct rpng_encoder*)userdata;
+   unsigned index                                 = item;
+   struct rpng_block *block                       = &enc->blocks[index];
+   const struct file_archive_file_backend *backend = enc->backend;
+   bool first                                     = index == 0;
+   bool last                                      = index == enc->num_blocks - 1;
+   uint8_t *out                                   = block->chunk + 8;
+   void *stream                                   = backend->stream_new();
+
+   (void)thread;
+
+   if (!stream)
+      return;
+
+   offset    = (size_t)block->first_row * (enc->line_size + 1);
+   size      = (size_t)block->rows      * (enc->line_size + 1);
+   dict_size = offset < RPNG_DICT_SIZE ? offset : RPNG_DICT_SIZE;
+
+   /* The zlib header, as deflate itself would write it. */
+   if (first)
+   {
+      unsigned flags  = enc->level < 2 ? 0
+         : enc->level < 6 ? 1 : enc->level == 6 ? 2 : 3;
+      unsigned header = (0x78 << 8) | (flags << 6);
+      header += 31 - (header % 31);
+      *out++  = (uint8_t)(header >> 8);
+      *out++  = (uint8_t)(header >> 0);
+   }
+
+   backend->stream_set(stream, size, size + size / 8 + 64,
+         enc->encode_buf + offset, out);
+   backend->stream_compress_block_init(stream, enc->level,
+         enc->encode_buf + offset - dict_size, dict_size);
+
+   block->ok = backend->stream_compress_block(stream, last) == 1;
+   out      += backend->stream_get_total_out(stream);
+   block->adler = backend->stream_adler32_calculate(1,
+         enc->encode_buf + offset, size);
+
+   backend->stream_compress_free(stream);
+   backend->stream_free(stream);
+   free(stream);
 
-   deflate_buf = (uint8_t*)malloc(encode_buf_size * 2); /* Just to be sure. */
-   if (!deflate_buf)
+   /* The checksum of the whole stream is filled in later. */
+   if (last)
+      out += 4;
+
+   block->chunk_size = out - block->chunk;
+}
+
+static bool rpng_save_image(const char *path,
+      const uint8_t *data,
+      unsigned width, unsigned height, unsigned pitch, unsigned bpp,
+      int level, rthread_pool_t *pool)
+{
+   unsigned i, rows, threads;
+   bool ret                 = true;
+   struct png_ihdr ihdr     = {0};
+   struct rpng_encoder enc  = {0};
+   RFILE *file              = filestream_open(path, RFILE_MODE_WRITE, -1);
+   if (!file)
       GOTO_END_ERROR();
 
-   stream = stream_backend->stream_new();
+   enc.backend = file_archive_get_default_file_backend();
+   enc.data    = data;
+   enc.width   = width;
+   enc.height  = height;
+   enc.pitch   = pitch;
+   enc.bpp     = bpp;
+   enc.level   = level < 0 ? 0 : level > 9 ? 9 : level;
 
-   if (!stream)
+   if (!width || !height)
       GOTO_END_ERROR();
 
-   stream_backend->stream_set(
-         stream,
-         encode_buf_size,
-         encode_buf_size * 2,
-         encode_buf,
-         deflate_buf + 8);
+   if (filestream_write(file, png_magic, sizeof(png_magic)) != sizeof(png_magic))
+      GOTO_END_ERROR();
 
-   stream_backend->stream_compress_init(stream, 9);
+   ihdr.width = width;
+   ihdr.height = height;
+   ihdr.depth = 8;
+   ihdr.color_type = bpp == sizeof(uint32_t) ? 6 : 2; /* RGBA or RGB */
+   if (!png_write_ihdr(file, &ihdr))
+      GOTO_END_ERROR();
 
-   if (stream_backend->stream_compress_data_to_file(stream) != 1)
-   {
-      stream_backend->stream_compress_free(stream);
+#ifdef HAVE_THREADS
+   threads = rthread_pool_threads(pool);
+#else
+   threads = 1;
+#endif
+
+   /* Splitting up costs a little compression, don't unless there
+    * are threads to do it. */
+   enc.line_size  = width * bpp;
+   rows           = height;
+   if (threads > 1)
+      rows        = RPNG_BLOCK_SIZE / (enc.line_size + 1) + 1;
+   enc.num_blocks = (height + rows - 1) / rows;
+
+   enc.encode_buf = (uint8_t*)malloc((enc.line_size + 1) * height);
+   enc.lines      = (uint8_t*)calloc(6 * threads, enc.line_size);
+   enc.blocks     = (struct rpng_block*)calloc(enc.num_blocks,
+         sizeof(*enc.blocks));
+   if (!enc.encode_buf || !enc.lines || !enc.blocks)
       GOTO_END_ERROR();
+
+   for (i = 0; i < enc.num_blocks; i++)
+   {
+      size_t size;
+      struct rpng_block *block = &enc.blocks[i];
+
+      block->first_row = i * rows;
+      block->rows      = MIN(rows, height - block->first_row);
+
+      /* Header, zlib header and checksum, and what deflate adds to
+       * data it can't compress. */
+      size         = (size_t)block->rows * (enc.line_size + 1);
+      block->chunk = (uint8_t*)malloc(8 + 2 + size + size / 8 + 64 + 4);
+      if (!block->chunk)
+         GOTO_END_ERROR();
    }
 
-   stream_backend->stream_compress_free(stream);
+   /* All rows have to be filtered before any block can use the
+    * end of the one before it as its dictionary. */
+   rpng_run(&enc, pool, rpng_filter_block);
+   rpng_run(&enc, pool, rpng_deflate_block);
 
-   memcpy(deflate_buf + 4, "IDAT", 4);
-   dword_write_be(deflate_buf + 0,        ((uint32_t)stream_backend->stream_get_total_out(stream)));
-   if (!png_write_idat(file, deflate_buf, ((size_t)stream_backend->stream_get_total_out(stream) + 8)))
-      GOTO_END_ERROR();
+   for (i = 0; i < enc.num_blocks; i++)
+   {
+      struct rpng_block *block = &enc.blocks[i];
+
+      if (!block->ok)
+         GOTO_END_ERROR();
+
+      if (i)
+         enc.blocks[0].adler = enc.backend->stream_adler32_combine(
+               enc.blocks[0].adler, block->adler,
+               (size_t)block->rows * (enc.line_size + 1));
+   }
+
+   dword_write_be(enc.blocks[enc.num_blocks - 1].chunk
+         + enc.blocks[enc.num_blocks - 1].chunk_size - 4,
+         enc.blocks[0].adler);
+
+   for (i = 0; i < enc.num_blocks; i++)
+   {
+      struct rpng_block *block = &enc.blocks[i];
+
+      memcpy(block->chunk + 4, "IDAT", 4);
+      dword_write_be(block->chunk + 0, (uint32_t)(block->chunk_size - 8));
+      if (!png_write_idat(file, block->chunk, block->chunk_size))
+         GOTO_END_ERROR();
+   }
 
    if (!png_write_iend(file))
       GOTO_END_ERROR();
 
 end:
    filestream_close(file);
-   free(encode_buf);
-   free(deflate_buf);
-   free(rgba_line);
-   free(prev_encoded);
-   free(up_filtered);
-   free(sub_filtered);
-   free(avg_filtered);
-   free(paeth_filtered);
-
-   if (stream_backend)
-   {
-      if (stream)
-      {
-         if (stream_backend->stream_free)
-            stream_backend->stream_free(stream);
-      }
-   }
+   if (enc.blocks)
+      for (i = 0; i < enc.num_blocks; i++)
+         free(enc.blocks[i].chunk);
+   free(enc.blocks);
+   free(enc.encode_buf);
+   free(enc.lines);
    return ret;
 }
 
@@ -380,12 +525,28 @@ bool rpng_save_image_argb(const char *path, const uint32_t *data,
       unsigned width, unsigned height, unsigned pitch)
 {
    return rpng_save_image(path, (const uint8_t*)data,
-         width, height, pitch, sizeof(uint32_t));
+         width, height, pitch, sizeof(uint32_t), 9, NULL);
 }
 
 bool rpng_save_image_bgr24(const char *path, const uint8_t *data,
       unsigned width, unsigned height, unsigned pitch)
 {
    return rpng_save_image(path, (const uint8_t*)data,
-         width, height, pitch, 3);
+         width, height, pitch, 3, 9, NULL);
+}
+
+bool rpng_save_image_argb_ext(const char *path, const uint32_t *data,
+      unsigned width, unsigned height, unsigned pitch,
+      int level, rthread_pool_t *pool)
+{
+   return rpng_save_image(path, (const uint8_t*)data,
+         width, height, pitch, sizeof(uint32_t), level, pool);
+}
+
+bool rpng_save_image_bgr24_ext(const char *path, const uint8_t *data,
+      unsigned width, unsigned height, unsigned pitch,
+      int level, rthread_pool_t *pool)
+{
+   return rpng_save_image(path, (const uint8_t*)data,
+         width, height, pitch, 3, level, pool);
 }
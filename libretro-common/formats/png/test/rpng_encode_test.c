@@ -0,0 +1,204 @@
+/* Copyright  (C) 2010-2016 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (rpng_encode_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Encodes a screenshot-sized frame at a few deflate levels, on the
+ * calling thread and split between threads, decodes every file again
+ * and compares it to the input. Prints times and sizes.
+ *
+ * Usage: rpng_encode_test [threads] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <features/features_cpu.h>
+#include <file/nbio.h>
+#include <formats/rpng.h>
+#include <formats/image.h>
+#include <retro_miscellaneous.h>
+#include <retro_test.h>
+#include <rthreads/rthread_pool.h>
+
+#define TEST_WIDTH  1920
+#define TEST_HEIGHT 1080
+#define TEST_PATH   "/tmp/rpng_encode_test.png"
+
+static const int levels[] = { 1, 6, 9 };
+
+static bool load_image_argb(const char *path, uint32_t **data,
+      unsigned *width, unsigned *height)
+{
+   int retval;
+   size_t file_len;
+   bool              ret = false;
+   rpng_t          *rpng = NULL;
+   void             *ptr = NULL;
+   struct nbio_t* handle = (struct nbio_t*)nbio_open(path, NBIO_READ);
+
+   if (!handle)
+      return false;
+
+   nbio_begin_read(handle);
+   while (!nbio_iterate(handle));
+
+   ptr  = nbio_get_ptr(handle, &file_len);
+   rpng = rpng_alloc();
+
+   if (!ptr || !rpng || !rpng_set_buf_ptr(rpng, (uint8_t*)ptr)
+         || !rpng_start(rpng))
+      goto end;
+
+   while (rpng_iterate_image(rpng));
+
+   if (!rpng_is_valid(rpng))
+      goto end;
+
+   do
+   {
+      retval = rpng_process_image(rpng,
+            (void**)data, file_len, width, height);
+   } while (retval == IMAGE_PROCESS_NEXT);
+
+   ret = retval != IMAGE_PROCESS_ERROR && retval != IMAGE_PROCESS_ERROR_END;
+
+end:
+   nbio_free(handle);
+   if (rpng)
+      rpng_free(rpng);
+   return ret;
+}
+
+/* Gradients with blocks of noise, somewhere between a rendered
+ * game and a photo for deflate. */
+static void gen_frame(uint8_t *frame, unsigned bpp)
+{
+   unsigned x, y, i;
+   uint32_t seed = 1;
+
+   for (y = 0; y < TEST_HEIGHT; y++)
+   {
+      for (x = 0; x < TEST_WIDTH; x++)
+      {
+         uint32_t col = ((x * 255 / TEST_WIDTH) << 16)
+            | ((y * 255 / TEST_HEIGHT) << 8) | ((x ^ y) & 0xff);
+
+         seed = seed * 1664525 + 1013904223;
+         if (((x / 64) + (y / 64)) % 5 == 0)
+            col = seed;
+         else
+            col |= 0xff000000u;
+
+         for (i = 0; i < bpp; i++)
+            frame[(y * TEST_WIDTH + x) * bpp + i] = col >> (8 * i);
+      }
+   }
+}
+
+static bool check_image(const uint8_t *frame, unsigned bpp)
+{
+   unsigned width, height, i;
+   uint32_t *data = NULL;
+   bool ret       = false;
+
+   if (!load_image_argb(TEST_PATH, &data, &width, &height))
+      return false;
+
+   if (width == TEST_WIDTH && height == TEST_HEIGHT)
+   {
+      for (i = 0; i < TEST_WIDTH * TEST_HEIGHT; i++)
+      {
+         const uint8_t *px = frame + i * bpp;
+         uint32_t col      = px[0] | (px[1] << 8) | (px[2] << 16)
+            | (bpp == 4 ? (uint32_t)px[3] << 24 : 0xff000000u);
+         if (data[i] != col)
+            break;
+      }
+      ret = i == TEST_WIDTH * TEST_HEIGHT;
+   }
+
+   free(data);
+   return ret;
+}
+
+static void test_encode(rthread_pool_t *pool, unsigned bpp)
+{
+   unsigned l;
+   uint8_t *frame = (uint8_t*)malloc(TEST_WIDTH * TEST_HEIGHT * bpp);
+
+   gen_frame(frame, bpp);
+
+   for (l = 0; l < ARRAY_SIZE(levels); l++)
+   {
+      bool ok, same;
+      FILE *file;
+      retro_time_t start = cpu_features_get_time_usec();
+
+      if (bpp == 4)
+         ok = rpng_save_image_argb_ext(TEST_PATH, (const uint32_t*)frame,
+               TEST_WIDTH, TEST_HEIGHT, TEST_WIDTH * 4, levels[l], pool);
+      else
+         ok = rpng_save_image_bgr24_ext(TEST_PATH, frame,
+               TEST_WIDTH, TEST_HEIGHT, TEST_WIDTH * 3, levels[l], pool);
+
+      start = cpu_features_get_time_usec() - start;
+
+      same = ok && check_image(frame, bpp);
+      CHECK(same, "%s level %d, %u threads: %s",
+            bpp == 4 ? "ARGB8888" : "BGR24", levels[l],
+            rthread_pool_threads(pool),
+            ok ? "image differs" : "could not save");
+      if (!same)
+         continue;
+
+      file = fopen(TEST_PATH, "rb");
+      fseek(file, 0, SEEK_END);
+      printf("%-8s level %d, %2u threads: %7.1f ms, %8ld bytes\n",
+            bpp == 4 ? "ARGB8888" : "BGR24", levels[l],
+            rthread_pool_threads(pool), start / 1000.0,
+            ftell(file));
+      fclose(file);
+   }
+
+   remove(TEST_PATH);
+   free(frame);
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned threads = argc > 1 ? strtoul(argv[1], NULL, 0)
+      : cpu_features_get_core_amount();
+   rthread_pool_t *pool;
+
+   if (threads < 2)
+      threads = 2;
+   pool = rthread_pool_new(threads);
+
+   test_encode(NULL, 3);
+   test_encode(pool, 3);
+   test_encode(NULL, 4);
+   test_encode(pool, 4);
+
+   rthread_pool_free(pool);
+
+   return test_result();
+}
@@ -26,45 +26,1737 @@
 #include <string.h>
 
 #include <retro_inline.h>
+#include <libretro.h>
+#include <features/features_cpu.h>
+#include <features/features_target.h>
 
 #include <gfx/scaler/pixconv.h>
 
-#ifdef SCALER_NO_SIMD
-#undef __SSE2__
+#ifndef SCALER_NO_SIMD
+#if defined(RETRO_HAVE_TARGET_X86)
+#define HAVE_PIXCONV_SSE2
+#define HAVE_PIXCONV_SSSE3
+#define HAVE_PIXCONV_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#define HAVE_PIXCONV_SSE2
+#include <emmintrin.h>
+#endif
+
+#if (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(VITA)
+#define HAVE_PIXCONV_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+#define YUV_SHIFT 6
+#define YUV_OFFSET (1 << (YUV_SHIFT - 1))
+#define YUV_MAT_Y (1 << 6)
+#define YUV_MAT_U_G (-22)
+#define YUV_MAT_U_B (113)
+#define YUV_MAT_V_R (90)
+#define YUV_MAT_V_G (-46)
+
+/* Vector kernels convert as many pixels of a row as fit in whole
+ * vectors and return how many that was. The C loops of the conv_*
+ * functions do the rest, and are the reference for all of them. */
+typedef int (*pixconv_row_t)(void *output, const void *input, int width);
+
+struct pixconv_kernels
+{
+   pixconv_row_t conv_rgb565_0rgb1555;
+   pixconv_row_t conv_0rgb1555_rgb565;
+   pixconv_row_t conv_0rgb1555_argb8888;
+   pixconv_row_t conv_rgb565_argb8888;
+   pixconv_row_t conv_rgba4444_argb8888;
+   pixconv_row_t conv_rgba4444_rgb565;
+   pixconv_row_t conv_bgr24_argb8888;
+   pixconv_row_t conv_argb8888_0rgb1555;
+   pixconv_row_t conv_argb8888_rgb565;
+   pixconv_row_t conv_argb8888_rgba4444;
+   pixconv_row_t conv_argb8888_bgr24;
+   pixconv_row_t conv_argb8888_abgr8888;
+   pixconv_row_t conv_abgr8888_bgr24;
+   pixconv_row_t conv_0rgb1555_bgr24;
+   pixconv_row_t conv_rgb565_bgr24;
+   pixconv_row_t conv_yuyv_argb8888;
+};
+
+/* Set by pixconv_init() before any other thread converts.
+ * Left zeroed, every conversion takes its C loop. */
+static struct pixconv_kernels pixconv_table;
+
+#ifdef HAVE_PIXCONV_SSE2
+RETRO_TARGET("sse2")
+static INLINE void pixconv_0rgb1555_argb8888_sse2(__m128i in,
+      __m128i *lo, __m128i *hi)
+{
+   const __m128i pix_mask_r  = _mm_set1_epi16(0x1f << 10);
+   const __m128i pix_mask_gb = _mm_set1_epi16(0x1f <<  5);
+   const __m128i mul15_mid   = _mm_set1_epi16(0x4200);
+   const __m128i mul15_hi    = _mm_set1_epi16(0x0210);
+   const __m128i a           = _mm_set1_epi16(0x00ff);
+   __m128i r = _mm_and_si128(in, pix_mask_r);
+   __m128i g = _mm_and_si128(in, pix_mask_gb);
+   __m128i b = _mm_and_si128(_mm_slli_epi16(in, 5), pix_mask_gb);
+
+   r = _mm_mulhi_epi16(r, mul15_hi);
+   g = _mm_mulhi_epi16(g, mul15_mid);
+   b = _mm_mulhi_epi16(b, mul15_mid);
+
+   *lo = _mm_or_si128(_mm_unpacklo_epi8(b, g),
+         _mm_slli_si128(_mm_unpacklo_epi8(r, a), 2));
+   *hi = _mm_or_si128(_mm_unpackhi_epi8(b, g),
+         _mm_slli_si128(_mm_unpackhi_epi8(r, a), 2));
+}
+
+RETRO_TARGET("sse2")
+static INLINE void pixconv_rgb565_argb8888_sse2(__m128i in,
+      __m128i *lo, __m128i *hi)
+{
+   const __m128i pix_mask_r = _mm_set1_epi16(0x1f << 10);
+   const __m128i pix_mask_g = _mm_set1_epi16(0x3f <<  5);
+   const __m128i pix_mask_b = _mm_set1_epi16(0x1f <<  5);
+   const __m128i mul16_r    = _mm_set1_epi16(0x0210);
+   const __m128i mul16_g    = _mm_set1_epi16(0x2080);
+   const __m128i mul16_b    = _mm_set1_epi16(0x4200);
+   const __m128i a          = _mm_set1_epi16(0x00ff);
+   __m128i r = _mm_and_si128(_mm_srli_epi16(in, 1), pix_mask_r);
+   __m128i g = _mm_and_si128(in, pix_mask_g);
+   __m128i b = _mm_and_si128(_mm_slli_epi16(in, 5), pix_mask_b);
+
+   r = _mm_mulhi_epi16(r, mul16_r);
+   g = _mm_mulhi_epi16(g, mul16_g);
+   b = _mm_mulhi_epi16(b, mul16_b);
+
+   *lo = _mm_or_si128(_mm_unpacklo_epi8(b, g),
+         _mm_slli_si128(_mm_unpacklo_epi8(r, a), 2));
+   *hi = _mm_or_si128(_mm_unpackhi_epi8(b, g),
+         _mm_slli_si128(_mm_unpackhi_epi8(r, a), 2));
+}
+
+/* Takes 32-bit pixels with the nibbles of RGBA4444 in the low bits. */
+RETRO_TARGET("sse2")
+static INLINE __m128i pixconv_rgba4444_argb8888_sse2(__m128i x)
+{
+   __m128i a = _mm_and_si128(x, _mm_set1_epi32(0x000f));
+   __m128i r = _mm_and_si128(x, _mm_set1_epi32(0xf000));
+   __m128i g = _mm_and_si128(x, _mm_set1_epi32(0x0f00));
+   __m128i b = _mm_and_si128(x, _mm_set1_epi32(0x00f0));
+
+   /* Each nibble ends up at the top and bottom of its byte. */
+   a = _mm_or_si128(_mm_slli_epi32(a, 24), _mm_slli_epi32(a, 28));
+   r = _mm_or_si128(_mm_slli_epi32(r,  4), _mm_slli_epi32(r,  8));
+   g = _mm_or_si128(g, _mm_slli_epi32(g, 4));
+   b = _mm_or_si128(b, _mm_srli_epi32(b, 4));
+
+   return _mm_or_si128(_mm_or_si128(a, r), _mm_or_si128(g, b));
+}
+
+RETRO_TARGET("sse2")
+static INLINE __m128i pixconv_argb8888_0rgb1555_sse2(__m128i x)
+{
+   __m128i r = _mm_and_si128(_mm_srli_epi32(x, 9), _mm_set1_epi32(0x7c00));
+   __m128i g = _mm_and_si128(_mm_srli_epi32(x, 6), _mm_set1_epi32(0x03e0));
+   __m128i b = _mm_and_si128(_mm_srli_epi32(x, 3), _mm_set1_epi32(0x001f));
+   return _mm_or_si128(r, _mm_or_si128(g, b));
+}
+
+RETRO_TARGET("sse2")
+static INLINE __m128i pixconv_argb8888_rgb565_sse2(__m128i x)
+{
+   __m128i r = _mm_and_si128(_mm_srli_epi32(x, 8), _mm_set1_epi32(0xf800));
+   __m128i g = _mm_and_si128(_mm_srli_epi32(x, 5), _mm_set1_epi32(0x07e0));
+   __m128i b = _mm_and_si128(_mm_srli_epi32(x, 3), _mm_set1_epi32(0x001f));
+   return _mm_or_si128(r, _mm_or_si128(g, b));
+}
+
+RETRO_TARGET("sse2")
+static INLINE __m128i pixconv_argb8888_rgba4444_sse2(__m128i x)
+{
+   __m128i r = _mm_and_si128(_mm_srli_epi32(x, 8), _mm_set1_epi32(0xf000));
+   __m128i g = _mm_and_si128(_mm_srli_epi32(x, 4), _mm_set1_epi32(0x0f00));
+   __m128i b = _mm_and_si128(x, _mm_set1_epi32(0x00f0));
+   __m128i a = _mm_srli_epi32(x, 28);
+   return _mm_or_si128(_mm_or_si128(r, g), _mm_or_si128(b, a));
+}
+
+/* Packs 32-bit lanes holding 16-bit pixels. They are sign extended
+ * first, so that the saturation of packs keeps all 16 bits. */
+RETRO_TARGET("sse2")
+static INLINE __m128i pixconv_pack16_sse2(__m128i lo, __m128i hi)
+{
+   lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+   hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+   return _mm_packs_epi32(lo, hi);
+}
+
+RETRO_TARGET("sse2")
+static INLINE __m128i pixconv_argb8888_abgr8888_sse2(__m128i x)
+{
+   __m128i ag = _mm_and_si128(x, _mm_set1_epi32((int)0xff00ff00u));
+   __m128i r  = _mm_and_si128(_mm_srli_epi32(x, 16), _mm_set1_epi32(0x000000ff));
+   __m128i b  = _mm_and_si128(_mm_slli_epi32(x, 16), _mm_set1_epi32(0x00ff0000));
+   return _mm_or_si128(ag, _mm_or_si128(r, b));
+}
+
+/* :( TODO: Make this saner. */
+RETRO_TARGET("sse2")
+static INLINE void store_bgr24_sse2(void *output, __m128i a,
+      __m128i b, __m128i c, __m128i d)
+{
+   const __m128i mask_0 = _mm_set_epi32(0, 0, 0, 0x00ffffff);
+   const __m128i mask_1 = _mm_set_epi32(0, 0, 0x00ffffff, 0);
+   const __m128i mask_2 = _mm_set_epi32(0, 0x00ffffff, 0, 0);
+   const __m128i mask_3 = _mm_set_epi32(0x00ffffff, 0, 0, 0);
+
+   __m128i a0 = _mm_and_si128(a, mask_0);
+   __m128i a1 = _mm_srli_si128(_mm_and_si128(a, mask_1),  1);
+   __m128i a2 = _mm_srli_si128(_mm_and_si128(a, mask_2),  2);
+   __m128i a3 = _mm_srli_si128(_mm_and_si128(a, mask_3),  3);
+   __m128i a4 = _mm_slli_si128(_mm_and_si128(b, mask_0), 12);
+   __m128i a5 = _mm_slli_si128(_mm_and_si128(b, mask_1), 11);
+
+   __m128i b0 = _mm_srli_si128(_mm_and_si128(b, mask_1), 5);
+   __m128i b1 = _mm_srli_si128(_mm_and_si128(b, mask_2), 6);
+   __m128i b2 = _mm_srli_si128(_mm_and_si128(b, mask_3), 7);
+   __m128i b3 = _mm_slli_si128(_mm_and_si128(c, mask_0), 8);
+   __m128i b4 = _mm_slli_si128(_mm_and_si128(c, mask_1), 7);
+   __m128i b5 = _mm_slli_si128(_mm_and_si128(c, mask_2), 6);
+
+   __m128i c0 = _mm_srli_si128(_mm_and_si128(c, mask_2), 10);
+   __m128i c1 = _mm_srli_si128(_mm_and_si128(c, mask_3), 11);
+   __m128i c2 = _mm_slli_si128(_mm_and_si128(d, mask_0),  4);
+   __m128i c3 = _mm_slli_si128(_mm_and_si128(d, mask_1),  3);
+   __m128i c4 = _mm_slli_si128(_mm_and_si128(d, mask_2),  2);
+   __m128i c5 = _mm_slli_si128(_mm_and_si128(d, mask_3),  1);
+
+   __m128i *out = (__m128i*)output;
+
+   _mm_storeu_si128(out + 0,
+         _mm_or_si128(a0, _mm_or_si128(a1, _mm_or_si128(a2,
+                  _mm_or_si128(a3, _mm_or_si128(a4, a5))))));
+
+   _mm_storeu_si128(out + 1,
+         _mm_or_si128(b0, _mm_or_si128(b1, _mm_or_si128(b2,
+                  _mm_or_si128(b3, _mm_or_si128(b4, b5))))));
+
+   _mm_storeu_si128(out + 2,
+         _mm_or_si128(c0, _mm_or_si128(c1, _mm_or_si128(c2,
+                  _mm_or_si128(c3, _mm_or_si128(c4, c5))))));
+}
+
+RETRO_TARGET("sse2")
+static int conv_rgb565_0rgb1555_sse2(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
+   const __m128i hi_mask = _mm_set1_epi16(0x7fe0);
+   const __m128i lo_mask = _mm_set1_epi16(0x1f);
+
+   for (w = 0; w + 8 <= width; w += 8)
+   {
+      const __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
+      __m128i hi = _mm_and_si128(_mm_srli_epi16(in, 1), hi_mask);
+      __m128i lo = _mm_and_si128(in, lo_mask);
+      _mm_storeu_si128((__m128i*)(output + w), _mm_or_si128(hi, lo));
+   }
+
+   return w;
+}
+
+RETRO_TARGET("sse2")
+static int conv_0rgb1555_rgb565_sse2(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint16_t *input   = (const uint16_t*)input_;
+   uint16_t *output        = (uint16_t*)output_;
+   const __m128i hi_mask   = _mm_set1_epi16(
+         (int16_t)((0x1f << 11) | (0x1f << 6)));
+   const __m128i lo_mask   = _mm_set1_epi16(0x1f);
+   const __m128i glow_mask = _mm_set1_epi16(1 << 5);
+
+   for (w = 0; w + 8 <= width; w += 8)
+   {
+      const __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
+      __m128i rg   = _mm_and_si128(_mm_slli_epi16(in, 1), hi_mask);
+      __m128i b    = _mm_and_si128(in, lo_mask);
+      __m128i glow = _mm_and_si128(_mm_srli_epi16(in, 4), glow_mask);
+      _mm_storeu_si128((__m128i*)(output + w),
+            _mm_or_si128(rg, _mm_or_si128(b, glow)));
+   }
+
+   return w;
+}
+
+RETRO_TARGET("sse2")
+static int conv_0rgb1555_argb8888_sse2(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+
+   for (w = 0; w + 8 <= width; w += 8)
+   {
+      __m128i lo, hi;
+      pixconv_0rgb1555_argb8888_sse2(
+            _mm_loadu_si128((const __m128i*)(input + w)), &lo, &hi);
+      _mm_storeu_si128((__m128i*)(output + w + 0), lo);
+      _mm_storeu_si128((__m128i*)(output + w + 4), hi);
+   }
+
+   return w;
+}
+
+RETRO_TARGET("sse2")
+static int conv_rgb565_argb8888_sse2(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+
+   for (w = 0; w + 8 <= width; w += 8)
+   {
+      __m128i lo, hi;
+      pixconv_rgb565_argb8888_sse2(
+            _mm_loadu_si128((const __m128i*)(input + w)), &lo, &hi);
+      _mm_storeu_si128((__m128i*)(output + w + 0), lo);
+      _mm_storeu_si128((__m128i*)(output + w + 4), hi);
+   }
+
+   return w;
+}
+
+RETRO_TARGET("sse2")
+static int conv_rgba4444_argb8888_sse2(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+   const __m128i zero    = _mm_setzero_si128();
+
+   for (w = 0; w + 8 <= width; w += 8)
+   {
+      const __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
+      _mm_storeu_si128((__m128i*)(output + w + 0),
+            pixconv_rgba4444_argb8888_sse2(_mm_unpacklo_epi16(in, zero)));
+      _mm_storeu_si128((__m128i*)(output + w + 4),
+            pixconv_rgba4444_argb8888_sse2(_mm_unpackhi_epi16(in, zero)));
+   }
+
+   return w;
+}
+
+RETRO_TARGET("sse2")
+static int conv_rgba4444_rgb565_sse2(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
+   const __m128i r_mask  = _mm_set1_epi16((int16_t)0xf000);
+   const __m128i g_mask  = _mm_set1_epi16(0x0f00);
+   const __m128i b_mask  = _mm_set1_epi16(0x00f0);
+
+   for (w = 0; w + 8 <= width; w += 8)
+   {
+      const __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
+      __m128i r = _mm_and_si128(in, r_mask);
+      __m128i g = _mm_srli_epi16(_mm_and_si128(in, g_mask), 1);
+      __m128i b = _mm_srli_epi16(_mm_and_si128(in, b_mask), 3);
+      _mm_storeu_si128((__m128i*)(output + w),
+            _mm_or_si128(r, _mm_or_si128(g, b)));
+   }
+
+   return w;
+}
+
+RETRO_TARGET("sse2")
+static int conv_argb8888_0rgb1555_sse2(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
+
+   for (w = 0; w + 8 <= width; w += 8)
+   {
+      __m128i lo = _mm_loadu_si128((const __m128i*)(input + w + 0));
+      __m128i hi = _mm_loadu_si128((const __m128i*)(input + w + 4));
+      _mm_storeu_si128((__m128i*)(output + w), pixconv_pack16_sse2(
+               pixconv_argb8888_0rgb1555_sse2(lo),
+               pixconv_argb8888_0rgb1555_sse2(hi)));
+   }
+
+   return w;
+}
+
+RETRO_TARGET("sse2")
+static int conv_argb8888_rgb565_sse2(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
+
+   for (w = 0; w + 8 <= width; w += 8)
+   {
+      __m128i lo = _mm_loadu_si128((const __m128i*)(input + w + 0));
+      __m128i hi = _mm_loadu_si128((const __m128i*)(input + w + 4));
+      _mm_storeu_si128((__m128i*)(output + w), pixconv_pack16_sse2(
+               pixconv_argb8888_rgb565_sse2(lo),
+               pixconv_argb8888_rgb565_sse2(hi)));
+   }
+
+   return w;
+}
+
+RETRO_TARGET("sse2")
+static int conv_argb8888_rgba4444_sse2(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
+
+   for (w = 0; w + 8 <= width; w += 8)
+   {
+      __m128i lo = _mm_loadu_si128((const __m128i*)(input + w + 0));
+      __m128i hi = _mm_loadu_si128((const __m128i*)(input + w + 4));
+      _mm_storeu_si128((__m128i*)(output + w), pixconv_pack16_sse2(
+               pixconv_argb8888_rgba4444_sse2(lo),
+               pixconv_argb8888_rgba4444_sse2(hi)));
+   }
+
+   return w;
+}
+
+RETRO_TARGET("sse2")
+static int conv_argb8888_bgr24_sse2(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+
+   for (w = 0; w + 16 <= width; w += 16)
+      store_bgr24_sse2(output + w * 3,
+            _mm_loadu_si128((const __m128i*)(input + w +  0)),
+            _mm_loadu_si128((const __m128i*)(input + w +  4)),
+            _mm_loadu_si128((const __m128i*)(input + w +  8)),
+            _mm_loadu_si128((const __m128i*)(input + w + 12)));
+
+   return w;
+}
+
+RETRO_TARGET("sse2")
+static int conv_argb8888_abgr8888_sse2(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+
+   for (w = 0; w + 4 <= width; w += 4)
+      _mm_storeu_si128((__m128i*)(output + w),
+            pixconv_argb8888_abgr8888_sse2(
+               _mm_loadu_si128((const __m128i*)(input + w))));
+
+   return w;
+}
+
+RETRO_TARGET("sse2")
+static int conv_abgr8888_bgr24_sse2(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+
+   /* Swapping red and blue makes it ARGB8888. */
+   for (w = 0; w + 16 <= width; w += 16)
+      store_bgr24_sse2(output + w * 3,
+            pixconv_argb8888_abgr8888_sse2(
+               _mm_loadu_si128((const __m128i*)(input + w +  0))),
+            pixconv_argb8888_abgr8888_sse2(
+               _mm_loadu_si128((const __m128i*)(input + w +  4))),
+            pixconv_argb8888_abgr8888_sse2(
+               _mm_loadu_si128((const __m128i*)(input + w +  8))),
+            pixconv_argb8888_abgr8888_sse2(
+               _mm_loadu_si128((const __m128i*)(input + w + 12))));
+
+   return w;
+}
+
+RETRO_TARGET("sse2")
+static int conv_0rgb1555_bgr24_sse2(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+
+   for (w = 0; w + 16 <= width; w += 16)
+   {
+      __m128i res_lo0, res_hi0, res_lo1, res_hi1;
+      pixconv_0rgb1555_argb8888_sse2(
+            _mm_loadu_si128((const __m128i*)(input + w + 0)), &res_lo0, &res_hi0);
+      pixconv_0rgb1555_argb8888_sse2(
+            _mm_loadu_si128((const __m128i*)(input + w + 8)), &res_lo1, &res_hi1);
+
+      /* Non-POT pixel sizes ftl :( */
+      store_bgr24_sse2(output + w * 3, res_lo0, res_hi0, res_lo1, res_hi1);
+   }
+
+   return w;
+}
+
+RETRO_TARGET("sse2")
+static int conv_rgb565_bgr24_sse2(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+
+   for (w = 0; w + 16 <= width; w += 16)
+   {
+      __m128i res_lo0, res_hi0, res_lo1, res_hi1;
+      pixconv_rgb565_argb8888_sse2(
+            _mm_loadu_si128((const __m128i*)(input + w + 0)), &res_lo0, &res_hi0);
+      pixconv_rgb565_argb8888_sse2(
+            _mm_loadu_si128((const __m128i*)(input + w + 8)), &res_lo1, &res_hi1);
+
+      store_bgr24_sse2(output + w * 3, res_lo0, res_hi0, res_lo1, res_hi1);
+   }
+
+   return w;
+}
+
+RETRO_TARGET("sse2")
+static int conv_yuyv_argb8888_sse2(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint8_t *src          = (const uint8_t*)input_;
+   uint32_t      *dst          = (uint32_t*)output_;
+   const __m128i mask_y        = _mm_set1_epi16(0xffu);
+   const __m128i mask_u        = _mm_set1_epi32(0xffu << 8);
+   const __m128i mask_v        = _mm_set1_epi32(0xffu << 24);
+   const __m128i chroma_offset = _mm_set1_epi16(128);
+   const __m128i round_offset  = _mm_set1_epi16(YUV_OFFSET);
+
+   const __m128i yuv_mul       = _mm_set1_epi16(YUV_MAT_Y);
+   const __m128i u_g_mul       = _mm_set1_epi16(YUV_MAT_U_G);
+   const __m128i u_b_mul       = _mm_set1_epi16(YUV_MAT_U_B);
+   const __m128i v_r_mul       = _mm_set1_epi16(YUV_MAT_V_R);
+   const __m128i v_g_mul       = _mm_set1_epi16(YUV_MAT_V_G);
+   const __m128i a             = _mm_cmpeq_epi16(
+         _mm_setzero_si128(), _mm_setzero_si128());
+
+   /* Each loop processes 16 pixels. */
+   for (w = 0; w + 16 <= width; w += 16, src += 32, dst += 16)
+   {
+      __m128i u, v, u0_g, u1_g, u0_b, u1_b, v0_r, v1_r, v0_g, v1_g,
+              r0, g0, b0, r1, g1, b1;
+      __m128i res_lo_bg, res_hi_bg, res_lo_ra, res_hi_ra;
+      __m128i res0, res1, res2, res3;
+      __m128i yuv0 = _mm_loadu_si128((const __m128i*)(src +  0)); /* [Y0, U0, Y1, V0, Y2, U1, Y3, V1, ...] */
+      __m128i yuv1 = _mm_loadu_si128((const __m128i*)(src + 16)); /* [Y0, U0, Y1, V0, Y2, U1, Y3, V1, ...] */
+
+      __m128i _y0 = _mm_and_si128(yuv0, mask_y); /* [Y0, Y1, Y2, ...] (16-bit) */
+      __m128i u0 = _mm_and_si128(yuv0, mask_u); /* [0, U0, 0, 0, 0, U1, 0, 0, ...] */
+      __m128i v0 = _mm_and_si128(yuv0, mask_v); /* [0, 0, 0, V1, 0, , 0, V1, ...] */
+      __m128i _y1 = _mm_and_si128(yuv1, mask_y); /* [Y0, Y1, Y2, ...] (16-bit) */
+      __m128i u1 = _mm_and_si128(yuv1, mask_u); /* [0, U0, 0, 0, 0, U1, 0, 0, ...] */
+      __m128i v1 = _mm_and_si128(yuv1, mask_v); /* [0, 0, 0, V1, 0, , 0, V1, ...] */
+
+      /* Juggle around to get U and V in the same 16-bit format as Y. */
+      u0 = _mm_srli_si128(u0, 1);
+      v0 = _mm_srli_si128(v0, 3);
+      u1 = _mm_srli_si128(u1, 1);
+      v1 = _mm_srli_si128(v1, 3);
+      u = _mm_packs_epi32(u0, u1);
+      v = _mm_packs_epi32(v0, v1);
+
+      /* Apply YUV offsets (U, V) -= (-128, -128). */
+      u = _mm_sub_epi16(u, chroma_offset);
+      v = _mm_sub_epi16(v, chroma_offset);
+
+      /* Upscale chroma horizontally (nearest). */
+      u0 = _mm_unpacklo_epi16(u, u);
+      u1 = _mm_unpackhi_epi16(u, u);
+      v0 = _mm_unpacklo_epi16(v, v);
+      v1 = _mm_unpackhi_epi16(v, v);
+
+      /* Apply transformations. */
+      _y0 = _mm_mullo_epi16(_y0, yuv_mul);
+      _y1 = _mm_mullo_epi16(_y1, yuv_mul);
+      u0_g   = _mm_mullo_epi16(u0, u_g_mul);
+      u1_g   = _mm_mullo_epi16(u1, u_g_mul);
+      u0_b   = _mm_mullo_epi16(u0, u_b_mul);
+      u1_b   = _mm_mullo_epi16(u1, u_b_mul);
+      v0_r   = _mm_mullo_epi16(v0, v_r_mul);
+      v1_r   = _mm_mullo_epi16(v1, v_r_mul);
+      v0_g   = _mm_mullo_epi16(v0, v_g_mul);
+      v1_g   = _mm_mullo_epi16(v1, v_g_mul);
+
+      /* Add contibutions from the transformed components. */
+      r0 = _mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(_y0, v0_r),
+               round_offset), YUV_SHIFT);
+      g0 = _mm_srai_epi16(_mm_adds_epi16(
+               _mm_adds_epi16(_mm_adds_epi16(_y0, v0_g), u0_g), round_offset), YUV_SHIFT);
+      b0 = _mm_srai_epi16(_mm_adds_epi16(
+               _mm_adds_epi16(_y0, u0_b), round_offset), YUV_SHIFT);
+
+      r1 = _mm_srai_epi16(_mm_adds_epi16(
+               _mm_adds_epi16(_y1, v1_r), round_offset), YUV_SHIFT);
+      g1 = _mm_srai_epi16(_mm_adds_epi16(
+               _mm_adds_epi16(_mm_adds_epi16(_y1, v1_g), u1_g), round_offset), YUV_SHIFT);
+      b1 = _mm_srai_epi16(_mm_adds_epi16(
+               _mm_adds_epi16(_y1, u1_b), round_offset), YUV_SHIFT);
+
+      /* Saturate into 8-bit. */
+      r0 = _mm_packus_epi16(r0, r1);
+      g0 = _mm_packus_epi16(g0, g1);
+      b0 = _mm_packus_epi16(b0, b1);
+
+      /* Interleave into ARGB. */
+      res_lo_bg = _mm_unpacklo_epi8(b0, g0);
+      res_hi_bg = _mm_unpackhi_epi8(b0, g0);
+      res_lo_ra = _mm_unpacklo_epi8(r0, a);
+      res_hi_ra = _mm_unpackhi_epi8(r0, a);
+      res0 = _mm_unpacklo_epi16(res_lo_bg, res_lo_ra);
+      res1 = _mm_unpackhi_epi16(res_lo_bg, res_lo_ra);
+      res2 = _mm_unpacklo_epi16(res_hi_bg, res_hi_ra);
+      res3 = _mm_unpackhi_epi16(res_hi_bg, res_hi_ra);
+
+      _mm_storeu_si128((__m128i*)(dst +  0), res0);
+      _mm_storeu_si128((__m128i*)(dst +  4), res1);
+      _mm_storeu_si128((__m128i*)(dst +  8), res2);
+      _mm_storeu_si128((__m128i*)(dst + 12), res3);
+   }
+
+   return w;
+}
+#endif
+
+#ifdef HAVE_PIXCONV_SSSE3
+/* Drops the fourth byte of every pixel with @pack, and stores
+ * 16 pixels as 48 bytes. */
+RETRO_TARGET("ssse3")
+static INLINE void store_bgr24_ssse3(void *output, __m128i a,
+      __m128i b, __m128i c, __m128i d, __m128i pack)
+{
+   __m128i *out = (__m128i*)output;
+
+   a = _mm_shuffle_epi8(a, pack);
+   b = _mm_shuffle_epi8(b, pack);
+   c = _mm_shuffle_epi8(c, pack);
+   d = _mm_shuffle_epi8(d, pack);
+
+   _mm_storeu_si128(out + 0, _mm_or_si128(a, _mm_slli_si128(b, 12)));
+   _mm_storeu_si128(out + 1, _mm_or_si128(_mm_srli_si128(b, 4),
+            _mm_slli_si128(c, 8)));
+   _mm_storeu_si128(out + 2, _mm_or_si128(_mm_srli_si128(c, 8),
+            _mm_slli_si128(d, 4)));
+}
+
+#define PIXCONV_PACK_BGR24 \
+      0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1
+#define PIXCONV_PACK_BGR24_SWAP \
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1
+#define PIXCONV_SWAP_RB \
+      2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15
+#define PIXCONV_UNPACK_BGR24 \
+      0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1
+
+RETRO_TARGET("ssse3")
+static int conv_argb8888_bgr24_ssse3(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+   const __m128i pack    = _mm_setr_epi8(PIXCONV_PACK_BGR24);
+
+   for (w = 0; w + 16 <= width; w += 16)
+      store_bgr24_ssse3(output + w * 3,
+            _mm_loadu_si128((const __m128i*)(input + w +  0)),
+            _mm_loadu_si128((const __m128i*)(input + w +  4)),
+            _mm_loadu_si128((const __m128i*)(input + w +  8)),
+            _mm_loadu_si128((const __m128i*)(input + w + 12)), pack);
+
+   return w;
+}
+
+RETRO_TARGET("ssse3")
+static int conv_abgr8888_bgr24_ssse3(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+   const __m128i pack    = _mm_setr_epi8(PIXCONV_PACK_BGR24_SWAP);
+
+   for (w = 0; w + 16 <= width; w += 16)
+      store_bgr24_ssse3(output + w * 3,
+            _mm_loadu_si128((const __m128i*)(input + w +  0)),
+            _mm_loadu_si128((const __m128i*)(input + w +  4)),
+            _mm_loadu_si128((const __m128i*)(input + w +  8)),
+            _mm_loadu_si128((const __m128i*)(input + w + 12)), pack);
+
+   return w;
+}
+
+RETRO_TARGET("ssse3")
+static int conv_0rgb1555_bgr24_ssse3(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+   const __m128i pack    = _mm_setr_epi8(PIXCONV_PACK_BGR24);
+
+   for (w = 0; w + 16 <= width; w += 16)
+   {
+      __m128i res_lo0, res_hi0, res_lo1, res_hi1;
+      pixconv_0rgb1555_argb8888_sse2(
+            _mm_loadu_si128((const __m128i*)(input + w + 0)), &res_lo0, &res_hi0);
+      pixconv_0rgb1555_argb8888_sse2(
+            _mm_loadu_si128((const __m128i*)(input + w + 8)), &res_lo1, &res_hi1);
+      store_bgr24_ssse3(output + w * 3, res_lo0, res_hi0, res_lo1, res_hi1, pack);
+   }
+
+   return w;
+}
+
+RETRO_TARGET("ssse3")
+static int conv_rgb565_bgr24_ssse3(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+   const __m128i pack    = _mm_setr_epi8(PIXCONV_PACK_BGR24);
+
+   for (w = 0; w + 16 <= width; w += 16)
+   {
+      __m128i res_lo0, res_hi0, res_lo1, res_hi1;
+      pixconv_rgb565_argb8888_sse2(
+            _mm_loadu_si128((const __m128i*)(input + w + 0)), &res_lo0, &res_hi0);
+      pixconv_rgb565_argb8888_sse2(
+            _mm_loadu_si128((const __m128i*)(input + w + 8)), &res_lo1, &res_hi1);
+      store_bgr24_ssse3(output + w * 3, res_lo0, res_hi0, res_lo1, res_hi1, pack);
+   }
+
+   return w;
+}
+
+RETRO_TARGET("ssse3")
+static int conv_argb8888_abgr8888_ssse3(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+   const __m128i swap    = _mm_setr_epi8(PIXCONV_SWAP_RB);
+
+   for (w = 0; w + 4 <= width; w += 4)
+      _mm_storeu_si128((__m128i*)(output + w), _mm_shuffle_epi8(
+               _mm_loadu_si128((const __m128i*)(input + w)), swap));
+
+   return w;
+}
+
+RETRO_TARGET("ssse3")
+static int conv_bgr24_argb8888_ssse3(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint8_t *input  = (const uint8_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+   const __m128i unpack  = _mm_setr_epi8(PIXCONV_UNPACK_BGR24);
+   const __m128i a       = _mm_set1_epi32((int)0xff000000u);
+
+   /* Four pixels from each 16 byte load, which must not go past
+    * the end of the row. */
+   for (w = 0; w + 6 <= width; w += 4)
+      _mm_storeu_si128((__m128i*)(output + w), _mm_or_si128(a,
+               _mm_shuffle_epi8(_mm_loadu_si128(
+                     (const __m128i*)(input + w * 3)), unpack)));
+
+   return w;
+}
+#endif
+
+#ifdef HAVE_PIXCONV_AVX2
+/* Takes eight pixels zero extended to 32 bits each. Every channel is
+ * moved up to its byte and its top bits repeated below it. */
+RETRO_TARGET("avx2")
+static INLINE __m256i pixconv_0rgb1555_argb8888_avx2(__m256i x)
+{
+   __m256i r = _mm256_or_si256(
+         _mm256_slli_epi32(_mm256_and_si256(x, _mm256_set1_epi32(0x7c00)), 9),
+         _mm256_slli_epi32(_mm256_and_si256(x, _mm256_set1_epi32(0x7000)), 4));
+   __m256i g = _mm256_or_si256(
+         _mm256_slli_epi32(_mm256_and_si256(x, _mm256_set1_epi32(0x03e0)), 6),
+         _mm256_slli_epi32(_mm256_and_si256(x, _mm256_set1_epi32(0x0380)), 1));
+   __m256i b = _mm256_or_si256(
+         _mm256_slli_epi32(_mm256_and_si256(x, _mm256_set1_epi32(0x001f)), 3),
+         _mm256_and_si256(_mm256_srli_epi32(x, 2), _mm256_set1_epi32(0x0007)));
+   return _mm256_or_si256(_mm256_or_si256(r, g),
+         _mm256_or_si256(b, _mm256_set1_epi32((int)0xff000000u)));
+}
+
+RETRO_TARGET("avx2")
+static INLINE __m256i pixconv_rgb565_argb8888_avx2(__m256i x)
+{
+   __m256i r = _mm256_or_si256(
+         _mm256_slli_epi32(_mm256_and_si256(x, _mm256_set1_epi32(0xf800)), 8),
+         _mm256_slli_epi32(_mm256_and_si256(x, _mm256_set1_epi32(0xe000)), 3));
+   __m256i g = _mm256_or_si256(
+         _mm256_slli_epi32(_mm256_and_si256(x, _mm256_set1_epi32(0x07e0)), 5),
+         _mm256_srli_epi32(_mm256_and_si256(x, _mm256_set1_epi32(0x0600)), 1));
+   __m256i b = _mm256_or_si256(
+         _mm256_slli_epi32(_mm256_and_si256(x, _mm256_set1_epi32(0x001f)), 3),
+         _mm256_and_si256(_mm256_srli_epi32(x, 2), _mm256_set1_epi32(0x0007)));
+   return _mm256_or_si256(_mm256_or_si256(r, g),
+         _mm256_or_si256(b, _mm256_set1_epi32((int)0xff000000u)));
+}
+
+RETRO_TARGET("avx2")
+static INLINE __m256i pixconv_rgba4444_argb8888_avx2(__m256i x)
+{
+   __m256i a = _mm256_and_si256(x, _mm256_set1_epi32(0x000f));
+   __m256i r = _mm256_and_si256(x, _mm256_set1_epi32(0xf000));
+   __m256i g = _mm256_and_si256(x, _mm256_set1_epi32(0x0f00));
+   __m256i b = _mm256_and_si256(x, _mm256_set1_epi32(0x00f0));
+
+   a = _mm256_or_si256(_mm256_slli_epi32(a, 24), _mm256_slli_epi32(a, 28));
+   r = _mm256_or_si256(_mm256_slli_epi32(r,  4), _mm256_slli_epi32(r,  8));
+   g = _mm256_or_si256(g, _mm256_slli_epi32(g, 4));
+   b = _mm256_or_si256(b, _mm256_srli_epi32(b, 4));
+
+   return _mm256_or_si256(_mm256_or_si256(a, r), _mm256_or_si256(g, b));
+}
+
+RETRO_TARGET("avx2")
+static INLINE __m256i pixconv_argb8888_0rgb1555_avx2(__m256i x)
+{
+   __m256i r = _mm256_and_si256(_mm256_srli_epi32(x, 9), _mm256_set1_epi32(0x7c00));
+   __m256i g = _mm256_and_si256(_mm256_srli_epi32(x, 6), _mm256_set1_epi32(0x03e0));
+   __m256i b = _mm256_and_si256(_mm256_srli_epi32(x, 3), _mm256_set1_epi32(0x001f));
+   return _mm256_or_si256(r, _mm256_or_si256(g, b));
+}
+
+RETRO_TARGET("avx2")
+static INLINE __m256i pixconv_argb8888_rgb565_avx2(__m256i x)
+{
+   __m256i r = _mm256_and_si256(_mm256_srli_epi32(x, 8), _mm256_set1_epi32(0xf800));
+   __m256i g = _mm256_and_si256(_mm256_srli_epi32(x, 5), _mm256_set1_epi32(0x07e0));
+   __m256i b = _mm256_and_si256(_mm256_srli_epi32(x, 3), _mm256_set1_epi32(0x001f));
+   return _mm256_or_si256(r, _mm256_or_si256(g, b));
+}
+
+RETRO_TARGET("avx2")
+static INLINE __m256i pixconv_argb8888_rgba4444_avx2(__m256i x)
+{
+   __m256i r = _mm256_and_si256(_mm256_srli_epi32(x, 8), _mm256_set1_epi32(0xf000));
+   __m256i g = _mm256_and_si256(_mm256_srli_epi32(x, 4), _mm256_set1_epi32(0x0f00));
+   __m256i b = _mm256_and_si256(x, _mm256_set1_epi32(0x00f0));
+   __m256i a = _mm256_srli_epi32(x, 28);
+   return _mm256_or_si256(_mm256_or_si256(r, g), _mm256_or_si256(b, a));
+}
+
+/* Packing works per lane, put the pixels back in order. */
+RETRO_TARGET("avx2")
+static INLINE __m256i pixconv_pack16_avx2(__m256i lo, __m256i hi)
+{
+   return _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi),
+         _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+RETRO_TARGET("avx2")
+static INLINE __m256i pixconv_load16_avx2(const uint16_t *input)
+{
+   return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)input));
+}
+
+/* Stores eight pixels as 24 bytes, with @pack dropping the fourth byte
+ * of each pixel in both lanes. The store is 32 bytes wide, callers
+ * have to leave room for three more pixels, which overwrite the
+ * eight bytes of zeroes at the end. */
+RETRO_TARGET("avx2")
+static INLINE void store_bgr24_avx2(uint8_t *output, __m256i x, __m256i pack)
+{
+   x = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(x, pack),
+         _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+   _mm256_storeu_si256((__m256i*)output, x);
+}
+
+RETRO_TARGET("avx2")
+static int conv_rgb565_0rgb1555_avx2(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
+   const __m256i hi_mask = _mm256_set1_epi16(0x7fe0);
+   const __m256i lo_mask = _mm256_set1_epi16(0x1f);
+
+   for (w = 0; w + 16 <= width; w += 16)
+   {
+      const __m256i in = _mm256_loadu_si256((const __m256i*)(input + w));
+      __m256i hi = _mm256_and_si256(_mm256_srli_epi16(in, 1), hi_mask);
+      __m256i lo = _mm256_and_si256(in, lo_mask);
+      _mm256_storeu_si256((__m256i*)(output + w), _mm256_or_si256(hi, lo));
+   }
+
+   return w;
+}
+
+RETRO_TARGET("avx2")
+static int conv_0rgb1555_rgb565_avx2(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint16_t *input   = (const uint16_t*)input_;
+   uint16_t *output        = (uint16_t*)output_;
+   const __m256i hi_mask   = _mm256_set1_epi16(
+         (int16_t)((0x1f << 11) | (0x1f << 6)));
+   const __m256i lo_mask   = _mm256_set1_epi16(0x1f);
+   const __m256i glow_mask = _mm256_set1_epi16(1 << 5);
+
+   for (w = 0; w + 16 <= width; w += 16)
+   {
+      const __m256i in = _mm256_loadu_si256((const __m256i*)(input + w));
+      __m256i rg   = _mm256_and_si256(_mm256_slli_epi16(in, 1), hi_mask);
+      __m256i b    = _mm256_and_si256(in, lo_mask);
+      __m256i glow = _mm256_and_si256(_mm256_srli_epi16(in, 4), glow_mask);
+      _mm256_storeu_si256((__m256i*)(output + w),
+            _mm256_or_si256(rg, _mm256_or_si256(b, glow)));
+   }
+
+   return w;
+}
+
+RETRO_TARGET("avx2")
+static int conv_0rgb1555_argb8888_avx2(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+
+   for (w = 0; w + 8 <= width; w += 8)
+      _mm256_storeu_si256((__m256i*)(output + w),
+            pixconv_0rgb1555_argb8888_avx2(pixconv_load16_avx2(input + w)));
+
+   return w;
+}
+
+RETRO_TARGET("avx2")
+static int conv_rgb565_argb8888_avx2(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+
+   for (w = 0; w + 8 <= width; w += 8)
+      _mm256_storeu_si256((__m256i*)(output + w),
+            pixconv_rgb565_argb8888_avx2(pixconv_load16_avx2(input + w)));
+
+   return w;
+}
+
+RETRO_TARGET("avx2")
+static int conv_rgba4444_argb8888_avx2(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+
+   for (w = 0; w + 8 <= width; w += 8)
+      _mm256_storeu_si256((__m256i*)(output + w),
+            pixconv_rgba4444_argb8888_avx2(pixconv_load16_avx2(input + w)));
+
+   return w;
+}
+
+RETRO_TARGET("avx2")
+static int conv_rgba4444_rgb565_avx2(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
+   const __m256i r_mask  = _mm256_set1_epi16((int16_t)0xf000);
+   const __m256i g_mask  = _mm256_set1_epi16(0x0f00);
+   const __m256i b_mask  = _mm256_set1_epi16(0x00f0);
+
+   for (w = 0; w + 16 <= width; w += 16)
+   {
+      const __m256i in = _mm256_loadu_si256((const __m256i*)(input + w));
+      __m256i r = _mm256_and_si256(in, r_mask);
+      __m256i g = _mm256_srli_epi16(_mm256_and_si256(in, g_mask), 1);
+      __m256i b = _mm256_srli_epi16(_mm256_and_si256(in, b_mask), 3);
+      _mm256_storeu_si256((__m256i*)(output + w),
+            _mm256_or_si256(r, _mm256_or_si256(g, b)));
+   }
+
+   return w;
+}
+
+RETRO_TARGET("avx2")
+static int conv_bgr24_argb8888_avx2(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint8_t *input  = (const uint8_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+   const __m256i unpack  = _mm256_setr_epi8(PIXCONV_UNPACK_BGR24,
+         PIXCONV_UNPACK_BGR24);
+   const __m256i a       = _mm256_set1_epi32((int)0xff000000u);
+
+   /* Four pixels per lane. The upper load ends 28 bytes in, which
+    * must not go past the end of the row. */
+   for (w = 0; w + 10 <= width; w += 8)
+   {
+      __m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(
+               _mm_loadu_si128((const __m128i*)(input + w * 3))),
+            _mm_loadu_si128((const __m128i*)(input + w * 3 + 12)), 1);
+      _mm256_storeu_si256((__m256i*)(output + w),
+            _mm256_or_si256(a, _mm256_shuffle_epi8(in, unpack)));
+   }
+
+   return w;
+}
+
+RETRO_TARGET("avx2")
+static int conv_argb8888_0rgb1555_avx2(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
+
+   for (w = 0; w + 16 <= width; w += 16)
+   {
+      __m256i lo = _mm256_loadu_si256((const __m256i*)(input + w + 0));
+      __m256i hi = _mm256_loadu_si256((const __m256i*)(input + w + 8));
+      _mm256_storeu_si256((__m256i*)(output + w), pixconv_pack16_avx2(
+               pixconv_argb8888_0rgb1555_avx2(lo),
+               pixconv_argb8888_0rgb1555_avx2(hi)));
+   }
+
+   return w;
+}
+
+RETRO_TARGET("avx2")
+static int conv_argb8888_rgb565_avx2(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
+
+   for (w = 0; w + 16 <= width; w += 16)
+   {
+      __m256i lo = _mm256_loadu_si256((const __m256i*)(input + w + 0));
+      __m256i hi = _mm256_loadu_si256((const __m256i*)(input + w + 8));
+      _mm256_storeu_si256((__m256i*)(output + w), pixconv_pack16_avx2(
+               pixconv_argb8888_rgb565_avx2(lo),
+               pixconv_argb8888_rgb565_avx2(hi)));
+   }
+
+   return w;
+}
+
+RETRO_TARGET("avx2")
+static int conv_argb8888_rgba4444_avx2(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
+
+   for (w = 0; w + 16 <= width; w += 16)
+   {
+      __m256i lo = _mm256_loadu_si256((const __m256i*)(input + w + 0));
+      __m256i hi = _mm256_loadu_si256((const __m256i*)(input + w + 8));
+      _mm256_storeu_si256((__m256i*)(output + w), pixconv_pack16_avx2(
+               pixconv_argb8888_rgba4444_avx2(lo),
+               pixconv_argb8888_rgba4444_avx2(hi)));
+   }
+
+   return w;
+}
+
+RETRO_TARGET("avx2")
+static int conv_argb8888_bgr24_avx2(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+   const __m256i pack    = _mm256_setr_epi8(PIXCONV_PACK_BGR24,
+         PIXCONV_PACK_BGR24);
+
+   for (w = 0; w + 8 + 3 <= width; w += 8)
+      store_bgr24_avx2(output + w * 3,
+            _mm256_loadu_si256((const __m256i*)(input + w)), pack);
+
+   return w;
+}
+
+RETRO_TARGET("avx2")
+static int conv_abgr8888_bgr24_avx2(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+   const __m256i pack    = _mm256_setr_epi8(PIXCONV_PACK_BGR24_SWAP,
+         PIXCONV_PACK_BGR24_SWAP);
+
+   for (w = 0; w + 8 + 3 <= width; w += 8)
+      store_bgr24_avx2(output + w * 3,
+            _mm256_loadu_si256((const __m256i*)(input + w)), pack);
+
+   return w;
+}
+
+RETRO_TARGET("avx2")
+static int conv_argb8888_abgr8888_avx2(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+   const __m256i swap    = _mm256_setr_epi8(PIXCONV_SWAP_RB, PIXCONV_SWAP_RB);
+
+   for (w = 0; w + 8 <= width; w += 8)
+      _mm256_storeu_si256((__m256i*)(output + w), _mm256_shuffle_epi8(
+               _mm256_loadu_si256((const __m256i*)(input + w)), swap));
+
+   return w;
+}
+
+RETRO_TARGET("avx2")
+static int conv_0rgb1555_bgr24_avx2(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+   const __m256i pack    = _mm256_setr_epi8(PIXCONV_PACK_BGR24,
+         PIXCONV_PACK_BGR24);
+
+   for (w = 0; w + 8 + 3 <= width; w += 8)
+      store_bgr24_avx2(output + w * 3, pixconv_0rgb1555_argb8888_avx2(
+               pixconv_load16_avx2(input + w)), pack);
+
+   return w;
+}
+
+RETRO_TARGET("avx2")
+static int conv_rgb565_bgr24_avx2(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+   const __m256i pack    = _mm256_setr_epi8(PIXCONV_PACK_BGR24,
+         PIXCONV_PACK_BGR24);
+
+   for (w = 0; w + 8 + 3 <= width; w += 8)
+      store_bgr24_avx2(output + w * 3, pixconv_rgb565_argb8888_avx2(
+               pixconv_load16_avx2(input + w)), pack);
+
+   return w;
+}
+
+/* Same steps as the SSE2 version, on 16 pixels per lane. */
+RETRO_TARGET("avx2")
+static int conv_yuyv_argb8888_avx2(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint8_t *src          = (const uint8_t*)input_;
+   uint32_t      *dst          = (uint32_t*)output_;
+   const __m256i mask_y        = _mm256_set1_epi16(0xffu);
+   const __m256i mask_u        = _mm256_set1_epi32(0xffu << 8);
+   const __m256i mask_v        = _mm256_set1_epi32((int)(0xffu << 24));
+   const __m256i chroma_offset = _mm256_set1_epi16(128);
+   const __m256i round_offset  = _mm256_set1_epi16(YUV_OFFSET);
+   const __m256i a             = _mm256_set1_epi16(-1);
+
+   for (w = 0; w + 32 <= width; w += 32, src += 64, dst += 32)
+   {
+      __m256i u, v, u0, u1, v0, v1, y0, y1, r, g, b;
+      __m256i res_lo_bg, res_hi_bg, res_lo_ra, res_hi_ra;
+      __m256i res0, res1, res2, res3;
+      /* The lower lanes hold pixels 0 to 15, the upper ones 16 to 31. */
+      __m256i yuv0 = _mm256_inserti128_si256(_mm256_castsi128_si256(
+               _mm_loadu_si128((const __m128i*)(src +  0))),
+            _mm_loadu_si128((const __m128i*)(src + 32)), 1);
+      __m256i yuv1 = _mm256_inserti128_si256(_mm256_castsi128_si256(
+               _mm_loadu_si128((const __m128i*)(src + 16))),
+            _mm_loadu_si128((const __m128i*)(src + 48)), 1);
+
+      y0 = _mm256_and_si256(yuv0, mask_y);
+      y1 = _mm256_and_si256(yuv1, mask_y);
+      u  = _mm256_packs_epi32(
+            _mm256_srli_si256(_mm256_and_si256(yuv0, mask_u), 1),
+            _mm256_srli_si256(_mm256_and_si256(yuv1, mask_u), 1));
+      v  = _mm256_packs_epi32(
+            _mm256_srli_si256(_mm256_and_si256(yuv0, mask_v), 3),
+            _mm256_srli_si256(_mm256_and_si256(yuv1, mask_v), 3));
+
+      u  = _mm256_sub_epi16(u, chroma_offset);
+      v  = _mm256_sub_epi16(v, chroma_offset);
+      u0 = _mm256_unpacklo_epi16(u, u);
+      u1 = _mm256_unpackhi_epi16(u, u);
+      v0 = _mm256_unpacklo_epi16(v, v);
+      v1 = _mm256_unpackhi_epi16(v, v);
+
+      y0 = _mm256_mullo_epi16(y0, _mm256_set1_epi16(YUV_MAT_Y));
+      y1 = _mm256_mullo_epi16(y1, _mm256_set1_epi16(YUV_MAT_Y));
+
+      r = _mm256_packus_epi16(
+            _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(y0,
+                     _mm256_mullo_epi16(v0, _mm256_set1_epi16(YUV_MAT_V_R))),
+                  round_offset), YUV_SHIFT),
+            _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(y1,
+                     _mm256_mullo_epi16(v1, _mm256_set1_epi16(YUV_MAT_V_R))),
+                  round_offset), YUV_SHIFT));
+      g = _mm256_packus_epi16(
+            _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(
+                     _mm256_adds_epi16(y0,
+                        _mm256_mullo_epi16(v0, _mm256_set1_epi16(YUV_MAT_V_G))),
+                     _mm256_mullo_epi16(u0, _mm256_set1_epi16(YUV_MAT_U_G))),
+                  round_offset), YUV_SHIFT),
+            _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(
+                     _mm256_adds_epi16(y1,
+                        _mm256_mullo_epi16(v1, _mm256_set1_epi16(YUV_MAT_V_G))),
+                     _mm256_mullo_epi16(u1, _mm256_set1_epi16(YUV_MAT_U_G))),
+                  round_offset), YUV_SHIFT));
+      b = _mm256_packus_epi16(
+            _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(y0,
+                     _mm256_mullo_epi16(u0, _mm256_set1_epi16(YUV_MAT_U_B))),
+                  round_offset), YUV_SHIFT),
+            _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(y1,
+                     _mm256_mullo_epi16(u1, _mm256_set1_epi16(YUV_MAT_U_B))),
+                  round_offset), YUV_SHIFT));
+
+      res_lo_bg = _mm256_unpacklo_epi8(b, g);
+      res_hi_bg = _mm256_unpackhi_epi8(b, g);
+      res_lo_ra = _mm256_unpacklo_epi8(r, a);
+      res_hi_ra = _mm256_unpackhi_epi8(r, a);
+      res0 = _mm256_unpacklo_epi16(res_lo_bg, res_lo_ra);
+      res1 = _mm256_unpackhi_epi16(res_lo_bg, res_lo_ra);
+      res2 = _mm256_unpacklo_epi16(res_hi_bg, res_hi_ra);
+      res3 = _mm256_unpackhi_epi16(res_hi_bg, res_hi_ra);
+
+      _mm256_storeu_si256((__m256i*)(dst +  0), _mm256_permute2x128_si256(res0, res1, 0x20));
+      _mm256_storeu_si256((__m256i*)(dst +  8), _mm256_permute2x128_si256(res2, res3, 0x20));
+      _mm256_storeu_si256((__m256i*)(dst + 16), _mm256_permute2x128_si256(res0, res1, 0x31));
+      _mm256_storeu_si256((__m256i*)(dst + 24), _mm256_permute2x128_si256(res2, res3, 0x31));
+   }
+
+   return w;
+}
+#endif
+
+#ifdef HAVE_PIXCONV_NEON
+/* Widens 5, 6 and 4-bit channels to 8 bits, repeating their top bits. */
+static INLINE uint8x8_t pixconv_expand5_neon(uint16x8_t x)
+{
+   return vmovn_u16(vorrq_u16(vshlq_n_u16(x, 3), vshrq_n_u16(x, 2)));
+}
+
+static INLINE uint8x8_t pixconv_expand6_neon(uint16x8_t x)
+{
+   return vmovn_u16(vorrq_u16(vshlq_n_u16(x, 2), vshrq_n_u16(x, 4)));
+}
+
+static INLINE uint8x8_t pixconv_expand4_neon(uint16x8_t x)
+{
+   return vmovn_u16(vorrq_u16(vshlq_n_u16(x, 4), x));
+}
+
+static INLINE uint8x8x4_t pixconv_0rgb1555_argb8888_neon(uint16x8_t in)
+{
+   uint8x8x4_t res;
+   const uint16x8_t mask = vdupq_n_u16(0x1f);
+   res.val[0] = pixconv_expand5_neon(vandq_u16(in, mask));
+   res.val[1] = pixconv_expand5_neon(vandq_u16(vshrq_n_u16(in,  5), mask));
+   res.val[2] = pixconv_expand5_neon(vandq_u16(vshrq_n_u16(in, 10), mask));
+   res.val[3] = vdup_n_u8(0xff);
+   return res;
+}
+
+static INLINE uint8x8x4_t pixconv_rgb565_argb8888_neon(uint16x8_t in)
+{
+   uint8x8x4_t res;
+   res.val[0] = pixconv_expand5_neon(vandq_u16(in, vdupq_n_u16(0x1f)));
+   res.val[1] = pixconv_expand6_neon(vandq_u16(vshrq_n_u16(in, 5),
+            vdupq_n_u16(0x3f)));
+   res.val[2] = pixconv_expand5_neon(vshrq_n_u16(in, 11));
+   res.val[3] = vdup_n_u8(0xff);
+   return res;
+}
+
+static int conv_rgb565_0rgb1555_neon(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
+
+   for (w = 0; w + 8 <= width; w += 8)
+   {
+      uint16x8_t in = vld1q_u16(input + w);
+      vst1q_u16(output + w, vorrq_u16(
+               vandq_u16(vshrq_n_u16(in, 1), vdupq_n_u16(0x7fe0)),
+               vandq_u16(in, vdupq_n_u16(0x1f))));
+   }
+
+   return w;
+}
+
+static int conv_0rgb1555_rgb565_neon(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
+
+   for (w = 0; w + 8 <= width; w += 8)
+   {
+      uint16x8_t in   = vld1q_u16(input + w);
+      uint16x8_t rg   = vandq_u16(vshlq_n_u16(in, 1),
+            vdupq_n_u16((0x1f << 11) | (0x1f << 6)));
+      uint16x8_t b    = vandq_u16(in, vdupq_n_u16(0x1f));
+      uint16x8_t glow = vandq_u16(vshrq_n_u16(in, 4), vdupq_n_u16(1 << 5));
+      vst1q_u16(output + w, vorrq_u16(rg, vorrq_u16(b, glow)));
+   }
+
+   return w;
+}
+
+static int conv_0rgb1555_argb8888_neon(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+
+   for (w = 0; w + 8 <= width; w += 8)
+      vst4_u8(output + w * 4,
+            pixconv_0rgb1555_argb8888_neon(vld1q_u16(input + w)));
+
+   return w;
+}
+
+static int conv_rgb565_argb8888_neon(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+
+   for (w = 0; w + 8 <= width; w += 8)
+      vst4_u8(output + w * 4,
+            pixconv_rgb565_argb8888_neon(vld1q_u16(input + w)));
+
+   return w;
+}
+
+static int conv_rgba4444_argb8888_neon(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+   const uint16x8_t mask = vdupq_n_u16(0xf);
+
+   for (w = 0; w + 8 <= width; w += 8)
+   {
+      uint8x8x4_t res;
+      uint16x8_t in = vld1q_u16(input + w);
+      res.val[0] = pixconv_expand4_neon(vandq_u16(vshrq_n_u16(in, 4), mask));
+      res.val[1] = pixconv_expand4_neon(vandq_u16(vshrq_n_u16(in, 8), mask));
+      res.val[2] = pixconv_expand4_neon(vshrq_n_u16(in, 12));
+      res.val[3] = pixconv_expand4_neon(vandq_u16(in, mask));
+      vst4_u8(output + w * 4, res);
+   }
+
+   return w;
+}
+
+static int conv_rgba4444_rgb565_neon(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
+
+   for (w = 0; w + 8 <= width; w += 8)
+   {
+      uint16x8_t in = vld1q_u16(input + w);
+      uint16x8_t r  = vandq_u16(in, vdupq_n_u16(0xf000));
+      uint16x8_t g  = vshrq_n_u16(vandq_u16(in, vdupq_n_u16(0x0f00)), 1);
+      uint16x8_t b  = vshrq_n_u16(vandq_u16(in, vdupq_n_u16(0x00f0)), 3);
+      vst1q_u16(output + w, vorrq_u16(r, vorrq_u16(g, b)));
+   }
+
+   return w;
+}
+
+static int conv_bgr24_argb8888_neon(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint8_t *input = (const uint8_t*)input_;
+   uint8_t *output      = (uint8_t*)output_;
+
+   for (w = 0; w + 8 <= width; w += 8)
+   {
+      uint8x8x4_t res;
+      uint8x8x3_t in = vld3_u8(input + w * 3);
+      res.val[0] = in.val[0];
+      res.val[1] = in.val[1];
+      res.val[2] = in.val[2];
+      res.val[3] = vdup_n_u8(0xff);
+      vst4_u8(output + w * 4, res);
+   }
+
+   return w;
+}
+
+/* Shift right and insert keeps the top bits already in place and
+ * fills in those of the next channel below them. */
+static int conv_argb8888_0rgb1555_neon(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint8_t *input = (const uint8_t*)input_;
+   uint16_t *output     = (uint16_t*)output_;
+
+   for (w = 0; w + 8 <= width; w += 8)
+   {
+      uint8x8x4_t in = vld4_u8(input + w * 4);
+      uint16x8_t res = vshrq_n_u16(vshll_n_u8(in.val[2], 8), 1);
+      res = vsriq_n_u16(res, vshll_n_u8(in.val[1], 8), 6);
+      res = vsriq_n_u16(res, vshll_n_u8(in.val[0], 8), 11);
+      vst1q_u16(output + w, res);
+   }
+
+   return w;
+}
+
+static int conv_argb8888_rgb565_neon(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint8_t *input = (const uint8_t*)input_;
+   uint16_t *output     = (uint16_t*)output_;
+
+   for (w = 0; w + 8 <= width; w += 8)
+   {
+      uint8x8x4_t in = vld4_u8(input + w * 4);
+      uint16x8_t res = vshll_n_u8(in.val[2], 8);
+      res = vsriq_n_u16(res, vshll_n_u8(in.val[1], 8), 5);
+      res = vsriq_n_u16(res, vshll_n_u8(in.val[0], 8), 11);
+      vst1q_u16(output + w, res);
+   }
+
+   return w;
+}
+
+static int conv_argb8888_rgba4444_neon(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint8_t *input = (const uint8_t*)input_;
+   uint16_t *output     = (uint16_t*)output_;
+
+   for (w = 0; w + 8 <= width; w += 8)
+   {
+      uint8x8x4_t in = vld4_u8(input + w * 4);
+      uint16x8_t res = vshll_n_u8(in.val[2], 8);
+      res = vsriq_n_u16(res, vshll_n_u8(in.val[1], 8), 4);
+      res = vsriq_n_u16(res, vshll_n_u8(in.val[0], 8), 8);
+      res = vsriq_n_u16(res, vshll_n_u8(in.val[3], 8), 12);
+      vst1q_u16(output + w, res);
+   }
+
+   return w;
+}
+
+static int conv_argb8888_bgr24_neon(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint8_t *input = (const uint8_t*)input_;
+   uint8_t *output      = (uint8_t*)output_;
+
+   for (w = 0; w + 16 <= width; w += 16)
+   {
+      uint8x16x3_t res;
+      uint8x16x4_t in = vld4q_u8(input + w * 4);
+      res.val[0] = in.val[0];
+      res.val[1] = in.val[1];
+      res.val[2] = in.val[2];
+      vst3q_u8(output + w * 3, res);
+   }
+
+   return w;
+}
+
+static int conv_argb8888_abgr8888_neon(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint8_t *input = (const uint8_t*)input_;
+   uint8_t *output      = (uint8_t*)output_;
+
+   for (w = 0; w + 16 <= width; w += 16)
+   {
+      uint8x16x4_t in = vld4q_u8(input + w * 4);
+      uint8x16_t b    = in.val[0];
+      in.val[0]       = in.val[2];
+      in.val[2]       = b;
+      vst4q_u8(output + w * 4, in);
+   }
+
+   return w;
+}
+
+static int conv_abgr8888_bgr24_neon(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint8_t *input = (const uint8_t*)input_;
+   uint8_t *output      = (uint8_t*)output_;
+
+   for (w = 0; w + 16 <= width; w += 16)
+   {
+      uint8x16x3_t res;
+      uint8x16x4_t in = vld4q_u8(input + w * 4);
+      res.val[0] = in.val[2];
+      res.val[1] = in.val[1];
+      res.val[2] = in.val[0];
+      vst3q_u8(output + w * 3, res);
+   }
+
+   return w;
+}
+
+static int conv_0rgb1555_bgr24_neon(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+
+   for (w = 0; w + 8 <= width; w += 8)
+   {
+      uint8x8x3_t res;
+      uint8x8x4_t argb = pixconv_0rgb1555_argb8888_neon(vld1q_u16(input + w));
+      res.val[0] = argb.val[0];
+      res.val[1] = argb.val[1];
+      res.val[2] = argb.val[2];
+      vst3_u8(output + w * 3, res);
+   }
+
+   return w;
+}
+
+static int conv_rgb565_bgr24_neon(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+
+   for (w = 0; w + 8 <= width; w += 8)
+   {
+      uint8x8x3_t res;
+      uint8x8x4_t argb = pixconv_rgb565_argb8888_neon(vld1q_u16(input + w));
+      res.val[0] = argb.val[0];
+      res.val[1] = argb.val[1];
+      res.val[2] = argb.val[2];
+      vst3_u8(output + w * 3, res);
+   }
+
+   return w;
+}
+
+static int conv_yuyv_argb8888_neon(void *output_, const void *input_,
+      int width)
+{
+   int w;
+   const uint8_t *input          = (const uint8_t*)input_;
+   uint8_t *output               = (uint8_t*)output_;
+   const int16x8_t chroma_offset = vdupq_n_s16(128);
+   const int16x8_t round_offset  = vdupq_n_s16(YUV_OFFSET);
+
+   /* Eight pairs of pixels, each pair sharing its chroma. */
+   for (w = 0; w + 16 <= width; w += 16)
+   {
+      uint8x8x2_t r, g, b;
+      uint8x8x4_t res;
+      uint8x8x4_t yuv = vld4_u8(input + w * 2);
+      int16x8_t y0    = vmulq_n_s16(vreinterpretq_s16_u16(
+               vmovl_u8(yuv.val[0])), YUV_MAT_Y);
+      int16x8_t y1    = vmulq_n_s16(vreinterpretq_s16_u16(
+               vmovl_u8(yuv.val[2])), YUV_MAT_Y);
+      int16x8_t u     = vsubq_s16(vreinterpretq_s16_u16(
+               vmovl_u8(yuv.val[1])), chroma_offset);
+      int16x8_t v     = vsubq_s16(vreinterpretq_s16_u16(
+               vmovl_u8(yuv.val[3])), chroma_offset);
+      int16x8_t r_uv  = vaddq_s16(vmulq_n_s16(v, YUV_MAT_V_R), round_offset);
+      int16x8_t g_uv  = vaddq_s16(vmlaq_n_s16(vmulq_n_s16(u, YUV_MAT_U_G),
+               v, YUV_MAT_V_G), round_offset);
+      int16x8_t b_uv  = vaddq_s16(vmulq_n_s16(u, YUV_MAT_U_B), round_offset);
+
+      /* Saturate into 8-bit and put even and odd pixels back in order. */
+      r = vzip_u8(vqshrun_n_s16(vaddq_s16(y0, r_uv), YUV_SHIFT),
+            vqshrun_n_s16(vaddq_s16(y1, r_uv), YUV_SHIFT));
+      g = vzip_u8(vqshrun_n_s16(vaddq_s16(y0, g_uv), YUV_SHIFT),
+            vqshrun_n_s16(vaddq_s16(y1, g_uv), YUV_SHIFT));
+      b = vzip_u8(vqshrun_n_s16(vaddq_s16(y0, b_uv), YUV_SHIFT),
+            vqshrun_n_s16(vaddq_s16(y1, b_uv), YUV_SHIFT));
+
+      res.val[3] = vdup_n_u8(0xff);
+      res.val[0] = b.val[0];
+      res.val[1] = g.val[0];
+      res.val[2] = r.val[0];
+      vst4_u8(output + w * 4, res);
+      res.val[0] = b.val[1];
+      res.val[1] = g.val[1];
+      res.val[2] = r.val[1];
+      vst4_u8(output + w * 4 + 32, res);
+   }
+
+   return w;
+}
 #endif
 
-#if defined(__SSE2__)
-#include <emmintrin.h>
+void pixconv_init(uint64_t simd)
+{
+   struct pixconv_kernels k;
+
+   memset(&k, 0, sizeof(k));
+
+#ifdef HAVE_PIXCONV_SSE2
+   if (simd & RETRO_SIMD_SSE2)
+   {
+      k.conv_rgb565_0rgb1555   = conv_rgb565_0rgb1555_sse2;
+      k.conv_0rgb1555_rgb565   = conv_0rgb1555_rgb565_sse2;
+      k.conv_0rgb1555_argb8888 = conv_0rgb1555_argb8888_sse2;
+      k.conv_rgb565_argb8888   = conv_rgb565_argb8888_sse2;
+      k.conv_rgba4444_argb8888 = conv_rgba4444_argb8888_sse2;
+      k.conv_rgba4444_rgb565   = conv_rgba4444_rgb565_sse2;
+      k.conv_argb8888_0rgb1555 = conv_argb8888_0rgb1555_sse2;
+      k.conv_argb8888_rgb565   = conv_argb8888_rgb565_sse2;
+      k.conv_argb8888_rgba4444 = conv_argb8888_rgba4444_sse2;
+      k.conv_argb8888_bgr24    = conv_argb8888_bgr24_sse2;
+      k.conv_argb8888_abgr8888 = conv_argb8888_abgr8888_sse2;
+      k.conv_abgr8888_bgr24    = conv_abgr8888_bgr24_sse2;
+      k.conv_0rgb1555_bgr24    = conv_0rgb1555_bgr24_sse2;
+      k.conv_rgb565_bgr24      = conv_rgb565_bgr24_sse2;
+      k.conv_yuyv_argb8888     = conv_yuyv_argb8888_sse2;
+   }
+#endif
+#ifdef HAVE_PIXCONV_SSSE3
+   /* Only conversions that shuffle bytes around gain from SSSE3. */
+   if (simd & RETRO_SIMD_SSSE3)
+   {
+      k.conv_bgr24_argb8888    = conv_bgr24_argb8888_ssse3;
+      k.conv_argb8888_bgr24    = conv_argb8888_bgr24_ssse3;
+      k.conv_argb8888_abgr8888 = conv_argb8888_abgr8888_ssse3;
+      k.conv_abgr8888_bgr24    = conv_abgr8888_bgr24_ssse3;
+      k.conv_0rgb1555_bgr24    = conv_0rgb1555_bgr24_ssse3;
+      k.conv_rgb565_bgr24      = conv_rgb565_bgr24_ssse3;
+   }
+#endif
+#ifdef HAVE_PIXCONV_AVX2
+   if (simd & RETRO_SIMD_AVX2)
+   {
+      k.conv_rgb565_0rgb1555   = conv_rgb565_0rgb1555_avx2;
+      k.conv_0rgb1555_rgb565   = conv_0rgb1555_rgb565_avx2;
+      k.conv_0rgb1555_argb8888 = conv_0rgb1555_argb8888_avx2;
+      k.conv_rgb565_argb8888   = conv_rgb565_argb8888_avx2;
+      k.conv_rgba4444_argb8888 = conv_rgba4444_argb8888_avx2;
+      k.conv_rgba4444_rgb565   = conv_rgba4444_rgb565_avx2;
+      k.conv_bgr24_argb8888    = conv_bgr24_argb8888_avx2;
+      k.conv_argb8888_0rgb1555 = conv_argb8888_0rgb1555_avx2;
+      k.conv_argb8888_rgb565   = conv_argb8888_rgb565_avx2;
+      k.conv_argb8888_rgba4444 = conv_argb8888_rgba4444_avx2;
+      k.conv_argb8888_bgr24    = conv_argb8888_bgr24_avx2;
+      k.conv_argb8888_abgr8888 = conv_argb8888_abgr8888_avx2;
+      k.conv_abgr8888_bgr24    = conv_abgr8888_bgr24_avx2;
+      k.conv_0rgb1555_bgr24    = conv_0rgb1555_bgr24_avx2;
+      k.conv_rgb565_bgr24      = conv_rgb565_bgr24_avx2;
+      k.conv_yuyv_argb8888     = conv_yuyv_argb8888_avx2;
+   }
+#endif
+#ifdef HAVE_PIXCONV_NEON
+   if (simd & RETRO_SIMD_NEON)
+   {
+      k.conv_rgb565_0rgb1555   = conv_rgb565_0rgb1555_neon;
+      k.conv_0rgb1555_rgb565   = conv_0rgb1555_rgb565_neon;
+      k.conv_0rgb1555_argb8888 = conv_0rgb1555_argb8888_neon;
+      k.conv_rgb565_argb8888   = conv_rgb565_argb8888_neon;
+      k.conv_rgba4444_argb8888 = conv_rgba4444_argb8888_neon;
+      k.conv_rgba4444_rgb565   = conv_rgba4444_rgb565_neon;
+      k.conv_bgr24_argb8888    = conv_bgr24_argb8888_neon;
+      k.conv_argb8888_0rgb1555 = conv_argb8888_0rgb1555_neon;
+      k.conv_argb8888_rgb565   = conv_argb8888_rgb565_neon;
+      k.conv_argb8888_rgba4444 = conv_argb8888_rgba4444_neon;
+      k.conv_argb8888_bgr24    = conv_argb8888_bgr24_neon;
+      k.conv_argb8888_abgr8888 = conv_argb8888_abgr8888_neon;
+      k.conv_abgr8888_bgr24    = conv_abgr8888_bgr24_neon;
+      k.conv_0rgb1555_bgr24    = conv_0rgb1555_bgr24_neon;
+      k.conv_rgb565_bgr24      = conv_rgb565_bgr24_neon;
+      k.conv_yuyv_argb8888     = conv_yuyv_argb8888_neon;
+   }
 #endif
 
+   (void)simd;
+
+   pixconv_table = k;
+}
+
+/* Converts what the vector kernel can of a row. */
+#define PIXCONV_ROW(row, output, input, width) \
+   ((row) ? (row)((output), (input), (width)) : 0)
+
 void conv_rgb565_0rgb1555(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
    int h;
    const uint16_t *input = (const uint16_t*)input_;
-   uint16_t *output = (uint16_t*)output_;
-
-#if defined(__SSE2_)
-   int max_width = width - 7;
-
-   const __m128i hi_mask   = _mm_set1_epi16(0x7fe0);
-   const __m128i lo_mask   = _mm_set1_epi16(0x1f);
-#endif
+   uint16_t *output      = (uint16_t*)output_;
+   pixconv_row_t row     = pixconv_table.conv_rgb565_0rgb1555;
 
    for (h = 0; h < height;
          h++, output += out_stride >> 1, input += in_stride >> 1)
    {
-      int w = 0;
-#if defined(__SSE2_)
-      for (; w < max_width; w += 8)
-      {
-         const __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
-         __m128i hi = _mm_and_si128(_mm_slli_epi16(in, 1), hi_mask);
-         __m128i lo = _mm_and_si128(in, lo_mask);
-         _mm_storeu_si128((__m128i*)(output + w), _mm_or_si128(hi, lo));
-      }
-#endif
+      int w = PIXCONV_ROW(row, output, input, width);
 
       for (; w < width; w++)
       {
@@ -83,31 +1775,12 @@ void conv_0rgb1555_rgb565(void *output_, const void *input_,
    int h;
    const uint16_t *input   = (const uint16_t*)input_;
    uint16_t *output        = (uint16_t*)output_;
-
-#if defined(__SSE2__)
-   int max_width           = width - 7;
-
-   const __m128i hi_mask   = _mm_set1_epi16(
-         (int16_t)((0x1f << 11) | (0x1f << 6)));
-   const __m128i lo_mask   = _mm_set1_epi16(0x1f);
-   const __m128i glow_mask = _mm_set1_epi16(1 << 5);
-#endif
+   pixconv_row_t row       = pixconv_table.conv_0rgb1555_rgb565;
 
    for (h = 0; h < height;
          h++, output += out_stride >> 1, input += in_stride >> 1)
    {
-      int w = 0;
-#if defined(__SSE2__)
-      for (; w < max_width; w += 8)
-      {
-         const __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
-         __m128i rg   = _mm_and_si128(_mm_slli_epi16(in, 1), hi_mask);
-         __m128i b    = _mm_and_si128(in, lo_mask);
-         __m128i glow = _mm_and_si128(_mm_srli_epi16(in, 4), glow_mask);
-         _mm_storeu_si128((__m128i*)(output + w),
-               _mm_or_si128(rg, _mm_or_si128(b, glow)));
-      }
-#endif
+      int w = PIXCONV_ROW(row, output, input, width);
 
       for (; w < width; w++)
       {
@@ -127,50 +1800,12 @@ void conv_0rgb1555_argb8888(void *output_, const void *input_,
    int h;
    const uint16_t *input = (const uint16_t*)input_;
    uint32_t *output      = (uint32_t*)output_;
-
-#ifdef __SSE2__
-   const __m128i pix_mask_r  = _mm_set1_epi16(0x1f << 10);
-   const __m128i pix_mask_gb = _mm_set1_epi16(0x1f <<  5);
-   const __m128i mul15_mid   = _mm_set1_epi16(0x4200);
-   const __m128i mul15_hi    = _mm_set1_epi16(0x0210);
-   const __m128i a           = _mm_set1_epi16(0x00ff);
-
-   int max_width = width - 7;
-#endif
+   pixconv_row_t row     = pixconv_table.conv_0rgb1555_argb8888;
 
    for (h = 0; h < height;
          h++, output += out_stride >> 2, input += in_stride >> 1)
    {
-      int w = 0;
-#ifdef __SSE2__
-      for (; w < max_width; w += 8)
-      {
-         __m128i res_lo_bg, res_hi_bg;
-         __m128i res_lo_ra, res_hi_ra;
-         __m128i res_lo, res_hi;
-         const __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
-         __m128i r = _mm_and_si128(in, pix_mask_r);
-         __m128i g = _mm_and_si128(in, pix_mask_gb);
-         __m128i b = _mm_and_si128(_mm_slli_epi16(in, 5), pix_mask_gb);
-
-         r = _mm_mulhi_epi16(r, mul15_hi);
-         g = _mm_mulhi_epi16(g, mul15_mid);
-         b = _mm_mulhi_epi16(b, mul15_mid);
-
-         res_lo_bg = _mm_unpacklo_epi8(b, g);
-         res_hi_bg = _mm_unpackhi_epi8(b, g);
-         res_lo_ra = _mm_unpacklo_epi8(r, a);
-         res_hi_ra = _mm_unpackhi_epi8(r, a);
-
-         res_lo = _mm_or_si128(res_lo_bg,
-               _mm_slli_si128(res_lo_ra, 2));
-         res_hi = _mm_or_si128(res_hi_bg,
-               _mm_slli_si128(res_hi_ra, 2));
-
-         _mm_storeu_si128((__m128i*)(output + w + 0), res_lo);
-         _mm_storeu_si128((__m128i*)(output + w + 4), res_hi);
-      }
-#endif
+      int w = PIXCONV_ROW(row, output, input, width);
 
       for (; w < width; w++)
       {
@@ -194,51 +1829,12 @@ void conv_rgb565_argb8888(void *output_, const void *input_,
    int h;
    const uint16_t *input    = (const uint16_t*)input_;
    uint32_t *output         = (uint32_t*)output_;
-
-#if defined(__SSE2__)
-   const __m128i pix_mask_r = _mm_set1_epi16(0x1f << 10);
-   const __m128i pix_mask_g = _mm_set1_epi16(0x3f <<  5);
-   const __m128i pix_mask_b = _mm_set1_epi16(0x1f <<  5);
-   const __m128i mul16_r    = _mm_set1_epi16(0x0210);
-   const __m128i mul16_g    = _mm_set1_epi16(0x2080);
-   const __m128i mul16_b    = _mm_set1_epi16(0x4200);
-   const __m128i a          = _mm_set1_epi16(0x00ff);
-
-   int max_width            = width - 7;
-#endif
+   pixconv_row_t row        = pixconv_table.conv_rgb565_argb8888;
 
    for (h = 0; h < height;
          h++, output += out_stride >> 2, input += in_stride >> 1)
    {
-      int w = 0;
-#if defined(__SSE2__)
-      for (; w < max_width; w += 8)
-      {
-         __m128i res_lo, res_hi;
-         __m128i res_lo_bg, res_hi_bg, res_lo_ra, res_hi_ra;
-         const __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
-         __m128i r = _mm_and_si128(_mm_srli_epi16(in, 1), pix_mask_r);
-         __m128i g = _mm_and_si128(in, pix_mask_g);
-         __m128i b = _mm_and_si128(_mm_slli_epi16(in, 5), pix_mask_b);
-
-         r = _mm_mulhi_epi16(r, mul16_r);
-         g = _mm_mulhi_epi16(g, mul16_g);
-         b = _mm_mulhi_epi16(b, mul16_b);
-
-         res_lo_bg = _mm_unpacklo_epi8(b, g);
-         res_hi_bg = _mm_unpackhi_epi8(b, g);
-         res_lo_ra = _mm_unpacklo_epi8(r, a);
-         res_hi_ra = _mm_unpackhi_epi8(r, a);
-
-         res_lo = _mm_or_si128(res_lo_bg,
-               _mm_slli_si128(res_lo_ra, 2));
-         res_hi = _mm_or_si128(res_hi_bg,
-               _mm_slli_si128(res_hi_ra, 2));
-
-         _mm_storeu_si128((__m128i*)(output + w + 0), res_lo);
-         _mm_storeu_si128((__m128i*)(output + w + 4), res_hi);
-      }
-#endif
+      int w = PIXCONV_ROW(row, output, input, width);
 
       for (; w < width; w++)
       {
@@ -259,24 +1855,23 @@ void conv_argb8888_rgba4444(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
-   int h, w;
+   int h;
    const uint32_t *input = (const uint32_t*)input_;
    uint16_t *output      = (uint16_t*)output_;
+   pixconv_row_t row     = pixconv_table.conv_argb8888_rgba4444;
 
    for (h = 0; h < height;
-         h++, output += out_stride >> 2, input += in_stride >> 1)
+         h++, output += out_stride >> 1, input += in_stride >> 2)
    {
-      for (w = 0; w < width; w++)
+      int w = PIXCONV_ROW(row, output, input, width);
+
+      for (; w < width; w++)
       {
          uint32_t col = input[w];
-         uint32_t r = (col >> 16) & 0xf;
-         uint32_t g = (col >>  8) & 0xf;
-         uint32_t b = (col) & 0xf;
-         uint32_t a = (col >>  24) & 0xf;
-         r = (r >> 4) | r;
-         g = (g >> 4) | g;
-         b = (b >> 4) | b;
-         a = (a >> 4) | a;
+         uint32_t r = (col >> 20) & 0xf;
+         uint32_t g = (col >> 12) & 0xf;
+         uint32_t b = (col >>  4) & 0xf;
+         uint32_t a = (col >> 28) & 0xf;
 
          output[w] = (r << 12) | (g << 8) | (b << 4) | a;
       }
@@ -287,14 +1882,17 @@ void conv_rgba4444_argb8888(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
-   int h, w;
+   int h;
    const uint16_t *input = (const uint16_t*)input_;
    uint32_t *output      = (uint32_t*)output_;
+   pixconv_row_t row     = pixconv_table.conv_rgba4444_argb8888;
 
    for (h = 0; h < height;
          h++, output += out_stride >> 2, input += in_stride >> 1)
    {
-      for (w = 0; w < width; w++)
+      int w = PIXCONV_ROW(row, output, input, width);
+
+      for (; w < width; w++)
       {
          uint32_t col = input[w];
          uint32_t r = (col >> 12) & 0xf;
@@ -315,14 +1913,17 @@ void conv_rgba4444_rgb565(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
-   int h, w;
+   int h;
    const uint16_t *input = (const uint16_t*)input_;
    uint16_t *output      = (uint16_t*)output_;
+   pixconv_row_t row     = pixconv_table.conv_rgba4444_rgb565;
 
    for (h = 0; h < height;
          h++, output += out_stride >> 1, input += in_stride >> 1)
    {
-      for (w = 0; w < width; w++)
+      int w = PIXCONV_ROW(row, output, input, width);
+
+      for (; w < width; w++)
       {
          uint32_t col = input[w];
          uint32_t r   = (col >> 12) & 0xf;
@@ -334,53 +1935,6 @@ void conv_rgba4444_rgb565(void *output_, const void *input_,
    }
 }
 
-#if defined(__SSE2__)
-/* :( TODO: Make this saner. */
-static INLINE void store_bgr24_sse2(void *output, __m128i a,
-      __m128i b, __m128i c, __m128i d)
-{
-   const __m128i mask_0 = _mm_set_epi32(0, 0, 0, 0x00ffffff);
-   const __m128i mask_1 = _mm_set_epi32(0, 0, 0x00ffffff, 0);
-   const __m128i mask_2 = _mm_set_epi32(0, 0x00ffffff, 0, 0);
-   const __m128i mask_3 = _mm_set_epi32(0x00ffffff, 0, 0, 0);
-
-   __m128i a0 = _mm_and_si128(a, mask_0);
-   __m128i a1 = _mm_srli_si128(_mm_and_si128(a, mask_1),  1);
-   __m128i a2 = _mm_srli_si128(_mm_and_si128(a, mask_2),  2);
-   __m128i a3 = _mm_srli_si128(_mm_and_si128(a, mask_3),  3);
-   __m128i a4 = _mm_slli_si128(_mm_and_si128(b, mask_0), 12);
-   __m128i a5 = _mm_slli_si128(_mm_and_si128(b, mask_1), 11);
-
-   __m128i b0 = _mm_srli_si128(_mm_and_si128(b, mask_1), 5);
-   __m128i b1 = _mm_srli_si128(_mm_and_si128(b, mask_2), 6);
-   __m128i b2 = _mm_srli_si128(_mm_and_si128(b, mask_3), 7);
-   __m128i b3 = _mm_slli_si128(_mm_and_si128(c, mask_0), 8);
-   __m128i b4 = _mm_slli_si128(_mm_and_si128(c, mask_1), 7);
-   __m128i b5 = _mm_slli_si128(_mm_and_si128(c, mask_2), 6);
-
-   __m128i c0 = _mm_srli_si128(_mm_and_si128(c, mask_2), 10);
-   __m128i c1 = _mm_srli_si128(_mm_and_si128(c, mask_3), 11);
-   __m128i c2 = _mm_slli_si128(_mm_and_si128(d, mask_0),  4);
-   __m128i c3 = _mm_slli_si128(_mm_and_si128(d, mask_1),  3);
-   __m128i c4 = _mm_slli_si128(_mm_and_si128(d, mask_2),  2);
-   __m128i c5 = _mm_slli_si128(_mm_and_si128(d, mask_3),  1);
-
-   __m128i *out = (__m128i*)output;
-
-   _mm_storeu_si128(out + 0,
-         _mm_or_si128(a0, _mm_or_si128(a1, _mm_or_si128(a2,
-                  _mm_or_si128(a3, _mm_or_si128(a4, a5))))));
-
-   _mm_storeu_si128(out + 1,
-         _mm_or_si128(b0, _mm_or_si128(b1, _mm_or_si128(b2,
-                  _mm_or_si128(b3, _mm_or_si128(b4, b5))))));
-
-   _mm_storeu_si128(out + 2,
-         _mm_or_si128(c0, _mm_or_si128(c1, _mm_or_si128(c2,
-                  _mm_or_si128(c3, _mm_or_si128(c4, c5))))));
-}
-#endif
-
 void conv_0rgb1555_bgr24(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
@@ -388,67 +1942,13 @@ void conv_0rgb1555_bgr24(void *output_, const void *input_,
    int h;
    const uint16_t *input     = (const uint16_t*)input_;
    uint8_t *output           = (uint8_t*)output_;
-
-#if defined(__SSE2__)
-   const __m128i pix_mask_r  = _mm_set1_epi16(0x1f << 10);
-   const __m128i pix_mask_gb = _mm_set1_epi16(0x1f <<  5);
-   const __m128i mul15_mid   = _mm_set1_epi16(0x4200);
-   const __m128i mul15_hi    = _mm_set1_epi16(0x0210);
-   const __m128i a           = _mm_set1_epi16(0x00ff);
-
-   int max_width             = width - 15;
-#endif
+   pixconv_row_t row         = pixconv_table.conv_0rgb1555_bgr24;
 
    for (h = 0; h < height;
          h++, output += out_stride, input += in_stride >> 1)
    {
-      uint8_t *out = output;
-      int   w = 0;
-
-#if defined(__SSE2__)
-      for (; w < max_width; w += 16, out += 48)
-      {
-         __m128i res_lo_bg0, res_lo_bg1, res_hi_bg0, res_hi_bg1,
-                 res_lo_ra0, res_lo_ra1, res_hi_ra0, res_hi_ra1,
-                 res_lo0, res_lo1, res_hi0, res_hi1;
-         const __m128i in0 = _mm_loadu_si128((const __m128i*)(input + w + 0));
-         const __m128i in1 = _mm_loadu_si128((const __m128i*)(input + w + 8));
-         __m128i r0        = _mm_and_si128(in0, pix_mask_r);
-         __m128i r1        = _mm_and_si128(in1, pix_mask_r);
-         __m128i g0        = _mm_and_si128(in0, pix_mask_gb);
-         __m128i g1        = _mm_and_si128(in1, pix_mask_gb);
-         __m128i b0        = _mm_and_si128(_mm_slli_epi16(in0, 5), pix_mask_gb);
-         __m128i b1        = _mm_and_si128(_mm_slli_epi16(in1, 5), pix_mask_gb);
-
-         r0 = _mm_mulhi_epi16(r0, mul15_hi);
-         r1 = _mm_mulhi_epi16(r1, mul15_hi);
-         g0 = _mm_mulhi_epi16(g0, mul15_mid);
-         g1 = _mm_mulhi_epi16(g1, mul15_mid);
-         b0 = _mm_mulhi_epi16(b0, mul15_mid);
-         b1 = _mm_mulhi_epi16(b1, mul15_mid);
-
-         res_lo_bg0 = _mm_unpacklo_epi8(b0, g0);
-         res_lo_bg1 = _mm_unpacklo_epi8(b1, g1);
-         res_hi_bg0 = _mm_unpackhi_epi8(b0, g0);
-         res_hi_bg1 = _mm_unpackhi_epi8(b1, g1);
-         res_lo_ra0 = _mm_unpacklo_epi8(r0, a);
-         res_lo_ra1 = _mm_unpacklo_epi8(r1, a);
-         res_hi_ra0 = _mm_unpackhi_epi8(r0, a);
-         res_hi_ra1 = _mm_unpackhi_epi8(r1, a);
-
-         res_lo0 = _mm_or_si128(res_lo_bg0,
-               _mm_slli_si128(res_lo_ra0, 2));
-         res_lo1 = _mm_or_si128(res_lo_bg1,
-               _mm_slli_si128(res_lo_ra1, 2));
-         res_hi0 = _mm_or_si128(res_hi_bg0,
-               _mm_slli_si128(res_hi_ra0, 2));
-         res_hi1 = _mm_or_si128(res_hi_bg1,
-               _mm_slli_si128(res_hi_ra1, 2));
-
-         /* Non-POT pixel sizes ftl :( */
-         store_bgr24_sse2(out, res_lo0, res_hi0, res_lo1, res_hi1);
-      }
-#endif
+      int   w      = PIXCONV_ROW(row, output, input, width);
+      uint8_t *out = output + w * 3;
 
       for (; w < width; w++)
       {
@@ -474,66 +1974,12 @@ void conv_rgb565_bgr24(void *output_, const void *input_,
    int h;
    const uint16_t *input    = (const uint16_t*)input_;
    uint8_t *output          = (uint8_t*)output_;
-
-#if defined(__SSE2__)
-   const __m128i pix_mask_r = _mm_set1_epi16(0x1f << 10);
-   const __m128i pix_mask_g = _mm_set1_epi16(0x3f <<  5);
-   const __m128i pix_mask_b = _mm_set1_epi16(0x1f <<  5);
-   const __m128i mul16_r    = _mm_set1_epi16(0x0210);
-   const __m128i mul16_g    = _mm_set1_epi16(0x2080);
-   const __m128i mul16_b    = _mm_set1_epi16(0x4200);
-   const __m128i a          = _mm_set1_epi16(0x00ff);
-
-   int max_width            = width - 15;
-#endif
+   pixconv_row_t row        = pixconv_table.conv_rgb565_bgr24;
 
    for (h = 0; h < height; h++, output += out_stride, input += in_stride >> 1)
    {
-      uint8_t *out = output;
-      int        w = 0;
-#if defined(__SSE2__)
-      for (; w < max_width; w += 16, out += 48)
-      {
-         __m128i res_lo_bg0, res_hi_bg0, res_lo_ra0, res_hi_ra0;
-         __m128i res_lo_bg1, res_hi_bg1, res_lo_ra1, res_hi_ra1;
-         __m128i res_lo0, res_hi0, res_lo1, res_hi1;
-         const __m128i in0 = _mm_loadu_si128((const __m128i*)(input + w));
-         const __m128i in1 = _mm_loadu_si128((const __m128i*)(input + w + 8));
-         __m128i r0 = _mm_and_si128(_mm_srli_epi16(in0, 1), pix_mask_r);
-         __m128i g0 = _mm_and_si128(in0, pix_mask_g);
-         __m128i b0 = _mm_and_si128(_mm_slli_epi16(in0, 5), pix_mask_b);
-         __m128i r1 = _mm_and_si128(_mm_srli_epi16(in1, 1), pix_mask_r);
-         __m128i g1 = _mm_and_si128(in1, pix_mask_g);
-         __m128i b1 = _mm_and_si128(_mm_slli_epi16(in1, 5), pix_mask_b);
-
-         r0 = _mm_mulhi_epi16(r0, mul16_r);
-         g0 = _mm_mulhi_epi16(g0, mul16_g);
-         b0 = _mm_mulhi_epi16(b0, mul16_b);
-         r1 = _mm_mulhi_epi16(r1, mul16_r);
-         g1 = _mm_mulhi_epi16(g1, mul16_g);
-         b1 = _mm_mulhi_epi16(b1, mul16_b);
-
-         res_lo_bg0 = _mm_unpacklo_epi8(b0, g0);
-         res_hi_bg0 = _mm_unpackhi_epi8(b0, g0);
-         res_lo_ra0 = _mm_unpacklo_epi8(r0, a);
-         res_hi_ra0 = _mm_unpackhi_epi8(r0, a);
-         res_lo_bg1 = _mm_unpacklo_epi8(b1, g1);
-         res_hi_bg1 = _mm_unpackhi_epi8(b1, g1);
-         res_lo_ra1 = _mm_unpacklo_epi8(r1, a);
-         res_hi_ra1 = _mm_unpackhi_epi8(r1, a);
-
-         res_lo0 = _mm_or_si128(res_lo_bg0,
-               _mm_slli_si128(res_lo_ra0, 2));
-         res_hi0 = _mm_or_si128(res_hi_bg0,
-               _mm_slli_si128(res_hi_ra0, 2));
-         res_lo1 = _mm_or_si128(res_lo_bg1,
-               _mm_slli_si128(res_lo_ra1, 2));
-         res_hi1 = _mm_or_si128(res_hi_bg1,
-               _mm_slli_si128(res_hi_ra1, 2));
-
-         store_bgr24_sse2(out, res_lo0, res_hi0, res_lo1, res_hi1);
-      }
-#endif
+      int        w = PIXCONV_ROW(row, output, input, width);
+      uint8_t *out = output + w * 3;
 
       for (; w < width; w++)
       {
@@ -556,15 +2002,18 @@ void conv_bgr24_argb8888(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
-   int h, w;
+   int h;
    const uint8_t *input = (const uint8_t*)input_;
    uint32_t *output     = (uint32_t*)output_;
+   pixconv_row_t row    = pixconv_table.conv_bgr24_argb8888;
 
    for (h = 0; h < height;
          h++, output += out_stride >> 2, input += in_stride)
    {
-      const uint8_t *inp = input;
-      for (w = 0; w < width; w++)
+      int              w = PIXCONV_ROW(row, output, input, width);
+      const uint8_t *inp = input + w * 3;
+
+      for (; w < width; w++)
       {
          uint32_t b = *inp++;
          uint32_t g = *inp++;
@@ -578,14 +2027,17 @@ void conv_argb8888_0rgb1555(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
-   int h, w;
+   int h;
    const uint32_t *input = (const uint32_t*)input_;
    uint16_t *output      = (uint16_t*)output_;
+   pixconv_row_t row     = pixconv_table.conv_argb8888_0rgb1555;
 
    for (h = 0; h < height;
          h++, output += out_stride >> 1, input += in_stride >> 2)
    {
-      for (w = 0; w < width; w++)
+      int w = PIXCONV_ROW(row, output, input, width);
+
+      for (; w < width; w++)
       {
          uint32_t col = input[w];
          uint16_t r = (col >> 19) & 0x1f;
@@ -596,6 +2048,31 @@ void conv_argb8888_0rgb1555(void *output_, const void *input_,
    }
 }
 
+void conv_argb8888_rgb565(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
+   pixconv_row_t row     = pixconv_table.conv_argb8888_rgb565;
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 1, input += in_stride >> 2)
+   {
+      int w = PIXCONV_ROW(row, output, input, width);
+
+      for (; w < width; w++)
+      {
+         uint32_t col = input[w];
+         uint16_t r = (col >> 19) & 0x1f;
+         uint16_t g = (col >> 10) & 0x3f;
+         uint16_t b = (col >>  3) & 0x1f;
+         output[w] = (r << 11) | (g << 5) | (b << 0);
+      }
+   }
+}
+
 void conv_argb8888_bgr24(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
@@ -603,26 +2080,13 @@ void conv_argb8888_bgr24(void *output_, const void *input_,
    int h;
    const uint32_t *input = (const uint32_t*)input_;
    uint8_t *output       = (uint8_t*)output_;
-
-#if defined(__SSE2__)
-   int max_width = width - 15;
-#endif
+   pixconv_row_t row     = pixconv_table.conv_argb8888_bgr24;
 
    for (h = 0; h < height;
          h++, output += out_stride, input += in_stride >> 2)
    {
-      uint8_t *out = output;
-      int        w = 0;
-#if defined(__SSE2__)
-      for (; w < max_width; w += 16, out += 48)
-      {
-         store_bgr24_sse2(out,
-               _mm_loadu_si128((const __m128i*)(input + w +  0)),
-               _mm_loadu_si128((const __m128i*)(input + w +  4)),
-               _mm_loadu_si128((const __m128i*)(input + w +  8)),
-               _mm_loadu_si128((const __m128i*)(input + w + 12)));
-      }
-#endif
+      int        w = PIXCONV_ROW(row, output, input, width);
+      uint8_t *out = output + w * 3;
 
       for (; w < width; w++)
       {
@@ -638,14 +2102,17 @@ void conv_argb8888_abgr8888(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
-   int h, w;
+   int h;
    const uint32_t *input = (const uint32_t*)input_;
    uint32_t *output      = (uint32_t*)output_;
+   pixconv_row_t row     = pixconv_table.conv_argb8888_abgr8888;
 
    for (h = 0; h < height;
          h++, output += out_stride >> 2, input += in_stride >> 2)
    {
-      for (w = 0; w < width; w++)
+      int w = PIXCONV_ROW(row, output, input, width);
+
+      for (; w < width; w++)
       {
          uint32_t col = input[w];
          output[w] = ((col << 16) & 0xff0000) | 
@@ -654,13 +2121,32 @@ void conv_argb8888_abgr8888(void *output_, const void *input_,
    }
 }
 
-#define YUV_SHIFT 6
-#define YUV_OFFSET (1 << (YUV_SHIFT - 1))
-#define YUV_MAT_Y (1 << 6)
-#define YUV_MAT_U_G (-22)
-#define YUV_MAT_U_B (113)
-#define YUV_MAT_V_R (90)
-#define YUV_MAT_V_G (-46)
+/* R, G, B, A bytes as read back from GL, which is ABGR8888 on
+ * little-endian hosts. */
+void conv_abgr8888_bgr24(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h;
+   const uint8_t *input = (const uint8_t*)input_;
+   uint8_t *output      = (uint8_t*)output_;
+   pixconv_row_t row    = pixconv_table.conv_abgr8888_bgr24;
+
+   for (h = 0; h < height;
+         h++, output += out_stride, input += in_stride)
+   {
+      int              w = PIXCONV_ROW(row, output, input, width);
+      const uint8_t *src = input + w * 4;
+      uint8_t       *dst = output + w * 3;
+
+      for (; w < width; w++, dst += 3, src += 4)
+      {
+         dst[0] = src[2];
+         dst[1] = src[1];
+         dst[2] = src[0];
+      }
+   }
+}
 
 void conv_yuyv_argb8888(void *output_, const void *input_,
       int width, int height,
@@ -669,113 +2155,13 @@ void conv_yuyv_argb8888(void *output_, const void *input_,
    int h;
    const uint8_t *input        = (const uint8_t*)input_;
    uint32_t *output            = (uint32_t*)output_;
-
-#if defined(__SSE2__)
-   const __m128i mask_y        = _mm_set1_epi16(0xffu);
-   const __m128i mask_u        = _mm_set1_epi32(0xffu << 8);
-   const __m128i mask_v        = _mm_set1_epi32(0xffu << 24);
-   const __m128i chroma_offset = _mm_set1_epi16(128);
-   const __m128i round_offset  = _mm_set1_epi16(YUV_OFFSET);
-
-   const __m128i yuv_mul       = _mm_set1_epi16(YUV_MAT_Y);
-   const __m128i u_g_mul       = _mm_set1_epi16(YUV_MAT_U_G);
-   const __m128i u_b_mul       = _mm_set1_epi16(YUV_MAT_U_B);
-   const __m128i v_r_mul       = _mm_set1_epi16(YUV_MAT_V_R);
-   const __m128i v_g_mul       = _mm_set1_epi16(YUV_MAT_V_G);
-   const __m128i a             = _mm_cmpeq_epi16(
-         _mm_setzero_si128(), _mm_setzero_si128());
-#endif
+   pixconv_row_t row           = pixconv_table.conv_yuyv_argb8888;
 
    for (h = 0; h < height; h++, output += out_stride >> 2, input += in_stride)
    {
-      const uint8_t *src = input;
-      uint32_t      *dst = output;
-      int              w = 0;
-
-#if defined(__SSE2__)
-      /* Each loop processes 16 pixels. */
-      for (; w + 16 <= width; w += 16, src += 32, dst += 16)
-      {
-         __m128i u, v, u0_g, u1_g, u0_b, u1_b, v0_r, v1_r, v0_g, v1_g,
-                 r0, g0, b0, r1, g1, b1;
-         __m128i res_lo_bg, res_hi_bg, res_lo_ra, res_hi_ra;
-         __m128i res0, res1, res2, res3;
-         __m128i yuv0 = _mm_loadu_si128((const __m128i*)(src +  0)); /* [Y0, U0, Y1, V0, Y2, U1, Y3, V1, ...] */
-         __m128i yuv1 = _mm_loadu_si128((const __m128i*)(src + 16)); /* [Y0, U0, Y1, V0, Y2, U1, Y3, V1, ...] */
-
-         __m128i _y0 = _mm_and_si128(yuv0, mask_y); /* [Y0, Y1, Y2, ...] (16-bit) */
-         __m128i u0 = _mm_and_si128(yuv0, mask_u); /* [0, U0, 0, 0, 0, U1, 0, 0, ...] */
-         __m128i v0 = _mm_and_si128(yuv0, mask_v); /* [0, 0, 0, V1, 0, , 0, V1, ...] */
-         __m128i _y1 = _mm_and_si128(yuv1, mask_y); /* [Y0, Y1, Y2, ...] (16-bit) */
-         __m128i u1 = _mm_and_si128(yuv1, mask_u); /* [0, U0, 0, 0, 0, U1, 0, 0, ...] */
-         __m128i v1 = _mm_and_si128(yuv1, mask_v); /* [0, 0, 0, V1, 0, , 0, V1, ...] */
-
-         /* Juggle around to get U and V in the same 16-bit format as Y. */
-         u0 = _mm_srli_si128(u0, 1);
-         v0 = _mm_srli_si128(v0, 3);
-         u1 = _mm_srli_si128(u1, 1);
-         v1 = _mm_srli_si128(v1, 3);
-         u = _mm_packs_epi32(u0, u1);
-         v = _mm_packs_epi32(v0, v1);
-
-         /* Apply YUV offsets (U, V) -= (-128, -128). */
-         u = _mm_sub_epi16(u, chroma_offset);
-         v = _mm_sub_epi16(v, chroma_offset);
-
-         /* Upscale chroma horizontally (nearest). */
-         u0 = _mm_unpacklo_epi16(u, u);
-         u1 = _mm_unpackhi_epi16(u, u);
-         v0 = _mm_unpacklo_epi16(v, v);
-         v1 = _mm_unpackhi_epi16(v, v);
-
-         /* Apply transformations. */
-         _y0 = _mm_mullo_epi16(_y0, yuv_mul);
-         _y1 = _mm_mullo_epi16(_y1, yuv_mul);
-         u0_g   = _mm_mullo_epi16(u0, u_g_mul);
-         u1_g   = _mm_mullo_epi16(u1, u_g_mul);
-         u0_b   = _mm_mullo_epi16(u0, u_b_mul);
-         u1_b   = _mm_mullo_epi16(u1, u_b_mul);
-         v0_r   = _mm_mullo_epi16(v0, v_r_mul);
-         v1_r   = _mm_mullo_epi16(v1, v_r_mul);
-         v0_g   = _mm_mullo_epi16(v0, v_g_mul);
-         v1_g   = _mm_mullo_epi16(v1, v_g_mul);
-
-         /* Add contibutions from the transformed components. */
-         r0 = _mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(_y0, v0_r),
-                  round_offset), YUV_SHIFT);
-         g0 = _mm_srai_epi16(_mm_adds_epi16(
-                  _mm_adds_epi16(_mm_adds_epi16(_y0, v0_g), u0_g), round_offset), YUV_SHIFT);
-         b0 = _mm_srai_epi16(_mm_adds_epi16(
-                  _mm_adds_epi16(_y0, u0_b), round_offset), YUV_SHIFT);
-
-         r1 = _mm_srai_epi16(_mm_adds_epi16(
-                  _mm_adds_epi16(_y1, v1_r), round_offset), YUV_SHIFT);
-         g1 = _mm_srai_epi16(_mm_adds_epi16(
-                  _mm_adds_epi16(_mm_adds_epi16(_y1, v1_g), u1_g), round_offset), YUV_SHIFT);
-         b1 = _mm_srai_epi16(_mm_adds_epi16(
-                  _mm_adds_epi16(_y1, u1_b), round_offset), YUV_SHIFT);
-
-         /* Saturate into 8-bit. */
-         r0 = _mm_packus_epi16(r0, r1);
-         g0 = _mm_packus_epi16(g0, g1);
-         b0 = _mm_packus_epi16(b0, b1);
-
-         /* Interleave into ARGB. */
-         res_lo_bg = _mm_unpacklo_epi8(b0, g0);
-         res_hi_bg = _mm_unpackhi_epi8(b0, g0);
-         res_lo_ra = _mm_unpacklo_epi8(r0, a);
-         res_hi_ra = _mm_unpackhi_epi8(r0, a);
-         res0 = _mm_unpacklo_epi16(res_lo_bg, res_lo_ra);
-         res1 = _mm_unpackhi_epi16(res_lo_bg, res_lo_ra);
-         res2 = _mm_unpacklo_epi16(res_hi_bg, res_hi_ra);
-         res3 = _mm_unpackhi_epi16(res_hi_bg, res_hi_ra);
-
-         _mm_storeu_si128((__m128i*)(dst +  0), res0);
-         _mm_storeu_si128((__m128i*)(dst +  4), res1);
-         _mm_storeu_si128((__m128i*)(dst +  8), res2);
-         _mm_storeu_si128((__m128i*)(dst + 12), res3);
-      }
-#endif
+      int              w = PIXCONV_ROW(row, output, input, width);
+      const uint8_t *src = input + w * 2;
+      uint32_t      *dst = output + w;
 
       /* Finish off the rest (if any) in C. */
       for (; w < width; w += 2, src += 4, dst += 2)
@@ -815,4 +2201,3 @@ void conv_copy(void *output_, const void *input_,
          h++, output += out_stride, input += in_stride)
       memcpy(output, input, copy_len);
 }
-
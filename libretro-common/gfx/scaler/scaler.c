@@ -29,6 +29,37 @@
 #include <gfx/scaler/scaler_int.h>
 #include <gfx/scaler/filter.h>
 #include <gfx/scaler/pixconv.h>
+#include <features/features_cpu.h>
+#include <retro_miscellaneous.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthread_pool.h>
+#endif
+
+/* Output rows per strip. A strip converts and scales the input rows
+ * it needs and filters them into output rows right away, so no pass
+ * goes through a whole frame. Strips also split the frame between
+ * the threads of a pool. */
+#define SCALER_STRIP_ROWS 16
+
+struct scaler_scratch
+{
+   /* An input row converted to ARGB8888. */
+   uint32_t *input;
+   /* An output row to convert from ARGB8888. */
+   uint32_t *output;
+   /* Horizontally scaled rows, starting with input row first. */
+   uint64_t *scaled;
+   int first;
+   int rows;
+};
+
+struct scaler_job
+{
+   const struct scaler_ctx *ctx;
+   void *output;
+   const void *input;
+};
 
 /**
  * scaler_alloc:
@@ -60,35 +91,68 @@ void scaler_free(void *ptr)
       free(ptr);
 }
 
-static bool allocate_frames(struct scaler_ctx *ctx)
+static bool allocate_scratch(struct scaler_ctx *ctx)
 {
-   ctx->scaled.stride = ((ctx->out_width + 7) & ~7) * sizeof(uint64_t);
-   ctx->scaled.width  = ctx->out_width;
-   ctx->scaled.height = ctx->in_height;
-   ctx->scaled.frame  = (uint64_t*)
-      scaler_alloc(sizeof(uint64_t),
-            (ctx->scaled.stride * ctx->scaled.height) >> 3);
-   if (!ctx->scaled.frame)
-      return false;
+   int y;
+   unsigned i;
+   unsigned threads = 1;
 
-   if (ctx->in_fmt != SCALER_FMT_ARGB8888)
+#ifdef HAVE_THREADS
+   threads = rthread_pool_threads(ctx->pool);
+#endif
+
+   ctx->scaled_stride = ((ctx->out_width + 7) & ~7) * sizeof(uint64_t);
+   ctx->scaled_rows   = 0;
+
+   /* Point scaling skips the filters. Otherwise, the most input
+    * rows any strip needs. */
+   if (!ctx->scaler_special)
    {
-      ctx->input.stride = ((ctx->in_width + 7) & ~7) * sizeof(uint32_t);
-      ctx->input.frame = (uint32_t*)
-         scaler_alloc(sizeof(uint32_t),
-               (ctx->input.stride * ctx->in_height) >> 2);
-      if (!ctx->input.frame)
-         return false;
+      for (y = 0; y < ctx->out_height; y += SCALER_STRIP_ROWS)
+      {
+         int end  = MIN(y + SCALER_STRIP_ROWS, ctx->out_height);
+         int rows = ctx->vert.filter_pos[end - 1]
+            + ctx->vert.filter_len - ctx->vert.filter_pos[y];
+
+         if (rows > ctx->scaled_rows)
+            ctx->scaled_rows = rows;
+      }
    }
 
-   if (ctx->out_fmt != SCALER_FMT_ARGB8888)
+   ctx->scratch = (struct scaler_scratch*)
+      scaler_alloc(sizeof(*ctx->scratch), threads);
+   if (!ctx->scratch)
+      return false;
+
+   ctx->scratch_threads = threads;
+
+   for (i = 0; i < threads; i++)
    {
-      ctx->output.stride = ((ctx->out_width + 7) & ~7) * sizeof(uint32_t);
-      ctx->output.frame  = (uint32_t*)
-         scaler_alloc(sizeof(uint32_t),
-               (ctx->output.stride * ctx->out_height) >> 2);
-      if (!ctx->output.frame)
-         return false;
+      struct scaler_scratch *scratch = &ctx->scratch[i];
+
+      if (ctx->in_fmt != SCALER_FMT_ARGB8888)
+      {
+         scratch->input = (uint32_t*)
+            scaler_alloc(sizeof(uint32_t), ctx->in_width);
+         if (!scratch->input)
+            return false;
+      }
+
+      if (ctx->out_fmt != SCALER_FMT_ARGB8888)
+      {
+         scratch->output = (uint32_t*)
+            scaler_alloc(sizeof(uint32_t), ctx->out_width);
+         if (!scratch->output)
+            return false;
+      }
+
+      if (ctx->scaled_rows)
+      {
+         scratch->scaled = (uint64_t*)
+            scaler_alloc(ctx->scaled_stride, ctx->scaled_rows);
+         if (!scratch->scaled)
+            return false;
+      }
    }
 
    return true;
@@ -266,52 +330,171 @@ bool scaler_ctx_gen_filter(struct scaler_ctx *ctx)
 {
    scaler_ctx_gen_reset(ctx);
 
+   ctx->scaler_special = NULL;
+
    if (ctx->in_width == ctx->out_width && ctx->in_height == ctx->out_height)
-      ctx->unscaled = true; /* Only pixel format conversion ... */
-   else
    {
-      ctx->scaler_horiz = scaler_argb8888_horiz;
-      ctx->scaler_vert  = scaler_argb8888_vert;
-      ctx->unscaled     = false;
+      ctx->unscaled = true; /* Only pixel format conversion ... */
+      return set_direct_pix_conv(ctx);
    }
 
-   ctx->scaler_special = NULL;
+   ctx->unscaled = false;
+   scaler_select_kernels(ctx, cpu_features_get());
 
-   if (!allocate_frames(ctx))
+   if (!set_pix_conv(ctx))
       return false;
 
-   if (ctx->unscaled)
-   {
-      if (!set_direct_pix_conv(ctx))
-         return false;
-   }
-   else
-   {
-      if (!set_pix_conv(ctx))
-         return false;
-   }
-
-   if (!ctx->unscaled && !scaler_gen_filter(ctx))
+   if (!scaler_gen_filter(ctx))
       return false;
 
-   return true;
+   return allocate_scratch(ctx);
 }
 
 void scaler_ctx_gen_reset(struct scaler_ctx *ctx)
 {
+   unsigned i;
+
    scaler_free(ctx->horiz.filter);
    scaler_free(ctx->horiz.filter_pos);
    scaler_free(ctx->vert.filter);
    scaler_free(ctx->vert.filter_pos);
-   scaler_free(ctx->scaled.frame);
-   scaler_free(ctx->input.frame);
-   scaler_free(ctx->output.frame);
+
+   if (ctx->scratch)
+   {
+      for (i = 0; i < ctx->scratch_threads; i++)
+      {
+         scaler_free(ctx->scratch[i].input);
+         scaler_free(ctx->scratch[i].output);
+         scaler_free(ctx->scratch[i].scaled);
+      }
+      scaler_free(ctx->scratch);
+   }
 
    memset(&ctx->horiz, 0, sizeof(ctx->horiz));
    memset(&ctx->vert, 0, sizeof(ctx->vert));
-   memset(&ctx->scaled, 0, sizeof(ctx->scaled));
-   memset(&ctx->input, 0, sizeof(ctx->input));
-   memset(&ctx->output, 0, sizeof(ctx->output));
+   ctx->scratch         = NULL;
+   ctx->scratch_threads = 0;
+   ctx->scaled_stride   = 0;
+   ctx->scaled_rows     = 0;
+}
+
+static const uint32_t *scaler_input_row(const struct scaler_ctx *ctx,
+      struct scaler_scratch *scratch, const void *input, int y)
+{
+   const uint8_t *row = (const uint8_t*)input + y * ctx->in_stride;
+
+   if (ctx->in_fmt == SCALER_FMT_ARGB8888)
+      return (const uint32_t*)row;
+
+   ctx->in_pixconv(scratch->input, row, ctx->in_width, 1, 0, 0);
+   return scratch->input;
+}
+
+static uint32_t *scaler_output_row(const struct scaler_ctx *ctx,
+      struct scaler_scratch *scratch, void *output, int y)
+{
+   if (ctx->out_fmt == SCALER_FMT_ARGB8888)
+      return (uint32_t*)((uint8_t*)output + y * ctx->out_stride);
+   return scratch->output;
+}
+
+static void scaler_finish_row(const struct scaler_ctx *ctx,
+      struct scaler_scratch *scratch, void *output, int y)
+{
+   if (ctx->out_fmt != SCALER_FMT_ARGB8888)
+      ctx->out_pixconv((uint8_t*)output + y * ctx->out_stride,
+            scratch->output, ctx->out_width, 1, 0, 0);
+}
+
+static void scaler_strip_filter(const struct scaler_ctx *ctx,
+      struct scaler_scratch *scratch, void *output, const void *input,
+      int y, int end)
+{
+   int row;
+   const int stride = ctx->scaled_stride >> 3;
+   int first        = ctx->vert.filter_pos[y];
+   int last         = ctx->vert.filter_pos[end - 1] + ctx->vert.filter_len;
+   int kept         = 0;
+
+   /* Strips overlap by a few input rows. When this thread ran the
+    * strip above, keep its rows instead of scaling them again. */
+   if (scratch->rows && first >= scratch->first
+         && first < scratch->first + scratch->rows)
+   {
+      kept = MIN(scratch->first + scratch->rows, last) - first;
+      if (first != scratch->first)
+         memmove(scratch->scaled,
+               scratch->scaled + (first - scratch->first) * stride,
+               kept * ctx->scaled_stride);
+   }
+
+   for (row = first + kept; row < last; row++)
+      ctx->scaler_horiz(ctx, scratch->scaled + (row - first) * stride,
+            scaler_input_row(ctx, scratch, input, row));
+
+   scratch->first = first;
+   scratch->rows  = last - first;
+
+   for (; y < end; y++)
+   {
+      ctx->scaler_vert(ctx, scaler_output_row(ctx, scratch, output, y),
+            scratch->scaled + (ctx->vert.filter_pos[y] - first) * stride,
+            ctx->vert.filter + y * ctx->vert.filter_stride);
+      scaler_finish_row(ctx, scratch, output, y);
+   }
+}
+
+static void scaler_strip_special(const struct scaler_ctx *ctx,
+      struct scaler_scratch *scratch, void *output, const void *input,
+      int y, int end)
+{
+   for (; y < end; y++)
+   {
+      int row = ctx->vert.filter_pos[y];
+
+      /* Upscaling picks the same input row several times over. */
+      if (!scratch->rows || scratch->first != row)
+      {
+         scratch->first = row;
+         scratch->rows  = 1;
+         if (ctx->in_fmt != SCALER_FMT_ARGB8888)
+            scaler_input_row(ctx, scratch, input, row);
+      }
+
+      ctx->scaler_special(ctx, scaler_output_row(ctx, scratch, output, y),
+            ctx->in_fmt != SCALER_FMT_ARGB8888 ? scratch->input
+            : (const uint32_t*)((const uint8_t*)input + row * ctx->in_stride));
+      scaler_finish_row(ctx, scratch, output, y);
+   }
+}
+
+static void scaler_strip(void *data, unsigned strip, unsigned thread)
+{
+   const struct scaler_job *job = (const struct scaler_job*)data;
+   const struct scaler_ctx *ctx = job->ctx;
+   int y                        = (int)strip * SCALER_STRIP_ROWS;
+   int end                      = MIN(y + SCALER_STRIP_ROWS, ctx->out_height);
+
+   if (ctx->scaler_special)
+      scaler_strip_special(ctx, &ctx->scratch[thread],
+            job->output, job->input, y, end);
+   else
+      scaler_strip_filter(ctx, &ctx->scratch[thread],
+            job->output, job->input, y, end);
+}
+
+static void scaler_strip_direct(void *data, unsigned strip, unsigned thread)
+{
+   const struct scaler_job *job = (const struct scaler_job*)data;
+   const struct scaler_ctx *ctx = job->ctx;
+   int y                        = (int)strip * SCALER_STRIP_ROWS;
+   int rows                     = MIN(SCALER_STRIP_ROWS, ctx->out_height - y);
+
+   (void)thread;
+
+   ctx->direct_pixconv((uint8_t*)job->output + y * ctx->out_stride,
+         (const uint8_t*)job->input + y * ctx->in_stride,
+         ctx->out_width, rows, ctx->out_stride, ctx->in_stride);
 }
 
 /**
@@ -325,55 +508,43 @@ void scaler_ctx_gen_reset(struct scaler_ctx *ctx)
 void scaler_ctx_scale(struct scaler_ctx *ctx,
       void *output, const void *input)
 {
-   const void *input_frame = input;
-   void *output_frame      = output;
-   int input_stride        = ctx->in_stride;
-   int output_stride       = ctx->out_stride;
+   unsigned i;
+   struct scaler_job job;
+   unsigned strips = (ctx->out_height + SCALER_STRIP_ROWS - 1)
+      / SCALER_STRIP_ROWS;
+
+   job.ctx    = ctx;
+   job.output = output;
+   job.input  = input;
 
    if (ctx->unscaled)
    {
       /* Just perform straight pixel conversion. */
+#ifdef HAVE_THREADS
+      if (ctx->pool && rthread_pool_threads(ctx->pool) > 1)
+      {
+         rthread_pool_run(ctx->pool, scaler_strip_direct, &job, strips);
+         return;
+      }
+#endif
       ctx->direct_pixconv(output, input,
             ctx->out_width, ctx->out_height,
             ctx->out_stride, ctx->in_stride);
       return;
    }
 
-   if (ctx->in_fmt != SCALER_FMT_ARGB8888)
-   {
-      ctx->in_pixconv(ctx->input.frame, input,
-            ctx->in_width, ctx->in_height,
-            ctx->input.stride, ctx->in_stride);
-
-      input_frame       = ctx->input.frame;
-      input_stride      = ctx->input.stride;
-   }
-
-   if (ctx->out_fmt != SCALER_FMT_ARGB8888)
-   {
-      output_frame  = ctx->output.frame;
-      output_stride = ctx->output.stride;
-   }
+   for (i = 0; i < ctx->scratch_threads; i++)
+      ctx->scratch[i].rows = 0;
 
-   if (ctx->scaler_special)
+#ifdef HAVE_THREADS
+   /* Scratch space is only there for the pool we were set up with. */
+   if (ctx->pool && rthread_pool_threads(ctx->pool) == ctx->scratch_threads)
    {
-      /* Take some special, and (hopefully) more optimized path. */
-      ctx->scaler_special(ctx, output_frame, input_frame,
-            ctx->out_width, ctx->out_height,
-            ctx->in_width, ctx->in_height,
-            output_stride, input_stride);
-   }
-   else
-   {
-      /* Take generic filter path. */
-      if (ctx->scaler_horiz)
-         ctx->scaler_horiz(ctx, input_frame, input_stride);
-      if (ctx->scaler_vert)
-         ctx->scaler_vert (ctx, output, output_stride);
+      rthread_pool_run(ctx->pool, scaler_strip, &job, strips);
+      return;
    }
+#endif
 
-   if (ctx->out_fmt != SCALER_FMT_ARGB8888)
-      ctx->out_pixconv(output, ctx->output.frame,
-            ctx->out_width, ctx->out_height,
-            ctx->out_stride, ctx->output.stride);
+   for (i = 0; i < strips; i++)
+      scaler_strip(&job, i, 0);
 }
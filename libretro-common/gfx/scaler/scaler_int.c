@@ -23,15 +23,22 @@
 #include <gfx/scaler/scaler_int.h>
 
 #include <retro_inline.h>
-
-#ifdef SCALER_NO_SIMD
-#undef __SSE2__
+#include <libretro.h>
+#include <features/features_target.h>
+
+#ifndef SCALER_NO_SIMD
+#if defined(RETRO_HAVE_TARGET_X86)
+#define HAVE_SCALER_SSE2
+#define HAVE_SCALER_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#define HAVE_SCALER_SSE2
+#include <emmintrin.h>
 #endif
 
-#if defined(__SSE2__)
-#include <emmintrin.h>
-#ifdef _WIN32
-#include <intrin.h>
+#if (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(VITA)
+#define HAVE_SCALER_NEON
+#include <arm_neon.h>
 #endif
 #endif
 
@@ -51,235 +58,426 @@
  * Scaling is now complete. Channels are shifted right by 3, and saturated into 8-bit values.
  *
  * The C version of scalers perform the exact same operations as the SIMD code for testing purposes.
+ * The SIMD versions saturate their sums, which the filters never get near, so all of them
+ * give the same result in whatever order they add up the taps.
  */
 
-#if defined(__SSE2__)
-void scaler_argb8888_vert(const struct scaler_ctx *ctx, void *output_, int stride)
+static INLINE uint32_t scaler_vert_pixel(const struct scaler_ctx *ctx,
+      const uint64_t *input_base_y, const int16_t *filter_vert)
 {
-   int h, w, y;
-   const uint64_t *input = ctx->scaled.frame;
-   uint32_t      *output = (uint32_t*)output_;
+   int y;
+   int16_t res_a = 0;
+   int16_t res_r = 0;
+   int16_t res_g = 0;
+   int16_t res_b = 0;
+
+   for (y = 0; y < ctx->vert.filter_len; y++, input_base_y += (ctx->scaled_stride >> 3))
+   {
+      uint64_t col = *input_base_y;
+
+      int16_t a = (col >> 48) & 0xffff;
+      int16_t r = (col >> 32) & 0xffff;
+      int16_t g = (col >> 16) & 0xffff;
+      int16_t b = (col >>  0) & 0xffff;
+
+      int16_t coeff = filter_vert[y];
 
-   const int16_t *filter_vert = ctx->vert.filter;
+      res_a += (a * coeff) >> 16;
+      res_r += (r * coeff) >> 16;
+      res_g += (g * coeff) >> 16;
+      res_b += (b * coeff) >> 16;
+   }
+
+   res_a >>= (7 - 2 - 2);
+   res_r >>= (7 - 2 - 2);
+   res_g >>= (7 - 2 - 2);
+   res_b >>= (7 - 2 - 2);
+
+   return ((uint32_t)clamp_8bit(res_a) << 24) | (clamp_8bit(res_r) << 16) | (clamp_8bit(res_g) << 8) | (clamp_8bit(res_b) << 0);
+}
 
-   for (h = 0; h < ctx->out_height; h++, filter_vert += ctx->vert.filter_stride, output += stride >> 2)
+void scaler_argb8888_vert(const struct scaler_ctx *ctx,
+      uint32_t *output, const uint64_t *input, const int16_t *filter)
+{
+   int w;
+
+   for (w = 0; w < ctx->out_width; w++)
+      output[w] = scaler_vert_pixel(ctx, input + w, filter);
+}
+
+static INLINE uint64_t build_argb64(uint16_t a, uint16_t r, uint16_t g, uint16_t b)
+{
+   return ((uint64_t)a << 48) | ((uint64_t)r << 32) | ((uint64_t)g << 16) | ((uint64_t)b << 0);
+}
+
+void scaler_argb8888_horiz(const struct scaler_ctx *ctx,
+      uint64_t *output, const uint32_t *input)
+{
+   int w, x;
+   const int16_t *filter_horiz = ctx->horiz.filter;
+
+   for (w = 0; w < ctx->out_width; w++, filter_horiz += ctx->horiz.filter_stride)
    {
-      const uint64_t *input_base = input + ctx->vert.filter_pos[h] * (ctx->scaled.stride >> 3);
+      const uint32_t *input_base_x = input + ctx->horiz.filter_pos[w];
+
+      int16_t res_a = 0;
+      int16_t res_r = 0;
+      int16_t res_g = 0;
+      int16_t res_b = 0;
 
-      for (w = 0; w < ctx->out_width; w++)
+      for (x = 0; x < ctx->horiz.filter_len; x++)
       {
-         __m128i final;
-         __m128i res = _mm_setzero_si128();
+         uint32_t col = input_base_x[x];
+
+         int16_t a = (col >> (24 - 7)) & (0xff << 7);
+         int16_t r = (col >> (16 - 7)) & (0xff << 7);
+         int16_t g = (col >> ( 8 - 7)) & (0xff << 7);
+         int16_t b = (col << ( 0 + 7)) & (0xff << 7);
 
-         const uint64_t *input_base_y = input_base + w;
+         int16_t coeff = filter_horiz[x];
 
-         for (y = 0; (y + 1) < ctx->vert.filter_len; y += 2, input_base_y += (ctx->scaled.stride >> 2))
-         {
-            __m128i coeff = _mm_set_epi64x(filter_vert[y + 1] * 0x0001000100010001ll, filter_vert[y + 0] * 0x0001000100010001ll);
-            __m128i col   = _mm_set_epi64x(input_base_y[ctx->scaled.stride >> 3], input_base_y[0]);
+         res_a += (a * coeff) >> 16;
+         res_r += (r * coeff) >> 16;
+         res_g += (g * coeff) >> 16;
+         res_b += (b * coeff) >> 16;
+      }
 
-            res = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
-         }
+      output[w] = build_argb64(res_a, res_r, res_g, res_b);
+   }
+}
 
-         for (; y < ctx->vert.filter_len; y++, input_base_y += (ctx->scaled.stride >> 3))
-         {
-            __m128i coeff = _mm_set_epi64x(0, filter_vert[y] * 0x0001000100010001ll);
-            __m128i col   = _mm_set_epi64x(0, input_base_y[0]);
+void scaler_argb8888_point_special(const struct scaler_ctx *ctx,
+      uint32_t *output, const uint32_t *input)
+{
+   int w;
+   const int *filter_pos = ctx->horiz.filter_pos;
 
-            res = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
-         }
+   for (w = 0; w < ctx->out_width; w++)
+      output[w] = input[filter_pos[w]];
+}
 
-         res       = _mm_adds_epi16(_mm_srli_si128(res, 8), res);
-         res       = _mm_srai_epi16(res, (7 - 2 - 2));
+#ifdef HAVE_SCALER_SSE2
+/* Sums up taps of one output pixel, two at a time. */
+RETRO_TARGET("sse2")
+static INLINE __m128i scaler_horiz_taps_sse2(__m128i res,
+      const uint32_t *input_base_x, const int16_t *filter_horiz,
+      int x, int len)
+{
+   for (; (x + 1) < len; x += 2)
+   {
+      /* Four copies of each of the two coefficients. */
+      __m128i coeff = _mm_unpacklo_epi64(
+            _mm_set1_epi16(filter_horiz[x + 0]),
+            _mm_set1_epi16(filter_horiz[x + 1]));
+      __m128i col   = _mm_unpacklo_epi8(
+            _mm_loadl_epi64((const __m128i*)(input_base_x + x)),
+            _mm_setzero_si128());
+
+      col = _mm_slli_epi16(col, 7);
+      res = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
+   }
 
-         final     = _mm_packus_epi16(res, res);
+   for (; x < len; x++)
+   {
+      /* The upper pixel is zero and adds nothing. */
+      __m128i coeff = _mm_set1_epi16(filter_horiz[x]);
+      __m128i col   = _mm_unpacklo_epi8(
+            _mm_cvtsi32_si128(input_base_x[x]), _mm_setzero_si128());
 
-         output[w] = _mm_cvtsi128_si32(final);
-      }
+      col = _mm_slli_epi16(col, 7);
+      res = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
    }
+
+   return _mm_adds_epi16(_mm_srli_si128(res, 8), res);
 }
-#else
-void scaler_argb8888_vert(const struct scaler_ctx *ctx, void *output_, int stride)
+
+RETRO_TARGET("sse2")
+static void scaler_argb8888_horiz_sse2(const struct scaler_ctx *ctx,
+      uint64_t *output, const uint32_t *input)
 {
-   int h, w, y;
-   const uint64_t      *input = ctx->scaled.frame;
-   uint32_t           *output = (uint32_t*)output_;
+   int w;
+   const int16_t *filter_horiz = ctx->horiz.filter;
 
-   const int16_t *filter_vert = ctx->vert.filter;
+   for (w = 0; w < ctx->out_width; w++, filter_horiz += ctx->horiz.filter_stride)
+   {
+      __m128i res = scaler_horiz_taps_sse2(_mm_setzero_si128(),
+            input + ctx->horiz.filter_pos[w], filter_horiz,
+            0, ctx->horiz.filter_len);
+
+      _mm_storel_epi64((__m128i*)(output + w), res);
+   }
+}
 
-   for (h = 0; h < ctx->out_height; h++, filter_vert += ctx->vert.filter_stride, output += stride >> 2)
+RETRO_TARGET("sse2")
+static void scaler_argb8888_vert_sse2(const struct scaler_ctx *ctx,
+      uint32_t *output, const uint64_t *input, const int16_t *filter)
+{
+   int w, y;
+   const int stride = ctx->scaled_stride >> 3;
+
+   /* Four pixels at a time. Scaled rows are padded to eight. */
+   for (w = 0; w < ctx->out_width; w += 4)
    {
-      const uint64_t *input_base = input + ctx->vert.filter_pos[h] * (ctx->scaled.stride >> 3);
+      __m128i final;
+      __m128i res0                 = _mm_setzero_si128();
+      __m128i res1                 = _mm_setzero_si128();
+      const uint64_t *input_base_y = input + w;
+
+      for (y = 0; y < ctx->vert.filter_len; y++, input_base_y += stride)
+      {
+         __m128i coeff = _mm_set1_epi16(filter[y]);
+         __m128i col0  = _mm_loadu_si128((const __m128i*)(input_base_y + 0));
+         __m128i col1  = _mm_loadu_si128((const __m128i*)(input_base_y + 2));
+
+         res0 = _mm_adds_epi16(_mm_mulhi_epi16(col0, coeff), res0);
+         res1 = _mm_adds_epi16(_mm_mulhi_epi16(col1, coeff), res1);
+      }
+
+      res0  = _mm_srai_epi16(res0, (7 - 2 - 2));
+      res1  = _mm_srai_epi16(res1, (7 - 2 - 2));
+      final = _mm_packus_epi16(res0, res1);
 
-      for (w = 0; w < ctx->out_width; w++)
+      if (w + 4 <= ctx->out_width)
+         _mm_storeu_si128((__m128i*)(output + w), final);
+      else
       {
-         int16_t res_a = 0;
-         int16_t res_r = 0;
-         int16_t res_g = 0;
-         int16_t res_b = 0;
-
-         const uint64_t *input_base_y = input_base + w;
-         for (y = 0; y < ctx->vert.filter_len; y++, input_base_y += (ctx->scaled.stride >> 3))
-         {
-            uint64_t col = *input_base_y;
-
-            int16_t a = (col >> 48) & 0xffff;
-            int16_t r = (col >> 32) & 0xffff;
-            int16_t g = (col >> 16) & 0xffff;
-            int16_t b = (col >>  0) & 0xffff;
-
-            int16_t coeff = filter_vert[y];
-
-            res_a += (a * coeff) >> 16;
-            res_r += (r * coeff) >> 16;
-            res_g += (g * coeff) >> 16;
-            res_b += (b * coeff) >> 16;
-         }
-
-         res_a >>= (7 - 2 - 2);
-         res_r >>= (7 - 2 - 2);
-         res_g >>= (7 - 2 - 2);
-         res_b >>= (7 - 2 - 2);
-
-         output[w] = (clamp_8bit(res_a) << 24) | (clamp_8bit(res_r) << 16) | (clamp_8bit(res_g) << 8) | (clamp_8bit(res_b) << 0);
+         int i;
+         for (i = 0; w + i < ctx->out_width; i++, final = _mm_srli_si128(final, 4))
+            output[w + i] = _mm_cvtsi128_si32(final);
       }
    }
 }
 #endif
 
-#if defined(__SSE2__)
-void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input_, int stride)
+#ifdef HAVE_SCALER_AVX2
+/* Picks four copies of each of four coefficients, two per lane,
+ * out of a broadcast 64-bit word. */
+#define SCALER_AVX2_COEFF_SHUFFLE _mm256_setr_epi8( \
+      0, 1, 0, 1, 0, 1, 0, 1, 2, 3, 2, 3, 2, 3, 2, 3, \
+      4, 5, 4, 5, 4, 5, 4, 5, 6, 7, 6, 7, 6, 7, 6, 7)
+
+RETRO_TARGET("avx2")
+static void scaler_argb8888_horiz_avx2(const struct scaler_ctx *ctx,
+      uint64_t *output, const uint32_t *input)
 {
-   int h, w, x;
-   const uint32_t *input = (const uint32_t*)input_;
-   uint64_t *output      = ctx->scaled.frame;
+   int w = 0, x;
+   const int16_t *filter_horiz = ctx->horiz.filter;
+   const int len               = ctx->horiz.filter_len;
+   const __m256i shuffle       = SCALER_AVX2_COEFF_SHUFFLE;
+
+   /* Bilinear: two output pixels of two taps each. */
+   if (len == 2 && ctx->horiz.filter_stride == 2)
+   {
+      for (; w + 1 < ctx->out_width; w += 2, filter_horiz += 4)
+      {
+         __m128i pixels = _mm_unpacklo_epi64(
+               _mm_loadl_epi64((const __m128i*)(input + ctx->horiz.filter_pos[w + 0])),
+               _mm_loadl_epi64((const __m128i*)(input + ctx->horiz.filter_pos[w + 1])));
+         __m256i coeff  = _mm256_shuffle_epi8(_mm256_broadcastq_epi64(
+                  _mm_loadl_epi64((const __m128i*)filter_horiz)), shuffle);
+         __m256i col    = _mm256_slli_epi16(_mm256_cvtepu8_epi16(pixels), 7);
+         __m256i res    = _mm256_mulhi_epi16(col, coeff);
+
+         res = _mm256_adds_epi16(_mm256_srli_si256(res, 8), res);
+
+         _mm_storel_epi64((__m128i*)(output + w + 0), _mm256_castsi256_si128(res));
+         _mm_storel_epi64((__m128i*)(output + w + 1), _mm256_extracti128_si256(res, 1));
+      }
+   }
 
-   for (h = 0; h < ctx->scaled.height; h++, input += stride >> 2, output += ctx->scaled.stride >> 3)
+   for (; w < ctx->out_width; w++, filter_horiz += ctx->horiz.filter_stride)
    {
-      const int16_t *filter_horiz = ctx->horiz.filter;
+      __m128i res;
+      __m256i res256               = _mm256_setzero_si256();
+      const uint32_t *input_base_x = input + ctx->horiz.filter_pos[w];
 
-      for (w = 0; w < ctx->scaled.width; w++, filter_horiz += ctx->horiz.filter_stride)
+      /* Four taps at a time, the rest two at a time. */
+      for (x = 0; (x + 3) < len; x += 4)
       {
-         __m128i res = _mm_setzero_si128();
-
-         const uint32_t *input_base_x = input + ctx->horiz.filter_pos[w];
-
-         for (x = 0; (x + 1) < ctx->horiz.filter_len; x += 2)
-         {
-            __m128i coeff = _mm_set_epi64x(filter_horiz[x + 1] * 0x0001000100010001ll, filter_horiz[x + 0] * 0x0001000100010001ll);
-
-            __m128i col = _mm_unpacklo_epi8(_mm_set_epi64x(0,
-                     ((uint64_t)input_base_x[x + 1] << 32) | input_base_x[x + 0]), _mm_setzero_si128());
-
-            col = _mm_slli_epi16(col, 7);
-            res = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
-         }
-
-         for (; x < ctx->horiz.filter_len; x++)
-         {
-            __m128i coeff = _mm_set_epi64x(0, filter_horiz[x] * 0x0001000100010001ll);
-            __m128i col   = _mm_unpacklo_epi8(_mm_set_epi32(0, 0, 0, input_base_x[x]), _mm_setzero_si128());
-
-            col = _mm_slli_epi16(col, 7);
-            res = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
-         }
-
-         res       = _mm_adds_epi16(_mm_srli_si128(res, 8), res);
-
-#ifdef __x86_64__
-         output[w] = _mm_cvtsi128_si64(res);
-#else /* 32-bit doesn't have si64. Do it in two steps. */
-         union
-         {
-            uint32_t *u32;
-            uint64_t *u64;
-         } u;
-         u.u64 = output + w;
-         u.u32[0] = _mm_cvtsi128_si32(res);
-         u.u32[1] = _mm_cvtsi128_si32(_mm_srli_si128(res, 4));
-#endif
+         __m256i coeff = _mm256_shuffle_epi8(_mm256_broadcastq_epi64(
+                  _mm_loadl_epi64((const __m128i*)(filter_horiz + x))), shuffle);
+         __m256i col   = _mm256_cvtepu8_epi16(
+               _mm_loadu_si128((const __m128i*)(input_base_x + x)));
+
+         col    = _mm256_slli_epi16(col, 7);
+         res256 = _mm256_adds_epi16(_mm256_mulhi_epi16(col, coeff), res256);
       }
+
+      res = _mm_adds_epi16(_mm256_castsi256_si128(res256),
+            _mm256_extracti128_si256(res256, 1));
+      res = scaler_horiz_taps_sse2(res, input_base_x, filter_horiz, x, len);
+
+      _mm_storel_epi64((__m128i*)(output + w), res);
    }
 }
-#else
-static INLINE uint64_t build_argb64(uint16_t a, uint16_t r, uint16_t g, uint16_t b)
-{
-   return ((uint64_t)a << 48) | ((uint64_t)r << 32) | ((uint64_t)g << 16) | ((uint64_t)b << 0);
-}
 
-void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input_, int stride)
+RETRO_TARGET("avx2")
+static void scaler_argb8888_vert_avx2(const struct scaler_ctx *ctx,
+      uint32_t *output, const uint64_t *input, const int16_t *filter)
 {
-   int h, w, x;
-   const uint32_t *input = (uint32_t*)input_;
-   uint64_t *output      = ctx->scaled.frame;
+   int w, y;
+   const int stride = ctx->scaled_stride >> 3;
+   const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
 
-   for (h = 0; h < ctx->scaled.height; h++, input += stride >> 2, output += ctx->scaled.stride >> 3)
+   /* Eight pixels at a time. Scaled rows are padded to eight. */
+   for (w = 0; w < ctx->out_width; w += 8)
    {
-      const int16_t *filter_horiz = ctx->horiz.filter;
+      __m256i final;
+      __m256i res0                 = _mm256_setzero_si256();
+      __m256i res1                 = _mm256_setzero_si256();
+      const uint64_t *input_base_y = input + w;
 
-      for (w = 0; w < ctx->scaled.width; w++, filter_horiz += ctx->horiz.filter_stride)
+      for (y = 0; y < ctx->vert.filter_len; y++, input_base_y += stride)
       {
-         const uint32_t *input_base_x = input + ctx->horiz.filter_pos[w];
+         __m256i coeff = _mm256_set1_epi16(filter[y]);
+         __m256i col0  = _mm256_loadu_si256((const __m256i*)(input_base_y + 0));
+         __m256i col1  = _mm256_loadu_si256((const __m256i*)(input_base_y + 4));
 
-         int16_t res_a = 0;
-         int16_t res_r = 0;
-         int16_t res_g = 0;
-         int16_t res_b = 0;
+         res0 = _mm256_adds_epi16(_mm256_mulhi_epi16(col0, coeff), res0);
+         res1 = _mm256_adds_epi16(_mm256_mulhi_epi16(col1, coeff), res1);
+      }
 
-         for (x = 0; x < ctx->horiz.filter_len; x++)
-         {
-            uint32_t col = input_base_x[x];
+      res0  = _mm256_srai_epi16(res0, (7 - 2 - 2));
+      res1  = _mm256_srai_epi16(res1, (7 - 2 - 2));
 
-            int16_t a = (col >> (24 - 7)) & (0xff << 7);
-            int16_t r = (col >> (16 - 7)) & (0xff << 7);
-            int16_t g = (col >> ( 8 - 7)) & (0xff << 7);
-            int16_t b = (col << ( 0 + 7)) & (0xff << 7);
+      /* Packing works per lane, put the pixels back in order. */
+      final = _mm256_permute4x64_epi64(_mm256_packus_epi16(res0, res1),
+            _MM_SHUFFLE(3, 1, 2, 0));
 
-            int16_t coeff = filter_horiz[x];
+      if (w + 8 <= ctx->out_width)
+         _mm256_storeu_si256((__m256i*)(output + w), final);
+      else
+         _mm256_maskstore_epi32((int*)(output + w), _mm256_cmpgt_epi32(
+                  _mm256_set1_epi32(ctx->out_width - w), lanes), final);
+   }
+}
+#endif
 
-            res_a += (a * coeff) >> 16;
-            res_r += (r * coeff) >> 16;
-            res_g += (g * coeff) >> 16;
-            res_b += (b * coeff) >> 16;
-         }
+#ifdef HAVE_SCALER_NEON
+/* [(a * b) >> 16] like _mm_mulhi_epi16. */
+static INLINE int16x8_t scaler_mulhi_neon(int16x8_t a, int16x8_t b)
+{
+   int32x4_t lo = vmull_s16(vget_low_s16(a), vget_low_s16(b));
+   int32x4_t hi = vmull_s16(vget_high_s16(a), vget_high_s16(b));
+   return vcombine_s16(vshrn_n_s32(lo, 16), vshrn_n_s32(hi, 16));
+}
 
-         output[w] = build_argb64(res_a, res_r, res_g, res_b);
+/* Two pixels expanded to 15 bits per channel. */
+static INLINE int16x8_t scaler_expand_neon(uint8x8_t pixels)
+{
+   return vreinterpretq_s16_u16(vshlq_n_u16(vmovl_u8(pixels), 7));
+}
+
+static void scaler_argb8888_horiz_neon(const struct scaler_ctx *ctx,
+      uint64_t *output, const uint32_t *input)
+{
+   int w, x;
+   const int16_t *filter_horiz = ctx->horiz.filter;
+   const int len               = ctx->horiz.filter_len;
+
+   for (w = 0; w < ctx->out_width; w++, filter_horiz += ctx->horiz.filter_stride)
+   {
+      int16x4_t final;
+      int16x8_t res                = vdupq_n_s16(0);
+      const uint8_t *input_base_x  = (const uint8_t*)(input + ctx->horiz.filter_pos[w]);
+
+      for (x = 0; (x + 3) < len; x += 4)
+      {
+         uint8x16_t pixels = vld1q_u8(input_base_x + x * 4);
+         int16x8_t coeff0  = vcombine_s16(vdup_n_s16(filter_horiz[x + 0]), vdup_n_s16(filter_horiz[x + 1]));
+         int16x8_t coeff1  = vcombine_s16(vdup_n_s16(filter_horiz[x + 2]), vdup_n_s16(filter_horiz[x + 3]));
+
+         res = vqaddq_s16(scaler_mulhi_neon(scaler_expand_neon(vget_low_u8(pixels)), coeff0), res);
+         res = vqaddq_s16(scaler_mulhi_neon(scaler_expand_neon(vget_high_u8(pixels)), coeff1), res);
+      }
+
+      for (; (x + 1) < len; x += 2)
+      {
+         int16x8_t coeff = vcombine_s16(vdup_n_s16(filter_horiz[x + 0]), vdup_n_s16(filter_horiz[x + 1]));
+         res = vqaddq_s16(scaler_mulhi_neon(scaler_expand_neon(vld1_u8(input_base_x + x * 4)), coeff), res);
       }
+
+      for (; x < len; x++)
+      {
+         /* Both halves hold the same pixel, only one gets a weight. */
+         int16x8_t coeff = vcombine_s16(vdup_n_s16(filter_horiz[x]), vdup_n_s16(0));
+         uint8x8_t pixel = vreinterpret_u8_u32(vdup_n_u32(((const uint32_t*)input_base_x)[x]));
+         res = vqaddq_s16(scaler_mulhi_neon(scaler_expand_neon(pixel), coeff), res);
+      }
+
+      final = vqadd_s16(vget_low_s16(res), vget_high_s16(res));
+      vst1_s16((int16_t*)(output + w), final);
    }
 }
-#endif
 
-void scaler_argb8888_point_special(const struct scaler_ctx *ctx,
-      void *output_, const void *input_,
-      int out_width, int out_height,
-      int in_width, int in_height,
-      int out_stride, int in_stride)
+static void scaler_argb8888_vert_neon(const struct scaler_ctx *ctx,
+      uint32_t *output, const uint64_t *input, const int16_t *filter)
 {
-   int h, w;
-   const uint32_t *input = NULL;
-   uint32_t *output      = NULL;
-   int x_pos  = (1 << 15) * in_width / out_width - (1 << 15);
-   int x_step = (1 << 16) * in_width / out_width;
-   int y_pos  = (1 << 15) * in_height / out_height - (1 << 15);
-   int y_step = (1 << 16) * in_height / out_height;
+   int w, y;
+   const int stride = ctx->scaled_stride >> 3;
 
-   (void)ctx;
+   /* Four pixels at a time. Scaled rows are padded to eight. */
+   for (w = 0; w < ctx->out_width; w += 4)
+   {
+      uint8x16_t final;
+      int16x8_t res0               = vdupq_n_s16(0);
+      int16x8_t res1               = vdupq_n_s16(0);
+      const uint64_t *input_base_y = input + w;
 
-   if (x_pos < 0)
-      x_pos = 0;
-   if (y_pos < 0)
-      y_pos = 0;
+      for (y = 0; y < ctx->vert.filter_len; y++, input_base_y += stride)
+      {
+         int16x8_t coeff = vdupq_n_s16(filter[y]);
+         int16x8_t col0  = vld1q_s16((const int16_t*)(input_base_y + 0));
+         int16x8_t col1  = vld1q_s16((const int16_t*)(input_base_y + 2));
 
-   input = (const uint32_t*)input_;
-   output = (uint32_t*)output_;
+         res0 = vqaddq_s16(scaler_mulhi_neon(col0, coeff), res0);
+         res1 = vqaddq_s16(scaler_mulhi_neon(col1, coeff), res1);
+      }
 
-   for (h = 0; h < out_height; h++, y_pos += y_step, output += out_stride >> 2)
-   {
-      int x = x_pos;
-      const uint32_t *inp = input + (y_pos >> 16) * (in_stride >> 2);
+      final = vcombine_u8(vqshrun_n_s16(res0, (7 - 2 - 2)),
+            vqshrun_n_s16(res1, (7 - 2 - 2)));
+
+      if (w + 4 <= ctx->out_width)
+         vst1q_u8((uint8_t*)(output + w), final);
+      else
+      {
+         int i;
+         uint32_t pixels[4];
 
-      for (w = 0; w < out_width; w++, x += x_step)
-         output[w] = inp[x >> 16];
+         vst1q_u8((uint8_t*)pixels, final);
+         for (i = 0; w + i < ctx->out_width; i++)
+            output[w + i] = pixels[i];
+      }
    }
 }
+#endif
 
+void scaler_select_kernels(struct scaler_ctx *ctx, uint64_t simd)
+{
+   ctx->scaler_horiz = scaler_argb8888_horiz;
+   ctx->scaler_vert  = scaler_argb8888_vert;
+
+#ifdef HAVE_SCALER_SSE2
+   if (simd & RETRO_SIMD_SSE2)
+   {
+      ctx->scaler_horiz = scaler_argb8888_horiz_sse2;
+      ctx->scaler_vert  = scaler_argb8888_vert_sse2;
+   }
+#endif
+#ifdef HAVE_SCALER_AVX2
+   if (simd & RETRO_SIMD_AVX2)
+   {
+      ctx->scaler_horiz = scaler_argb8888_horiz_avx2;
+      ctx->scaler_vert  = scaler_argb8888_vert_avx2;
+   }
+#endif
+#ifdef HAVE_SCALER_NEON
+   if (simd & RETRO_SIMD_NEON)
+   {
+      ctx->scaler_horiz = scaler_argb8888_horiz_neon;
+      ctx->scaler_vert  = scaler_argb8888_vert_neon;
+   }
+#endif
+
+   (void)simd;
+}
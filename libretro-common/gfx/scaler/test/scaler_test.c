@@ -0,0 +1,442 @@
+/* Copyright  (C) 2010-2016 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (scaler_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Checks every set of kernels the CPU supports, on one thread and
+ * on a pool, against whole-frame passes done the simple way. Then
+ * times the sizes used for recording and screenshots.
+ *
+ * Usage: scaler_test [threads] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <clamping.h>
+#include <features/features_cpu.h>
+#include <gfx/scaler/pixconv.h>
+#include <gfx/scaler/scaler.h>
+#include <gfx/scaler/scaler_int.h>
+#include <retro_miscellaneous.h>
+#include <retro_test.h>
+#include <rthreads/rthread_pool.h>
+
+#define BENCH_RUNS 8
+
+struct kernel_impl
+{
+   const char *ident;
+   uint64_t simd;
+};
+
+static const struct kernel_impl impls[] = {
+   { "c",    0 },
+   { "sse2", RETRO_SIMD_SSE2 },
+   { "avx2", RETRO_SIMD_SSE2 | RETRO_SIMD_AVX2 },
+   { "neon", RETRO_SIMD_NEON },
+};
+
+struct format_info
+{
+   const char *ident;
+   enum scaler_pix_fmt fmt;
+   unsigned bpp;
+};
+
+static const struct format_info in_formats[] = {
+   { "ARGB8888", SCALER_FMT_ARGB8888, 4 },
+   { "RGB565",   SCALER_FMT_RGB565,   2 },
+   { "0RGB1555", SCALER_FMT_0RGB1555, 2 },
+   { "BGR24",    SCALER_FMT_BGR24,    3 },
+   { "RGBA4444", SCALER_FMT_RGBA4444, 2 },
+};
+
+static const struct format_info out_formats[] = {
+   { "ARGB8888", SCALER_FMT_ARGB8888, 4 },
+   { "0RGB1555", SCALER_FMT_0RGB1555, 2 },
+   { "BGR24",    SCALER_FMT_BGR24,    3 },
+   { "RGBA4444", SCALER_FMT_RGBA4444, 2 },
+};
+
+static const enum scaler_type types[] = {
+   SCALER_TYPE_POINT,
+   SCALER_TYPE_BILINEAR,
+   SCALER_TYPE_SINC,
+};
+
+static const char *type_names[] = { "", "point", "bilinear", "sinc" };
+
+/* Odd sizes, up and down, and one that only converts. */
+static const int test_sizes[][4] = {
+   {  37,  29,   83,  61 },
+   {  83,  61,   37,  29 },
+   { 256, 224,  613, 541 },
+   { 640, 480,  319, 237 },
+   {  64,  48,   64,  48 },
+};
+
+static const int bench_sizes[][4] = {
+   {  256,  224, 1920, 1080 },
+   { 1920, 1080, 1280,  720 },
+};
+
+static uint32_t rand_state = 1;
+
+static uint32_t test_rand(void)
+{
+   rand_state = rand_state * 1103515245 + 12345;
+   return rand_state >> 8;
+}
+
+/* Smooth gradients with some noise and hard edges. */
+static void gen_frame(uint8_t *frame, int width, int height, int stride,
+      unsigned bpp)
+{
+   int x, y;
+   unsigned i;
+
+   for (y = 0; y < height; y++)
+   {
+      for (x = 0; x < width; x++)
+      {
+         uint32_t col = ((x * 255 / width) << 16) | ((y * 255 / height) << 8)
+            | (((x / 8 + y / 8) & 1) ? 0xff : 0x00) | 0xff000000u;
+
+         if ((test_rand() & 7) == 0)
+            col = test_rand() | 0xff000000u;
+
+         for (i = 0; i < bpp; i++)
+            frame[y * stride + x * bpp + i] = col >> (8 * i);
+      }
+   }
+}
+
+/* Filter passes over whole frames, the way the scaler used to run. */
+static void reference_scale(const struct scaler_ctx *ctx,
+      uint8_t *output, const uint8_t *input)
+{
+   int x, y, i;
+   const uint32_t *in = (const uint32_t*)input;
+   int in_stride      = ctx->in_stride >> 2;
+   uint32_t *conv_in  = NULL;
+   uint32_t *conv_out = (uint32_t*)calloc(ctx->out_width * ctx->out_height,
+         sizeof(uint32_t));
+   uint64_t *scaled   = (uint64_t*)calloc(ctx->out_width * ctx->in_height,
+         sizeof(uint64_t));
+
+   if (ctx->unscaled)
+   {
+      ctx->direct_pixconv(output, input, ctx->out_width, ctx->out_height,
+            ctx->out_stride, ctx->in_stride);
+      goto end;
+   }
+
+   if (ctx->in_fmt != SCALER_FMT_ARGB8888)
+   {
+      conv_in   = (uint32_t*)calloc(ctx->in_width * ctx->in_height,
+            sizeof(uint32_t));
+      ctx->in_pixconv(conv_in, input, ctx->in_width, ctx->in_height,
+            ctx->in_width * 4, ctx->in_stride);
+      in        = conv_in;
+      in_stride = ctx->in_width;
+   }
+
+   if (ctx->scaler_type == SCALER_TYPE_POINT)
+   {
+      /* What the whole-frame point scaler computed. */
+      int x_pos  = (1 << 15) * ctx->in_width / ctx->out_width - (1 << 15);
+      int x_step = (1 << 16) * ctx->in_width / ctx->out_width;
+      int y_pos  = (1 << 15) * ctx->in_height / ctx->out_height - (1 << 15);
+      int y_step = (1 << 16) * ctx->in_height / ctx->out_height;
+
+      if (x_pos < 0)
+         x_pos = 0;
+      if (y_pos < 0)
+         y_pos = 0;
+
+      for (y = 0; y < ctx->out_height; y++, y_pos += y_step)
+      {
+         int pos = x_pos;
+         for (x = 0; x < ctx->out_width; x++, pos += x_step)
+            conv_out[y * ctx->out_width + x] =
+               in[(y_pos >> 16) * in_stride + (pos >> 16)];
+      }
+   }
+   else
+   {
+      for (y = 0; y < ctx->in_height; y++)
+      {
+         for (x = 0; x < ctx->out_width; x++)
+         {
+            int16_t res[4] = {0};
+            const int16_t *filter = ctx->horiz.filter
+               + x * ctx->horiz.filter_stride;
+            const uint32_t *base  = in + y * in_stride
+               + ctx->horiz.filter_pos[x];
+
+            for (i = 0; i < ctx->horiz.filter_len; i++)
+            {
+               unsigned c;
+               for (c = 0; c < 4; c++)
+                  res[c] += ((int16_t)(((base[i] >> (8 * c)) & 0xff) << 7)
+                        * filter[i]) >> 16;
+            }
+
+            scaled[y * ctx->out_width + x] = (uint64_t)(uint16_t)res[0]
+               | ((uint64_t)(uint16_t)res[1] << 16)
+               | ((uint64_t)(uint16_t)res[2] << 32)
+               | ((uint64_t)(uint16_t)res[3] << 48);
+         }
+      }
+
+      for (y = 0; y < ctx->out_height; y++)
+      {
+         const int16_t *filter = ctx->vert.filter
+            + y * ctx->vert.filter_stride;
+
+         for (x = 0; x < ctx->out_width; x++)
+         {
+            unsigned c;
+            int16_t res[4] = {0};
+            uint32_t col   = 0;
+
+            for (i = 0; i < ctx->vert.filter_len; i++)
+            {
+               uint64_t s = scaled[(ctx->vert.filter_pos[y] + i)
+                  * ctx->out_width + x];
+               for (c = 0; c < 4; c++)
+                  res[c] += ((int16_t)(s >> (16 * c)) * filter[i]) >> 16;
+            }
+
+            for (c = 0; c < 4; c++)
+               col |= (uint32_t)clamp_8bit(res[c] >> 3) << (8 * c);
+            conv_out[y * ctx->out_width + x] = col;
+         }
+      }
+   }
+
+   if (ctx->out_fmt == SCALER_FMT_ARGB8888)
+   {
+      for (y = 0; y < ctx->out_height; y++)
+         memcpy(output + y * ctx->out_stride, conv_out + y * ctx->out_width,
+               ctx->out_width * 4);
+   }
+   else
+      ctx->out_pixconv(output, conv_out, ctx->out_width, ctx->out_height,
+            ctx->out_stride, ctx->out_width * 4);
+
+end:
+   free(conv_in);
+   free(conv_out);
+   free(scaled);
+}
+
+static bool setup(struct scaler_ctx *ctx, const int *size,
+      const struct format_info *in, const struct format_info *out,
+      enum scaler_type type, rthread_pool_t *pool)
+{
+   memset(ctx, 0, sizeof(*ctx));
+   ctx->in_width    = size[0];
+   ctx->in_height   = size[1];
+   ctx->out_width   = size[2];
+   ctx->out_height  = size[3];
+   ctx->in_stride   = size[0] * in->bpp;
+   ctx->out_stride  = size[2] * out->bpp;
+   ctx->in_fmt      = in->fmt;
+   ctx->out_fmt     = out->fmt;
+   ctx->scaler_type = type;
+   ctx->pool        = pool;
+   return scaler_ctx_gen_filter(ctx);
+}
+
+static void test_conformance(const struct kernel_impl *impl,
+      rthread_pool_t *pool)
+{
+   unsigned s, t, i, o, p;
+   unsigned checked = 0;
+
+   for (s = 0; s < ARRAY_SIZE(test_sizes); s++)
+   for (t = 0; t < ARRAY_SIZE(types); t++)
+   for (i = 0; i < ARRAY_SIZE(in_formats); i++)
+   for (o = 0; o < ARRAY_SIZE(out_formats); o++)
+   {
+      const int *size = test_sizes[s];
+      size_t in_size  = size[0] * size[1] * in_formats[i].bpp;
+      size_t out_size = size[2] * size[3] * out_formats[o].bpp;
+      uint8_t *input  = (uint8_t*)malloc(in_size);
+      uint8_t *ref    = (uint8_t*)calloc(1, out_size);
+      uint8_t *output = (uint8_t*)calloc(1, out_size);
+
+      gen_frame(input, size[0], size[1], size[0] * in_formats[i].bpp,
+            in_formats[i].bpp);
+
+      for (p = 0; p < 2; p++)
+      {
+         bool same;
+         struct scaler_ctx ctx;
+
+         if (!setup(&ctx, size, &in_formats[i], &out_formats[o],
+                  types[t], p ? pool : NULL))
+         {
+            /* Conversions the scaler doesn't do. */
+            scaler_ctx_gen_reset(&ctx);
+            break;
+         }
+
+         scaler_select_kernels(&ctx, impl->simd);
+
+         if (!p)
+            reference_scale(&ctx, ref, input);
+
+         memset(output, 0, out_size);
+         scaler_ctx_scale(&ctx, output, input);
+         /* Again, in case anything was left over from the last frame. */
+         scaler_ctx_scale(&ctx, output, input);
+
+         same = !memcmp(output, ref, out_size);
+         CHECK(same, "%s: %s %dx%d %s -> %dx%d %s%s",
+               impl->ident, type_names[types[t]],
+               size[0], size[1], in_formats[i].ident,
+               size[2], size[3], out_formats[o].ident,
+               p ? " on a pool" : "");
+         if (same)
+            checked++;
+
+         scaler_ctx_gen_reset(&ctx);
+      }
+
+      free(input);
+      free(ref);
+      free(output);
+   }
+
+   printf("%-4s: %u scales match\n", impl->ident, checked);
+}
+
+static double bench_scale(const struct scaler_ctx *proto, uint64_t simd,
+      rthread_pool_t *pool, uint8_t *output, const uint8_t *input)
+{
+   unsigned i;
+   retro_time_t start;
+   struct scaler_ctx ctx = *proto;
+
+   ctx.pool = pool;
+
+   if (!scaler_ctx_gen_filter(&ctx))
+      return -1.0;
+   scaler_select_kernels(&ctx, simd);
+
+   scaler_ctx_scale(&ctx, output, input);
+
+   start = cpu_features_get_time_usec();
+   for (i = 0; i < BENCH_RUNS; i++)
+      scaler_ctx_scale(&ctx, output, input);
+   start = cpu_features_get_time_usec() - start;
+
+   scaler_ctx_gen_reset(&ctx);
+   return (double)start / BENCH_RUNS / 1000.0;
+}
+
+static void bench(uint64_t cpu, rthread_pool_t *pool)
+{
+   unsigned s, i, t, k;
+
+   printf("\nms per frame, to ARGB8888:\n%-36s", "");
+   for (k = 0; k < ARRAY_SIZE(impls); k++)
+      if ((impls[k].simd & cpu) == impls[k].simd)
+         printf(" %8s", impls[k].ident);
+   printf(" %5u thr\n", rthread_pool_threads(pool));
+
+   for (s = 0; s < ARRAY_SIZE(bench_sizes); s++)
+   for (i = 0; i < ARRAY_SIZE(in_formats); i++)
+   {
+      const int *size = bench_sizes[s];
+      uint8_t *input  = (uint8_t*)malloc(size[0] * size[1] * in_formats[i].bpp);
+      uint8_t *output = (uint8_t*)malloc(size[2] * size[3] * 4);
+
+      gen_frame(input, size[0], size[1], size[0] * in_formats[i].bpp,
+            in_formats[i].bpp);
+
+      for (t = 0; t < ARRAY_SIZE(types); t++)
+      {
+         char name[64];
+         struct scaler_ctx proto;
+         uint64_t best = 0;
+
+         memset(&proto, 0, sizeof(proto));
+         proto.in_width    = size[0];
+         proto.in_height   = size[1];
+         proto.out_width   = size[2];
+         proto.out_height  = size[3];
+         proto.in_stride   = size[0] * in_formats[i].bpp;
+         proto.out_stride  = size[2] * 4;
+         proto.in_fmt      = in_formats[i].fmt;
+         proto.out_fmt     = SCALER_FMT_ARGB8888;
+         proto.scaler_type = types[t];
+
+         snprintf(name, sizeof(name), "%dx%d>%dx%d %s %s", size[0], size[1],
+               size[2], size[3], in_formats[i].ident, type_names[types[t]]);
+         printf("%-36s", name);
+
+         for (k = 0; k < ARRAY_SIZE(impls); k++)
+         {
+            if ((impls[k].simd & cpu) != impls[k].simd)
+               continue;
+            printf(" %8.2f", bench_scale(&proto, impls[k].simd, NULL,
+                     output, input));
+            best = impls[k].simd;
+         }
+
+         printf(" %9.2f\n", bench_scale(&proto, best, pool, output, input));
+      }
+
+      free(input);
+      free(output);
+   }
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned k;
+   uint64_t cpu          = cpu_features_get();
+   unsigned threads      = argc > 1 ? strtoul(argv[1], NULL, 0)
+      : cpu_features_get_core_amount();
+   rthread_pool_t *pool;
+
+   if (threads < 2)
+      threads = 2;
+   pool = rthread_pool_new(threads);
+
+   pixconv_init(cpu);
+
+   for (k = 0; k < ARRAY_SIZE(impls); k++)
+   {
+      if ((impls[k].simd & cpu) != impls[k].simd)
+         continue;
+      test_conformance(&impls[k], pool);
+   }
+
+   bench(cpu, pool);
+
+   rthread_pool_free(pool);
+
+   return test_result();
+}
@@ -31,10 +31,59 @@
 
 RETRO_BEGIN_DECLS
 
+/**
+ * mismatch_init:
+ * @simd                 : mask of RETRO_SIMD_* flags.
+ *
+ * Picks the find_change/find_same implementations for the
+ * given CPU features, usually from cpu_features_get(). Until
+ * then, the plain C versions are used.
+ *
+ * The choice is global and not synchronized. Call this once at
+ * startup, before any thread that might search is started.
+ **/
+void mismatch_init(uint64_t simd);
+
+/**
+ * find_change:
+ * @a                    : first buffer.
+ * @b                    : second buffer.
+ *
+ * There is no length argument. The buffers must differ somewhere,
+ * and both must stay readable for 64 bytes past that point.
+ *
+ * Returns: index of the first uint16_t where @a and @b differ.
+ **/
 size_t find_change(const uint16_t *a, const uint16_t *b);
 
+/**
+ * find_same:
+ * @a                    : first buffer.
+ * @b                    : second buffer.
+ *
+ * Looks for the first aligned pair of uint16_t (relative to @a)
+ * that is the same in both buffers, including a matching uint16_t
+ * right in front of it. Same buffer requirements as find_change().
+ *
+ * Returns: index of the first uint16_t of the matching run.
+ **/
 size_t find_same(const uint16_t *a, const uint16_t *b);
 
+/**
+ * find_same_limit:
+ * @a                    : first buffer.
+ * @b                    : second buffer.
+ * @limit                : index to give up at.
+ *
+ * Like find_same(), but stops looking once it is past @limit, so
+ * that a long run of changes doesn't get scanned to its end. Only
+ * needs both buffers readable for 64 bytes past @limit, they don't
+ * have to be the same anywhere.
+ *
+ * Returns: the smaller of find_same() and @limit.
+ **/
+size_t find_same_limit(const uint16_t *a, const uint16_t *b, size_t limit);
+
 RETRO_END_DECLS
 
 #endif
@@ -0,0 +1,56 @@
+/* Copyright  (C) 2010-2016 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (features_target.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LIBRETRO_SDK_FEATURES_TARGET_H
+#define _LIBRETRO_SDK_FEATURES_TARGET_H
+
+/* Per-function instruction set targets for runtime dispatch.
+ *
+ * With GCC 4.9+ and Clang on x86, RETRO_HAVE_TARGET_X86 is defined
+ * and RETRO_TARGET("avx2") etc. builds a single function for that
+ * instruction set regardless of the -m flags the file is compiled
+ * with. Such a function may only be called after cpu_features_get()
+ * has reported the matching RETRO_SIMD_* bits.
+ *
+ * RETRO_HAVE_TARGET_AVX512 is defined on top of that when the
+ * compiler also knows the AVX-512 intrinsics.
+ *
+ * Elsewhere RETRO_TARGET() expands to nothing, and only the
+ * instruction sets enabled by the -m flags can be used. */
+
+#if defined(__x86_64__) || defined(__i386__) || defined(__i486__) || defined(__i686__)
+#if defined(__clang__) || \
+      (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#define RETRO_HAVE_TARGET_X86
+#if defined(__clang__) || __GNUC__ >= 5
+#define RETRO_HAVE_TARGET_AVX512
+#endif
+#endif
+#endif
+
+#ifdef RETRO_HAVE_TARGET_X86
+#define RETRO_TARGET(x) __attribute__((target(x)))
+#else
+#define RETRO_TARGET(x)
+#endif
+
+#endif
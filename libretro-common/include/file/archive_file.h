@@ -63,6 +63,17 @@ struct file_archive_file_backend
    void     (*stream_compress_free)(void *);
    int      (*stream_compress_data_to_file)(void *);
    uint32_t (*stream_crc_calculate)(uint32_t, const uint8_t *, size_t);
+   /* CRC of two consecutive buffers, from the CRCs of each
+    * and the length of the second one. */
+   uint32_t (*stream_crc_combine)(uint32_t, uint32_t, size_t);
+   /* Raw deflate of one block of a stream compressed in pieces,
+    * primed with the data before the block. Blocks other than the
+    * last end on a byte boundary, so that they can be joined. */
+   void     (*stream_compress_block_init)(void *, int,
+         const uint8_t *, uint32_t);
+   int      (*stream_compress_block)(void *, bool);
+   uint32_t (*stream_adler32_calculate)(uint32_t, const uint8_t *, size_t);
+   uint32_t (*stream_adler32_combine)(uint32_t, uint32_t, size_t);
    const char *ident;
 };
 
@@ -29,6 +29,7 @@
 #include <retro_common_api.h>
 
 #include <boolean.h>
+#include <rthreads/rthread_pool.h>
 
 RETRO_BEGIN_DECLS
 
@@ -56,6 +57,25 @@ bool rpng_save_image_argb(const char *path, const uint32_t *data,
 bool rpng_save_image_bgr24(const char *path, const uint8_t *data,
       unsigned width, unsigned height, unsigned pitch);
 
+/**
+ * rpng_save_image_argb_ext:
+ * @level                : deflate level, 0 to 9.
+ * @pool                 : thread pool, may be NULL.
+ *
+ * Like rpng_save_image_argb(), which compresses at level 9 on the
+ * calling thread. With a pool of more than one thread, blocks of
+ * rows are filtered and deflated concurrently, at the cost of a
+ * slightly larger file. @pool is busy until the image is written,
+ * so don't pass one that other threads need to stay responsive.
+ **/
+bool rpng_save_image_argb_ext(const char *path, const uint32_t *data,
+      unsigned width, unsigned height, unsigned pitch,
+      int level, rthread_pool_t *pool);
+
+bool rpng_save_image_bgr24_ext(const char *path, const uint8_t *data,
+      unsigned width, unsigned height, unsigned pitch,
+      int level, rthread_pool_t *pool);
+
 RETRO_END_DECLS
 
 #endif
@@ -23,8 +23,21 @@
 #ifndef __LIBRETRO_SDK_SCALER_PIXCONV_H__
 #define __LIBRETRO_SDK_SCALER_PIXCONV_H__
 
+#include <stdint.h>
+
 #include <clamping.h>
 
+/**
+ * pixconv_init:
+ * @simd                 : mask of RETRO_SIMD_* flags.
+ *
+ * Picks the vector kernels behind the conv_* functions for the
+ * given CPU features. Until it is called, they use plain C.
+ * The choice is global and not synchronized. Call this once at
+ * startup, before any thread that might convert is started.
+ **/
+void pixconv_init(uint64_t simd);
+
 void conv_0rgb1555_argb8888(void *output, const void *input,
       int width, int height,
       int out_stride, int in_stride);
@@ -73,6 +86,10 @@ void conv_argb8888_abgr8888(void *output, const void *input,
       int width, int height,
       int out_stride, int in_stride);
 
+void conv_abgr8888_bgr24(void *output, const void *input,
+      int width, int height,
+      int out_stride, int in_stride);
+
 void conv_0rgb1555_bgr24(void *output, const void *input,
       int width, int height,
       int out_stride, int in_stride);
@@ -34,6 +34,9 @@ RETRO_BEGIN_DECLS
 
 #define FILTER_UNITY (1 << 14)
 
+struct rthread_pool;
+struct scaler_scratch;
+
 enum scaler_pix_fmt
 {
    SCALER_FMT_ARGB8888 = 0,
@@ -75,12 +78,13 @@ struct scaler_ctx
    enum scaler_pix_fmt out_fmt;
    enum scaler_type scaler_type;
 
+   /* Filter one row at a time, see scaler_int.h. */
    void (*scaler_horiz)(const struct scaler_ctx*,
-         const void*, int);
+         uint64_t*, const uint32_t*);
    void (*scaler_vert)(const struct scaler_ctx*,
-         void*, int);
+         uint32_t*, const uint64_t*, const int16_t*);
    void (*scaler_special)(const struct scaler_ctx*,
-         void*, const void*, int, int, int, int, int, int);
+         uint32_t*, const uint32_t*);
 
    void (*in_pixconv)(void*, const void*, int, int, int, int);
    void (*out_pixconv)(void*, const void*, int, int, int, int);
@@ -89,25 +93,18 @@ struct scaler_ctx
    bool unscaled;
    struct scaler_filter horiz, vert;
 
-   struct
-   {
-      uint32_t *frame;
-      int stride;
-   } input;
-
-   struct
-   {
-      uint64_t *frame;
-      int width;
-      int height;
-      int stride;
-   } scaled;
-
-   struct
-   {
-      uint32_t *frame;
-      int stride;
-   } output;
+   /* Horizontally scaled rows, 16 bits per channel. Each thread
+    * keeps up to scaled_rows of them in its scratch space. */
+   int scaled_stride;
+   int scaled_rows;
+
+   struct scaler_scratch *scratch;
+   unsigned scratch_threads;
+
+   /* If set before scaler_ctx_gen_filter(), scaler_ctx_scale()
+    * splits the frame into strips of rows and runs them on this
+    * pool (HAVE_THREADS only). */
+   struct rthread_pool *pool;
 };
 
 bool scaler_ctx_gen_filter(struct scaler_ctx *ctx);
@@ -25,17 +25,54 @@
 
 #include <gfx/scaler/scaler.h>
 
-void scaler_argb8888_vert(const struct scaler_ctx *ctx,
-      void *output, int stride);
+/* Kernels work on ARGB8888 rows. These are the plain C versions,
+ * scaler_select_kernels() binds the SIMD ones. */
 
+/**
+ * scaler_argb8888_horiz:
+ * @ctx          : pointer to scaler context object.
+ * @output       : out_width scaled pixels.
+ * @input        : input row.
+ *
+ * Applies the horizontal filter to one row.
+ **/
 void scaler_argb8888_horiz(const struct scaler_ctx *ctx,
-      const void *input, int stride);
+      uint64_t *output, const uint32_t *input);
+
+/**
+ * scaler_argb8888_vert:
+ * @ctx          : pointer to scaler context object.
+ * @output       : out_width output pixels.
+ * @input        : first of the horizontally scaled rows to filter,
+ *                 scaled_stride bytes apart.
+ * @filter       : vertical filter of the output row.
+ *
+ * Applies the vertical filter to make one output row.
+ **/
+void scaler_argb8888_vert(const struct scaler_ctx *ctx,
+      uint32_t *output, const uint64_t *input, const int16_t *filter);
 
+/**
+ * scaler_argb8888_point_special:
+ * @ctx          : pointer to scaler context object.
+ * @output       : out_width output pixels.
+ * @input        : input row.
+ *
+ * Picks the pixels of one output row from its input row.
+ **/
 void scaler_argb8888_point_special(const struct scaler_ctx *ctx,
-      void *output, const void *input,
-      int out_width, int out_height,
-      int in_width, int in_height,
-      int out_stride, int in_stride);
+      uint32_t *output, const uint32_t *input);
+
+/**
+ * scaler_select_kernels:
+ * @ctx          : pointer to scaler context object.
+ * @simd         : mask of RETRO_SIMD_* flags.
+ *
+ * Binds the fastest filter kernels for the given CPU features.
+ * scaler_ctx_gen_filter() does this with cpu_features_get(),
+ * calling it afterwards forces another set of kernels.
+ **/
+void scaler_select_kernels(struct scaler_ctx *ctx, uint64_t simd);
 
 #endif
 
@@ -0,0 +1,121 @@
+/* Copyright  (C) 2010-2016 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (spsc_fifo.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef __LIBRETRO_SDK_SPSC_FIFO_H
+#define __LIBRETRO_SDK_SPSC_FIFO_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <retro_common_api.h>
+
+RETRO_BEGIN_DECLS
+
+/* A ring buffer for exactly one producer and one consumer thread,
+ * which don't need to lock around it.
+ *
+ * The producer only calls the write functions, the consumer only the
+ * read functions. Each side sees a consistent, if possibly outdated,
+ * count of the other side's data. Data written with
+ * spsc_fifo_write_at() or through a write span only becomes visible
+ * to the consumer with spsc_fifo_write_commit(), and space read with
+ * spsc_fifo_read_at() or through a read span is only handed back to
+ * the producer with spsc_fifo_read_commit(). */
+typedef struct spsc_fifo spsc_fifo_t;
+
+/**
+ * spsc_fifo_new:
+ * @size               : capacity in bytes, at most UINT_MAX / 2.
+ *
+ * The capacity is used as given, so a buffer sized for a whole
+ * number of records holds exactly that many of them.
+ *
+ * Returns: new ring buffer, or NULL on failure.
+ **/
+spsc_fifo_t *spsc_fifo_new(size_t size);
+
+void spsc_fifo_free(spsc_fifo_t *fifo);
+
+/**
+ * spsc_fifo_clear:
+ * @fifo               : ring buffer.
+ *
+ * Discards all committed data. Must be called by the consumer, or
+ * while the consumer is known not to touch the buffer.
+ **/
+void spsc_fifo_clear(spsc_fifo_t *fifo);
+
+size_t spsc_fifo_read_avail(spsc_fifo_t *fifo);
+
+size_t spsc_fifo_write_avail(spsc_fifo_t *fifo);
+
+/* Copies @size bytes in and commits them. */
+void spsc_fifo_write(spsc_fifo_t *fifo, const void *in_buf, size_t size);
+
+/* Copies @size bytes out and commits the space. */
+void spsc_fifo_read(spsc_fifo_t *fifo, void *out_buf, size_t size);
+
+/* Copies @size bytes to @offset bytes past the write position,
+ * without committing them. */
+void spsc_fifo_write_at(spsc_fifo_t *fifo, size_t offset,
+      const void *in_buf, size_t size);
+
+/* Copies @size bytes from @offset bytes past the read position,
+ * without committing the space. */
+void spsc_fifo_read_at(spsc_fifo_t *fifo, size_t offset,
+      void *out_buf, size_t size);
+
+/**
+ * spsc_fifo_write_span:
+ * @fifo               : ring buffer.
+ * @offset             : bytes past the write position.
+ * @size               : set to the size of the span.
+ *
+ * Gives direct access to free space, up to the point where the
+ * buffer wraps around. @offset must be below spsc_fifo_write_avail().
+ *
+ * Returns: start of the span.
+ **/
+void *spsc_fifo_write_span(spsc_fifo_t *fifo, size_t offset, size_t *size);
+
+/**
+ * spsc_fifo_read_span:
+ * @fifo               : ring buffer.
+ * @offset             : bytes past the read position.
+ * @size               : set to the size of the span.
+ *
+ * Gives direct access to committed data, up to the point where the
+ * buffer wraps around. @offset must be below spsc_fifo_read_avail().
+ *
+ * Returns: start of the span.
+ **/
+const void *spsc_fifo_read_span(spsc_fifo_t *fifo, size_t offset,
+      size_t *size);
+
+void spsc_fifo_write_commit(spsc_fifo_t *fifo, size_t size);
+
+void spsc_fifo_read_commit(spsc_fifo_t *fifo, size_t size);
+
+RETRO_END_DECLS
+
+#endif
@@ -97,9 +97,26 @@ enum task_queue_ctl_state
    /**
     * Signals a task to end without waiting for
     * it to complete. */
-   TASK_QUEUE_CTL_CANCEL
+   TASK_QUEUE_CTL_CANCEL,
+
+   /* Sets the number of worker threads used by the threaded
+    * implementation from the next TASK_QUEUE_CTL_INIT on.
+    * Takes an unsigned *, 0 means one per CPU core. */
+   TASK_QUEUE_CTL_SET_WORKERS
  };
 
+enum task_priority
+{
+   /* Default for tasks which don't set one. */
+   TASK_PRIORITY_NORMAL = 0,
+
+   /* Things the user is waiting to see, e.g. menu images. */
+   TASK_PRIORITY_HIGH,
+
+   /* Long running background work, e.g. database scans. */
+   TASK_PRIORITY_LOW
+};
+
 typedef struct retro_task retro_task_t;
 typedef void (*retro_task_callback_t)(void *task_data,
       void *user_data, const char *error);
@@ -138,6 +155,15 @@ struct retro_task
    /* if true no OSD messages will be displayed. */
    bool mute;
 
+   /* with the threaded implementation, runnable tasks of a 
+    * higher priority are always picked first. */
+   enum task_priority priority;
+
+   /* with the threaded implementation, tasks run one at a time
+    * unless this is set. Only set it for handlers which touch
+    * no state shared with other tasks. */
+   bool concurrent;
+
    /* created by the handler, destroyed by the user */
    void *task_data;
 
@@ -160,6 +186,10 @@ struct retro_task
 
    /* don't touch this. */
    retro_task_t *next;
+
+   /* set while a worker thread runs the handler,
+    * so no other worker picks up the same task. */
+   bool busy;
 };
 
 typedef struct task_finder_data
@@ -0,0 +1,123 @@
+/* Copyright  (C) 2010-2016 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (retro_atomic.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __LIBRETRO_SDK_ATOMIC_H
+#define __LIBRETRO_SDK_ATOMIC_H
+
+#include <retro_inline.h>
+
+/* Minimal atomic operations on an int.
+ *
+ * retro_atomic_load() and retro_atomic_store() are sequentially
+ * consistent, the _acquire/_release variants only order accesses
+ * in one direction. retro_atomic_exchange() and
+ * retro_atomic_fetch_add() are full barriers.
+ *
+ * RETRO_ATOMIC_LOCK_FREE is defined when these are implemented
+ * with compiler intrinsics. Otherwise they are plain volatile
+ * accesses and callers must fall back to locks. */
+
+#if defined(__clang__) || (defined(__GNUC__) && \
+      (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)))
+
+#define RETRO_ATOMIC_LOCK_FREE 1
+
+typedef volatile int retro_atomic_int_t;
+
+#define retro_atomic_load(p)            __atomic_load_n((p), __ATOMIC_SEQ_CST)
+#define retro_atomic_load_acquire(p)    __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define retro_atomic_store(p, v)        __atomic_store_n((p), (v), __ATOMIC_SEQ_CST)
+#define retro_atomic_store_release(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define retro_atomic_exchange(p, v)     __atomic_exchange_n((p), (v), __ATOMIC_SEQ_CST)
+#define retro_atomic_fetch_add(p, v)    __atomic_fetch_add((p), (v), __ATOMIC_SEQ_CST)
+
+#elif defined(__GNUC__) && \
+      (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+
+#define RETRO_ATOMIC_LOCK_FREE 1
+
+typedef volatile int retro_atomic_int_t;
+
+static INLINE int retro_atomic_load(retro_atomic_int_t *p)
+{
+   return __sync_fetch_and_add(p, 0);
+}
+
+static INLINE void retro_atomic_store(retro_atomic_int_t *p, int v)
+{
+   __sync_synchronize();
+   *p = v;
+   __sync_synchronize();
+}
+
+static INLINE int retro_atomic_exchange(retro_atomic_int_t *p, int v)
+{
+   /* __sync_lock_test_and_set() is only an acquire barrier. */
+   __sync_synchronize();
+   return __sync_lock_test_and_set(p, v);
+}
+
+#define retro_atomic_load_acquire(p)     retro_atomic_load(p)
+#define retro_atomic_store_release(p, v) retro_atomic_store(p, v)
+#define retro_atomic_fetch_add(p, v)     __sync_fetch_and_add((p), (v))
+
+#elif defined(_MSC_VER)
+
+#include <windows.h>
+
+#define RETRO_ATOMIC_LOCK_FREE 1
+
+typedef volatile LONG retro_atomic_int_t;
+
+#define retro_atomic_load(p)             ((int)InterlockedCompareExchange((p), 0, 0))
+#define retro_atomic_store(p, v)         ((void)InterlockedExchange((p), (v)))
+#define retro_atomic_exchange(p, v)      ((int)InterlockedExchange((p), (v)))
+#define retro_atomic_fetch_add(p, v)     ((int)InterlockedExchangeAdd((p), (v)))
+#define retro_atomic_load_acquire(p)     retro_atomic_load(p)
+#define retro_atomic_store_release(p, v) retro_atomic_store(p, v)
+
+#else
+
+typedef volatile int retro_atomic_int_t;
+
+static INLINE int retro_atomic_exchange(retro_atomic_int_t *p, int v)
+{
+   int old = *p;
+   *p      = v;
+   return old;
+}
+
+static INLINE int retro_atomic_fetch_add(retro_atomic_int_t *p, int v)
+{
+   int old = *p;
+   *p      = old + v;
+   return old;
+}
+
+#define retro_atomic_load(p)             (*(p))
+#define retro_atomic_load_acquire(p)     (*(p))
+#define retro_atomic_store(p, v)         ((void)(*(p) = (v)))
+#define retro_atomic_store_release(p, v) ((void)(*(p) = (v)))
+
+#endif
+
+#endif
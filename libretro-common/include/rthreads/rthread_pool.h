@@ -0,0 +1,94 @@
+/* Copyright  (C) 2010-2016 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (rthread_pool.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __LIBRETRO_SDK_RTHREAD_POOL_H
+#define __LIBRETRO_SDK_RTHREAD_POOL_H
+
+#include <retro_common_api.h>
+
+RETRO_BEGIN_DECLS
+
+/* A fixed set of persistent threads that split a job of numbered
+ * items, typically bands of rows, between them.
+ *
+ * The calling thread takes part in every job. Each thread starts on
+ * its own contiguous range of items and steals from the others once
+ * it runs dry. Idle workers spin for a short while before they park,
+ * so back-to-back jobs in a frame don't go through the scheduler.
+ *
+ * A pool runs one job at a time and is meant to be driven by a
+ * single thread. It is safe to call from several, but a job issued
+ * while another thread's job is running waits for all of it, so a
+ * thread that must not stall behind others needs a pool of its own. */
+
+typedef struct rthread_pool rthread_pool_t;
+
+/**
+ * rthread_pool_job_t:
+ * @userdata             : userdata passed to rthread_pool_run().
+ * @item                 : item to process.
+ * @thread               : index of the running thread, below
+ *                         rthread_pool_threads(). The caller is 0.
+ **/
+typedef void (*rthread_pool_job_t)(void *userdata,
+      unsigned item, unsigned thread);
+
+/**
+ * rthread_pool_new:
+ * @threads              : threads running a job, including the caller.
+ *
+ * Create a new thread pool, starting @threads - 1 workers.
+ *
+ * Returns: pointer to new thread pool if successful, otherwise NULL.
+ */
+rthread_pool_t *rthread_pool_new(unsigned threads);
+
+void rthread_pool_free(rthread_pool_t *pool);
+
+/**
+ * rthread_pool_threads:
+ * @pool                 : thread pool, may be NULL.
+ *
+ * Returns: number of threads that run a job at once, 1 if @pool is NULL.
+ */
+unsigned rthread_pool_threads(rthread_pool_t *pool);
+
+/**
+ * rthread_pool_run:
+ * @pool                 : thread pool, may be NULL.
+ * @job                  : called once for every item.
+ * @userdata             : passed to @job.
+ * @count                : number of items.
+ *
+ * Runs @job for items 0 to @count - 1 and waits for all of them.
+ * Without a pool, they all run on the calling thread.
+ *
+ * Jobs from different threads are not queued next to each other,
+ * the second caller blocks until the first job has finished. Don't
+ * call this from inside a job of the same pool.
+ */
+void rthread_pool_run(rthread_pool_t *pool, rthread_pool_job_t job,
+      void *userdata, unsigned count);
+
+RETRO_END_DECLS
+
+#endif
@@ -0,0 +1,249 @@
+/* Copyright  (C) 2010-2016 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (spsc_fifo.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include <retro_inline.h>
+#include <retro_atomic.h>
+#include <queues/spsc_fifo.h>
+
+/* Without atomic intrinsics, the positions are guarded by a lock. */
+#if !defined(RETRO_ATOMIC_LOCK_FREE) && defined(HAVE_THREADS)
+#define SPSC_FIFO_LOCKED
+#include <rthreads/rthreads.h>
+#endif
+
+/* Both positions run over twice the capacity, which has to fit
+ * the unsigned value stored in a retro_atomic_int_t. */
+#define SPSC_FIFO_MAX_SIZE   ((size_t)(UINT_MAX / 2))
+#define SPSC_FIFO_CACHE_LINE 64
+
+struct spsc_fifo
+{
+   uint8_t *buffer;
+   size_t size;
+#ifdef SPSC_FIFO_LOCKED
+   slock_t *lock;
+#endif
+
+   /* Byte positions in [0, 2 * size), so that a full buffer can be
+    * told apart from an empty one without rounding the capacity to
+    * a power of two. Each is only stored by one side, and they are
+    * kept on separate cache lines so the two threads don't fight
+    * over them. */
+   uint8_t pad0[SPSC_FIFO_CACHE_LINE];
+   retro_atomic_int_t write_pos;
+   uint8_t pad1[SPSC_FIFO_CACHE_LINE];
+   retro_atomic_int_t read_pos;
+   uint8_t pad2[SPSC_FIFO_CACHE_LINE];
+};
+
+static INLINE unsigned spsc_fifo_load(spsc_fifo_t *fifo,
+      retro_atomic_int_t *pos)
+{
+#ifdef SPSC_FIFO_LOCKED
+   unsigned val;
+   slock_lock(fifo->lock);
+   val = (unsigned)*pos;
+   slock_unlock(fifo->lock);
+   return val;
+#else
+   return (unsigned)retro_atomic_load_acquire(pos);
+#endif
+}
+
+static INLINE void spsc_fifo_store(spsc_fifo_t *fifo,
+      retro_atomic_int_t *pos, unsigned val)
+{
+#ifdef SPSC_FIFO_LOCKED
+   slock_lock(fifo->lock);
+   *pos = (int)val;
+   slock_unlock(fifo->lock);
+#else
+   retro_atomic_store_release(pos, (int)val);
+#endif
+}
+
+/* Maps a position onto the buffer. */
+static INLINE size_t spsc_fifo_index(const spsc_fifo_t *fifo, size_t pos)
+{
+   return pos >= fifo->size ? pos - fifo->size : pos;
+}
+
+static INLINE unsigned spsc_fifo_advance(const spsc_fifo_t *fifo,
+      unsigned pos, size_t size)
+{
+   size_t left = 2 * fifo->size - pos;
+   if (size >= left)
+      return (unsigned)(size - left);
+   return (unsigned)(pos + size);
+}
+
+static INLINE size_t spsc_fifo_used(const spsc_fifo_t *fifo,
+      unsigned write_pos, unsigned read_pos)
+{
+   if (write_pos >= read_pos)
+      return write_pos - read_pos;
+   return 2 * fifo->size - read_pos + write_pos;
+}
+
+spsc_fifo_t *spsc_fifo_new(size_t size)
+{
+   spsc_fifo_t *buf = NULL;
+
+   if (!size || size > SPSC_FIFO_MAX_SIZE)
+      return NULL;
+
+   buf = (spsc_fifo_t*)calloc(1, sizeof(*buf));
+   if (!buf)
+      return NULL;
+
+   buf->buffer = (uint8_t*)calloc(1, size);
+   if (!buf->buffer)
+      goto error;
+   buf->size   = size;
+
+#ifdef SPSC_FIFO_LOCKED
+   buf->lock   = slock_new();
+   if (!buf->lock)
+      goto error;
+#endif
+
+   return buf;
+
+error:
+   spsc_fifo_free(buf);
+   return NULL;
+}
+
+void spsc_fifo_free(spsc_fifo_t *fifo)
+{
+   if (!fifo)
+      return;
+
+#ifdef SPSC_FIFO_LOCKED
+   if (fifo->lock)
+      slock_free(fifo->lock);
+#endif
+   free(fifo->buffer);
+   free(fifo);
+}
+
+void spsc_fifo_clear(spsc_fifo_t *fifo)
+{
+   spsc_fifo_store(fifo, &fifo->read_pos,
+         spsc_fifo_load(fifo, &fifo->write_pos));
+}
+
+size_t spsc_fifo_read_avail(spsc_fifo_t *fifo)
+{
+   unsigned write_pos = spsc_fifo_load(fifo, &fifo->write_pos);
+   unsigned read_pos  = spsc_fifo_load(fifo, &fifo->read_pos);
+   return spsc_fifo_used(fifo, write_pos, read_pos);
+}
+
+size_t spsc_fifo_write_avail(spsc_fifo_t *fifo)
+{
+   unsigned write_pos = spsc_fifo_load(fifo, &fifo->write_pos);
+   unsigned read_pos  = spsc_fifo_load(fifo, &fifo->read_pos);
+   return fifo->size - spsc_fifo_used(fifo, write_pos, read_pos);
+}
+
+void *spsc_fifo_write_span(spsc_fifo_t *fifo, size_t offset, size_t *size)
+{
+   size_t start = spsc_fifo_index(fifo, spsc_fifo_advance(fifo,
+            spsc_fifo_load(fifo, &fifo->write_pos), offset));
+   size_t avail = spsc_fifo_write_avail(fifo) - offset;
+   size_t span  = fifo->size - start;
+
+   *size        = avail < span ? avail : span;
+   return fifo->buffer + start;
+}
+
+const void *spsc_fifo_read_span(spsc_fifo_t *fifo, size_t offset,
+      size_t *size)
+{
+   size_t start = spsc_fifo_index(fifo, spsc_fifo_advance(fifo,
+            spsc_fifo_load(fifo, &fifo->read_pos), offset));
+   size_t avail = spsc_fifo_read_avail(fifo) - offset;
+   size_t span  = fifo->size - start;
+
+   *size        = avail < span ? avail : span;
+   return fifo->buffer + start;
+}
+
+void spsc_fifo_write_at(spsc_fifo_t *fifo, size_t offset,
+      const void *in_buf, size_t size)
+{
+   size_t start       = spsc_fifo_index(fifo, spsc_fifo_advance(fifo,
+            spsc_fifo_load(fifo, &fifo->write_pos), offset));
+   size_t first_write = size;
+
+   if (start + size > fifo->size)
+      first_write = fifo->size - start;
+
+   memcpy(fifo->buffer + start, in_buf, first_write);
+   memcpy(fifo->buffer, (const uint8_t*)in_buf + first_write,
+         size - first_write);
+}
+
+void spsc_fifo_read_at(spsc_fifo_t *fifo, size_t offset,
+      void *out_buf, size_t size)
+{
+   size_t start      = spsc_fifo_index(fifo, spsc_fifo_advance(fifo,
+            spsc_fifo_load(fifo, &fifo->read_pos), offset));
+   size_t first_read = size;
+
+   if (start + size > fifo->size)
+      first_read = fifo->size - start;
+
+   memcpy(out_buf, fifo->buffer + start, first_read);
+   memcpy((uint8_t*)out_buf + first_read, fifo->buffer,
+         size - first_read);
+}
+
+void spsc_fifo_write_commit(spsc_fifo_t *fifo, size_t size)
+{
+   spsc_fifo_store(fifo, &fifo->write_pos, spsc_fifo_advance(fifo,
+            spsc_fifo_load(fifo, &fifo->write_pos), size));
+}
+
+void spsc_fifo_read_commit(spsc_fifo_t *fifo, size_t size)
+{
+   spsc_fifo_store(fifo, &fifo->read_pos, spsc_fifo_advance(fifo,
+            spsc_fifo_load(fifo, &fifo->read_pos), size));
+}
+
+void spsc_fifo_write(spsc_fifo_t *fifo, const void *in_buf, size_t size)
+{
+   spsc_fifo_write_at(fifo, 0, in_buf, size);
+   spsc_fifo_write_commit(fifo, size);
+}
+
+void spsc_fifo_read(spsc_fifo_t *fifo, void *out_buf, size_t size)
+{
+   spsc_fifo_read_at(fifo, 0, out_buf, size);
+   spsc_fifo_read_commit(fifo, size);
+}
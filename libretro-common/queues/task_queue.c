@@ -27,6 +27,7 @@
 #include <queues/task_queue.h>
 
 #ifdef HAVE_THREADS
+#include <features/features_cpu.h>
 #include <rthreads/rthreads.h>
 #endif
 
@@ -51,6 +52,7 @@ struct retro_task_impl
 
 static task_queue_t tasks_running  = {NULL, NULL};
 static task_queue_t tasks_finished = {NULL, NULL};
+static unsigned task_worker_count  = 0;
 
 static void task_queue_msg_push(unsigned prio, unsigned duration,
       bool flush, const char *fmt, ...)
@@ -275,11 +277,13 @@ static struct retro_task_impl impl_regular = {
 };
 
 #ifdef HAVE_THREADS
-static slock_t *running_lock    = NULL;
-static slock_t *finished_lock   = NULL;
-static scond_t *worker_cond     = NULL;
-static sthread_t *worker_thread = NULL;
-static bool worker_continue     = true; /* use running_lock when touching it */
+static slock_t *running_lock     = NULL;
+static slock_t *finished_lock    = NULL;
+static scond_t *worker_cond      = NULL;
+static sthread_t **worker_thread = NULL;
+static unsigned worker_threads   = 0;
+static bool worker_continue      = true; /* use running_lock when touching it */
+static unsigned serial_busy      = 0;    /* use running_lock when touching it */
 
 static void task_queue_remove(task_queue_t *queue, retro_task_t *task)
 {
@@ -302,6 +306,8 @@ static void task_queue_remove(task_queue_t *queue, retro_task_t *task)
       {
          t->next    = task->next;
          task->next = NULL;
+         if (queue->back == task)
+            queue->back = t;
          break;
       }
 
@@ -408,6 +414,41 @@ static void retro_task_threaded_retrieve(task_retriever_data_t *data)
    slock_unlock(running_lock);
 }
 
+/* Picks the first task of the highest priority which isn't
+ * already running on another worker. Tasks which aren't marked
+ * concurrent are skipped while another such task runs, as most
+ * of them still share file-static state. Tasks go to the back of
+ * tasks_running after each call to their handler, so tasks of
+ * the same priority take turns. Call with running_lock held. */
+static retro_task_t *threaded_worker_pick(void)
+{
+   retro_task_t *task   = NULL;
+   retro_task_t *normal = NULL;
+   retro_task_t *low    = NULL;
+
+   for (task = tasks_running.front; task; task = task->next)
+   {
+      if (task->busy || (!task->concurrent && serial_busy))
+         continue;
+
+      switch (task->priority)
+      {
+         case TASK_PRIORITY_HIGH:
+            return task;
+         case TASK_PRIORITY_LOW:
+            if (!low)
+               low = task;
+            break;
+         default:
+            if (!normal)
+               normal = task;
+            break;
+      }
+   }
+
+   return normal ? normal : low;
+}
+
 static void threaded_worker(void *userdata)
 {
    (void)userdata;
@@ -416,13 +457,17 @@ static void threaded_worker(void *userdata)
    {
       retro_task_t *task  = NULL;
 
-      if (!worker_continue)
-         break; /* should we keep running until all tasks finished? */
-
       slock_lock(running_lock);
 
+      if (!worker_continue)
+      {
+         /* should we keep running until all tasks finished? */
+         slock_unlock(running_lock);
+         break;
+      }
+
       /* Get first task to run */
-      task = tasks_running.front;
+      task = threaded_worker_pick();
       if (task == NULL)
       {
          scond_wait(worker_cond, running_lock);
@@ -430,22 +475,32 @@ static void threaded_worker(void *userdata)
          continue;
       }
 
+      task->busy = true;
+      if (!task->concurrent)
+         serial_busy++;
       slock_unlock(running_lock);
 
       task->handler(task);
 
       slock_lock(running_lock);
+      task->busy = false;
+      if (!task->concurrent)
+         serial_busy--;
       task_queue_remove(&tasks_running, task);
-      slock_unlock(running_lock);
 
       /* Update queue */
       if (!task->finished)
       {
-         /* Re-add task to running queue */
-         retro_task_threaded_push_running(task);
+         /* Re-add task to running queue, and let another worker 
+          * have it if we get something of higher priority first. */
+         task_queue_put(&tasks_running, task);
+         scond_signal(worker_cond);
+         slock_unlock(running_lock);
       }
       else
       {
+         slock_unlock(running_lock);
+
          /* Add task to finished queue */
          slock_lock(finished_lock);
          task_queue_put(&tasks_finished, task);
@@ -460,6 +515,8 @@ static void threaded_worker(void *userdata)
 
 static void retro_task_threaded_init(void)
 {
+   unsigned i;
+
    running_lock  = slock_new();
    finished_lock = slock_new();
    worker_cond   = scond_new();
@@ -468,26 +525,42 @@ static void retro_task_threaded_init(void)
    worker_continue = true;
    slock_unlock(running_lock);
 
-   worker_thread = sthread_create(threaded_worker, NULL);
+   worker_threads = task_worker_count;
+   if (!worker_threads)
+      worker_threads = cpu_features_get_core_amount();
+   if (!worker_threads)
+      worker_threads = 1;
+
+   worker_thread  = (sthread_t**)calloc(worker_threads, sizeof(*worker_thread));
+
+   for (i = 0; i < worker_threads; i++)
+      worker_thread[i] = sthread_create(threaded_worker, NULL);
 }
 
 static void retro_task_threaded_deinit(void)
 {
+   unsigned i;
+
    slock_lock(running_lock);
    worker_continue = false;
-   scond_signal(worker_cond);
+   scond_broadcast(worker_cond);
    slock_unlock(running_lock);
 
-   sthread_join(worker_thread);
+   for (i = 0; i < worker_threads; i++)
+      if (worker_thread[i])
+         sthread_join(worker_thread[i]);
+
+   free(worker_thread);
 
    scond_free(worker_cond);
    slock_free(running_lock);
    slock_free(finished_lock);
 
-   worker_thread = NULL;
-   worker_cond   = NULL;
-   running_lock  = NULL;
-   finished_lock = NULL;
+   worker_thread  = NULL;
+   worker_threads = 0;
+   worker_cond    = NULL;
+   running_lock   = NULL;
+   finished_lock  = NULL;
 }
 
 static struct retro_task_impl impl_threaded = {
@@ -585,6 +658,9 @@ bool task_queue_ctl(enum task_queue_ctl_state state, void *data)
       case TASK_QUEUE_CTL_CANCEL:
          impl_current->cancel(data);
          break;
+      case TASK_QUEUE_CTL_SET_WORKERS:
+         task_worker_count = *(unsigned*)data;
+         break;
       case TASK_QUEUE_CTL_NONE:
       default:
          break;
@@ -0,0 +1,247 @@
+/* Copyright  (C) 2010-2016 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (fifo_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Moves messages of 1, 2 and 4 KB from a producer to a consumer
+ * thread, through a fifo_buffer_t guarded by a lock the way the
+ * recorder used it, and through spsc_fifo_t. Every message carries
+ * a sequence number, which the consumer checks. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+
+#include <boolean.h>
+#include <features/features_cpu.h>
+#include <queues/fifo_queue.h>
+#include <queues/spsc_fifo.h>
+#include <rthreads/rthreads.h>
+
+#define BENCH_FIFO_SIZE (64 << 10)
+#define BENCH_BYTES     (256 << 20)
+
+struct bench
+{
+   fifo_buffer_t *fifo;
+   slock_t *lock;
+   spsc_fifo_t *spsc;
+   size_t msg_size;
+   unsigned msgs;
+   unsigned errors;
+};
+
+static void bench_fill(uint8_t *msg, size_t size, uint32_t seq)
+{
+   size_t i;
+   for (i = 0; i < size; i += sizeof(seq))
+      memcpy(msg + i, &seq, sizeof(seq));
+}
+
+static bool bench_check(const uint8_t *msg, size_t size, uint32_t seq)
+{
+   size_t i;
+   for (i = 0; i < size; i += sizeof(seq))
+      if (memcmp(msg + i, &seq, sizeof(seq)))
+         return false;
+   return true;
+}
+
+static void bench_locked_consumer(void *data)
+{
+   unsigned i;
+   struct bench *b = (struct bench*)data;
+   uint8_t *msg    = (uint8_t*)malloc(b->msg_size);
+
+   for (i = 0; i < b->msgs; i++)
+   {
+      for (;;)
+      {
+         bool got;
+
+         slock_lock(b->lock);
+         got = fifo_read_avail(b->fifo) >= b->msg_size;
+         if (got)
+            fifo_read(b->fifo, msg, b->msg_size);
+         slock_unlock(b->lock);
+
+         if (got)
+            break;
+         sched_yield();
+      }
+
+      if (!bench_check(msg, b->msg_size, i))
+         b->errors++;
+   }
+
+   free(msg);
+}
+
+static void bench_locked_producer(struct bench *b)
+{
+   unsigned i;
+   uint8_t *msg = (uint8_t*)malloc(b->msg_size);
+
+   for (i = 0; i < b->msgs; i++)
+   {
+      bench_fill(msg, b->msg_size, i);
+
+      for (;;)
+      {
+         bool put;
+
+         slock_lock(b->lock);
+         put = fifo_write_avail(b->fifo) >= b->msg_size;
+         if (put)
+            fifo_write(b->fifo, msg, b->msg_size);
+         slock_unlock(b->lock);
+
+         if (put)
+            break;
+         sched_yield();
+      }
+   }
+
+   free(msg);
+}
+
+/* Checks the message in place where it doesn't wrap. */
+static void bench_spsc_consumer(void *data)
+{
+   unsigned i;
+   struct bench *b = (struct bench*)data;
+   uint8_t *msg    = (uint8_t*)malloc(b->msg_size);
+
+   for (i = 0; i < b->msgs; i++)
+   {
+      size_t span;
+      const uint8_t *in;
+
+      while (spsc_fifo_read_avail(b->spsc) < b->msg_size)
+         sched_yield();
+
+      in = (const uint8_t*)spsc_fifo_read_span(b->spsc, 0, &span);
+      if (span < b->msg_size)
+      {
+         spsc_fifo_read_at(b->spsc, 0, msg, b->msg_size);
+         in = msg;
+      }
+
+      if (!bench_check(in, b->msg_size, i))
+         b->errors++;
+      spsc_fifo_read_commit(b->spsc, b->msg_size);
+   }
+
+   free(msg);
+}
+
+/* Builds the message in place where it doesn't wrap. */
+static void bench_spsc_producer(struct bench *b)
+{
+   unsigned i;
+   uint8_t *msg = (uint8_t*)malloc(b->msg_size);
+
+   for (i = 0; i < b->msgs; i++)
+   {
+      size_t span;
+      uint8_t *out;
+
+      while (spsc_fifo_write_avail(b->spsc) < b->msg_size)
+         sched_yield();
+
+      out = (uint8_t*)spsc_fifo_write_span(b->spsc, 0, &span);
+      if (span >= b->msg_size)
+         bench_fill(out, b->msg_size, i);
+      else
+      {
+         bench_fill(msg, b->msg_size, i);
+         spsc_fifo_write_at(b->spsc, 0, msg, b->msg_size);
+      }
+      spsc_fifo_write_commit(b->spsc, b->msg_size);
+   }
+
+   free(msg);
+}
+
+static bool bench_run(size_t msg_size, bool spsc)
+{
+   sthread_t *thread;
+   retro_time_t start, delta;
+   struct bench b;
+
+   memset(&b, 0, sizeof(b));
+   b.msg_size = msg_size;
+   b.msgs     = BENCH_BYTES / msg_size;
+
+   if (spsc)
+      b.spsc  = spsc_fifo_new(BENCH_FIFO_SIZE);
+   else
+   {
+      b.fifo  = fifo_new(BENCH_FIFO_SIZE);
+      b.lock  = slock_new();
+   }
+
+   start  = cpu_features_get_time_usec();
+   thread = sthread_create(spsc ? bench_spsc_consumer
+         : bench_locked_consumer, &b);
+   if (!thread)
+   {
+      fprintf(stderr, "Failed to start consumer.\n");
+      return false;
+   }
+
+   if (spsc)
+      bench_spsc_producer(&b);
+   else
+      bench_locked_producer(&b);
+
+   sthread_join(thread);
+   delta = cpu_features_get_time_usec() - start;
+
+   printf("%-6s %u KB messages: %8.1f MB/s, %u errors\n",
+         spsc ? "spsc" : "locked", (unsigned)(msg_size >> 10),
+         (double)BENCH_BYTES / delta, b.errors);
+
+   if (spsc)
+      spsc_fifo_free(b.spsc);
+   else
+   {
+      fifo_free(b.fifo);
+      slock_free(b.lock);
+   }
+
+   return b.errors == 0;
+}
+
+int main(void)
+{
+   unsigned i;
+   static const size_t sizes[] = { 1 << 10, 2 << 10, 4 << 10 };
+   bool ok                     = true;
+
+   for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+   {
+      ok = bench_run(sizes[i], false) && ok;
+      ok = bench_run(sizes[i], true)  && ok;
+   }
+
+   return ok ? 0 : 1;
+}
@@ -0,0 +1,237 @@
+/* Copyright  (C) 2010-2016 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (task_queue_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Pushes a few hundred tasks of all priorities, shaped like a
+ * database scan with image loads and downloads running alongside,
+ * and checks that no handler ever runs on two workers at once,
+ * that tasks not marked concurrent never run alongside each other,
+ * that every task finishes exactly once and that high priority
+ * tasks don't wait behind the scan. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <features/features_cpu.h>
+#include <queues/task_queue.h>
+#include <retro_atomic.h>
+#include <retro_miscellaneous.h>
+
+#define TEST_TASKS   600
+#define TEST_TIMEOUT (60 * 1000000)
+
+struct test_task
+{
+   retro_atomic_int_t running;
+   unsigned slices;
+   unsigned callbacks;
+   retro_time_t pushed;
+   retro_time_t done;
+};
+
+static struct test_task test_tasks[TEST_TASKS];
+static retro_atomic_int_t test_overlaps;
+static retro_atomic_int_t test_serial_running;
+static retro_atomic_int_t test_serial_overlaps;
+static unsigned test_done;
+
+static void test_handler(retro_task_t *task)
+{
+   unsigned i;
+   volatile uint32_t x = 0;
+   struct test_task *t = (struct test_task*)task->user_data;
+
+   if (retro_atomic_fetch_add(&t->running, 1) != 0)
+      retro_atomic_fetch_add(&test_overlaps, 1);
+   if (!task->concurrent &&
+         retro_atomic_fetch_add(&test_serial_running, 1) != 0)
+      retro_atomic_fetch_add(&test_serial_overlaps, 1);
+
+   /* Something in the range of decoding a chunk of a PNG. */
+   for (i = 0; i < 20000; i++)
+      x = x * 1664525 + 1013904223;
+
+   if (--t->slices == 0 || task->cancelled)
+      task->finished = true;
+
+   if (!task->concurrent)
+      retro_atomic_fetch_add(&test_serial_running, -1);
+   retro_atomic_fetch_add(&t->running, -1);
+}
+
+static void test_callback(void *task_data, void *user_data, const char *error)
+{
+   struct test_task *t = (struct test_task*)user_data;
+
+   t->done = cpu_features_get_time_usec();
+   t->callbacks++;
+   test_done++;
+}
+
+static enum task_priority test_priority(unsigned i)
+{
+   /* The scan is queued first, the rest arrives while it runs. */
+   if (i < TEST_TASKS / 3)
+      return TASK_PRIORITY_LOW;
+   return (i & 1) ? TASK_PRIORITY_HIGH : TASK_PRIORITY_NORMAL;
+}
+
+static void test_push(unsigned i)
+{
+   retro_task_t *task = (retro_task_t*)calloc(1, sizeof(*task));
+
+   task->handler   = test_handler;
+   task->callback  = test_callback;
+   task->user_data = &test_tasks[i];
+   task->priority  = test_priority(i);
+   task->mute      = true;
+
+   /* Like image loads, the high priority tasks share nothing. */
+   task->concurrent = task->priority == TASK_PRIORITY_HIGH;
+
+   switch (task->priority)
+   {
+      case TASK_PRIORITY_HIGH:
+         test_tasks[i].slices = 1 + i % 2;
+         break;
+      case TASK_PRIORITY_LOW:
+         test_tasks[i].slices = 10 + i % 11;
+         break;
+      default:
+         test_tasks[i].slices = 3 + i % 3;
+         break;
+   }
+
+   test_tasks[i].pushed = cpu_features_get_time_usec();
+   task_queue_ctl(TASK_QUEUE_CTL_PUSH, task);
+}
+
+static bool test_run(bool threaded, unsigned workers)
+{
+   unsigned i;
+   retro_time_t start;
+   double latency[3]  = {0};
+   unsigned count[3]  = {0};
+   bool ok            = true;
+
+   memset(test_tasks, 0, sizeof(test_tasks));
+   test_overlaps        = 0;
+   test_serial_running  = 0;
+   test_serial_overlaps = 0;
+   test_done            = 0;
+
+   task_queue_ctl(TASK_QUEUE_CTL_SET_WORKERS, &workers);
+   task_queue_ctl(TASK_QUEUE_CTL_INIT, &threaded);
+   if (!threaded)
+      task_queue_ctl(TASK_QUEUE_CTL_UNSET_THREADED, NULL);
+
+   start = cpu_features_get_time_usec();
+
+   for (i = 0; i < TEST_TASKS / 3; i++)
+      test_push(i);
+
+   /* Let the scan get going before the rest shows up. */
+   task_queue_ctl(TASK_QUEUE_CTL_CHECK, NULL);
+
+   for (; i < TEST_TASKS; i++)
+   {
+      test_push(i);
+      if (i % 16 == 0)
+         task_queue_ctl(TASK_QUEUE_CTL_CHECK, NULL);
+   }
+
+   while (test_done < TEST_TASKS)
+   {
+      if (cpu_features_get_time_usec() - start > TEST_TIMEOUT)
+      {
+         fprintf(stderr, "Timed out with %u/%u tasks done.\n",
+               test_done, TEST_TASKS);
+         return false;
+      }
+
+      /* Gather about as often as the frontend would. */
+      retro_sleep(1);
+      task_queue_ctl(TASK_QUEUE_CTL_CHECK, NULL);
+   }
+
+   for (i = 0; i < TEST_TASKS; i++)
+   {
+      unsigned prio = test_priority(i);
+
+      if (test_tasks[i].callbacks != 1)
+      {
+         fprintf(stderr, "Task %u finished %u times.\n",
+               i, test_tasks[i].callbacks);
+         ok = false;
+      }
+
+      latency[prio] += test_tasks[i].done - test_tasks[i].pushed;
+      count[prio]++;
+   }
+
+   for (i = 0; i < 3; i++)
+      latency[i] /= count[i] * 1000.0;
+
+   printf("%-8s %2u workers: %7.1f ms, latency high %7.1f ms, "
+         "normal %7.1f ms, low %7.1f ms, overlaps %d\n",
+         threaded ? "threaded" : "regular", threaded ? workers : 0,
+         (cpu_features_get_time_usec() - start) / 1000.0,
+         latency[TASK_PRIORITY_HIGH], latency[TASK_PRIORITY_NORMAL],
+         latency[TASK_PRIORITY_LOW], (int)test_overlaps);
+
+   if (test_overlaps)
+   {
+      fprintf(stderr, "A handler ran on two threads at once.\n");
+      ok = false;
+   }
+
+   if (test_serial_overlaps)
+   {
+      fprintf(stderr, "Two tasks not marked concurrent ran at once.\n");
+      ok = false;
+   }
+
+   if (threaded && latency[TASK_PRIORITY_HIGH] > latency[TASK_PRIORITY_LOW])
+   {
+      fprintf(stderr, "High priority tasks waited behind the scan.\n");
+      ok = false;
+   }
+
+   task_queue_ctl(TASK_QUEUE_CTL_DEINIT, NULL);
+   return ok;
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned workers = cpu_features_get_core_amount();
+   bool ok          = true;
+
+   if (argc > 1)
+      workers = strtoul(argv[1], NULL, 0);
+
+   ok = test_run(false, 0) && ok;
+   ok = test_run(true, 1) && ok;
+   if (workers > 1)
+      ok = test_run(true, workers) && ok;
+
+   return ok ? 0 : 1;
+}
@@ -0,0 +1,348 @@
+/* Copyright  (C) 2010-2016 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (rthread_pool.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+
+#include <boolean.h>
+#include <retro_atomic.h>
+#include <retro_inline.h>
+#include <rthreads/rthreads.h>
+#include <rthreads/rthread_pool.h>
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#endif
+
+#define RTHREAD_POOL_MAX_THREADS 64
+
+/* Polls before an idle thread parks. Long enough to bridge the gap
+ * between jobs issued back to back, short next to a frame. */
+#define RTHREAD_POOL_SPIN        4096
+
+/* The low bits of the state count the threads inside a job, the rest
+ * is a sequence number which is odd while a job is open. */
+#define RTHREAD_POOL_BUSY_MASK   0x3ff
+#define RTHREAD_POOL_OPEN        0x400
+
+struct rthread_pool_range
+{
+   retro_atomic_int_t next;
+   int end;
+   /* Ranges are hammered by different threads,
+    * keep them on cache lines of their own. */
+   char pad[64 - sizeof(retro_atomic_int_t) - sizeof(int)];
+};
+
+struct rthread_pool_worker
+{
+   rthread_pool_t *pool;
+   sthread_t *thread;
+   unsigned index;
+};
+
+struct rthread_pool
+{
+   struct rthread_pool_range *ranges;
+   struct rthread_pool_worker *workers;
+   unsigned threads;
+
+   /* Held by the caller for the whole job, so that a second
+    * calling thread waits until the job is done. */
+   slock_t *run_lock;
+
+   /* Guards parking. Workers park on wake, the caller on idle. */
+   slock_t *lock;
+   scond_t *wake;
+   scond_t *idle;
+   unsigned sleepers;
+   bool caller_waiting;
+
+   retro_atomic_int_t state;
+   retro_atomic_int_t done;
+   retro_atomic_int_t quit;
+
+   /* Only written while no job is open. */
+   rthread_pool_job_t job;
+   void *userdata;
+   int count;
+};
+
+static INLINE void rthread_pool_relax(void)
+{
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+   __builtin_ia32_pause();
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+   _mm_pause();
+#elif defined(__GNUC__) && (defined(__aarch64__) || \
+      (defined(__ARM_ARCH) && __ARM_ARCH >= 7))
+   __asm__ __volatile__("yield");
+#endif
+}
+
+/* Whether @state has a job open that started after @seen. */
+static INLINE bool rthread_pool_is_new(int state, int seen)
+{
+   return (state & RTHREAD_POOL_OPEN) &&
+      (state & ~RTHREAD_POOL_BUSY_MASK) != seen;
+}
+
+static void rthread_pool_work(rthread_pool_t *pool, unsigned thread)
+{
+   unsigned i;
+
+   /* Our own range first, then whatever the others have left. */
+   for (i = 0; i < pool->threads; i++)
+   {
+      int item;
+      struct rthread_pool_range *range =
+         &pool->ranges[(thread + i) % pool->threads];
+
+      while ((item = retro_atomic_fetch_add(&range->next, 1)) < range->end)
+      {
+         pool->job(pool->userdata, item, thread);
+
+         if (retro_atomic_fetch_add(&pool->done, 1) + 1 == pool->count
+               && thread)
+         {
+            slock_lock(pool->lock);
+            if (pool->caller_waiting)
+               scond_signal(pool->idle);
+            slock_unlock(pool->lock);
+         }
+      }
+   }
+}
+
+static void rthread_pool_thread(void *data)
+{
+   struct rthread_pool_worker *worker = (struct rthread_pool_worker*)data;
+   rthread_pool_t *pool               = worker->pool;
+   int seen                           = 0;
+
+   for (;;)
+   {
+      int state;
+      unsigned spin;
+
+      for (spin = 0; spin < RTHREAD_POOL_SPIN; spin++)
+      {
+         if (rthread_pool_is_new(retro_atomic_load_acquire(&pool->state), seen)
+               || retro_atomic_load_acquire(&pool->quit))
+            break;
+         rthread_pool_relax();
+      }
+
+      if (spin == RTHREAD_POOL_SPIN)
+      {
+         slock_lock(pool->lock);
+         pool->sleepers++;
+         while (!rthread_pool_is_new(retro_atomic_load(&pool->state), seen)
+               && !retro_atomic_load(&pool->quit))
+            scond_wait(pool->wake, pool->lock);
+         pool->sleepers--;
+         slock_unlock(pool->lock);
+      }
+
+      if (retro_atomic_load(&pool->quit))
+         break;
+
+      /* Joining only counts while the job is still open. Once the
+       * caller closes it, it may set up the next one. */
+      state = retro_atomic_fetch_add(&pool->state, 1);
+      seen  = state & ~RTHREAD_POOL_BUSY_MASK;
+
+      if (state & RTHREAD_POOL_OPEN)
+         rthread_pool_work(pool, worker->index);
+
+      state = retro_atomic_fetch_add(&pool->state, -1);
+      if ((state & RTHREAD_POOL_BUSY_MASK) == 1 &&
+            !(state & RTHREAD_POOL_OPEN))
+      {
+         slock_lock(pool->lock);
+         if (pool->caller_waiting)
+            scond_signal(pool->idle);
+         slock_unlock(pool->lock);
+      }
+   }
+}
+
+/* Spins, then parks until the bits of @value in @mask equal @target. */
+static void rthread_pool_wait(rthread_pool_t *pool,
+      retro_atomic_int_t *value, int mask, int target)
+{
+   unsigned spin;
+
+   for (spin = 0; spin < RTHREAD_POOL_SPIN; spin++)
+   {
+      if ((retro_atomic_load_acquire(value) & mask) == target)
+         return;
+      rthread_pool_relax();
+   }
+
+   slock_lock(pool->lock);
+   pool->caller_waiting = true;
+   while ((retro_atomic_load(value) & mask) != target)
+      scond_wait(pool->idle, pool->lock);
+   pool->caller_waiting = false;
+   slock_unlock(pool->lock);
+}
+
+rthread_pool_t *rthread_pool_new(unsigned threads)
+{
+   unsigned i;
+   rthread_pool_t *pool = (rthread_pool_t*)calloc(1, sizeof(*pool));
+
+   if (!pool)
+      return NULL;
+
+#ifndef RETRO_ATOMIC_LOCK_FREE
+   /* Without real atomics, the caller runs everything. */
+   threads = 1;
+#endif
+   if (threads < 1)
+      threads = 1;
+   if (threads > RTHREAD_POOL_MAX_THREADS)
+      threads = RTHREAD_POOL_MAX_THREADS;
+
+   pool->ranges   = (struct rthread_pool_range*)
+      calloc(threads, sizeof(*pool->ranges));
+   pool->workers  = (struct rthread_pool_worker*)
+      calloc(threads, sizeof(*pool->workers));
+   pool->run_lock = slock_new();
+   pool->lock     = slock_new();
+   pool->wake     = scond_new();
+   pool->idle     = scond_new();
+
+   if (!pool->ranges || !pool->workers || !pool->run_lock ||
+         !pool->lock || !pool->wake || !pool->idle)
+      goto error;
+
+   pool->threads = threads;
+
+   /* Worker 0 is the caller. */
+   for (i = 1; i < threads; i++)
+   {
+      struct rthread_pool_worker *worker = &pool->workers[i];
+
+      worker->pool   = pool;
+      worker->index  = i;
+      worker->thread = sthread_create(rthread_pool_thread, worker);
+      if (!worker->thread)
+         goto error;
+   }
+
+   return pool;
+
+error:
+   rthread_pool_free(pool);
+   return NULL;
+}
+
+void rthread_pool_free(rthread_pool_t *pool)
+{
+   unsigned i;
+
+   if (!pool)
+      return;
+
+   if (pool->lock)
+   {
+      slock_lock(pool->lock);
+      retro_atomic_store(&pool->quit, 1);
+      scond_broadcast(pool->wake);
+      slock_unlock(pool->lock);
+   }
+
+   if (pool->workers)
+   {
+      for (i = 1; i < pool->threads; i++)
+      {
+         if (pool->workers[i].thread)
+            sthread_join(pool->workers[i].thread);
+      }
+   }
+
+   if (pool->idle)
+      scond_free(pool->idle);
+   if (pool->wake)
+      scond_free(pool->wake);
+   if (pool->lock)
+      slock_free(pool->lock);
+   if (pool->run_lock)
+      slock_free(pool->run_lock);
+
+   free(pool->workers);
+   free(pool->ranges);
+   free(pool);
+}
+
+unsigned rthread_pool_threads(rthread_pool_t *pool)
+{
+   return pool ? pool->threads : 1;
+}
+
+void rthread_pool_run(rthread_pool_t *pool, rthread_pool_job_t job,
+      void *userdata, unsigned count)
+{
+   unsigned i;
+
+   if (!pool || pool->threads < 2 || count < 2)
+   {
+      for (i = 0; i < count; i++)
+         job(userdata, i, 0);
+      return;
+   }
+
+   slock_lock(pool->run_lock);
+
+   pool->job      = job;
+   pool->userdata = userdata;
+   pool->count    = (int)count;
+   retro_atomic_store(&pool->done, 0);
+
+   for (i = 0; i < pool->threads; i++)
+   {
+      retro_atomic_store(&pool->ranges[i].next,
+            (int)((unsigned long long)count * i / pool->threads));
+      pool->ranges[i].end =
+         (int)((unsigned long long)count * (i + 1) / pool->threads);
+   }
+
+   /* Open the job. Parked workers have to be woken, the
+    * spinning ones will see it on their own. */
+   retro_atomic_fetch_add(&pool->state, RTHREAD_POOL_OPEN);
+
+   slock_lock(pool->lock);
+   if (pool->sleepers)
+      scond_broadcast(pool->wake);
+   slock_unlock(pool->lock);
+
+   rthread_pool_work(pool, 0);
+   rthread_pool_wait(pool, &pool->done, ~0, pool->count);
+
+   /* Close the job, then wait for workers still looking
+    * for items to leave before the next one can be set up. */
+   retro_atomic_fetch_add(&pool->state, RTHREAD_POOL_OPEN);
+   rthread_pool_wait(pool, &pool->state, RTHREAD_POOL_BUSY_MASK, 0);
+
+   slock_unlock(pool->run_lock);
+}
@@ -0,0 +1,296 @@
+/* Copyright  (C) 2010-2016 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (rthread_pool_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Checks that every item of a job runs exactly once, also with
+ * two threads issuing jobs at the same time, and that idle threads
+ * steal from a thread stuck on a slow item. Then times an empty
+ * job against waking every thread through its own lock and
+ * condition variable, the way video filters used to.
+ *
+ * Usage: rthread_pool_test [threads] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <unistd.h>
+
+#include <boolean.h>
+#include <features/features_cpu.h>
+#include <retro_atomic.h>
+#include <retro_test.h>
+#include <rthreads/rthreads.h>
+#include <rthreads/rthread_pool.h>
+
+#define TEST_MAX_ITEMS 512
+#define TEST_JOBS      20000
+#define BENCH_JOBS     20000
+
+struct test_job
+{
+   retro_atomic_int_t runs[TEST_MAX_ITEMS];
+   retro_atomic_int_t bad_thread;
+   unsigned threads;
+};
+
+struct test_caller
+{
+   rthread_pool_t *pool;
+   struct test_job job;
+   unsigned seed;
+   unsigned errors;
+};
+
+static void count_item(void *data, unsigned item, unsigned thread)
+{
+   struct test_job *job = (struct test_job*)data;
+
+   retro_atomic_fetch_add(&job->runs[item], 1);
+   if (thread >= job->threads)
+      retro_atomic_store(&job->bad_thread, 1);
+}
+
+/* Runs jobs of random sizes and counts those that went wrong. */
+static void caller_thread(void *data)
+{
+   unsigned i, j;
+   struct test_caller *caller = (struct test_caller*)data;
+
+   caller->job.threads = rthread_pool_threads(caller->pool);
+
+   for (i = 0; i < TEST_JOBS; i++)
+   {
+      unsigned count;
+
+      caller->seed = caller->seed * 1664525 + 1013904223;
+      count        = (caller->seed >> 8) % TEST_MAX_ITEMS;
+
+      memset((void*)caller->job.runs, 0, sizeof(caller->job.runs));
+      rthread_pool_run(caller->pool, count_item, &caller->job, count);
+
+      for (j = 0; j < TEST_MAX_ITEMS; j++)
+      {
+         if (retro_atomic_load(&caller->job.runs[j]) != (j < count))
+         {
+            caller->errors++;
+            break;
+         }
+      }
+   }
+
+   if (retro_atomic_load(&caller->job.bad_thread))
+      caller->errors++;
+}
+
+static void test_items(rthread_pool_t *pool)
+{
+   struct test_caller *a = (struct test_caller*)calloc(1, sizeof(*a));
+   struct test_caller *b = (struct test_caller*)calloc(1, sizeof(*b));
+   sthread_t *thread;
+
+   a->pool = b->pool = pool;
+   a->seed = 1;
+   b->seed = 2;
+
+   caller_thread(a);
+   CHECK(a->errors == 0, "%u of %u jobs went wrong", a->errors, TEST_JOBS);
+
+   a->errors = 0;
+   thread    = sthread_create(caller_thread, b);
+   caller_thread(a);
+   sthread_join(thread);
+   CHECK(a->errors == 0 && b->errors == 0,
+         "%u and %u of %u concurrent jobs went wrong",
+         a->errors, b->errors, TEST_JOBS);
+
+   free(a);
+   free(b);
+}
+
+struct steal_job
+{
+   retro_atomic_int_t ran_on[TEST_MAX_ITEMS];
+};
+
+static void slow_first_item(void *data, unsigned item, unsigned thread)
+{
+   struct steal_job *job = (struct steal_job*)data;
+
+   if (item == 0)
+      usleep(50 * 1000);
+   retro_atomic_store(&job->ran_on[item], (int)thread + 1);
+}
+
+static void test_steal(rthread_pool_t *pool)
+{
+   unsigned i;
+   unsigned stolen  = 0;
+   unsigned threads = rthread_pool_threads(pool);
+   unsigned count   = threads * 8;
+   struct steal_job *job;
+
+   if (threads < 2)
+      return;
+
+   job = (struct steal_job*)calloc(1, sizeof(*job));
+   rthread_pool_run(pool, slow_first_item, job, count);
+
+   /* Whoever took item 0 is stuck on it, the rest of its range
+    * has to go to the others. */
+   for (i = 1; i < count / threads; i++)
+      if (retro_atomic_load(&job->ran_on[i]) !=
+            retro_atomic_load(&job->ran_on[0]))
+         stolen++;
+
+   CHECK(stolen > 0, "no item was stolen from a stuck thread");
+   free(job);
+}
+
+static void empty_item(void *data, unsigned item, unsigned thread)
+{
+   (void)data;
+   (void)item;
+   (void)thread;
+}
+
+/* What filters used before: one lock and condition per thread,
+ * signalled and then waited on in turn. */
+struct cond_worker
+{
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+   bool done;
+   bool die;
+};
+
+static void cond_worker_loop(void *data)
+{
+   struct cond_worker *w = (struct cond_worker*)data;
+
+   for (;;)
+   {
+      slock_lock(w->lock);
+      while (w->done && !w->die)
+         scond_wait(w->cond, w->lock);
+      if (w->die)
+      {
+         slock_unlock(w->lock);
+         break;
+      }
+      slock_unlock(w->lock);
+
+      slock_lock(w->lock);
+      w->done = true;
+      scond_signal(w->cond);
+      slock_unlock(w->lock);
+   }
+}
+
+static double bench_conds(unsigned threads)
+{
+   unsigned i, j;
+   retro_time_t start;
+   struct cond_worker *w = (struct cond_worker*)calloc(threads, sizeof(*w));
+
+   for (i = 0; i < threads; i++)
+   {
+      w[i].lock   = slock_new();
+      w[i].cond   = scond_new();
+      w[i].done   = true;
+      w[i].thread = sthread_create(cond_worker_loop, &w[i]);
+   }
+
+   start = cpu_features_get_time_usec();
+   for (j = 0; j < BENCH_JOBS; j++)
+   {
+      for (i = 0; i < threads; i++)
+      {
+         slock_lock(w[i].lock);
+         w[i].done = false;
+         scond_signal(w[i].cond);
+         slock_unlock(w[i].lock);
+      }
+
+      for (i = 0; i < threads; i++)
+      {
+         slock_lock(w[i].lock);
+         while (!w[i].done)
+            scond_wait(w[i].cond, w[i].lock);
+         slock_unlock(w[i].lock);
+      }
+   }
+   start = cpu_features_get_time_usec() - start;
+
+   for (i = 0; i < threads; i++)
+   {
+      slock_lock(w[i].lock);
+      w[i].die = true;
+      scond_signal(w[i].cond);
+      slock_unlock(w[i].lock);
+      sthread_join(w[i].thread);
+      slock_free(w[i].lock);
+      scond_free(w[i].cond);
+   }
+
+   free(w);
+   return (double)start / BENCH_JOBS;
+}
+
+static double bench_pool(rthread_pool_t *pool)
+{
+   unsigned j;
+   unsigned threads   = rthread_pool_threads(pool);
+   retro_time_t start = cpu_features_get_time_usec();
+
+   for (j = 0; j < BENCH_JOBS; j++)
+      rthread_pool_run(pool, empty_item, NULL, threads * 4);
+
+   return (double)(cpu_features_get_time_usec() - start) / BENCH_JOBS;
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned threads = argc > 1 ? strtoul(argv[1], NULL, 0)
+      : cpu_features_get_core_amount();
+   rthread_pool_t *pool;
+
+   if (threads < 2)
+      threads = 2;
+
+   pool = rthread_pool_new(threads);
+   CHECK(pool && rthread_pool_threads(pool) == threads,
+         "failed to create a pool of %u threads", threads);
+   if (!pool)
+      return 1;
+
+   test_items(pool);
+   test_items(NULL);
+   test_steal(pool);
+
+   printf("%u threads, empty job: pool %.2f us, per-thread condvars %.2f us\n",
+         threads, bench_pool(pool), bench_conds(threads));
+
+   rthread_pool_free(pool);
+
+   return test_result();
+}
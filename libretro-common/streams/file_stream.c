@@ -96,6 +96,27 @@ int filestream_get_fd(RFILE *stream)
    return stream->fd;
 }
 
+/**
+ * filestream_get_mapped:
+ * @stream           : file stream opened with RFILE_HINT_MMAP.
+ * @size             : set to the size of the mapping.
+ *
+ * Returns: the mapped contents of the file, or NULL if
+ * the stream isn't memory-mapped.
+ **/
+const void *filestream_get_mapped(RFILE *stream, size_t *size)
+{
+#ifdef HAVE_MMAP
+   if (stream && stream->mapped && (stream->hints & RFILE_HINT_MMAP))
+   {
+      if (size)
+         *size = (size_t)stream->mapsize;
+      return stream->mapped;
+   }
+#endif
+   return NULL;
+}
+
 RFILE *filestream_open(const char *path, unsigned mode, ssize_t len)
 {
    int            flags = 0;
@@ -207,7 +228,11 @@ RFILE *filestream_open(const char *path, unsigned mode, ssize_t len)
       {
          stream->mappos  = 0;
          stream->mapped  = NULL;
-         stream->mapsize = filestream_seek(stream, 0, SEEK_END);
+         /* filestream_seek() only returns the position once mapped. */
+         if (filestream_seek(stream, 0, SEEK_END) == -1)
+            goto error;
+
+         stream->mapsize = filestream_tell(stream);
 
          if (stream->mapsize == (uint64_t)-1)
             goto error;
@@ -381,8 +406,7 @@ ssize_t filestream_tell(RFILE *stream)
    if (!stream)
       goto error;
 #if  defined(PSP)
-  if (sceIoLseek(stream->fd, 0, SEEK_CUR) < 0)
-     goto error;
+   return sceIoLseek(stream->fd, 0, SEEK_CUR);
 #else
 #if defined(HAVE_BUFFERED_IO)
    if ((stream->hints & RFILE_HINT_UNBUFFERED) == 0)
@@ -394,12 +418,9 @@ ssize_t filestream_tell(RFILE *stream)
    if (stream->mapped && stream->hints & RFILE_HINT_MMAP)
       return stream->mappos;
 #endif
-   if (lseek(stream->fd, 0, SEEK_CUR) < 0)
-      goto error;
+   return lseek(stream->fd, 0, SEEK_CUR);
 #endif
 
-   return 0;
-
 error:
    return -1;
 }
@@ -47,13 +47,19 @@
 
 struct node_iter_ctx
 {
-	libretrodb_t *db;
+	RFILE *fd;
 	libretrodb_index_t *idx;
 };
 
+struct libretrodb_loaded_index;
+
 struct libretrodb
 {
 	RFILE *fd;
+	/* The whole file, if it could be memory-mapped. */
+	const uint8_t *map;
+	size_t map_size;
+	struct libretrodb_loaded_index *indexes;
 	uint64_t root;
 	uint64_t count;
 	uint64_t first_index_offset;
@@ -67,6 +73,17 @@ struct libretrodb_index
 	uint64_t next;
 };
 
+/* An index used by libretrodb_find_entry(), kept until
+ * libretrodb_close(). The entries point into the mapping
+ * if the database is mapped, and are read once otherwise. */
+struct libretrodb_loaded_index
+{
+	libretrodb_index_t header;
+	const uint8_t *entries;
+	void *buff;
+	struct libretrodb_loaded_index *next;
+};
+
 typedef struct libretrodb_metadata
 {
 	uint64_t count;
@@ -82,6 +99,9 @@ struct libretrodb_cursor
 {
 	int is_valid;
    RFILE *fd;
+   /* Read position in the mapping if the database is mapped,
+    * in which case fd is NULL. */
+   const uint8_t *pos;
 	int eof;
 	libretrodb_query_t *query;
 	libretrodb_t *db;
@@ -142,7 +162,7 @@ int libretrodb_create(RFILE *fd, libretrodb_value_provider value_provider,
    struct rmsgpack_dom_value item;
    uint64_t item_count        = 0;
    libretrodb_header_t header = {{0}};
-   ssize_t root = filestream_seek(fd, 0, SEEK_CUR);
+   ssize_t root = filestream_tell(fd);
 
    memcpy(header.magic_number, MAGIC_NUMBER, sizeof(MAGIC_NUMBER)-1);
 
@@ -171,7 +191,7 @@ int libretrodb_create(RFILE *fd, libretrodb_value_provider value_provider,
    if ((rv = rmsgpack_dom_write(fd, &sentinal)) < 0)
       goto clean;
 
-   header.metadata_offset = swap_if_little64(filestream_seek(fd, 0, SEEK_CUR));
+   header.metadata_offset = swap_if_little64(filestream_tell(fd));
    md.count = item_count;
    libretrodb_write_metadata(fd, &md);
    filestream_seek(fd, root, SEEK_SET);
@@ -203,9 +223,20 @@ static void libretrodb_write_index_header(RFILE *fd, libretrodb_index_t *idx)
 
 void libretrodb_close(libretrodb_t *db)
 {
+   while (db->indexes)
+   {
+      struct libretrodb_loaded_index *next = db->indexes->next;
+
+      free(db->indexes->buff);
+      free(db->indexes);
+      db->indexes = next;
+   }
+
    if (db->fd)
       filestream_close(db->fd);
-   db->fd = NULL;
+   db->fd       = NULL;
+   db->map      = NULL;
+   db->map_size = 0;
 }
 
 int libretrodb_open(const char *path, libretrodb_t *db)
@@ -213,13 +244,14 @@ int libretrodb_open(const char *path, libretrodb_t *db)
    libretrodb_header_t header;
    libretrodb_metadata_t md;
    int rv;
-   RFILE *fd = filestream_open(path, RFILE_MODE_READ, -1);
+   RFILE *fd = filestream_open(path,
+         RFILE_MODE_READ | RFILE_HINT_MMAP, -1);
 
    if (!fd)
       return -errno;
 
    strlcpy(db->path, path, sizeof(db->path));
-   db->root = filestream_seek(fd, 0, SEEK_CUR);
+   db->root = filestream_tell(fd);
 
    if ((rv = filestream_read(fd, &header, sizeof(header))) == -1)
    {
@@ -227,7 +259,7 @@ int libretrodb_open(const char *path, libretrodb_t *db)
       goto error;
    }
 
-   if (strncmp(header.magic_number, MAGIC_NUMBER, sizeof(MAGIC_NUMBER)) != 0)
+   if (memcmp(header.magic_number, MAGIC_NUMBER, sizeof(MAGIC_NUMBER) - 1) != 0)
    {
       rv = -EINVAL;
       goto error;
@@ -243,8 +275,10 @@ int libretrodb_open(const char *path, libretrodb_t *db)
    }
 
    db->count = md.count;
-   db->first_index_offset = filestream_seek(fd, 0, SEEK_CUR);
+   db->first_index_offset = filestream_tell(fd);
    db->fd = fd;
+   db->map = (const uint8_t*)filestream_get_mapped(fd, &db->map_size);
+   db->indexes = NULL;
    return 0;
 
 error:
@@ -256,88 +290,152 @@ error:
 static int libretrodb_find_index(libretrodb_t *db, const char *index_name,
       libretrodb_index_t *idx)
 {
-   ssize_t eof    = filestream_seek(db->fd, 0, SEEK_END);
-   ssize_t offset = filestream_seek(db->fd,
-         (ssize_t)db->first_index_offset, SEEK_SET);
+   ssize_t eof, offset;
+
+   filestream_seek(db->fd, 0, SEEK_END);
+   eof    = filestream_tell(db->fd);
+   filestream_seek(db->fd, (ssize_t)db->first_index_offset, SEEK_SET);
+   offset = filestream_tell(db->fd);
 
    while (offset < eof)
    {
-      libretrodb_read_index_header(db->fd, idx);
+      if (libretrodb_read_index_header(db->fd, idx) < 0)
+         return -1;
 
-      if (strncmp(index_name, idx->name, strlen(idx->name)) == 0)
+      if (strcmp(index_name, idx->name) == 0)
          return 0;
 
-      offset = filestream_seek(db->fd, (ssize_t)idx->next, SEEK_CUR);
+      filestream_seek(db->fd, (ssize_t)idx->next, SEEK_CUR);
+      offset = filestream_tell(db->fd);
    }
 
    return -1;
 }
 
+static const struct libretrodb_loaded_index *libretrodb_load_index(
+      libretrodb_t *db, const char *index_name)
+{
+   uint64_t offset;
+   struct libretrodb_loaded_index *loaded = NULL;
+
+   for (loaded = db->indexes; loaded; loaded = loaded->next)
+      if (strcmp(index_name, loaded->header.name) == 0)
+         return loaded;
+
+   loaded = (struct libretrodb_loaded_index*)calloc(1, sizeof(*loaded));
+   if (!loaded)
+      return NULL;
+
+   if (libretrodb_find_index(db, index_name, &loaded->header) < 0)
+      goto error;
+
+   if (  loaded->header.key_size == 0 || loaded->header.key_size > 0xff ||
+         loaded->header.next != 
+         db->count * (loaded->header.key_size + sizeof(uint64_t)))
+      goto error;
+
+   offset = filestream_tell(db->fd);
+
+   if (db->map)
+   {
+      if (offset > db->map_size || loaded->header.next > db->map_size - offset)
+         goto error;
+      loaded->entries = db->map + offset;
+   }
+   else
+   {
+      ssize_t nread   = 0;
+      ssize_t bufflen = (ssize_t)loaded->header.next;
+
+      loaded->buff    = malloc(bufflen ? bufflen : 1);
+      if (!loaded->buff)
+         goto error;
+
+      while (nread < bufflen)
+      {
+         ssize_t rv = filestream_read(db->fd,
+               (uint8_t*)loaded->buff + nread, bufflen - nread);
+
+         if (rv <= 0)
+            goto error;
+         nread += rv;
+      }
+
+      loaded->entries = (const uint8_t*)loaded->buff;
+   }
+
+   loaded->next = db->indexes;
+   db->indexes  = loaded;
+
+   return loaded;
+
+error:
+   free(loaded->buff);
+   free(loaded);
+   return NULL;
+}
+
 static int node_compare(const void *a, const void *b, void *ctx)
 {
    return memcmp(a, b, *(uint8_t *)ctx);
 }
 
-static int binsearch(const void *buff, const void *item,
-      uint64_t count, uint8_t field_size, uint64_t *offset)
+static int binsearch(const uint8_t *entries, const void *key,
+      uint64_t count, uint8_t key_size, uint64_t *offset)
 {
-   int mid            = count / 2;
-   int item_size      = field_size + sizeof(uint64_t);
-   uint64_t *current  = (uint64_t *)buff + (mid * item_size);
-   int rv             = node_compare(current, item, &field_size);
+   uint64_t lo       = 0;
+   uint64_t hi       = count;
+   size_t entry_size = key_size + sizeof(uint64_t);
 
-   if (rv == 0)
+   while (lo < hi)
    {
-      *offset = *(uint64_t *)(current + field_size);
-      return 0;
-   }
+      uint64_t mid         = lo + (hi - lo) / 2;
+      const uint8_t *entry = entries + mid * entry_size;
+      int rv               = memcmp(entry, key, key_size);
 
-   if (count == 0)
-      return -1;
+      if (rv == 0)
+      {
+         memcpy(offset, entry + key_size, sizeof(uint64_t));
+         return 0;
+      }
 
-   if (rv > 0)
-      return binsearch(buff, item, mid, field_size, offset);
+      if (rv < 0)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
 
-   return binsearch(current + item_size, item,
-         count - mid, field_size, offset);
+   return -1;
 }
 
+/* The index is located and loaded by the first lookup and then
+ * kept, so with a mapped database a lookup makes no system
+ * calls and decodes the record straight from the mapping. */
 int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
       const void *key, struct rmsgpack_dom_value *out)
 {
-   libretrodb_index_t idx;
-   int rv;
-   void *buff;
    uint64_t offset;
-   ssize_t bufflen, nread = 0;
+   const struct libretrodb_loaded_index *idx = 
+      libretrodb_load_index(db, index_name);
 
-   if (libretrodb_find_index(db, index_name, &idx) < 0)
+   if (!idx)
       return -1;
 
-   bufflen = idx.next;
-   buff = malloc(bufflen);
-
-   if (!buff)
-      return -ENOMEM;
+   if (binsearch(idx->entries, key, db->count,
+            (uint8_t)idx->header.key_size, &offset) != 0)
+      return -1;
 
-   while (nread < bufflen)
+   if (db->map)
    {
-      void *buff_ = (uint64_t *)buff + nread;
-      rv = filestream_read(db->fd, buff_, bufflen - nread);
+      const uint8_t *pos = db->map + offset;
 
-      if (rv <= 0)
-      {
-         free(buff);
-         return -errno;
-      }
-      nread += rv;
-   }
+      if (offset >= db->map_size)
+         return -EINVAL;
 
-   rv = binsearch(buff, key, db->count, (ssize_t)idx.key_size, &offset);
-   free(buff);
+      return rmsgpack_dom_read_buf(&pos, db->map + db->map_size, out);
+   }
 
-   if (rv == 0)
-      filestream_seek(db->fd, (ssize_t)offset, SEEK_SET);
+   filestream_seek(db->fd, (ssize_t)offset, SEEK_SET);
 
    return rmsgpack_dom_read(db->fd, out);
 }
@@ -353,6 +451,14 @@ int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
 int libretrodb_cursor_reset(libretrodb_cursor_t *cursor)
 {
    cursor->eof = 0;
+
+   if (!cursor->fd)
+   {
+      cursor->pos = cursor->db->map + 
+         cursor->db->root + sizeof(libretrodb_header_t);
+      return 0;
+   }
+
    return filestream_seek(cursor->fd,
          (ssize_t)(cursor->db->root + sizeof(libretrodb_header_t)),
          SEEK_SET);
@@ -367,7 +473,11 @@ int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
       return EOF;
 
 retry:
-   rv = rmsgpack_dom_read(cursor->fd, out);
+   if (cursor->fd)
+      rv = rmsgpack_dom_read(cursor->fd, out);
+   else
+      rv = rmsgpack_dom_read_buf(&cursor->pos,
+            cursor->db->map + cursor->db->map_size, out);
    if (rv < 0)
       return rv;
 
@@ -409,6 +519,7 @@ void libretrodb_cursor_close(libretrodb_cursor_t *cursor)
    cursor->is_valid = 0;
    cursor->eof      = 1;
    cursor->fd       = NULL;
+   cursor->pos      = NULL;
    cursor->db       = NULL;
    cursor->query    = NULL;
 }
@@ -426,10 +537,18 @@ void libretrodb_cursor_close(libretrodb_cursor_t *cursor)
 int libretrodb_cursor_open(libretrodb_t *db, libretrodb_cursor_t *cursor,
       libretrodb_query_t *q)
 {
-   cursor->fd = filestream_open(db->path, RFILE_MODE_READ | RFILE_HINT_MMAP, -1);
+   /* Cursors of a mapped database share its mapping. */
+   cursor->fd  = NULL;
+   cursor->pos = NULL;
 
-   if (!cursor->fd)
-      return -errno;
+   if (!db->map)
+   {
+      cursor->fd = filestream_open(db->path,
+            RFILE_MODE_READ | RFILE_HINT_MMAP, -1);
+
+      if (!cursor->fd)
+         return -errno;
+   }
 
    cursor->db = db;
    cursor->is_valid = 1;
@@ -446,16 +565,18 @@ static int node_iter(void *value, void *ctx)
 {
    struct node_iter_ctx *nictx = (struct node_iter_ctx*)ctx;
 
-   if (filestream_write(nictx->db->fd, value,
+   if (filestream_write(nictx->fd, value,
             (ssize_t)(nictx->idx->key_size + sizeof(uint64_t))) > 0)
       return 0;
 
    return -1;
 }
 
-static uint64_t libretrodb_tell(libretrodb_t *db)
+static uint64_t libretrodb_cursor_tell(libretrodb_cursor_t *cursor)
 {
-   return filestream_seek(db->fd, 0, SEEK_CUR);
+   if (!cursor->fd)
+      return cursor->pos - cursor->db->map;
+   return filestream_tell(cursor->fd);
 }
 
 int libretrodb_create_index(libretrodb_t *db,
@@ -464,16 +585,19 @@ int libretrodb_create_index(libretrodb_t *db,
    struct node_iter_ctx nictx;
    struct rmsgpack_dom_value key;
    libretrodb_index_t idx;
-   uint64_t idx_header_offset;
    struct rmsgpack_dom_value item;
+   char path[sizeof(db->path)];
    libretrodb_cursor_t cur          = {0};
    struct rmsgpack_dom_value *field = NULL;
+   RFILE *fd                        = NULL;
    void *buff                       = NULL;
-   uint64_t *buff_u64               = NULL;
    uint8_t field_size               = 0;
-   uint64_t item_loc                = libretrodb_tell(db);
+   uint64_t item_loc                = 0;
+   int rv                           = -1;
    bintree_t *tree                  = bintree_new(node_compare, &field_size);
 
+   item.type = RDT_NULL;
+
    if (!tree || (libretrodb_cursor_open(db, &cur, NULL) != 0))
       goto clean;
 
@@ -482,7 +606,7 @@ int libretrodb_create_index(libretrodb_t *db,
 
    /* We know we aren't going to change it */
    key.val.string.buff = (char *) field_name;
-   item.type           = RDT_NULL;
+   item_loc            = libretrodb_cursor_tell(&cur);
 
    while (libretrodb_cursor_read_item(&cur, &item) == 0)
    {
@@ -527,10 +651,7 @@ int libretrodb_create_index(libretrodb_t *db,
       }
 
       memcpy(buff, field->val.binary.buff, field_size);
-
-      buff_u64 = (uint64_t *)buff + field_size;
-
-      memcpy(buff_u64, &item_loc, sizeof(uint64_t));
+      memcpy((uint8_t*)buff + field_size, &item_loc, sizeof(uint64_t));
 
       if (bintree_insert(tree, buff) != 0)
       {
@@ -541,23 +662,41 @@ int libretrodb_create_index(libretrodb_t *db,
       }
       buff = NULL;
       rmsgpack_dom_value_free(&item);
-      item_loc = libretrodb_tell(db);
+      item.type = RDT_NULL;
+      item_loc  = libretrodb_cursor_tell(&cur);
    }
 
-   idx_header_offset = filestream_seek(db->fd, 0, SEEK_END);
+   /* Only ever write to the file while nothing has it mapped.
+    * The index is appended through a stream of its own, and the
+    * database reopened afterwards so the mapping covers it. */
+   libretrodb_cursor_close(&cur);
+   strlcpy(path, db->path, sizeof(path));
+   libretrodb_close(db);
+
+   fd = filestream_open(path,
+         RFILE_MODE_READ_WRITE | RFILE_HINT_UNBUFFERED, -1);
+   if (!fd)
+      goto reopen;
 
-   (void)idx_header_offset;
+   filestream_seek(fd, 0, SEEK_END);
 
    strncpy(idx.name, name, 50);
 
    idx.name[49] = '\0';
    idx.key_size = field_size;
    idx.next = db->count * (field_size + sizeof(uint64_t));
-   libretrodb_write_index_header(db->fd, &idx);
+   libretrodb_write_index_header(fd, &idx);
 
-   nictx.db = db;
+   nictx.fd  = fd;
    nictx.idx = &idx;
-   bintree_iterate(tree, node_iter, &nictx);
+   if (bintree_iterate(tree, node_iter, &nictx) == 0)
+      rv = 0;
+
+   filestream_close(fd);
+
+reopen:
+   if (libretrodb_open(path, db) != 0)
+      rv = -1;
 
 clean:
    rmsgpack_dom_value_free(&item);
@@ -568,7 +707,7 @@ clean:
    if (tree)
       bintree_free(tree);
    free(tree);
-   return 0;
+   return rv;
 }
 
 libretrodb_cursor_t *libretrodb_cursor_new(void)
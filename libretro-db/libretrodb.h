@@ -49,6 +49,9 @@ int libretrodb_create(RFILE *fd, libretrodb_value_provider value_provider, void
 
 void libretrodb_close(libretrodb_t *db);
 
+/* Opens the database read-only. With HAVE_MMAP, it is mapped
+ * until libretrodb_close(), so it must not be rewritten in place
+ * while open. */
 int libretrodb_open(const char *path, libretrodb_t *db);
 
 int libretrodb_create_index(libretrodb_t *db, const char *name,
@@ -21,11 +21,129 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include <features/features_cpu.h>
+
 #include "libretrodb.h"
 #include "rmsgpack_dom.h"
 
+/* Times full scans of the database, and lookups through
+ * @index_name of every value of @field_name. */
+static int libretrodb_bench(libretrodb_t *db, const char *index_name,
+      const char *field_name, unsigned iterations)
+{
+   unsigned i;
+   struct rmsgpack_dom_value key, item;
+   retro_time_t start, scan_time, find_time;
+   libretrodb_cursor_t *cur = libretrodb_cursor_new();
+   uint8_t *keys            = NULL;
+   uint32_t key_size        = 0;
+   uint64_t count           = 0;
+   uint64_t records         = 0;
+   uint64_t misses          = 0;
+   int rv                   = 1;
+
+   if (!cur)
+      return 1;
+
+   key.type            = RDT_STRING;
+   key.val.string.len  = strlen(field_name);
+   key.val.string.buff = (char*)field_name;
+
+   start = cpu_features_get_time_usec();
+
+   for (i = 0; i < iterations; i++)
+   {
+      if (libretrodb_cursor_open(db, cur, NULL) != 0)
+         goto end;
+
+      while (libretrodb_cursor_read_item(cur, &item) == 0)
+      {
+         struct rmsgpack_dom_value *field = NULL;
+
+         records++;
+
+         /* Collect the keys to look up on the first pass. */
+         if (i == 0 && (field = rmsgpack_dom_value_map_value(&item, &key))
+               && field->type == RDT_BINARY && field->val.binary.len)
+         {
+            uint8_t *new_keys = NULL;
+
+            if (!key_size)
+               key_size = field->val.binary.len;
+
+            if (field->val.binary.len == key_size && (new_keys = 
+                     (uint8_t*)realloc(keys, (count + 1) * key_size)))
+            {
+               keys = new_keys;
+               memcpy(keys + count * key_size,
+                     field->val.binary.buff, key_size);
+               count++;
+            }
+         }
+
+         rmsgpack_dom_value_free(&item);
+      }
+
+      libretrodb_cursor_close(cur);
+   }
+
+   scan_time = cpu_features_get_time_usec() - start;
+
+   printf("scan: %u x %u records in %.1f ms, %.0f records/s\n",
+         iterations, (unsigned)(records / (iterations ? iterations : 1)),
+         scan_time / 1000.0,
+         scan_time ? records * 1000000.0 / scan_time : 0.0);
+
+   if (!count)
+   {
+      printf("No binary field '%s' to look up.\n", field_name);
+      goto end;
+   }
+
+   start = cpu_features_get_time_usec();
+
+   for (i = 0; i < iterations; i++)
+   {
+      uint64_t j;
+
+      for (j = 0; j < count; j++)
+      {
+         struct rmsgpack_dom_value *field = NULL;
+         const uint8_t *k                 = keys + j * key_size;
+
+         if (libretrodb_find_entry(db, index_name, k, &item) != 0)
+         {
+            misses++;
+            continue;
+         }
+
+         field = rmsgpack_dom_value_map_value(&item, &key);
+         if (!field || field->type != RDT_BINARY ||
+               field->val.binary.len != key_size ||
+               memcmp(field->val.binary.buff, k, key_size))
+            misses++;
+
+         rmsgpack_dom_value_free(&item);
+      }
+   }
+
+   find_time = cpu_features_get_time_usec() - start;
+
+   printf("find: %u x %u lookups in %.1f ms, %.2f us/lookup, %u misses\n",
+         iterations, (unsigned)count, find_time / 1000.0,
+         (double)find_time / (count * iterations), (unsigned)misses);
+
+   rv = misses ? 1 : 0;
+
+end:
+   free(keys);
+   libretrodb_cursor_free(cur);
+   return rv;
+}
+
 int main(int argc, char ** argv)
 {
    int rv;
@@ -42,6 +160,7 @@ int main(int argc, char ** argv)
       printf("\tlist\n");
       printf("\tcreate-index <index name> <field name>\n");
       printf("\tfind <query expression>\n");
+      printf("\tbench <index name> <field name> [iterations]\n");
       return 1;
    }
 
@@ -124,7 +243,22 @@ int main(int argc, char ** argv)
       index_name = argv[3];
       field_name = argv[4];
 
-      libretrodb_create_index(db, index_name, field_name);
+      if (libretrodb_create_index(db, index_name, field_name) != 0)
+      {
+         printf("Could not create index '%s'\n", index_name);
+         goto error;
+      }
+   }
+   else if (!strcmp(command, "bench"))
+   {
+      if (argc != 5 && argc != 6)
+      {
+         printf("Usage: %s <db file> bench <index name> <field name> [iterations]\n", argv[0]);
+         goto error;
+      }
+
+      libretrodb_bench(db, argv[3], argv[4],
+            argc == 6 ? strtoul(argv[5], NULL, 0) : 10);
    }
    else
    {
@@ -396,11 +396,39 @@ error:
    return -errno;
 }
 
-static int read_uint(RFILE *fd, uint64_t *out, size_t size)
+/* Where rmsgpack_read() and rmsgpack_read_buf() decode from. */
+struct rmsgpack_source
+{
+   RFILE *fd;
+   const uint8_t *pos;
+   const uint8_t *end;
+};
+
+static int rmsgpack_read_source(struct rmsgpack_source *src,
+      struct rmsgpack_read_callbacks *callbacks, void *data);
+
+static ssize_t rmsgpack_source_read(struct rmsgpack_source *src,
+      void *s, size_t len)
+{
+   if (src->fd)
+      return filestream_read(src->fd, s, len);
+
+   if ((size_t)(src->end - src->pos) < len)
+   {
+      errno = EINVAL;
+      return -1;
+   }
+
+   memcpy(s, src->pos, len);
+   src->pos += len;
+   return len;
+}
+
+static int read_uint(struct rmsgpack_source *src, uint64_t *out, size_t size)
 {
    uint64_t tmp;
 
-   if (filestream_read(fd, &tmp, size) == -1)
+   if (rmsgpack_source_read(src, &tmp, size) == -1)
       goto error;
 
    switch (size)
@@ -424,14 +452,14 @@ error:
    return -errno;
 }
 
-static int read_int(RFILE *fd, int64_t *out, size_t size)
+static int read_int(struct rmsgpack_source *src, int64_t *out, size_t size)
 {
    uint8_t tmp8 = 0;
    uint16_t tmp16;
    uint32_t tmp32;
    uint64_t tmp64;
 
-   if (filestream_read(fd, &tmp64, size) == -1)
+   if (rmsgpack_source_read(src, &tmp64, size) == -1)
       goto error;
 
    (void)tmp8;
@@ -460,17 +488,17 @@ error:
    return -errno;
 }
 
-static int read_buff(RFILE *fd, size_t size, char **pbuff, uint64_t *len)
+static int read_buff(struct rmsgpack_source *src, size_t size, char **pbuff, uint64_t *len)
 {
    uint64_t tmp_len = 0;
    ssize_t read_len = 0;
 
-   if (read_uint(fd, &tmp_len, size) == -1)
+   if (read_uint(src, &tmp_len, size) == -1)
       return -errno;
 
    *pbuff = (char *)malloc((size_t)(tmp_len + 1) * sizeof(char));
 
-   if ((read_len = filestream_read(fd, *pbuff, (size_t)tmp_len)) == -1)
+   if ((read_len = rmsgpack_source_read(src, *pbuff, (size_t)tmp_len)) == -1)
       goto error;
 
    *len = read_len;
@@ -485,7 +513,7 @@ error:
    return -errno;
 }
 
-static int read_map(RFILE *fd, uint32_t len,
+static int read_map(struct rmsgpack_source *src, uint32_t len,
         struct rmsgpack_read_callbacks *callbacks, void *data)
 {
    int rv;
@@ -497,16 +525,16 @@ static int read_map(RFILE *fd, uint32_t len,
 
    for (i = 0; i < len; i++)
    {
-      if ((rv = rmsgpack_read(fd, callbacks, data)) < 0)
+      if ((rv = rmsgpack_read_source(src, callbacks, data)) < 0)
          return rv;
-      if ((rv = rmsgpack_read(fd, callbacks, data)) < 0)
+      if ((rv = rmsgpack_read_source(src, callbacks, data)) < 0)
          return rv;
    }
 
    return 0;
 }
 
-static int read_array(RFILE *fd, uint32_t len,
+static int read_array(struct rmsgpack_source *src, uint32_t len,
       struct rmsgpack_read_callbacks *callbacks, void *data)
 {
    int rv;
@@ -518,14 +546,14 @@ static int read_array(RFILE *fd, uint32_t len,
 
    for (i = 0; i < len; i++)
    {
-      if ((rv = rmsgpack_read(fd, callbacks, data)) < 0)
+      if ((rv = rmsgpack_read_source(src, callbacks, data)) < 0)
          return rv;
    }
 
    return 0;
 }
 
-int rmsgpack_read(RFILE *fd,
+static int rmsgpack_read_source(struct rmsgpack_source *src,
       struct rmsgpack_read_callbacks *callbacks, void *data)
 {
    int rv;
@@ -535,7 +563,7 @@ int rmsgpack_read(RFILE *fd,
    uint8_t type      = 0;
    char *buff        = NULL;
 
-   if (filestream_read(fd, &type, sizeof(uint8_t)) == -1)
+   if (rmsgpack_source_read(src, &type, sizeof(uint8_t)) == -1)
       goto error;
 
    if (type < MPF_FIXMAP)
@@ -547,12 +575,12 @@ int rmsgpack_read(RFILE *fd,
    else if (type < MPF_FIXARRAY)
    {
       tmp_len = type - MPF_FIXMAP;
-      return read_map(fd, (uint32_t)tmp_len, callbacks, data);
+      return read_map(src, (uint32_t)tmp_len, callbacks, data);
    }
    else if (type < MPF_FIXSTR)
    {
       tmp_len = type - MPF_FIXARRAY;
-      return read_array(fd, (uint32_t)tmp_len, callbacks, data);
+      return read_array(src, (uint32_t)tmp_len, callbacks, data);
    }
    else if (type < MPF_NIL)
    {
@@ -561,7 +589,7 @@ int rmsgpack_read(RFILE *fd,
       buff = (char *)malloc((size_t)(tmp_len + 1) * sizeof(char));
       if (!buff)
          return -ENOMEM;
-      if ((read_len = filestream_read(fd, buff, (ssize_t)tmp_len)) == -1)
+      if ((read_len = rmsgpack_source_read(src, buff, (ssize_t)tmp_len)) == -1)
       {
          free(buff);
          goto error;
@@ -598,7 +626,7 @@ int rmsgpack_read(RFILE *fd,
       case _MPF_BIN8:
       case _MPF_BIN16:
       case _MPF_BIN32:
-         if ((rv = read_buff(fd, 1<<(type - _MPF_BIN8),
+         if ((rv = read_buff(src, 1<<(type - _MPF_BIN8),
                      &buff, &tmp_len)) < 0)
             return rv;
 
@@ -611,7 +639,7 @@ int rmsgpack_read(RFILE *fd,
       case _MPF_UINT64:
          tmp_len  = UINT64_C(1) << (type - _MPF_UINT8);
          tmp_uint = 0;
-         if (read_uint(fd, &tmp_uint, (size_t)tmp_len) == -1)
+         if (read_uint(src, &tmp_uint, (size_t)tmp_len) == -1)
             goto error;
 
          if (callbacks->read_uint)
@@ -623,7 +651,7 @@ int rmsgpack_read(RFILE *fd,
       case _MPF_INT64:
          tmp_len = UINT64_C(1) << (type - _MPF_INT8);
          tmp_int = 0;
-         if (read_int(fd, &tmp_int, (size_t)tmp_len) == -1)
+         if (read_int(src, &tmp_int, (size_t)tmp_len) == -1)
             goto error;
 
          if (callbacks->read_int)
@@ -632,7 +660,7 @@ int rmsgpack_read(RFILE *fd,
       case _MPF_STR8:
       case _MPF_STR16:
       case _MPF_STR32:
-         if ((rv = read_buff(fd, 1<<(type - _MPF_STR8), &buff, &tmp_len)) < 0)
+         if ((rv = read_buff(src, 1<<(type - _MPF_STR8), &buff, &tmp_len)) < 0)
             return rv;
 
          if (callbacks->read_string)
@@ -640,14 +668,14 @@ int rmsgpack_read(RFILE *fd,
          break;
       case _MPF_ARRAY16:
       case _MPF_ARRAY32:
-         if (read_uint(fd, &tmp_len, 2<<(type - _MPF_ARRAY16)) == -1)
+         if (read_uint(src, &tmp_len, 2<<(type - _MPF_ARRAY16)) == -1)
             goto error;
-         return read_array(fd, (uint32_t)tmp_len, callbacks, data);
+         return read_array(src, (uint32_t)tmp_len, callbacks, data);
       case _MPF_MAP16:
       case _MPF_MAP32:
-         if (read_uint(fd, &tmp_len, 2<<(type - _MPF_MAP16)) == -1)
+         if (read_uint(src, &tmp_len, 2<<(type - _MPF_MAP16)) == -1)
             goto error;
-         return read_map(fd, (uint32_t)tmp_len, callbacks, data);
+         return read_map(src, (uint32_t)tmp_len, callbacks, data);
    }
 
    if (buff)
@@ -657,3 +685,31 @@ int rmsgpack_read(RFILE *fd,
 error:
    return -errno;
 }
+
+int rmsgpack_read(RFILE *fd,
+      struct rmsgpack_read_callbacks *callbacks, void *data)
+{
+   struct rmsgpack_source src;
+
+   src.fd  = fd;
+   src.pos = NULL;
+   src.end = NULL;
+
+   return rmsgpack_read_source(&src, callbacks, data);
+}
+
+int rmsgpack_read_buf(const uint8_t **buf, const uint8_t *end,
+      struct rmsgpack_read_callbacks *callbacks, void *data)
+{
+   int rv;
+   struct rmsgpack_source src;
+
+   src.fd  = NULL;
+   src.pos = *buf;
+   src.end = end;
+
+   rv   = rmsgpack_read_source(&src, callbacks, data);
+   *buf = src.pos;
+
+   return rv;
+}
@@ -57,5 +57,10 @@ int rmsgpack_write_uint(RFILE *fd, uint64_t value );
 
 int rmsgpack_read(RFILE *fd, struct rmsgpack_read_callbacks *callbacks, void *data);
 
+/* Decodes one value from memory instead of a file, and
+ * advances @buf past it. Never reads beyond @end. */
+int rmsgpack_read_buf(const uint8_t **buf, const uint8_t *end,
+      struct rmsgpack_read_callbacks *callbacks, void *data);
+
 #endif
 
@@ -426,6 +426,23 @@ int rmsgpack_dom_read(RFILE *fd, struct rmsgpack_dom_value *out)
    return rv;
 }
 
+int rmsgpack_dom_read_buf(const uint8_t **buf, const uint8_t *end,
+      struct rmsgpack_dom_value *out)
+{
+   struct dom_reader_state s;
+   int rv = 0;
+
+   s.i        = 0;
+   s.stack[0] = out;
+
+   rv = rmsgpack_read_buf(buf, end, &dom_reader_callbacks, &s);
+
+   if (rv < 0)
+      rmsgpack_dom_value_free(out);
+
+   return rv;
+}
+
 int rmsgpack_dom_read_into(RFILE *fd, ...)
 {
    va_list ap;
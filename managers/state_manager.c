@@ -16,13 +16,34 @@
  */
 
 #define __STDC_LIMIT_MACROS
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include <retro_inline.h>
 #include <algorithms/mismatch.h>
 
+#ifdef HAVE_CONFIG_H
+#include "../config.h"
+#endif
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#ifdef HAVE_ZLIB
+#include <file/archive_file.h>
+#endif
+
+#ifdef HAVE_MMAP
+#include <memmap.h>
+#include <streams/file_stream.h>
+#endif
+
 #include "state_manager.h"
+#ifndef STATE_MANAGER_TEST
+#include <file/file_path.h>
+
 #include "../configuration.h"
 #include "../msg_hash.h"
 #include "../movie.h"
@@ -31,6 +52,7 @@
 #include "../performance_counters.h"
 #include "../verbosity.h"
 #include "../audio/audio_driver.h"
+#endif
 
 /* This makes Valgrind throw errors if a core overflows its savestate size. */
 /* Keep it off unless you're chasing a core bug, it slows things down. */
@@ -44,6 +66,70 @@
 #define UINT32_MAX 0xffffffffu
 #endif
 
+/* Size of the pieces a savestate is cut into when it is
+ * compressed on the worker pool. Must be a multiple of uint16_t. */
+#define STATE_MANAGER_CHUNK_SIZE (128 * 1024)
+
+#ifdef HAVE_THREADS
+struct state_manager_chunk
+{
+   /* Start of this chunk, in uint16 units from the start of the state. */
+   size_t offset16;
+   size_t num16s;
+   /* Where the patch leaves the output pointer, relative to offset16. */
+   size_t end16;
+   /* Bytes of patch data, excluding the terminator. */
+   size_t size;
+   uint16_t *patch;
+};
+
+struct state_manager_pool
+{
+   sthread_t **threads;
+   unsigned num_threads;
+
+   slock_t *lock;
+   scond_t *cond_work;
+   scond_t *cond_done;
+
+   struct state_manager_chunk *chunks;
+   size_t num_chunks;
+
+   /* The job currently in flight. Both blocks must stay
+    * untouched until state_manager_sync() returns. */
+   const uint16_t *old16;
+   const uint16_t *new16;
+   size_t next_chunk;
+   size_t done_chunks;
+   bool pending;
+   bool quit;
+};
+#endif
+
+/* A run of the oldest frames, moved out of the main buffer. */
+struct state_manager_block
+{
+   /* Compressed data, for blocks kept in RAM. */
+   uint8_t *data;
+   /* Position in the spill file, for blocks kept on disk. */
+   size_t offset;
+   size_t size;
+   /* Size of the frames once decompressed. */
+   size_t raw_size;
+   unsigned entries;
+};
+
+/* Blocks are ordered from oldest to newest. */
+struct state_manager_store
+{
+   struct state_manager_block *blocks;
+   size_t count;
+   size_t allocated;
+   size_t bytes;
+   size_t limit;
+   unsigned entries;
+};
+
 struct state_manager
 {
    uint8_t *data;
@@ -66,6 +152,24 @@ struct state_manager
 
    unsigned entries;
    bool thisblock_valid;
+#ifdef HAVE_THREADS
+   /* If non-NULL, deltas are generated chunk by chunk on
+    * worker threads and committed to the buffer lazily. */
+   struct state_manager_pool *pool;
+#endif
+
+   /* Instead of discarding the oldest frames, move them in
+    * blocks of about tier_block_size to the compressed tier,
+    * and from there to the spill file. */
+   bool tiered;
+   size_t tier_block_size;
+   struct state_manager_store tiers[STATE_MANAGER_TIER_LAST - 1];
+#ifdef HAVE_MMAP
+   RFILE *spill_file;
+   uint8_t *spill_map;
+   size_t spill_head;
+   char *spill_path;
+#endif
 #if STRICT_BUF_SIZE
    size_t debugsize;
    uint8_t *debugblock;
@@ -92,6 +196,7 @@ repeat {
 size thisstart;
 #endif
 
+#ifndef STATE_MANAGER_TEST
 struct state_manager_rewind_state
 {
    /* Rewind support. */
@@ -101,6 +206,7 @@ struct state_manager_rewind_state
 
 static struct state_manager_rewind_state rewind_state;
 static bool frame_is_reversed;
+#endif
 
 /* Returns the maximum compressed size of a savestate. 
  * It is very likely to compress to far less. */
@@ -123,7 +229,7 @@ static size_t state_manager_raw_maxsize(size_t uncomp)
 static void *state_manager_raw_alloc(size_t len, uint16_t uniq)
 {
    size_t  len16 = (len + sizeof(uint16_t) - 1) & -sizeof(uint16_t);
-   uint16_t *ret = (uint16_t*)calloc(len16 + sizeof(uint16_t) * 4 + 16, 1);
+   uint16_t *ret = (uint16_t*)calloc(len16 + sizeof(uint16_t) * 4 + 64, 1);
 
    /* Force in a different byte at the end, so we don't need to check 
     * bounds in the innermost loop (it's expensive).
@@ -133,8 +239,9 @@ static void *state_manager_raw_alloc(size_t len, uint16_t uniq)
     *
     * There is also some padding at the end. This is so we don't 
     * read outside the buffer end if we're reading in large blocks;
+    * the AVX-512 scanners read 64 bytes at a time.
     *
-    * It doesn't make any difference to us, but sacrificing 16 bytes to get 
+    * It doesn't make any difference to us, but sacrificing 64 bytes to get 
     * Valgrind happy is worth it. */
    ret[len16/sizeof(uint16_t) + 3] = uniq;
 
@@ -208,6 +315,121 @@ static size_t state_manager_raw_compress(const void *src,
    return (uint8_t*)(compressed16+3) - (uint8_t*)patch;
 }
 
+#ifdef HAVE_THREADS
+/*
+ * Like state_manager_raw_compress, but only looks at 'num16s' words
+ * starting at 'src'/'dst', which may point into the middle of two blocks
+ * returned from state_manager_raw_alloc().
+ *
+ * No terminator is written, and the output pointer of the decompressor
+ * is left at '*end16' words from the start of the chunk, so chunks can
+ * be concatenated into a regular patch by state_manager_chunk_stitch().
+ *
+ * 'patch' must be size 'state_manager_raw_maxsize(num16s * 2)' or more.
+ * Returns the number of bytes actually written to 'patch'.
+ */
+static size_t state_manager_chunk_compress(const uint16_t *old16,
+      const uint16_t *new16, size_t num16s, uint16_t *patch,
+      size_t *end16)
+{
+   uint16_t *compressed16 = patch;
+   const uint16_t *org16  = old16;
+
+   /* find_change doesn't know about chunk boundaries and only stops
+    * at the guard words at the end of the whole block. Trim the
+    * unchanged tail first so it can't run off into the next chunk
+    * looking for a change that isn't there. find_same is told where
+    * the chunk ends. */
+   while (num16s >= 32 && !memcmp(old16 + num16s - 32,
+            new16 + num16s - 32, 32 * sizeof(uint16_t)))
+      num16s -= 32;
+   while (num16s && old16[num16s - 1] == new16[num16s - 1])
+      num16s--;
+
+   while (num16s)
+   {
+      size_t i, changed;
+      size_t skip = find_change(old16, new16);
+
+      if (skip >= num16s)
+         break;
+
+      old16  += skip;
+      new16  += skip;
+      num16s -= skip;
+
+      if (skip > UINT16_MAX)
+      {
+         *compressed16++ = 0;
+         *compressed16++ = skip;
+         *compressed16++ = skip >> 16;
+         continue;
+      }
+
+      changed = find_same_limit(old16, new16, num16s);
+      if (changed > UINT16_MAX)
+         changed = UINT16_MAX;
+
+      *compressed16++ = changed;
+      *compressed16++ = skip;
+
+      for (i = 0; i < changed; i++)
+         compressed16[i] = old16[i];
+
+      old16 += changed;
+      new16 += changed;
+      num16s -= changed;
+      compressed16 += changed;
+   }
+
+   *end16 = old16 - org16;
+
+   return (uint8_t*)compressed16 - (uint8_t*)patch;
+}
+
+/*
+ * Concatenates the chunk patches of the last job into a regular
+ * patch, as produced by state_manager_raw_compress.
+ *
+ * Returns the number of bytes actually written to 'patch'.
+ */
+static size_t state_manager_chunk_stitch(
+      const struct state_manager_pool *pool, void *patch)
+{
+   size_t i;
+   size_t pos16           = 0;
+   uint16_t *compressed16 = (uint16_t*)patch;
+
+   for (i = 0; i < pool->num_chunks; i++)
+   {
+      const struct state_manager_chunk *chunk = &pool->chunks[i];
+      size_t skip = chunk->offset16 - pos16;
+
+      if (!chunk->size)
+         continue;
+
+      while (skip)
+      {
+         size_t part = skip > UINT32_MAX ? UINT32_MAX : skip;
+         *compressed16++ = 0;
+         *compressed16++ = part;
+         *compressed16++ = part >> 16;
+         skip           -= part;
+      }
+
+      memcpy(compressed16, chunk->patch, chunk->size);
+      compressed16 += chunk->size / sizeof(uint16_t);
+      pos16         = chunk->offset16 + chunk->end16;
+   }
+
+   compressed16[0] = 0;
+   compressed16[1] = 0;
+   compressed16[2] = 0;
+
+   return (uint8_t*)(compressed16+3) - (uint8_t*)patch;
+}
+#endif
+
 /*
  * Takes 'patch' from a previous call to 'state_manager_raw_compress' 
  * and applies it to 'data' ('src' from that call), 
@@ -294,11 +516,672 @@ static INLINE size_t read_size_t(const void *ptr)
    return ret;
 }
 
-static void state_manager_free(state_manager_t *state)
+#ifdef HAVE_THREADS
+static void state_manager_pool_thread(void *data)
+{
+   struct state_manager_pool *pool = (struct state_manager_pool*)data;
+
+   slock_lock(pool->lock);
+
+   for (;;)
+   {
+      struct state_manager_chunk *chunk = NULL;
+
+      while (!pool->quit && pool->next_chunk >= pool->num_chunks)
+         scond_wait(pool->cond_work, pool->lock);
+
+      if (pool->quit)
+         break;
+
+      chunk = &pool->chunks[pool->next_chunk++];
+
+      slock_unlock(pool->lock);
+
+      chunk->size = state_manager_chunk_compress(
+            pool->old16 + chunk->offset16,
+            pool->new16 + chunk->offset16,
+            chunk->num16s, chunk->patch, &chunk->end16);
+
+      slock_lock(pool->lock);
+
+      if (++pool->done_chunks == pool->num_chunks)
+         scond_signal(pool->cond_done);
+   }
+
+   slock_unlock(pool->lock);
+}
+
+static void state_manager_pool_free(struct state_manager_pool *pool)
+{
+   size_t i;
+
+   if (!pool)
+      return;
+
+   if (pool->threads)
+   {
+      slock_lock(pool->lock);
+      pool->quit = true;
+      scond_broadcast(pool->cond_work);
+      slock_unlock(pool->lock);
+
+      for (i = 0; i < pool->num_threads; i++)
+      {
+         if (pool->threads[i])
+            sthread_join(pool->threads[i]);
+      }
+      free(pool->threads);
+   }
+
+   if (pool->chunks)
+   {
+      for (i = 0; i < pool->num_chunks; i++)
+         free(pool->chunks[i].patch);
+      free(pool->chunks);
+   }
+
+   if (pool->cond_done)
+      scond_free(pool->cond_done);
+   if (pool->cond_work)
+      scond_free(pool->cond_work);
+   if (pool->lock)
+      slock_free(pool->lock);
+   free(pool);
+}
+
+static struct state_manager_pool *state_manager_pool_new(
+      size_t blocksize, unsigned num_threads)
+{
+   size_t i;
+   const size_t chunk16s           = STATE_MANAGER_CHUNK_SIZE / sizeof(uint16_t);
+   size_t num16s                   = blocksize / sizeof(uint16_t);
+   struct state_manager_pool *pool = (struct state_manager_pool*)
+      calloc(1, sizeof(*pool));
+
+   if (!pool)
+      return NULL;
+
+   pool->num_chunks = (num16s + chunk16s - 1) / chunk16s;
+   pool->next_chunk = pool->num_chunks;
+   pool->chunks     = (struct state_manager_chunk*)
+      calloc(pool->num_chunks, sizeof(*pool->chunks));
+   pool->lock       = slock_new();
+   pool->cond_work  = scond_new();
+   pool->cond_done  = scond_new();
+
+   if (!pool->chunks || !pool->lock || !pool->cond_work || !pool->cond_done)
+      goto error;
+
+   for (i = 0; i < pool->num_chunks; i++)
+   {
+      struct state_manager_chunk *chunk = &pool->chunks[i];
+
+      chunk->offset16 = i * chunk16s;
+      chunk->num16s   = num16s - chunk->offset16;
+      if (chunk->num16s > chunk16s)
+         chunk->num16s = chunk16s;
+
+      chunk->patch    = (uint16_t*)malloc(
+            state_manager_raw_maxsize(chunk->num16s * sizeof(uint16_t)));
+      if (!chunk->patch)
+         goto error;
+   }
+
+   pool->threads = (sthread_t**)calloc(num_threads, sizeof(*pool->threads));
+   if (!pool->threads)
+      goto error;
+
+   for (i = 0; i < num_threads; i++)
+   {
+      pool->threads[i] = sthread_create(state_manager_pool_thread, pool);
+      if (!pool->threads[i])
+         goto error;
+      pool->num_threads++;
+   }
+
+   return pool;
+
+error:
+   state_manager_pool_free(pool);
+   return NULL;
+}
+
+/* The worst case for a stitched patch: every chunk at its
+ * own worst case, plus a skip in front of each of them. */
+static size_t state_manager_pool_maxsize(
+      const struct state_manager_pool *pool)
+{
+   size_t i;
+   size_t ret = sizeof(uint16_t) * 3;
+
+   for (i = 0; i < pool->num_chunks; i++)
+      ret += state_manager_raw_maxsize(
+            pool->chunks[i].num16s * sizeof(uint16_t))
+         + sizeof(uint16_t) * 3;
+
+   return ret;
+}
+
+static void state_manager_pool_submit(struct state_manager_pool *pool,
+      const uint8_t *oldb, const uint8_t *newb)
+{
+   slock_lock(pool->lock);
+   pool->old16       = (const uint16_t*)oldb;
+   pool->new16       = (const uint16_t*)newb;
+   pool->next_chunk  = 0;
+   pool->done_chunks = 0;
+   pool->pending     = true;
+   scond_broadcast(pool->cond_work);
+   slock_unlock(pool->lock);
+}
+
+/* Returns true if a job was in flight; its chunks are ready afterwards. */
+static bool state_manager_pool_wait(struct state_manager_pool *pool)
+{
+   if (!pool->pending)
+      return false;
+
+   slock_lock(pool->lock);
+   while (pool->done_chunks < pool->num_chunks)
+      scond_wait(pool->cond_done, pool->lock);
+   slock_unlock(pool->lock);
+
+   pool->pending = false;
+   return true;
+}
+#endif
+
+static bool state_manager_tier_evict(state_manager_t *state);
+static void state_manager_tier_clear(state_manager_t *state);
+
+/* Discards the oldest frame in the main buffer. Whatever the lower
+ * tiers hold is older still and can no longer be reached. */
+static void state_manager_drop_tail(state_manager_t *state)
+{
+   state->tail = state->data + read_size_t(state->tail);
+   state->entries--;
+
+   if (state->tiered)
+      state_manager_tier_clear(state);
+}
+
+/* Discards the oldest frames until a frame of maxcompsize fits at head.
+ * Returns where the patch should be written. */
+static uint8_t *state_manager_reserve(state_manager_t *state)
+{
+   for (;;)
+   {
+      size_t headpos   = state->head - state->data;
+      size_t tailpos   = state->tail - state->data;
+      size_t remaining = (tailpos + state->capacity -
+            sizeof(size_t) - headpos - 1) % state->capacity + 1;
+
+      if (remaining > state->maxcompsize)
+         break;
+
+      if (state->tiered && state_manager_tier_evict(state))
+         continue;
+
+      state_manager_drop_tail(state);
+   }
+
+   return state->head + sizeof(size_t);
+}
+
+/* Links the patch that ends at 'compressed' into the buffer. */
+static void state_manager_commit(state_manager_t *state, uint8_t *compressed)
+{
+   if (compressed - state->data + state->maxcompsize > state->capacity)
+   {
+      compressed = state->data;
+      if (state->tail == state->data + sizeof(size_t)
+            && !(state->tiered && state_manager_tier_evict(state)))
+         state_manager_drop_tail(state);
+   }
+   write_size_t(compressed, state->head-state->data);
+   compressed += sizeof(size_t);
+   write_size_t(state->head, compressed-state->data);
+   state->head = compressed;
+}
+
+/* Returns the size of a patch from state_manager_raw_compress,
+ * including its terminator. */
+static size_t state_manager_patch_size(const uint8_t *patch)
+{
+   const uint16_t *patch16 = (const uint16_t*)patch;
+
+   for (;;)
+   {
+      uint16_t numchanged = *(patch16++);
+
+      if (numchanged)
+         patch16 += numchanged + 1;
+      else
+      {
+         uint32_t numunchanged = patch16[0] | (patch16[1] << 16);
+
+         patch16 += 2;
+         if (!numunchanged)
+            break;
+      }
+   }
+
+   return (const uint8_t*)patch16 - patch;
+}
+
+static bool state_manager_tier_push(struct state_manager_store *tier,
+      const struct state_manager_block *block)
+{
+   if (tier->count == tier->allocated)
+   {
+      size_t allocated = tier->allocated ? tier->allocated * 2 : 16;
+      struct state_manager_block *blocks = (struct state_manager_block*)
+         realloc(tier->blocks, allocated * sizeof(*blocks));
+
+      if (!blocks)
+         return false;
+
+      tier->blocks    = blocks;
+      tier->allocated = allocated;
+   }
+
+   tier->blocks[tier->count++] = *block;
+   tier->bytes   += block->size;
+   tier->entries += block->entries;
+   return true;
+}
+
+static void state_manager_tier_remove(struct state_manager_store *tier,
+      size_t idx, struct state_manager_block *block)
+{
+   *block = tier->blocks[idx];
+   memmove(tier->blocks + idx, tier->blocks + idx + 1,
+         (tier->count - idx - 1) * sizeof(*block));
+   tier->count--;
+   tier->bytes   -= block->size;
+   tier->entries -= block->entries;
+}
+
+/* Drops every block. Needed whenever a block gets lost, since
+ * the frames in older blocks can then no longer be reached. */
+static void state_manager_tier_clear(state_manager_t *state)
+{
+   size_t i, j;
+
+   for (i = 0; i < STATE_MANAGER_TIER_LAST - 1; i++)
+   {
+      struct state_manager_store *tier = &state->tiers[i];
+
+      for (j = 0; j < tier->count; j++)
+         free(tier->blocks[j].data);
+
+      tier->count   = 0;
+      tier->bytes   = 0;
+      tier->entries = 0;
+   }
+}
+
+#ifdef HAVE_ZLIB
+static uint8_t *state_manager_deflate(const uint8_t *in,
+      size_t in_size, size_t *out_size)
+{
+   const struct file_archive_file_backend *backend =
+      file_archive_get_default_file_backend();
+   size_t bound  = in_size + (in_size >> 8) + 64;
+   uint8_t *out  = (uint8_t*)malloc(bound);
+   void *stream  = backend->stream_new();
+   bool ok       = false;
+
+   if (out && stream)
+   {
+      backend->stream_set(stream, in_size, bound, in, out);
+      /* These are written once and usually never read again,
+       * so favour speed. */
+      backend->stream_compress_init(stream, 1);
+      ok = backend->stream_compress_data_to_file(stream) == 1;
+      *out_size = backend->stream_get_total_out(stream);
+      backend->stream_compress_free(stream);
+   }
+
+   free(stream);
+
+   if (!ok)
+   {
+      free(out);
+      return NULL;
+   }
+
+   return out;
+}
+
+static bool state_manager_inflate(const uint8_t *in,
+      size_t in_size, uint8_t *out, size_t out_size)
+{
+   const struct file_archive_file_backend *backend =
+      file_archive_get_default_file_backend();
+   void *stream = backend->stream_new();
+   bool ok      = false;
+
+   if (!stream)
+      return false;
+
+   if (backend->stream_decompress_init(stream))
+   {
+      backend->stream_set(stream, in_size, out_size, in, out);
+      ok = backend->stream_decompress_data_to_file_iterate(stream) == 1;
+   }
+
+   backend->stream_free(stream);
+   free(stream);
+   return ok;
+}
+#endif
+
+#ifdef HAVE_MMAP
+static bool state_manager_spill_open(state_manager_t *state,
+      const char *path, size_t size)
+{
+   bool grown;
+   RFILE *file = filestream_open(path, RFILE_MODE_WRITE, -1);
+
+   if (!file)
+      return false;
+
+   /* Set first, so that spill_close() removes the file again. */
+   state->spill_path = strdup(path);
+
+   /* Grow the file to its full size. */
+   grown = filestream_seek(file, size - 1, SEEK_SET) >= 0
+      && filestream_write(file, "", 1) == 1;
+
+   if (filestream_close(file) != 0 || !grown || !state->spill_path)
+      return false;
+
+   state->spill_file = filestream_open(path,
+         RFILE_MODE_READ_WRITE | RFILE_HINT_UNBUFFERED, -1);
+
+   if (!state->spill_file)
+      return false;
+
+   state->spill_map = (uint8_t*)mmap(NULL, size, PROT_READ | PROT_WRITE,
+         MAP_SHARED, filestream_get_fd(state->spill_file), 0);
+
+   if (state->spill_map == MAP_FAILED)
+   {
+      state->spill_map = NULL;
+      return false;
+   }
+
+   state->tiers[STATE_MANAGER_TIER_DISK - 1].limit = size;
+   return true;
+}
+
+static void state_manager_spill_close(state_manager_t *state)
+{
+   if (state->spill_map)
+      munmap(state->spill_map,
+            state->tiers[STATE_MANAGER_TIER_DISK - 1].limit);
+   if (state->spill_file)
+      filestream_close(state->spill_file);
+   if (state->spill_path)
+      remove(state->spill_path);
+   free(state->spill_path);
+
+   state->spill_map  = NULL;
+   state->spill_file = NULL;
+   state->spill_path = NULL;
+}
+
+/* The spill file is used as a ring of blocks. Only the oldest
+ * blocks are ever discarded, so what's left is always contiguous. */
+static bool state_manager_spill(state_manager_t *state,
+      const struct state_manager_block *block)
+{
+   struct state_manager_block spilled;
+   struct state_manager_store *disk = &state->tiers[STATE_MANAGER_TIER_DISK - 1];
+   size_t pos                      = state->spill_head;
+
+   if (!state->spill_map || block->size > disk->limit)
+      return false;
+
+   if (pos + block->size > disk->limit)
+      pos = 0;
+
+   for (;;)
+   {
+      size_t i;
+      bool overlap = false;
+
+      for (i = 0; i < disk->count && !overlap; i++)
+         overlap = disk->blocks[i].offset < pos + block->size
+            && pos < disk->blocks[i].offset + disk->blocks[i].size;
+
+      if (!overlap)
+         break;
+
+      state_manager_tier_remove(disk, 0, &spilled);
+   }
+
+   spilled        = *block;
+   spilled.data   = NULL;
+   spilled.offset = pos;
+
+   if (!state_manager_tier_push(disk, &spilled))
+      return false;
+
+   memcpy(state->spill_map + pos, block->data, block->size);
+   state->spill_head = pos + block->size;
+   return true;
+}
+#endif
+
+/* Moves the oldest compressed blocks to disk, or discards them,
+ * until the compressed tier fits in its limit again. */
+static void state_manager_tier_balance(state_manager_t *state)
+{
+   struct state_manager_store *ram = &state->tiers[STATE_MANAGER_TIER_COMPRESSED - 1];
+
+   while (ram->count && ram->bytes > ram->limit)
+   {
+      struct state_manager_block block;
+
+      state_manager_tier_remove(ram, 0, &block);
+#ifdef HAVE_MMAP
+      if (!state_manager_spill(state, &block))
+#endif
+      {
+         /* Anything older can't be reached anymore. */
+         struct state_manager_store *disk = &state->tiers[STATE_MANAGER_TIER_DISK - 1];
+         disk->count   = 0;
+         disk->bytes   = 0;
+         disk->entries = 0;
+      }
+      free(block.data);
+   }
+}
+
+/* Moves a block of the oldest frames out of the main buffer.
+ * Each one is stored as its size followed by its patch.
+ * The main buffer is left untouched if that fails. */
+static bool state_manager_tier_evict(state_manager_t *state)
+{
+   struct state_manager_block block;
+   uint8_t *raw, *out, *cur;
+   uint8_t *pos      = state->tail;
+   size_t   raw_size = 0;
+   unsigned entries  = 0;
+
+   while (pos != state->head && raw_size < state->tier_block_size)
+   {
+      raw_size += sizeof(size_t)
+         + state_manager_patch_size(pos + sizeof(size_t));
+      pos       = state->data + read_size_t(pos);
+      entries++;
+   }
+
+   if (!entries || !(raw = (uint8_t*)malloc(raw_size)))
+      return false;
+
+   for (out = raw, cur = state->tail; cur != pos; )
+   {
+      const uint8_t *patch = cur + sizeof(size_t);
+      size_t len           = state_manager_patch_size(patch);
+
+      write_size_t(out, len);
+      memcpy(out + sizeof(size_t), patch, len);
+      out += sizeof(size_t) + len;
+
+      cur = state->data + read_size_t(cur);
+   }
+
+   memset(&block, 0, sizeof(block));
+   block.raw_size = raw_size;
+   block.entries  = entries;
+#ifdef HAVE_ZLIB
+   block.data     = state_manager_deflate(raw, raw_size, &block.size);
+   free(raw);
+#else
+   block.data     = raw;
+   block.size     = raw_size;
+#endif
+
+   if (!block.data || !state_manager_tier_push(
+            &state->tiers[STATE_MANAGER_TIER_COMPRESSED - 1], &block))
+   {
+      free(block.data);
+      return false;
+   }
+
+   state->tail     = pos;
+   state->entries -= entries;
+
+   state_manager_tier_balance(state);
+   return true;
+}
+
+/* Moves the newest block from the lower tiers back into the
+ * (empty) main buffer. */
+static bool state_manager_tier_restore(state_manager_t *state)
 {
+   struct state_manager_block block;
+   const uint8_t *in;
+   uint8_t *raw;
+   size_t pos;
+   struct state_manager_store *ram  = &state->tiers[STATE_MANAGER_TIER_COMPRESSED - 1];
+   struct state_manager_store *disk = &state->tiers[STATE_MANAGER_TIER_DISK - 1];
+
+   if (ram->count)
+   {
+      state_manager_tier_remove(ram, ram->count - 1, &block);
+      in = block.data;
+   }
+#ifdef HAVE_MMAP
+   else if (disk->count)
+   {
+      state_manager_tier_remove(disk, disk->count - 1, &block);
+      in                = state->spill_map + block.offset;
+      state->spill_head = block.offset;
+   }
+#endif
+   else
+      return false;
+
+   (void)disk;
+
+   raw = (uint8_t*)malloc(block.raw_size);
+
+#ifdef HAVE_ZLIB
+   if (!raw || !state_manager_inflate(in, block.size, raw, block.raw_size))
+#else
+   if (!raw)
+#endif
+   {
+      free(raw);
+      free(block.data);
+      state_manager_tier_clear(state);
+      return false;
+   }
+
+#ifndef HAVE_ZLIB
+   memcpy(raw, in, block.raw_size);
+#endif
+   free(block.data);
+
+   for (pos = 0; pos < block.raw_size; )
+   {
+      size_t len          = read_size_t(raw + pos);
+      uint8_t *compressed = state_manager_reserve(state);
+
+      memcpy(compressed, raw + pos + sizeof(size_t), len);
+      state_manager_commit(state, compressed + len);
+      state->entries++;
+
+      pos += sizeof(size_t) + len;
+   }
+
+   free(raw);
+   return true;
+}
+
+bool state_manager_enable_tiers(state_manager_t *state,
+      size_t compressed_size, const char *spill_path, size_t spill_size)
+{
+   /* Evicted blocks must fit back into an empty buffer,
+    * with room to spare for wrapping around. */
+   if (state->capacity < state->maxcompsize * 8)
+      return false;
+
+   state->tiered          = true;
+   state->tier_block_size = state->capacity / 4;
+   state->tiers[STATE_MANAGER_TIER_COMPRESSED - 1].limit = compressed_size;
+
+   if (!spill_path || !spill_size)
+      return true;
+
+#ifdef HAVE_MMAP
+   if (state_manager_spill_open(state, spill_path, spill_size))
+      return true;
+   state_manager_spill_close(state);
+#endif
+   return false;
+}
+
+void state_manager_get_tier_stats(const state_manager_t *state,
+      enum state_manager_tier tier, unsigned *entries, size_t *bytes)
+{
+   if (tier == STATE_MANAGER_TIER_RAW)
+   {
+      size_t headpos   = state->head - state->data;
+      size_t tailpos   = state->tail - state->data;
+      size_t remaining = (tailpos + state->capacity -
+            sizeof(size_t) - headpos - 1) % state->capacity + 1;
+
+      *entries = state->entries;
+      *bytes   = state->capacity - remaining;
+      return;
+   }
+
+   *entries = state->tiers[tier - 1].entries;
+   *bytes   = state->tiers[tier - 1].bytes;
+}
+
+void state_manager_free(state_manager_t *state)
+{
+   size_t i;
+
    if (!state)
       return;
 
+   state_manager_tier_clear(state);
+   for (i = 0; i < STATE_MANAGER_TIER_LAST - 1; i++)
+      free(state->tiers[i].blocks);
+#ifdef HAVE_MMAP
+   state_manager_spill_close(state);
+#endif
+
+#ifdef HAVE_THREADS
+   state_manager_pool_free(state->pool);
+#endif
    free(state->data);
    free(state->thisblock);
    free(state->nextblock);
@@ -308,7 +1191,8 @@ static void state_manager_free(state_manager_t *state)
    free(state);
 }
 
-static state_manager_t *state_manager_new(size_t state_size, size_t buffer_size)
+state_manager_t *state_manager_new(size_t state_size, size_t buffer_size,
+      unsigned num_threads)
 {
    state_manager_t *state = (state_manager_t*)calloc(1, sizeof(*state));
 
@@ -329,6 +1213,19 @@ static state_manager_t *state_manager_new(size_t state_size, size_t buffer_size)
    if (!state->thisblock || !state->nextblock)
       goto error;
 
+#ifdef HAVE_THREADS
+   if (num_threads)
+   {
+      state->pool = state_manager_pool_new(state->blocksize, num_threads);
+      if (!state->pool)
+         goto error;
+      state->maxcompsize = state_manager_pool_maxsize(state->pool)
+         + sizeof(size_t) * 2;
+   }
+#else
+   (void)num_threads;
+#endif
+
    state->capacity = buffer_size;
 
    state->head = state->data + sizeof(size_t);
@@ -347,7 +1244,22 @@ error:
    return NULL;
 }
 
-static bool state_manager_pop(state_manager_t *state, const void **data)
+/* Waits for the delta generated by the worker threads, if any,
+ * and adds it to the buffer. Both blocks are free to use afterwards. */
+static void state_manager_sync(state_manager_t *state)
+{
+#ifdef HAVE_THREADS
+   if (state->pool && state_manager_pool_wait(state->pool))
+   {
+      uint8_t *compressed = state_manager_reserve(state);
+
+      compressed += state_manager_chunk_stitch(state->pool, compressed);
+      state_manager_commit(state, compressed);
+   }
+#endif
+}
+
+bool state_manager_pop(state_manager_t *state, const void **data)
 {
    size_t start;
    uint8_t *out                 = NULL;
@@ -355,6 +1267,8 @@ static bool state_manager_pop(state_manager_t *state, const void **data)
 
    *data = NULL;
 
+   state_manager_sync(state);
+
    if (state->thisblock_valid)
    {
       state->thisblock_valid = false;
@@ -364,7 +1278,10 @@ static bool state_manager_pop(state_manager_t *state, const void **data)
    }
 
    if (state->head == state->tail)
-      return false;
+   {
+      if (!state->tiered || !state_manager_tier_restore(state))
+         return false;
+   }
 
    start = read_size_t(state->head - sizeof(size_t));
    state->head = state->data + start;
@@ -380,8 +1297,10 @@ static bool state_manager_pop(state_manager_t *state, const void **data)
    return true;
 }
 
-static void state_manager_push_where(state_manager_t *state, void **data)
+void state_manager_push_where(state_manager_t *state, void **data)
 {
+   state_manager_sync(state);
+
    /* We need to ensure we have an uncompressed copy of the last
     * pushed state, or we could end up applying a 'patch' to wrong 
     * savestate, and that'd blow up rather quickly. */
@@ -402,59 +1321,36 @@ static void state_manager_push_where(state_manager_t *state, void **data)
 #endif
 }
 
-static void state_manager_push_do(state_manager_t *state)
+void state_manager_push_do(state_manager_t *state)
 {
+   uint8_t *swap = NULL;
+
 #if STRICT_BUF_SIZE
    memcpy(state->nextblock, state->debugblock, state->debugsize);
 #endif
 
-   static struct retro_perf_counter gen_deltas = {0};
-   uint8_t *swap = NULL;
-
    if (state->thisblock_valid)
    {
-      const uint8_t *oldb, *newb;
-      uint8_t *compressed;
-      size_t headpos, tailpos, remaining;
       if (state->capacity < sizeof(size_t) + state->maxcompsize)
          return;
 
-recheckcapacity:;
-
-      headpos = state->head - state->data;
-      tailpos = state->tail - state->data;
-      remaining = (tailpos + state->capacity -
-            sizeof(size_t) - headpos - 1) % state->capacity + 1;
-
-      if (remaining <= state->maxcompsize)
+#ifdef HAVE_THREADS
+      if (state->pool)
       {
-         state->tail = state->data + read_size_t(state->tail);
-         state->entries--;
-         goto recheckcapacity;
+         /* The delta is picked up by the next push or pop. */
+         state_manager_pool_submit(state->pool,
+               state->thisblock, state->nextblock);
       }
+      else
+#endif
+      {
+         uint8_t *compressed = state_manager_reserve(state);
 
-      performance_counter_init(&gen_deltas, "gen_deltas");
-      performance_counter_start(&gen_deltas);
-
-      oldb        = state->thisblock;
-      newb        = state->nextblock;
-      compressed  = state->head + sizeof(size_t);
-
-      compressed += state_manager_raw_compress(oldb, newb,
-            state->blocksize, compressed);
+         compressed += state_manager_raw_compress(state->thisblock,
+               state->nextblock, state->blocksize, compressed);
 
-      if (compressed - state->data + state->maxcompsize > state->capacity)
-      {
-         compressed = state->data;
-         if (state->tail == state->data + sizeof(size_t))
-            state->tail = state->data + read_size_t(state->tail);
+         state_manager_commit(state, compressed);
       }
-      write_size_t(compressed, state->head-state->data);
-      compressed += sizeof(size_t);
-      write_size_t(state->head, compressed-state->data);
-      state->head = compressed;
-
-      performance_counter_stop(&gen_deltas);
    }
    else
       state->thisblock_valid = true;
@@ -466,24 +1362,7 @@ recheckcapacity:;
    state->entries++;
 }
 
-#if 0
-static void state_manager_capacity(state_manager_t *state,
-      unsigned *entries, size_t *bytes, bool *full)
-{
-   size_t headpos   = state->head - state->data;
-   size_t tailpos   = state->tail - state->data;
-   size_t remaining = (tailpos + state->capacity -
-         sizeof(size_t) - headpos - 1) % state->capacity + 1;
-
-   if (entries)
-      *entries = state->entries;
-   if (bytes)
-      *bytes = state->capacity-remaining;
-   if (full)
-      *full = remaining <= state->maxcompsize * 2;
-}
-#endif
-
+#ifndef STATE_MANAGER_TEST
 void state_manager_event_init(void)
 {
    retro_ctx_serialize_info_t serial_info;
@@ -516,10 +1395,30 @@ void state_manager_event_init(void)
          (unsigned)(settings->rewind_buffer_size / 1000000));
 
    rewind_state.state = state_manager_new(rewind_state.size,
-         settings->rewind_buffer_size);
+         settings->rewind_buffer_size, settings->rewind_threads);
 
    if (!rewind_state.state)
+   {
       RARCH_WARN("%s.\n", msg_hash_to_str(MSG_REWIND_INIT_FAILED));
+      return;
+   }
+
+   if (settings->rewind_compressed_size || settings->rewind_disk_size)
+   {
+      char spill_path[PATH_MAX_LENGTH] = {0};
+      global_t *global                 = global_get_ptr();
+
+      if (settings->rewind_disk_size)
+         fill_pathname_noext(spill_path, global->name.savestate,
+               ".rewind", sizeof(spill_path));
+
+      if (!state_manager_enable_tiers(rewind_state.state,
+               settings->rewind_compressed_size,
+               settings->rewind_disk_size ? spill_path : NULL,
+               settings->rewind_disk_size))
+         RARCH_WARN("Failed to set up rewind tiers, "
+               "oldest frames will be discarded.\n");
+   }
 
    state_manager_push_where(rewind_state.state, &state);
 
@@ -532,6 +1431,32 @@ void state_manager_event_init(void)
 }
 
 
+/* The tier counters are gauges rather than timers:
+ * 'total' holds the bytes in use and 'call_cnt' the frames. */
+static void state_manager_update_counters(void)
+{
+   static struct retro_perf_counter tiers[STATE_MANAGER_TIER_LAST] = {{0}};
+   static const char *idents[STATE_MANAGER_TIER_LAST] = {
+      "rewind_tier_raw",
+      "rewind_tier_compressed",
+      "rewind_tier_disk",
+   };
+   unsigned i;
+
+   for (i = 0; i < STATE_MANAGER_TIER_LAST; i++)
+   {
+      unsigned entries;
+      size_t bytes;
+
+      state_manager_get_tier_stats(rewind_state.state,
+            (enum state_manager_tier)i, &entries, &bytes);
+
+      performance_counter_init(&tiers[i], idents[i]);
+      tiers[i].total    = bytes;
+      tiers[i].call_cnt = entries;
+   }
+}
+
 bool state_manager_frame_is_reversed(void)
 {
    return frame_is_reversed;
@@ -578,9 +1503,18 @@ void state_manager_check_rewind(bool pressed)
 
    if (pressed)
    {
+      static struct retro_perf_counter rewind_pop = {0};
       const void *buf    = NULL;
+      bool popped        = false;
+
+      performance_counter_init(&rewind_pop, "rewind_pop");
+      performance_counter_start(&rewind_pop);
 
-      if (state_manager_pop(rewind_state.state, &buf))
+      popped = state_manager_pop(rewind_state.state, &buf);
+
+      performance_counter_stop(&rewind_pop);
+
+      if (popped)
       {
          retro_ctx_serialize_info_t serial_info;
 
@@ -617,6 +1551,7 @@ void state_manager_check_rewind(bool pressed)
       {
          retro_ctx_serialize_info_t serial_info;
          static struct retro_perf_counter rewind_serialize = {0};
+         static struct retro_perf_counter gen_deltas       = {0};
          void *state = NULL;
 
          state_manager_push_where(rewind_state.state, &state);
@@ -631,9 +1566,19 @@ void state_manager_check_rewind(bool pressed)
 
          performance_counter_stop(&rewind_serialize);
 
+         /* With worker threads, this only measures handing off the job. */
+         performance_counter_init(&gen_deltas, "gen_deltas");
+         performance_counter_start(&gen_deltas);
+
          state_manager_push_do(rewind_state.state);
+
+         performance_counter_stop(&gen_deltas);
       }
    }
 
+   if (runloop_ctl(RUNLOOP_CTL_IS_PERFCNT_ENABLE, NULL))
+      state_manager_update_counters();
+
    core_set_rewind_callbacks();
 }
+#endif
@@ -28,6 +28,80 @@ RETRO_BEGIN_DECLS
 
 typedef struct state_manager state_manager_t;
 
+enum state_manager_tier
+{
+   /* Recent frames, as deltas in the main buffer. */
+   STATE_MANAGER_TIER_RAW = 0,
+   /* Older blocks of deltas, compressed again, in RAM. */
+   STATE_MANAGER_TIER_COMPRESSED,
+   /* The oldest blocks, in a memory-mapped file. */
+   STATE_MANAGER_TIER_DISK,
+   STATE_MANAGER_TIER_LAST
+};
+
+/**
+ * state_manager_new:
+ * @state_size           : size of a single savestate.
+ * @buffer_size          : size of the rewind buffer in bytes.
+ * @num_threads          : number of worker threads generating deltas.
+ *
+ * Creates a rewind buffer. If @num_threads is non-zero, savestates
+ * are split into chunks which are diffed on a pool of worker threads,
+ * and the result is only added to the buffer by the next push or pop.
+ * The contents of the buffer are the same either way.
+ *
+ * Returns: new rewind buffer, or NULL on failure.
+ **/
+state_manager_t *state_manager_new(size_t state_size, size_t buffer_size,
+      unsigned num_threads);
+
+void state_manager_free(state_manager_t *state);
+
+/**
+ * state_manager_pop:
+ * @state                : rewind buffer.
+ * @data                 : set to the most recently pushed savestate.
+ *
+ * Removes the most recent savestate from the buffer.
+ * @data stays valid until the next push or pop.
+ *
+ * Returns: false if the buffer is empty.
+ **/
+bool state_manager_pop(state_manager_t *state, const void **data);
+
+/**
+ * state_manager_push_where:
+ * @state                : rewind buffer.
+ * @data                 : set to where the next savestate should be written.
+ *
+ * Must be followed by state_manager_push_do() once the savestate
+ * has been serialized into @data.
+ **/
+void state_manager_push_where(state_manager_t *state, void **data);
+
+void state_manager_push_do(state_manager_t *state);
+
+/**
+ * state_manager_enable_tiers:
+ * @state                : rewind buffer.
+ * @compressed_size      : bytes of compressed blocks to keep in RAM.
+ * @spill_path           : file to spill older blocks to, or NULL.
+ * @spill_size           : size of the spill file in bytes.
+ *
+ * Instead of discarding the oldest frames when the buffer is full,
+ * moves them in blocks to a compressed tier in RAM, and from there
+ * to a memory-mapped spill file. The spill file is deleted again
+ * by state_manager_free().
+ *
+ * Returns: false if the buffer is too small for tiering, or
+ * the spill file couldn't be mapped.
+ **/
+bool state_manager_enable_tiers(state_manager_t *state,
+      size_t compressed_size, const char *spill_path, size_t spill_size);
+
+void state_manager_get_tier_stats(const state_manager_t *state,
+      enum state_manager_tier tier, unsigned *entries, size_t *bytes);
+
 bool state_manager_frame_is_reversed(void);
 
 void state_manager_event_deinit(void);
@@ -0,0 +1,205 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2016 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Measures push and pop latency of the rewind buffer for
+ * synthetic savestates, with and without worker threads,
+ * and checks that every popped state matches what was pushed.
+ * A final run keeps a long history in a small buffer, so most
+ * frames go through the compressed and disk tiers. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithms/mismatch.h>
+#include <features/features_cpu.h>
+
+#include "../state_manager.h"
+
+#define BENCH_FRAMES      240
+#define BENCH_BUFFER_SIZE (256 << 20)
+
+#define TIER_FRAMES       2400
+#define TIER_STATE_SIZE   (256 << 10)
+#define TIER_BUFFER_SIZE  (3 << 20)
+#define TIER_RAM_SIZE     (256 << 10)
+#define TIER_DISK_SIZE    (4 << 20)
+#define TIER_SPILL_PATH   "state_manager_bench.rewind"
+
+static uint32_t bench_rand_state = 1;
+
+static uint32_t bench_rand(void)
+{
+   bench_rand_state = bench_rand_state * 1103515245 + 12345;
+   return bench_rand_state >> 8;
+}
+
+static uint32_t bench_hash(const uint8_t *data, size_t size)
+{
+   size_t i;
+   uint32_t hash = 2166136261u;
+
+   for (i = 0; i < size; i++)
+      hash = (hash ^ data[i]) * 16777619u;
+   return hash;
+}
+
+/* Roughly what a core does to its state in one frame:
+ * a few scattered writes and one hot region that always changes. */
+static void bench_emulate_frame(uint8_t *state, size_t size, unsigned frame)
+{
+   unsigned i;
+   size_t hot = size / 4;
+
+   for (i = 0; i < 64; i++)
+   {
+      size_t pos = (bench_rand() % (size / 32)) * 32;
+      memset(state + pos, bench_rand() & 0xff, 32);
+   }
+
+   for (i = 0; i < 4096 && hot + i < size; i++)
+      state[hot + i] = (uint8_t)(frame + i);
+}
+
+static bool bench_run(size_t size, unsigned num_threads,
+      unsigned frames, bool tiered)
+{
+   unsigned i;
+   retro_time_t push_total = 0, push_max = 0;
+   retro_time_t pop_total  = 0, pop_max  = 0;
+   unsigned popped         = 0;
+   bool ok                 = true;
+   uint8_t *state          = (uint8_t*)malloc(size);
+   uint32_t *hashes        = (uint32_t*)calloc(frames, sizeof(*hashes));
+   state_manager_t *mgr    = state_manager_new(size,
+         tiered ? TIER_BUFFER_SIZE : BENCH_BUFFER_SIZE, num_threads);
+
+   if (!state || !hashes || !mgr)
+   {
+      fprintf(stderr, "Failed to allocate %u KB state.\n",
+            (unsigned)(size >> 10));
+      ok = false;
+      goto end;
+   }
+
+   if (tiered && !state_manager_enable_tiers(mgr,
+            TIER_RAM_SIZE, TIER_SPILL_PATH, TIER_DISK_SIZE))
+   {
+      fprintf(stderr, "Failed to enable tiers.\n");
+      ok = false;
+      goto end;
+   }
+
+   bench_rand_state = 1;
+   for (i = 0; i < size; i++)
+      state[i] = bench_rand() & 0xff;
+
+   for (i = 0; i < frames; i++)
+   {
+      void *where;
+      retro_time_t start, delta;
+
+      bench_emulate_frame(state, size, i);
+      hashes[i] = bench_hash(state, size);
+
+      start = cpu_features_get_time_usec();
+      state_manager_push_where(mgr, &where);
+      memcpy(where, state, size);
+      state_manager_push_do(mgr);
+      delta = cpu_features_get_time_usec() - start;
+
+      push_total += delta;
+      if (delta > push_max)
+         push_max = delta;
+   }
+
+   if (tiered)
+   {
+      unsigned tier;
+      for (tier = 0; tier < STATE_MANAGER_TIER_LAST; tier++)
+      {
+         unsigned entries;
+         size_t bytes;
+
+         state_manager_get_tier_stats(mgr,
+               (enum state_manager_tier)tier, &entries, &bytes);
+         printf("tier %u: %5u frames, %7u KB\n", tier, entries,
+               (unsigned)(bytes >> 10));
+      }
+   }
+
+   for (i = frames; i > 0; i--)
+   {
+      const void *data;
+      retro_time_t start, delta;
+      bool got;
+
+      start = cpu_features_get_time_usec();
+      got   = state_manager_pop(mgr, &data);
+      delta = cpu_features_get_time_usec() - start;
+
+      if (!got)
+         break;
+
+      if (bench_hash((const uint8_t*)data, size) != hashes[i - 1])
+      {
+         fprintf(stderr, "Mismatch at frame %u.\n", i - 1);
+         ok = false;
+         break;
+      }
+
+      pop_total += delta;
+      if (delta > pop_max)
+         pop_max = delta;
+      popped++;
+   }
+
+   printf("%6u KB, %u threads: push avg %7.1f us max %7u us, "
+         "pop avg %7.1f us max %7u us, %u/%u frames\n",
+         (unsigned)(size >> 10), num_threads,
+         (double)push_total / frames, (unsigned)push_max,
+         popped ? (double)pop_total / popped : 0.0, (unsigned)pop_max,
+         popped, frames);
+
+end:
+   state_manager_free(mgr);
+   free(hashes);
+   free(state);
+   return ok;
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i;
+   static const size_t sizes[] = { 256 << 10, 2 << 20, 16 << 20 };
+   unsigned num_threads        = cpu_features_get_core_amount();
+   bool ok                     = true;
+
+   if (argc > 1)
+      num_threads = strtoul(argv[1], NULL, 0);
+
+   mismatch_init(cpu_features_get());
+
+   for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+   {
+      ok = bench_run(sizes[i], 0, BENCH_FRAMES, false) && ok;
+      if (num_threads)
+         ok = bench_run(sizes[i], num_threads, BENCH_FRAMES, false) && ok;
+   }
+
+   ok = bench_run(TIER_STATE_SIZE, num_threads, TIER_FRAMES, true) && ok;
+
+   return ok ? 0 : 1;
+}
@@ -595,6 +595,31 @@ static void menu_action_setting_disp_set_label_libretro_perf_counters(
          s2, len, path, w);
 }
 
+static void menu_action_setting_disp_set_label_audio_telemetry(
+      file_list_t* list,
+      unsigned *w, unsigned type, unsigned i,
+      const char *label,
+      char *s, size_t len,
+      const char *entry_label,
+      const char *path,
+      char *s2, size_t len2)
+{
+   char line[256];
+   const char *value = NULL;
+   struct audio_telemetry_stats stats;
+
+   audio_telemetry_poll(AUDIO_TELEMETRY_WINDOW_MENU, &stats, false);
+   audio_telemetry_format(&stats,
+         type - MENU_SETTINGS_AUDIO_TELEMETRY_BEGIN, line, sizeof(line));
+
+   value = strchr(line, ' ');
+   strlcpy(s, value ? value + 1 : "", len);
+   *w = 19;
+   strlcpy(s2, path, len2);
+
+   menu_animation_ctl(MENU_ANIMATION_CTL_SET_ACTIVE, NULL);
+}
+
 static void menu_action_setting_disp_set_label_menu_more(
       file_list_t* list,
       unsigned *w, unsigned type, unsigned i,
@@ -1648,6 +1673,12 @@ static int menu_cbs_init_bind_get_string_representation_compare_type(
       BIND_ACTION_GET_VALUE(cbs,
          menu_action_setting_disp_set_label_libretro_perf_counters);
    }
+   else if (type >= MENU_SETTINGS_AUDIO_TELEMETRY_BEGIN
+         && type <= MENU_SETTINGS_AUDIO_TELEMETRY_END)
+   {
+      BIND_ACTION_GET_VALUE(cbs,
+         menu_action_setting_disp_set_label_audio_telemetry);
+   }
    else
    {
       switch (type)
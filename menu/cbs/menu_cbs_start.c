@@ -99,6 +99,12 @@ static int action_start_performance_counters_frontend(unsigned type,
    return generic_action_start_performance_counters(counters, offset, type, label);
 }
 
+static int action_start_audio_telemetry(unsigned type, const char *label)
+{
+   audio_telemetry_poll(AUDIO_TELEMETRY_WINDOW_MENU, NULL, true);
+   return 0;
+}
+
 static int action_start_input_desc(unsigned type, const char *label)
 {
    settings_t           *settings = config_get_ptr();
@@ -393,6 +399,11 @@ static int menu_cbs_init_bind_start_compare_type(menu_file_list_cbs_t *cbs,
    {
       BIND_ACTION_START(cbs, action_start_performance_counters_frontend);
    }
+   else if (type >= MENU_SETTINGS_AUDIO_TELEMETRY_BEGIN &&
+         type <= MENU_SETTINGS_AUDIO_TELEMETRY_END)
+   {
+      BIND_ACTION_START(cbs, action_start_audio_telemetry);
+   }
    else if ((type >= MENU_SETTINGS_PLAYLIST_ASSOCIATION_START))
    {
       BIND_ACTION_START(cbs, action_start_playlist_association);
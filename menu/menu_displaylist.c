@@ -220,6 +220,32 @@ static void menu_displaylist_push_perfcounter(
                counters[i]->ident, "", (enum msg_hash_enums)(id + i), id + i , 0, 0);
 }
 
+static void menu_displaylist_push_audio_telemetry(
+      menu_displaylist_info_t *info)
+{
+   unsigned i;
+   struct audio_telemetry_stats stats;
+
+   audio_telemetry_poll(AUDIO_TELEMETRY_WINDOW_MENU, &stats, false);
+
+   for (i = 0; i < AUDIO_TELEMETRY_LINES; i++)
+   {
+      char line[256];
+      char *value = NULL;
+
+      audio_telemetry_format(&stats, i, line, sizeof(line));
+
+      /* The name is the first word, the rest is shown as value. */
+      value = strchr(line, ' ');
+      if (value)
+         *value = '\0';
+
+      menu_entries_append_enum(info->list, line, "",
+            (enum msg_hash_enums)(MENU_SETTINGS_AUDIO_TELEMETRY_BEGIN + i),
+            MENU_SETTINGS_AUDIO_TELEMETRY_BEGIN + i, 0, 0);
+   }
+}
+
 static int menu_displaylist_parse_core_info(menu_displaylist_info_t *info)
 {
    unsigned i;
@@ -5228,6 +5254,8 @@ bool menu_displaylist_ctl(enum menu_displaylist_ctl_state type, void *data)
                (type == DISPLAYLIST_PERFCOUNTERS_CORE) ?
                MENU_SETTINGS_LIBRETRO_PERF_COUNTERS_BEGIN :
                MENU_SETTINGS_PERF_COUNTERS_BEGIN);
+         if (type == DISPLAYLIST_PERFCOUNTERS_FRONTEND)
+            menu_displaylist_push_audio_telemetry(info);
          ret = 0;
 
          info->need_refresh = false;
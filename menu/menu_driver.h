@@ -29,6 +29,7 @@
 #include "menu_entries.h"
 
 #include "../gfx/video_shader_driver.h"
+#include "../audio/audio_telemetry.h"
 
 RETRO_BEGIN_DECLS
 
@@ -208,6 +209,8 @@ enum menu_settings_type
    MENU_SETTINGS_LIBRETRO_PERF_COUNTERS_END = MENU_SETTINGS_LIBRETRO_PERF_COUNTERS_BEGIN + (MAX_COUNTERS - 1),
    MENU_SETTINGS_PERF_COUNTERS_BEGIN,
    MENU_SETTINGS_PERF_COUNTERS_END = MENU_SETTINGS_PERF_COUNTERS_BEGIN + (MAX_COUNTERS - 1),
+   MENU_SETTINGS_AUDIO_TELEMETRY_BEGIN,
+   MENU_SETTINGS_AUDIO_TELEMETRY_END = MENU_SETTINGS_AUDIO_TELEMETRY_BEGIN + (AUDIO_TELEMETRY_LINES - 1),
    MENU_SETTINGS_CHEAT_BEGIN,
    MENU_SETTINGS_CHEAT_END = MENU_SETTINGS_CHEAT_BEGIN + (MAX_CHEAT_COUNTERS - 1),
    MENU_SETTINGS_INPUT_DESC_BEGIN,
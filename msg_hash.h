@@ -279,6 +279,9 @@ enum msg_hash_enums
    MSG_REDIRECTING_CHEATFILE_TO,
    MSG_SCANNING,
    MSG_SCANNING_OF_DIRECTORY_FINISHED,
+   MSG_FILES,
+   MSG_FILES_PER_SECOND,
+   MSG_MEGABYTES_PER_SECOND,
    MSG_COULD_NOT_PROCESS_ZIP_FILE,
    MSG_LOADED_STATE_FROM_SLOT,
    MSG_REMOVING_TEMPORARY_CONTENT_FILE,
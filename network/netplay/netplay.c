@@ -26,6 +26,7 @@
 #include <net/net_compat.h>
 #include <net/net_socket.h>
 #include <retro_endianness.h>
+#include <retro_miscellaneous.h>
 
 #include "netplay_private.h"
 
@@ -33,6 +34,7 @@
 #include "../../command.h"
 #include "../../movie.h"
 #include "../../runloop.h"
+#include "../../gfx/video_driver.h"
 
 enum
 {
@@ -107,19 +109,17 @@ static bool send_chunk(netplay_t *netplay)
 
    if (addr)
    {
-      ssize_t bytes_sent;
-
 #ifdef HAVE_IPV6
-      bytes_sent = (sendto(netplay->udp_fd, (const char*)netplay->packet_buffer,
-               sizeof(netplay->packet_buffer), 0, addr,
-               sizeof(struct sockaddr_in6)));
+      socklen_t addrlen = sizeof(struct sockaddr_in6);
 #else
-      bytes_sent = (sendto(netplay->udp_fd, (const char*)netplay->packet_buffer,
-               sizeof(netplay->packet_buffer), 0, addr,
-               sizeof(struct sockaddr_in)));
+      socklen_t addrlen = sizeof(struct sockaddr_in);
 #endif
 
-      if (bytes_sent != sizeof(netplay->packet_buffer))
+      /* A full socket buffer just loses the packet, which the
+       * redundant frames in the next packets make up for. */
+      if (!netplay_io_sendto(netplay->io, netplay->io_udp,
+               netplay->packet_buffer, sizeof(netplay->packet_buffer),
+               addr, addrlen))
       {
          warn_hangup();
          netplay->has_connection = false;
@@ -139,8 +139,11 @@ static bool send_chunk(netplay_t *netplay)
  **/
 static bool get_self_input_state(netplay_t *netplay)
 {
+   double fps;
+   const uint32_t *input;
    uint32_t state[UDP_WORDS_PER_FRAME - 1] = {0};
    struct delta_frame *ptr                 = &netplay->buffer[netplay->self_ptr];
+   struct retro_system_av_info *av_info    = video_viewport_get_system_av_info();
 
    if (!input_driver_is_libretro_input_blocked() && netplay->frame_count > 0)
    {
@@ -183,12 +186,9 @@ static bool get_self_input_state(netplay_t *netplay)
     *    frame redundancy_frames[UDP_FRAME_PACKETS];
     * }
     */
-   memmove(netplay->packet_buffer, netplay->packet_buffer + UDP_WORDS_PER_FRAME,
-         sizeof (netplay->packet_buffer) - UDP_WORDS_PER_FRAME * sizeof(uint32_t));
-   netplay->packet_buffer[(UDP_FRAME_PACKETS - 1) * UDP_WORDS_PER_FRAME] = htonl(netplay->frame_count); 
-   netplay->packet_buffer[(UDP_FRAME_PACKETS - 1) * UDP_WORDS_PER_FRAME + 1] = htonl(state[0]);
-   netplay->packet_buffer[(UDP_FRAME_PACKETS - 1) * UDP_WORDS_PER_FRAME + 2] = htonl(state[1]);
-   netplay->packet_buffer[(UDP_FRAME_PACKETS - 1) * UDP_WORDS_PER_FRAME + 3] = htonl(state[2]);
+   fps   = av_info && av_info->timing.fps > 0.0 ? av_info->timing.fps : 60.0;
+   input = netplay_net_delay_input(netplay, state,
+         netplay_net_input_delay_target(netplay, fps));
 
    if (!send_chunk(netplay))
    {
@@ -197,7 +197,7 @@ static bool get_self_input_state(netplay_t *netplay)
       return false;
    }
 
-   memcpy(ptr->self_state, state, sizeof(state));
+   memcpy(ptr->self_state, input, sizeof(ptr->self_state));
    netplay->self_ptr = NEXT_PTR(netplay->self_ptr);
    return true;
 }
@@ -205,60 +205,138 @@ static bool get_self_input_state(netplay_t *netplay)
 static bool netplay_cmd_ack(netplay_t *netplay)
 {
    uint32_t cmd = htonl(NETPLAY_CMD_ACK);
-   return socket_send_all_blocking(netplay->fd, &cmd, sizeof(cmd), false);
+   return netplay_io_send(netplay->io, netplay->io_tcp, &cmd, sizeof(cmd));
 }
 
 static bool netplay_cmd_nak(netplay_t *netplay)
 {
    uint32_t cmd = htonl(NETPLAY_CMD_NAK);
-   return socket_send_all_blocking(netplay->fd, &cmd, sizeof(cmd), false);
+   return netplay_io_send(netplay->io, netplay->io_tcp, &cmd, sizeof(cmd));
 }
 
-static bool netplay_get_response(netplay_t *netplay)
+/**
+ * netplay_get_response:
+ * @netplay              : pointer to netplay object
+ * @ack                  : true if the other side accepted the command.
+ *
+ * Completes the pending command from netplay_command().
+ **/
+static void netplay_get_response(netplay_t *netplay, bool ack)
 {
-   uint32_t response;
-   if (!socket_receive_all_blocking(netplay->fd, &response, sizeof(response)))
-      return false;
+   char msg[256];
+
+   if (!netplay->pending.active)
+   {
+      RARCH_WARN("Got a netplay command response nothing was waiting for.\n");
+      return;
+   }
+
+   netplay->pending.active = false;
+
+   if (ack)
+   {
+      runloop_msg_queue_push(netplay->pending.success_msg, 1, 180, false);
+      return;
+   }
+
+   /* Undo what was applied when the command was sent. */
+   if (netplay->pending.cmd == NETPLAY_CMD_FLIP_PLAYERS)
+   {
+      netplay->flip       = netplay->pending.flip;
+      netplay->flip_frame = netplay->pending.flip_frame;
+   }
+
+   snprintf(msg, sizeof(msg), "Failed to send command \"%s\"",
+         netplay->pending.command_str);
+   RARCH_WARN("%s\n", msg);
+   runloop_msg_queue_push(msg, 1, 180, false);
+}
+
+static void netplay_send_ping(netplay_t *netplay)
+{
+   uint32_t clock[2];
+   retro_time_t now = cpu_features_get_time_usec();
+
+   if (now - netplay->delay.last_ping < NETPLAY_PING_USEC)
+      return;
+
+   clock[0] = htonl((uint32_t)(now >> 32));
+   clock[1] = htonl((uint32_t)now);
 
-   return ntohl(response) == NETPLAY_CMD_ACK;
+   /* A full send buffer just skips this one. */
+   if (netplay_send_raw_cmd(netplay, NETPLAY_CMD_PING, clock, sizeof(clock)))
+      netplay->delay.last_ping = now;
 }
 
-static bool netplay_get_cmd(netplay_t *netplay)
+/* True if the next frame would roll back further than allowed,
+ * so we have to wait for the other side's input. */
+static bool netplay_rollback_full(netplay_t *netplay)
+{
+   if (netplay->other_ptr == netplay->self_ptr)
+      return true;
+
+   return netplay->rollback_frames && netplay->frame_count + 1
+      - netplay->other_frame_count > netplay->rollback_frames;
+}
+
+/**
+ * netplay_get_cmd:
+ * @netplay              : pointer to netplay object
+ *
+ * Handles the next command from the other side, once all of it
+ * has arrived.
+ *
+ * Returns: 1 if a command was handled, 0 if the next command is
+ * incomplete and -1 if responding to it failed.
+ **/
+static int netplay_get_cmd(netplay_t *netplay)
 {
    uint32_t cmd;
    uint32_t flip_frame;
    size_t cmd_size;
 
-   if (!socket_receive_all_blocking(netplay->fd, &cmd, sizeof(cmd)))
-      return false;
+   if (!netplay_io_recv(netplay->io, netplay->io_tcp,
+            &cmd, sizeof(cmd), true))
+      return 0;
 
    cmd      = ntohl(cmd);
 
+   /* Responses are bare words rather than command headers. */
+   if (cmd == NETPLAY_CMD_ACK || cmd == NETPLAY_CMD_NAK)
+   {
+      netplay_io_recv(netplay->io, netplay->io_tcp, NULL, sizeof(cmd), false);
+      netplay_get_response(netplay, cmd == NETPLAY_CMD_ACK);
+      return 1;
+   }
+
    cmd_size = cmd & 0xffff;
    cmd      = cmd >> 16;
 
+   if (netplay_io_recv_avail(netplay->io, netplay->io_tcp)
+         < sizeof(cmd) + cmd_size)
+      return 0;
+
+   netplay_io_recv(netplay->io, netplay->io_tcp, NULL, sizeof(cmd), false);
+
    switch (cmd)
    {
       case NETPLAY_CMD_FLIP_PLAYERS:
          if (cmd_size != sizeof(uint32_t))
          {
             RARCH_ERR("CMD_FLIP_PLAYERS received an unexpected command size.\n");
-            return netplay_cmd_nak(netplay);
+            break;
          }
 
-         if (!socket_receive_all_blocking(
-                  netplay->fd, &flip_frame, sizeof(flip_frame)))
-         {
-            RARCH_ERR("Failed to receive CMD_FLIP_PLAYERS argument.\n");
-            return netplay_cmd_nak(netplay);
-         }
+         netplay_io_recv(netplay->io, netplay->io_tcp,
+               &flip_frame, sizeof(flip_frame), false);
+         cmd_size   = 0;
 
          flip_frame = ntohl(flip_frame);
 
          if (flip_frame < netplay->flip_frame)
          {
             RARCH_ERR("Host asked us to flip users in the past. Not possible ...\n");
-            return netplay_cmd_nak(netplay);
+            break;
          }
 
          netplay->flip ^= true;
@@ -267,33 +345,102 @@ static bool netplay_get_cmd(netplay_t *netplay)
          RARCH_LOG("Netplay users are flipped.\n");
          runloop_msg_queue_push("Netplay users are flipped.", 1, 180, false);
 
-         return netplay_cmd_ack(netplay);
+         return netplay_cmd_ack(netplay) ? 1 : -1;
 
       case NETPLAY_CMD_SPECTATE:
          RARCH_ERR("NETPLAY_CMD_SPECTATE unimplemented.\n");
-         return netplay_cmd_nak(netplay);
+         break;
 
       case NETPLAY_CMD_DISCONNECT:
          warn_hangup();
-         return netplay_cmd_ack(netplay);
+         return netplay_cmd_ack(netplay) ? 1 : -1;
+
+      /* Both sides go by when the command arrived rather than when
+       * this frame got to it, so the round-trip time doesn't include
+       * up to a frame of waiting on either side. */
+      case NETPLAY_CMD_PING:
+      {
+         uint32_t pong[3];
+         retro_time_t received;
 
+         if (cmd_size != 2 * sizeof(uint32_t))
+         {
+            RARCH_ERR("CMD_PING received an unexpected command size.\n");
+            netplay_io_recv(netplay->io, netplay->io_tcp, NULL, cmd_size, false);
+            return 1;
+         }
+
+         received = netplay_io_recv_time(netplay->io, netplay->io_tcp);
+         netplay_io_recv(netplay->io, netplay->io_tcp,
+               pong, 2 * sizeof(uint32_t), false);
+
+         /* Echo the clock, plus how long we held on to it. */
+         pong[2] = htonl((uint32_t)(cpu_features_get_time_usec() - received));
+         netplay_send_raw_cmd(netplay, NETPLAY_CMD_PONG, pong, sizeof(pong));
+         return 1;
+      }
+
+      case NETPLAY_CMD_PONG:
+      {
+         uint32_t pong[3];
+         retro_time_t received, sent;
+
+         if (cmd_size != sizeof(pong))
+         {
+            RARCH_ERR("CMD_PONG received an unexpected command size.\n");
+            netplay_io_recv(netplay->io, netplay->io_tcp, NULL, cmd_size, false);
+            return 1;
+         }
+
+         received = netplay_io_recv_time(netplay->io, netplay->io_tcp);
+         netplay_io_recv(netplay->io, netplay->io_tcp,
+               pong, sizeof(pong), false);
+
+         sent = ((retro_time_t)ntohl(pong[0]) << 32) | ntohl(pong[1]);
+         netplay_net_update_rtt(netplay, received - sent - ntohl(pong[2]));
+         return 1;
+      }
+
+      /* Neither of these is acknowledged. */
       case NETPLAY_CMD_LOAD_SAVESTATE:
-         RARCH_ERR("NETPLAY_CMD_LOAD_SAVESTATE unimplemented.\n");
-         return netplay_cmd_nak(netplay);
+         if (!netplay_net_sync_patch_cmd(netplay, cmd_size))
+            RARCH_ERR("Dropped an unexpected netplay savestate patch.\n");
+         return 1;
+
+      case NETPLAY_CMD_CRC:
+      {
+         uint32_t args[3];
+
+         if (cmd_size != sizeof(args))
+         {
+            RARCH_ERR("CMD_CRC received an unexpected command size.\n");
+            netplay_io_recv(netplay->io, netplay->io_tcp, NULL, cmd_size, false);
+            return 1;
+         }
+
+         netplay_io_recv(netplay->io, netplay->io_tcp,
+               args, sizeof(args), false);
+         netplay_net_sync_checksum_cmd(netplay,
+               ntohl(args[0]), ntohl(args[1]), ntohl(args[2]));
+         return 1;
+      }
 
       case NETPLAY_CMD_PAUSE:
          command_event(CMD_EVENT_PAUSE, NULL);
-         return netplay_cmd_ack(netplay);
+         return netplay_cmd_ack(netplay) ? 1 : -1;
 
       case NETPLAY_CMD_RESUME:
          command_event(CMD_EVENT_UNPAUSE, NULL);
-         return netplay_cmd_ack(netplay);
+         return netplay_cmd_ack(netplay) ? 1 : -1;
 
-      default: break;
+      default:
+         RARCH_ERR("Unknown netplay command received.\n");
+         break;
    }
 
-   RARCH_ERR("Unknown netplay command received.\n");
-   return netplay_cmd_nak(netplay);
+   /* Skip whatever argument we didn't use. */
+   netplay_io_recv(netplay->io, netplay->io_tcp, NULL, cmd_size, false);
+   return netplay_cmd_nak(netplay) ? 1 : -1;
 }
 
 #define MAX_RETRIES 16
@@ -301,35 +448,25 @@ static bool netplay_get_cmd(netplay_t *netplay)
 
 static int poll_input(netplay_t *netplay, bool block)
 {
-   int max_fd        = (netplay->fd > netplay->udp_fd ? 
-         netplay->fd : netplay->udp_fd) + 1;
-   struct timeval tv = {0};
-   tv.tv_sec         = 0;
-   tv.tv_usec        = block ? (RETRY_MS * 1000) : 0;
-
    do
    { 
-      fd_set fds;
-      /* select() does not take pointer to const struct timeval.
-       * Technically possible for select() to modify tmp_tv, so 
-       * we go paranoia mode. */
-      struct timeval tmp_tv = tv;
+      int res;
 
       netplay->timeout_cnt++;
 
-      FD_ZERO(&fds);
-      FD_SET(netplay->udp_fd, &fds);
-      FD_SET(netplay->fd, &fds);
+      netplay_io_wait(netplay->io, block ? RETRY_MS : 0);
 
-      if (socket_select(max_fd, &fds, NULL, NULL, &tmp_tv) < 0)
+      if (  !netplay_io_alive(netplay->io, netplay->io_tcp) ||
+            !netplay_io_alive(netplay->io, netplay->io_udp))
          return -1;
 
       /* Somewhat hacky,
        * but we aren't using the TCP connection for anything useful atm. */
-      if (FD_ISSET(netplay->fd, &fds) && !netplay_get_cmd(netplay))
-         return -1; 
+      while ((res = netplay_get_cmd(netplay)) > 0);
+      if (res < 0)
+         return -1;
 
-      if (FD_ISSET(netplay->udp_fd, &fds))
+      if (netplay_io_packet_avail(netplay->io, netplay->io_udp))
          return 1;
 
       if (!block)
@@ -353,10 +490,10 @@ static int poll_input(netplay_t *netplay, bool block)
 
 static bool receive_data(netplay_t *netplay, uint32_t *buffer, size_t size)
 {
-   socklen_t addrlen = sizeof(netplay->their_addr);
+   size_t received = size;
 
-   if (recvfrom(netplay->udp_fd, (char*)buffer, size, 0,
-            (struct sockaddr*)&netplay->their_addr, &addrlen) != (ssize_t)size)
+   if (!netplay_io_packet(netplay->io, netplay->io_udp,
+            buffer, &received, &netplay->their_addr) || received != size)
       return false;
 
    netplay->has_client_addr = true;
@@ -440,9 +577,14 @@ static bool netplay_poll(netplay_t *netplay)
       return true;
    }
 
+   netplay_send_ping(netplay);
+
    /* We might have reached the end of the buffer, where we 
     * simply have to block. */
-   res = poll_input(netplay, netplay->other_ptr == netplay->self_ptr);
+   if (netplay_rollback_full(netplay))
+      netplay->stats.stalls++;
+
+   res = poll_input(netplay, netplay_rollback_full(netplay));
    if (res == -1)
    {
       netplay->has_connection = false;
@@ -465,7 +607,7 @@ static bool netplay_poll(netplay_t *netplay)
          parse_packet(netplay, buffer, UDP_FRAME_PACKETS);
 
       } while ((netplay->read_frame_count <= netplay->frame_count) && 
-            poll_input(netplay, (netplay->other_ptr == netplay->self_ptr) && 
+            poll_input(netplay, netplay_rollback_full(netplay) && 
                (first_read == netplay->read_frame_count)) == 1);
    }
    else
@@ -551,14 +693,17 @@ static int16_t netplay_input_state(netplay_t *netplay,
    size_t ptr = netplay->is_replay ? 
       netplay->tmp_ptr : PREV_PTR(netplay->self_ptr);
 
-   const uint32_t *curr_input_state = netplay->buffer[ptr].self_state;
+   const struct delta_frame *frame = netplay->sync.replay_frame ?
+      netplay->sync.replay_frame : &netplay->buffer[ptr];
+
+   const uint32_t *curr_input_state = frame->self_state;
 
    if (netplay->port == (netplay_flip_port(netplay, port) ? 1 : 0))
    {
-      if (netplay->buffer[ptr].is_simulated)
-         curr_input_state = netplay->buffer[ptr].simulated_input_state;
+      if (frame->is_simulated)
+         curr_input_state = frame->simulated_input_state;
       else
-         curr_input_state = netplay->buffer[ptr].real_input_state;
+         curr_input_state = frame->real_input_state;
    }
 
    switch (device)
@@ -793,6 +938,41 @@ error:
    return false;
 }
 
+/**
+ * init_io:
+ * @netplay              : pointer to netplay object
+ *
+ * Hands the sockets over to the non-blocking transport once the
+ * blocking handshake is done. The listening socket of a spectating
+ * host keeps being polled from the frame.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+static bool init_io(netplay_t *netplay)
+{
+   if (netplay->spectate.enabled && netplay->is_server)
+      return true;
+
+   netplay->io = netplay_io_new();
+   if (!netplay->io)
+      return false;
+
+   netplay->io_tcp = netplay_io_add(netplay->io, netplay->fd,
+         NETPLAY_IO_STREAM);
+   if (netplay->io_tcp < 0)
+      return false;
+
+   if (!netplay->spectate.enabled)
+   {
+      netplay->io_udp = netplay_io_add(netplay->io, netplay->udp_fd,
+            NETPLAY_IO_DATAGRAM);
+      if (netplay->io_udp < 0)
+         return false;
+   }
+
+   return netplay_io_start(netplay->io);
+}
+
 static bool init_socket(netplay_t *netplay, const char *server, uint16_t port)
 {
    if (!network_init())
@@ -814,6 +994,8 @@ static bool init_socket(netplay_t *netplay, const char *server, uint16_t port)
  * @cb                   : Libretro callbacks.
  * @spectate             : If true, enable spectator mode.
  * @nick                 : Nickname of user.
+ * @check_frames         : Frames between savestate checksums, 0 disables.
+ *                         A client uses the host's value instead.
  *
  * Creates a new netplay handle. A NULL host means we're 
  * hosting (user 1).
@@ -823,7 +1005,7 @@ static bool init_socket(netplay_t *netplay, const char *server, uint16_t port)
 netplay_t *netplay_new(const char *server, uint16_t port,
       unsigned frames, const struct retro_callbacks *cb,
       bool spectate,
-      const char *nick)
+      const char *nick, unsigned check_frames)
 {
    netplay_t *netplay = NULL;
 
@@ -840,6 +1022,7 @@ netplay_t *netplay_new(const char *server, uint16_t port,
    netplay->port              = server ? 0 : 1;
    netplay->spectate.enabled  = spectate;
    netplay->is_server         = server == NULL;
+   netplay->sync.check_frames = MIN(check_frames, NETPLAY_MAX_CHECK_FRAMES);
    strlcpy(netplay->nick, nick, sizeof(netplay->nick));
 
    if(spectate)
@@ -856,9 +1039,17 @@ netplay_t *netplay_new(const char *server, uint16_t port,
    if(!netplay_info_cb(netplay, frames))
       goto error;
 
+   if (!init_io(netplay))
+   {
+      RARCH_ERR("Failed to set up netplay transport.\n");
+      goto error;
+   }
+
    return netplay;
 
 error:
+   netplay_io_free(netplay->io);
+   netplay_broadcast_free(netplay->spectate.broadcast);
    if (netplay->fd >= 0)
       socket_close(netplay->fd);
    if (netplay->udp_fd >= 0)
@@ -868,19 +1059,29 @@ error:
    return NULL;
 }
 
-static bool netplay_send_raw_cmd(netplay_t *netplay, uint32_t cmd,
+bool netplay_send_raw_cmd(netplay_t *netplay, uint32_t cmd,
       const void *data, size_t size)
 {
+   bool ret;
+   /* Queued in one piece, so a full send buffer can't leave
+    * half a command behind. */
+   uint8_t *buf = (uint8_t*)malloc(sizeof(cmd) + size);
+
+   if (!buf)
+      return false;
+
    cmd = (cmd << 16) | (size & 0xffff);
    cmd = htonl(cmd);
 
-   if (!socket_send_all_blocking(netplay->fd, &cmd, sizeof(cmd), false))
-      return false;
+   memcpy(buf, &cmd, sizeof(cmd));
+   if (size)
+      memcpy(buf + sizeof(cmd), data, size);
 
-   if (!socket_send_all_blocking(netplay->fd, data, size, false))
-      return false;
+   ret = netplay_io_send(netplay->io, netplay->io_tcp,
+         buf, sizeof(cmd) + size);
 
-   return true;
+   free(buf);
+   return ret;
 }
 
 /**
@@ -893,7 +1094,8 @@ static bool netplay_send_raw_cmd(netplay_t *netplay, uint32_t cmd,
  * @command_str            : name of action
  * @success_msg            : message to display upon success
  * 
- * Sends a single netplay command and waits for response.
+ * Sends a single netplay command. The response is handled when
+ * it arrives, see netplay_get_response().
  */
 bool netplay_command(netplay_t* netplay, enum netplay_cmd cmd,
                      void* data, size_t sz,
@@ -927,15 +1129,24 @@ bool netplay_command(netplay_t* netplay, enum netplay_cmd cmd,
       goto error;
    }
 
-   if(netplay_send_raw_cmd(netplay, cmd, data, sz)) {
-      if(netplay_get_response(netplay))
-         runloop_msg_queue_push(success_msg, 1, 180, false);
-      else
-      {
-         msg = "Failed to send command \"%s\"";
-         goto error;
-      }
+   if (netplay->pending.active)
+   {
+      msg = "Cannot %s while waiting for the previous command.";
+      goto error;
    }
+
+   if (!netplay_send_raw_cmd(netplay, cmd, data, sz))
+   {
+      msg = "Failed to send command \"%s\"";
+      goto error;
+   }
+
+   netplay->pending.active      = true;
+   netplay->pending.cmd         = cmd;
+   netplay->pending.command_str = command_str;
+   netplay->pending.success_msg = success_msg;
+   netplay->pending.flip        = netplay->flip;
+   netplay->pending.flip_frame  = netplay->flip_frame;
    return true;
 
 error:
@@ -961,6 +1172,8 @@ static void netplay_flip_users(netplay_t *netplay)
       CMD_OPT_HOST_ONLY | CMD_OPT_REQUIRE_SYNC,
       "flip users", "Successfully flipped users.\n");
    
+   /* Flipped right away, as the response may only arrive after
+    * flip_frame. It's undone if the client refuses. */
    if(command)
    {
       netplay->flip       ^= true;
@@ -968,6 +1181,26 @@ static void netplay_flip_users(netplay_t *netplay)
    }
 }
 
+/**
+ * netplay_get_stats:
+ * @netplay              : pointer to netplay object
+ * @stats                : set to the statistics since the last call.
+ *
+ * Starts a new statistics interval.
+ **/
+static void netplay_get_stats(netplay_t *netplay, struct netplay_stats *stats)
+{
+   retro_time_t now = cpu_features_get_time_usec();
+
+   *stats                = netplay->stats;
+   stats->usec           = now - netplay->stats_start;
+   stats->input_delay    = netplay->delay.frames;
+   stats->rtt_usec       = (unsigned)netplay->delay.rtt;
+
+   memset(&netplay->stats, 0, sizeof(netplay->stats));
+   netplay->stats_start  = now;
+}
+
 /**
  * netplay_free:
  * @netplay              : pointer to netplay object
@@ -977,15 +1210,21 @@ static void netplay_flip_users(netplay_t *netplay)
 void netplay_free(netplay_t *netplay)
 {
    unsigned i;
+   struct netplay_stats stats;
 
+   netplay_get_stats(netplay, &stats);
+   if (stats.frames)
+      RARCH_LOG("Netplay: replayed %u of %u frames in %u rollbacks "
+            "(at most %u frames deep), stalled %u times.\n",
+            stats.replayed, stats.frames, stats.rollbacks,
+            stats.max_depth, stats.stalls);
+
+   netplay_io_free(netplay->io);
    socket_close(netplay->fd);
 
    if (netplay->spectate.enabled)
    {
-      for (i = 0; i < MAX_SPECTATORS; i++)
-         if (netplay->spectate.fds[i] >= 0)
-            socket_close(netplay->spectate.fds[i]);
-
+      netplay_broadcast_free(netplay->spectate.broadcast);
       free(netplay->spectate.input);
    }
    else
@@ -996,6 +1235,10 @@ void netplay_free(netplay_t *netplay)
          free(netplay->buffer[i].state);
 
       free(netplay->buffer);
+
+      netplay_sync_free(netplay->sync.data);
+      free(netplay->sync.patch);
+      free(netplay->sync.state);
    }
 
    if (netplay->addr)
@@ -1034,8 +1277,17 @@ static int16_t netplay_get_spectate_input(netplay_t *netplay, bool port,
    int16_t inp;
    retro_ctx_input_state_info_t input_info;
 
-   if (socket_receive_all_blocking(netplay->fd, (char*)&inp, sizeof(inp)))
-      return swap_if_big16(inp);
+   /* The host is expected to be ahead, so this rarely waits. A host
+    * that is paused or stalled is waited on for as long as the
+    * connection stays up. */
+   while (netplay_io_alive(netplay->io, netplay->io_tcp))
+   {
+      if (netplay_io_recv(netplay->io, netplay->io_tcp,
+               &inp, sizeof(inp), false))
+         return swap_if_big16(inp);
+
+      netplay_io_wait(netplay->io, RETRY_MS);
+   }
 
    RARCH_ERR("Connection with host was cut.\n");
    runloop_msg_queue_push("Connection with host was cut.", 1, 180, true);
@@ -1129,10 +1381,19 @@ bool init_netplay(void)
          global->netplay.is_client ? global->netplay.server : NULL,
          global->netplay.port ? global->netplay.port : RARCH_DEFAULT_PORT,
          global->netplay.sync_frames, &cbs, global->netplay.is_spectate,
-         settings->username);
+         settings->username, global->netplay.check_frames);
 
    if (netplay_data)
+   {
+      netplay_t *netplay       = (netplay_t*)netplay_data;
+
+      netplay->delay.adaptive  = global->netplay.input_delay_auto;
+      netplay->delay.max       = MIN(global->netplay.input_delay_frames,
+            NETPLAY_MAX_INPUT_DELAY);
+      netplay->rollback_frames = global->netplay.rollback_frames;
+      netplay->stats_start     = cpu_features_get_time_usec();
       return true;
+   }
 
    global->netplay.is_client = false;
    RARCH_WARN("%s\n", msg_hash_to_str(MSG_NETPLAY_FAILED));
@@ -1152,6 +1413,10 @@ bool netplay_driver_ctl(enum rarch_netplay_ctl_state state, void *data)
    {
       case RARCH_NETPLAY_CTL_IS_DATA_INITED:
          return true;
+      case RARCH_NETPLAY_CTL_GET_STATS:
+         netplay_get_stats((netplay_t*)netplay_data,
+               (struct netplay_stats*)data);
+         return true;
       case RARCH_NETPLAY_CTL_POST_FRAME:
          netplay_post_frame((netplay_t*)netplay_data);
          break;
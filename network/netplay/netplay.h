@@ -35,7 +35,35 @@ enum rarch_netplay_ctl_state
    RARCH_NETPLAY_CTL_FULLSCREEN_TOGGLE,
    RARCH_NETPLAY_CTL_POST_FRAME,
    RARCH_NETPLAY_CTL_PRE_FRAME,
-   RARCH_NETPLAY_CTL_IS_DATA_INITED
+   RARCH_NETPLAY_CTL_IS_DATA_INITED,
+   /* Fills in a struct netplay_stats and starts a new interval. */
+   RARCH_NETPLAY_CTL_GET_STATS
+};
+
+/* Rollback statistics, see RARCH_NETPLAY_CTL_GET_STATS. */
+struct netplay_stats
+{
+   /* Length of the interval. */
+   uint64_t usec;
+   /* Frames run, and frames run again because the other side's
+    * input turned out different from what was predicted. */
+   unsigned frames;
+   unsigned replayed;
+   unsigned rollbacks;
+   /* Deepest rollback, in frames. */
+   unsigned max_depth;
+   /* Frames that waited for input because the rollback window
+    * was full. */
+   unsigned stalls;
+   /* Time spent in core_serialize(), core_unserialize() and
+    * core_run() while replaying. */
+   uint64_t serialize_usec;
+   uint64_t unserialize_usec;
+   uint64_t run_usec;
+   /* Current local input delay, in frames. */
+   unsigned input_delay;
+   /* Smoothed round-trip time, 0 until measured. */
+   unsigned rtt_usec;
 };
 
 enum netplay_cmd
@@ -66,12 +94,25 @@ enum netplay_cmd
       each one individually */
    NETPLAY_CMD_CFG_ACK        = 0x0006, 
 
+   /* Measures the round-trip time. Carries the sender's clock,
+    * which the other side sends back with NETPLAY_CMD_PONG, along
+    * with the microseconds it held on to it. Neither is
+    * acknowledged. */
+   NETPLAY_CMD_PING           = 0x0007, 
+   NETPLAY_CMD_PONG           = 0x0008, 
+
    /* Loading and synchronization */
 
-   /* Send a savestate for the client to load */
+   /* Send a savestate for the client to load, as a patch against
+    * a state both sides have. Split into chunks of
+    * epoch, frame, base frame, checksum, patch size, offset, data.
+    * Not acknowledged. See netplay_sync.h. */
    NETPLAY_CMD_LOAD_SAVESTATE = 0x0012, 
    /* Sends over cheats enabled on client */
    NETPLAY_CMD_CHEATS         = 0x0013, 
+   /* Client's savestate checksum: frame, checksum, epoch.
+    * Not acknowledged. */
+   NETPLAY_CMD_CRC            = 0x0014, 
 
    /* Controlling game playback */
 
@@ -124,6 +165,7 @@ int16_t input_state_spectate_client(unsigned port, unsigned device,
  * @cb                   : Libretro callbacks.
  * @spectate             : If true, enable spectator mode.
  * @nick                 : Nickname of user.
+ * @check_frames         : Frames between savestate checksums, 0 disables.
  *
  * Creates a new netplay handle. A NULL host means we're 
  * hosting (user 1).
@@ -133,7 +175,7 @@ int16_t input_state_spectate_client(unsigned port, unsigned device,
 netplay_t *netplay_new(const char *server,
       uint16_t port, unsigned frames,
       const struct retro_callbacks *cb, bool spectate,
-      const char *nick);
+      const char *nick, unsigned check_frames);
 
 /**
  * netplay_free:
@@ -0,0 +1,663 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2016 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <net/net_compat.h>
+#include <net/net_socket.h>
+#include <queues/spsc_fifo.h>
+#include <retro_atomic.h>
+#include <retro_miscellaneous.h>
+
+#include "netplay_broadcast.h"
+
+/* Same requirements as the netplay_io thread. */
+#if defined(HAVE_THREADS) && (defined(__unix__) || defined(__APPLE__))
+#define NETPLAY_BROADCAST_THREAD
+#include <unistd.h>
+#include <fcntl.h>
+#include <rthreads/rthreads.h>
+#endif
+
+#if defined(NETPLAY_BROADCAST_THREAD) && defined(__linux__)
+#define NETPLAY_BROADCAST_EPOLL
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+/* Data written by the host and not picked up by the sender yet. */
+#define NETPLAY_BROADCAST_FIFO (256 * 1024)
+
+/* Life of a spectator slot. The host fills a free slot and marks it
+ * pending, the sender takes it over and closes it again, and the
+ * host frees it in netplay_broadcast_reap(). */
+enum netplay_broadcast_slot
+{
+   NETPLAY_BROADCAST_FREE = 0,
+   NETPLAY_BROADCAST_PENDING,
+   NETPLAY_BROADCAST_ACTIVE,
+   NETPLAY_BROADCAST_CLOSED
+};
+
+struct netplay_broadcast_client
+{
+   int fd;
+   retro_atomic_int_t state;
+   enum netplay_broadcast_drop reason;
+
+   uint8_t *header;
+   size_t header_size;
+   size_t header_sent;
+   /* Stream position of the next byte to send. */
+   uint64_t cursor;
+
+#ifdef NETPLAY_BROADCAST_EPOLL
+   uint32_t events;
+#endif
+};
+
+struct netplay_broadcast
+{
+   struct netplay_broadcast_client *clients;
+   unsigned max_clients;
+   /* Slots past this one have never been used. */
+   retro_atomic_int_t num_slots;
+   unsigned num_clients;
+   bool started;
+
+   /* Host side: bytes written so far, and the way to the sender.
+    * overflow is set if the sender fell so far behind that the
+    * host had to drop data. */
+   uint64_t written;
+   spsc_fifo_t *fifo;
+   retro_atomic_int_t overflow;
+
+   /* Sender side: the last history_size bytes of the stream. */
+   uint8_t *history;
+   size_t history_size;
+   uint64_t received;
+
+#ifdef NETPLAY_BROADCAST_THREAD
+   sthread_t *thread;
+   retro_atomic_int_t quit;
+   /* Read and write end of the wakeup pipe. Both are the same
+    * eventfd with epoll. */
+   int wake_fd[2];
+#endif
+#ifdef NETPLAY_BROADCAST_EPOLL
+   int epoll_fd;
+#endif
+};
+
+static void netplay_broadcast_close(netplay_broadcast_t *bcast,
+      struct netplay_broadcast_client *client,
+      enum netplay_broadcast_drop reason)
+{
+#ifdef NETPLAY_BROADCAST_EPOLL
+   epoll_ctl(bcast->epoll_fd, EPOLL_CTL_DEL, client->fd, NULL);
+#endif
+   socket_close(client->fd);
+   free(client->header);
+
+   client->fd     = -1;
+   client->header = NULL;
+   client->reason = reason;
+   retro_atomic_store_release(&client->state, NETPLAY_BROADCAST_CLOSED);
+}
+
+/* Takes over the spectators the host added. */
+static void netplay_broadcast_adopt(netplay_broadcast_t *bcast)
+{
+   unsigned i;
+   unsigned num_slots = retro_atomic_load_acquire(&bcast->num_slots);
+
+   for (i = 0; i < num_slots; i++)
+   {
+      struct netplay_broadcast_client *client = &bcast->clients[i];
+
+      if (retro_atomic_load_acquire(&client->state)
+            != NETPLAY_BROADCAST_PENDING)
+         continue;
+
+#ifdef NETPLAY_BROADCAST_EPOLL
+      {
+         struct epoll_event ev = {0};
+         ev.events             = EPOLLIN;
+         ev.data.u32           = i;
+         client->events        = EPOLLIN;
+
+         if (epoll_ctl(bcast->epoll_fd, EPOLL_CTL_ADD, client->fd, &ev) < 0)
+         {
+            netplay_broadcast_close(bcast, client, NETPLAY_BROADCAST_HANGUP);
+            continue;
+         }
+      }
+#endif
+
+      retro_atomic_store(&client->state, NETPLAY_BROADCAST_ACTIVE);
+   }
+}
+
+/* Moves what the host wrote into the history. */
+static void netplay_broadcast_pull(netplay_broadcast_t *bcast)
+{
+   size_t avail;
+
+   while ((avail = spsc_fifo_read_avail(bcast->fifo)) > 0)
+   {
+      size_t span, pos;
+      const uint8_t *src = (const uint8_t*)spsc_fifo_read_span(
+            bcast->fifo, 0, &span);
+
+      span = MIN(span, avail);
+      pos  = (size_t)(bcast->received % bcast->history_size);
+      span = MIN(span, bcast->history_size - pos);
+
+      memcpy(bcast->history + pos, src, span);
+      spsc_fifo_read_commit(bcast->fifo, span);
+      bcast->received += span;
+   }
+}
+
+/**
+ * netplay_broadcast_flush:
+ * @bcast                : broadcast handle.
+ * @client               : active spectator.
+ *
+ * Sends the spectator as much as its socket takes.
+ *
+ * Returns: true (1) if everything was sent, false (0) if the socket
+ * is full or the spectator was dropped.
+ **/
+static bool netplay_broadcast_flush(netplay_broadcast_t *bcast,
+      struct netplay_broadcast_client *client)
+{
+   while (client->header_sent < client->header_size)
+   {
+      ssize_t ret = send(client->fd,
+            (const char*)client->header + client->header_sent,
+            client->header_size - client->header_sent, MSG_NOSIGNAL);
+
+      if (ret > 0)
+      {
+         client->header_sent += ret;
+         continue;
+      }
+
+      if (ret < 0 && isagain((int)ret))
+         return false;
+
+      netplay_broadcast_close(bcast, client, NETPLAY_BROADCAST_HANGUP);
+      return false;
+   }
+
+   /* The history only holds so much. Spectators that joined after
+    * the sender last pulled are ahead of it, not behind. */
+   if (client->cursor < bcast->received &&
+         bcast->received - client->cursor > bcast->history_size)
+   {
+      netplay_broadcast_close(bcast, client, NETPLAY_BROADCAST_TOO_SLOW);
+      return false;
+   }
+
+   while (client->cursor < bcast->received)
+   {
+      ssize_t ret;
+      size_t pos = (size_t)(client->cursor % bcast->history_size);
+      size_t len = (size_t)MIN(bcast->received - client->cursor,
+            (uint64_t)(bcast->history_size - pos));
+
+      ret = send(client->fd, (const char*)bcast->history + pos, len,
+            MSG_NOSIGNAL);
+
+      if (ret > 0)
+      {
+         client->cursor += ret;
+         continue;
+      }
+
+      if (ret < 0 && isagain((int)ret))
+         return false;
+
+      netplay_broadcast_close(bcast, client, NETPLAY_BROADCAST_HANGUP);
+      return false;
+   }
+
+   return true;
+}
+
+/* Spectators don't send anything, so reading only notices hangups. */
+static void netplay_broadcast_read(netplay_broadcast_t *bcast,
+      struct netplay_broadcast_client *client)
+{
+   char buf[256];
+
+   for (;;)
+   {
+      ssize_t ret = recv(client->fd, buf, sizeof(buf), 0);
+
+      if (ret > 0)
+         continue;
+      if (ret < 0 && isagain((int)ret))
+         return;
+
+      netplay_broadcast_close(bcast, client, NETPLAY_BROADCAST_HANGUP);
+      return;
+   }
+}
+
+/* Returns: true (1) if a spectator is waiting for its socket. */
+static bool netplay_broadcast_update(netplay_broadcast_t *bcast)
+{
+   unsigned i, num_slots;
+   bool blocked = false;
+   bool overflow;
+
+   netplay_broadcast_adopt(bcast);
+   netplay_broadcast_pull(bcast);
+
+   overflow  = retro_atomic_exchange(&bcast->overflow, 0) != 0;
+   num_slots = retro_atomic_load_acquire(&bcast->num_slots);
+
+   for (i = 0; i < num_slots; i++)
+   {
+      struct netplay_broadcast_client *client = &bcast->clients[i];
+      bool flushed;
+
+      if (retro_atomic_load(&client->state) != NETPLAY_BROADCAST_ACTIVE)
+         continue;
+
+      /* Data went missing, so everyone's stream is broken. */
+      if (overflow)
+      {
+         netplay_broadcast_close(bcast, client, NETPLAY_BROADCAST_TOO_SLOW);
+         continue;
+      }
+
+      flushed = netplay_broadcast_flush(bcast, client);
+
+      if (retro_atomic_load(&client->state) != NETPLAY_BROADCAST_ACTIVE)
+         continue;
+
+      if (!flushed)
+         blocked = true;
+
+#ifdef NETPLAY_BROADCAST_EPOLL
+      {
+         uint32_t want = EPOLLIN | (flushed ? 0 : EPOLLOUT);
+
+         if (want != client->events)
+         {
+            struct epoll_event ev = {0};
+            ev.events             = want;
+            ev.data.u32           = i;
+            epoll_ctl(bcast->epoll_fd, EPOLL_CTL_MOD, client->fd, &ev);
+            client->events        = want;
+         }
+      }
+#endif
+   }
+
+   return blocked;
+}
+
+#ifdef NETPLAY_BROADCAST_THREAD
+static void netplay_broadcast_wake(netplay_broadcast_t *bcast)
+{
+   ssize_t ret;
+#ifdef NETPLAY_BROADCAST_EPOLL
+   uint64_t one = 1;
+#else
+   char one     = 1;
+#endif
+
+   /* A full pipe already has a wakeup pending. */
+   ret = write(bcast->wake_fd[1], &one, sizeof(one));
+   (void)ret;
+}
+
+static void netplay_broadcast_drain_wake(netplay_broadcast_t *bcast)
+{
+   char buf[64];
+   while (read(bcast->wake_fd[0], buf, sizeof(buf)) > 0) { }
+}
+
+#ifdef NETPLAY_BROADCAST_EPOLL
+/* The event data is the slot index, the wakeup fd comes last. */
+static void netplay_broadcast_wait(netplay_broadcast_t *bcast)
+{
+   int i, n;
+   struct epoll_event events[64];
+
+   n = epoll_wait(bcast->epoll_fd, events, ARRAY_SIZE(events), -1);
+
+   for (i = 0; i < n; i++)
+   {
+      struct netplay_broadcast_client *client = NULL;
+
+      if (events[i].data.u32 >= bcast->max_clients)
+      {
+         netplay_broadcast_drain_wake(bcast);
+         continue;
+      }
+
+      client = &bcast->clients[events[i].data.u32];
+
+      if (retro_atomic_load(&client->state) == NETPLAY_BROADCAST_ACTIVE &&
+            (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)))
+         netplay_broadcast_read(bcast, client);
+   }
+}
+#else
+static void netplay_broadcast_wait(netplay_broadcast_t *bcast, bool blocked)
+{
+   unsigned i, num_slots;
+   fd_set read_fds, write_fds;
+   int max_fd = bcast->wake_fd[0];
+
+   FD_ZERO(&read_fds);
+   FD_ZERO(&write_fds);
+   FD_SET(bcast->wake_fd[0], &read_fds);
+
+   num_slots = retro_atomic_load_acquire(&bcast->num_slots);
+
+   for (i = 0; i < num_slots; i++)
+   {
+      struct netplay_broadcast_client *client = &bcast->clients[i];
+
+      if (retro_atomic_load(&client->state) != NETPLAY_BROADCAST_ACTIVE)
+         continue;
+
+      FD_SET(client->fd, &read_fds);
+      if (blocked)
+         FD_SET(client->fd, &write_fds);
+      if (client->fd > max_fd)
+         max_fd = client->fd;
+   }
+
+   if (socket_select(max_fd + 1, &read_fds, &write_fds, NULL, NULL) <= 0)
+      return;
+
+   if (FD_ISSET(bcast->wake_fd[0], &read_fds))
+      netplay_broadcast_drain_wake(bcast);
+
+   for (i = 0; i < num_slots; i++)
+   {
+      struct netplay_broadcast_client *client = &bcast->clients[i];
+
+      if (retro_atomic_load(&client->state) == NETPLAY_BROADCAST_ACTIVE &&
+            FD_ISSET(client->fd, &read_fds))
+         netplay_broadcast_read(bcast, client);
+   }
+}
+#endif
+
+static void netplay_broadcast_thread(void *data)
+{
+   netplay_broadcast_t *bcast = (netplay_broadcast_t*)data;
+
+   while (!retro_atomic_load(&bcast->quit))
+   {
+      bool blocked = netplay_broadcast_update(bcast);
+#ifdef NETPLAY_BROADCAST_EPOLL
+      (void)blocked;
+      netplay_broadcast_wait(bcast);
+#else
+      netplay_broadcast_wait(bcast, blocked);
+#endif
+   }
+}
+#endif
+
+netplay_broadcast_t *netplay_broadcast_new(size_t history,
+      unsigned max_clients)
+{
+   netplay_broadcast_t *bcast = (netplay_broadcast_t*)
+      calloc(1, sizeof(*bcast));
+
+   if (!bcast)
+      return NULL;
+
+#ifdef NETPLAY_BROADCAST_THREAD
+   bcast->wake_fd[0] = -1;
+   bcast->wake_fd[1] = -1;
+#endif
+#ifdef NETPLAY_BROADCAST_EPOLL
+   bcast->epoll_fd   = -1;
+#endif
+
+   bcast->max_clients  = max_clients;
+   bcast->history_size = history;
+   bcast->clients      = (struct netplay_broadcast_client*)
+      calloc(max_clients, sizeof(*bcast->clients));
+   bcast->history      = (uint8_t*)malloc(history);
+   bcast->fifo         = spsc_fifo_new(NETPLAY_BROADCAST_FIFO);
+
+   if (!max_clients || !history ||
+         !bcast->clients || !bcast->history || !bcast->fifo)
+      goto error;
+
+#ifdef NETPLAY_BROADCAST_EPOLL
+   bcast->epoll_fd = epoll_create(64);
+   if (bcast->epoll_fd < 0)
+      goto error;
+
+   bcast->wake_fd[0] = eventfd(0, EFD_NONBLOCK);
+   bcast->wake_fd[1] = bcast->wake_fd[0];
+   if (bcast->wake_fd[0] < 0)
+      goto error;
+#elif defined(NETPLAY_BROADCAST_THREAD)
+   if (pipe(bcast->wake_fd) < 0)
+   {
+      bcast->wake_fd[0] = -1;
+      bcast->wake_fd[1] = -1;
+      goto error;
+   }
+
+   fcntl(bcast->wake_fd[0], F_SETFL,
+         fcntl(bcast->wake_fd[0], F_GETFL) | O_NONBLOCK);
+   fcntl(bcast->wake_fd[1], F_SETFL,
+         fcntl(bcast->wake_fd[1], F_GETFL) | O_NONBLOCK);
+#endif
+
+   return bcast;
+
+error:
+   netplay_broadcast_free(bcast);
+   return NULL;
+}
+
+void netplay_broadcast_free(netplay_broadcast_t *bcast)
+{
+   unsigned i;
+
+   if (!bcast)
+      return;
+
+#ifdef NETPLAY_BROADCAST_THREAD
+   if (bcast->thread)
+   {
+      retro_atomic_store(&bcast->quit, 1);
+      netplay_broadcast_wake(bcast);
+      sthread_join(bcast->thread);
+   }
+
+   if (bcast->wake_fd[0] >= 0)
+      close(bcast->wake_fd[0]);
+   if (bcast->wake_fd[1] >= 0 && bcast->wake_fd[1] != bcast->wake_fd[0])
+      close(bcast->wake_fd[1]);
+#endif
+#ifdef NETPLAY_BROADCAST_EPOLL
+   if (bcast->epoll_fd >= 0)
+      close(bcast->epoll_fd);
+#endif
+
+   if (bcast->clients)
+   {
+      for (i = 0; i < bcast->max_clients; i++)
+      {
+         struct netplay_broadcast_client *client = &bcast->clients[i];
+         int state = retro_atomic_load(&client->state);
+
+         if (state == NETPLAY_BROADCAST_PENDING ||
+               state == NETPLAY_BROADCAST_ACTIVE)
+         {
+            socket_close(client->fd);
+            free(client->header);
+         }
+      }
+   }
+
+   if (bcast->fifo)
+      spsc_fifo_free(bcast->fifo);
+   free(bcast->history);
+   free(bcast->clients);
+   free(bcast);
+}
+
+bool netplay_broadcast_start(netplay_broadcast_t *bcast)
+{
+#ifdef NETPLAY_BROADCAST_EPOLL
+   struct epoll_event ev = {0};
+
+   ev.events   = EPOLLIN;
+   ev.data.u32 = bcast->max_clients;
+   if (epoll_ctl(bcast->epoll_fd, EPOLL_CTL_ADD, bcast->wake_fd[0], &ev) < 0)
+      return false;
+#endif
+
+#ifdef NETPLAY_BROADCAST_THREAD
+   bcast->thread = sthread_create(netplay_broadcast_thread, bcast);
+   if (!bcast->thread)
+      return false;
+#endif
+
+   bcast->started = true;
+   return true;
+}
+
+int netplay_broadcast_add(netplay_broadcast_t *bcast, int fd,
+      const void *header, size_t header_size)
+{
+   unsigned i;
+   struct netplay_broadcast_client *client = NULL;
+   unsigned num_slots = retro_atomic_load(&bcast->num_slots);
+
+   for (i = 0; i < bcast->max_clients; i++)
+   {
+      if (retro_atomic_load_acquire(&bcast->clients[i].state)
+            == NETPLAY_BROADCAST_FREE)
+      {
+         client = &bcast->clients[i];
+         break;
+      }
+   }
+
+#if defined(NETPLAY_BROADCAST_THREAD) && !defined(NETPLAY_BROADCAST_EPOLL)
+   /* select() can't watch it. */
+   if (fd >= FD_SETSIZE)
+      client = NULL;
+#endif
+
+   if (!client || !socket_nonblock(fd))
+      goto error;
+
+   client->header = NULL;
+   if (header_size)
+   {
+      client->header = (uint8_t*)malloc(header_size);
+      if (!client->header)
+         goto error;
+      memcpy(client->header, header, header_size);
+   }
+
+   client->fd          = fd;
+   client->header_size = header_size;
+   client->header_sent = 0;
+   client->cursor      = bcast->written;
+
+   retro_atomic_store_release(&client->state, NETPLAY_BROADCAST_PENDING);
+   if (i >= num_slots)
+      retro_atomic_store_release(&bcast->num_slots, (int)(i + 1));
+
+   bcast->num_clients++;
+
+#ifdef NETPLAY_BROADCAST_THREAD
+   if (bcast->started)
+      netplay_broadcast_wake(bcast);
+#else
+   netplay_broadcast_update(bcast);
+#endif
+
+   return (int)i;
+
+error:
+   socket_close(fd);
+   return -1;
+}
+
+void netplay_broadcast_write(netplay_broadcast_t *bcast,
+      const void *data, size_t size)
+{
+   if (!size)
+      return;
+
+   if (spsc_fifo_write_avail(bcast->fifo) < size)
+      retro_atomic_store(&bcast->overflow, 1);
+   else
+   {
+      spsc_fifo_write(bcast->fifo, data, size);
+      bcast->written += size;
+   }
+
+#ifdef NETPLAY_BROADCAST_THREAD
+   if (bcast->started)
+      netplay_broadcast_wake(bcast);
+#else
+   netplay_broadcast_update(bcast);
+#endif
+}
+
+int netplay_broadcast_reap(netplay_broadcast_t *bcast,
+      enum netplay_broadcast_drop *reason)
+{
+   unsigned i;
+   unsigned num_slots = retro_atomic_load(&bcast->num_slots);
+
+   for (i = 0; i < num_slots; i++)
+   {
+      struct netplay_broadcast_client *client = &bcast->clients[i];
+
+      if (retro_atomic_load_acquire(&client->state)
+            != NETPLAY_BROADCAST_CLOSED)
+         continue;
+
+      if (reason)
+         *reason = client->reason;
+
+      retro_atomic_store(&client->state, NETPLAY_BROADCAST_FREE);
+      bcast->num_clients--;
+      return (int)i;
+   }
+
+   return -1;
+}
+
+unsigned netplay_broadcast_clients(netplay_broadcast_t *bcast)
+{
+   return bcast->num_clients;
+}
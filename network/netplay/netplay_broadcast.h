@@ -0,0 +1,113 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2016 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_NETPLAY_BROADCAST_H
+#define __RARCH_NETPLAY_BROADCAST_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <boolean.h>
+
+/* Sends one byte stream to many spectators.
+ *
+ * The host writes each frame's data once. A sender thread keeps the
+ * most recent data in a history ring and streams it to every
+ * spectator from that spectator's own position, over non-blocking
+ * sockets (epoll on Linux, select() elsewhere). A spectator that
+ * falls further behind than the ring holds is dropped, so a slow one
+ * never holds up the host or the others.
+ *
+ * Without thread support, the sockets are serviced from
+ * netplay_broadcast_write() instead.
+ *
+ * All functions must be called from the same thread. */
+
+typedef struct netplay_broadcast netplay_broadcast_t;
+
+enum netplay_broadcast_drop
+{
+   /* The spectator closed the connection, or it failed. */
+   NETPLAY_BROADCAST_HANGUP = 0,
+   /* The spectator fell too far behind. */
+   NETPLAY_BROADCAST_TOO_SLOW
+};
+
+/**
+ * netplay_broadcast_new:
+ * @history              : bytes a spectator may fall behind.
+ * @max_clients          : spectators at most.
+ *
+ * Returns: new broadcast handle, or NULL on failure.
+ **/
+netplay_broadcast_t *netplay_broadcast_new(size_t history,
+      unsigned max_clients);
+
+/* Stops the sender thread and closes all spectator sockets. */
+void netplay_broadcast_free(netplay_broadcast_t *bcast);
+
+/**
+ * netplay_broadcast_start:
+ * @bcast                : broadcast handle.
+ *
+ * Starts the sender thread, if there is one.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+bool netplay_broadcast_start(netplay_broadcast_t *bcast);
+
+/**
+ * netplay_broadcast_add:
+ * @bcast                : broadcast handle.
+ * @fd                   : connected socket. Owned by @bcast from now on,
+ *                         even on failure.
+ * @header               : sent to this spectator first, may be NULL.
+ * @header_size          : size of @header.
+ *
+ * Adds a spectator, which gets everything written from now on.
+ *
+ * Returns: spectator index, or -1 on failure.
+ **/
+int netplay_broadcast_add(netplay_broadcast_t *bcast, int fd,
+      const void *header, size_t header_size);
+
+/**
+ * netplay_broadcast_write:
+ * @bcast                : broadcast handle.
+ * @data                 : data to send to all spectators.
+ * @size                 : size of @data.
+ *
+ * Queues @data for every spectator. Never blocks.
+ **/
+void netplay_broadcast_write(netplay_broadcast_t *bcast,
+      const void *data, size_t size);
+
+/**
+ * netplay_broadcast_reap:
+ * @bcast                : broadcast handle.
+ * @reason               : set to why the spectator was dropped.
+ *
+ * Frees the slot of a dropped spectator.
+ *
+ * Returns: index of the dropped spectator, or -1 if there is none.
+ **/
+int netplay_broadcast_reap(netplay_broadcast_t *bcast,
+      enum netplay_broadcast_drop *reason);
+
+/* Spectators connected and not dropped yet. */
+unsigned netplay_broadcast_clients(netplay_broadcast_t *bcast);
+
+#endif
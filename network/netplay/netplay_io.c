@@ -0,0 +1,811 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2016 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <net/net_compat.h>
+#include <net/net_socket.h>
+#include <features/features_cpu.h>
+#include <queues/spsc_fifo.h>
+#include <retro_atomic.h>
+#include <retro_miscellaneous.h>
+
+#include "netplay_io.h"
+
+/* The wakeup descriptor for the I/O thread needs pipe() or eventfd(). */
+#if defined(HAVE_THREADS) && (defined(__unix__) || defined(__APPLE__))
+#define NETPLAY_IO_THREAD
+#include <unistd.h>
+#include <fcntl.h>
+#include <rthreads/rthreads.h>
+#endif
+
+#if defined(NETPLAY_IO_THREAD) && defined(__linux__)
+#define NETPLAY_IO_EPOLL
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+/* Netplay commands are at most 64 KB plus their header. */
+#define NETPLAY_IO_STREAM_BUFFER   (128 * 1024)
+#define NETPLAY_IO_DATAGRAM_BUFFER (64 * 1024)
+
+/* Stream reads whose arrival time is kept, see netplay_io_recv_time(). */
+#define NETPLAY_IO_ARRIVALS        64
+
+/* Precedes each datagram in the receive queue. */
+struct netplay_io_packet_header
+{
+   uint32_t size;
+   struct sockaddr_storage addr;
+};
+
+struct netplay_io_arrival
+{
+   /* Stream position just past the bytes read. */
+   uint64_t end;
+   retro_time_t time;
+};
+
+struct netplay_io_conn
+{
+   int fd;
+   enum netplay_io_type type;
+
+   /* Filled by the caller, drained by the I/O side. Streams only. */
+   spsc_fifo_t *send_fifo;
+   /* Filled by the I/O side, drained by the caller. */
+   spsc_fifo_t *recv_fifo;
+
+   retro_atomic_int_t failed;
+   retro_atomic_int_t dropped;
+   /* Set while the I/O side stops reading because recv_fifo is full. */
+   retro_atomic_int_t recv_stalled;
+
+   /* Written by the I/O side under the lock. Streams only. */
+   struct netplay_io_arrival arrivals[NETPLAY_IO_ARRIVALS];
+   unsigned num_arrivals;
+   uint64_t received;
+   /* Bytes read by the caller. */
+   uint64_t consumed;
+
+#ifdef NETPLAY_IO_EPOLL
+   uint32_t events;
+   /* Set while the socket is out of the epoll set, because it hung up
+    * with recv_fifo full. epoll reports EPOLLHUP whether or not it was
+    * asked for, so the socket can't stay in the set until the caller
+    * has made room for the rest of the data. */
+   bool parked;
+#endif
+};
+
+struct netplay_io
+{
+   struct netplay_io_conn conns[NETPLAY_IO_MAX_CONNS];
+   unsigned num_conns;
+   bool started;
+
+   /* Bumped by the I/O side whenever there is something new for the
+    * caller. netplay_io_wait() compares it against seen_seq. */
+   retro_atomic_int_t seq;
+   int seen_seq;
+
+   /* Used by the I/O side only. */
+   uint8_t datagram[NETPLAY_IO_MAX_DATAGRAM];
+
+#ifdef NETPLAY_IO_THREAD
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+   retro_atomic_int_t quit;
+   /* Read and write end of the wakeup pipe. Both are the same
+    * eventfd with epoll. */
+   int wake_fd[2];
+#endif
+#ifdef NETPLAY_IO_EPOLL
+   int epoll_fd;
+#endif
+};
+
+static void netplay_io_notify(netplay_io_t *io)
+{
+   retro_atomic_fetch_add(&io->seq, 1);
+
+#ifdef NETPLAY_IO_THREAD
+   slock_lock(io->lock);
+   scond_signal(io->cond);
+   slock_unlock(io->lock);
+#endif
+}
+
+static void netplay_io_fail(netplay_io_t *io, struct netplay_io_conn *conn)
+{
+   if (retro_atomic_exchange(&conn->failed, 1))
+      return;
+
+#ifdef NETPLAY_IO_EPOLL
+   epoll_ctl(io->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+#endif
+   netplay_io_notify(io);
+}
+
+/* Records that @size bytes were read at @time. */
+static void netplay_io_stamp(netplay_io_t *io, struct netplay_io_conn *conn,
+      size_t size, retro_time_t time)
+{
+   struct netplay_io_arrival *arrival;
+
+#ifdef NETPLAY_IO_THREAD
+   slock_lock(io->lock);
+#endif
+   conn->received += size;
+   arrival         = &conn->arrivals[
+      conn->num_arrivals++ % NETPLAY_IO_ARRIVALS];
+   arrival->end    = conn->received;
+   arrival->time   = time;
+#ifdef NETPLAY_IO_THREAD
+   slock_unlock(io->lock);
+#endif
+}
+
+static void netplay_io_read_stream(netplay_io_t *io,
+      struct netplay_io_conn *conn)
+{
+   size_t received   = 0;
+   retro_time_t time = cpu_features_get_time_usec();
+
+   for (;;)
+   {
+      ssize_t ret;
+      size_t span;
+      void *buf;
+
+      if (!spsc_fifo_write_avail(conn->recv_fifo))
+      {
+         /* Leave the rest in the socket until the caller catches up,
+          * which makes TCP throttle the peer. */
+         retro_atomic_store(&conn->recv_stalled, 1);
+         break;
+      }
+
+      buf = spsc_fifo_write_span(conn->recv_fifo, 0, &span);
+      ret = recv(conn->fd, (char*)buf, span, 0);
+
+      if (ret > 0)
+      {
+         spsc_fifo_write_commit(conn->recv_fifo, ret);
+         received += ret;
+         continue;
+      }
+
+      if (ret < 0 && isagain((int)ret))
+         break;
+
+      /* Closed by the peer, or failed. */
+      netplay_io_fail(io, conn);
+      break;
+   }
+
+   if (received)
+   {
+      netplay_io_stamp(io, conn, received, time);
+      netplay_io_notify(io);
+   }
+}
+
+static void netplay_io_read_datagrams(netplay_io_t *io,
+      struct netplay_io_conn *conn)
+{
+   bool received = false;
+
+   for (;;)
+   {
+      struct netplay_io_packet_header header;
+      socklen_t addrlen = sizeof(header.addr);
+      ssize_t ret       = recvfrom(conn->fd, (char*)io->datagram,
+            sizeof(io->datagram), 0,
+            (struct sockaddr*)&header.addr, &addrlen);
+
+      /* Errors on datagram sockets are mostly ICMP replies to
+       * earlier sends, which don't make the socket unusable. */
+      if (ret < 0)
+         break;
+
+      if ((size_t)ret >= sizeof(io->datagram) ||
+            spsc_fifo_write_avail(conn->recv_fifo)
+            < sizeof(header) + ret)
+      {
+         retro_atomic_fetch_add(&conn->dropped, 1);
+         continue;
+      }
+
+      header.size = (uint32_t)ret;
+      spsc_fifo_write_at(conn->recv_fifo, 0, &header, sizeof(header));
+      spsc_fifo_write_at(conn->recv_fifo, sizeof(header),
+            io->datagram, ret);
+      spsc_fifo_write_commit(conn->recv_fifo, sizeof(header) + ret);
+      received = true;
+   }
+
+   if (received)
+      netplay_io_notify(io);
+}
+
+static void netplay_io_read(netplay_io_t *io, struct netplay_io_conn *conn)
+{
+   if (retro_atomic_load(&conn->failed))
+      return;
+
+   if (conn->type == NETPLAY_IO_STREAM)
+      netplay_io_read_stream(io, conn);
+   else
+      netplay_io_read_datagrams(io, conn);
+}
+
+/* Returns true if everything queued was sent. */
+static bool netplay_io_flush(netplay_io_t *io, struct netplay_io_conn *conn)
+{
+   if (conn->type != NETPLAY_IO_STREAM ||
+         retro_atomic_load(&conn->failed))
+      return true;
+
+   while (spsc_fifo_read_avail(conn->send_fifo))
+   {
+      size_t span;
+      const void *buf = spsc_fifo_read_span(conn->send_fifo, 0, &span);
+      ssize_t ret     = send(conn->fd, (const char*)buf, span, MSG_NOSIGNAL);
+
+      if (ret > 0)
+      {
+         spsc_fifo_read_commit(conn->send_fifo, ret);
+         continue;
+      }
+
+      if (ret < 0 && isagain((int)ret))
+         return false;
+
+      netplay_io_fail(io, conn);
+      return true;
+   }
+
+   return true;
+}
+
+static bool netplay_io_want_read(struct netplay_io_conn *conn)
+{
+   if (conn->type != NETPLAY_IO_STREAM)
+      return true;
+   if (spsc_fifo_write_avail(conn->recv_fifo))
+   {
+      retro_atomic_store(&conn->recv_stalled, 0);
+      return true;
+   }
+   return false;
+}
+
+#ifdef NETPLAY_IO_THREAD
+static void netplay_io_wake(netplay_io_t *io)
+{
+   ssize_t ret;
+#ifdef NETPLAY_IO_EPOLL
+   uint64_t one = 1;
+#else
+   char one     = 1;
+#endif
+
+   /* A full pipe already has a wakeup pending. */
+   ret = write(io->wake_fd[1], &one, sizeof(one));
+   (void)ret;
+}
+
+static void netplay_io_drain_wake(netplay_io_t *io)
+{
+   char buf[64];
+   while (read(io->wake_fd[0], buf, sizeof(buf)) > 0) { }
+}
+#endif
+
+#ifdef NETPLAY_IO_EPOLL
+/* The event data is the connection index, the wakeup fd
+ * comes last. */
+static void netplay_io_service(netplay_io_t *io)
+{
+   int i, n;
+   struct epoll_event events[NETPLAY_IO_MAX_CONNS + 1];
+   unsigned c;
+
+   for (c = 0; c < io->num_conns; c++)
+   {
+      struct netplay_io_conn *conn = &io->conns[c];
+      uint32_t want                = 0;
+
+      if (retro_atomic_load(&conn->failed))
+         continue;
+
+      if (conn->parked)
+      {
+         struct epoll_event ev = {0};
+
+         if (!netplay_io_want_read(conn))
+            continue;
+
+         /* The remaining data, then the hangup, is read as soon as
+          * the socket is back in the set. */
+         ev.events    = EPOLLIN;
+         ev.data.u32  = c;
+         epoll_ctl(io->epoll_fd, EPOLL_CTL_ADD, conn->fd, &ev);
+         conn->events = EPOLLIN;
+         conn->parked = false;
+         continue;
+      }
+
+      if (!netplay_io_flush(io, conn))
+         want |= EPOLLOUT;
+      if (netplay_io_want_read(conn))
+         want |= EPOLLIN;
+
+      if (want != conn->events && !retro_atomic_load(&conn->failed))
+      {
+         struct epoll_event ev = {0};
+         ev.events             = want;
+         ev.data.u32           = c;
+         epoll_ctl(io->epoll_fd, EPOLL_CTL_MOD, conn->fd, &ev);
+         conn->events          = want;
+      }
+   }
+
+   n = epoll_wait(io->epoll_fd, events, ARRAY_SIZE(events), -1);
+
+   for (i = 0; i < n; i++)
+   {
+      struct netplay_io_conn *conn = NULL;
+
+      if (events[i].data.u32 >= io->num_conns)
+      {
+         netplay_io_drain_wake(io);
+         continue;
+      }
+
+      conn = &io->conns[events[i].data.u32];
+
+      if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+         netplay_io_read(io, conn);
+      if (events[i].events & EPOLLOUT)
+         netplay_io_flush(io, conn);
+
+      if (     (events[i].events & (EPOLLERR | EPOLLHUP))
+            && !retro_atomic_load(&conn->failed)
+            && !netplay_io_want_read(conn))
+      {
+         epoll_ctl(io->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+         conn->events = 0;
+         conn->parked = true;
+      }
+   }
+}
+#else
+/* @timeout_ms of -1 waits indefinitely. */
+static void netplay_io_service(netplay_io_t *io, int timeout_ms)
+{
+   unsigned c;
+   fd_set read_fds, write_fds;
+   struct timeval tv;
+   int max_fd = -1;
+
+   FD_ZERO(&read_fds);
+   FD_ZERO(&write_fds);
+
+#ifdef NETPLAY_IO_THREAD
+   FD_SET(io->wake_fd[0], &read_fds);
+   max_fd = io->wake_fd[0];
+#endif
+
+   for (c = 0; c < io->num_conns; c++)
+   {
+      struct netplay_io_conn *conn = &io->conns[c];
+
+      if (retro_atomic_load(&conn->failed))
+         continue;
+
+      if (!netplay_io_flush(io, conn))
+         FD_SET(conn->fd, &write_fds);
+      if (netplay_io_want_read(conn))
+         FD_SET(conn->fd, &read_fds);
+
+      if (conn->fd > max_fd)
+         max_fd = conn->fd;
+   }
+
+   tv.tv_sec  = timeout_ms / 1000;
+   tv.tv_usec = (timeout_ms % 1000) * 1000;
+
+   if (socket_select(max_fd + 1, &read_fds, &write_fds, NULL,
+            timeout_ms < 0 ? NULL : &tv) <= 0)
+      return;
+
+#ifdef NETPLAY_IO_THREAD
+   if (FD_ISSET(io->wake_fd[0], &read_fds))
+      netplay_io_drain_wake(io);
+#endif
+
+   for (c = 0; c < io->num_conns; c++)
+   {
+      struct netplay_io_conn *conn = &io->conns[c];
+
+      if (FD_ISSET(conn->fd, &read_fds))
+         netplay_io_read(io, conn);
+      if (FD_ISSET(conn->fd, &write_fds))
+         netplay_io_flush(io, conn);
+   }
+}
+#endif
+
+#ifdef NETPLAY_IO_THREAD
+static void netplay_io_thread(void *data)
+{
+   netplay_io_t *io = (netplay_io_t*)data;
+
+   while (!retro_atomic_load(&io->quit))
+   {
+#ifdef NETPLAY_IO_EPOLL
+      netplay_io_service(io);
+#else
+      netplay_io_service(io, -1);
+#endif
+   }
+}
+#endif
+
+netplay_io_t *netplay_io_new(void)
+{
+   netplay_io_t *io = (netplay_io_t*)calloc(1, sizeof(*io));
+
+   if (!io)
+      return NULL;
+
+#ifdef NETPLAY_IO_THREAD
+   io->wake_fd[0] = -1;
+   io->wake_fd[1] = -1;
+
+   io->lock = slock_new();
+   io->cond = scond_new();
+   if (!io->lock || !io->cond)
+      goto error;
+
+#ifdef NETPLAY_IO_EPOLL
+   io->epoll_fd = epoll_create(NETPLAY_IO_MAX_CONNS + 1);
+   if (io->epoll_fd < 0)
+      goto error;
+
+   io->wake_fd[0] = eventfd(0, EFD_NONBLOCK);
+   io->wake_fd[1] = io->wake_fd[0];
+   if (io->wake_fd[0] < 0)
+      goto error;
+#else
+   if (pipe(io->wake_fd) < 0)
+   {
+      io->wake_fd[0] = -1;
+      io->wake_fd[1] = -1;
+      goto error;
+   }
+
+   fcntl(io->wake_fd[0], F_SETFL, fcntl(io->wake_fd[0], F_GETFL) | O_NONBLOCK);
+   fcntl(io->wake_fd[1], F_SETFL, fcntl(io->wake_fd[1], F_GETFL) | O_NONBLOCK);
+#endif
+#endif
+
+   return io;
+
+#ifdef NETPLAY_IO_THREAD
+error:
+   netplay_io_free(io);
+   return NULL;
+#endif
+}
+
+void netplay_io_free(netplay_io_t *io)
+{
+   unsigned c;
+
+   if (!io)
+      return;
+
+#ifdef NETPLAY_IO_THREAD
+   if (io->thread)
+   {
+      retro_atomic_store(&io->quit, 1);
+      netplay_io_wake(io);
+      sthread_join(io->thread);
+   }
+
+   if (io->wake_fd[0] >= 0)
+      close(io->wake_fd[0]);
+   if (io->wake_fd[1] >= 0 && io->wake_fd[1] != io->wake_fd[0])
+      close(io->wake_fd[1]);
+#ifdef NETPLAY_IO_EPOLL
+   if (io->epoll_fd >= 0)
+      close(io->epoll_fd);
+#endif
+   if (io->cond)
+      scond_free(io->cond);
+   if (io->lock)
+      slock_free(io->lock);
+#endif
+
+   for (c = 0; c < io->num_conns; c++)
+   {
+      if (io->conns[c].send_fifo)
+         spsc_fifo_free(io->conns[c].send_fifo);
+      if (io->conns[c].recv_fifo)
+         spsc_fifo_free(io->conns[c].recv_fifo);
+   }
+
+   free(io);
+}
+
+int netplay_io_add(netplay_io_t *io, int fd, enum netplay_io_type type)
+{
+   struct netplay_io_conn *conn = NULL;
+
+   if (io->started || io->num_conns >= NETPLAY_IO_MAX_CONNS || fd < 0)
+      return -1;
+
+   if (!socket_nonblock(fd))
+      return -1;
+
+   conn       = &io->conns[io->num_conns];
+   conn->fd   = fd;
+   conn->type = type;
+
+   if (type == NETPLAY_IO_STREAM)
+   {
+      conn->send_fifo = spsc_fifo_new(NETPLAY_IO_STREAM_BUFFER);
+      conn->recv_fifo = spsc_fifo_new(NETPLAY_IO_STREAM_BUFFER);
+   }
+   else
+      conn->recv_fifo = spsc_fifo_new(NETPLAY_IO_DATAGRAM_BUFFER);
+
+   if (!conn->recv_fifo || (type == NETPLAY_IO_STREAM && !conn->send_fifo))
+   {
+      if (conn->send_fifo)
+         spsc_fifo_free(conn->send_fifo);
+      if (conn->recv_fifo)
+         spsc_fifo_free(conn->recv_fifo);
+      memset(conn, 0, sizeof(*conn));
+      return -1;
+   }
+
+   return io->num_conns++;
+}
+
+bool netplay_io_start(netplay_io_t *io)
+{
+#ifdef NETPLAY_IO_EPOLL
+   unsigned c;
+   struct epoll_event ev = {0};
+
+   for (c = 0; c < io->num_conns; c++)
+   {
+      ev.events            = EPOLLIN;
+      ev.data.u32          = c;
+      io->conns[c].events  = EPOLLIN;
+
+      if (epoll_ctl(io->epoll_fd, EPOLL_CTL_ADD, io->conns[c].fd, &ev) < 0)
+         return false;
+   }
+
+   ev.events   = EPOLLIN;
+   ev.data.u32 = NETPLAY_IO_MAX_CONNS;
+   if (epoll_ctl(io->epoll_fd, EPOLL_CTL_ADD, io->wake_fd[0], &ev) < 0)
+      return false;
+#endif
+
+#ifdef NETPLAY_IO_THREAD
+   io->thread = sthread_create(netplay_io_thread, io);
+   if (!io->thread)
+      return false;
+#endif
+
+   io->started = true;
+   return true;
+}
+
+bool netplay_io_alive(netplay_io_t *io, int conn)
+{
+   return !retro_atomic_load(&io->conns[conn].failed);
+}
+
+static bool netplay_io_changed(netplay_io_t *io)
+{
+   int seq = retro_atomic_load_acquire(&io->seq);
+
+   if (seq == io->seen_seq)
+      return false;
+
+   io->seen_seq = seq;
+   return true;
+}
+
+bool netplay_io_wait(netplay_io_t *io, unsigned timeout_ms)
+{
+   retro_time_t deadline;
+   bool changed = netplay_io_changed(io);
+
+   if (changed || !timeout_ms)
+   {
+#ifndef NETPLAY_IO_THREAD
+      if (!changed)
+      {
+         netplay_io_service(io, 0);
+         changed = netplay_io_changed(io);
+      }
+#endif
+      return changed;
+   }
+
+   deadline = cpu_features_get_time_usec() + timeout_ms * 1000;
+
+#ifdef NETPLAY_IO_THREAD
+   slock_lock(io->lock);
+   while (!(changed = netplay_io_changed(io)))
+   {
+      retro_time_t left = deadline - cpu_features_get_time_usec();
+      if (left <= 0)
+         break;
+      scond_wait_timeout(io->cond, io->lock, left);
+   }
+   slock_unlock(io->lock);
+#else
+   while (!(changed = netplay_io_changed(io)))
+   {
+      retro_time_t left = deadline - cpu_features_get_time_usec();
+      if (left <= 0)
+         break;
+      netplay_io_service(io, (int)((left + 999) / 1000));
+   }
+#endif
+
+   return changed;
+}
+
+bool netplay_io_send(netplay_io_t *io, int conn,
+      const void *data, size_t size)
+{
+   struct netplay_io_conn *c = &io->conns[conn];
+
+   if (retro_atomic_load(&c->failed) ||
+         spsc_fifo_write_avail(c->send_fifo) < size)
+      return false;
+
+   spsc_fifo_write(c->send_fifo, data, size);
+
+#ifdef NETPLAY_IO_THREAD
+   netplay_io_wake(io);
+#else
+   netplay_io_flush(io, c);
+#endif
+   return !retro_atomic_load(&c->failed);
+}
+
+size_t netplay_io_recv_avail(netplay_io_t *io, int conn)
+{
+#ifndef NETPLAY_IO_THREAD
+   netplay_io_service(io, 0);
+#endif
+   return spsc_fifo_read_avail(io->conns[conn].recv_fifo);
+}
+
+bool netplay_io_recv(netplay_io_t *io, int conn,
+      void *data, size_t size, bool peek)
+{
+   struct netplay_io_conn *c = &io->conns[conn];
+
+   if (netplay_io_recv_avail(io, conn) < size)
+      return false;
+
+   if (peek)
+   {
+      spsc_fifo_read_at(c->recv_fifo, 0, data, size);
+      return true;
+   }
+
+   if (data)
+      spsc_fifo_read(c->recv_fifo, data, size);
+   else
+      spsc_fifo_read_commit(c->recv_fifo, size);
+   c->consumed += size;
+
+#ifdef NETPLAY_IO_THREAD
+   if (retro_atomic_load(&c->recv_stalled))
+      netplay_io_wake(io);
+#endif
+   return true;
+}
+
+retro_time_t netplay_io_recv_time(netplay_io_t *io, int conn)
+{
+   unsigned i;
+   retro_time_t time         = 0;
+   struct netplay_io_conn *c = &io->conns[conn];
+
+#ifdef NETPLAY_IO_THREAD
+   slock_lock(io->lock);
+#endif
+   i = c->num_arrivals > NETPLAY_IO_ARRIVALS ?
+      c->num_arrivals - NETPLAY_IO_ARRIVALS : 0;
+
+   for (; i < c->num_arrivals; i++)
+   {
+      const struct netplay_io_arrival *arrival =
+         &c->arrivals[i % NETPLAY_IO_ARRIVALS];
+
+      if (arrival->end > c->consumed)
+      {
+         time = arrival->time;
+         break;
+      }
+   }
+#ifdef NETPLAY_IO_THREAD
+   slock_unlock(io->lock);
+#endif
+
+   return time ? time : cpu_features_get_time_usec();
+}
+
+bool netplay_io_sendto(netplay_io_t *io, int conn,
+      const void *data, size_t size,
+      const struct sockaddr *addr, socklen_t addrlen)
+{
+   ssize_t ret = sendto(io->conns[conn].fd, (const char*)data, size, 0,
+         addr, addrlen);
+
+   if (ret == (ssize_t)size || isagain((int)ret))
+      return true;
+   return false;
+}
+
+bool netplay_io_packet_avail(netplay_io_t *io, int conn)
+{
+   return netplay_io_recv_avail(io, conn) != 0;
+}
+
+bool netplay_io_packet(netplay_io_t *io, int conn,
+      void *data, size_t *size, struct sockaddr_storage *addr)
+{
+   struct netplay_io_packet_header header;
+   struct netplay_io_conn *c = &io->conns[conn];
+   size_t copy;
+
+   if (!netplay_io_packet_avail(io, conn))
+      return false;
+
+   spsc_fifo_read(c->recv_fifo, &header, sizeof(header));
+
+   copy = header.size < *size ? header.size : *size;
+   spsc_fifo_read_at(c->recv_fifo, 0, data, copy);
+   spsc_fifo_read_commit(c->recv_fifo, header.size);
+
+   *size = header.size;
+   if (addr)
+      memcpy(addr, &header.addr, sizeof(*addr));
+   return true;
+}
+
+unsigned netplay_io_packets_dropped(netplay_io_t *io, int conn)
+{
+   return retro_atomic_load(&io->conns[conn].dropped);
+}
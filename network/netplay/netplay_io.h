@@ -0,0 +1,206 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2016 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_NETPLAY_IO_H
+#define __RARCH_NETPLAY_IO_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <boolean.h>
+#include <net/net_compat.h>
+#include <libretro.h>
+
+/* Non-blocking transport for netplay.
+ *
+ * Sockets are switched to non-blocking mode and serviced by an I/O
+ * thread (epoll on Linux, select() elsewhere), which moves data
+ * between the sockets and per-connection ring buffers. The emulation
+ * thread only ever touches the ring buffers, so a slow or stalled
+ * peer can't block a frame.
+ *
+ * Without thread support, the sockets are serviced from
+ * netplay_io_wait() and netplay_io_send() instead. They are still
+ * non-blocking, so the only difference is latency.
+ *
+ * Connections are added before netplay_io_start() and live until
+ * netplay_io_free(). The functions taking a connection index must
+ * all be called from the same thread. */
+
+#define NETPLAY_IO_MAX_CONNS    4
+/* Larger datagrams are truncated and dropped. */
+#define NETPLAY_IO_MAX_DATAGRAM 2048
+
+typedef struct netplay_io netplay_io_t;
+
+enum netplay_io_type
+{
+   /* TCP: a byte stream in each direction. */
+   NETPLAY_IO_STREAM = 0,
+   /* UDP: incoming datagrams are queued along with their source
+    * address. Outgoing datagrams are sent directly, see
+    * netplay_io_sendto(). */
+   NETPLAY_IO_DATAGRAM
+};
+
+netplay_io_t *netplay_io_new(void);
+
+/**
+ * netplay_io_free:
+ * @io                   : transport handle.
+ *
+ * Stops the I/O thread. The sockets are left open, but in
+ * non-blocking mode.
+ **/
+void netplay_io_free(netplay_io_t *io);
+
+/**
+ * netplay_io_add:
+ * @io                   : transport handle.
+ * @fd                   : connected or bound socket.
+ * @type                 : socket type.
+ *
+ * Switches @fd to non-blocking mode and adds it to @io.
+ * Must be called before netplay_io_start().
+ *
+ * Returns: connection index, or -1 on failure.
+ **/
+int netplay_io_add(netplay_io_t *io, int fd, enum netplay_io_type type);
+
+/**
+ * netplay_io_start:
+ * @io                   : transport handle.
+ *
+ * Starts servicing the connections, on the I/O thread if
+ * there is one.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+bool netplay_io_start(netplay_io_t *io);
+
+/**
+ * netplay_io_alive:
+ * @io                   : transport handle.
+ * @conn                 : connection index.
+ *
+ * Returns: false (0) once the connection has failed or
+ * the peer has closed it, otherwise true (1).
+ **/
+bool netplay_io_alive(netplay_io_t *io, int conn);
+
+/**
+ * netplay_io_wait:
+ * @io                   : transport handle.
+ * @timeout_ms           : maximum time to wait.
+ *
+ * Waits until data has been received on any connection or any
+ * connection failed. Returns right away if either is already
+ * the case.
+ *
+ * Returns: true (1) if there is something to handle, false (0)
+ * on timeout.
+ **/
+bool netplay_io_wait(netplay_io_t *io, unsigned timeout_ms);
+
+/**
+ * netplay_io_send:
+ * @io                   : transport handle.
+ * @conn                 : stream connection index.
+ * @data                 : data to send.
+ * @size                 : size of data.
+ *
+ * Queues @size bytes for sending. Never blocks.
+ *
+ * Returns: true (1) if successful, false (0) if the connection
+ * failed or the send buffer is full, in which case nothing
+ * is queued.
+ **/
+bool netplay_io_send(netplay_io_t *io, int conn,
+      const void *data, size_t size);
+
+/* Bytes received on a stream connection and not read yet. */
+size_t netplay_io_recv_avail(netplay_io_t *io, int conn);
+
+/**
+ * netplay_io_recv:
+ * @io                   : transport handle.
+ * @conn                 : stream connection index.
+ * @data                 : buffer to read into, or NULL to discard.
+ * @size                 : size of data.
+ * @peek                 : if true, leave the data in the buffer.
+ *
+ * Reads exactly @size bytes. Never blocks.
+ *
+ * Returns: true (1) if successful, false (0) if fewer than @size
+ * bytes are available, in which case nothing is read.
+ **/
+bool netplay_io_recv(netplay_io_t *io, int conn,
+      void *data, size_t size, bool peek);
+
+/**
+ * netplay_io_recv_time:
+ * @io                   : transport handle.
+ * @conn                 : stream connection index.
+ *
+ * Unlike the time it is read, this doesn't depend on how often the
+ * caller checks for data.
+ *
+ * Returns: when the next byte to be read from @conn was received,
+ * or the current time if that is no longer known.
+ **/
+retro_time_t netplay_io_recv_time(netplay_io_t *io, int conn);
+
+/**
+ * netplay_io_sendto:
+ * @io                   : transport handle.
+ * @conn                 : datagram connection index.
+ * @data                 : datagram.
+ * @size                 : size of datagram.
+ * @addr                 : destination address.
+ * @addrlen              : size of @addr.
+ *
+ * Sends a datagram right away. A full socket send buffer drops
+ * the datagram, as a lossy network would.
+ *
+ * Returns: false (0) on socket errors, otherwise true (1).
+ **/
+bool netplay_io_sendto(netplay_io_t *io, int conn,
+      const void *data, size_t size,
+      const struct sockaddr *addr, socklen_t addrlen);
+
+/* True if a datagram is queued on @conn. */
+bool netplay_io_packet_avail(netplay_io_t *io, int conn);
+
+/**
+ * netplay_io_packet:
+ * @io                   : transport handle.
+ * @conn                 : datagram connection index.
+ * @data                 : buffer to receive the datagram.
+ * @size                 : size of @data, set to size of the datagram.
+ * @addr                 : set to the source address, may be NULL.
+ *
+ * Pops the oldest queued datagram. Datagrams larger than @size
+ * are truncated.
+ *
+ * Returns: true (1) if a datagram was queued, otherwise false (0).
+ **/
+bool netplay_io_packet(netplay_io_t *io, int conn,
+      void *data, size_t *size, struct sockaddr_storage *addr);
+
+/* Datagrams dropped on @conn because its queue was full. */
+unsigned netplay_io_packets_dropped(netplay_io_t *io, int conn);
+
+#endif
@@ -15,11 +15,548 @@
  */
 
 #include <compat/strl.h>
+#include <net/net_compat.h>
+#include <net/net_socket.h>
+#include <retro_miscellaneous.h>
 
 #include "netplay_private.h"
 
 #include "../../autosave.h"
 
+/* Buffer entry of @frame. Only valid while self_ptr is the entry
+ * of frame_count and @frame is still in the buffer. */
+static size_t netplay_net_frame_ptr(netplay_t *netplay, uint32_t frame)
+{
+   return (netplay->self_ptr + netplay->buffer_size
+         - (netplay->frame_count - frame)) % netplay->buffer_size;
+}
+
+/* Runs a frame again, see netplay_net_replay(). */
+static void netplay_net_run(netplay_t *netplay)
+{
+   retro_time_t start = cpu_features_get_time_usec();
+
+#if defined(HAVE_THREADS)
+   autosave_lock();
+#endif
+   core_run();
+#if defined(HAVE_THREADS)
+   autosave_unlock();
+#endif
+
+   netplay->stats.run_usec += cpu_features_get_time_usec() - start;
+   netplay->stats.replayed++;
+}
+
+static void netplay_net_serialize(netplay_t *netplay, void *state)
+{
+   retro_ctx_serialize_info_t serial_info;
+   retro_time_t start     = cpu_features_get_time_usec();
+
+   serial_info.data       = state;
+   serial_info.data_const = NULL;
+   serial_info.size       = netplay->state_size;
+
+   core_serialize(&serial_info);
+
+   netplay->stats.serialize_usec += cpu_features_get_time_usec() - start;
+}
+
+static void netplay_net_unserialize(netplay_t *netplay, const void *state)
+{
+   retro_ctx_serialize_info_t serial_info;
+   retro_time_t start     = cpu_features_get_time_usec();
+
+   serial_info.data       = NULL;
+   serial_info.data_const = state;
+   serial_info.size       = netplay->state_size;
+
+   core_unserialize(&serial_info);
+
+   netplay->stats.unserialize_usec += cpu_features_get_time_usec() - start;
+}
+
+/* Counts a rollback of @depth frames. */
+static void netplay_net_rollback(netplay_t *netplay, uint32_t depth)
+{
+   netplay->stats.rollbacks++;
+   if (depth > netplay->stats.max_depth)
+      netplay->stats.max_depth = depth;
+}
+
+/* Adds the input of @frame to the packet, see netplay_net_delay_input(). */
+static void netplay_net_push_frame(netplay_t *netplay, uint32_t frame,
+      const uint32_t *state)
+{
+   uint32_t *last = &netplay->packet_buffer[
+      (UDP_FRAME_PACKETS - 1) * UDP_WORDS_PER_FRAME];
+
+   memmove(netplay->packet_buffer, netplay->packet_buffer + UDP_WORDS_PER_FRAME,
+         sizeof (netplay->packet_buffer) - UDP_WORDS_PER_FRAME * sizeof(uint32_t));
+   last[0] = htonl(frame);
+   last[1] = htonl(state[0]);
+   last[2] = htonl(state[1]);
+   last[3] = htonl(state[2]);
+
+   memcpy(netplay->delay.queue[frame % (NETPLAY_MAX_INPUT_DELAY + 1)],
+         state, sizeof(netplay->delay.queue[0]));
+}
+
+/**
+ * netplay_net_delay_input:
+ * @netplay              : pointer to netplay object
+ * @state                : local input read on this frame.
+ * @target               : input delay to move towards.
+ *
+ * Adds @state to the packet as the input of the frame it's delayed
+ * to. Input for frames up to frame_count - 1 + delay has been sent
+ * before. The delay changes by one frame at a time: growing sends
+ * @state for two frames, shrinking drops it.
+ *
+ * Returns: local input of the current frame.
+ **/
+const uint32_t *netplay_net_delay_input(netplay_t *netplay,
+      const uint32_t *state, unsigned target)
+{
+   uint32_t frame = netplay->frame_count;
+
+   if (target > netplay->delay.frames)
+   {
+      netplay_net_push_frame(netplay, frame + netplay->delay.frames, state);
+      netplay->delay.frames++;
+      netplay_net_push_frame(netplay, frame + netplay->delay.frames, state);
+   }
+   else if (target < netplay->delay.frames)
+      netplay->delay.frames--;
+   else
+      netplay_net_push_frame(netplay, frame + netplay->delay.frames, state);
+
+   return netplay->delay.queue[frame % (NETPLAY_MAX_INPUT_DELAY + 1)];
+}
+
+/**
+ * netplay_net_input_delay_target:
+ * @netplay              : pointer to netplay object
+ * @fps                  : frame rate of the core.
+ *
+ * Returns: input delay we should be moving towards. The adaptive
+ * delay covers half the round-trip time plus its variation, with
+ * some hysteresis so jitter doesn't make it flap.
+ **/
+unsigned netplay_net_input_delay_target(netplay_t *netplay, double fps)
+{
+   retro_time_t frame_usec, one_way;
+   unsigned up, down;
+
+   if (!netplay->delay.adaptive)
+      return netplay->delay.max;
+   if (!netplay->delay.rtt)
+      return netplay->delay.frames;
+
+   frame_usec = (retro_time_t)(1000000.0 / fps);
+   one_way    = netplay->delay.rtt / 2 + netplay->delay.rtt_var;
+
+   /* Up once a frame and a half is covered, down below a quarter. */
+   up         = (unsigned)((one_way + frame_usec / 2) / frame_usec);
+   down       = (unsigned)((one_way + frame_usec * 3 / 4) / frame_usec);
+
+   if (up > netplay->delay.frames)
+      return MIN(up, netplay->delay.max);
+   if (down < netplay->delay.frames)
+      return down;
+   return MIN(netplay->delay.frames, netplay->delay.max);
+}
+
+/* Smooths round-trip time samples the way TCP does (RFC 6298). */
+void netplay_net_update_rtt(netplay_t *netplay, retro_time_t sample)
+{
+   retro_time_t diff;
+
+   if (sample < 0)
+      return;
+
+   if (!netplay->delay.rtt)
+   {
+      netplay->delay.rtt     = sample ? sample : 1;
+      netplay->delay.rtt_var = sample / 2;
+      return;
+   }
+
+   diff = netplay->delay.rtt - sample;
+   if (diff < 0)
+      diff = -diff;
+
+   netplay->delay.rtt_var = (3 * netplay->delay.rtt_var + diff) / 4;
+   netplay->delay.rtt     = (7 * netplay->delay.rtt + sample) / 8;
+   if (!netplay->delay.rtt)
+      netplay->delay.rtt  = 1;
+}
+
+/**
+ * netplay_net_replay:
+ * @netplay              : pointer to netplay object
+ *
+ * Loads the state of other_frame_count and runs the frames
+ * up to frame_count again, now that their input is known.
+ **/
+static void netplay_net_replay(netplay_t *netplay)
+{
+   bool first = true;
+
+   netplay->is_replay = true;
+   netplay->tmp_ptr = netplay->other_ptr;
+   netplay->tmp_frame_count = netplay->other_frame_count;
+
+   netplay_net_rollback(netplay,
+         netplay->frame_count - netplay->other_frame_count);
+   netplay_net_unserialize(netplay, netplay->buffer[netplay->other_ptr].state);
+
+   while (first || (netplay->tmp_ptr != netplay->self_ptr))
+   {
+      netplay_net_serialize(netplay, netplay->buffer[netplay->tmp_ptr].state);
+      netplay_net_run(netplay);
+
+      netplay->tmp_ptr = NEXT_PTR(netplay->tmp_ptr);
+      netplay->tmp_frame_count++;
+      first = false;
+   }
+
+   netplay->other_ptr = netplay->read_ptr;
+   netplay->other_frame_count = netplay->read_frame_count;
+   netplay->is_replay = false;
+}
+
+static void netplay_net_sync_result(netplay_t *netplay, uint32_t frame,
+      enum netplay_sync_result res)
+{
+   if (res == NETPLAY_SYNC_MATCH)
+      netplay->sync.matched = true;
+
+   if (res != NETPLAY_SYNC_MISMATCH || netplay->sync.resync)
+      return;
+
+   RARCH_WARN("Netplay desync detected at frame %u.\n", frame);
+
+   /* The last patch didn't get us back in sync, so the client
+    * likely doesn't have the base we think it has. */
+   if (netplay->sync.epoch && !netplay->sync.matched)
+      netplay->sync.resync_full = true;
+
+   netplay->sync.resync = true;
+}
+
+/* Records the input of frames that became confirmed. */
+static void netplay_net_sync_record(netplay_t *netplay)
+{
+   uint32_t frame = netplay->sync.next_history;
+
+   if (frame + netplay->buffer_size <= netplay->frame_count)
+      frame = netplay->frame_count - netplay->buffer_size + 1;
+
+   for (; frame < netplay->other_frame_count; frame++)
+   {
+      struct delta_frame *entry =
+         &netplay->sync.history[frame % NETPLAY_SYNC_HISTORY];
+
+      *entry       = netplay->buffer[netplay_net_frame_ptr(netplay, frame)];
+      entry->state = NULL;
+   }
+
+   netplay->sync.next_history = frame;
+}
+
+/**
+ * netplay_net_sync_check:
+ * @netplay              : pointer to netplay object
+ *
+ * Checksums the states that became confirmed, i.e. all input up to
+ * them is known, and compares them (host) or sends them (client).
+ **/
+static void netplay_net_sync_check(netplay_t *netplay)
+{
+   uint32_t frame;
+   netplay_sync_t *data = netplay->sync.data;
+
+   netplay_net_sync_record(netplay);
+
+   frame = netplay->sync.next_check;
+   if (frame + netplay->buffer_size <= netplay->frame_count)
+      frame = netplay->frame_count - netplay->buffer_size + 1;
+
+   for (; frame <= netplay->other_frame_count; frame++)
+   {
+      uint32_t checksum;
+      const void *state;
+
+      if (!netplay_sync_is_check_frame(data, frame))
+         continue;
+
+      state    = netplay->buffer[netplay_net_frame_ptr(netplay, frame)].state;
+      checksum = netplay_sync_checksum(state, netplay->state_size);
+
+      if (netplay_sync_is_snapshot_frame(data, frame))
+         netplay_sync_snapshot(data, frame, state, false);
+
+      if (netplay->is_server)
+         netplay_net_sync_result(netplay, frame,
+               netplay_sync_local(data, frame, checksum));
+      else
+      {
+         uint32_t args[3];
+
+         netplay_sync_local(data, frame, checksum);
+
+         args[0] = htonl(frame);
+         args[1] = htonl(checksum);
+         args[2] = htonl(netplay->sync.epoch);
+
+         /* A full send buffer just skips this one. */
+         netplay_send_raw_cmd(netplay, NETPLAY_CMD_CRC, args, sizeof(args));
+      }
+   }
+
+   netplay->sync.next_check = frame;
+}
+
+/**
+ * netplay_net_sync_send:
+ * @netplay              : pointer to netplay object
+ *
+ * Host: starts a patch if one is due, and sends as much of it as
+ * fits into the send buffer. The rest goes out on later frames.
+ **/
+static void netplay_net_sync_send(netplay_t *netplay)
+{
+   uint8_t *buf;
+   netplay_sync_t *data = netplay->sync.data;
+
+   if (netplay->sync.resync
+         && netplay->sync.patch_offset >= netplay->sync.patch_size)
+   {
+      /* All input up to other_frame_count is known on both sides,
+       * so that is the newest state the client can patch to. */
+      uint32_t frame    = netplay->other_frame_count;
+      const void *state = netplay->buffer[netplay->other_ptr].state;
+      uint32_t base     = netplay->sync.resync_full ?
+         NETPLAY_SYNC_NO_BASE : netplay_sync_shared_base(data);
+
+      netplay->sync.patch_size     = netplay_sync_diff(data, base, state,
+            netplay->sync.patch);
+      netplay->sync.patch_offset   = 0;
+      netplay->sync.patch_frame    = frame;
+      netplay->sync.patch_base     = base;
+      netplay->sync.patch_checksum = netplay_sync_checksum(state,
+            netplay->state_size);
+      netplay->sync.patch_epoch    = ++netplay->sync.epoch;
+
+      netplay_sync_snapshot(data, frame, state, true);
+      netplay_sync_clear_remote(data);
+
+      netplay->sync.resync      = false;
+      netplay->sync.resync_full = false;
+      netplay->sync.matched     = false;
+
+      RARCH_LOG("Netplay resync at frame %u: %u byte patch against %s, "
+            "savestate is %u bytes.\n", frame,
+            (unsigned)netplay->sync.patch_size,
+            base == NETPLAY_SYNC_NO_BASE ? "nothing" : "a shared state",
+            (unsigned)netplay->state_size);
+   }
+
+   if (netplay->sync.patch_offset >= netplay->sync.patch_size)
+      return;
+
+   buf = (uint8_t*)malloc(6 * sizeof(uint32_t) + NETPLAY_SYNC_CHUNK);
+   if (!buf)
+      return;
+
+   while (netplay->sync.patch_offset < netplay->sync.patch_size)
+   {
+      uint32_t header[6];
+      size_t len = netplay->sync.patch_size - netplay->sync.patch_offset;
+
+      if (len > NETPLAY_SYNC_CHUNK)
+         len = NETPLAY_SYNC_CHUNK;
+
+      header[0] = htonl(netplay->sync.patch_epoch);
+      header[1] = htonl(netplay->sync.patch_frame);
+      header[2] = htonl(netplay->sync.patch_base);
+      header[3] = htonl(netplay->sync.patch_checksum);
+      header[4] = htonl((uint32_t)netplay->sync.patch_size);
+      header[5] = htonl((uint32_t)netplay->sync.patch_offset);
+
+      memcpy(buf, header, sizeof(header));
+      memcpy(buf + sizeof(header),
+            netplay->sync.patch + netplay->sync.patch_offset, len);
+
+      if (!netplay_send_raw_cmd(netplay, NETPLAY_CMD_LOAD_SAVESTATE,
+               buf, sizeof(header) + len))
+         break;
+
+      netplay->sync.patch_offset += len;
+   }
+
+   free(buf);
+}
+
+/**
+ * netplay_net_sync_apply:
+ * @netplay              : pointer to netplay object
+ *
+ * Client: once a complete patch is there and all input up to its
+ * frame is known, patches that state and replays from it.
+ **/
+static void netplay_net_sync_apply(netplay_t *netplay)
+{
+   netplay_sync_t *data = netplay->sync.data;
+   uint32_t frame       = netplay->sync.patch_frame;
+
+   if (!netplay->sync.patch_ready || frame > netplay->other_frame_count)
+      return;
+
+   netplay->sync.patch_ready = false;
+   netplay_net_sync_record(netplay);
+
+   /* Whatever happens below, checksums from now on are compared
+    * again. If we failed, they still differ and the host sends
+    * a full state next time. */
+   netplay->sync.epoch      = netplay->sync.patch_epoch;
+   netplay->sync.next_check = netplay->other_frame_count;
+
+   if (netplay->other_frame_count - frame > NETPLAY_SYNC_HISTORY)
+   {
+      RARCH_WARN("Netplay savestate patch for frame %u came too late.\n",
+            frame);
+      return;
+   }
+
+   if (!netplay_sync_apply(data, netplay->sync.patch_base,
+            netplay->sync.patch, netplay->sync.patch_size,
+            netplay->sync.state)
+         || netplay_sync_checksum(netplay->sync.state, netplay->state_size)
+            != netplay->sync.patch_checksum)
+   {
+      RARCH_WARN("Failed to apply netplay savestate patch for frame %u.\n",
+            frame);
+      return;
+   }
+
+   netplay_sync_snapshot(data, frame, netplay->sync.state, true);
+
+   netplay_net_rollback(netplay, netplay->frame_count - frame);
+   netplay_net_unserialize(netplay, netplay->sync.state);
+
+   /* The patched frame may be older than anything in the buffer,
+    * so catch up to other_frame_count from the input history. */
+   netplay->is_replay = true;
+
+   for (netplay->tmp_frame_count = frame;
+         netplay->tmp_frame_count < netplay->other_frame_count;
+         netplay->tmp_frame_count++)
+   {
+      netplay->sync.replay_frame = &netplay->sync.history[
+         netplay->tmp_frame_count % NETPLAY_SYNC_HISTORY];
+      netplay_net_run(netplay);
+   }
+
+   netplay->sync.replay_frame = NULL;
+   netplay->is_replay         = false;
+
+   if (netplay->other_frame_count < netplay->frame_count)
+   {
+      netplay_net_serialize(netplay,
+            netplay->buffer[netplay->other_ptr].state);
+      netplay_net_replay(netplay);
+   }
+
+   RARCH_LOG("Netplay state patched at frame %u.\n", frame);
+}
+
+/**
+ * netplay_net_sync_checksum_cmd:
+ * @netplay              : pointer to netplay object
+ * @frame                : frame number.
+ * @checksum             : client's checksum of the state at @frame.
+ * @epoch                : client's patch count.
+ *
+ * Host: compares a checksum from the client to our own.
+ **/
+void netplay_net_sync_checksum_cmd(netplay_t *netplay,
+      uint32_t frame, uint32_t checksum, uint32_t epoch)
+{
+   if (!netplay->is_server || !netplay->sync.data)
+      return;
+
+   /* Taken before the last patch was applied. */
+   if (epoch != netplay->sync.epoch)
+      return;
+
+   netplay_net_sync_result(netplay, frame,
+         netplay_sync_remote(netplay->sync.data, frame, checksum));
+}
+
+/**
+ * netplay_net_sync_patch_cmd:
+ * @netplay              : pointer to netplay object
+ * @size                 : size of the command.
+ *
+ * Client: reads one piece of a savestate patch. Reads all of the
+ * command even if it's dropped.
+ *
+ * Returns: false (0) if the piece was dropped, otherwise true (1).
+ **/
+bool netplay_net_sync_patch_cmd(netplay_t *netplay, size_t size)
+{
+   unsigned i;
+   size_t len;
+   uint32_t header[6];
+
+   if (size < sizeof(header))
+   {
+      netplay_io_recv(netplay->io, netplay->io_tcp, NULL, size, false);
+      return false;
+   }
+
+   netplay_io_recv(netplay->io, netplay->io_tcp,
+         header, sizeof(header), false);
+   len = size - sizeof(header);
+
+   for (i = 0; i < 6; i++)
+      header[i] = ntohl(header[i]);
+
+   if (netplay->is_server || !netplay->sync.data
+         || header[4] > netplay_sync_patch_max(netplay->sync.data)
+         || header[5] > header[4] || len > header[4] - header[5])
+      goto drop;
+
+   if (header[5] == 0)
+   {
+      netplay->sync.patch_epoch    = header[0];
+      netplay->sync.patch_frame    = header[1];
+      netplay->sync.patch_base     = header[2];
+      netplay->sync.patch_checksum = header[3];
+      netplay->sync.patch_size     = header[4];
+      netplay->sync.patch_offset   = 0;
+      netplay->sync.patch_ready    = false;
+   }
+   else if (header[0] != netplay->sync.patch_epoch
+         || header[5] != netplay->sync.patch_offset)
+      goto drop;
+
+   netplay_io_recv(netplay->io, netplay->io_tcp,
+         netplay->sync.patch + netplay->sync.patch_offset, len, false);
+
+   netplay->sync.patch_offset += len;
+   if (netplay->sync.patch_offset == netplay->sync.patch_size)
+      netplay->sync.patch_ready = true;
+
+   return true;
+
+drop:
+   netplay_io_recv(netplay->io, netplay->io_tcp, NULL, len, false);
+   return false;
+}
+
 /**
  * pre_frame:   
  * @netplay              : pointer to netplay object
@@ -35,6 +572,13 @@ static void netplay_net_pre_frame(netplay_t *netplay)
 
    core_serialize(&serial_info);
 
+   if (netplay->sync.data)
+   {
+      netplay_net_sync_check(netplay);
+      if (netplay->is_server)
+         netplay_net_sync_send(netplay);
+   }
+
    netplay->can_poll = true;
 
    input_poll_net();
@@ -50,10 +594,15 @@ static void netplay_net_pre_frame(netplay_t *netplay)
 static void netplay_net_post_frame(netplay_t *netplay)
 {
    netplay->frame_count++;
+   netplay->stats.frames++;
 
    /* Nothing to do... */
    if (netplay->other_frame_count == netplay->read_frame_count)
+   {
+      if (netplay->sync.data)
+         netplay_net_sync_apply(netplay);
       return;
+   }
 
    /* Skip ahead if we predicted correctly.
     * Skip until our simulation failed. */
@@ -69,46 +618,15 @@ static void netplay_net_post_frame(netplay_t *netplay)
       netplay->other_frame_count++;
    }
 
+   /* Replay frames. */
    if (netplay->other_frame_count < netplay->read_frame_count)
-   {
-      retro_ctx_serialize_info_t serial_info;
-      bool first = true;
-
-      /* Replay frames. */
-      netplay->is_replay = true;
-      netplay->tmp_ptr = netplay->other_ptr;
-      netplay->tmp_frame_count = netplay->other_frame_count;
-
-      serial_info.data_const = netplay->buffer[netplay->other_ptr].state;
-      serial_info.size       = netplay->state_size;
-
-      core_unserialize(&serial_info);
-
-      while (first || (netplay->tmp_ptr != netplay->self_ptr))
-      {
-         serial_info.data       = netplay->buffer[netplay->tmp_ptr].state;
-         serial_info.size       = netplay->state_size;
-         serial_info.data_const = NULL;
+      netplay_net_replay(netplay);
 
-         core_serialize(&serial_info);
+   if (netplay->sync.data)
+      netplay_net_sync_apply(netplay);
+}
 
-#if defined(HAVE_THREADS)
-         autosave_lock();
-#endif
-         core_run();
-#if defined(HAVE_THREADS)
-         autosave_unlock();
-#endif
-         netplay->tmp_ptr = NEXT_PTR(netplay->tmp_ptr);
-         netplay->tmp_frame_count++;
-         first = false;
-      }
 
-      netplay->other_ptr = netplay->read_ptr;
-      netplay->other_frame_count = netplay->read_frame_count;
-      netplay->is_replay = false;
-   }
-}
 static bool netplay_net_init_buffers(netplay_t *netplay)
 {
    unsigned i;
@@ -137,6 +655,60 @@ static bool netplay_net_init_buffers(netplay_t *netplay)
       netplay->buffer[i].is_simulated = true;
    }
 
+   if (netplay->sync.check_frames && netplay->state_size)
+   {
+      netplay->sync.data = netplay_sync_new(netplay->state_size,
+            netplay->sync.check_frames);
+      if (!netplay->sync.data)
+         return false;
+
+      netplay->sync.patch = (uint8_t*)malloc(
+            netplay_sync_patch_max(netplay->sync.data));
+      netplay->sync.state = malloc(netplay->state_size);
+
+      if (!netplay->sync.patch || !netplay->sync.state)
+         return false;
+   }
+
+   return true;
+}
+
+/**
+ * netplay_net_negotiate_sync:
+ * @netplay              : pointer to netplay object
+ *
+ * Both sides have to checksum the same frames, so the host's
+ * checksum interval is used by both.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+static bool netplay_net_negotiate_sync(netplay_t *netplay)
+{
+   uint32_t check_frames;
+
+   if (netplay_is_server(netplay))
+   {
+      check_frames = htonl(netplay->sync.check_frames);
+      return socket_send_all_blocking(netplay->fd,
+            &check_frames, sizeof(check_frames), false);
+   }
+
+   if (!socket_receive_all_blocking(netplay->fd,
+            &check_frames, sizeof(check_frames)))
+      return false;
+
+   check_frames = ntohl(check_frames);
+   if (check_frames > NETPLAY_MAX_CHECK_FRAMES)
+   {
+      RARCH_ERR("Host sent an invalid checksum interval.\n");
+      return false;
+   }
+
+   if (check_frames != netplay->sync.check_frames)
+      RARCH_LOG("Using the host's netplay checksum interval of %u frames.\n",
+            check_frames);
+
+   netplay->sync.check_frames = check_frames;
    return true;
 }
 
@@ -153,6 +725,9 @@ static bool netplay_net_info_cb(netplay_t* netplay, unsigned frames)
          return false;
    }
 
+   if (!netplay_net_negotiate_sync(netplay))
+      return false;
+
    netplay->buffer_size = frames + 1;
 
    if (!netplay_net_init_buffers(netplay))
@@ -18,9 +18,13 @@
 #define __RARCH_NETPLAY_PRIVATE_H
 
 #include "netplay.h"
+#include "netplay_io.h"
+#include "netplay_broadcast.h"
+#include "netplay_sync.h"
 
 #include <net/net_compat.h>
 #include <retro_endianness.h>
+#include <features/features_cpu.h>
 
 #include "../../core.h"
 #include "../../msg_hash.h"
@@ -32,8 +36,21 @@
 
 #define UDP_FRAME_PACKETS     16
 #define UDP_WORDS_PER_FRAME   4 /* Allows us to send 128 bits worth of state per frame. */
-#define MAX_SPECTATORS        16
+#define MAX_SPECTATORS        1024
+/* Spectator stream a spectator may fall behind, in bytes. */
+#define NETPLAY_SPECTATE_HISTORY (256 * 1024)
 #define RARCH_DEFAULT_PORT    55435
+/* Frames of confirmed input kept for replaying from a patched state. */
+#define NETPLAY_SYNC_HISTORY  256
+/* Longest checksum interval the host may ask for. */
+#define NETPLAY_MAX_CHECK_FRAMES 3600
+/* Largest piece of a savestate patch in one command. */
+#define NETPLAY_SYNC_CHUNK    32768
+/* Input is sent this far ahead at most. Leaves half of the
+ * redundant frames in each packet to cover for lost ones. */
+#define NETPLAY_MAX_INPUT_DELAY (UDP_FRAME_PACKETS / 2)
+/* Microseconds between round-trip time measurements. */
+#define NETPLAY_PING_USEC     500000
 
 #define PREV_PTR(x) ((x) == 0 ? netplay->buffer_size - 1 : (x) - 1)
 #define NEXT_PTR(x) ((x + 1) % netplay->buffer_size)
@@ -71,6 +88,83 @@ struct netplay
    unsigned port;
    bool has_connection;
 
+   /* Services fd and udp_fd once connected, so neither blocks
+    * a frame. io_tcp and io_udp are the connection indices. */
+   netplay_io_t *io;
+   int io_tcp;
+   int io_udp;
+
+   /* Command sent to the other side and not acknowledged yet. */
+   struct {
+      bool active;
+      uint32_t cmd;
+      const char *command_str;
+      const char *success_msg;
+      /* Flip state to restore if the command is refused. */
+      bool flip;
+      uint32_t flip_frame;
+   } pending;
+
+   /* Savestate checksums and patches, see netplay_sync.h. */
+   struct {
+      netplay_sync_t *data;
+      unsigned check_frames;
+      /* Next frame to checksum. */
+      uint32_t next_check;
+      /* Bumped on every patch, so the host can tell checksums of
+       * patched states from older ones. */
+      uint32_t epoch;
+
+      /* Host: a patch is due. If patches against the shared base
+       * didn't help, the next one is against NETPLAY_SYNC_NO_BASE. */
+      bool resync;
+      bool resync_full;
+      bool matched;
+
+      /* Host: patch being sent. Client: patch being received,
+       * ready once all of it is there. */
+      uint8_t *patch;
+      size_t patch_size;
+      size_t patch_offset;
+      uint32_t patch_frame;
+      uint32_t patch_base;
+      uint32_t patch_checksum;
+      uint32_t patch_epoch;
+      bool patch_ready;
+      /* Patched state. */
+      void *state;
+
+      /* Confirmed input, for replaying from states older than
+       * what the buffer holds. */
+      struct delta_frame history[NETPLAY_SYNC_HISTORY];
+      uint32_t next_history;
+      /* If set, input is read from here rather than the buffer. */
+      const struct delta_frame *replay_frame;
+   } sync;
+
+   /* Local input delay. Input read on frame N is used on frame
+    * N + frames, and sent right away, so it usually reaches the
+    * other side before it's needed there. */
+   struct {
+      bool adaptive;
+      /* Fixed delay, or the upper bound of the adaptive one. */
+      unsigned max;
+      unsigned frames;
+      /* Input of the frames sent but not run yet, by frame. */
+      uint32_t queue[NETPLAY_MAX_INPUT_DELAY + 1][UDP_WORDS_PER_FRAME - 1];
+      /* Smoothed round-trip time and its variation, as in TCP. */
+      retro_time_t rtt;
+      retro_time_t rtt_var;
+      retro_time_t last_ping;
+   } delay;
+
+   /* Frames we may run ahead of the other side's input, 0 for as
+    * many as the buffer holds. */
+   unsigned rollback_frames;
+
+   struct netplay_stats stats;
+   retro_time_t stats_start;
+
    struct delta_frame *buffer;
    size_t buffer_size;
 
@@ -107,7 +201,7 @@ struct netplay
    /* Spectating. */
    struct {
       bool enabled;
-      int fds[MAX_SPECTATORS];
+      netplay_broadcast_t *broadcast;
       uint16_t *input;
       size_t input_ptr;
       size_t input_sz;
@@ -158,4 +252,19 @@ bool netplay_is_server(netplay_t* netplay);
 
 bool netplay_is_spectate(netplay_t* netplay);
 
+bool netplay_send_raw_cmd(netplay_t *netplay, uint32_t cmd,
+      const void *data, size_t size);
+
+void netplay_net_sync_checksum_cmd(netplay_t *netplay,
+      uint32_t frame, uint32_t checksum, uint32_t epoch);
+
+bool netplay_net_sync_patch_cmd(netplay_t *netplay, size_t size);
+
+const uint32_t *netplay_net_delay_input(netplay_t *netplay,
+      const uint32_t *state, unsigned target);
+
+unsigned netplay_net_input_delay_target(netplay_t *netplay, double fps);
+
+void netplay_net_update_rtt(netplay_t *netplay, retro_time_t sample);
+
 #endif
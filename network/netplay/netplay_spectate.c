@@ -35,9 +35,8 @@
  **/
 static void netplay_spectate_pre_frame(netplay_t *netplay)
 {
-   unsigned i;
    uint32_t *header;
-   int new_fd, idx, bufsize;
+   int new_fd, idx;
    size_t header_size;
    struct sockaddr_storage their_addr;
    socklen_t addr_size;
@@ -64,18 +63,9 @@ static void netplay_spectate_pre_frame(netplay_t *netplay)
       return;
    }
 
-   idx = -1;
-   for (i = 0; i < MAX_SPECTATORS; i++)
-   {
-      if (netplay->spectate.fds[i] == -1)
-      {
-         idx = i;
-         break;
-      }
-   }
-
    /* No vacant client streams :( */
-   if (idx == -1)
+   if (netplay_broadcast_clients(netplay->spectate.broadcast)
+         >= MAX_SPECTATORS)
    {
       socket_close(new_fd);
       return;
@@ -105,21 +95,18 @@ static void netplay_spectate_pre_frame(netplay_t *netplay)
       return;
    }
 
-   bufsize = header_size;
-   setsockopt(new_fd, SOL_SOCKET, SO_SNDBUF, (const char*)&bufsize,
-         sizeof(int));
+   /* The header goes out from the broadcast thread,
+    * ahead of this spectator's input stream. */
+   idx = netplay_broadcast_add(netplay->spectate.broadcast, new_fd,
+         header, header_size);
+   free(header);
 
-   if (!socket_send_all_blocking(new_fd, header, header_size, false))
+   if (idx < 0)
    {
       RARCH_ERR("%s\n", msg_hash_to_str(MSG_FAILED_TO_SEND_HEADER_TO_CLIENT));
-      socket_close(new_fd);
-      free(header);
       return;
    }
 
-   free(header);
-   netplay->spectate.fds[idx] = new_fd;
-
 #ifndef HAVE_SOCKET_LEGACY
    netplay_log_connection(&their_addr, idx, netplay->other_nick);
 #endif
@@ -134,32 +121,34 @@ static void netplay_spectate_pre_frame(netplay_t *netplay)
  **/
 static void netplay_spectate_post_frame(netplay_t *netplay)
 {
-   unsigned i;
+   int idx;
+   enum netplay_broadcast_drop reason;
 
    if (!netplay_is_server(netplay))
       return;
 
-   for (i = 0; i < MAX_SPECTATORS; i++)
+   netplay_broadcast_write(netplay->spectate.broadcast,
+         netplay->spectate.input,
+         netplay->spectate.input_ptr * sizeof(int16_t));
+
+   while ((idx = netplay_broadcast_reap(netplay->spectate.broadcast,
+               &reason)) >= 0)
    {
       char msg[128];
 
-      if (netplay->spectate.fds[i] == -1)
-         continue;
-
-      if (socket_send_all_blocking(netplay->spectate.fds[i],
-               netplay->spectate.input,
-               netplay->spectate.input_ptr * sizeof(int16_t),
-               false))
-         continue;
-
-      RARCH_LOG("Client (#%u) disconnected ...\n", i);
+      if (reason == NETPLAY_BROADCAST_TOO_SLOW)
+      {
+         RARCH_LOG("Client (#%d) fell behind, disconnecting ...\n", idx);
+         snprintf(msg, sizeof(msg),
+               "Client (#%d) disconnected, connection too slow.", idx);
+      }
+      else
+      {
+         RARCH_LOG("Client (#%d) disconnected ...\n", idx);
+         snprintf(msg, sizeof(msg), "Client (#%d) disconnected.", idx);
+      }
 
-      snprintf(msg, sizeof(msg), "Client (#%u) disconnected.", i);
       runloop_msg_queue_push(msg, 1, 180, false);
-
-      socket_close(netplay->spectate.fds[i]);
-      netplay->spectate.fds[i] = -1;
-      break;
    }
 
    netplay->spectate.input_ptr = 0;
@@ -167,15 +156,19 @@ static void netplay_spectate_post_frame(netplay_t *netplay)
 
 static bool netplay_spectate_info_cb(netplay_t *netplay, unsigned frames)
 {
-   unsigned i;
    if(netplay_is_server(netplay))
    {
       if(!netplay_get_info(netplay))
          return false;
+
+      netplay->spectate.broadcast = netplay_broadcast_new(
+            NETPLAY_SPECTATE_HISTORY, MAX_SPECTATORS);
+
+      if (!netplay->spectate.broadcast ||
+            !netplay_broadcast_start(netplay->spectate.broadcast))
+         return false;
    }
 
-   for (i = 0; i < MAX_SPECTATORS; i++)
-      netplay->spectate.fds[i] = -1;
    return true;
 }
 
@@ -0,0 +1,425 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2016 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithms/mismatch.h>
+#include <retro_endianness.h>
+
+#include "netplay_sync.h"
+
+struct netplay_sync_check
+{
+   uint32_t frame;
+   uint32_t local;
+   uint32_t remote;
+   bool has_local;
+   bool has_remote;
+};
+
+struct netplay_sync_snapshot
+{
+   uint32_t frame;
+   bool valid;
+   bool shared;
+   uint8_t *data;
+};
+
+struct netplay_sync
+{
+   size_t state_size;
+   size_t num16s;
+   unsigned check_frames;
+   unsigned snapshot_frames;
+
+   struct netplay_sync_check checks[NETPLAY_SYNC_CHECKSUMS];
+
+   struct netplay_sync_snapshot snapshots[NETPLAY_SYNC_SNAPSHOTS];
+   unsigned next_snapshot;
+
+   /* Copies of the two states being compared, with guard words for
+    * find_change() and find_same(), see netplay_sync_alloc(). */
+   uint16_t *old16;
+   uint16_t *new16;
+   /* The base for NETPLAY_SYNC_NO_BASE. */
+   uint8_t *zero;
+};
+
+/* Same layout as state_manager_raw_alloc(): a differing word past
+ * the end stops find_change(), a run of equal ones find_same(), and
+ * there is padding for the 64-byte wide scanners. */
+static uint16_t *netplay_sync_alloc(size_t num16s, uint16_t uniq)
+{
+   uint16_t *ret = (uint16_t*)calloc(num16s * sizeof(uint16_t)
+         + sizeof(uint16_t) * 4 + 64, 1);
+
+   if (ret)
+      ret[num16s + 3] = uniq;
+   return ret;
+}
+
+netplay_sync_t *netplay_sync_new(size_t state_size, unsigned check_frames)
+{
+   unsigned i;
+   netplay_sync_t *sync = (netplay_sync_t*)calloc(1, sizeof(*sync));
+
+   if (!sync)
+      return NULL;
+
+   if (check_frames < 1)
+      check_frames = 1;
+
+   sync->state_size      = state_size;
+   sync->num16s          = (state_size + 1) / sizeof(uint16_t);
+   sync->check_frames    = check_frames;
+   sync->snapshot_frames = ((NETPLAY_SYNC_INTERVAL + check_frames - 1)
+         / check_frames) * check_frames;
+
+   sync->old16 = netplay_sync_alloc(sync->num16s, 1);
+   sync->new16 = netplay_sync_alloc(sync->num16s, 2);
+   sync->zero  = (uint8_t*)calloc(1, state_size + 1);
+
+   if (!sync->old16 || !sync->new16 || !sync->zero)
+      goto error;
+
+   for (i = 0; i < NETPLAY_SYNC_SNAPSHOTS; i++)
+   {
+      sync->snapshots[i].data = (uint8_t*)malloc(state_size + 1);
+      if (!sync->snapshots[i].data)
+         goto error;
+   }
+
+   return sync;
+
+error:
+   netplay_sync_free(sync);
+   return NULL;
+}
+
+void netplay_sync_free(netplay_sync_t *sync)
+{
+   unsigned i;
+
+   if (!sync)
+      return;
+
+   for (i = 0; i < NETPLAY_SYNC_SNAPSHOTS; i++)
+      free(sync->snapshots[i].data);
+
+   free(sync->old16);
+   free(sync->new16);
+   free(sync->zero);
+   free(sync);
+}
+
+bool netplay_sync_is_check_frame(netplay_sync_t *sync, uint32_t frame)
+{
+   return frame % sync->check_frames == 0;
+}
+
+bool netplay_sync_is_snapshot_frame(netplay_sync_t *sync, uint32_t frame)
+{
+   return frame % sync->snapshot_frames == 0;
+}
+
+/* Not a CRC, just four interleaved multiplicative hashes, which keeps
+ * up with memcpy() on the multi-megabyte states of some cores. */
+uint32_t netplay_sync_checksum(const void *data, size_t size)
+{
+   size_t i;
+   uint32_t word;
+   const uint8_t *bytes = (const uint8_t*)data;
+   uint32_t h0          = 0x811c9dc5;
+   uint32_t h1          = 0x01000193;
+   uint32_t h2          = 0x9e3779b9;
+   uint32_t h3          = 0x85ebca6b;
+
+   for (i = 0; i + 16 <= size; i += 16)
+   {
+      memcpy(&word, bytes + i +  0, sizeof(word));
+      h0 = (h0 ^ word) * 0x01000193;
+      memcpy(&word, bytes + i +  4, sizeof(word));
+      h1 = (h1 ^ word) * 0x01000193;
+      memcpy(&word, bytes + i +  8, sizeof(word));
+      h2 = (h2 ^ word) * 0x01000193;
+      memcpy(&word, bytes + i + 12, sizeof(word));
+      h3 = (h3 ^ word) * 0x01000193;
+   }
+
+   for (; i < size; i++)
+      h0 = (h0 ^ bytes[i]) * 0x01000193;
+
+   return h0 ^ (h1 * 3) ^ (h2 * 5) ^ (h3 * 7) ^ (uint32_t)size;
+}
+
+static enum netplay_sync_result netplay_sync_compare(netplay_sync_t *sync,
+      struct netplay_sync_check *check)
+{
+   unsigned i;
+
+   if (!check->has_local || !check->has_remote)
+      return NETPLAY_SYNC_PENDING;
+
+   if (check->local != check->remote)
+      return NETPLAY_SYNC_MISMATCH;
+
+   for (i = 0; i < NETPLAY_SYNC_SNAPSHOTS; i++)
+   {
+      struct netplay_sync_snapshot *snap = &sync->snapshots[i];
+      if (snap->valid && snap->frame == check->frame)
+         snap->shared = true;
+   }
+
+   return NETPLAY_SYNC_MATCH;
+}
+
+static struct netplay_sync_check *netplay_sync_slot(netplay_sync_t *sync,
+      uint32_t frame)
+{
+   struct netplay_sync_check *check =
+      &sync->checks[(frame / sync->check_frames) % NETPLAY_SYNC_CHECKSUMS];
+
+   if (check->frame != frame)
+   {
+      memset(check, 0, sizeof(*check));
+      check->frame = frame;
+   }
+
+   return check;
+}
+
+enum netplay_sync_result netplay_sync_local(netplay_sync_t *sync,
+      uint32_t frame, uint32_t checksum)
+{
+   struct netplay_sync_check *check = netplay_sync_slot(sync, frame);
+
+   check->local     = checksum;
+   check->has_local = true;
+   return netplay_sync_compare(sync, check);
+}
+
+enum netplay_sync_result netplay_sync_remote(netplay_sync_t *sync,
+      uint32_t frame, uint32_t checksum)
+{
+   struct netplay_sync_check *check = netplay_sync_slot(sync, frame);
+
+   check->remote     = checksum;
+   check->has_remote = true;
+   return netplay_sync_compare(sync, check);
+}
+
+void netplay_sync_clear_remote(netplay_sync_t *sync)
+{
+   unsigned i;
+
+   for (i = 0; i < NETPLAY_SYNC_CHECKSUMS; i++)
+      sync->checks[i].has_remote = false;
+}
+
+void netplay_sync_snapshot(netplay_sync_t *sync, uint32_t frame,
+      const void *state, bool shared)
+{
+   unsigned i;
+   struct netplay_sync_snapshot *snap = NULL;
+
+   /* Replace an older copy of the same frame, e.g. one taken before
+    * a patch for it arrived. */
+   for (i = 0; i < NETPLAY_SYNC_SNAPSHOTS; i++)
+      if (sync->snapshots[i].valid && sync->snapshots[i].frame == frame)
+         snap = &sync->snapshots[i];
+
+   if (!snap)
+   {
+      snap = &sync->snapshots[sync->next_snapshot];
+      sync->next_snapshot = (sync->next_snapshot + 1)
+         % NETPLAY_SYNC_SNAPSHOTS;
+   }
+
+   memcpy(snap->data, state, sync->state_size);
+   snap->frame  = frame;
+   snap->valid  = true;
+   snap->shared = shared;
+}
+
+const void *netplay_sync_find(netplay_sync_t *sync, uint32_t frame)
+{
+   unsigned i;
+
+   if (frame == NETPLAY_SYNC_NO_BASE)
+      return sync->zero;
+
+   for (i = 0; i < NETPLAY_SYNC_SNAPSHOTS; i++)
+      if (sync->snapshots[i].valid && sync->snapshots[i].frame == frame)
+         return sync->snapshots[i].data;
+
+   return NULL;
+}
+
+uint32_t netplay_sync_shared_base(netplay_sync_t *sync)
+{
+   unsigned i;
+   const struct netplay_sync_snapshot *best = NULL;
+
+   for (i = 0; i < NETPLAY_SYNC_SNAPSHOTS; i++)
+   {
+      const struct netplay_sync_snapshot *snap = &sync->snapshots[i];
+      if (snap->valid && snap->shared && (!best || snap->frame > best->frame))
+         best = snap;
+   }
+
+   return best ? best->frame : NETPLAY_SYNC_NO_BASE;
+}
+
+size_t netplay_sync_patch_max(netplay_sync_t *sync)
+{
+   /* Same bound as state_manager_raw_maxsize(): a run costs two words
+    * on top of its data, and is followed by at least as many
+    * unchanged words unless it's cut at UINT16_MAX words. */
+   size_t runs = (sync->num16s + UINT16_MAX - 1) / UINT16_MAX + 1;
+   return (sync->num16s + runs * 2 + 3) * sizeof(uint16_t);
+}
+
+size_t netplay_sync_diff(netplay_sync_t *sync, uint32_t base,
+      const void *state, void *patch)
+{
+   const void *base_state = netplay_sync_find(sync, base);
+   const uint16_t *old16  = sync->old16;
+   const uint16_t *new16  = sync->new16;
+   uint16_t *out16        = (uint16_t*)patch;
+   size_t num16s          = sync->num16s;
+
+   if (!base_state)
+      return 0;
+
+   memcpy(sync->old16, base_state, sync->state_size);
+   memcpy(sync->new16, state, sync->state_size);
+
+   while (num16s)
+   {
+      size_t i, changed;
+      size_t skip = find_change(old16, new16);
+
+      if (skip >= num16s)
+         break;
+
+      old16  += skip;
+      new16  += skip;
+      num16s -= skip;
+
+      if (skip > UINT16_MAX)
+      {
+         *out16++ = 0;
+         *out16++ = swap_if_big16((uint16_t)skip);
+         *out16++ = swap_if_big16((uint16_t)(skip >> 16));
+         continue;
+      }
+
+      changed = find_same(old16, new16);
+      if (changed > num16s)
+         changed = num16s;
+      if (changed > UINT16_MAX)
+         changed = UINT16_MAX;
+
+      *out16++ = swap_if_big16((uint16_t)changed);
+      *out16++ = swap_if_big16((uint16_t)skip);
+
+      /* XOR of native words is XOR of bytes, so this part
+       * doesn't care about endianness. */
+      for (i = 0; i < changed; i++)
+         out16[i] = old16[i] ^ new16[i];
+
+      old16  += changed;
+      new16  += changed;
+      num16s -= changed;
+      out16  += changed;
+   }
+
+   out16[0] = 0;
+   out16[1] = 0;
+   out16[2] = 0;
+
+   return (uint8_t*)(out16 + 3) - (uint8_t*)patch;
+}
+
+bool netplay_sync_apply(netplay_sync_t *sync, uint32_t base,
+      const void *patch, size_t patch_size, void *state)
+{
+   size_t pos16           = 0;
+   const void *base_state = netplay_sync_find(sync, base);
+   const uint8_t *in      = (const uint8_t*)patch;
+   const uint8_t *end     = in + patch_size;
+   uint16_t *out16        = sync->new16;
+
+   if (!base_state)
+      return false;
+
+   memcpy(sync->new16, base_state, sync->state_size);
+
+   /* Patches come off the network, so check every bound. */
+   for (;;)
+   {
+      uint16_t words[3];
+      size_t i, changed;
+
+      if (end - in < (ptrdiff_t)(2 * sizeof(uint16_t)))
+         return false;
+
+      memcpy(words, in, 2 * sizeof(uint16_t));
+      in      += 2 * sizeof(uint16_t);
+      changed  = swap_if_big16(words[0]);
+
+      if (!changed)
+      {
+         uint32_t skip;
+
+         if (end - in < (ptrdiff_t)sizeof(uint16_t))
+            return false;
+
+         memcpy(&words[2], in, sizeof(uint16_t));
+         in   += sizeof(uint16_t);
+         skip  = swap_if_big16(words[1])
+            | ((uint32_t)swap_if_big16(words[2]) << 16);
+
+         if (!skip)
+            break;
+         if (skip > sync->num16s - pos16)
+            return false;
+
+         pos16 += skip;
+         continue;
+      }
+
+      pos16 += swap_if_big16(words[1]);
+
+      if (pos16 > sync->num16s || changed > sync->num16s - pos16 ||
+            (size_t)(end - in) < changed * sizeof(uint16_t))
+         return false;
+
+      for (i = 0; i < changed; i++)
+      {
+         uint16_t word;
+         memcpy(&word, in + i * sizeof(uint16_t), sizeof(word));
+         out16[pos16 + i] ^= word;
+      }
+
+      in    += changed * sizeof(uint16_t);
+      pos16 += changed;
+   }
+
+   memcpy(state, sync->new16, sync->state_size);
+   return true;
+}
@@ -0,0 +1,164 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2016 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_NETPLAY_SYNC_H
+#define __RARCH_NETPLAY_SYNC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <boolean.h>
+
+/* Savestate bookkeeping for netplay desync recovery.
+ *
+ * Both sides checksum their savestates once all input up to them is
+ * known. The client sends its checksums to the host, which compares
+ * them to its own. Now and then both sides also keep a copy of such
+ * a state. Once the checksums for one of those copies match, it
+ * becomes a base both sides are known to share. On a mismatch, the
+ * host sends the difference between its current state and that base,
+ * which is usually a small fraction of a full savestate.
+ *
+ * Patches are a run-length coded XOR against the base, in 16-bit
+ * words. A run is either
+ *    changed, skip, XOR[changed]
+ * or, for skips that don't fit into 16 bits,
+ *    0, skip low, skip high
+ * and the patch ends with 0, 0, 0. All words are little endian. */
+
+/* Checksums kept for comparison, in frames. */
+#define NETPLAY_SYNC_CHECKSUMS  64
+/* States kept as a base for patches. */
+#define NETPLAY_SYNC_SNAPSHOTS  4
+/* Frames between snapshots, rounded up to a multiple of
+ * the checksum interval. */
+#define NETPLAY_SYNC_INTERVAL   60
+/* Base frame of a patch against an all-zero state. */
+#define NETPLAY_SYNC_NO_BASE    0xffffffffu
+
+enum netplay_sync_result
+{
+   /* The other side's checksum hasn't arrived yet, or is gone. */
+   NETPLAY_SYNC_PENDING = 0,
+   NETPLAY_SYNC_MATCH,
+   NETPLAY_SYNC_MISMATCH
+};
+
+typedef struct netplay_sync netplay_sync_t;
+
+/**
+ * netplay_sync_new:
+ * @state_size           : savestate size.
+ * @check_frames         : frames between checksums, at least 1.
+ *
+ * Returns: new sync state, or NULL on failure.
+ **/
+netplay_sync_t *netplay_sync_new(size_t state_size, unsigned check_frames);
+
+void netplay_sync_free(netplay_sync_t *sync);
+
+/* True if @frame is one that gets checksummed. */
+bool netplay_sync_is_check_frame(netplay_sync_t *sync, uint32_t frame);
+
+/* True if @frame is one that gets snapshotted. */
+bool netplay_sync_is_snapshot_frame(netplay_sync_t *sync, uint32_t frame);
+
+uint32_t netplay_sync_checksum(const void *data, size_t size);
+
+/**
+ * netplay_sync_local:
+ * @sync                 : sync state.
+ * @frame                : frame number.
+ * @checksum             : our checksum of the state at the start of @frame.
+ *
+ * Records our own checksum.
+ *
+ * Returns: result of comparing it to the other side's, if that
+ * has already arrived.
+ **/
+enum netplay_sync_result netplay_sync_local(netplay_sync_t *sync,
+      uint32_t frame, uint32_t checksum);
+
+/* Same as netplay_sync_local(), for the other side's checksum. */
+enum netplay_sync_result netplay_sync_remote(netplay_sync_t *sync,
+      uint32_t frame, uint32_t checksum);
+
+/* Forgets the other side's checksums, e.g. once its state
+ * has been patched. */
+void netplay_sync_clear_remote(netplay_sync_t *sync);
+
+/**
+ * netplay_sync_snapshot:
+ * @sync                 : sync state.
+ * @frame                : frame number.
+ * @state                : state at the start of @frame.
+ * @shared               : true if the other side is known to have it.
+ *
+ * Keeps a copy of @state, replacing the oldest one. A snapshot
+ * of a frame whose checksums match later on becomes shared too.
+ **/
+void netplay_sync_snapshot(netplay_sync_t *sync, uint32_t frame,
+      const void *state, bool shared);
+
+/**
+ * netplay_sync_find:
+ * @sync                 : sync state.
+ * @frame                : frame number, or NETPLAY_SYNC_NO_BASE.
+ *
+ * Returns: snapshot of @frame, all zeroes for NETPLAY_SYNC_NO_BASE,
+ * or NULL if there is no such snapshot.
+ **/
+const void *netplay_sync_find(netplay_sync_t *sync, uint32_t frame);
+
+/**
+ * netplay_sync_shared_base:
+ * @sync                 : sync state.
+ *
+ * Returns: frame of the newest shared snapshot, or
+ * NETPLAY_SYNC_NO_BASE if there is none.
+ **/
+uint32_t netplay_sync_shared_base(netplay_sync_t *sync);
+
+/* Largest possible patch. */
+size_t netplay_sync_patch_max(netplay_sync_t *sync);
+
+/**
+ * netplay_sync_diff:
+ * @sync                 : sync state.
+ * @base                 : frame of the base state, see netplay_sync_find().
+ * @state                : state to encode.
+ * @patch                : at least netplay_sync_patch_max() bytes.
+ *
+ * Returns: size of the patch, or 0 if there is no snapshot of @base.
+ **/
+size_t netplay_sync_diff(netplay_sync_t *sync, uint32_t base,
+      const void *state, void *patch);
+
+/**
+ * netplay_sync_apply:
+ * @sync                 : sync state.
+ * @base                 : frame of the base state, see netplay_sync_find().
+ * @patch                : patch from netplay_sync_diff().
+ * @patch_size           : size of patch.
+ * @state                : set to the patched state.
+ *
+ * Returns: true (1) if successful, false (0) if there is no snapshot
+ * of @base or the patch is malformed.
+ **/
+bool netplay_sync_apply(netplay_sync_t *sync, uint32_t base,
+      const void *patch, size_t patch_size, void *state);
+
+#endif
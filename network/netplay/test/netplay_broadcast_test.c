@@ -0,0 +1,339 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2016 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Loopback load test for the spectator broadcast.
+ *
+ * Hundreds of spectators connect, each gets its own header and then
+ * the same stream, which a reader thread checks byte by byte. One
+ * spectator never reads and has to be dropped as too slow, another
+ * hangs up right away. Neither may hold up the host or the others.
+ *
+ * Usage: netplay_broadcast_test [spectators] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <unistd.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+#include <boolean.h>
+#include <features/features_cpu.h>
+#include <rthreads/rthreads.h>
+#include <retro_atomic.h>
+#include <retro_test.h>
+
+#include "../netplay_broadcast.h"
+
+#define TEST_FRAMES           2000
+#define TEST_FRAME_SIZE       256
+#define TEST_FRAME_USEC       500
+#define TEST_HISTORY          (64 * 1024)
+#define TEST_HEADER_SIZE      24
+#define TEST_STREAM_SIZE      ((size_t)TEST_FRAMES * TEST_FRAME_SIZE)
+
+struct spectator
+{
+   int fd;
+   char header[TEST_HEADER_SIZE];
+   size_t received;
+   bool broken;
+};
+
+struct reader
+{
+   struct spectator *spectators;
+   unsigned num;
+   retro_atomic_int_t done;
+   retro_atomic_int_t quit;
+};
+
+static uint8_t stream_byte(size_t pos)
+{
+   return (uint8_t)(pos / TEST_FRAME_SIZE + pos % TEST_FRAME_SIZE);
+}
+
+static void check_bytes(struct spectator *s, const uint8_t *buf, size_t size)
+{
+   size_t i;
+
+   for (i = 0; i < size && !s->broken; i++, s->received++)
+   {
+      uint8_t expected = s->received < TEST_HEADER_SIZE
+         ? (uint8_t)s->header[s->received]
+         : stream_byte(s->received - TEST_HEADER_SIZE);
+
+      if (buf[i] != expected)
+         s->broken = true;
+   }
+}
+
+static void reader_thread(void *data)
+{
+   unsigned i;
+   uint8_t buf[16384];
+   struct reader *r     = (struct reader*)data;
+   struct pollfd *fds   = (struct pollfd*)calloc(r->num, sizeof(*fds));
+
+   while (!retro_atomic_load(&r->quit))
+   {
+      unsigned active = 0;
+
+      for (i = 0; i < r->num; i++)
+      {
+         struct spectator *s = &r->spectators[i];
+         bool finished       = s->broken ||
+            s->received == TEST_HEADER_SIZE + TEST_STREAM_SIZE;
+
+         fds[i].fd     = finished ? -1 : s->fd;
+         fds[i].events = POLLIN;
+         if (!finished)
+            active++;
+      }
+
+      if (!active)
+         break;
+
+      if (poll(fds, r->num, 100) <= 0)
+         continue;
+
+      for (i = 0; i < r->num; i++)
+      {
+         ssize_t ret;
+
+         if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+            continue;
+
+         ret = recv(fds[i].fd, buf, sizeof(buf), 0);
+         if (ret > 0)
+            check_bytes(&r->spectators[i], buf, ret);
+         else
+            r->spectators[i].broken = true;
+      }
+   }
+
+   free(fds);
+   retro_atomic_store_release(&r->done, 1);
+}
+
+static int listen_loopback(struct sockaddr_in *addr, int backlog)
+{
+   socklen_t len = sizeof(*addr);
+   int fd        = socket(AF_INET, SOCK_STREAM, 0);
+
+   memset(addr, 0, sizeof(*addr));
+   addr->sin_family      = AF_INET;
+   addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+   if (fd < 0 || bind(fd, (struct sockaddr*)addr, sizeof(*addr)) < 0 ||
+         listen(fd, backlog) < 0 ||
+         getsockname(fd, (struct sockaddr*)addr, &len) < 0)
+      return -1;
+   return fd;
+}
+
+/* Connects a spectator and hands the host side to the broadcast. */
+static int connect_spectator(netplay_broadcast_t *bcast, int listener,
+      const struct sockaddr_in *addr, const char *header, int bufsize)
+{
+   int host_fd;
+   int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+   if (bufsize)
+      setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufsize, sizeof(bufsize));
+
+   if (connect(fd, (const struct sockaddr*)addr, sizeof(*addr)) < 0)
+   {
+      close(fd);
+      return -1;
+   }
+
+   host_fd = accept(listener, NULL, NULL);
+   if (bufsize)
+      setsockopt(host_fd, SOL_SOCKET, SO_SNDBUF, &bufsize, sizeof(bufsize));
+
+   if (host_fd < 0 ||
+         netplay_broadcast_add(bcast, host_fd, header, TEST_HEADER_SIZE) < 0)
+   {
+      close(fd);
+      return -1;
+   }
+
+   return fd;
+}
+
+/* Each spectator takes two descriptors. */
+static unsigned fit_fd_limit(unsigned spectators)
+{
+   struct rlimit lim;
+   rlim_t needed = (rlim_t)spectators * 2 + 64;
+
+   if (getrlimit(RLIMIT_NOFILE, &lim) < 0)
+      return spectators;
+
+   if (lim.rlim_cur < needed)
+   {
+      lim.rlim_cur = lim.rlim_max < needed ? lim.rlim_max : needed;
+      setrlimit(RLIMIT_NOFILE, &lim);
+      getrlimit(RLIMIT_NOFILE, &lim);
+   }
+
+   if (lim.rlim_cur < needed)
+   {
+      spectators = lim.rlim_cur > 64 ? (unsigned)(lim.rlim_cur - 64) / 2 : 1;
+      printf("descriptor limit %lu, using %u spectators\n",
+            (unsigned long)lim.rlim_cur, spectators);
+   }
+
+   return spectators;
+}
+
+static void test_broadcast(unsigned num)
+{
+   unsigned i, frame, delivered = 0;
+   int listener, slow_fd, hangup_fd, idx;
+   bool slow_dropped = false, hangup_dropped = false;
+   unsigned other_drops = 0;
+   enum netplay_broadcast_drop reason;
+   struct sockaddr_in addr;
+   struct reader r;
+   sthread_t *thread;
+   char header[TEST_HEADER_SIZE];
+   uint8_t data[TEST_FRAME_SIZE];
+   retro_time_t total = 0, worst = 0, start, deadline;
+   netplay_broadcast_t *bcast = netplay_broadcast_new(TEST_HISTORY, num + 2);
+
+   CHECK(bcast && netplay_broadcast_start(bcast), "failed to start");
+   if (!bcast)
+      return;
+
+   listener = listen_loopback(&addr, num + 2);
+   CHECK(listener >= 0, "failed to listen");
+
+   memset(&r, 0, sizeof(r));
+   r.spectators = (struct spectator*)calloc(num, sizeof(*r.spectators));
+
+   for (i = 0; i < num; i++)
+   {
+      struct spectator *s = &r.spectators[i];
+
+      snprintf(s->header, sizeof(s->header), "spectator %05u", i);
+      s->fd = connect_spectator(bcast, listener, &addr, s->header, 0);
+      if (s->fd < 0)
+         break;
+   }
+
+   CHECK(i == num, "only %u of %u spectators connected", i, num);
+   r.num = i;
+
+   memset(header, 0, sizeof(header));
+   snprintf(header, sizeof(header), "slow");
+   slow_fd   = connect_spectator(bcast, listener, &addr, header, 4096);
+   snprintf(header, sizeof(header), "hangup");
+   hangup_fd = connect_spectator(bcast, listener, &addr, header, 0);
+   CHECK(slow_fd >= 0 && hangup_fd >= 0, "failed to connect");
+   close(hangup_fd);
+
+   thread = sthread_create(reader_thread, &r);
+
+   for (frame = 0; frame < TEST_FRAMES; frame++)
+   {
+      retro_time_t spent;
+
+      for (i = 0; i < TEST_FRAME_SIZE; i++)
+         data[i] = stream_byte((size_t)frame * TEST_FRAME_SIZE + i);
+
+      start = cpu_features_get_time_usec();
+      netplay_broadcast_write(bcast, data, sizeof(data));
+      spent = cpu_features_get_time_usec() - start;
+
+      total += spent;
+      if (spent > worst)
+         worst = spent;
+
+      while ((idx = netplay_broadcast_reap(bcast, &reason)) >= 0)
+      {
+         if (idx == (int)r.num && reason == NETPLAY_BROADCAST_TOO_SLOW)
+            slow_dropped = true;
+         else if (idx == (int)r.num + 1 && reason == NETPLAY_BROADCAST_HANGUP)
+            hangup_dropped = true;
+         else
+            other_drops++;
+      }
+
+      usleep(TEST_FRAME_USEC);
+   }
+
+   deadline = cpu_features_get_time_usec() + 10 * 1000 * 1000;
+   while (!retro_atomic_load_acquire(&r.done) &&
+         cpu_features_get_time_usec() < deadline)
+      usleep(1000);
+
+   retro_atomic_store(&r.quit, 1);
+   sthread_join(thread);
+
+   while ((idx = netplay_broadcast_reap(bcast, &reason)) >= 0)
+   {
+      if (idx == (int)r.num && reason == NETPLAY_BROADCAST_TOO_SLOW)
+         slow_dropped = true;
+      else if (idx == (int)r.num + 1 && reason == NETPLAY_BROADCAST_HANGUP)
+         hangup_dropped = true;
+      else
+         other_drops++;
+   }
+
+   for (i = 0; i < r.num; i++)
+   {
+      struct spectator *s = &r.spectators[i];
+
+      if (!s->broken && s->received == TEST_HEADER_SIZE + TEST_STREAM_SIZE)
+         delivered++;
+      close(s->fd);
+   }
+
+   CHECK(delivered == r.num, "%u of %u spectators got the whole stream",
+         delivered, r.num);
+   CHECK(slow_dropped, "slow spectator not dropped");
+   CHECK(hangup_dropped, "hangup not noticed");
+   CHECK(other_drops == 0, "%u spectators dropped for no reason",
+         other_drops);
+   CHECK(netplay_broadcast_clients(bcast) == r.num,
+         "%u spectators left, expected %u",
+         netplay_broadcast_clients(bcast), r.num);
+   /* Generous, as this only has to rule out blocking on spectators. */
+   CHECK(worst < 20 * 1000, "a write took %.1f ms", worst / 1000.0);
+
+   printf("%u spectators, %u KB each: write avg %.2f us, max %.1f us\n",
+         r.num, (unsigned)(TEST_STREAM_SIZE / 1024),
+         (double)total / TEST_FRAMES, (double)worst);
+
+   netplay_broadcast_free(bcast);
+   close(slow_fd);
+   close(listener);
+   free(r.spectators);
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned spectators = argc > 1 ? strtoul(argv[1], NULL, 0) : 400;
+
+   test_broadcast(fit_fd_limit(spectators));
+
+   return test_result();
+}
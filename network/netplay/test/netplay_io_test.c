@@ -0,0 +1,587 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2016 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Loopback tests for the netplay transport.
+ *
+ * Input packets go through a proxy thread which delays, jitters and
+ * drops them, and are reassembled from the redundant frames in each
+ * packet the way netplay does. The TCP tests check that commands
+ * arrive intact, that sending never blocks on a peer which stopped
+ * reading, and that a hangup is noticed.
+ *
+ * Usage: netplay_io_test [latency ms] [jitter ms] [loss %] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+
+#include <boolean.h>
+#include <features/features_cpu.h>
+#include <rthreads/rthreads.h>
+#include <retro_atomic.h>
+
+#include "../netplay_io.h"
+#include "netplay_test.h"
+
+/* Matches netplay_private.h. */
+#define UDP_FRAME_PACKETS     16
+#define UDP_WORDS_PER_FRAME   4
+
+#define TEST_FRAMES           1200
+#define TEST_FRAME_USEC       2000
+#define TEST_COMMANDS         2000
+
+#define PROXY_MAX_PENDING     4096
+
+struct proxy_packet
+{
+   retro_time_t due;
+   int to_b;
+   size_t size;
+   uint8_t data[NETPLAY_IO_MAX_DATAGRAM];
+};
+
+struct proxy
+{
+   /* fd_a faces endpoint A, fd_b faces endpoint B. */
+   int fd_a, fd_b;
+   struct sockaddr_in addr_a, addr_b;
+   bool have_a;
+
+   unsigned latency_us, jitter_us, loss_pct;
+   uint32_t seed;
+
+   struct proxy_packet *pending;
+   unsigned num_pending;
+
+   unsigned forwarded, dropped;
+   retro_atomic_int_t quit;
+};
+
+static uint32_t proxy_rand(struct proxy *p)
+{
+   p->seed = p->seed * 1664525 + 1013904223;
+   return p->seed >> 8;
+}
+
+static int udp_bind_loopback(struct sockaddr_in *addr)
+{
+   socklen_t len = sizeof(*addr);
+   int fd        = socket(AF_INET, SOCK_DGRAM, 0);
+
+   memset(addr, 0, sizeof(*addr));
+   addr->sin_family      = AF_INET;
+   addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+   if (fd < 0 || bind(fd, (struct sockaddr*)addr, sizeof(*addr)) < 0 ||
+         getsockname(fd, (struct sockaddr*)addr, &len) < 0)
+      return -1;
+   return fd;
+}
+
+static void proxy_receive(struct proxy *p, int fd, int to_b)
+{
+   struct proxy_packet *pkt;
+   struct sockaddr_in from;
+   socklen_t len = sizeof(from);
+   uint8_t buf[NETPLAY_IO_MAX_DATAGRAM];
+   ssize_t ret   = recvfrom(fd, buf, sizeof(buf), 0,
+         (struct sockaddr*)&from, &len);
+
+   if (ret <= 0)
+      return;
+
+   if (to_b)
+   {
+      p->addr_a = from;
+      p->have_a = true;
+   }
+
+   if (proxy_rand(p) % 100 < p->loss_pct ||
+         p->num_pending >= PROXY_MAX_PENDING)
+   {
+      p->dropped++;
+      return;
+   }
+
+   pkt       = &p->pending[p->num_pending++];
+   pkt->due  = cpu_features_get_time_usec() + p->latency_us;
+   if (p->jitter_us)
+      pkt->due += proxy_rand(p) % p->jitter_us;
+   pkt->to_b = to_b;
+   pkt->size = ret;
+   memcpy(pkt->data, buf, ret);
+}
+
+static void proxy_thread(void *data)
+{
+   struct proxy *p = (struct proxy*)data;
+
+   while (!retro_atomic_load(&p->quit))
+   {
+      unsigned i;
+      fd_set fds;
+      struct timeval tv;
+      retro_time_t now  = cpu_features_get_time_usec();
+      retro_time_t next = now + 1000;
+      int max_fd        = p->fd_a > p->fd_b ? p->fd_a : p->fd_b;
+
+      /* Jitter reorders packets, like a real network would. */
+      for (i = 0; i < p->num_pending; )
+      {
+         struct proxy_packet *pkt = &p->pending[i];
+
+         if (pkt->due > now)
+         {
+            if (pkt->due < next)
+               next = pkt->due;
+            i++;
+            continue;
+         }
+
+         if (pkt->to_b)
+            sendto(p->fd_b, pkt->data, pkt->size, 0,
+                  (struct sockaddr*)&p->addr_b, sizeof(p->addr_b));
+         else if (p->have_a)
+            sendto(p->fd_a, pkt->data, pkt->size, 0,
+                  (struct sockaddr*)&p->addr_a, sizeof(p->addr_a));
+         p->forwarded++;
+
+         *pkt = p->pending[--p->num_pending];
+      }
+
+      FD_ZERO(&fds);
+      FD_SET(p->fd_a, &fds);
+      FD_SET(p->fd_b, &fds);
+      tv.tv_sec  = 0;
+      tv.tv_usec = next > now ? next - now : 0;
+
+      if (select(max_fd + 1, &fds, NULL, NULL, &tv) <= 0)
+         continue;
+
+      if (FD_ISSET(p->fd_a, &fds))
+         proxy_receive(p, p->fd_a, 1);
+      if (FD_ISSET(p->fd_b, &fds))
+         proxy_receive(p, p->fd_b, 0);
+   }
+}
+
+/* Same layout as get_self_input_state(). */
+static void push_frame(uint32_t *packet, uint32_t frame)
+{
+   uint32_t *last = packet + (UDP_FRAME_PACKETS - 1) * UDP_WORDS_PER_FRAME;
+
+   memmove(packet, packet + UDP_WORDS_PER_FRAME,
+         (UDP_FRAME_PACKETS - 1) * UDP_WORDS_PER_FRAME * sizeof(uint32_t));
+   last[0] = htonl(frame);
+   last[1] = htonl(frame * 2654435761u);
+   last[2] = htonl(~frame);
+   last[3] = htonl(frame ^ 0x5a5a5a5a);
+}
+
+/* Same as parse_packet(), returns the next frame still missing. */
+static uint32_t parse_frames(const uint32_t *packet, uint32_t read_frame,
+      retro_time_t *received, unsigned *corrupt)
+{
+   unsigned i;
+
+   for (i = 0; i < UDP_FRAME_PACKETS; i++)
+   {
+      const uint32_t *f = packet + i * UDP_WORDS_PER_FRAME;
+      uint32_t frame    = ntohl(f[0]);
+
+      if (frame != read_frame)
+         continue;
+
+      if (ntohl(f[1]) != frame * 2654435761u || ntohl(f[2]) != ~frame ||
+            ntohl(f[3]) != (frame ^ 0x5a5a5a5a))
+         (*corrupt)++;
+
+      received[read_frame++] = cpu_features_get_time_usec();
+   }
+
+   return read_frame;
+}
+
+static void test_input_stream(unsigned latency_ms, unsigned jitter_ms,
+      unsigned loss_pct)
+{
+   unsigned i;
+   int conn_a, conn_b;
+   struct sockaddr_in addr_a, proxy_a;
+   sthread_t *thread;
+   uint32_t packet[UDP_FRAME_PACKETS * UDP_WORDS_PER_FRAME] = {0};
+   uint32_t frame = 1, read_frame = 1;
+   unsigned corrupt = 0;
+   retro_time_t next_frame, worst = 0, total = 0;
+   retro_time_t *sent     = (retro_time_t*)calloc(TEST_FRAMES + 1,
+         sizeof(*sent));
+   retro_time_t *received = (retro_time_t*)calloc(TEST_FRAMES + 1,
+         sizeof(*received));
+   struct proxy *p        = (struct proxy*)calloc(1, sizeof(*p));
+   netplay_io_t *io_a     = netplay_io_new();
+   netplay_io_t *io_b     = netplay_io_new();
+   struct sockaddr_in addr_b;
+   int fd_a               = udp_bind_loopback(&addr_a);
+   int fd_b               = udp_bind_loopback(&addr_b);
+
+   p->pending    = (struct proxy_packet*)calloc(PROXY_MAX_PENDING,
+         sizeof(*p->pending));
+   p->fd_a       = udp_bind_loopback(&proxy_a);
+   p->fd_b       = udp_bind_loopback(&p->addr_b);
+   p->addr_b     = addr_b;
+   p->latency_us = latency_ms * 1000;
+   p->jitter_us  = jitter_ms * 1000;
+   p->loss_pct   = loss_pct;
+   p->seed       = 1;
+
+   CHECK(fd_a >= 0 && fd_b >= 0 && p->fd_a >= 0 && p->fd_b >= 0,
+         "failed to create sockets");
+
+   conn_a = netplay_io_add(io_a, fd_a, NETPLAY_IO_DATAGRAM);
+   conn_b = netplay_io_add(io_b, fd_b, NETPLAY_IO_DATAGRAM);
+   CHECK(conn_a >= 0 && conn_b >= 0, "failed to add connections");
+   CHECK(netplay_io_start(io_a) && netplay_io_start(io_b),
+         "failed to start");
+
+   thread = sthread_create(proxy_thread, p);
+
+   next_frame = cpu_features_get_time_usec();
+
+   while (read_frame <= TEST_FRAMES)
+   {
+      retro_time_t now = cpu_features_get_time_usec();
+
+      if (frame <= TEST_FRAMES && now >= next_frame)
+      {
+         push_frame(packet, frame);
+         sent[frame++] = now;
+         netplay_io_sendto(io_a, conn_a, packet, sizeof(packet),
+               (struct sockaddr*)&proxy_a, sizeof(proxy_a));
+         next_frame += TEST_FRAME_USEC;
+      }
+
+      if (frame > TEST_FRAMES)
+      {
+         /* Keep resending the last packet, like poll_input() does
+          * when it stalls. */
+         if (now - sent[TEST_FRAMES] > 4000 * 1000)
+            break;
+         if (!netplay_io_wait(io_b, 50))
+            netplay_io_sendto(io_a, conn_a, packet, sizeof(packet),
+                  (struct sockaddr*)&proxy_a, sizeof(proxy_a));
+      }
+      else
+      {
+         retro_time_t wait = next_frame - cpu_features_get_time_usec();
+         netplay_io_wait(io_b, wait > 0 ? (unsigned)(wait / 1000) : 0);
+      }
+
+      for (;;)
+      {
+         uint32_t in[UDP_FRAME_PACKETS * UDP_WORDS_PER_FRAME];
+         size_t size = sizeof(in);
+
+         if (!netplay_io_packet(io_b, conn_b, in, &size, NULL))
+            break;
+         CHECK(size == sizeof(in), "datagram size %u", (unsigned)size);
+         read_frame = parse_frames(in, read_frame, received, &corrupt);
+      }
+   }
+
+   retro_atomic_store(&p->quit, 1);
+   sthread_join(thread);
+
+   CHECK(read_frame == TEST_FRAMES + 1, "only got %u of %u frames",
+         read_frame - 1, TEST_FRAMES);
+   CHECK(!corrupt, "%u corrupt frames", corrupt);
+
+   for (i = 1; i < read_frame; i++)
+   {
+      retro_time_t delay = received[i] - sent[i];
+      total += delay;
+      if (delay > worst)
+         worst = delay;
+   }
+
+   printf("input stream: %u frames, %u ms latency, %u ms jitter, %u%% loss: "
+         "%u packets forwarded, %u dropped, %u dropped by queue, "
+         "frame delay avg %.1f ms max %.1f ms\n",
+         TEST_FRAMES, latency_ms, jitter_ms, loss_pct,
+         p->forwarded, p->dropped,
+         netplay_io_packets_dropped(io_b, conn_b),
+         read_frame > 1 ? total / 1000.0 / (read_frame - 1) : 0.0,
+         worst / 1000.0);
+
+   netplay_io_free(io_a);
+   netplay_io_free(io_b);
+   close(fd_a);
+   close(fd_b);
+   close(p->fd_a);
+   close(p->fd_b);
+   free(p->pending);
+   free(p);
+   free(sent);
+   free(received);
+}
+
+static void test_commands(void)
+{
+   unsigned sent = 0, got = 0, bad = 0;
+   int fd_a, fd_b, conn_a, conn_b;
+   retro_time_t deadline;
+   netplay_io_t *io_a = netplay_io_new();
+   netplay_io_t *io_b = netplay_io_new();
+
+   CHECK(tcp_pair(&fd_a, &fd_b), "failed to connect");
+   conn_a = netplay_io_add(io_a, fd_a, NETPLAY_IO_STREAM);
+   conn_b = netplay_io_add(io_b, fd_b, NETPLAY_IO_STREAM);
+   netplay_io_start(io_a);
+   netplay_io_start(io_b);
+
+   deadline = cpu_features_get_time_usec() + 5000 * 1000;
+
+   /* Command headers with a varying argument, echoed back. */
+   while (got < TEST_COMMANDS && cpu_features_get_time_usec() < deadline)
+   {
+      uint32_t cmd[3];
+
+      while (sent < TEST_COMMANDS && sent - got < 64)
+      {
+         cmd[0] = htonl((0x30 << 16) | (sent % 9));
+         cmd[1] = htonl(sent);
+         cmd[2] = htonl(~sent);
+         if (!netplay_io_send(io_a, conn_a, cmd, 4 + sent % 9))
+            break;
+         sent++;
+      }
+
+      netplay_io_wait(io_b, 10);
+      while (netplay_io_recv(io_b, conn_b, cmd, 4, true))
+      {
+         size_t arg = ntohl(cmd[0]) & 0xffff;
+         if (!netplay_io_recv(io_b, conn_b, cmd, 4 + arg, false))
+            break;
+         netplay_io_send(io_b, conn_b, cmd, 4 + arg);
+      }
+
+      netplay_io_wait(io_a, 10);
+      while (netplay_io_recv(io_a, conn_a, cmd, 4, true))
+      {
+         uint32_t expect[3];
+         size_t arg = ntohl(cmd[0]) & 0xffff;
+
+         if (!netplay_io_recv(io_a, conn_a, cmd, 4 + arg, false))
+            break;
+
+         expect[0] = htonl((0x30 << 16) | (got % 9));
+         expect[1] = htonl(got);
+         expect[2] = htonl(~got);
+         if (arg != got % 9 || memcmp(cmd, expect, 4 + arg))
+            bad++;
+         got++;
+      }
+   }
+
+   CHECK(got == TEST_COMMANDS, "got %u of %u commands back",
+         got, TEST_COMMANDS);
+   CHECK(!bad, "%u commands came back wrong", bad);
+   printf("commands: %u round trips\n", got);
+
+   netplay_io_free(io_a);
+   netplay_io_free(io_b);
+   close(fd_a);
+   close(fd_b);
+}
+
+static void test_stalled_peer(void)
+{
+   char block[4096] = {0};
+   unsigned queued  = 0;
+   int fd_a, fd_b, conn_a, conn_b;
+   retro_time_t worst = 0, deadline;
+   netplay_io_t *io_a = netplay_io_new();
+   netplay_io_t *io_b = netplay_io_new();
+
+   CHECK(tcp_pair(&fd_a, &fd_b), "failed to connect");
+   conn_a = netplay_io_add(io_a, fd_a, NETPLAY_IO_STREAM);
+   netplay_io_start(io_a);
+
+   /* fd_b is never read, so its socket buffers fill up and sends
+    * start piling up in our send buffer. */
+   while (queued < 64 * 1024 * 1024)
+   {
+      retro_time_t start = cpu_features_get_time_usec();
+      bool ok            = netplay_io_send(io_a, conn_a, block, sizeof(block));
+      retro_time_t spent = cpu_features_get_time_usec() - start;
+
+      if (spent > worst)
+         worst = spent;
+      if (!ok)
+         break;
+      queued += sizeof(block);
+   }
+
+   CHECK(queued < 64 * 1024 * 1024, "send buffer never filled up");
+   CHECK(netplay_io_alive(io_a, conn_a), "stall counted as a hangup");
+   /* Generous, as this only has to rule out blocking on the peer. */
+   CHECK(worst < 50 * 1000, "a send took %.1f ms", worst / 1000.0);
+   printf("stalled peer: %u KB queued, slowest send %.3f ms\n",
+         queued / 1024, worst / 1000.0);
+
+   /* Now hang up, and the other side should notice. */
+   conn_b = netplay_io_add(io_b, fd_b, NETPLAY_IO_STREAM);
+   netplay_io_start(io_b);
+   netplay_io_free(io_a);
+   close(fd_a);
+
+   deadline = cpu_features_get_time_usec() + 5000 * 1000;
+   while (netplay_io_alive(io_b, conn_b) &&
+         cpu_features_get_time_usec() < deadline)
+   {
+      netplay_io_wait(io_b, 100);
+      /* Drain what was sent before the hangup. */
+      netplay_io_recv(io_b, conn_b, NULL,
+            netplay_io_recv_avail(io_b, conn_b), false);
+   }
+
+   CHECK(!netplay_io_alive(io_b, conn_b), "hangup not noticed");
+
+   netplay_io_free(io_b);
+   close(fd_b);
+}
+
+/* Data is timed from when it arrived, not from when it's read. */
+static void test_recv_time(void)
+{
+   char buf[16] = {0};
+   int fd_a, fd_b, conn_b;
+   retro_time_t first, second, now;
+   netplay_io_t *io_b = netplay_io_new();
+
+   CHECK(tcp_pair(&fd_a, &fd_b), "failed to connect");
+   conn_b = netplay_io_add(io_b, fd_b, NETPLAY_IO_STREAM);
+   netplay_io_start(io_b);
+
+   CHECK(send(fd_a, buf, 8, 0) == 8, "send failed");
+   while (netplay_io_recv_avail(io_b, conn_b) < 8)
+      netplay_io_wait(io_b, 100);
+   usleep(50 * 1000);
+
+   first = netplay_io_recv_time(io_b, conn_b);
+   now   = cpu_features_get_time_usec();
+   CHECK(now - first >= 45 * 1000, "data read 50 ms after arrival "
+         "looks %.1f ms old", (now - first) / 1000.0);
+
+   CHECK(send(fd_a, buf, 8, 0) == 8, "send failed");
+   while (netplay_io_recv_avail(io_b, conn_b) < 16)
+      netplay_io_wait(io_b, 100);
+
+   /* The first batch is still in front. */
+   netplay_io_recv(io_b, conn_b, buf, 4, false);
+   CHECK(netplay_io_recv_time(io_b, conn_b) == first,
+         "part of the first batch got a new time");
+
+   netplay_io_recv(io_b, conn_b, buf, 4, false);
+   second = netplay_io_recv_time(io_b, conn_b);
+   CHECK(second - first >= 45 * 1000, "second batch timed %.1f ms "
+         "after the first", (second - first) / 1000.0);
+
+   netplay_io_free(io_b);
+   close(fd_a);
+   close(fd_b);
+}
+
+/* A peer which resets the connection while our receive ring is full
+ * makes the socket report an error and a hangup that can't be read
+ * yet. That must not keep the I/O thread spinning. */
+static void test_reset_peer(void)
+{
+   char block[4096] = {0};
+   struct linger linger;
+   unsigned written = 0;
+   int fd_a, fd_b, conn_b;
+   clock_t cpu;
+   retro_time_t deadline;
+   netplay_io_t *io_b = netplay_io_new();
+
+   CHECK(tcp_pair(&fd_a, &fd_b), "failed to connect");
+   conn_b = netplay_io_add(io_b, fd_b, NETPLAY_IO_STREAM);
+   netplay_io_start(io_b);
+
+   fcntl(fd_a, F_SETFL, fcntl(fd_a, F_GETFL) | O_NONBLOCK);
+   while (written < 16 * 1024 * 1024)
+   {
+      ssize_t ret = send(fd_a, block, sizeof(block), MSG_NOSIGNAL);
+      if (ret <= 0)
+         break;
+      written += ret;
+   }
+
+   /* Give the ring time to fill up, then reset. */
+   usleep(100 * 1000);
+   linger.l_onoff  = 1;
+   linger.l_linger = 0;
+   setsockopt(fd_a, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
+   close(fd_a);
+
+   cpu = clock();
+   usleep(300 * 1000);
+   cpu = clock() - cpu;
+
+   CHECK(cpu < CLOCKS_PER_SEC / 10,
+         "I/O thread used %.0f ms of CPU while stalled on a reset",
+         cpu * 1000.0 / CLOCKS_PER_SEC);
+   printf("reset peer: %u KB written, %.1f ms CPU while stalled\n",
+         written / 1024, cpu * 1000.0 / CLOCKS_PER_SEC);
+
+   deadline = cpu_features_get_time_usec() + 5000 * 1000;
+   while (netplay_io_alive(io_b, conn_b) &&
+         cpu_features_get_time_usec() < deadline)
+   {
+      netplay_io_recv(io_b, conn_b, NULL,
+            netplay_io_recv_avail(io_b, conn_b), false);
+      netplay_io_wait(io_b, 100);
+   }
+
+   CHECK(!netplay_io_alive(io_b, conn_b), "reset not noticed");
+
+   netplay_io_free(io_b);
+   close(fd_b);
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned latency_ms = argc > 1 ? strtoul(argv[1], NULL, 0) : 20;
+   unsigned jitter_ms  = argc > 2 ? strtoul(argv[2], NULL, 0) : 10;
+   unsigned loss_pct   = argc > 3 ? strtoul(argv[3], NULL, 0) : 10;
+
+   test_input_stream(0, 0, 0);
+   test_input_stream(latency_ms, jitter_ms, loss_pct);
+   test_commands();
+   test_stalled_peer();
+   test_recv_time();
+   test_reset_peer();
+
+   return test_result();
+}
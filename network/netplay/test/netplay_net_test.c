@@ -0,0 +1,652 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2016 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Tests for the rollback and resync code in netplay_net.c.
+ *
+ * A host and a client run a fake core in lockstep through the real
+ * netplay_net.c frame callbacks. Each side sees the other's input a
+ * few frames late, so frames are predicted and replayed. Commands go
+ * over a loopback connection. The client is knocked out of sync,
+ * and the host has to notice and patch it back.
+ *
+ * The input delay queue and the adaptive delay are tested on their
+ * own first.
+ *
+ * Only what netplay_net.c needs from the rest of RetroArch is
+ * stubbed out below: the core, input polling and the handshake.
+ *
+ * Usage: netplay_net_test [state size] */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <unistd.h>
+
+#include "../netplay_private.h"
+#include "netplay_test.h"
+
+#define TEST_STATE_SIZE       (256 * 1024)
+#define TEST_RAM_OFFSET       4096
+#define TEST_RAM_SIZE         2048
+#define TEST_FRAMES           900
+/* Both sides send no input for this many frames at the end, so
+ * every prediction comes true and the states have to match. */
+#define TEST_IDLE_FRAMES      60
+#define TEST_DESYNC_FRAME     300
+/* Frames until the other side's input arrives. */
+#define TEST_LAG              3
+#define TEST_DELAY_FRAMES     8
+
+struct test_side
+{
+   netplay_t *netplay;
+   uint8_t *core;
+   bool host;
+};
+
+static size_t test_state_size = TEST_STATE_SIZE;
+/* Side whose frame is being run. */
+static struct test_side *test_cur;
+static unsigned test_desyncs;
+static unsigned test_patches;
+/* Frame which the client's core runs differently, or 0. */
+static uint32_t test_desync_frame;
+
+/* Stubs. */
+
+void RARCH_LOG(const char *fmt, ...)
+{
+   if (strstr(fmt, "patched"))
+      test_patches++;
+}
+
+void RARCH_WARN(const char *fmt, ...)
+{
+   if (strstr(fmt, "desync"))
+      test_desyncs++;
+}
+
+void RARCH_ERR(const char *fmt, ...)
+{
+   va_list ap;
+   va_start(ap, fmt);
+   vfprintf(stderr, fmt, ap);
+   va_end(ap);
+}
+
+void autosave_lock(void) { }
+void autosave_unlock(void) { }
+
+bool netplay_send_info(netplay_t *netplay) { return true; }
+bool netplay_get_info(netplay_t *netplay) { return true; }
+
+bool netplay_is_server(netplay_t *netplay)
+{
+   return netplay->is_server;
+}
+
+bool netplay_send_raw_cmd(netplay_t *netplay, uint32_t cmd,
+      const void *data, size_t size)
+{
+   bool ret;
+   uint8_t *buf = (uint8_t*)malloc(sizeof(cmd) + size);
+
+   if (!buf)
+      return false;
+
+   cmd = htonl((cmd << 16) | (size & 0xffff));
+   memcpy(buf, &cmd, sizeof(cmd));
+   if (size)
+      memcpy(buf + sizeof(cmd), data, size);
+
+   ret = netplay_io_send(netplay->io, netplay->io_tcp,
+         buf, sizeof(cmd) + size);
+
+   free(buf);
+   return ret;
+}
+
+bool core_serialize_size(retro_ctx_size_info_t *info)
+{
+   info->size = test_state_size;
+   return true;
+}
+
+bool core_serialize(retro_ctx_serialize_info_t *info)
+{
+   memcpy(info->data, test_cur->core, info->size);
+   return true;
+}
+
+bool core_unserialize(retro_ctx_serialize_info_t *info)
+{
+   memcpy(test_cur->core, info->data_const, info->size);
+   return true;
+}
+
+static uint32_t test_rand(uint32_t *seed)
+{
+   *seed = *seed * 1664525 + 1013904223;
+   return *seed >> 8;
+}
+
+/* Input of either side, changing every few frames. Frame 0 has no
+ * input, as in netplay_poll(). */
+static uint32_t test_input(bool host, uint32_t frame)
+{
+   uint32_t seed = (frame / 5) * 2 + host;
+
+   if (frame == 0 || frame >= TEST_FRAMES - TEST_IDLE_FRAMES)
+      return 0;
+   return test_rand(&seed) & 0xfff;
+}
+
+/* Fake core: a frame counter, a value that depends on all input so
+ * far, some work RAM derived from it, and the rest stays as it was
+ * loaded. Reads input the way netplay_input_state() does. The
+ * client's copy goes wrong on test_desync_frame, replays included. */
+bool core_run(void)
+{
+   size_t i;
+   uint32_t frame, acc, seed, self, other;
+   netplay_t *netplay               = test_cur->netplay;
+   uint8_t *state                   = test_cur->core;
+   size_t ptr                       = netplay->is_replay ?
+      netplay->tmp_ptr : PREV_PTR(netplay->self_ptr);
+   const struct delta_frame *delta  = netplay->sync.replay_frame ?
+      netplay->sync.replay_frame : &netplay->buffer[ptr];
+
+   self  = delta->self_state[0];
+   other = delta->is_simulated ?
+      delta->simulated_input_state[0] : delta->real_input_state[0];
+
+   memcpy(&frame, state, sizeof(frame));
+   memcpy(&acc, state + 4, sizeof(acc));
+
+   /* Host is user 1. */
+   if (test_cur->host)
+      acc = acc * 31 + self * 7 + other * 13 + 1;
+   else
+      acc = acc * 31 + other * 7 + self * 13 + 1;
+   frame++;
+
+   seed = acc;
+   for (i = 0; i < TEST_RAM_SIZE; i += 16)
+      state[TEST_RAM_OFFSET + i] ^= (uint8_t)test_rand(&seed);
+
+   if (!test_cur->host && frame == test_desync_frame)
+      state[test_state_size / 2] ^= 0x10;
+
+   memcpy(state, &frame, sizeof(frame));
+   memcpy(state + 4, &acc, sizeof(acc));
+   return true;
+}
+
+/* What netplay_poll() does, with the other side's input arriving
+ * TEST_LAG frames late instead of over UDP. */
+void input_poll_net(void)
+{
+   struct test_side *side = test_cur;
+   netplay_t *netplay     = side->netplay;
+
+   if (!netplay->can_poll)
+      return;
+   netplay->can_poll = false;
+
+   memset(netplay->buffer[netplay->self_ptr].self_state, 0,
+         sizeof(netplay->buffer[0].self_state));
+   netplay->buffer[netplay->self_ptr].self_state[0] =
+      test_input(side->host, netplay->frame_count);
+   netplay->self_ptr = NEXT_PTR(netplay->self_ptr);
+
+   if (netplay->frame_count == 0)
+   {
+      netplay->buffer[0].used_real    = true;
+      netplay->buffer[0].is_simulated = false;
+      memset(netplay->buffer[0].real_input_state, 0,
+            sizeof(netplay->buffer[0].real_input_state));
+      netplay->read_ptr = NEXT_PTR(netplay->read_ptr);
+      netplay->read_frame_count++;
+      return;
+   }
+
+   while (netplay->read_frame_count <= netplay->frame_count &&
+         netplay->read_frame_count + TEST_LAG <= netplay->frame_count)
+   {
+      struct delta_frame *delta = &netplay->buffer[netplay->read_ptr];
+
+      delta->is_simulated = false;
+      memset(delta->real_input_state, 0, sizeof(delta->real_input_state));
+      delta->real_input_state[0] = test_input(!side->host,
+            netplay->read_frame_count);
+
+      netplay->read_ptr = NEXT_PTR(netplay->read_ptr);
+      netplay->read_frame_count++;
+   }
+
+   if (netplay->read_ptr != netplay->self_ptr)
+   {
+      size_t ptr  = PREV_PTR(netplay->self_ptr);
+      size_t prev = PREV_PTR(netplay->read_ptr);
+
+      memcpy(netplay->buffer[ptr].simulated_input_state,
+            netplay->buffer[prev].real_input_state,
+            sizeof(netplay->buffer[prev].real_input_state));
+      netplay->buffer[ptr].is_simulated = true;
+      netplay->buffer[ptr].used_real    = false;
+   }
+   else
+      netplay->buffer[PREV_PTR(netplay->self_ptr)].used_real = true;
+}
+
+/* The savestate commands of netplay_get_cmd(). */
+static void test_get_cmds(struct test_side *side)
+{
+   netplay_t *netplay = side->netplay;
+
+   for (;;)
+   {
+      uint32_t header, cmd, size;
+      size_t avail = netplay_io_recv_avail(netplay->io, netplay->io_tcp);
+
+      if (avail < sizeof(header))
+         return;
+
+      netplay_io_recv(netplay->io, netplay->io_tcp,
+            &header, sizeof(header), true);
+      header = ntohl(header);
+      cmd    = header >> 16;
+      size   = header & 0xffff;
+
+      if (avail < sizeof(header) + size)
+         return;
+
+      netplay_io_recv(netplay->io, netplay->io_tcp,
+            NULL, sizeof(header), false);
+
+      switch (cmd)
+      {
+         case NETPLAY_CMD_LOAD_SAVESTATE:
+            CHECK(netplay_net_sync_patch_cmd(netplay, size),
+                  "patch piece dropped");
+            break;
+
+         case NETPLAY_CMD_CRC:
+         {
+            uint32_t args[3];
+
+            CHECK(size == sizeof(args), "CRC of %u bytes", size);
+            netplay_io_recv(netplay->io, netplay->io_tcp,
+                  args, sizeof(args), false);
+            netplay_net_sync_checksum_cmd(netplay,
+                  ntohl(args[0]), ntohl(args[1]), ntohl(args[2]));
+            break;
+         }
+
+         default:
+            CHECK(false, "unexpected command %u", cmd);
+            netplay_io_recv(netplay->io, netplay->io_tcp,
+                  NULL, size, false);
+            break;
+      }
+   }
+}
+
+static void test_side_free(struct test_side *side)
+{
+   netplay_t *netplay = side->netplay;
+
+   if (netplay)
+   {
+      size_t i;
+
+      netplay_io_free(netplay->io);
+      if (netplay->fd >= 0)
+         close(netplay->fd);
+
+      if (netplay->buffer)
+         for (i = 0; i < netplay->buffer_size; i++)
+            free(netplay->buffer[i].state);
+      free(netplay->buffer);
+
+      netplay_sync_free(netplay->sync.data);
+      free(netplay->sync.patch);
+      free(netplay->sync.state);
+      free(netplay);
+   }
+
+   free(side->core);
+   memset(side, 0, sizeof(*side));
+}
+
+/* netplay_new() after the connection is up. */
+static bool test_side_init(struct test_side *side, bool host, int fd,
+      unsigned check_frames)
+{
+   netplay_t *netplay;
+
+   memset(side, 0, sizeof(*side));
+   side->host    = host;
+   side->core    = (uint8_t*)calloc(1, test_state_size);
+   side->netplay = netplay = (netplay_t*)calloc(1, sizeof(*netplay));
+
+   if (!side->core || !netplay)
+      return false;
+
+   netplay->fd                = fd;
+   netplay->is_server         = host;
+   netplay->port              = host ? 1 : 0;
+   netplay->sync.check_frames = check_frames;
+   netplay->net_cbs           = netplay_get_cbs_net();
+
+   test_cur = side;
+   return netplay->net_cbs->info_cb(netplay, TEST_DELAY_FRAMES);
+}
+
+static bool test_side_start(struct test_side *side)
+{
+   netplay_t *netplay = side->netplay;
+
+   netplay->io     = netplay_io_new();
+   netplay->io_tcp = netplay->io ?
+      netplay_io_add(netplay->io, netplay->fd, NETPLAY_IO_STREAM) : -1;
+
+   return netplay->io_tcp >= 0 && netplay_io_start(netplay->io);
+}
+
+static void test_negotiate(void)
+{
+   int fd_host, fd_client;
+   struct test_side host, client;
+
+   CHECK(tcp_pair(&fd_host, &fd_client), "failed to connect");
+   CHECK(test_side_init(&host, true, fd_host, 30), "host setup failed");
+   CHECK(test_side_init(&client, false, fd_client, 1),
+         "client setup failed");
+   CHECK(client.netplay->sync.check_frames == 30,
+         "client checksums every %u frames",
+         client.netplay->sync.check_frames);
+   test_side_free(&host);
+   test_side_free(&client);
+
+   /* A host which doesn't checksum turns it off on the client. */
+   CHECK(tcp_pair(&fd_host, &fd_client), "failed to connect");
+   CHECK(test_side_init(&host, true, fd_host, 0), "host setup failed");
+   CHECK(test_side_init(&client, false, fd_client, 30),
+         "client setup failed");
+   CHECK(!client.netplay->sync.data, "client checksums anyway");
+   test_side_free(&host);
+   test_side_free(&client);
+
+   CHECK(tcp_pair(&fd_host, &fd_client), "failed to connect");
+   CHECK(test_side_init(&host, true, fd_host,
+            NETPLAY_MAX_CHECK_FRAMES + 1), "host setup failed");
+   CHECK(!test_side_init(&client, false, fd_client, 30),
+         "client took an interval of %u frames",
+         NETPLAY_MAX_CHECK_FRAMES + 1);
+   test_side_free(&host);
+   test_side_free(&client);
+}
+
+static void test_run_frame(struct test_side *side)
+{
+   test_cur = side;
+   test_get_cmds(side);
+   side->netplay->net_cbs->pre_frame(side->netplay);
+   core_run();
+   side->netplay->net_cbs->post_frame(side->netplay);
+}
+
+/* @desync: frame on which the client goes off the rails, or 0. */
+static void test_resync(unsigned check_frames, uint32_t desync)
+{
+   uint32_t frame, seed = 42;
+   size_t i;
+   int fd_host, fd_client;
+   struct test_side host, client;
+   unsigned replayed;
+
+   memset(&host, 0, sizeof(host));
+   memset(&client, 0, sizeof(client));
+   test_desyncs      = 0;
+   test_patches      = 0;
+   test_desync_frame = desync;
+
+   CHECK(tcp_pair(&fd_host, &fd_client), "failed to connect");
+   if (!test_side_init(&host, true, fd_host, check_frames) ||
+         !test_side_init(&client, false, fd_client, check_frames) ||
+         !test_side_start(&host) || !test_side_start(&client))
+   {
+      CHECK(false, "setup failed");
+      goto end;
+   }
+
+   /* Same game loaded on both sides. */
+   for (i = 8; i < test_state_size; i++)
+      host.core[i] = (uint8_t)test_rand(&seed);
+   memcpy(client.core, host.core, test_state_size);
+
+   for (frame = 0; frame < TEST_FRAMES; frame++)
+   {
+      test_run_frame(&host);
+      test_run_frame(&client);
+
+      /* Gives the checksums and patches time to cross over. */
+      usleep(200);
+   }
+
+   replayed = client.netplay->stats.replayed;
+
+   CHECK(host.netplay->frame_count == TEST_FRAMES &&
+         client.netplay->frame_count == TEST_FRAMES,
+         "%u and %u frames run", host.netplay->frame_count,
+         client.netplay->frame_count);
+   CHECK(replayed > 0, "no frames were replayed");
+   CHECK(!memcmp(host.core, client.core, test_state_size),
+         "states differ at the end");
+
+   if (desync)
+   {
+      CHECK(test_desyncs == 1, "%u desyncs detected", test_desyncs);
+      CHECK(test_patches == 1, "%u patches applied", test_patches);
+      CHECK(host.netplay->sync.patch_base != NETPLAY_SYNC_NO_BASE,
+            "patch wasn't against a shared state");
+      CHECK(client.netplay->sync.epoch == host.netplay->sync.epoch,
+            "client is on epoch %u, host on %u",
+            client.netplay->sync.epoch, host.netplay->sync.epoch);
+   }
+   else
+      CHECK(test_desyncs == 0 && host.netplay->sync.epoch == 0,
+            "%u desyncs detected without one", test_desyncs);
+
+   printf("resync every %u frames%s: %u frames replayed, "
+         "%u byte patch for a %u byte state\n",
+         check_frames, desync ? " with a desync" : "", replayed,
+         desync ? (unsigned)host.netplay->sync.patch_size : 0,
+         (unsigned)test_state_size);
+
+end:
+   test_side_free(&host);
+   test_side_free(&client);
+}
+
+/* Input delay the schedule asks for on @frame. */
+static unsigned test_delay_schedule(uint32_t frame)
+{
+   if (frame < 10)
+      return 0;
+   if (frame < 40)
+      return 4;
+   if (frame < 70)
+      return 2;
+   if (frame < 100)
+      return NETPLAY_MAX_INPUT_DELAY;
+   return 0;
+}
+
+static void test_input_delay(void)
+{
+   uint32_t frame;
+   int64_t last_sent            = -1;
+   uint32_t sent[160]           = {0};
+   unsigned times_sent[160]     = {0};
+   uint32_t used[160]           = {0};
+   netplay_t *netplay           = (netplay_t*)calloc(1, sizeof(*netplay));
+   unsigned prev_delay          = 0;
+   const uint32_t *last         = &netplay->packet_buffer[
+      (UDP_FRAME_PACKETS - 1) * UDP_WORDS_PER_FRAME];
+
+   for (frame = 0; frame < 120; frame++)
+   {
+      int64_t i, newest;
+      uint32_t state[UDP_WORDS_PER_FRAME - 1] = {0};
+      unsigned target = test_delay_schedule(frame);
+
+      /* Input read on each frame is the frame number plus one. */
+      state[0]               = frame + 1;
+      netplay->frame_count   = frame;
+      used[frame]            = netplay_net_delay_input(netplay, state,
+            target)[0];
+
+      CHECK(netplay->delay.frames + 1 >= prev_delay &&
+            netplay->delay.frames <= prev_delay + 1,
+            "delay went from %u to %u on frame %u", prev_delay,
+            netplay->delay.frames, frame);
+      prev_delay = netplay->delay.frames;
+
+      /* Whatever was added to the packet this frame. */
+      newest = last_sent < 0 && !last[1] ? -1 : (int64_t)ntohl(last[0]);
+      for (i = last_sent + 1; i <= newest; i++)
+      {
+         const uint32_t *entry = last -
+            (newest - i) * UDP_WORDS_PER_FRAME;
+
+         CHECK(ntohl(entry[0]) == i, "frame %u sent out of order",
+               (unsigned)i);
+         sent[i] = ntohl(entry[1]);
+         times_sent[i]++;
+      }
+      if (newest > last_sent)
+         last_sent = newest;
+   }
+
+   CHECK(netplay->delay.frames == 0, "delay stuck at %u",
+         netplay->delay.frames);
+
+   for (frame = 0; frame < 120; frame++)
+   {
+      CHECK(times_sent[frame] == 1, "frame %u sent %u times",
+            frame, times_sent[frame]);
+      /* What's used here is what the other side gets. */
+      CHECK(used[frame] == sent[frame],
+            "frame %u used input %u but sent %u", frame,
+            used[frame], sent[frame]);
+   }
+
+   /* Steady at 4 frames, input is used 4 frames after it's read. */
+   CHECK(used[30] == 30 - 4 + 1, "frame 30 used input read on %u",
+         used[30] - 1);
+
+   free(netplay);
+}
+
+static void test_delay_target(void)
+{
+   netplay_t *netplay = (netplay_t*)calloc(1, sizeof(*netplay));
+
+   netplay->delay.max = 6;
+   CHECK(netplay_net_input_delay_target(netplay, 60.0) == 6,
+         "fixed delay not used");
+
+   netplay->delay.adaptive = true;
+   netplay->delay.frames   = 2;
+   CHECK(netplay_net_input_delay_target(netplay, 60.0) == 2,
+         "delay moved without a round-trip time");
+
+   /* 50 ms one way is three frames at 60 fps. */
+   netplay->delay.frames   = 0;
+   netplay->delay.rtt      = 100000;
+   CHECK(netplay_net_input_delay_target(netplay, 60.0) == 3,
+         "wrong delay for 50 ms");
+   CHECK(netplay_net_input_delay_target(netplay, 30.0) == 2,
+         "wrong delay for 50 ms at 30 fps");
+
+   /* 22 ms lies between the points where one frame is added and
+    * where the second is dropped, so either stays. */
+   netplay->delay.rtt      = 44000;
+   netplay->delay.frames   = 1;
+   CHECK(netplay_net_input_delay_target(netplay, 60.0) == 1,
+         "delay grew within the hysteresis");
+   netplay->delay.frames   = 2;
+   CHECK(netplay_net_input_delay_target(netplay, 60.0) == 2,
+         "delay shrank within the hysteresis");
+
+   netplay->delay.rtt      = 2000;
+   CHECK(netplay_net_input_delay_target(netplay, 60.0) == 0,
+         "delay kept on a fast connection");
+
+   netplay->delay.rtt      = 1000000;
+   CHECK(netplay_net_input_delay_target(netplay, 60.0) == 6,
+         "delay went past the maximum");
+
+   free(netplay);
+}
+
+static void test_rtt(void)
+{
+   unsigned i;
+   netplay_t *netplay = (netplay_t*)calloc(1, sizeof(*netplay));
+
+   netplay_net_update_rtt(netplay, -5);
+   CHECK(netplay->delay.rtt == 0, "negative sample used");
+
+   netplay_net_update_rtt(netplay, 10000);
+   CHECK(netplay->delay.rtt == 10000 && netplay->delay.rtt_var == 5000,
+         "first sample gave %d / %d", (int)netplay->delay.rtt,
+         (int)netplay->delay.rtt_var);
+
+   for (i = 0; i < 50; i++)
+      netplay_net_update_rtt(netplay, 10000);
+   CHECK(netplay->delay.rtt == 10000 && netplay->delay.rtt_var < 10,
+         "steady samples gave %d / %d", (int)netplay->delay.rtt,
+         (int)netplay->delay.rtt_var);
+
+   netplay_net_update_rtt(netplay, 18000);
+   CHECK(netplay->delay.rtt == 11000, "smoothed to %d",
+         (int)netplay->delay.rtt);
+   CHECK(netplay->delay.rtt_var >= 2000, "variation %d",
+         (int)netplay->delay.rtt_var);
+
+   free(netplay);
+}
+
+int main(int argc, char *argv[])
+{
+   if (argc > 1)
+      test_state_size = strtoul(argv[1], NULL, 0);
+
+   test_input_delay();
+   test_delay_target();
+   test_rtt();
+   test_negotiate();
+   test_resync(30, 0);
+   test_resync(1, TEST_DESYNC_FRAME);
+   test_resync(30, TEST_DESYNC_FRAME);
+   test_resync(7, TEST_DESYNC_FRAME + 3);
+
+   return test_result();
+}
@@ -0,0 +1,238 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2016 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Tests for netplay savestate patches.
+ *
+ * Patches are round-tripped over sparse and dense changes, and
+ * malformed ones must be rejected. netplay_net_test covers their
+ * use in netplay_net.c.
+ *
+ * Usage: netplay_sync_test [state size] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <algorithms/mismatch.h>
+#include <features/features_cpu.h>
+#include <retro_test.h>
+
+#include "../netplay_sync.h"
+
+#define TEST_STATE_SIZE            (1024 * 1024 + 3)
+
+static uint32_t test_rand(uint32_t *seed)
+{
+   *seed = *seed * 1664525 + 1013904223;
+   return *seed >> 8;
+}
+
+static void fill_random(uint8_t *data, size_t size, uint32_t seed)
+{
+   size_t i;
+   for (i = 0; i < size; i++)
+      data[i] = (uint8_t)test_rand(&seed);
+}
+
+static void test_roundtrip(size_t size)
+{
+   unsigned i;
+   size_t patch_size;
+   netplay_sync_t *sync = netplay_sync_new(size, 1);
+   uint8_t *base        = (uint8_t*)malloc(size);
+   uint8_t *state       = (uint8_t*)malloc(size);
+   uint8_t *out         = (uint8_t*)malloc(size);
+   uint8_t *patch       = sync ?
+      (uint8_t*)malloc(netplay_sync_patch_max(sync)) : NULL;
+
+   CHECK(sync && base && state && out && patch, "allocation failed");
+   if (!sync || !base || !state || !out || !patch)
+      goto end;
+
+   fill_random(base, size, 1);
+   netplay_sync_snapshot(sync, 60, base, false);
+
+   /* Identical. */
+   patch_size = netplay_sync_diff(sync, 60, base, patch);
+   CHECK(patch_size == 3 * sizeof(uint16_t),
+         "identical states gave a %u byte patch", (unsigned)patch_size);
+
+   /* Sparse changes: both ends, a skip over 64K words and a run
+    * of changes longer than a run can be. */
+   memcpy(state, base, size);
+   state[0]        ^= 1;
+   state[size - 1] ^= 0x80;
+   state[size / 2] ^= 0x55;
+   for (i = 0; i < 70000 * 2 && 1000 + i < size / 2; i++)
+      state[1000 + i] = ~state[1000 + i];
+
+   patch_size = netplay_sync_diff(sync, 60, state, patch);
+   CHECK(patch_size && patch_size <= netplay_sync_patch_max(sync),
+         "bad patch size %u", (unsigned)patch_size);
+   CHECK(netplay_sync_apply(sync, 60, patch, patch_size, out),
+         "patch didn't apply");
+   CHECK(!memcmp(out, state, size), "patched state differs (size %u)",
+         (unsigned)size);
+
+   /* Everything changed is the worst case. */
+   for (i = 0; i < size; i++)
+      state[i] = ~base[i];
+   patch_size = netplay_sync_diff(sync, 60, state, patch);
+   CHECK(patch_size <= netplay_sync_patch_max(sync),
+         "patch of %u bytes overflowed the maximum of %u",
+         (unsigned)patch_size, (unsigned)netplay_sync_patch_max(sync));
+   CHECK(netplay_sync_apply(sync, 60, patch, patch_size, out)
+         && !memcmp(out, state, size), "dense patch failed");
+
+   /* Against no base at all. */
+   patch_size = netplay_sync_diff(sync, NETPLAY_SYNC_NO_BASE, state, patch);
+   CHECK(netplay_sync_apply(sync, NETPLAY_SYNC_NO_BASE, patch, patch_size,
+            out) && !memcmp(out, state, size), "full patch failed");
+
+   /* Missing base. */
+   CHECK(!netplay_sync_diff(sync, 61, state, patch),
+         "diff against a missing base");
+   CHECK(!netplay_sync_apply(sync, 61, patch, patch_size, out),
+         "apply against a missing base");
+
+end:
+   netplay_sync_free(sync);
+   free(base);
+   free(state);
+   free(out);
+   free(patch);
+}
+
+static void test_malformed(void)
+{
+   unsigned i;
+   size_t patch_size;
+   uint16_t bad[8];
+   uint32_t seed        = 7;
+   size_t size          = 4096;
+   netplay_sync_t *sync = netplay_sync_new(size, 1);
+   uint8_t *state       = (uint8_t*)calloc(1, size);
+   uint8_t *out         = (uint8_t*)malloc(size);
+   uint8_t *patch       = (uint8_t*)malloc(netplay_sync_patch_max(sync));
+
+   state[10]   = 1;
+   state[2000] = 2;
+   state[4095] = 3;
+   patch_size  = netplay_sync_diff(sync, NETPLAY_SYNC_NO_BASE, state, patch);
+
+   /* Any truncation loses the terminator. */
+   for (i = 0; i < patch_size; i++)
+      CHECK(!netplay_sync_apply(sync, NETPLAY_SYNC_NO_BASE, patch, i, out),
+            "patch truncated to %u bytes applied", i);
+
+   /* Skips and runs past the end of the state. */
+   bad[0] = 0; bad[1] = 0xffff; bad[2] = 0xffff;
+   CHECK(!netplay_sync_apply(sync, NETPLAY_SYNC_NO_BASE, bad, 6, out),
+         "skip past the end applied");
+
+   bad[0] = 4; bad[1] = (uint16_t)(size / 2 - 2);
+   bad[2] = bad[3] = bad[4] = bad[5] = 0;
+   bad[6] = bad[7] = 0;
+   CHECK(!netplay_sync_apply(sync, NETPLAY_SYNC_NO_BASE, bad, sizeof(bad),
+            out), "run past the end applied");
+
+   /* Garbage mustn't crash. */
+   for (i = 0; i < 10000; i++)
+   {
+      size_t j, len = test_rand(&seed) % 64;
+      for (j = 0; j < len; j++)
+         patch[j] = (uint8_t)test_rand(&seed);
+      netplay_sync_apply(sync, NETPLAY_SYNC_NO_BASE, patch, len, out);
+   }
+
+   netplay_sync_free(sync);
+   free(state);
+   free(out);
+   free(patch);
+}
+
+static void test_checks(void)
+{
+   uint8_t state[64];
+   netplay_sync_t *sync = netplay_sync_new(sizeof(state), 2);
+
+   memset(state, 0xaa, sizeof(state));
+
+   CHECK(netplay_sync_is_check_frame(sync, 4)
+         && !netplay_sync_is_check_frame(sync, 5), "check frames");
+   CHECK(netplay_sync_is_snapshot_frame(sync, 120)
+         && !netplay_sync_is_snapshot_frame(sync, 60 + 2), "snapshot frames");
+
+   netplay_sync_snapshot(sync, 0, state, false);
+   netplay_sync_snapshot(sync, 60, state, false);
+   CHECK(netplay_sync_shared_base(sync) == NETPLAY_SYNC_NO_BASE,
+         "nothing is shared yet");
+
+   CHECK(netplay_sync_local(sync, 0, 1) == NETPLAY_SYNC_PENDING, "pending");
+   CHECK(netplay_sync_remote(sync, 0, 1) == NETPLAY_SYNC_MATCH, "match");
+   CHECK(netplay_sync_shared_base(sync) == 0, "frame 0 is shared");
+
+   CHECK(netplay_sync_remote(sync, 60, 5) == NETPLAY_SYNC_PENDING, "pending");
+   CHECK(netplay_sync_local(sync, 60, 6) == NETPLAY_SYNC_MISMATCH,
+         "mismatch");
+   CHECK(netplay_sync_shared_base(sync) == 0, "frame 60 isn't shared");
+
+   netplay_sync_clear_remote(sync);
+   CHECK(netplay_sync_local(sync, 60, 5) == NETPLAY_SYNC_PENDING,
+         "remote checksums were cleared");
+   CHECK(netplay_sync_remote(sync, 60, 5) == NETPLAY_SYNC_MATCH, "match");
+   CHECK(netplay_sync_shared_base(sync) == 60, "frame 60 is shared");
+
+   netplay_sync_free(sync);
+}
+
+static void bench_checksum(size_t size)
+{
+   unsigned i;
+   uint32_t sum    = 0;
+   uint8_t *state  = (uint8_t*)malloc(size);
+   retro_time_t start;
+
+   fill_random(state, size, 3);
+
+   start = cpu_features_get_time_usec();
+   for (i = 0; i < 100; i++)
+   {
+      state[i] ^= 1;
+      sum      ^= netplay_sync_checksum(state, size);
+   }
+
+   printf("Checksum of %u bytes: %.3f ms (%08x)\n", (unsigned)size,
+         (cpu_features_get_time_usec() - start) / 100.0 / 1000.0,
+         (unsigned)sum);
+   free(state);
+}
+
+int main(int argc, char *argv[])
+{
+   size_t size = argc > 1 ? strtoul(argv[1], NULL, 0) : TEST_STATE_SIZE;
+
+   mismatch_init(cpu_features_get());
+
+   test_roundtrip(size);
+   test_roundtrip(size + 1);
+   test_roundtrip(5);
+   test_malformed();
+   test_checks();
+   bench_checksum(size);
+
+   return test_result();
+}
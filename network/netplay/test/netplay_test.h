@@ -0,0 +1,70 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2016 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_NETPLAY_TEST_H
+#define __RARCH_NETPLAY_TEST_H
+
+#include <string.h>
+
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <boolean.h>
+#include <retro_test.h>
+
+/* Connects two TCP sockets over the loopback interface. */
+static bool tcp_pair(int *fd_a, int *fd_b)
+{
+   struct sockaddr_in addr;
+   socklen_t len = sizeof(addr);
+   int listener  = socket(AF_INET, SOCK_STREAM, 0);
+
+   if (listener < 0)
+      return false;
+
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_family      = AF_INET;
+   addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+   *fd_a = -1;
+   *fd_b = -1;
+
+   if (bind(listener, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+         listen(listener, 1) < 0 ||
+         getsockname(listener, (struct sockaddr*)&addr, &len) < 0)
+      goto error;
+
+   *fd_a = socket(AF_INET, SOCK_STREAM, 0);
+   if (*fd_a < 0 ||
+         connect(*fd_a, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+      goto error;
+
+   *fd_b = accept(listener, NULL, NULL);
+   if (*fd_b < 0)
+      goto error;
+
+   close(listener);
+   return true;
+
+error:
+   if (*fd_a >= 0)
+      close(*fd_a);
+   close(listener);
+   return false;
+}
+
+#endif
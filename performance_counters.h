@@ -62,6 +62,17 @@ void performance_counter_start(struct retro_perf_counter *perf);
  **/
 void performance_counter_stop(struct retro_perf_counter *perf);
 
+/**
+ * performance_counter_add:
+ * @perf               : pointer to performance counter
+ * @ticks              : ticks spent in one run
+ *
+ * Counts a run that was timed elsewhere, e.g. summed up
+ * over several threads.
+ **/
+void performance_counter_add(struct retro_perf_counter *perf,
+      retro_perf_tick_t ticks);
+
 RETRO_END_DECLS
 
 #endif
@@ -25,6 +25,7 @@
 #include <streams/file_stream.h>
 #include <retro_miscellaneous.h>
 #include <file/file_path.h>
+#include <rhash.h>
 
 #include "playlist.h"
 #include "verbosity.h"
@@ -228,6 +229,70 @@ void playlist_update(playlist_t *playlist, size_t idx,
    }
 }
 
+static bool playlist_check_core(const char **core_path,
+      const char **core_name)
+{
+   if (string_is_empty(*core_path) || string_is_empty(*core_name))
+   {
+      if (string_is_empty(*core_name) && !string_is_empty(*core_path))
+      {
+         static char base_path[PATH_MAX_LENGTH] = {0};
+         fill_pathname_base_noext(base_path, *core_path, sizeof(base_path));
+         *core_name = base_path;
+         RARCH_LOG("core_name is now: %s\n", *core_name);
+      }
+
+      RARCH_LOG("core_name: %s.\n", string_is_empty(*core_name) ? "N/A" : *core_name);
+      RARCH_LOG("core_path: %s.\n", string_is_empty(*core_path) ? "N/A" : *core_path);
+
+      if (string_is_empty(*core_path) || string_is_empty(*core_name))
+      {
+         RARCH_ERR("cannot push NULL or empty core name into the playlist.\n");
+         return false;
+      }
+   }
+
+   return true;
+}
+
+static void playlist_push_front(playlist_t *playlist,
+      const char *path, const char *label,
+      const char *core_path, const char *core_name,
+      const char *crc32,
+      const char *db_name)
+{
+   if (playlist->size == playlist->cap)
+   {
+      playlist_free_entry(&playlist->entries[playlist->cap - 1]);
+      playlist->size--;
+   }
+
+   /* Everything past size is already empty. */
+   memmove(playlist->entries + 1, playlist->entries,
+         playlist->size * sizeof(struct playlist_entry));
+
+   playlist->entries[0].path      = NULL;
+   playlist->entries[0].label     = NULL;
+   playlist->entries[0].core_path = NULL;
+   playlist->entries[0].core_name = NULL;
+   playlist->entries[0].db_name   = NULL;
+   playlist->entries[0].crc32     = NULL;
+   if (!string_is_empty(path))
+      playlist->entries[0].path   = strdup(path);
+   if (!string_is_empty(label))
+      playlist->entries[0].label  = strdup(label);
+   if (!string_is_empty(core_path))
+      playlist->entries[0].core_path = strdup(core_path);
+   if (!string_is_empty(core_name))
+      playlist->entries[0].core_name = strdup(core_name);
+   if (!string_is_empty(db_name))
+      playlist->entries[0].db_name   = strdup(db_name);
+   if (!string_is_empty(crc32))
+      playlist->entries[0].crc32     = strdup(crc32);
+
+   playlist->size++;
+}
+
 /**
  * playlist_push:
  * @playlist        	   : Playlist handle.
@@ -248,25 +313,8 @@ bool playlist_push(playlist_t *playlist,
    if (!playlist)
       return false;
 
-   if (string_is_empty(core_path) || string_is_empty(core_name))
-   {
-      if (string_is_empty(core_name) && !string_is_empty(core_path))
-      {
-         static char base_path[PATH_MAX_LENGTH] = {0};
-         fill_pathname_base_noext(base_path, core_path, sizeof(base_path));
-         core_name = base_path;
-         RARCH_LOG("core_name is now: %s\n", core_name);
-      }
-
-      RARCH_LOG("core_name: %s.\n", string_is_empty(core_name) ? "N/A" : core_name);
-      RARCH_LOG("core_path: %s.\n", string_is_empty(core_path) ? "N/A" : core_path);
-
-      if (string_is_empty(core_path) || string_is_empty(core_name))
-      {
-         RARCH_ERR("cannot push NULL or empty core name into the playlist.\n");
-         return false;
-      }
-   }
+   if (!playlist_check_core(&core_path, &core_name))
+      return false;
 
    if (string_is_empty(path))
       path = NULL;
@@ -300,35 +348,8 @@ bool playlist_push(playlist_t *playlist,
       return true;
    }
 
-   if (playlist->size == playlist->cap)
-   {
-      playlist_free_entry(&playlist->entries[playlist->cap - 1]);
-      playlist->size--;
-   }
-
-   memmove(playlist->entries + 1, playlist->entries,
-         (playlist->cap - 1) * sizeof(struct playlist_entry));
-
-   playlist->entries[0].path      = NULL;
-   playlist->entries[0].label     = NULL;
-   playlist->entries[0].core_path = NULL;
-   playlist->entries[0].core_name = NULL;
-   playlist->entries[0].db_name   = NULL;
-   playlist->entries[0].crc32     = NULL;
-   if (!string_is_empty(path))
-      playlist->entries[0].path   = strdup(path);
-   if (!string_is_empty(label))
-      playlist->entries[0].label  = strdup(label);
-   if (!string_is_empty(core_path))
-      playlist->entries[0].core_path = strdup(core_path);
-   if (!string_is_empty(core_name))
-      playlist->entries[0].core_name = strdup(core_name);
-   if (!string_is_empty(db_name))
-      playlist->entries[0].db_name   = strdup(db_name);
-   if (!string_is_empty(crc32))
-      playlist->entries[0].crc32     = strdup(crc32);
-
-   playlist->size++;
+   playlist_push_front(playlist, path, label,
+         core_path, core_name, crc32, db_name);
 
    return true;
 }
@@ -534,3 +555,288 @@ void playlist_qsort(playlist_t *playlist)
          sizeof(struct playlist_entry),
          (int (*)(const void *, const void *))playlist_qsort_func);
 }
+
+struct playlist_cache_key
+{
+   char *path;
+   uint32_t hash;
+   struct playlist_cache_key *next;
+};
+
+struct playlist_cache_item
+{
+   playlist_t *playlist;
+   /* Set of the paths in the playlist. */
+   struct playlist_cache_key **buckets;
+   size_t bucket_count;
+   size_t key_count;
+   bool dirty;
+};
+
+struct playlist_cache
+{
+   struct playlist_cache_item *items;
+   size_t count;
+   size_t capacity;
+   size_t size;
+   unsigned flush_interval;
+   unsigned pending;
+};
+
+static struct playlist_cache_key **playlist_cache_find_key(
+      struct playlist_cache_item *item, const char *path, uint32_t hash)
+{
+   struct playlist_cache_key **key = 
+      &item->buckets[hash & (item->bucket_count - 1)];
+
+   for (; *key; key = &(*key)->next)
+      if ((*key)->hash == hash && string_is_equal((*key)->path, path))
+         break;
+
+   return key;
+}
+
+static void playlist_cache_add_key(struct playlist_cache_item *item,
+      const char *path)
+{
+   struct playlist_cache_key **slot = NULL;
+   struct playlist_cache_key *key   = NULL;
+   uint32_t hash                    = djb2_calculate(path);
+
+   if (item->key_count >= item->bucket_count)
+   {
+      size_t i;
+      size_t count = item->bucket_count * 2;
+      struct playlist_cache_key **buckets = (struct playlist_cache_key**)
+         calloc(count, sizeof(*buckets));
+
+      if (buckets)
+      {
+         for (i = 0; i < item->bucket_count; i++)
+         {
+            struct playlist_cache_key *next = NULL;
+
+            for (key = item->buckets[i]; key; key = next)
+            {
+               next                            = key->next;
+               key->next                       = buckets[key->hash & (count - 1)];
+               buckets[key->hash & (count - 1)] = key;
+            }
+         }
+
+         free(item->buckets);
+         item->buckets      = buckets;
+         item->bucket_count = count;
+      }
+   }
+
+   slot = playlist_cache_find_key(item, path, hash);
+   if (*slot)
+      return;
+
+   key = (struct playlist_cache_key*)malloc(sizeof(*key));
+   if (!key)
+      return;
+
+   key->path = strdup(path);
+   key->hash = hash;
+   key->next = NULL;
+
+   if (!key->path)
+   {
+      free(key);
+      return;
+   }
+
+   *slot = key;
+   item->key_count++;
+}
+
+static void playlist_cache_remove_key(struct playlist_cache_item *item,
+      const char *path)
+{
+   struct playlist_cache_key **slot = playlist_cache_find_key(
+         item, path, djb2_calculate(path));
+   struct playlist_cache_key *key   = *slot;
+
+   if (!key)
+      return;
+
+   *slot = key->next;
+   free(key->path);
+   free(key);
+   item->key_count--;
+}
+
+static void playlist_cache_free_item(struct playlist_cache_item *item)
+{
+   size_t i;
+
+   for (i = 0; item->buckets && i < item->bucket_count; i++)
+   {
+      struct playlist_cache_key *key  = item->buckets[i];
+      struct playlist_cache_key *next = NULL;
+
+      for (; key; key = next)
+      {
+         next = key->next;
+         free(key->path);
+         free(key);
+      }
+   }
+
+   free(item->buckets);
+   playlist_free(item->playlist);
+}
+
+static struct playlist_cache_item *playlist_cache_get_item(
+      playlist_cache_t *cache, const char *playlist_path)
+{
+   size_t i;
+   struct playlist_cache_item *item  = NULL;
+   struct playlist_cache_item *items = NULL;
+
+   for (i = 0; i < cache->count; i++)
+      if (string_is_equal(cache->items[i].playlist->conf_path, playlist_path))
+         return &cache->items[i];
+
+   if (cache->count == cache->capacity)
+   {
+      size_t capacity = cache->capacity ? cache->capacity * 2 : 8;
+
+      items = (struct playlist_cache_item*)realloc(cache->items,
+            capacity * sizeof(*items));
+      if (!items)
+         return NULL;
+
+      cache->items    = items;
+      cache->capacity = capacity;
+   }
+
+   item         = &cache->items[cache->count];
+   memset(item, 0, sizeof(*item));
+
+   item->playlist     = playlist_init(playlist_path, cache->size);
+   item->bucket_count = 64;
+   item->buckets      = (struct playlist_cache_key**)
+      calloc(item->bucket_count, sizeof(*item->buckets));
+
+   if (!item->playlist || !item->buckets)
+   {
+      playlist_cache_free_item(item);
+      return NULL;
+   }
+
+   for (i = 0; i < item->playlist->size; i++)
+      if (item->playlist->entries[i].path)
+         playlist_cache_add_key(item, item->playlist->entries[i].path);
+
+   cache->count++;
+
+   return item;
+}
+
+/**
+ * playlist_cache_new:
+ * @size                : Maximum capacity of each playlist.
+ * @flush_interval      : Number of new entries after which all
+ *                        changed playlists are written, or 0.
+ *
+ * Creates a set of playlists which stay open until
+ * playlist_cache_free(), so entries can be added to them
+ * without reading and writing the whole file every time.
+ *
+ * Returns: handle to new playlist cache if successful, otherwise NULL
+ **/
+playlist_cache_t *playlist_cache_new(size_t size, unsigned flush_interval)
+{
+   playlist_cache_t *cache = (playlist_cache_t*)calloc(1, sizeof(*cache));
+
+   if (!cache)
+      return NULL;
+
+   cache->size           = size;
+   cache->flush_interval = flush_interval;
+
+   return cache;
+}
+
+bool playlist_cache_push(playlist_cache_t *cache,
+      const char *playlist_path,
+      const char *path, const char *label,
+      const char *core_path, const char *core_name,
+      const char *crc32,
+      const char *db_name)
+{
+   struct playlist_cache_item *item = NULL;
+   playlist_t *playlist             = NULL;
+
+   if (!cache || string_is_empty(playlist_path) || string_is_empty(path))
+      return false;
+
+   item = playlist_cache_get_item(cache, playlist_path);
+   if (!item)
+      return false;
+
+   if (*playlist_cache_find_key(item, path, djb2_calculate(path)))
+      return false;
+
+   if (!playlist_check_core(&core_path, &core_name))
+      return false;
+
+   playlist = item->playlist;
+
+   if (playlist->size == playlist->cap && playlist->entries[playlist->cap - 1].path)
+      playlist_cache_remove_key(item, playlist->entries[playlist->cap - 1].path);
+
+   playlist_push_front(playlist, path, label,
+         core_path, core_name, crc32, db_name);
+   playlist_cache_add_key(item, path);
+   item->dirty = true;
+
+   if (cache->flush_interval && ++cache->pending >= cache->flush_interval)
+      playlist_cache_flush(cache);
+
+   return true;
+}
+
+/**
+ * playlist_cache_flush:
+ * @cache               : Playlist cache handle.
+ *
+ * Writes every playlist that changed since the last flush.
+ **/
+void playlist_cache_flush(playlist_cache_t *cache)
+{
+   size_t i;
+
+   if (!cache)
+      return;
+
+   for (i = 0; i < cache->count; i++)
+   {
+      if (!cache->items[i].dirty)
+         continue;
+
+      playlist_write_file(cache->items[i].playlist);
+      cache->items[i].dirty = false;
+   }
+
+   cache->pending = 0;
+}
+
+void playlist_cache_free(playlist_cache_t *cache)
+{
+   size_t i;
+
+   if (!cache)
+      return;
+
+   playlist_cache_flush(cache);
+
+   for (i = 0; i < cache->count; i++)
+      playlist_cache_free_item(&cache->items[i]);
+
+   free(cache->items);
+   free(cache);
+}
@@ -145,6 +145,50 @@ void playlist_write_file(playlist_t *playlist);
 
 void playlist_qsort(playlist_t *playlist);
 
+typedef struct playlist_cache playlist_cache_t;
+
+/**
+ * playlist_cache_new:
+ * @size                : Maximum capacity of each playlist.
+ * @flush_interval      : Number of new entries after which all
+ *                        changed playlists are written, or 0.
+ *
+ * Creates a set of playlists which stay open until
+ * playlist_cache_free(), so entries can be added to them
+ * without reading and writing the whole file every time.
+ *
+ * Returns: handle to new playlist cache if successful, otherwise NULL
+ **/
+playlist_cache_t *playlist_cache_new(size_t size, unsigned flush_interval);
+
+/**
+ * playlist_cache_push:
+ * @cache               : Playlist cache handle.
+ * @playlist_path       : Path to playlist contents file.
+ *
+ * Opens the playlist at @playlist_path if it isn't open yet, and
+ * pushes a new entry to its top unless it already has one for @path.
+ *
+ * Returns: true if the entry was added, otherwise false.
+ **/
+bool playlist_cache_push(playlist_cache_t *cache,
+      const char *playlist_path,
+      const char *path, const char *label,
+      const char *core_path, const char *core_name,
+      const char *crc32,
+      const char *db_name);
+
+/**
+ * playlist_cache_flush:
+ * @cache               : Playlist cache handle.
+ *
+ * Writes every playlist that changed since the last flush.
+ **/
+void playlist_cache_flush(playlist_cache_t *cache);
+
+/* Flushes and closes all playlists. */
+void playlist_cache_free(playlist_cache_t *cache);
+
 RETRO_END_DECLS
 
 #endif
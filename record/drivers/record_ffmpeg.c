@@ -25,8 +25,9 @@
 #include <compat/msvc.h>
 
 #include <boolean.h>
-#include <queues/fifo_queue.h>
+#include <queues/spsc_fifo.h>
 #include <rthreads/rthreads.h>
+#include <rthreads/rthread_pool.h>
 #include <gfx/scaler/scaler.h>
 #include <file/config_file.h>
 #include <conversion/float_to_s16.h>
@@ -124,6 +125,9 @@ struct ff_video_info
    AVFormatContext *format;
 
    struct scaler_ctx scaler;
+   /* Scaler threads, separate from the video driver's so that the
+    * encoder thread never waits on the main thread or stalls it. */
+   rthread_pool_t *pool;
    struct SwsContext *sws;
    bool use_sws;
 };
@@ -210,10 +214,10 @@ typedef struct ffmpeg
 
    scond_t *cond;
    slock_t *cond_lock;
-   slock_t *lock;
-   fifo_buffer_t *audio_fifo;
-   fifo_buffer_t *video_fifo;
-   fifo_buffer_t *attr_fifo;
+   /* Written by the frontend, read by the encoder thread. */
+   spsc_fifo_t *audio_fifo;
+   spsc_fifo_t *video_fifo;
+   spsc_fifo_t *attr_fifo;
    sthread_t *thread;
 
    volatile bool alive;
@@ -341,7 +345,8 @@ static bool ffmpeg_init_audio(ffmpeg_t *handle)
       rarch_resampler_realloc(&audio->resampler_data,
             &audio->resampler,
             settings->audio.resampler,
-            audio->ratio);
+            audio->ratio,
+            (enum resampler_quality)settings->audio.resampler_quality);
    }
    else
    {
@@ -473,6 +478,11 @@ static bool ffmpeg_init_video(ffmpeg_t *handle)
          return false;
    }
 
+   /* Scaling runs on the encoder thread, with as many threads
+    * as the encoder is allowed. */
+   video->pool        = rthread_pool_new(params->threads);
+   video->scaler.pool = video->pool;
+
    video->codec = avcodec_alloc_context3(codec);
 
    /* Useful to set scale_factor to 2 for chroma subsampled formats to
@@ -663,24 +673,40 @@ static void ffmpeg_thread(void *data);
 
 static bool init_thread(ffmpeg_t *handle)
 {
-   handle->lock = slock_new();
-   handle->cond_lock = slock_new();
-   handle->cond = scond_new();
-   handle->audio_fifo = fifo_new(32000 * sizeof(int16_t) *
+   handle->audio_fifo = spsc_fifo_new(32000 * sizeof(int16_t) *
          handle->params.channels * MAX_FRAMES / 60); /* Some arbitrary max size. */
-   handle->attr_fifo = fifo_new(sizeof(struct ffemu_video_data) * MAX_FRAMES);
-   handle->video_fifo = fifo_new(handle->params.fb_width * handle->params.fb_height *
+   handle->attr_fifo = spsc_fifo_new(sizeof(struct ffemu_video_data) * MAX_FRAMES);
+   handle->video_fifo = spsc_fifo_new(handle->params.fb_width * handle->params.fb_height *
             handle->video.pix_size * MAX_FRAMES);
 
+   if (!handle->audio_fifo || !handle->attr_fifo || !handle->video_fifo)
+   {
+      RARCH_ERR("[FFmpeg]: Cannot allocate frame buffers for %ux%u.\n",
+            handle->params.fb_width, handle->params.fb_height);
+      return false;
+   }
+
+   handle->cond_lock = slock_new();
+   handle->cond = scond_new();
+   if (!handle->cond_lock || !handle->cond)
+      goto error;
+
    handle->alive = true;
    handle->can_sleep = true;
    handle->thread = sthread_create(ffmpeg_thread, handle);
-
-   retro_assert(handle->lock && handle->cond_lock &&
-      handle->cond && handle->audio_fifo &&
-      handle->attr_fifo && handle->video_fifo && handle->thread);
+   if (!handle->thread)
+      goto error;
 
    return true;
+
+error:
+   if (handle->cond_lock)
+      slock_free(handle->cond_lock);
+   if (handle->cond)
+      scond_free(handle->cond);
+   handle->cond_lock = NULL;
+   handle->cond      = NULL;
+   return false;
 }
 
 static void deinit_thread(ffmpeg_t *handle)
@@ -696,7 +722,6 @@ static void deinit_thread(ffmpeg_t *handle)
    scond_signal(handle->cond);
    sthread_join(handle->thread);
 
-   slock_free(handle->lock);
    slock_free(handle->cond_lock);
    scond_free(handle->cond);
 
@@ -707,19 +732,19 @@ static void deinit_thread_buf(ffmpeg_t *handle)
 {
    if (handle->audio_fifo)
    {
-      fifo_free(handle->audio_fifo);
+      spsc_fifo_free(handle->audio_fifo);
       handle->audio_fifo = NULL;
    }
    
    if (handle->attr_fifo)
    {
-      fifo_free(handle->attr_fifo);
+      spsc_fifo_free(handle->attr_fifo);
       handle->attr_fifo = NULL;
    }
 
    if (handle->video_fifo)
    {
-      fifo_free(handle->video_fifo);
+      spsc_fifo_free(handle->video_fifo);
       handle->video_fifo = NULL;
    }
 }
@@ -751,6 +776,7 @@ static void ffmpeg_free(void *data)
    av_free(handle->video.conv_frame_buf);
 
    scaler_ctx_gen_reset(&handle->video.scaler);
+   rthread_pool_free(handle->video.pool);
 
    if (handle->video.sws)
       sws_freeContext(handle->video.sws);
@@ -831,17 +857,27 @@ static bool ffmpeg_push_video(void *data,
    if (drop_frame)
       return true;
 
+   /* Tightly pack our frame to conserve memory.
+    * libretro tends to use a very large pitch.
+    */
+   attr_data = *vid;
+
+   if (attr_data.is_dupe)
+      attr_data.width = attr_data.height = attr_data.pitch = 0;
+   else
+      attr_data.pitch = attr_data.width * handle->video.pix_size;
+
+   /* Both the attributes and the packed frame need room. */
    for (;;)
    {
-      unsigned avail;
-      slock_lock(handle->lock);
-      avail = fifo_write_avail(handle->attr_fifo);
-      slock_unlock(handle->lock);
+      size_t attr_avail  = spsc_fifo_write_avail(handle->attr_fifo);
+      size_t video_avail = spsc_fifo_write_avail(handle->video_fifo);
 
       if (!handle->alive)
          return false;
 
-      if (avail >= sizeof(*vid))
+      if (attr_avail >= sizeof(attr_data) &&
+            video_avail >= attr_data.height * attr_data.pitch)
          break;
 
       slock_lock(handle->cond_lock);
@@ -857,25 +893,15 @@ static bool ffmpeg_push_video(void *data,
       slock_unlock(handle->cond_lock);
    }
 
-   slock_lock(handle->lock);
-
-   /* Tightly pack our frame to conserve memory.
-    * libretro tends to use a very large pitch.
-    */
-   attr_data = *vid;
-
-   if (attr_data.is_dupe)
-      attr_data.width = attr_data.height = attr_data.pitch = 0;
-   else
-      attr_data.pitch = attr_data.width * handle->video.pix_size;
-
-   fifo_write(handle->attr_fifo, &attr_data, sizeof(attr_data));
-
    for (y = 0; y < attr_data.height; y++, offset += vid->pitch)
-      fifo_write(handle->video_fifo,
+      spsc_fifo_write_at(handle->video_fifo, y * attr_data.pitch,
             (const uint8_t*)vid->data + offset, attr_data.pitch);
+   spsc_fifo_write_commit(handle->video_fifo,
+         attr_data.height * attr_data.pitch);
 
-   slock_unlock(handle->lock);
+   /* The encoder thread waits for the attributes,
+    * so the frame has to be in place before them. */
+   spsc_fifo_write(handle->attr_fifo, &attr_data, sizeof(attr_data));
    scond_signal(handle->cond);
 
    return true;
@@ -894,10 +920,7 @@ static bool ffmpeg_push_audio(void *data,
 
    for (;;)
    {
-      unsigned avail;
-      slock_lock(handle->lock);
-      avail = fifo_write_avail(handle->audio_fifo);
-      slock_unlock(handle->lock);
+      size_t avail = spsc_fifo_write_avail(handle->audio_fifo);
 
       if (!handle->alive)
          return false;
@@ -919,10 +942,8 @@ static bool ffmpeg_push_audio(void *data,
       slock_unlock(handle->cond_lock);
    }
 
-   slock_lock(handle->lock);
-   fifo_write(handle->audio_fifo, audio_data->data,
+   spsc_fifo_write(handle->audio_fifo, audio_data->data,
          audio_data->frames * handle->params.channels * sizeof(int16_t));
-   slock_unlock(handle->lock);
    scond_signal(handle->cond);
 
    return true;
@@ -1255,13 +1276,13 @@ static bool ffmpeg_push_audio_thread(ffmpeg_t *handle,
 static void ffmpeg_flush_audio(ffmpeg_t *handle, void *audio_buf,
       size_t audio_buf_size)
 {
-   size_t avail = fifo_read_avail(handle->audio_fifo);
+   size_t avail = spsc_fifo_read_avail(handle->audio_fifo);
 
    if (avail)
    {
       struct ffemu_audio_data aud = {0};
 
-      fifo_read(handle->audio_fifo, audio_buf, avail);
+      spsc_fifo_read(handle->audio_fifo, audio_buf, avail);
 
       aud.frames = avail / (sizeof(int16_t) * handle->params.channels);
       aud.data = audio_buf;
@@ -1312,11 +1333,11 @@ static void ffmpeg_flush_buffers(ffmpeg_t *handle)
 
       if (handle->config.audio_enable)
       {
-         if (fifo_read_avail(handle->audio_fifo) >= audio_buf_size)
+         if (spsc_fifo_read_avail(handle->audio_fifo) >= audio_buf_size)
          {
             struct ffemu_audio_data aud = {0};
 
-            fifo_read(handle->audio_fifo, audio_buf, audio_buf_size);
+            spsc_fifo_read(handle->audio_fifo, audio_buf, audio_buf_size);
 
             aud.frames = handle->audio.codec->frame_size;
             aud.data = audio_buf;
@@ -1326,10 +1347,10 @@ static void ffmpeg_flush_buffers(ffmpeg_t *handle)
          }
       }
 
-      if (fifo_read_avail(handle->attr_fifo) >= sizeof(attr_buf))
+      if (spsc_fifo_read_avail(handle->attr_fifo) >= sizeof(attr_buf))
       {
-         fifo_read(handle->attr_fifo, &attr_buf, sizeof(attr_buf));
-         fifo_read(handle->video_fifo, video_buf, 
+         spsc_fifo_read(handle->attr_fifo, &attr_buf, sizeof(attr_buf));
+         spsc_fifo_read(handle->video_fifo, video_buf, 
                attr_buf.height * attr_buf.pitch);
          attr_buf.data = video_buf;
          ffmpeg_push_video_thread(handle, &attr_buf);
@@ -1392,14 +1413,12 @@ static void ffmpeg_thread(void *data)
       bool avail_video = false;
       bool avail_audio = false;
 
-      slock_lock(ff->lock);
-      if (fifo_read_avail(ff->attr_fifo) >= sizeof(attr_buf))
+      if (spsc_fifo_read_avail(ff->attr_fifo) >= sizeof(attr_buf))
          avail_video = true;
 
       if (ff->config.audio_enable)
-         if (fifo_read_avail(ff->audio_fifo) >= audio_buf_size)
+         if (spsc_fifo_read_avail(ff->audio_fifo) >= audio_buf_size)
             avail_audio = true;
-      slock_unlock(ff->lock);
 
       if (!avail_video && !avail_audio)
       {
@@ -1418,11 +1437,11 @@ static void ffmpeg_thread(void *data)
 
       if (avail_video && video_buf)
       {
-         slock_lock(ff->lock);
-         fifo_read(ff->attr_fifo, &attr_buf, sizeof(attr_buf));
-         fifo_read(ff->video_fifo, video_buf,
+         /* Not read in place, swscale may read past the
+          * end of the frame, and so past the end of the fifo. */
+         spsc_fifo_read(ff->attr_fifo, &attr_buf, sizeof(attr_buf));
+         spsc_fifo_read(ff->video_fifo, video_buf,
                attr_buf.height * attr_buf.pitch);
-         slock_unlock(ff->lock);
          scond_signal(ff->cond);
 
          attr_buf.data = video_buf;
@@ -1431,17 +1450,22 @@ static void ffmpeg_thread(void *data)
 
       if (avail_audio && audio_buf)
       {
+         size_t span;
          struct ffemu_audio_data aud = {0};
 
-         slock_lock(ff->lock);
-         fifo_read(ff->audio_fifo, audio_buf, audio_buf_size);
-         slock_unlock(ff->lock);
-         scond_signal(ff->cond);
-
+         /* Encode straight from the fifo unless the block wraps. */
+         aud.data = spsc_fifo_read_span(ff->audio_fifo, 0, &span);
+         if (span < audio_buf_size)
+         {
+            spsc_fifo_read_at(ff->audio_fifo, 0, audio_buf, audio_buf_size);
+            aud.data = audio_buf;
+         }
          aud.frames = ff->audio.codec->frame_size;
-         aud.data = audio_buf;
 
          ffmpeg_push_audio_thread(ff, &aud, true);
+
+         spsc_fifo_read_commit(ff->audio_fifo, audio_buf_size);
+         scond_signal(ff->cond);
       }
    }
 
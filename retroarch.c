@@ -43,6 +43,8 @@
 #include <retro_assert.h>
 
 #include <features/features_cpu.h>
+#include <algorithms/mismatch.h>
+#include <gfx/scaler/pixconv.h>
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -69,6 +71,7 @@
 
 #include "frontend/frontend_driver.h"
 #include "audio/audio_driver.h"
+#include "audio/audio_dsp_filter.h"
 #include "record/record_driver.h"
 #include "core.h"
 #include "configuration.h"
@@ -1366,6 +1369,12 @@ bool retroarch_main_init(int argc, char *argv[])
    }
 
    retroarch_validate_cpu_features();
+
+   /* Kernels are picked once, before any thread can use them. */
+   mismatch_init(cpu_features_get());
+   pixconv_init(cpu_features_get());
+   rarch_dsp_filter_init(cpu_features_get());
+
    config_load();
 
    runloop_ctl(RUNLOOP_CTL_TASK_INIT, NULL);
@@ -1471,6 +1480,8 @@ bool rarch_ctl(enum rarch_ctl_state state, void *data)
          runloop_ctl(RUNLOOP_CTL_STATE_FREE,  NULL);
          runloop_ctl(RUNLOOP_CTL_GLOBAL_FREE, NULL);
          runloop_ctl(RUNLOOP_CTL_DATA_DEINIT, NULL);
+         screenshot_deinit();
+         video_driver_thread_pool_free();
          config_free();
          break;
       case RARCH_CTL_DEINIT:
@@ -1811,6 +1822,8 @@ int retroarch_get_capabilities(enum rarch_capabilities type,
                strlcat(s, "AVX ", len);
             if (cpu & RETRO_SIMD_AVX2)
                strlcat(s, "AVX2 ", len);
+            if (cpu & RETRO_SIMD_AVX512)
+               strlcat(s, "AVX512 ", len);
             if (cpu & RETRO_SIMD_VFPU)
                strlcat(s, "VFPU ", len);
             if (cpu & RETRO_SIMD_NEON)
@@ -1098,10 +1098,13 @@ bool runloop_ctl(enum runloop_ctl_state state, void *data)
 #ifdef HAVE_THREADS
             settings_t *settings = config_get_ptr();
             bool threaded_enable = settings->threaded_data_runloop_enable;
+            unsigned workers     = settings->threaded_data_runloop_workers;
 #else
             bool threaded_enable = false;
+            unsigned workers     = 0;
 #endif
             task_queue_ctl(TASK_QUEUE_CTL_DEINIT, NULL);
+            task_queue_ctl(TASK_QUEUE_CTL_SET_WORKERS, &workers);
             task_queue_ctl(TASK_QUEUE_CTL_INIT, &threaded_enable);
          }
          break;
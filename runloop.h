@@ -224,6 +224,10 @@ typedef struct global
       bool is_client;
       bool is_spectate;
       unsigned sync_frames;
+      unsigned check_frames;
+      unsigned input_delay_frames;
+      bool input_delay_auto;
+      unsigned rollback_frames;
       unsigned port;
    } netplay;
 #endif
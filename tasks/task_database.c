@@ -20,7 +20,13 @@
 #include <string/stdstring.h>
 #include <lists/dir_list.h>
 #include <file/file_path.h>
+#include <retro_stat.h>
+#include <features/features_cpu.h>
 #include <queues/message_queue.h>
+#include <streams/file_stream.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #include "tasks_internal.h"
 
@@ -40,8 +46,29 @@
 #define COLLECTION_SIZE                99999
 #endif
 
+/* Files are read and hashed in chunks of this size,
+ * so large files are spread over all scanner threads. */
+#define DATABASE_CRC_CHUNK_SIZE        (256 * 1024)
+
+/* How many files the scanner threads may get ahead 
+ * of the database lookups. */
+#define DATABASE_CRC_WINDOW            64
+
+/* Playlists stay open during a scan, and are written
+ * after this many new entries and when the scan ends. */
+#define DATABASE_PLAYLIST_FLUSH_INTERVAL 256
+
+typedef struct database_crc_scanner database_crc_scanner_t;
+
 typedef struct database_state_handle
 {
+   database_crc_scanner_t *scanner;
+   database_info_index_t *index;
+   bool index_failed;
+   playlist_cache_t *playlists;
+   retro_time_t scan_start;
+   uint64_t scan_bytes;
+   unsigned scan_files;
    database_info_list_t *info;
    struct string_list *list;
    size_t list_index;
@@ -63,6 +90,332 @@ typedef struct db_handle
 
 #ifdef HAVE_LIBRETRODB
 
+#if defined(HAVE_THREADS) && defined(HAVE_ZLIB)
+static bool task_database_wants_crc(const char *name)
+{
+   switch (msg_hash_to_file_type(msg_hash_calculate(path_get_extension(name))))
+   {
+      case FILE_TYPE_CUE:
+      case FILE_TYPE_ISO:
+      case FILE_TYPE_LUTRO:
+         return false;
+      default:
+         break;
+   }
+
+   return true;
+}
+
+enum database_crc_file_state
+{
+   DATABASE_CRC_FILE_SKIP = 0,
+   DATABASE_CRC_FILE_PENDING,
+   DATABASE_CRC_FILE_OPENING,
+   DATABASE_CRC_FILE_HASHING,
+   DATABASE_CRC_FILE_DONE,
+   DATABASE_CRC_FILE_FAILED
+};
+
+struct database_crc_file
+{
+   enum database_crc_file_state state;
+   size_t size;
+   unsigned chunks;
+   unsigned claimed;
+   unsigned hashed;
+   uint32_t *chunk_crc;
+   uint32_t crc;
+};
+
+/* Hashes the files of a scan ahead of the scan task. Each file is
+ * split into fixed-size chunks, which the threads read and hash
+ * independently, so one thread waiting on I/O doesn't keep the
+ * others from hashing. The CRCs of the chunks are combined once
+ * all of them are in. */
+struct database_crc_scanner
+{
+   const struct string_list *list;
+   const struct file_archive_file_backend *backend;
+   struct database_crc_file *files;
+   size_t next_file;   /* First file no thread has opened yet. */
+   size_t consumer;    /* File the scan task is waiting for. */
+
+   slock_t *lock;
+   scond_t *cond;
+   sthread_t **threads;
+   unsigned num_threads;
+   bool quit;
+
+   uint64_t bytes;
+   unsigned hashed_files;
+};
+
+/* Finds the next chunk to read, or a file to open.
+ * Call with the lock held. */
+static bool database_crc_scanner_claim(database_crc_scanner_t *scanner,
+      size_t *index, unsigned *chunk)
+{
+   size_t i;
+   size_t end = scanner->consumer + DATABASE_CRC_WINDOW;
+
+   for (i = scanner->consumer; i < scanner->next_file; i++)
+   {
+      struct database_crc_file *file = &scanner->files[i];
+
+      if (file->state == DATABASE_CRC_FILE_HASHING
+            && file->claimed < file->chunks)
+      {
+         *index = i;
+         *chunk = file->claimed++;
+         return true;
+      }
+   }
+
+   while (scanner->next_file < scanner->list->size &&
+         scanner->files[scanner->next_file].state == DATABASE_CRC_FILE_SKIP)
+      scanner->next_file++;
+
+   if (scanner->next_file >= scanner->list->size
+         || scanner->next_file >= end)
+      return false;
+
+   *index = scanner->next_file++;
+   *chunk = 0;
+   scanner->files[*index].state = DATABASE_CRC_FILE_OPENING;
+   return true;
+}
+
+static void database_crc_scanner_thread(void *data)
+{
+   database_crc_scanner_t *scanner = (database_crc_scanner_t*)data;
+   uint8_t *buf                    = (uint8_t*)malloc(DATABASE_CRC_CHUNK_SIZE);
+   RFILE *fp                       = NULL;
+   size_t fp_index                 = 0;
+
+   slock_lock(scanner->lock);
+
+   while (buf && !scanner->quit)
+   {
+      size_t index, offset, len;
+      unsigned chunk;
+      uint32_t crc;
+      struct database_crc_file *file = NULL;
+      bool opening                   = false;
+
+      if (!database_crc_scanner_claim(scanner, &index, &chunk))
+      {
+         scond_wait(scanner->cond, scanner->lock);
+         continue;
+      }
+
+      file    = &scanner->files[index];
+      opening = file->state == DATABASE_CRC_FILE_OPENING;
+      slock_unlock(scanner->lock);
+
+      if (!fp || fp_index != index)
+      {
+         if (fp)
+            filestream_close(fp);
+         fp       = filestream_open(scanner->list->elems[index].data,
+               RFILE_MODE_READ | RFILE_HINT_UNBUFFERED, -1);
+         fp_index = index;
+      }
+
+      if (opening)
+      {
+         ssize_t size = -1;
+
+         if (fp && filestream_seek(fp, 0, SEEK_END) >= 0)
+            size = filestream_tell(fp);
+
+         slock_lock(scanner->lock);
+
+         if (size <= 0)
+         {
+            file->state = DATABASE_CRC_FILE_FAILED;
+            scond_broadcast(scanner->cond);
+            continue;
+         }
+
+         file->size      = size;
+         file->chunks    = (size + DATABASE_CRC_CHUNK_SIZE - 1)
+            / DATABASE_CRC_CHUNK_SIZE;
+         file->chunk_crc = (uint32_t*)calloc(file->chunks, sizeof(uint32_t));
+         file->claimed   = 1;
+         file->state     = file->chunk_crc
+            ? DATABASE_CRC_FILE_HASHING : DATABASE_CRC_FILE_FAILED;
+
+         /* Let the other threads help with the remaining chunks. */
+         scond_broadcast(scanner->cond);
+
+         if (file->state == DATABASE_CRC_FILE_FAILED)
+            continue;
+
+         slock_unlock(scanner->lock);
+      }
+
+      offset = (size_t)chunk * DATABASE_CRC_CHUNK_SIZE;
+      len    = MIN(file->size - offset, DATABASE_CRC_CHUNK_SIZE);
+
+      if (!fp
+            || filestream_seek(fp, offset, SEEK_SET) < 0
+            || filestream_read(fp, buf, len) != (ssize_t)len)
+      {
+         slock_lock(scanner->lock);
+         file->state = DATABASE_CRC_FILE_FAILED;
+         scond_broadcast(scanner->cond);
+         continue;
+      }
+
+      crc = scanner->backend->stream_crc_calculate(0, buf, len);
+
+      slock_lock(scanner->lock);
+
+      if (file->state != DATABASE_CRC_FILE_HASHING)
+         continue;
+
+      file->chunk_crc[chunk] = crc;
+      scanner->bytes        += len;
+
+      if (++file->hashed == file->chunks)
+      {
+         unsigned i;
+
+         file->crc = file->chunk_crc[0];
+         for (i = 1; i < file->chunks; i++)
+            file->crc = scanner->backend->stream_crc_combine(file->crc,
+                  file->chunk_crc[i],
+                  MIN(file->size - (size_t)i * DATABASE_CRC_CHUNK_SIZE,
+                     DATABASE_CRC_CHUNK_SIZE));
+
+         file->state = DATABASE_CRC_FILE_DONE;
+         scanner->hashed_files++;
+         scond_broadcast(scanner->cond);
+      }
+   }
+
+   slock_unlock(scanner->lock);
+
+   if (fp)
+      filestream_close(fp);
+   free(buf);
+}
+
+static void database_crc_scanner_free(database_crc_scanner_t *scanner)
+{
+   size_t i;
+
+   if (!scanner)
+      return;
+
+   if (scanner->lock)
+   {
+      slock_lock(scanner->lock);
+      scanner->quit = true;
+      scond_broadcast(scanner->cond);
+      slock_unlock(scanner->lock);
+   }
+
+   for (i = 0; i < scanner->num_threads; i++)
+      if (scanner->threads[i])
+         sthread_join(scanner->threads[i]);
+
+   if (scanner->files)
+      for (i = 0; i < scanner->list->size; i++)
+         free(scanner->files[i].chunk_crc);
+
+   free(scanner->threads);
+   free(scanner->files);
+   scond_free(scanner->cond);
+   slock_free(scanner->lock);
+   free(scanner);
+}
+
+static database_crc_scanner_t *database_crc_scanner_new(
+      const struct string_list *list, unsigned num_threads)
+{
+   size_t i;
+   database_crc_scanner_t *scanner = (database_crc_scanner_t*)
+      calloc(1, sizeof(*scanner));
+
+   if (!scanner)
+      return NULL;
+
+   scanner->list        = list;
+   scanner->backend     = file_archive_get_default_file_backend();
+   scanner->files       = (struct database_crc_file*)
+      calloc(list->size, sizeof(*scanner->files));
+   scanner->threads     = (sthread_t**)calloc(num_threads,
+         sizeof(*scanner->threads));
+   scanner->lock        = slock_new();
+   scanner->cond        = scond_new();
+
+   if (!scanner->backend || !scanner->backend->stream_crc_combine
+         || !scanner->files || !scanner->threads
+         || !scanner->lock || !scanner->cond)
+      goto error;
+
+   for (i = 0; i < list->size; i++)
+      if (task_database_wants_crc(list->elems[i].data))
+         scanner->files[i].state = DATABASE_CRC_FILE_PENDING;
+
+   for (; scanner->num_threads < num_threads; scanner->num_threads++)
+   {
+      scanner->threads[scanner->num_threads] = sthread_create(
+            database_crc_scanner_thread, scanner);
+      if (!scanner->threads[scanner->num_threads])
+         goto error;
+   }
+
+   return scanner;
+
+error:
+   database_crc_scanner_free(scanner);
+   return NULL;
+}
+
+/* Returns 1 and the CRC if file @index has been hashed, 0 if it
+ * couldn't be read, or -1 if it isn't done within @timeout_us. */
+static int database_crc_scanner_get(database_crc_scanner_t *scanner,
+      size_t index, int64_t timeout_us, uint32_t *crc)
+{
+   int ret                        = -1;
+   struct database_crc_file *file = &scanner->files[index];
+
+   slock_lock(scanner->lock);
+
+   if (scanner->consumer != index)
+   {
+      /* Moves the window ahead. */
+      scanner->consumer = index;
+      scond_broadcast(scanner->cond);
+   }
+
+   if (timeout_us && file->state != DATABASE_CRC_FILE_DONE
+         && file->state != DATABASE_CRC_FILE_FAILED
+         && file->state != DATABASE_CRC_FILE_SKIP)
+      scond_wait_timeout(scanner->cond, scanner->lock, timeout_us);
+
+   switch (file->state)
+   {
+      case DATABASE_CRC_FILE_DONE:
+         *crc = file->crc;
+         ret  = 1;
+         break;
+      case DATABASE_CRC_FILE_FAILED:
+      case DATABASE_CRC_FILE_SKIP:
+         ret  = 0;
+         break;
+      default:
+         break;
+   }
+
+   slock_unlock(scanner->lock);
+
+   return ret;
+}
+#endif
+
 #ifdef HAVE_ZLIB
 static int zlib_compare_crc32(const char *name, const char *valid_exts,
       const uint8_t *cdata, unsigned cmode, uint32_t csize, uint32_t size,
@@ -179,15 +532,45 @@ static bool file_get_crc(database_state_handle_t *db_state,
          0, db_state->buf, ret);
 #endif
 
+   db_state->scan_bytes += ret;
+   db_state->scan_files++;
+
    return 1;
 }
 
+static bool task_database_get_crc(database_state_handle_t *db_state,
+      database_info_handle_t *db, const char *name, uint32_t *crc)
+{
+#if defined(HAVE_THREADS) && defined(HAVE_ZLIB)
+   if (db_state->scanner)
+      return database_crc_scanner_get(db_state->scanner,
+            db->list_ptr, 0, crc) == 1;
+#endif
+   return file_get_crc(db_state, name, crc);
+}
+
 static int task_database_iterate_playlist(
       database_state_handle_t *db_state,
       database_info_handle_t *db, const char *name)
 {
    char parent_dir[PATH_MAX_LENGTH] = {0};
 
+#if defined(HAVE_THREADS) && defined(HAVE_ZLIB)
+   if (db_state->scanner)
+   {
+      uint32_t crc;
+      /* Blocking a little is fine on a task thread, 
+       * but not when tasks run on the main thread. */
+      int64_t timeout = task_queue_ctl(TASK_QUEUE_CTL_IS_THREADED, NULL)
+         ? 10000 : 0;
+
+      /* Still being hashed, try again on the next run of the task. */
+      if (database_crc_scanner_get(db_state->scanner,
+               db->list_ptr, timeout, &crc) < 0)
+         return 1;
+   }
+#endif
+
    path_parent_dir(parent_dir);
 
    switch (msg_hash_to_file_type(msg_hash_calculate(path_get_extension(name))))
@@ -198,7 +581,7 @@ static int task_database_iterate_playlist(
          memset(&db->state, 0, sizeof(file_archive_transfer_t));
          db_state->zip_name[0] = '\0';
          db->state.type = ZLIB_TRANSFER_INIT;
-         return file_get_crc(db_state, name, &db_state->zip_crc);
+         return task_database_get_crc(db_state, db, name, &db_state->zip_crc);
 #else
          break;
 #endif
@@ -217,7 +600,7 @@ static int task_database_iterate_playlist(
          break;
       default:
          db->type = DATABASE_TYPE_CRC_LOOKUP;
-         return file_get_crc(db_state, name, &db_state->crc);
+         return task_database_get_crc(db_state, db, name, &db_state->crc);
    }
 
    return 1;
@@ -260,6 +643,15 @@ static int database_info_list_iterate_new(database_state_handle_t *db_state,
    return 0;
 }
 
+static playlist_cache_t *task_database_get_playlists(
+      database_state_handle_t *db_state)
+{
+   if (!db_state->playlists)
+      db_state->playlists = playlist_cache_new(COLLECTION_SIZE,
+            DATABASE_PLAYLIST_FLUSH_INTERVAL);
+   return db_state->playlists;
+}
+
 static int database_info_list_iterate_found_match(
       database_state_handle_t *db_state,
       database_info_handle_t *db,
@@ -270,7 +662,6 @@ static int database_info_list_iterate_found_match(
    char db_playlist_path[PATH_MAX_LENGTH]      = {0};
    char  db_playlist_base_str[PATH_MAX_LENGTH] = {0};
    char entry_path_str[PATH_MAX_LENGTH]        = {0};
-   playlist_t   *playlist                      = NULL;
    settings_t           *settings              = config_get_ptr();
    const char            *db_path              = 
       db_state->list->elems[db_state->list_index].data;
@@ -288,9 +679,6 @@ static int database_info_list_iterate_found_match(
    fill_pathname_join(db_playlist_path, settings->directory.playlist,
          db_playlist_base_str, sizeof(db_playlist_path));
 
-   playlist = playlist_init(db_playlist_path, COLLECTION_SIZE);
-
-
    snprintf(db_crc, sizeof(db_crc), "%08X|crc", db_info_entry->crc32);
 
    if (entry_path)
@@ -312,17 +700,12 @@ static int database_info_list_iterate_found_match(
    RARCH_LOG("entry path str: %s\n", entry_path_str);
 #endif
 
-   if(!playlist_entry_exists(playlist, entry_path_str, db_crc))
-   {
-      playlist_push(playlist, entry_path_str,
-            db_info_entry->name,
-            file_path_str(FILE_PATH_DETECT),
-            file_path_str(FILE_PATH_DETECT),
-            db_crc, db_playlist_base_str);
-   }
-
-   playlist_write_file(playlist);
-   playlist_free(playlist);
+   playlist_cache_push(task_database_get_playlists(db_state),
+         db_playlist_path, entry_path_str,
+         db_info_entry->name,
+         file_path_str(FILE_PATH_DETECT),
+         file_path_str(FILE_PATH_DETECT),
+         db_crc, db_playlist_base_str);
 
    database_info_list_free(db_state->info);
 
@@ -347,6 +730,81 @@ static int database_info_list_iterate_next(
    return 1;
 }
 
+/* Builds the CRC/serial index of all databases on first use,
+ * or loads it from the cache directory if none of them changed. */
+static database_info_index_t *task_database_get_index(
+      database_state_handle_t *db_state)
+{
+   char cache_path[PATH_MAX_LENGTH] = {0};
+   settings_t *settings             = config_get_ptr();
+   const char *dir                  = settings->directory.cache;
+   retro_time_t start;
+
+   if (db_state->index || db_state->index_failed || !db_state->list)
+      return db_state->index;
+
+   /* Without a cache directory the index is rebuilt every scan. */
+   if (!string_is_empty(dir) && path_is_directory(dir))
+      fill_pathname_join(cache_path, dir,
+            "database.idx", sizeof(cache_path));
+
+   start           = cpu_features_get_time_usec();
+   db_state->index = database_info_index_new(db_state->list, cache_path);
+
+   if (!db_state->index)
+   {
+      RARCH_WARN("Could not index databases, "
+            "falling back to database queries.\n");
+      db_state->index_failed = true;
+      return NULL;
+   }
+
+   RARCH_LOG("Indexed %u databases in %.1f ms.\n",
+         (unsigned)db_state->list->size,
+         (cpu_features_get_time_usec() - start) / 1000.0);
+
+   return db_state->index;
+}
+
+static int task_database_index_found_match(
+      database_state_handle_t *db_state,
+      database_info_handle_t *db,
+      int entry, const char *zip_name)
+{
+   database_info_list_free(db_state->info);
+
+   db_state->entry_index = 0;
+   db_state->info        = database_info_index_get(
+         db_state->index, entry, &db_state->list_index);
+
+   if (!db_state->info)
+      return database_info_list_iterate_end_no_match(db_state);
+
+   database_info_list_iterate_found_match(db_state, db, zip_name);
+   return database_info_list_iterate_end_no_match(db_state);
+}
+
+static int task_database_index_crc_lookup(
+      database_state_handle_t *db_state,
+      database_info_handle_t *db,
+      const char *zip_entry)
+{
+   int zip_match = database_info_index_find_crc(
+         db_state->index, db_state->zip_crc);
+   int match     = database_info_index_find_crc(
+         db_state->index, db_state->crc);
+
+   /* Same precedence as walking the databases entry by entry. */
+   if (zip_match >= 0 && (match < 0 || zip_match <= match))
+      return task_database_index_found_match(
+            db_state, db, zip_match, NULL);
+   if (match >= 0)
+      return task_database_index_found_match(
+            db_state, db, match, zip_entry);
+
+   return database_info_list_iterate_end_no_match(db_state);
+}
+
 static int task_database_iterate_crc_lookup(
       database_state_handle_t *db_state,
       database_info_handle_t *db,
@@ -357,6 +815,9 @@ static int task_database_iterate_crc_lookup(
          (unsigned)db_state->list_index == (unsigned)db_state->list->size)
       return database_info_list_iterate_end_no_match(db_state);
 
+   if (task_database_get_index(db_state))
+      return task_database_index_crc_lookup(db_state, db, zip_entry);
+
    if (db_state->entry_index == 0)
    {
       char query[50] = {0};
@@ -432,7 +893,7 @@ static int task_database_iterate_playlist_lutro(
       const char *path)
 {
    char db_playlist_path[PATH_MAX_LENGTH]      = {0};
-   playlist_t   *playlist                      = NULL;
+   char game_title[PATH_MAX_LENGTH]            = {0};
    settings_t           *settings              = config_get_ptr();
 
    fill_pathname_join(db_playlist_path,
@@ -440,25 +901,16 @@ static int task_database_iterate_playlist_lutro(
          file_path_str(FILE_PATH_LUTRO_PLAYLIST),
          sizeof(db_playlist_path));
 
-   playlist = playlist_init(db_playlist_path, COLLECTION_SIZE);
+   fill_short_pathname_representation_noext(game_title,
+         path, sizeof(game_title));
 
-   if(!playlist_entry_exists(playlist, path, file_path_str(FILE_PATH_DETECT)))
-   {
-      char game_title[PATH_MAX_LENGTH]            = {0};
-
-      fill_short_pathname_representation_noext(game_title,
-            path, sizeof(game_title));
-
-      playlist_push(playlist, path,
-            game_title,
-            file_path_str(FILE_PATH_DETECT),
-            file_path_str(FILE_PATH_DETECT),
-            file_path_str(FILE_PATH_DETECT),
-            file_path_str(FILE_PATH_LUTRO_PLAYLIST));
-   }
-
-   playlist_write_file(playlist);
-   playlist_free(playlist);
+   playlist_cache_push(task_database_get_playlists(db_state),
+         db_playlist_path, path,
+         game_title,
+         file_path_str(FILE_PATH_DETECT),
+         file_path_str(FILE_PATH_DETECT),
+         file_path_str(FILE_PATH_DETECT),
+         file_path_str(FILE_PATH_LUTRO_PLAYLIST));
 
    return 0;
 }
@@ -472,6 +924,16 @@ static int task_database_iterate_serial_lookup(
          (unsigned)db_state->list_index == (unsigned)db_state->list->size)
       return database_info_list_iterate_end_no_match(db_state);
 
+   if (task_database_get_index(db_state))
+   {
+      int match = database_info_index_find_serial(
+            db_state->index, db_state->serial);
+
+      if (match >= 0)
+         return task_database_index_found_match(db_state, db, match, NULL);
+      return database_info_list_iterate_end_no_match(db_state);
+   }
+
    if (db_state->entry_index == 0)
    {
       char query[50]   = {0};
@@ -552,6 +1014,52 @@ static int task_database_iterate(database_state_handle_t *db_state,
    return 0;
 }
 
+static void task_database_scan_begin(database_state_handle_t *db_state,
+      database_info_handle_t *db)
+{
+   settings_t *settings = config_get_ptr();
+
+   db_state->scan_start = cpu_features_get_time_usec();
+
+#if defined(HAVE_THREADS) && defined(HAVE_ZLIB)
+   if (settings->database_scan_threads && db->list && !db_state->scanner)
+      db_state->scanner = database_crc_scanner_new(db->list,
+            settings->database_scan_threads);
+#endif
+}
+
+static void task_database_scan_finish(database_state_handle_t *db_state)
+{
+   char msg[256];
+   double seconds = (cpu_features_get_time_usec() 
+         - db_state->scan_start) / 1000000.0;
+
+#if defined(HAVE_THREADS) && defined(HAVE_ZLIB)
+   if (db_state->scanner)
+   {
+      slock_lock(db_state->scanner->lock);
+      db_state->scan_bytes = db_state->scanner->bytes;
+      db_state->scan_files = db_state->scanner->hashed_files;
+      slock_unlock(db_state->scanner->lock);
+   }
+#endif
+
+   if (seconds <= 0.0)
+      seconds = 0.000001;
+
+   snprintf(msg, sizeof(msg), "%s (%u %s, %.1f %s, %.1f %s)",
+         msg_hash_to_str(MSG_SCANNING_OF_DIRECTORY_FINISHED),
+         db_state->scan_files,
+         msg_hash_to_str(MSG_FILES),
+         db_state->scan_files / seconds,
+         msg_hash_to_str(MSG_FILES_PER_SECOND),
+         db_state->scan_bytes / seconds / (1024.0 * 1024.0),
+         msg_hash_to_str(MSG_MEGABYTES_PER_SECOND));
+
+   RARCH_LOG("%s\n", msg);
+   runloop_msg_queue_push(msg, 0, 180, true);
+}
+
 static void task_database_cleanup_state(
       database_state_handle_t *db_state)
 {
@@ -582,6 +1090,7 @@ static void task_database_handler(retro_task_t *task)
             dbstate->list = dir_list_new_special(
                   settings->path.content_database,
                   DIR_LIST_DATABASES, NULL);
+         task_database_scan_begin(dbstate, dbinfo);
          dbinfo->status = DATABASE_STATUS_ITERATE_START;
          break;
       case DATABASE_STATUS_ITERATE_START:
@@ -605,9 +1114,7 @@ static void task_database_handler(retro_task_t *task)
          }
          else
          {
-            runloop_msg_queue_push(
-                  msg_hash_to_str(MSG_SCANNING_OF_DIRECTORY_FINISHED),
-                  0, 180, true);
+            task_database_scan_finish(dbstate);
             goto task_finished;
          }
          break;
@@ -621,6 +1128,13 @@ static void task_database_handler(retro_task_t *task)
 task_finished:
    task->finished = true;
 
+#if defined(HAVE_THREADS) && defined(HAVE_ZLIB)
+   database_crc_scanner_free(dbstate->scanner);
+#endif
+
+   database_info_index_free(dbstate->index);
+   playlist_cache_free(dbstate->playlists);
+
    if (dbstate->list)
       dir_list_free(dbstate->list);
 
@@ -646,6 +1160,7 @@ bool task_push_dbscan(const char *fullpath,
    t->handler        = task_database_handler;
    t->state          = db;
    t->callback       = cb;
+   t->priority       = TASK_PRIORITY_LOW;
 
    if (directory)
       db->handle = database_info_dir_init(fullpath, DATABASE_TYPE_ITERATE);
@@ -254,6 +254,11 @@ void *task_push_http_transfer(const char *url, bool mute, const char *type,
       return NULL;
    }
 
+   /* Done here rather than in the handler, as transfers can
+    * run at once on worker threads. */
+   if (!network_init())
+      return NULL;
+
    conn = net_http_connection_new(url);
 
    if (!conn)
@@ -284,6 +289,8 @@ void *task_push_http_transfer(const char *url, bool mute, const char *type,
    t->callback             = cb;
    t->user_data            = user_data;
    t->progress             = -1;
+   /* Each transfer only touches its own connection. */
+   t->concurrent           = true;
 
    snprintf(tmp, sizeof(tmp), "%s '%s'",
          msg_hash_to_str(MSG_DOWNLOADING), path_basename(url));
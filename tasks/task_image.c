@@ -377,6 +377,9 @@ bool task_push_image_load(const char *fullpath,
    t->cleanup   = task_image_load_free;
    t->callback  = cb;
    t->user_data = user_data;
+   t->priority  = TASK_PRIORITY_HIGH;
+   /* Each load only touches its own nbio and decoder state. */
+   t->concurrent = true;
 
    task_queue_ctl(TASK_QUEUE_CTL_PUSH, t);
 
@@ -14,8 +14,6 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 
-/* TODO/FIXME - turn this into actual task */
-
 #ifdef _XBOX1
 #include <xtl.h>
 #include <xgraphics.h>
@@ -31,7 +29,10 @@
 #include <file/file_path.h>
 #include <compat/strl.h>
 #include <string/stdstring.h>
+#include <features/features_cpu.h>
 #include <gfx/scaler/scaler.h>
+#include <queues/task_queue.h>
+#include <rthreads/rthread_pool.h>
 
 #ifdef HAVE_RBMP
 #include <formats/rbmp.h>
@@ -48,6 +49,7 @@
 #include "../configuration.h"
 #include "../runloop.h"
 #include "../msg_hash.h"
+#include "../verbosity.h"
 
 #include "../gfx/video_driver.h"
 #include "../gfx/video_frame.h"
@@ -58,23 +60,241 @@
 
 #include "tasks_internal.h"
 
-/* Take frame bottom-up. */
+/* Frames are captured on the main thread, then converted and
+ * written out by a task. Capture buffers are kept for the next
+ * screenshot rather than allocating a whole frame every time. */
+#define SCREENSHOT_BUFFERS 2
+
+struct screenshot_buffer
+{
+   uint8_t *data;
+   size_t size;
+   bool busy;
+};
+
+typedef struct
+{
+   char filename[PATH_MAX_LENGTH];
+   /* Bottom-up, from a screenshot buffer. */
+   uint8_t *frame;
+   unsigned width;
+   unsigned height;
+   unsigned pitch;
+   enum scaler_pix_fmt in_fmt;
+   int compression_level;
+   /* When the screenshot was asked for, and how long
+    * the main thread took to capture it. */
+   retro_time_t start;
+   retro_time_t stall;
+} screenshot_task_state_t;
+
+/* Only touched on the main thread. */
+static struct screenshot_buffer screenshot_buffers[SCREENSHOT_BUFFERS];
+
+/* Converting and compressing holds a pool for a whole image,
+ * so screenshots have threads of their own rather than the
+ * video driver's. Created on the main thread before the first
+ * task is pushed. */
+static rthread_pool_t *screenshot_pool;
+
+static uint8_t *screenshot_buffer_acquire(size_t size)
+{
+   unsigned i;
+
+   for (i = 0; i < SCREENSHOT_BUFFERS; i++)
+   {
+      struct screenshot_buffer *buf = &screenshot_buffers[i];
+
+      if (buf->busy)
+         continue;
+
+      if (buf->size < size)
+      {
+         free(buf->data);
+         buf->size = 0;
+         buf->data = (uint8_t*)malloc(size);
+         if (!buf->data)
+            return NULL;
+         buf->size = size;
+      }
+
+      buf->busy = true;
+      return buf->data;
+   }
+
+   /* Screenshots taken faster than they can be written
+    * get a buffer of their own. */
+   return (uint8_t*)malloc(size);
+}
+
+static void screenshot_buffer_release(uint8_t *data)
+{
+   unsigned i;
+
+   for (i = 0; i < SCREENSHOT_BUFFERS; i++)
+   {
+      if (screenshot_buffers[i].busy && screenshot_buffers[i].data == data)
+      {
+         screenshot_buffers[i].busy = false;
+         return;
+      }
+   }
+
+   free(data);
+}
+
+/**
+ * screenshot_deinit:
+ *
+ * Frees the capture buffers and threads kept for screenshots.
+ * Call once no task is running anymore. Buffers still held by
+ * a task are left to it, and get freed when it is cleaned up.
+ **/
+void screenshot_deinit(void)
+{
+   unsigned i;
+
+   for (i = 0; i < SCREENSHOT_BUFFERS; i++)
+   {
+      struct screenshot_buffer *buf = &screenshot_buffers[i];
+
+      if (!buf->busy)
+         free(buf->data);
+      buf->data = NULL;
+      buf->size = 0;
+      buf->busy = false;
+   }
+
+#ifdef HAVE_THREADS
+   rthread_pool_free(screenshot_pool);
+#endif
+   screenshot_pool = NULL;
+}
+
+static void task_screenshot_handler(retro_task_t *task)
+{
+   screenshot_task_state_t *state = (screenshot_task_state_t*)task->state;
+   bool ret                       = false;
+#if defined(HAVE_RPNG)
+   struct scaler_ctx scaler       = {0};
+   rthread_pool_t *pool           = screenshot_pool;
+   uint8_t *out_buffer            = (uint8_t*)
+      malloc(state->width * state->height * 3);
+
+   if (out_buffer)
+   {
+      scaler.pool = pool;
+
+      video_frame_convert_to_bgr24(
+            &scaler,
+            out_buffer,
+            state->frame + (state->height - 1) * state->pitch,
+            state->width, state->height,
+            -(int)state->pitch,
+            state->in_fmt);
+
+      scaler_ctx_gen_reset(&scaler);
+
+      ret = rpng_save_image_bgr24_ext(
+            state->filename,
+            out_buffer,
+            state->width,
+            state->height,
+            state->width * 3,
+            state->compression_level,
+            pool);
+      free(out_buffer);
+   }
+#elif defined(HAVE_RBMP)
+   enum rbmp_source_type bmp_type = RBMP_SOURCE_TYPE_DONT_CARE;
+
+   if (state->in_fmt == SCALER_FMT_BGR24)
+      bmp_type = RBMP_SOURCE_TYPE_BGR24;
+   else if (state->in_fmt == SCALER_FMT_ARGB8888)
+      bmp_type = RBMP_SOURCE_TYPE_XRGB888;
+
+   ret = rbmp_save_image(state->filename,
+         state->frame,
+         state->width,
+         state->height,
+         state->pitch,
+         bmp_type);
+#endif
+
+   if (ret)
+      RARCH_LOG("[screenshot] Wrote %s in %.1f ms, main thread took %.1f ms.\n",
+            state->filename,
+            (cpu_features_get_time_usec() - state->start) / 1000.0,
+            state->stall / 1000.0);
+   else
+      task->error = strdup(msg_hash_to_str(MSG_FAILED_TO_TAKE_SCREENSHOT));
+
+   task->finished = true;
+}
+
+static void task_screenshot_callback(void *task_data,
+      void *user_data, const char *error)
+{
+   screenshot_task_state_t *state = (screenshot_task_state_t*)user_data;
+
+   (void)task_data;
+
+   if (error)
+   {
+      runloop_msg_queue_push(error, 1, 180, true);
+      return;
+   }
+
+#ifdef HAVE_IMAGEVIEWER
+   if (content_push_to_history_playlist(g_defaults.image_history,
+            state->filename, "imageviewer", "builtin"))
+      playlist_write_file(g_defaults.image_history);
+#else
+   (void)state;
+#endif
+}
+
+static void task_screenshot_cleanup(retro_task_t *task)
+{
+   screenshot_task_state_t *state = (screenshot_task_state_t*)task->state;
+
+   screenshot_buffer_release(state->frame);
+   free(state);
+}
+
+/**
+ * screenshot_dump:
+ * @global_name_base     : name of the content.
+ * @folder               : directory to write to.
+ * @frame                : frame from screenshot_buffer_acquire(),
+ *                         bottom-up. Taken over by the task.
+ * @width                : width of @frame.
+ * @height               : height of @frame.
+ * @pitch                : pitch of @frame.
+ * @in_fmt               : pixel format of @frame.
+ * @start                : time the screenshot was asked for.
+ *
+ * Returns: true (1) if the screenshot is being written,
+ * otherwise false (0).
+ **/
 static bool screenshot_dump(
       const char *global_name_base,
       const char *folder,
-      const void *frame,
+      uint8_t *frame,
       unsigned width,
       unsigned height,
-      int pitch, bool bgr24)
+      unsigned pitch,
+      enum scaler_pix_fmt in_fmt,
+      retro_time_t start)
 {
-   char filename[PATH_MAX_LENGTH] = {0};
    char shotname[256]             = {0};
-   bool ret                       = false;
+   retro_task_t *task             = NULL;
    settings_t *settings           = config_get_ptr();
-#if defined(HAVE_RPNG)
-   uint8_t *out_buffer            = NULL;
-   struct scaler_ctx scaler       = {0};
-#endif
+   screenshot_task_state_t *state = (screenshot_task_state_t*)
+      calloc(1, sizeof(*state));
+
+   if (!state)
+      goto error;
 
    if (settings->auto_screenshot_filename)
    {
@@ -85,74 +305,71 @@ static bool screenshot_dump(
    {
       snprintf(shotname, sizeof(shotname),"%s.png", path_basename(global_name_base));
    }
-   fill_pathname_join(filename, folder, shotname, sizeof(filename));
+   fill_pathname_join(state->filename, folder, shotname,
+         sizeof(state->filename));
 
 #ifdef _XBOX1
-   d3d_video_t *d3d = (d3d_video_t*)video_driver_get_ptr(true);
-   D3DSurface *surf = NULL;
-
-   d3d->dev->GetBackBuffer(-1, D3DBACKBUFFER_TYPE_MONO, &surf);
-   if (XGWriteSurfaceToFile(surf, filename) == S_OK)
-      ret = true;
-   surf->Release();
-#elif defined(HAVE_RPNG)
-   out_buffer = (uint8_t*)malloc(width * height * 3);
-   if (!out_buffer)
-      return false;
+   {
+      bool ret         = false;
+      d3d_video_t *d3d = (d3d_video_t*)video_driver_get_ptr(true);
+      D3DSurface *surf = NULL;
 
-   video_frame_convert_to_bgr24(
-         &scaler,
-         out_buffer,
-         (const uint8_t*)frame + ((int)height - 1) * pitch,
-         width, height,
-         -pitch,
-         bgr24);
-
-   scaler_ctx_gen_reset(&scaler);
-
-   ret = rpng_save_image_bgr24(
-         filename,
-         out_buffer,
-         width,
-         height,
-         width * 3
-         );
-   free(out_buffer);
-#elif defined(HAVE_RBMP)
-   enum rbmp_source_type bmp_type = RBMP_SOURCE_TYPE_DONT_CARE;
+      d3d->dev->GetBackBuffer(-1, D3DBACKBUFFER_TYPE_MONO, &surf);
+      if (XGWriteSurfaceToFile(surf, state->filename) == S_OK)
+         ret = true;
+      surf->Release();
 
-   if (bgr24)
-      bmp_type = RBMP_SOURCE_TYPE_BGR24;
-   else if (video_driver_get_pixel_format() == RETRO_PIXEL_FORMAT_XRGB8888)
-      bmp_type = RBMP_SOURCE_TYPE_XRGB888;
-
-   ret = rbmp_save_image(filename,
-         frame,
-         width,
-         height,
-         pitch,
-         bmp_type);
+      screenshot_buffer_release(frame);
+      free(state);
+      return ret;
+   }
 #endif
 
-#ifdef HAVE_IMAGEVIEWER
-   if (ret == true)
-   {
-      if (content_push_to_history_playlist(g_defaults.image_history, filename,  
-               "imageviewer", "builtin"))
-         playlist_write_file(g_defaults.image_history);
-   }
+   task = (retro_task_t*)calloc(1, sizeof(*task));
+   if (!task)
+      goto error;
+
+#if defined(HAVE_RPNG) && defined(HAVE_THREADS)
+   if (!screenshot_pool)
+      screenshot_pool = rthread_pool_new(cpu_features_get_core_amount());
 #endif
 
-   return ret;
+   state->frame             = frame;
+   state->width             = width;
+   state->height            = height;
+   state->pitch             = pitch;
+   state->in_fmt            = in_fmt;
+   state->compression_level = settings->screenshot_compression_level;
+   state->start             = start;
+   state->stall             = cpu_features_get_time_usec() - start;
+
+   task->state              = state;
+   task->handler            = task_screenshot_handler;
+   task->callback           = task_screenshot_callback;
+   task->cleanup            = task_screenshot_cleanup;
+   task->user_data          = state;
+   task->mute               = true;
+   /* The pool lets one conversion in at a time, and buffers
+    * are only released on the main thread in cleanup. */
+   task->concurrent         = true;
+
+   task_queue_ctl(TASK_QUEUE_CTL_PUSH, task);
+
+   return true;
+
+error:
+   screenshot_buffer_release(frame);
+   free(state);
+   return false;
 }
 
 #if !defined(VITA)
-static bool take_screenshot_viewport(const char *global_name_base)
+static bool take_screenshot_viewport(const char *global_name_base,
+      retro_time_t start)
 {
    char screenshot_path[PATH_MAX_LENGTH] = {0};
    const char *screenshot_dir            = NULL;
    uint8_t *buffer                       = NULL;
-   bool retval                           = false;
    struct video_viewport vp              = {0};
    settings_t *settings                  = config_get_ptr();
 
@@ -161,12 +378,15 @@ static bool take_screenshot_viewport(const char *global_name_base)
    if (!vp.width || !vp.height)
       return false;
 
-   buffer = (uint8_t*)malloc(vp.width * vp.height * 3);
+   buffer = screenshot_buffer_acquire(vp.width * vp.height * 3);
    if (!buffer)
       return false;
 
    if (!video_driver_read_viewport(buffer))
-      goto done;
+   {
+      screenshot_buffer_release(buffer);
+      return false;
+   }
 
    screenshot_dir = settings->directory.screenshot;
 
@@ -178,30 +398,44 @@ static bool take_screenshot_viewport(const char *global_name_base)
    }
 
    /* Data read from viewport is in bottom-up order, suitable for BMP. */
-   if (!screenshot_dump(global_name_base, screenshot_dir, buffer, vp.width, vp.height,
-            vp.width * 3, true))
-      goto done;
-
-   retval = true;
-
-done:
-   if (buffer)
-      free(buffer);
-   return retval;
+   return screenshot_dump(global_name_base, screenshot_dir, buffer,
+         vp.width, vp.height, vp.width * 3, SCALER_FMT_BGR24, start);
 }
 #endif
 
-static bool take_screenshot_raw(const char *global_name_base)
+static bool take_screenshot_raw(const char *global_name_base,
+      retro_time_t start)
 {
-   unsigned width, height;
-   size_t pitch;
+   unsigned i, width, height;
+   size_t pitch, line_size;
    char screenshot_path[PATH_MAX_LENGTH] = {0};
    const void *data                      = NULL;
+   uint8_t *buffer                       = NULL;
+   enum scaler_pix_fmt in_fmt            = SCALER_FMT_RGB565;
    settings_t *settings                  = config_get_ptr();
    const char *screenshot_dir            = settings->directory.screenshot;
 
    video_driver_cached_frame_get(&data, &width, &height, &pitch);
 
+   if (!data || !width || !height)
+      return false;
+
+   if (video_driver_get_pixel_format() == RETRO_PIXEL_FORMAT_XRGB8888)
+      in_fmt = SCALER_FMT_ARGB8888;
+
+   line_size = width *
+      (in_fmt == SCALER_FMT_ARGB8888 ? sizeof(uint32_t) : sizeof(uint16_t));
+
+   buffer = screenshot_buffer_acquire(line_size * height);
+   if (!buffer)
+      return false;
+
+   /* The frame may be gone by the time the task gets to it. Copy it
+    * out, turning it bottom-up like a frame read from the viewport. */
+   for (i = 0; i < height; i++)
+      memcpy(buffer + (height - 1 - i) * line_size,
+            (const uint8_t*)data + i * pitch, line_size);
+
    if (string_is_empty(settings->directory.screenshot))
    {
       fill_pathname_basedir(screenshot_path, global_name_base,
@@ -209,18 +443,12 @@ static bool take_screenshot_raw(const char *global_name_base)
       screenshot_dir = screenshot_path;
    }
 
-   /* Negative pitch is needed as screenshot takes bottom-up,
-    * but we use top-down.
-    */
-   if (!screenshot_dump(global_name_base, screenshot_dir,
-         (const uint8_t*)data + (height - 1) * pitch,
-         width, height, -pitch, false))
-      return false;
-
-   return true;
+   return screenshot_dump(global_name_base, screenshot_dir, buffer,
+         width, height, line_size, in_fmt, start);
 }
 
-static bool take_screenshot_choice(const char *global_name_base)
+static bool take_screenshot_choice(const char *global_name_base,
+      retro_time_t start)
 {
    settings_t *settings = config_get_ptr();
 
@@ -234,14 +462,14 @@ static bool take_screenshot_choice(const char *global_name_base)
       video_driver_set_texture_enable(false, false);
       video_driver_cached_frame_render();
 #if defined(VITA)
-      return take_screenshot_raw(global_name_base);
+      return take_screenshot_raw(global_name_base, start);
 #else
-      return take_screenshot_viewport(global_name_base);
+      return take_screenshot_viewport(global_name_base, start);
 #endif
    }
 
    if (!video_driver_cached_frame_has_valid_framebuffer())
-      return take_screenshot_raw(global_name_base);
+      return take_screenshot_raw(global_name_base, start);
 
    if (video_driver_supports_read_frame_raw())
    {
@@ -263,7 +491,7 @@ static bool take_screenshot_choice(const char *global_name_base)
       if (frame_data)
       {
          video_driver_set_cached_frame_ptr(frame_data);
-         if (take_screenshot_raw(global_name_base))
+         if (take_screenshot_raw(global_name_base, start))
             ret = true;
          free(frame_data);
       }
@@ -277,14 +505,17 @@ static bool take_screenshot_choice(const char *global_name_base)
 /**
  * take_screenshot:
  *
+ * Captures the current frame and starts a task to write it out.
+ *
  * Returns: true (1) if successful, otherwise false (0).
  **/
 bool take_screenshot(void)
 {
+   retro_time_t start         = cpu_features_get_time_usec();
    global_t *global           = global_get_ptr();
    char *name_base            = strdup(global->name.base);
    bool            is_paused  = runloop_ctl(RUNLOOP_CTL_IS_PAUSED, NULL);
-   bool             ret       = take_screenshot_choice(name_base);
+   bool             ret       = take_screenshot_choice(name_base, start);
    const char *msg_screenshot = ret 
       ? msg_hash_to_str(MSG_TAKING_SCREENSHOT)  :
         msg_hash_to_str(MSG_FAILED_TO_TAKE_SCREENSHOT);
@@ -145,6 +145,9 @@ bool content_push_to_history_playlist(
 
 /* TODO/FIXME - turn this into actual task */
 bool take_screenshot(void);
+
+void screenshot_deinit(void);
+
 bool dump_to_file_desperate(const void *data,
       size_t size, unsigned type);
 
@@ -0,0 +1,178 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2016 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Adds synthetic database scan matches to one playlist, once by
+ * opening, checking, pushing and writing the playlist for every
+ * match as the scanner used to, and once through a playlist cache.
+ * Both playlists must end up the same. The per-match way gets
+ * slower with every entry, so it only gets the first few matches
+ * unless a count is given on the command line. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <features/features_cpu.h>
+#include <string/stdstring.h>
+
+#include "playlist.h"
+
+#define BENCH_MATCHES        10000
+#define BENCH_SHORT_MATCHES  1000
+#define BENCH_CAPACITY       99999
+#define BENCH_FLUSH_INTERVAL 256
+#define BENCH_PLAYLIST_OLD   "playlist_scan_bench_old.lpl"
+#define BENCH_PLAYLIST_NEW   "playlist_scan_bench_new.lpl"
+
+void RARCH_LOG(const char *fmt, ...) { }
+void RARCH_WARN(const char *fmt, ...) { }
+void RARCH_ERR(const char *fmt, ...) { }
+
+static void bench_match(unsigned i, char *path, char *label,
+      char *crc, size_t len)
+{
+   unsigned n = i % BENCH_MATCHES;
+
+   snprintf(path,  len, "/roms/Nintendo - Super Nintendo Entertainment "
+         "System/Synthetic Game %05u (USA).zip#Synthetic Game %05u.sfc", n, n);
+   snprintf(label, len, "Synthetic Game %05u (USA)", n);
+   snprintf(crc,   len, "%08X|crc", n * 2654435761u);
+}
+
+static retro_time_t bench_per_match(const char *playlist_path,
+      unsigned matches)
+{
+   unsigned i;
+   retro_time_t start = cpu_features_get_time_usec();
+
+   for (i = 0; i < matches; i++)
+   {
+      char path[256], label[256], crc[32];
+      playlist_t *playlist = playlist_init(playlist_path, BENCH_CAPACITY);
+
+      bench_match(i, path, label, crc, sizeof(path));
+
+      if (!playlist_entry_exists(playlist, path, crc))
+         playlist_push(playlist, path, label, "DETECT", "DETECT",
+               crc, "Synthetic.lpl");
+
+      playlist_write_file(playlist);
+      playlist_free(playlist);
+   }
+
+   return cpu_features_get_time_usec() - start;
+}
+
+static retro_time_t bench_cached(const char *playlist_path,
+      unsigned matches)
+{
+   unsigned i;
+   retro_time_t start      = cpu_features_get_time_usec();
+   playlist_cache_t *cache = playlist_cache_new(BENCH_CAPACITY,
+         BENCH_FLUSH_INTERVAL);
+
+   for (i = 0; i < matches; i++)
+   {
+      char path[256], label[256], crc[32];
+
+      bench_match(i, path, label, crc, sizeof(path));
+      playlist_cache_push(cache, playlist_path, path, label,
+            "DETECT", "DETECT", crc, "Synthetic.lpl");
+   }
+
+   playlist_cache_free(cache);
+
+   return cpu_features_get_time_usec() - start;
+}
+
+static bool bench_compare(unsigned expected)
+{
+   size_t i;
+   bool ok           = true;
+   playlist_t *a     = playlist_init(BENCH_PLAYLIST_OLD, BENCH_CAPACITY);
+   playlist_t *b     = playlist_init(BENCH_PLAYLIST_NEW, BENCH_CAPACITY);
+
+   if (!a || !b || playlist_size(a) != playlist_size(b))
+      ok = false;
+
+   for (i = 0; ok && i < playlist_size(a); i++)
+   {
+      if (  !string_is_equal(a->entries[i].path,  b->entries[i].path) ||
+            !string_is_equal(a->entries[i].label, b->entries[i].label) ||
+            !string_is_equal(a->entries[i].crc32, b->entries[i].crc32))
+      {
+         fprintf(stderr, "Playlists differ at entry %u.\n", (unsigned)i);
+         ok = false;
+      }
+   }
+
+   if (ok && playlist_size(a) != expected)
+      ok = false;
+
+   printf("%u entries in each playlist: %s\n",
+         (unsigned)playlist_size(b), ok ? "ok" : "mismatch");
+
+   playlist_free(a);
+   playlist_free(b);
+   return ok;
+}
+
+int main(int argc, char *argv[])
+{
+   retro_time_t old_time, new_time;
+   unsigned short_matches = BENCH_SHORT_MATCHES;
+   unsigned matches       = BENCH_MATCHES * 2;
+   bool ok;
+
+   if (argc > 1)
+      short_matches = strtoul(argv[1], NULL, 0);
+   if (short_matches > BENCH_MATCHES)
+      short_matches = BENCH_MATCHES;
+
+   remove(BENCH_PLAYLIST_OLD);
+   remove(BENCH_PLAYLIST_NEW);
+
+   old_time = bench_per_match(BENCH_PLAYLIST_OLD, short_matches);
+   new_time = bench_cached(BENCH_PLAYLIST_NEW, short_matches);
+
+   printf("%5u matches: per match %9.1f ms, cached %7.1f ms\n",
+         short_matches, old_time / 1000.0, new_time / 1000.0);
+
+   ok = bench_compare(short_matches);
+
+   /* Every match twice, as when rescanning a directory. */
+   remove(BENCH_PLAYLIST_NEW);
+   new_time = bench_cached(BENCH_PLAYLIST_NEW, matches);
+
+   printf("%5u matches:                        cached %7.1f ms\n",
+         matches, new_time / 1000.0);
+
+   {
+      playlist_t *playlist = playlist_init(BENCH_PLAYLIST_NEW, BENCH_CAPACITY);
+
+      if (playlist_size(playlist) != BENCH_MATCHES)
+      {
+         fprintf(stderr, "Expected %u entries, got %u.\n", BENCH_MATCHES,
+               (unsigned)playlist_size(playlist));
+         ok = false;
+      }
+      playlist_free(playlist);
+   }
+
+   remove(BENCH_PLAYLIST_OLD);
+   remove(BENCH_PLAYLIST_NEW);
+
+   return ok ? 0 : 1;
+}